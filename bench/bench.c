@@ -0,0 +1,341 @@
+/*
+ * bench.c - Micro-benchmark harness for jm-raid-status hot paths
+ *
+ * Copyright (C) 2026 Jamie Treworgy
+ * SPDX-License-Identifier: MIT
+ *
+ * Usage: jm-bench [--filter SUBSTR] [--min-time MS] [--data-dir DIR] [--json FILE]
+ *
+ * Each case is calibrated, then timed in BENCH_SAMPLES samples; ns/op is the
+ * median sample. Allocations are counted by wrapping malloc/calloc/realloc at
+ * link time (-Wl,--wrap), so only calls made from project code are seen.
+ */
+
+#include "bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <time.h>
+
+#define BENCH_SAMPLES 5
+#define BENCH_MAX_RESULTS 64
+#define BENCH_MAX_FILES 16
+#define BENCH_CALIBRATE_NS 1000000ULL  /* Calibrate until a run takes 1ms */
+
+typedef struct {
+    char name[64];
+    uint64_t iterations;                /* Per sample */
+    size_t bytes_per_op;
+    double ns_per_op;                   /* Median sample */
+    double min_ns_per_op;               /* Fastest sample */
+    double mb_per_s;                    /* From the median; 0 if bytes_per_op is 0 */
+    double allocs_per_op;
+    double alloc_bytes_per_op;
+} bench_result_t;
+
+static struct {
+    const char* filter;
+    const char* json_path;
+    const char* data_dir;
+    double min_time_ms;
+} g_opts = { NULL, NULL, "tests", 500.0 };
+
+static bench_result_t g_results[BENCH_MAX_RESULTS];
+static int g_num_results = 0;
+static FILE* g_table = NULL;
+
+static char* g_files[BENCH_MAX_FILES];
+static int g_num_files = 0;
+
+/* Allocation counters, fed by the --wrap hooks below */
+static uint64_t g_alloc_count = 0;
+static uint64_t g_alloc_bytes = 0;
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t nmemb, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+
+void* __wrap_malloc(size_t size) {
+    g_alloc_count++;
+    g_alloc_bytes += size;
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t nmemb, size_t size) {
+    g_alloc_count++;
+    g_alloc_bytes += nmemb * size;
+    return __real_calloc(nmemb, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+    g_alloc_count++;
+    g_alloc_bytes += size;
+    return __real_realloc(ptr, size);
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t time_iterations(bench_fn_t fn, void* ctx, uint64_t iterations) {
+    uint64_t start = now_ns();
+    for (uint64_t i = 0; i < iterations; i++) {
+        fn(ctx);
+    }
+    return now_ns() - start;
+}
+
+static int compare_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+void bench_run(const char* name, bench_fn_t fn, void* ctx, size_t bytes_per_op) {
+    if (g_opts.filter != NULL && strstr(name, g_opts.filter) == NULL) {
+        return;
+    }
+    if (g_num_results >= BENCH_MAX_RESULTS) {
+        fprintf(stderr, "Warning: Maximum results (%d) exceeded, skipping %s\n",
+                BENCH_MAX_RESULTS, name);
+        return;
+    }
+
+    /* Calibrate (doubles as warm-up): find a count that takes >= 1ms */
+    uint64_t n = 1;
+    uint64_t elapsed;
+    while ((elapsed = time_iterations(fn, ctx, n)) < BENCH_CALIBRATE_NS && n < (1ULL << 32)) {
+        n *= 2;
+    }
+    if (elapsed == 0) {
+        elapsed = 1;
+    }
+
+    double sample_ns = g_opts.min_time_ms * 1e6 / BENCH_SAMPLES;
+    uint64_t iterations = (uint64_t)((double)n * sample_ns / (double)elapsed);
+    if (iterations == 0) {
+        iterations = 1;
+    }
+
+    double samples[BENCH_SAMPLES];
+    uint64_t allocs = 0, alloc_bytes = 0;
+    for (int s = 0; s < BENCH_SAMPLES; s++) {
+        uint64_t count_before = g_alloc_count, bytes_before = g_alloc_bytes;
+        samples[s] = (double)time_iterations(fn, ctx, iterations) / (double)iterations;
+        allocs += g_alloc_count - count_before;
+        alloc_bytes += g_alloc_bytes - bytes_before;
+    }
+    qsort(samples, BENCH_SAMPLES, sizeof(samples[0]), compare_double);
+
+    bench_result_t* r = &g_results[g_num_results++];
+    snprintf(r->name, sizeof(r->name), "%s", name);
+    r->iterations = iterations;
+    r->bytes_per_op = bytes_per_op;
+    r->ns_per_op = samples[BENCH_SAMPLES / 2];
+    r->min_ns_per_op = samples[0];
+    r->mb_per_s = (bytes_per_op > 0 && r->ns_per_op > 0) ?
+                  (double)bytes_per_op * 1e3 / r->ns_per_op : 0.0;  /* bytes/ns * 1e9 / 1e6 */
+    r->allocs_per_op = (double)allocs / (double)(iterations * BENCH_SAMPLES);
+    r->alloc_bytes_per_op = (double)alloc_bytes / (double)(iterations * BENCH_SAMPLES);
+
+    if (r->mb_per_s > 0) {
+        fprintf(g_table, "%-34s %12.1f %10.1f %10.2f %12.1f\n",
+                r->name, r->ns_per_op, r->mb_per_s, r->allocs_per_op, r->alloc_bytes_per_op);
+    } else {
+        fprintf(g_table, "%-34s %12.1f %10s %10.2f %12.1f\n",
+                r->name, r->ns_per_op, "-", r->allocs_per_op, r->alloc_bytes_per_op);
+    }
+    fflush(g_table);
+}
+
+char* bench_load_file(const char* rel_path, size_t* size) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", g_opts.data_dir, rel_path);
+
+    FILE* f = fopen(path, "rb");
+    if (f == NULL || g_num_files >= BENCH_MAX_FILES) {
+        fprintf(stderr, "Error: Cannot load fixture %s\n", path);
+        exit(2);
+    }
+
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    char* data = malloc((size_t)len + 1);
+    if (data == NULL || len < 0 || fread(data, 1, (size_t)len, f) != (size_t)len) {
+        fprintf(stderr, "Error: Cannot read fixture %s\n", path);
+        exit(2);
+    }
+    fclose(f);
+    data[len] = '\0';
+
+    g_files[g_num_files++] = data;
+    if (size != NULL) {
+        *size = (size_t)len;
+    }
+    return data;
+}
+
+void bench_load_hexdump(const char* rel_path, const char* section, uint8_t* out) {
+    char* text = bench_load_file(rel_path, NULL);
+    char header[96];
+    snprintf(header, sizeof(header), "=== %s RESPONSE", section);
+
+    char* p = strstr(text, header);
+    size_t filled = 0;
+
+    /* Rows look like "0020: 10 00 01 0b ... |ascii|"; other lines are notes */
+    while (p != NULL && filled < 512) {
+        p = strchr(p, '\n');
+        if (p == NULL) {
+            break;
+        }
+        p++;
+        if (strncmp(p, "===", 3) == 0) {
+            break;  /* Next section */
+        }
+
+        unsigned int offset;
+        int consumed;
+        if (sscanf(p, "%4x:%n", &offset, &consumed) != 1 || offset != filled) {
+            continue;
+        }
+
+        char* q = p + consumed;
+        unsigned int byte;
+        int n;
+        for (int col = 0; col < 16 && sscanf(q, " %2x%n", &byte, &n) == 1; col++) {
+            out[filled++] = (uint8_t)byte;  /* 16 columns, then the ASCII column */
+            q += n;
+        }
+    }
+
+    if (filled != 512) {
+        fprintf(stderr, "Error: Section '%s' missing or short in %s\n", section, rel_path);
+        exit(2);
+    }
+}
+
+static void json_escape(FILE* f, const char* s) {
+    fputc('"', f);
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\') {
+            fputc('\\', f);
+        }
+        fputc(*s, f);
+    }
+    fputc('"', f);
+}
+
+static int write_json(const char* path) {
+    FILE* f = (strcmp(path, "-") == 0) ? stdout : fopen(path, "w");
+    if (f == NULL) {
+        fprintf(stderr, "Error: Cannot write %s\n", path);
+        return -1;
+    }
+
+    char timestamp[32];
+    time_t now = time(NULL);
+    strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+
+    fprintf(f, "{\n");
+    fprintf(f, "  \"version\": \"1.0\",\n");
+    fprintf(f, "  \"jm_version\": \"%s\",\n", VERSION);
+    fprintf(f, "  \"timestamp\": \"%s\",\n", timestamp);
+    fprintf(f, "  \"compiler\": ");
+    json_escape(f, __VERSION__);
+    fprintf(f, ",\n");
+    fprintf(f, "  \"samples\": %d,\n", BENCH_SAMPLES);
+    fprintf(f, "  \"min_time_ms\": %.0f,\n", g_opts.min_time_ms);
+    fprintf(f, "  \"results\": [\n");
+    for (int i = 0; i < g_num_results; i++) {
+        const bench_result_t* r = &g_results[i];
+        fprintf(f, "    {\"name\": \"%s\", \"iterations\": %llu, \"bytes_per_op\": %zu, "
+                   "\"ns_per_op\": %.2f, \"min_ns_per_op\": %.2f, \"mb_per_s\": %.2f, "
+                   "\"allocs_per_op\": %.3f, \"alloc_bytes_per_op\": %.1f}%s\n",
+                r->name, (unsigned long long)r->iterations, r->bytes_per_op,
+                r->ns_per_op, r->min_ns_per_op, r->mb_per_s,
+                r->allocs_per_op, r->alloc_bytes_per_op,
+                (i + 1 < g_num_results) ? "," : "");
+    }
+    fprintf(f, "  ]\n");
+    fprintf(f, "}\n");
+
+    if (f != stdout) {
+        fclose(f);
+        fprintf(stderr, "Wrote %s\n", path);
+    }
+    return 0;
+}
+
+static void print_usage(const char* prog) {
+    printf("Usage: %s [OPTIONS]\n\n", prog);
+    printf("Benchmark the protocol, parsing and aggregation hot paths\n\n");
+    printf("Options:\n");
+    printf("  -f, --filter SUBSTR  Only run cases whose name contains SUBSTR\n");
+    printf("  -t, --min-time MS    Time spent per case (default: 500)\n");
+    printf("  -d, --data-dir DIR   Fixture root (default: tests)\n");
+    printf("  -j, --json FILE      Write machine-readable results ('-' = stdout)\n");
+    printf("  -h, --help           Show this help\n");
+}
+
+int main(int argc, char** argv) {
+    static struct option long_options[] = {
+        {"filter", required_argument, 0, 'f'},
+        {"min-time", required_argument, 0, 't'},
+        {"data-dir", required_argument, 0, 'd'},
+        {"json", required_argument, 0, 'j'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "f:t:d:j:h", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'f':
+                g_opts.filter = optarg;
+                break;
+            case 't':
+                g_opts.min_time_ms = atof(optarg);
+                if (g_opts.min_time_ms <= 0) {
+                    fprintf(stderr, "Error: --min-time must be positive\n");
+                    return 1;
+                }
+                break;
+            case 'd':
+                g_opts.data_dir = optarg;
+                break;
+            case 'j':
+                g_opts.json_path = optarg;
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            default:
+                return 1;
+        }
+    }
+
+    /* Keep stdout clean for --json - */
+    g_table = (g_opts.json_path != NULL && strcmp(g_opts.json_path, "-") == 0) ? stderr : stdout;
+    fprintf(g_table, "%-34s %12s %10s %10s %12s\n", "benchmark", "ns/op", "MB/s", "allocs/op", "B alloc/op");
+
+    bench_protocol();
+    bench_parsers();
+    bench_output();
+    bench_sim();
+    bench_table();
+
+    int ret = 0;
+    if (g_opts.json_path != NULL && write_json(g_opts.json_path) != 0) {
+        ret = 1;
+    }
+
+    for (int i = 0; i < g_num_files; i++) {
+        free(g_files[i]);
+    }
+    return ret;
+}
@@ -0,0 +1,61 @@
+/*
+ * bench.h - Micro-benchmark harness for jm-raid-status hot paths
+ *
+ * Copyright (C) 2026 Jamie Treworgy
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Benchmark body: performs exactly one operation on ctx */
+typedef void (*bench_fn_t)(void* ctx);
+
+/**
+ * Time one benchmark and record its result
+ * Skipped (not run) if it does not match the --filter substring.
+ *
+ * @param name Result name, "<group>/<case>"
+ * @param fn Benchmark body
+ * @param ctx Passed to fn on every call
+ * @param bytes_per_op Bytes processed per call (for MB/s; 0 = not reported)
+ */
+void bench_run(const char* name, bench_fn_t fn, void* ctx, size_t bytes_per_op);
+
+/**
+ * Load a fixture file relative to the data directory (--data-dir, default "tests")
+ * Exits with status 2 if the file cannot be read, so results are never
+ * silently missing a case.
+ *
+ * @param rel_path Path below the data directory
+ * @param size Output file size (may be NULL)
+ * @return NUL-terminated buffer (owned by the harness, freed at exit)
+ */
+char* bench_load_file(const char* rel_path, size_t* size);
+
+/**
+ * Load one 512-byte response from a fixture hex dump (tests/fixtures/STATE/_state.txt)
+ * Exits with status 2 if the section is missing or short.
+ *
+ * @param rel_path Path below the data directory
+ * @param section Section title, e.g. "SMART VALUES DISK 0"
+ * @param out Output buffer (512 bytes)
+ */
+void bench_load_hexdump(const char* rel_path, const char* section, uint8_t* out);
+
+/* Keep the compiler from discarding a result the benchmark does not use */
+static inline void bench_keep(const void* p) {
+    __asm__ __volatile__("" : : "g"(p) : "memory");
+}
+
+/* Benchmark groups (one per file) */
+void bench_protocol(void);
+void bench_parsers(void);
+void bench_output(void);
+void bench_sim(void);
+void bench_table(void);
+
+#endif /* BENCH_H */
@@ -0,0 +1,70 @@
+/*
+ * bench_output.c - JSON output benchmarks
+ *
+ * Copyright (C) 2026 Jamie Treworgy
+ * SPDX-License-Identifier: MIT
+ *
+ * The document is the integration test line tests/data/jmicron/healthy-4disk.json,
+ * parsed back into disks and written to /dev/null as jmraidstatus would.
+ */
+
+#define JSMN_HEADER  /* jsmn declarations only (via health_source.h) */
+#include "bench.h"
+#include "../src/aggregator/health_source.h"
+#include "../src/output_formatter.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef struct {
+    source_result_t source;
+    disk_smart_data_t slots[5];
+    FILE* sink;
+} json_output_ctx_t;
+
+/* Large result structs: keep them off the stack */
+static json_output_ctx_t g_output_raid;
+
+static void run_json_line(void* ctx) {
+    json_output_ctx_t* c = ctx;
+    FILE* saved = stdout;
+
+    stdout = c->sink;
+    format_json_line(c->source.device, c->slots, c->source.num_disks, 0, 0, 0,
+                     c->source.controller_model, NULL);
+    stdout = saved;
+}
+
+static void run_json_pretty(void* ctx) {
+    json_output_ctx_t* c = ctx;
+    FILE* saved = stdout;
+
+    stdout = c->sink;
+    format_json(c->source.device, c->slots, c->source.num_disks, 0, 0, 0,
+                c->source.controller_model, NULL);
+    stdout = saved;
+}
+
+void bench_output(void) {
+    size_t size;
+    const char* line = bench_load_file("data/jmicron/healthy-4disk.json", &size);
+
+    if (parse_disk_health_line(line, &g_output_raid.source) != 0) {
+        fprintf(stderr, "Error: Fixture healthy-4disk.json does not parse\n");
+        exit(2);
+    }
+    for (int i = 0; i < g_output_raid.source.num_disks; i++) {
+        int slot = g_output_raid.source.disks[i].disk_number;
+        if (slot >= 0 && slot < 5) {
+            g_output_raid.slots[slot] = g_output_raid.source.disks[i];
+            g_output_raid.slots[slot].is_present = 1;
+        }
+    }
+    g_output_raid.sink = fopen("/dev/null", "w");
+    if (g_output_raid.sink == NULL) {
+        fprintf(stderr, "Error: Cannot open /dev/null\n");
+        exit(2);
+    }
+
+    bench_run("output/json_line_raid", run_json_line, &g_output_raid, size);
+    bench_run("output/json_pretty_raid", run_json_pretty, &g_output_raid, 0);
+}
@@ -0,0 +1,101 @@
+/*
+ * bench_parsers.c - smartctl-parser and disk-health parsing benchmarks
+ *
+ * Copyright (C) 2026 Jamie Treworgy
+ * SPDX-License-Identifier: MIT
+ *
+ * Inputs are the integration test documents in tests/data.
+ */
+
+#define JSMN_HEADER  /* jsmn declarations only (via smartctl_json.h) */
+#include "bench.h"
+#include "../src/parsers/smartctl_json.h"
+#include "../src/aggregator/health_source.h"
+#include "../src/health_record.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef struct {
+    const char* json;
+    size_t len;
+    json_tokens_t tokens;       /* Reused, as in a smartctl-parser batch */
+    smartctl_data_t data;
+} smartctl_ctx_t;
+
+typedef struct {
+    const char* line;
+    source_result_t result;
+} health_line_ctx_t;
+
+typedef struct {
+    health_record_t record;
+    source_result_t result;
+} health_record_ctx_t;
+
+/* Large result structs: keep them off the stack */
+static smartctl_ctx_t g_smartctl;
+static health_line_ctx_t g_health_raid;
+static health_line_ctx_t g_health_single;
+static health_record_ctx_t g_record_raid;
+
+static void run_smartctl_json(void* ctx) {
+    smartctl_ctx_t* c = ctx;
+    parse_smartctl_json(c->json, &c->data);
+    bench_keep(&c->data);
+}
+
+static void run_smartctl_json_batch(void* ctx) {
+    smartctl_ctx_t* c = ctx;
+    parse_smartctl_json_tokens(c->json, c->len, &c->tokens, &c->data);
+    bench_keep(&c->data);
+}
+
+static void run_health_line(void* ctx) {
+    health_line_ctx_t* c = ctx;
+    parse_disk_health_line(c->line, &c->result);
+    bench_keep(&c->result);
+}
+
+static void run_health_record(void* ctx) {
+    health_record_ctx_t* c = ctx;
+    parse_disk_health_record((const char*)c->record.data, c->record.len, &c->result);
+    bench_keep(&c->result);
+}
+
+/* Helper: Encode a parsed source as the --format=bin record of the same content */
+static void encode_record(const source_result_t* src, health_record_t* rec) {
+    health_record_begin(rec, src->backend, src->device, src->controller_model,
+                        src->controller_type, src->has_timings ? &src->timings : NULL);
+    for (int i = 0; i < src->num_disks; i++) {
+        health_record_add_disk(rec, &src->disks[i], src->disks[i].disk_number);
+    }
+    health_record_finish(rec);
+}
+
+/* Parse once up front so a broken fixture fails loudly instead of timing errors */
+static void check(int ret, const char* what) {
+    if (ret != 0) {
+        fprintf(stderr, "Error: Fixture %s does not parse\n", what);
+        exit(2);
+    }
+}
+
+void bench_parsers(void) {
+    size_t smartctl_size, raid_size, single_size;
+
+    g_smartctl.json = bench_load_file("data/smartctl/source-failed-ssd.json", &smartctl_size);
+    g_smartctl.len = smartctl_size;
+    g_health_raid.line = bench_load_file("data/jmicron/healthy-4disk.json", &raid_size);
+    g_health_single.line = bench_load_file("data/smartctl/healthy-ssd.json", &single_size);
+
+    check(parse_smartctl_json(g_smartctl.json, &g_smartctl.data), "source-failed-ssd.json");
+    check(parse_disk_health_line(g_health_raid.line, &g_health_raid.result), "healthy-4disk.json");
+    check(parse_disk_health_line(g_health_single.line, &g_health_single.result), "healthy-ssd.json");
+    encode_record(&g_health_raid.result, &g_record_raid.record);
+
+    bench_run("parse/smartctl_json", run_smartctl_json, &g_smartctl, smartctl_size);
+    bench_run("parse/smartctl_json_batch", run_smartctl_json_batch, &g_smartctl, smartctl_size);
+    bench_run("parse/disk_health_line_raid", run_health_line, &g_health_raid, raid_size);
+    bench_run("parse/disk_health_line_single", run_health_line, &g_health_single, single_size);
+    bench_run("parse/disk_health_record_raid", run_health_record, &g_record_raid, g_record_raid.record.len);
+}
@@ -0,0 +1,156 @@
+/*
+ * bench_protocol.c - Mailbox protocol and SMART page benchmarks
+ *
+ * Copyright (C) 2026 Jamie Treworgy
+ * SPDX-License-Identifier: MIT
+ *
+ * Sector data comes from the captured responses in tests/fixtures. The
+ * sector/ image cases read an empty 1 MiB image file in /tmp.
+ */
+
+#include "bench.h"
+#include "../src/jm_crc.h"
+#include "../src/jm_protocol.h"
+#include "../src/sata_xor.h"
+#include "../src/smart_parser.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define STATE_FIXTURE "fixtures/healthy/healthy_state.txt"
+
+typedef struct {
+    uint32_t sector[128];               /* Working copy, scrambled in place */
+    uint8_t response[512];              /* SMART VALUES response (header + page) */
+    smart_values_page_t values;
+    smart_thresholds_page_t thresholds;
+    smart_thresholds_page_t scratch_thresholds;
+    disk_smart_data_t disk;
+    uint32_t crc;
+} protocol_ctx_t;
+
+static protocol_ctx_t g_ctx;
+static char g_image[] = "/tmp/jm_bench_sectors_XXXXXX";
+
+static void run_jm_crc(void* ctx) {
+    protocol_ctx_t* c = ctx;
+    c->crc = JM_CRC(c->sector, 0x7f);
+    bench_keep(&c->crc);
+}
+
+static void run_sata_xor(void* ctx) {
+    protocol_ctx_t* c = ctx;
+    SATA_XOR(c->sector);
+    bench_keep(c->sector);
+}
+
+static void run_crc_then_xor(void* ctx) {
+    protocol_ctx_t* c = ctx;
+    c->crc = JM_CRC_THEN_XOR(c->sector);
+    bench_keep(c->sector);
+}
+
+static void run_xor_then_crc(void* ctx) {
+    protocol_ctx_t* c = ctx;
+    c->crc = JM_XOR_THEN_CRC(c->sector);
+    bench_keep(c->sector);
+}
+
+static void run_parse_values(void* ctx) {
+    protocol_ctx_t* c = ctx;
+    smart_parse_values(c->response + 0x20, &c->values);
+    bench_keep(&c->values);
+}
+
+static void run_combine_data(void* ctx) {
+    protocol_ctx_t* c = ctx;
+    smart_combine_data(0, "WDC WD40EFRX-68N32N0", &c->values, &c->thresholds, &c->disk);
+    bench_keep(&c->disk);
+}
+
+/* Everything the host does for one disk's 0xD0 + 0xD1 round trips, I/O
+ * excluded: build and scramble both commands, unscramble both responses,
+ * parse the pages and assess. This is all a pipelined scheduler could hide
+ * behind the SG_IO calls of the next command. */
+static void run_disk_host_work(void* ctx) {
+    protocol_ctx_t* c = ctx;
+    uint32_t cmd[128];
+
+    for (int i = 0; i < 2; i++) {
+        memset(cmd, 0, sizeof(cmd));
+        cmd[0] = 0x197b0322;
+        cmd[1] = (uint32_t)i;
+        memcpy((uint8_t*)cmd + 8, c->response + 8, 24);
+        c->crc ^= JM_CRC_THEN_XOR(cmd);
+        c->crc ^= JM_XOR_THEN_CRC(c->sector);
+    }
+    smart_parse_values(c->response + 0x20, &c->values);
+    smart_parse_thresholds(c->response + 0x20, &c->scratch_thresholds);
+    smart_combine_data(0, "WDC WD40EFRX-68N32N0", &c->values, &c->thresholds, &c->disk);
+    bench_keep(&c->disk);
+}
+
+static void run_sector_is_empty(void* ctx) {
+    (void)ctx;
+    static const uint8_t zero[JM_SECTORSIZE];
+    int empty = jm_sector_is_empty(zero, sizeof(zero));
+    bench_keep(&empty);
+}
+
+static void run_find_empty(void* ctx) {
+    (void)ctx;
+    jm_sector_map_t map;
+    int n = jm_find_empty_sectors(g_image, &map);
+    bench_keep(&n);
+}
+
+/* What tools/check_sectors did: one open and read per candidate sector */
+static void run_read_each(void* ctx) {
+    (void)ctx;
+    uint8_t sector[JM_SECTORSIZE];
+    int n = 0;
+
+    for (uint32_t s = 33; s < JM_SAFE_SECTOR_END; s++) {
+        if (jm_sector_in_safe_range(s) && jm_read_sector_block(g_image, s, sector) == 0 &&
+            jm_sector_is_empty(sector, sizeof(sector))) {
+            n++;
+        }
+    }
+    bench_keep(&n);
+}
+
+void bench_protocol(void) {
+    protocol_ctx_t* c = &g_ctx;
+
+    bench_load_hexdump(STATE_FIXTURE, "IDENTIFY DISK 0", (uint8_t*)c->sector);
+    bench_load_hexdump(STATE_FIXTURE, "SMART VALUES DISK 0", c->response);
+    smart_parse_values(c->response + 0x20, &c->values);
+
+    /* The captures have no 0xD1 page: give every present attribute a threshold */
+    memset(&c->thresholds, 0, sizeof(c->thresholds));
+    c->thresholds.revision = c->values.revision;
+    for (int i = 0; i < 30; i++) {
+        c->thresholds.thresholds[i].id = c->values.attributes[i].id;
+        c->thresholds.thresholds[i].threshold = c->values.attributes[i].id ? 6 : 0;
+    }
+
+    bench_run("protocol/jm_crc", run_jm_crc, c, 0x7f * sizeof(uint32_t));
+    bench_run("protocol/sata_xor", run_sata_xor, c, sizeof(c->sector));
+    bench_run("protocol/crc_then_xor", run_crc_then_xor, c, sizeof(c->sector));
+    bench_run("protocol/xor_then_crc", run_xor_then_crc, c, sizeof(c->sector));
+    bench_run("smart/parse_values", run_parse_values, c, sizeof(smart_values_page_t));
+    bench_run("smart/combine_data", run_combine_data, c, 0);
+    bench_run("smart/disk_host_work", run_disk_host_work, c, 0);
+    bench_run("sector/is_empty", run_sector_is_empty, NULL, JM_SECTORSIZE);
+
+    int fd = mkstemp(g_image);
+    if (fd < 0 || ftruncate(fd, (off_t)JM_SAFE_SECTOR_END * JM_SECTORSIZE) != 0) {
+        fprintf(stderr, "Error: Cannot create an image in /tmp\n");
+        exit(2);
+    }
+    close(fd);
+    bench_run("sector/find_empty_image", run_find_empty, NULL, (size_t)JM_SAFE_SECTOR_END * JM_SECTORSIZE);
+    bench_run("sector/read_each_image", run_read_each, NULL, (size_t)JM_SAFE_SECTOR_END * JM_SECTORSIZE);
+    unlink(g_image);
+}
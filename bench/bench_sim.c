@@ -0,0 +1,103 @@
+/*
+ * bench_sim.c - Simulated controller fleet benchmarks
+ *
+ * Copyright (C) 2026 Jamie Treworgy
+ * SPDX-License-Identifier: MIT
+ *
+ * Every enclosure is a jm_sim controller serving tests/data/jmicron/healthy-4disk.json
+ * with no injected latency, so the cases time the command path itself
+ * (scramble, CRC, IDENTIFY and SMART parsing) across a 64-enclosure fleet.
+ * Faults are not benchmarked: retries back off in milliseconds.
+ */
+
+#define JSMN_HEADER  /* jsmn declarations only (via health_source.h) */
+#include "bench.h"
+#include "../src/aggregator/health_source.h"
+#include "../src/jm_commands.h"
+#include "../src/jm_sim.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define FLEET_SIZE 64
+
+typedef struct {
+    jm_session_t session;
+    disk_smart_data_t disks[5];
+} sim_enclosure_t;
+
+/* Large result structs: keep them off the stack */
+static jm_sim_array_t g_array;
+static sim_enclosure_t g_fleet[FLEET_SIZE];
+
+static void poll_enclosure(sim_enclosure_t* e) {
+    int num_disks = 0, is_degraded = 0, present = 0;
+
+    jm_get_all_disks_smart_data(&e->session, e->disks, &num_disks, &is_degraded, &present);
+    bench_keep(e->disks);
+}
+
+static void run_poll_enclosure(void* ctx) {
+    poll_enclosure(ctx);
+}
+
+static void run_fleet_poll(void* ctx) {
+    (void)ctx;
+    for (int i = 0; i < FLEET_SIZE; i++) {
+        poll_enclosure(&g_fleet[i]);
+    }
+}
+
+static void* fleet_worker(void* arg) {
+    poll_enclosure(arg);
+    return NULL;
+}
+
+/* One thread per enclosure, as jmraidstatus runs several devices */
+static void run_fleet_threads(void* ctx) {
+    pthread_t threads[FLEET_SIZE];
+    (void)ctx;
+
+    for (int i = 0; i < FLEET_SIZE; i++) {
+        pthread_create(&threads[i], NULL, fleet_worker, &g_fleet[i]);
+    }
+    for (int i = 0; i < FLEET_SIZE; i++) {
+        pthread_join(threads[i], NULL);
+    }
+}
+
+void bench_sim(void) {
+    const char* line = bench_load_file("data/jmicron/healthy-4disk.json", NULL);
+    source_result_t* source = malloc(sizeof(source_result_t));
+
+    if (source == NULL || parse_disk_health_line(line, source) != 0) {
+        fprintf(stderr, "Error: Fixture healthy-4disk.json does not parse\n");
+        exit(2);
+    }
+    for (int i = 0; i < source->num_disks; i++) {
+        int slot = source->disks[i].disk_number;
+        if (slot >= 0 && slot < 5) {
+            g_array.disks[slot] = source->disks[i];
+            g_array.disks[slot].is_present = 1;
+            g_array.presence |= (uint8_t)(1u << slot);
+        }
+    }
+    free(source);
+
+    for (int i = 0; i < FLEET_SIZE; i++) {
+        jm_session_init(&g_fleet[i].session, 33);
+        g_fleet[i].session.transport = jm_sim_open(&g_array, NULL);
+        if (g_fleet[i].session.transport == NULL || jm_send_wakeup(&g_fleet[i].session) != JM_SUCCESS) {
+            fprintf(stderr, "Error: Simulated enclosure %d did not wake up\n", i);
+            exit(2);
+        }
+    }
+
+    bench_run("sim/poll_enclosure", run_poll_enclosure, &g_fleet[0], 0);
+    bench_run("sim/fleet64_poll", run_fleet_poll, NULL, 0);
+    bench_run("sim/fleet64_threads", run_fleet_threads, NULL, 0);
+
+    for (int i = 0; i < FLEET_SIZE; i++) {
+        jm_cleanup_device(&g_fleet[i].session);
+    }
+}
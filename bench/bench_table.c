@@ -0,0 +1,118 @@
+/*
+ * bench_table.c - Columnar disk table benchmarks
+ *
+ * Copyright (C) 2026 Jamie Treworgy
+ * SPDX-License-Identifier: MIT
+ *
+ * The fleet is tests/data/jmicron/failed-disk.json repeated 1024 times
+ * (4096 disks), as disk-health stores it for a batch report.
+ */
+
+#define JSMN_HEADER  /* jsmn declarations only (via health_source.h) */
+#include "bench.h"
+#include "../src/aggregator/disk_table.h"
+#include "../src/aggregator/fleet_query.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define FLEET_SOURCES 1024
+
+typedef struct {
+    source_result_t source;
+    disk_table_t fleet;                 /* Scanned by the scan cases */
+    disk_table_t scratch;               /* Refilled by add_source */
+    fleet_query_t where;                /* --where 'attr[0x05].raw>0 && model~ST' */
+    fleet_query_t group;                /* --group-by firmware */
+    fleet_query_t top;                  /* --top 10 --by attr[0x09].raw */
+} table_ctx_t;
+
+/* Large result structs: keep them off the stack */
+static table_ctx_t g_table;
+
+static void run_add_source(void* ctx) {
+    table_ctx_t* c = ctx;
+
+    /* Start over before the columns grow past the fleet's size */
+    if (c->scratch.num_sources == FLEET_SOURCES) {
+        disk_table_free(&c->scratch);
+        disk_table_init(&c->scratch);
+    }
+    disk_table_add_source(&c->scratch, &c->source);
+}
+
+static void run_scan_raw(void* ctx) {
+    table_ctx_t* c = ctx;
+    uint32_t disks[16];
+
+    uint32_t n = disk_table_scan_raw(&c->fleet, 0x05, 0, disks, 16);
+    bench_keep(&n);
+}
+
+static void run_query(fleet_query_t* query) {
+    fleet_query_result_t result;
+
+    fleet_query_run(query, &g_table.fleet, &result);
+    bench_keep(&result.matched);
+    fleet_query_result_free(&result);
+}
+
+static void run_query_where(void* ctx) { run_query(&((table_ctx_t*)ctx)->where); }
+static void run_query_group(void* ctx) { run_query(&((table_ctx_t*)ctx)->group); }
+static void run_query_top(void* ctx) { run_query(&((table_ctx_t*)ctx)->top); }
+
+/* The same question asked of an array of full records, for comparison */
+static disk_smart_data_t* g_records;
+
+static void run_scan_records(void* ctx) {
+    (void)ctx;
+    uint32_t n = 0;
+
+    for (int d = 0; d < FLEET_SOURCES * 4; d++) {
+        for (int a = 0; a < g_records[d].num_attributes; a++) {
+            if (g_records[d].attributes[a].id == 0x05 && g_records[d].attributes[a].raw_value > 0) {
+                n++;
+            }
+        }
+    }
+    bench_keep(&n);
+}
+
+void bench_table(void) {
+    const char* line = bench_load_file("data/jmicron/failed-disk.json", NULL);
+
+    if (parse_disk_health_line(line, &g_table.source) != 0 || g_table.source.num_disks != 4) {
+        fprintf(stderr, "Error: Fixture failed-disk.json does not parse\n");
+        exit(2);
+    }
+    g_records = malloc(sizeof(disk_smart_data_t) * FLEET_SOURCES * 4);
+    if (g_records == NULL || disk_table_init(&g_table.fleet) != 0 || disk_table_init(&g_table.scratch) != 0) {
+        fprintf(stderr, "Error: Out of memory\n");
+        exit(2);
+    }
+    for (int i = 0; i < FLEET_SOURCES; i++) {
+        disk_table_add_source(&g_table.fleet, &g_table.source);
+        for (int d = 0; d < 4; d++) {
+            g_records[i * 4 + d] = g_table.source.disks[d];
+        }
+    }
+
+    char error[160];
+    fleet_query_init(&g_table.where);
+    fleet_query_init(&g_table.group);
+    fleet_query_init(&g_table.top);
+    fleet_query_add_where(&g_table.where, "attr[0x05].raw>0 && model~ST", error, sizeof(error));
+    fleet_query_set_group(&g_table.group, "firmware");
+    g_table.top.top = 10;
+    fleet_query_set_by(&g_table.top, "attr[0x09].raw");
+
+    bench_run("table/add_source", run_add_source, &g_table, 0);
+    bench_run("table/scan_raw_4k_disks", run_scan_raw, &g_table, 0);
+    bench_run("table/scan_records_4k_disks", run_scan_records, NULL, 0);
+    bench_run("table/query_where_4k_disks", run_query_where, &g_table, 0);
+    bench_run("table/query_group_4k_disks", run_query_group, &g_table, 0);
+    bench_run("table/query_top10_4k_disks", run_query_top, &g_table, 0);
+
+    disk_table_free(&g_table.fleet);
+    disk_table_free(&g_table.scratch);
+    free(g_records);
+}
@@ -0,0 +1,243 @@
+#!/usr/bin/env python3
+"""End-to-end pipeline benchmark (make bench-pipeline).
+
+Generates a synthetic fleet with scripts/gen_fleet.py and pipes it through
+the built tools the way a central aggregator does:
+
+    pipeline/smartctl_parser       smartctl-parser < smartctl documents
+    pipeline/disk_health_serial    disk-health --json
+    pipeline/disk_health_threaded  disk-health --json --threads 0
+    pipeline/disk_health_stream    disk-health --stream
+
+Throughput is total input lines over the median wall time of --runs runs,
+with input from a pipe (cat). Peak RSS is the tool's VmHWM, sampled every
+2 ms during one more run. Per-line latency is measured closed-loop on the
+modes that answer per line: one valid line is written, and the clock stops
+when its output arrives; the pass of --runs with the lowest p99 is kept,
+as one scheduler hiccup moves a p99. The batch modes only answer at end of input, so they have
+no per-line latency.
+
+--compare OLD.json fails (exit 1) if a mode lost more than --tolerance of
+its throughput, or grew its p99 latency or peak RSS by more than that.
+"""
+
+import argparse
+import json
+import os
+import platform
+import statistics
+import subprocess
+import sys
+import tempfile
+import time
+from pathlib import Path
+
+ROOT = Path(__file__).resolve().parent.parent
+GENERATOR = ROOT / "scripts" / "gen_fleet.py"
+
+# Latencies below this are scheduler noise, not parser regressions
+LATENCY_FLOOR_US = 200.0
+RSS_SAMPLE_S = 0.002
+
+
+def source_line(line):
+    """disk-health --stream prints one source per line, marked ✓ or ✗."""
+    return line.startswith("  ✓".encode()) or line.startswith("  ✗".encode())
+
+
+def any_line(line):
+    return True
+
+
+# name, argv after the binary directory, input, latency marker (None = batch only)
+MODES = [
+    ("pipeline/smartctl_parser", ["smartctl-parser"], "smartctl", any_line),
+    ("pipeline/disk_health_serial", ["disk-health", "--json"], "health", None),
+    ("pipeline/disk_health_threaded", ["disk-health", "--json", "--threads", "0"], "health", None),
+    ("pipeline/disk_health_stream", ["disk-health", "--stream"], "health", source_line),
+]
+
+
+def generate(args, fmt, path):
+    """Write the fleet in one format; returns its line count."""
+    subprocess.run([sys.executable, str(GENERATOR), "--hosts", str(args.hosts), "--disks", str(args.disks),
+                    "--format", fmt, "--seed", str(args.seed), "-o", str(path)], check=True)
+    with open(path, "rb") as f:
+        return sum(1 for _ in f)
+
+
+def peak_rss_kb(pid):
+    """VmHWM of a running process, or None once it has exited."""
+    try:
+        with open("/proc/%d/status" % pid) as f:
+            for line in f:
+                if line.startswith("VmHWM:"):
+                    return int(line.split()[1])
+    except OSError:
+        pass
+    return None
+
+
+def run_once(argv, path, sample_rss=False):
+    """Pipe a file through a tool; returns (seconds, peak RSS in KB or None).
+
+    ru_maxrss can't be used: it keeps the high-water mark of the forked
+    Python process from before the exec. VmHWM is sampled instead, which
+    costs CPU, so only runs that don't count for throughput sample it."""
+    start = time.perf_counter()
+    cat = subprocess.Popen(["cat", str(path)], stdout=subprocess.PIPE)
+    tool = subprocess.Popen(argv, stdin=cat.stdout, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    cat.stdout.close()
+    peak = None
+    while sample_rss and tool.poll() is None:
+        peak = max(peak or 0, peak_rss_kb(tool.pid) or 0)
+        time.sleep(RSS_SAMPLE_S)
+    tool.wait()
+    elapsed = time.perf_counter() - start
+    cat.wait()
+    if tool.returncode < 0 or tool.returncode == 3:
+        raise RuntimeError("%s failed (exit %d)" % (" ".join(argv), tool.returncode))
+    return elapsed, peak
+
+
+def valid_lines(path, limit):
+    """The first limit lines that are complete documents with disks."""
+    lines = []
+    with open(path, "rb") as f:
+        for raw in f:
+            try:
+                doc = json.loads(raw)
+            except ValueError:
+                continue
+            if isinstance(doc, dict) and ("disks" in doc or "device" in doc and "smartctl" in doc):
+                lines.append(raw)
+                if len(lines) == limit:
+                    break
+    return lines
+
+
+def measure_latency(argv, lines, is_answer):
+    """Closed loop: write one line, wait for its answer; returns (p50, p99) in us."""
+    tool = subprocess.Popen(argv, stdin=subprocess.PIPE, stdout=subprocess.PIPE,
+                            stderr=subprocess.DEVNULL, bufsize=0)
+    out = tool.stdout.fileno()
+    pending = b""
+    samples = []
+
+    for line in lines:
+        start = time.perf_counter()
+        os.write(tool.stdin.fileno(), line)
+        answered = False
+        while not answered:
+            chunk = os.read(out, 65536)
+            if not chunk:
+                raise RuntimeError("%s exited during the latency run" % argv[0])
+            pending += chunk
+            *complete, pending = pending.split(b"\n")
+            answered = any(is_answer(l) for l in complete)
+        samples.append((time.perf_counter() - start) * 1e6)
+
+    tool.stdin.close()
+    tool.stdout.read()
+    tool.wait()
+    samples.sort()
+    return samples[len(samples) // 2], samples[min(len(samples) - 1, int(len(samples) * 0.99))]
+
+
+def compare(results, old_path, tolerance):
+    """Regressions against an earlier run's JSON; returns their descriptions."""
+    with open(old_path) as f:
+        old = {r["name"]: r for r in json.load(f)["results"]}
+
+    regressions = []
+    for r in results:
+        o = old.get(r["name"])
+        if o is None:
+            continue
+        if r["lines_per_s"] < o["lines_per_s"] * (1 - tolerance):
+            regressions.append("%s: %.0f lines/s, was %.0f" % (r["name"], r["lines_per_s"], o["lines_per_s"]))
+        if r["peak_rss_kb"] and o.get("peak_rss_kb") and r["peak_rss_kb"] > o["peak_rss_kb"] * (1 + tolerance):
+            regressions.append("%s: peak RSS %d KB, was %d KB" % (r["name"], r["peak_rss_kb"], o["peak_rss_kb"]))
+        if r["p99_us"] is not None and o.get("p99_us") is not None and \
+                r["p99_us"] > max(o["p99_us"], LATENCY_FLOOR_US) * (1 + tolerance):
+            regressions.append("%s: p99 %.0f us, was %.0f us" % (r["name"], r["p99_us"], o["p99_us"]))
+    return regressions
+
+
+def write_json(path, args, results):
+    """Same layout as bin/bench/results.json: one result per line."""
+    with open(path, "w") as f:
+        f.write('{\n  "version": "1.0",\n')
+        f.write('  "timestamp": "%s",\n' % time.strftime("%Y-%m-%dT%H:%M:%SZ", time.gmtime()))
+        f.write('  "machine": "%s",\n' % platform.machine())
+        f.write('  "hosts": %d,\n  "disks_per_host": %d,\n  "runs": %d,\n' % (args.hosts, args.disks, args.runs))
+        f.write('  "results": [\n')
+        f.write(",\n".join("    " + json.dumps(r) for r in results))
+        f.write("\n  ]\n}\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("--bin-dir", default=str(ROOT / "bin"), help="built binaries (default: bin)")
+    parser.add_argument("--hosts", type=int, default=2000, help="hosts in the fleet (default: 2000)")
+    parser.add_argument("--disks", type=int, default=12, help="disks per host (default: 12)")
+    parser.add_argument("--seed", type=int, default=1, help="generator seed (default: 1)")
+    parser.add_argument("--runs", type=int, default=3, help="throughput runs per mode (default: 3)")
+    parser.add_argument("--latency-lines", type=int, default=2000,
+                        help="lines timed closed-loop per streaming mode (default: 2000)")
+    parser.add_argument("--json", help="write results to this file")
+    parser.add_argument("--compare", help="fail on regressions against this earlier --json file")
+    parser.add_argument("--tolerance", type=float, default=0.25,
+                        help="allowed regression for --compare (default: 0.25)")
+    parser.add_argument("--filter", default="", help="only modes whose name contains this")
+    args = parser.parse_args()
+
+    results = []
+    with tempfile.TemporaryDirectory(prefix="jm-pipeline-") as tmp:
+        inputs = {}
+        for fmt in ("health", "smartctl"):
+            path = Path(tmp) / ("%s.ndjson" % fmt)
+            inputs[fmt] = (path, generate(args, fmt, path))
+
+        print("%-32s %10s %12s %10s %10s" % ("benchmark", "lines/s", "peak RSS KB", "p50 us", "p99 us"))
+        for name, argv, fmt, is_answer in MODES:
+            if args.filter not in name:
+                continue
+            argv = [os.path.join(args.bin_dir, argv[0])] + argv[1:]
+            path, num_lines = inputs[fmt]
+
+            seconds = statistics.median(run_once(argv, path)[0] for _ in range(args.runs))
+            _, peak = run_once(argv, path, sample_rss=True)
+            result = {
+                "name": name,
+                "lines": num_lines,
+                "seconds": round(seconds, 4),
+                "lines_per_s": round(num_lines / seconds, 1),
+                "peak_rss_kb": peak,
+                "p50_us": None,
+                "p99_us": None,
+            }
+            if is_answer is not None:
+                lines = valid_lines(path, args.latency_lines)
+                p50, p99 = min((measure_latency(argv, lines, is_answer) for _ in range(args.runs)),
+                               key=lambda r: r[1])
+                result["p50_us"], result["p99_us"] = round(p50, 1), round(p99, 1)
+            results.append(result)
+
+            print("%-32s %10.0f %12s %10s %10s" % (name, result["lines_per_s"], peak or "-",
+                  "-" if result["p50_us"] is None else "%.0f" % result["p50_us"],
+                  "-" if result["p99_us"] is None else "%.0f" % result["p99_us"]))
+
+    if args.json:
+        write_json(args.json, args, results)
+    if args.compare:
+        regressions = compare(results, args.compare, args.tolerance)
+        for r in regressions:
+            print("Regression: " + r, file=sys.stderr)
+        if regressions:
+            return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
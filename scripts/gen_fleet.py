@@ -0,0 +1,168 @@
+#!/usr/bin/env python3
+"""Synthesize fleet-wide disk-health NDJSON from the documents in tests/data.
+
+Each of N hosts reports M disks: full enclosures as jmicron lines (from
+healthy-4disk.json, or failed-disk.json for a few), the remainder as
+single-disk smartctl lines. Serials, devices, temperatures and power-on
+hours vary per disk. A share of the lines is malformed (truncated, not
+JSON, or missing fields) or oversized (a valid line padded past the
+parsers' chunk size), as a central aggregator sees them.
+
+With --format=smartctl the same fleet is written as raw `smartctl --json`
+documents, one per disk and line, for `smartctl-parser`.
+
+    python3 scripts/gen_fleet.py --hosts 1000 --disks 12 -o /tmp/fleet.ndjson
+"""
+
+import argparse
+import copy
+import json
+import random
+import sys
+from pathlib import Path
+
+DATA_DIR = Path(__file__).resolve().parent.parent / "tests" / "data"
+ENCLOSURE_DISKS = 4
+
+
+def load_templates():
+    """Load the template documents from tests/data."""
+    def load(name):
+        with open(DATA_DIR / name) as f:
+            return json.load(f)
+
+    return {
+        "healthy": load("jmicron/healthy-4disk.json"),
+        "failed": load("jmicron/failed-disk.json"),
+        "single": load("smartctl/healthy-ssd.json"),
+        "smartctl": load("smartctl/source-failed-ssd.json"),
+    }
+
+
+def vary_disk(disk, rng, serial):
+    """Give a template disk its own serial and plausible readings."""
+    disk["serial"] = serial
+    for attr in disk.get("attributes", []):
+        if attr["id"] == 9:
+            attr["raw"] = rng.randint(100, 60000)
+        elif attr["id"] in (190, 194):
+            attr["raw"] = rng.randint(24, 48)
+    if "power_on_hours" in disk:
+        disk["power_on_hours"] = rng.randint(100, 60000)
+    return disk
+
+
+def enclosure_line(templates, rng, host, index, num_disks, failed_rate):
+    """One jmicron line for an enclosure with num_disks disks (1-4)."""
+    template = templates["failed"] if rng.random() < failed_rate else templates["healthy"]
+    line = copy.deepcopy(template)
+    line["device"] = "%s:/dev/sd%s" % (host, chr(ord("c") + index % 24))
+    disks = line["disks"][:num_disks]
+    for slot, disk in enumerate(disks):
+        vary_disk(disk, rng, "%s-%s-%d-%d" % (disk["serial"], host, index, slot))
+    line["disks"] = disks
+    if line.get("raid_status"):
+        line["raid_status"]["present_disks"] = num_disks
+    return line
+
+
+def single_line(templates, rng, host, index):
+    """One smartctl line for a standalone disk."""
+    line = copy.deepcopy(templates["single"])
+    line["device"] = "%s:/dev/nvme%dn1" % (host, index)
+    for disk in line["disks"]:
+        vary_disk(disk, rng, "%s-%s-%d" % (disk["serial"], host, index))
+    return line
+
+
+def smartctl_document(templates, rng, host, index):
+    """One raw smartctl --json document for a disk."""
+    doc = copy.deepcopy(templates["smartctl"])
+    doc["device"]["name"] = doc["device"]["info_name"] = "%s:/dev/sd%d" % (host, index)
+    doc["serial_number"] = "%s-%s-%d" % (doc["serial_number"], host, index)
+    doc["temperature"]["current"] = rng.randint(24, 48)
+    doc["power_on_time"]["hours"] = rng.randint(100, 60000)
+    return doc
+
+
+def host_documents(templates, rng, host, disks, fmt, failed_rate):
+    """Every document one host reports."""
+    if fmt == "smartctl":
+        return [smartctl_document(templates, rng, host, i) for i in range(disks)]
+
+    docs = []
+    for index in range(disks // ENCLOSURE_DISKS):
+        docs.append(enclosure_line(templates, rng, host, index, ENCLOSURE_DISKS, failed_rate))
+    for index in range(disks % ENCLOSURE_DISKS):
+        docs.append(single_line(templates, rng, host, index))
+    return docs
+
+
+def malformed(text, rng, fmt):
+    """Damage a line the ways broken senders do.
+
+    smartctl documents are not cut off: smartctl-parser reads concatenated
+    documents, so an unclosed one would swallow the documents after it."""
+    kind = rng.randrange(1 if fmt == "smartctl" else 0, 3)
+    if kind == 0:
+        return text[:rng.randint(1, len(text) - 1)]           # Cut off mid-line
+    if kind == 1:
+        return "ssh: connect to host: Connection timed out"   # Not JSON at all
+    return '{"version":"1.0","backend":"jmicron"}'            # No device or disks
+
+
+def oversized(doc, size):
+    """Pad a valid document past size bytes with a member parsers skip."""
+    padded = dict(doc)
+    padded["padding"] = "x" * size
+    return padded
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("--hosts", type=int, default=100, help="hosts in the fleet (default: 100)")
+    parser.add_argument("--disks", type=int, default=12, help="disks per host (default: 12)")
+    parser.add_argument("--format", choices=("health", "smartctl"), default="health",
+                        help="disk-health lines (default) or raw smartctl documents")
+    parser.add_argument("--failed", type=float, default=0.02,
+                        help="share of enclosures with a failed disk (default: 0.02)")
+    parser.add_argument("--malformed", type=float, default=0.01,
+                        help="share of malformed lines (default: 0.01)")
+    parser.add_argument("--oversized", type=float, default=0.002,
+                        help="share of oversized lines (default: 0.002)")
+    parser.add_argument("--oversized-bytes", type=int, default=256 * 1024,
+                        help="padding of an oversized line (default: 262144)")
+    parser.add_argument("--seed", type=int, default=1, help="random seed (default: 1)")
+    parser.add_argument("-o", "--output", help="output file (default: stdout)")
+    args = parser.parse_args()
+
+    rng = random.Random(args.seed)
+    templates = load_templates()
+    out = open(args.output, "w") if args.output else sys.stdout
+    counts = {"lines": 0, "malformed": 0, "oversized": 0, "bytes": 0}
+
+    for h in range(args.hosts):
+        host = "host%05d" % h
+        for doc in host_documents(templates, rng, host, args.disks, args.format, args.failed):
+            roll = rng.random()
+            if roll < args.oversized:
+                text = json.dumps(oversized(doc, args.oversized_bytes), separators=(",", ":"))
+                counts["oversized"] += 1
+            else:
+                text = json.dumps(doc, separators=(",", ":"))
+                if roll < args.oversized + args.malformed:
+                    text = malformed(text, rng, args.format)
+                    counts["malformed"] += 1
+            out.write(text + "\n")
+            counts["lines"] += 1
+            counts["bytes"] += len(text) + 1
+
+    if out is not sys.stdout:
+        out.close()
+    print("%d lines (%d malformed, %d oversized), %.1f MB, %d disks" %
+          (counts["lines"], counts["malformed"], counts["oversized"], counts["bytes"] / 1e6,
+           args.hosts * args.disks), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -5,47 +5,35 @@
  * SPDX-License-Identifier: MIT
  *
  * Usage: { source1; source2; } | disk-health [OPTIONS]
- * Reads NDJSON from stdin (one JSON object per line)
- * Aggregates and outputs unified report
+ *        disk-health --source "cmd1" --source "cmd2" [OPTIONS]
+ * Reads NDJSON from stdin or from concurrently run source commands
+ * (one JSON object per line), aggregates and outputs unified report
  */
 
-#define JSMN_STATIC
-#include "../jsmn/jsmn.h"
+#define JSMN_HEADER  /* jsmn declarations only (via common.h) */
+#include "health_source.h"
+#include "disk_table.h"
+#include "fleet_query.h"
+#include "source_runner.h"
+#include "line_pool.h"
 #include "../parsers/common.h"
-#include "../smart_parser.h"
+#include "../jm_history.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <getopt.h>
+#include <sys/wait.h>
+#include <unistd.h>
 #include <time.h>
 
-#define MAX_SOURCES 32
-#define MAX_LINE_SIZE (1024 * 1024)  /* 1MB per line */
+#define MAX_SOURCE_COMMANDS 64
+#define DEFAULT_SOURCE_TIMEOUT_S 30
+#define MAX_SOURCE_TIMEOUT_S 3600
 
-/* Source result from one input line */
+/* Aggregated report: every source's disks, in columns */
 typedef struct {
-    char backend[32];
-    char device[256];
-    char controller_model[64];
-    char controller_type[32];
-
-    disk_smart_data_t disks[32];
-    int num_disks;
-
-    disk_health_status_t overall_status;
-    int parse_error;
-} source_result_t;
-
-/* Aggregated report */
-typedef struct {
-    source_result_t sources[MAX_SOURCES];
-    int num_sources;
-
-    int total_disks;
-    int healthy_disks;
-    int failed_disks;
-    disk_health_status_t overall_status;
-
+    disk_table_t table;
+    health_totals_t totals;
     char timestamp[64];
 } aggregated_report_t;
 
@@ -54,207 +42,277 @@ typedef struct {
     int output_json;
     int quiet;
     int verbose;
+    int stream;                         /* --stream: constant memory, output per source */
+    const char* config_path;            /* --config: re-assess disks with this policy */
+    const char* commands[MAX_SOURCE_COMMANDS];  /* --source: run instead of reading stdin */
+    int num_commands;
+    int timeout_s;                      /* --timeout: per-source deadline */
+    int threads;                        /* --threads: stdin parser threads */
+    const char* history_path;           /* --history: append every disk's snapshot */
+    uint32_t history_drives;            /* --history-drives: directory size of a new file */
+    int changed_since;                  /* --changed-since: report changes instead */
+    fleet_query_t query;                /* --where, --group-by, --top, --by */
+    int has_query;                      /* Report the query instead of the sources */
+    int has_by;
 } cli_options_t;
 
 /**
- * Parse one line of disk-health JSON format
+ * Output one source line of the text summary
  */
-static int parse_disk_health_line(const char* line, source_result_t* result) {
-    jsmn_parser parser;
-    jsmntok_t tokens[10000];
+static void output_summary_source(const source_result_t* src) {
+    if (src->error[0] != '\0') {
+        printf("  ✗ %s: %s\n", src->device, src->error);
+        return;
+    }
 
-    jsmn_init(&parser);
-    int num_tokens = jsmn_parse(&parser, line, strlen(line), tokens, 10000);
+    const char* status_icon = (src->overall_status == DISK_STATUS_PASSED) ? "✓" : "✗";
+    printf("  %s %s %s (%d disk%s)\n",
+           status_icon, src->backend, src->device,
+           src->num_disks, src->num_disks == 1 ? "" : "s");
+}
 
-    if (num_tokens < 0) {
-        fprintf(stderr, "Warning: Failed to parse JSON line (error %d)\n", num_tokens);
-        result->parse_error = 1;
-        return -1;
+/**
+ * Output the totals of the text summary
+ */
+static void output_summary_totals(const health_totals_t* totals) {
+    printf("\nOverall Status: %s\n", totals->overall_status == DISK_STATUS_PASSED ? "PASSED" : "FAILED");
+    printf("  Total Disks: %d\n", totals->total_disks);
+    printf("  Healthy: %d\n", totals->healthy_disks);
+    printf("  Failed: %d\n", totals->failed_disks);
+    if (totals->error_sources > 0) {
+        printf("  Source Errors: %d\n", totals->error_sources);
     }
 
-    memset(result, 0, sizeof(source_result_t));
+    printf("\nExit Code: %d (%s)\n",
+           totals->overall_status == DISK_STATUS_PASSED ? 0 : 1,
+           totals->overall_status == DISK_STATUS_PASSED ? "all healthy" : "failures detected");
+}
 
-    /* Extract basic fields */
-    for (int i = 0; i < num_tokens - 1; i++) {
-        jsmntok_t* t = &tokens[i];
-        if (t->type != JSMN_STRING) continue;
+/**
+ * Output text summary (scratch as for output_json)
+ */
+static void output_summary(const aggregated_report_t* report, source_result_t* scratch) {
+    printf("Disk Health Report - %s\n\n", report->timestamp);
 
-        if (json_token_streq(line, t, "backend")) {
-            json_token_tostr(line, &tokens[i + 1], result->backend, sizeof(result->backend));
-        }
-        else if (json_token_streq(line, t, "device")) {
-            json_token_tostr(line, &tokens[i + 1], result->device, sizeof(result->device));
-        }
-        /* controller.model and controller.type */
-        else if (json_token_streq(line, t, "controller") && tokens[i + 1].type == JSMN_OBJECT) {
-            int obj_end = tokens[i + 1].end;
-            for (int j = i + 2; j < num_tokens && tokens[j].start < obj_end; j++) {
-                if (json_token_streq(line, &tokens[j], "model")) {
-                    json_token_tostr(line, &tokens[j + 1], result->controller_model,
-                                   sizeof(result->controller_model));
-                }
-                else if (json_token_streq(line, &tokens[j], "type")) {
-                    json_token_tostr(line, &tokens[j + 1], result->controller_type,
-                                   sizeof(result->controller_type));
-                }
-            }
-        }
-        /* disks array */
-        else if (json_token_streq(line, t, "disks") && tokens[i + 1].type == JSMN_ARRAY) {
-            int array_end = tokens[i + 1].end;
-            int k = i + 2;
-
-            while (k < num_tokens && tokens[k].start < array_end &&
-                   result->num_disks < 32) {
-                if (tokens[k].type == JSMN_OBJECT) {
-                    disk_smart_data_t* disk = &result->disks[result->num_disks];
-                    memset(disk, 0, sizeof(disk_smart_data_t));
-                    disk->is_present = 1;
-
-                    int disk_end = tokens[k].end;
-                    for (int m = k + 1; m < num_tokens && tokens[m].start < disk_end; m++) {
-                        if (json_token_streq(line, &tokens[m], "disk_number")) {
-                            json_token_toint(line, &tokens[m + 1], &disk->disk_number);
-                        }
-                        else if (json_token_streq(line, &tokens[m], "model")) {
-                            json_token_tostr(line, &tokens[m + 1], disk->disk_name,
-                                           sizeof(disk->disk_name));
-                        }
-                        else if (json_token_streq(line, &tokens[m], "serial")) {
-                            json_token_tostr(line, &tokens[m + 1], disk->serial_number,
-                                           sizeof(disk->serial_number));
-                        }
-                        else if (json_token_streq(line, &tokens[m], "firmware")) {
-                            json_token_tostr(line, &tokens[m + 1], disk->firmware_rev,
-                                           sizeof(disk->firmware_rev));
-                        }
-                        else if (json_token_streq(line, &tokens[m], "size_mb")) {
-                            uint64_t size;
-                            json_token_touint64(line, &tokens[m + 1], &size);
-                            disk->size_mb = size;
-                        }
-                        else if (json_token_streq(line, &tokens[m], "overall_status")) {
-                            char status[16];
-                            json_token_tostr(line, &tokens[m + 1], status, sizeof(status));
-                            if (strcmp(status, "healthy") == 0) {
-                                disk->overall_status = DISK_STATUS_PASSED;
-                            } else if (strcmp(status, "failed") == 0) {
-                                disk->overall_status = DISK_STATUS_FAILED;
-                            } else {
-                                disk->overall_status = DISK_STATUS_ERROR;
-                            }
-                        }
-                    }
+    printf("Sources: %d\n", report->totals.num_sources);
+    for (uint32_t i = 0; i < report->table.num_sources; i++) {
+        disk_table_get_source(&report->table, i, scratch);
+        output_summary_source(scratch);
+    }
 
-                    result->num_disks++;
-                    k++;
-                    while (k < num_tokens && tokens[k].start < disk_end) k++;
-                } else {
-                    k++;
-                }
-            }
-        }
+    output_summary_totals(&report->totals);
+}
+
+/**
+ * Output the start of the aggregated JSON, up to the sources array
+ */
+static void output_json_header(json_writer_t* w, const char* timestamp) {
+    json_begin_object(w, NULL);
+    json_write_string(w, "version", "2.0");
+    json_write_string(w, "timestamp", timestamp);
+    json_begin_array(w, "sources");
+}
+
+/**
+ * Output one entry of the JSON sources array
+ */
+static void output_json_source(json_writer_t* w, const source_result_t* src) {
+    json_begin_object(w, NULL);
+
+    if (src->error[0] != '\0') {
+        json_write_string(w, "backend", "command");
+        json_write_string(w, "device", src->device);
+        json_write_int(w, "num_disks", 0);
+        json_write_string(w, "status", "error");
+        json_write_string(w, "error", src->error);
+        json_end(w);
+        return;
     }
 
-    /* Determine overall status for this source */
-    result->overall_status = DISK_STATUS_PASSED;
-    for (int i = 0; i < result->num_disks; i++) {
-        if (result->disks[i].overall_status == DISK_STATUS_FAILED) {
-            result->overall_status = DISK_STATUS_FAILED;
-            break;
-        }
+    json_write_string(w, "backend", src->backend);
+    json_write_string(w, "device", src->device);
+    json_begin_object(w, "controller");
+    json_write_string(w, "model", src->controller_model);
+    json_write_string(w, "type", src->controller_type);
+    json_end(w);
+    json_write_int(w, "num_disks", src->num_disks);
+    json_write_string(w, "status", src->overall_status == DISK_STATUS_PASSED ? "healthy" : "failed");
+    if (src->has_timings) {
+        jm_timings_write_json(w, "timings", &src->timings);
     }
+    json_end(w);
+}
 
-    return 0;
+/**
+ * Output the end of the aggregated JSON: close sources, add the summary
+ */
+static void output_json_summary(json_writer_t* w, const health_totals_t* totals) {
+    json_end(w);
+
+    json_begin_object(w, "summary");
+    json_write_int(w, "total_disks", totals->total_disks);
+    json_write_int(w, "healthy_disks", totals->healthy_disks);
+    json_write_int(w, "failed_disks", totals->failed_disks);
+    json_write_int(w, "error_sources", totals->error_sources);
+    json_write_string(w, "overall_status",
+                      totals->overall_status == DISK_STATUS_PASSED ? "healthy" : "failed");
+    json_end(w);
+    json_end(w);
 }
 
 /**
- * Aggregate multiple source results
+ * Output aggregated JSON (built whole, then written at once)
+ * scratch receives each stored source's header in turn.
  */
-static void aggregate_sources(aggregated_report_t* report) {
-    get_timestamp(report->timestamp, sizeof(report->timestamp));
+static void output_json(const aggregated_report_t* report, source_result_t* scratch) {
+    json_writer_t w;
+    json_writer_init(&w, 1);
+    output_json_header(&w, report->timestamp);
+    for (uint32_t i = 0; i < report->table.num_sources; i++) {
+        disk_table_get_source(&report->table, i, scratch);
+        output_json_source(&w, scratch);
+    }
+    output_json_summary(&w, &report->totals);
+    json_writer_flush(&w, stdout);
+    json_writer_free(&w);
+}
 
-    report->total_disks = 0;
-    report->healthy_disks = 0;
-    report->failed_disks = 0;
-    report->overall_status = DISK_STATUS_PASSED;
+/* Status of a stored disk, as the JSON API names it */
+static const char* status_name(uint8_t status) {
+    return status == DISK_STATUS_PASSED ? "healthy" : status == DISK_STATUS_FAILED ? "failed" : "error";
+}
 
-    for (int i = 0; i < report->num_sources; i++) {
-        source_result_t* src = &report->sources[i];
+/* Helper: String or "-" when empty */
+static const char* or_dash(const char* s) {
+    return s[0] != '\0' ? s : "-";
+}
 
-        report->total_disks += src->num_disks;
+/**
+ * Output one disk of a query result as a text line
+ */
+static void output_query_disk(const disk_table_t* t, uint32_t d) {
+    const disk_table_source_t* src = &t->sources[t->disk_source[d]];
+    int temp = fleet_query_temperature(t, d);
 
-        for (int j = 0; j < src->num_disks; j++) {
-            if (src->disks[j].overall_status == DISK_STATUS_PASSED) {
-                report->healthy_disks++;
-            } else {
-                report->failed_disks++;
-                report->overall_status = DISK_STATUS_FAILED;
-            }
-        }
+    printf("%s", or_dash(disk_table_string(t, src->device)));
+    if (t->disk_number[d] >= 0) {
+        printf(" disk %d", t->disk_number[d]);
     }
+    printf("  %s  %s  %s  %s", or_dash(disk_table_string(t, t->model[d])),
+           or_dash(disk_table_string(t, t->serial[d])), or_dash(disk_table_string(t, t->firmware[d])),
+           status_name(t->status[d]));
+    if (temp >= 0) {
+        printf("  %d°C", temp);
+    }
+    printf("\n");
 }
 
 /**
- * Output text summary
+ * Output a query result as text
  */
-static void output_summary(const aggregated_report_t* report) {
-    printf("Disk Health Report - %s\n\n", report->timestamp);
-
-    printf("Sources: %d\n", report->num_sources);
-    for (int i = 0; i < report->num_sources; i++) {
-        const source_result_t* src = &report->sources[i];
-        const char* status_icon = (src->overall_status == DISK_STATUS_PASSED) ? "✓" : "✗";
-        printf("  %s %s %s (%d disk%s)\n",
-               status_icon, src->backend, src->device,
-               src->num_disks, src->num_disks == 1 ? "" : "s");
+static void output_query(const cli_options_t* options, const aggregated_report_t* report,
+                         const fleet_query_result_t* result) {
+    const fleet_query_t* q = &options->query;
+    const disk_table_t* t = &report->table;
+
+    printf("Disk Health Query - %s\n\n", report->timestamp);
+    if (q->where[0] != '\0') {
+        printf("Where: %s\n", q->where);
+    }
+    printf("Matched: %u of %u disks\n\n", result->matched, t->num_disks);
+
+    if (q->group_by != QUERY_GROUP_NONE) {
+        static const char* keys[] = {"", "model", "firmware", "backend", "controller"};
+        printf("Groups by %s: %u\n", keys[q->group_by], result->num_groups);
+        printf("  %7s %8s %7s %9s  %s\n", "DISKS", "HEALTHY", "FAILED", "MAX TEMP", "KEY");
+        for (uint32_t i = 0; i < result->num_groups; i++) {
+            const query_group_entry_t* g = &result->groups[i];
+            char temp[16] = "-";
+            if (g->max_temperature >= 0) snprintf(temp, sizeof(temp), "%d°C", g->max_temperature);
+            printf("  %7u %8u %7u %10s  %s\n", g->disks, g->healthy, g->failed, temp,
+                   or_dash(disk_table_string(t, g->key)));
+        }
+    } else if (q->top > 0) {
+        printf("Top %d by %s:\n", q->top, q->by_name);
+        for (uint32_t i = 0; i < result->num_matches; i++) {
+            printf("  %3u. %-8llu ", i + 1, (unsigned long long)result->matches[i].value);
+            output_query_disk(t, result->matches[i].disk);
+        }
+    } else {
+        for (uint32_t i = 0; i < result->num_matches; i++) {
+            printf("  ");
+            output_query_disk(t, result->matches[i].disk);
+        }
     }
 
-    printf("\nOverall Status: %s\n", report->overall_status == DISK_STATUS_PASSED ? "PASSED" : "FAILED");
-    printf("  Total Disks: %d\n", report->total_disks);
-    printf("  Healthy: %d\n", report->healthy_disks);
-    printf("  Failed: %d\n", report->failed_disks);
-
-    printf("\nExit Code: %d (%s)\n",
-           report->overall_status == DISK_STATUS_PASSED ? 0 : 1,
-           report->overall_status == DISK_STATUS_PASSED ? "all healthy" : "failures detected");
+    output_summary_totals(&report->totals);
 }
 
 /**
- * Output aggregated JSON
+ * Output a query result as JSON (the summary closes the array, as for sources)
  */
-static void output_json(const aggregated_report_t* report) {
-    printf("{\n");
-    printf("  \"version\": \"2.0\",\n");
-    printf("  \"timestamp\": \"%s\",\n", report->timestamp);
-
-    printf("  \"sources\": [\n");
-    for (int i = 0; i < report->num_sources; i++) {
-        const source_result_t* src = &report->sources[i];
-        if (i > 0) printf(",\n");
-
-        printf("    {\n");
-        printf("      \"backend\": \"%s\",\n", src->backend);
-        printf("      \"device\": \"%s\",\n", src->device);
-        printf("      \"controller\": {\n");
-        printf("        \"model\": \"%s\",\n", src->controller_model);
-        printf("        \"type\": \"%s\"\n", src->controller_type);
-        printf("      },\n");
-        printf("      \"num_disks\": %d,\n", src->num_disks);
-        printf("      \"status\": \"%s\"\n",
-               src->overall_status == DISK_STATUS_PASSED ? "healthy" : "failed");
-        printf("    }");
-    }
-    printf("\n  ],\n");
-
-    printf("  \"summary\": {\n");
-    printf("    \"total_disks\": %d,\n", report->total_disks);
-    printf("    \"healthy_disks\": %d,\n", report->healthy_disks);
-    printf("    \"failed_disks\": %d,\n", report->failed_disks);
-    printf("    \"overall_status\": \"%s\"\n",
-           report->overall_status == DISK_STATUS_PASSED ? "healthy" : "failed");
-    printf("  }\n");
-    printf("}\n");
+static void output_query_json(const cli_options_t* options, const aggregated_report_t* report,
+                              const fleet_query_result_t* result) {
+    static const char* keys[] = {NULL, "model", "firmware", "backend", "controller"};
+    const fleet_query_t* q = &options->query;
+    const disk_table_t* t = &report->table;
+    json_writer_t w;
+
+    json_writer_init(&w, 1);
+    json_begin_object(&w, NULL);
+    json_write_string(&w, "version", "2.0");
+    json_write_string(&w, "timestamp", report->timestamp);
+    json_begin_object(&w, "query");
+    if (q->where[0] != '\0') json_write_string(&w, "where", q->where);
+    else json_write_null(&w, "where");
+    if (q->group_by != QUERY_GROUP_NONE) json_write_string(&w, "group_by", keys[q->group_by]);
+    else json_write_null(&w, "group_by");
+    if (q->top > 0) {
+        json_write_int(&w, "top", q->top);
+        json_write_string(&w, "by", q->by_name);
+    } else {
+        json_write_null(&w, "top");
+        json_write_null(&w, "by");
+    }
+    json_end(&w);
+    json_write_uint(&w, "matched_disks", result->matched);
+
+    if (q->group_by != QUERY_GROUP_NONE) {
+        json_begin_array(&w, "groups");
+        for (uint32_t i = 0; i < result->num_groups; i++) {
+            const query_group_entry_t* g = &result->groups[i];
+            json_begin_object(&w, NULL);
+            json_write_string(&w, "key", disk_table_string(t, g->key));
+            json_write_uint(&w, "disks", g->disks);
+            json_write_uint(&w, "healthy", g->healthy);
+            json_write_uint(&w, "failed", g->failed);
+            if (g->max_temperature >= 0) json_write_int(&w, "max_temperature_celsius", g->max_temperature);
+            else json_write_null(&w, "max_temperature_celsius");
+            json_end(&w);
+        }
+    } else {
+        json_begin_array(&w, "disks");
+        for (uint32_t i = 0; i < result->num_matches; i++) {
+            uint32_t d = result->matches[i].disk;
+            int temp = fleet_query_temperature(t, d);
+            json_begin_object(&w, NULL);
+            json_write_string(&w, "device", disk_table_string(t, t->sources[t->disk_source[d]].device));
+            if (t->disk_number[d] >= 0) json_write_int(&w, "disk_number", t->disk_number[d]);
+            else json_write_null(&w, "disk_number");
+            json_write_string(&w, "model", disk_table_string(t, t->model[d]));
+            json_write_string(&w, "serial", disk_table_string(t, t->serial[d]));
+            json_write_string(&w, "firmware", disk_table_string(t, t->firmware[d]));
+            json_write_string(&w, "status", status_name(t->status[d]));
+            if (temp >= 0) json_write_int(&w, "temperature_celsius", temp);
+            else json_write_null(&w, "temperature_celsius");
+            if (q->top > 0) json_write_uint(&w, "value", result->matches[i].value);
+            json_end(&w);
+        }
+    }
+
+    output_json_summary(&w, &report->totals);
+    json_writer_flush(&w, stdout);
+    json_writer_free(&w);
 }
 
 /**
@@ -262,17 +320,32 @@ static void output_json(const aggregated_report_t* report) {
  */
 static void parse_arguments(int argc, char** argv, cli_options_t* options) {
     memset(options, 0, sizeof(cli_options_t));
+    options->timeout_s = DEFAULT_SOURCE_TIMEOUT_S;
+    options->threads = 1;
+    fleet_query_init(&options->query);
 
     static struct option long_options[] = {
         {"json", no_argument, 0, 'j'},
         {"quiet", no_argument, 0, 'q'},
         {"verbose", no_argument, 0, 'v'},
+        {"config", required_argument, 0, 'c'},
+        {"stream", no_argument, 0, 's'},
+        {"source", required_argument, 0, 'S'},
+        {"timeout", required_argument, 0, 't'},
+        {"threads", required_argument, 0, 'T'},
+        {"history", required_argument, 0, 'H'},
+        {"changed-since", required_argument, 0, 'C'},
+        {"history-drives", required_argument, 0, 'D'},
+        {"where", required_argument, 0, 'w'},
+        {"group-by", required_argument, 0, 'g'},
+        {"top", required_argument, 0, 'n'},
+        {"by", required_argument, 0, 'b'},
         {"help", no_argument, 0, 'h'},
         {0, 0, 0, 0}
     };
 
     int opt;
-    while ((opt = getopt_long(argc, argv, "jqvh", long_options, NULL)) != -1) {
+    while ((opt = getopt_long(argc, argv, "jqvc:sS:t:T:H:C:D:w:g:n:b:h", long_options, NULL)) != -1) {
         switch (opt) {
             case 'j':
                 options->output_json = 1;
@@ -283,6 +356,97 @@ static void parse_arguments(int argc, char** argv, cli_options_t* options) {
             case 'v':
                 options->verbose = 1;
                 break;
+            case 'c':
+                options->config_path = optarg;
+                break;
+            case 's':
+                options->stream = 1;
+                break;
+            case 'S':
+                if (options->num_commands >= MAX_SOURCE_COMMANDS) {
+                    fprintf(stderr, "Error: At most %d --source commands\n", MAX_SOURCE_COMMANDS);
+                    exit(3);
+                }
+                options->commands[options->num_commands++] = optarg;
+                break;
+            case 't': {
+                char* end;
+                long value = strtol(optarg, &end, 10);
+                if (*end != '\0' || value < 1 || value > MAX_SOURCE_TIMEOUT_S) {
+                    fprintf(stderr, "Error: --timeout must be 1-%d seconds\n", MAX_SOURCE_TIMEOUT_S);
+                    exit(3);
+                }
+                options->timeout_s = (int)value;
+                break;
+            }
+            case 'T': {
+                char* end;
+                long value = strtol(optarg, &end, 10);
+                if (*end != '\0' || value < 0 || value > LINE_POOL_MAX_THREADS) {
+                    fprintf(stderr, "Error: --threads must be 0-%d\n", LINE_POOL_MAX_THREADS);
+                    exit(3);
+                }
+                if (value == 0) {
+                    /* 0 = one per online CPU */
+                    value = sysconf(_SC_NPROCESSORS_ONLN);
+                    if (value < 1) value = 1;
+                    if (value > LINE_POOL_MAX_THREADS) value = LINE_POOL_MAX_THREADS;
+                }
+                options->threads = (int)value;
+                break;
+            }
+            case 'H':
+                options->history_path = optarg;
+                break;
+            case 'C':
+                options->history_path = optarg;
+                options->changed_since = 1;
+                break;
+            case 'D': {
+                char* end;
+                long value = strtol(optarg, &end, 10);
+                if (*end != '\0' || value < 1 || value > JM_HISTORY_MAX_DRIVES) {
+                    fprintf(stderr, "Error: --history-drives must be 1-%d\n", JM_HISTORY_MAX_DRIVES);
+                    exit(3);
+                }
+                options->history_drives = (uint32_t)value;
+                break;
+            }
+            case 'w': {
+                char error[160];
+                if (fleet_query_add_where(&options->query, optarg, error, sizeof(error)) != 0) {
+                    fprintf(stderr, "Error: --where: %s\n", error);
+                    exit(3);
+                }
+                options->has_query = 1;
+                break;
+            }
+            case 'g':
+                if (fleet_query_set_group(&options->query, optarg) != 0) {
+                    fprintf(stderr, "Error: --group-by must be model, firmware, backend or controller\n");
+                    exit(3);
+                }
+                options->has_query = 1;
+                break;
+            case 'n': {
+                char* end;
+                long value = strtol(optarg, &end, 10);
+                if (*end != '\0' || value < 1 || value > FLEET_QUERY_MAX_TOP) {
+                    fprintf(stderr, "Error: --top must be 1-%d\n", FLEET_QUERY_MAX_TOP);
+                    exit(3);
+                }
+                options->query.top = (int)value;
+                options->has_query = 1;
+                break;
+            }
+            case 'b':
+                if (fleet_query_set_by(&options->query, optarg) != 0) {
+                    fprintf(stderr, "Error: --by must be temperature, size_mb, disk_number or "
+                                    "attr[ID].raw|value|worst|thresh\n");
+                    exit(3);
+                }
+                options->has_by = 1;
+                break;
             case 'h':
                 printf("Usage: disk-health [OPTIONS]\n\n");
                 printf("Aggregate SMART data from multiple sources\n\n");
@@ -290,73 +454,425 @@ static void parse_arguments(int argc, char** argv, cli_options_t* options) {
                 printf("  -j, --json     Output aggregated JSON\n");
                 printf("  -q, --quiet    Minimal output (exit code only)\n");
                 printf("  -v, --verbose  Verbose output\n");
+                printf("  -c, --config PATH\n");
+                printf("                 Re-assess disks from their attributes with this\n");
+                printf("                 threshold config instead of trusting each source\n");
+                printf("  -s, --stream   Output each source as it arrives, in constant memory\n");
+                printf("  -S, --source CMD\n");
+                printf("                 Run CMD (via /bin/sh) as a source instead of reading\n");
+                printf("                 stdin; repeat for more. All sources run concurrently\n");
+                printf("  -t, --timeout SEC\n");
+                printf("                 Per-source deadline for --source (default: %d)\n",
+                       DEFAULT_SOURCE_TIMEOUT_S);
+                printf("  -T, --threads N\n");
+                printf("                 Parse stdin on N threads (0 = one per CPU); output\n");
+                printf("                 order and totals are the same as with one thread\n");
+                printf("  -H, --history FILE\n");
+                printf("                 Append each disk's SMART snapshot to a history file\n");
+                printf("                 (created if missing; query it with jm-history)\n");
+                printf("  -C, --changed-since FILE\n");
+                printf("                 Output only the disks, statuses and attributes that\n");
+                printf("                 changed since FILE's last poll, or a heartbeat line\n");
+                printf("                 if nothing did (implies --history FILE)\n");
+                printf("  -D, --history-drives N\n");
+                printf("                 Drives a new history file keeps apart (default: %d);\n",
+                       JM_HISTORY_DEFAULT_DRIVES);
+                printf("                 drives with no snapshot left in it make room\n");
+                printf("  -w, --where EXPR\n");
+                printf("                 Report only disks matching EXPR, e.g. 'attr[0xC5].raw>0'\n");
+                printf("                 or 'temperature>=45 && model~WD' (repeat to AND)\n");
+                printf("  -g, --group-by KEY\n");
+                printf("                 Count disks per model, firmware, backend or controller\n");
+                printf("  -n, --top N    Report the N disks ranked highest --by a field\n");
+                printf("  -b, --by FIELD Ranking for --top: temperature (default), size_mb,\n");
+                printf("                 disk_number or attr[ID].raw|value|worst|thresh\n");
                 printf("  -h, --help     Show this help\n\n");
-                printf("Input: NDJSON from stdin (one JSON object per line)\n");
+                printf("Input: NDJSON from stdin or --source commands (one JSON object per line)\n");
                 printf("Output: Text summary or JSON aggregate\n");
                 exit(0);
             default:
                 exit(1);
         }
     }
+
+    if (options->threads > 1 && options->num_commands > 0) {
+        fprintf(stderr, "Error: --threads applies to stdin input, not --source\n");
+        exit(3);
+    }
+    if (options->has_by && options->query.top == 0) {
+        fprintf(stderr, "Error: --by ranks --top results; add --top N\n");
+        exit(3);
+    }
+    if (options->query.top > 0 && options->query.group_by != QUERY_GROUP_NONE) {
+        fprintf(stderr, "Error: --top and --group-by cannot be combined\n");
+        exit(3);
+    }
+    if (options->has_query && (options->stream || options->changed_since)) {
+        fprintf(stderr, "Error: --where, --group-by and --top report the whole input; "
+                        "they cannot be combined with --stream or --changed-since\n");
+        exit(3);
+    }
 }
 
-int main(int argc, char** argv) {
-    cli_options_t options;
-    parse_arguments(argc, argv, &options);
 
-    aggregated_report_t report;
-    memset(&report, 0, sizeof(report));
+/* Where parsed sources go, whether they come from stdin or --source */
+typedef struct {
+    const cli_options_t* options;
+    health_totals_t totals;
+    char timestamp[64];
+    aggregated_report_t* report;        /* Batch: collected sources (NULL when streaming) */
+    source_result_t* current;           /* Reused for every source */
+    health_arena_t arena;
+    int streamed;                       /* Sources output so far (streaming) */
+    int dropped;                        /* Batch: sources left out for lack of memory */
+    int per_command[MAX_SOURCE_COMMANDS];  /* Sources parsed from each --source */
+    jm_history_t history;               /* --history, if open */
+    int has_history;
+    int64_t now;                        /* Snapshot time of this run */
+    int changes;                        /* Changes reported (--changed-since) */
+    json_writer_t json;                 /* Stream: the open report, flushed per source */
+} collector_t;
+
+static int collector_init(collector_t* c, const cli_options_t* options) {
+    memset(c, 0, sizeof(collector_t));
+    c->options = options;
+    json_writer_init(&c->json, 1);
+    get_timestamp(c->timestamp, sizeof(c->timestamp));
+    c->now = (int64_t)time(NULL);
+    health_totals_init(&c->totals);
+    health_arena_init(&c->arena);
+
+    c->current = malloc(sizeof(source_result_t));
+    if (c->current == NULL) {
+        return -1;
+    }
+    if (options->stream) {
+        return 0;
+    }
+    c->report = calloc(1, sizeof(aggregated_report_t));
+    if (c->report == NULL || disk_table_init(&c->report->table) != 0) {
+        free(c->report);
+        c->report = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+static void collector_free(collector_t* c) {
+    if (c->has_history) {
+        jm_history_close(&c->history);
+    }
+    health_arena_free(&c->arena);
+    json_writer_free(&c->json);
+    free(c->current);
+    if (c->report != NULL) {
+        disk_table_free(&c->report->table);
+        free(c->report);
+    }
+}
 
-    /* Read NDJSON from stdin (one JSON object per line) */
-    char* line = malloc(MAX_LINE_SIZE);
-    if (!line) {
-        fprintf(stderr, "Error: Out of memory\n");
-        return 3;
+/**
+ * Output one source right away when streaming, or keep it for the report
+ */
+static void collector_emit(collector_t* c, const source_result_t* result) {
+    const cli_options_t* options = c->options;
+
+    if (c->report != NULL) {
+        if (disk_table_add_source(&c->report->table, result) != 0 && c->dropped++ == 0) {
+            fprintf(stderr, "Warning: Out of memory storing %s; it is counted but not listed "
+                            "(use --stream)\n", result->device);
+        }
+        return;
+    }
+    if (!options->quiet && !options->changed_since) {
+        int first = (c->streamed++ == 0);
+        if (options->output_json) {
+            if (first) output_json_header(&c->json, c->timestamp);
+            output_json_source(&c->json, result);
+            json_writer_flush(&c->json, stdout);
+        } else {
+            if (first) printf("Disk Health Report - %s\n\nSources:\n", c->timestamp);
+            output_summary_source(result);
+            fflush(stdout);
+        }
+    }
+}
+
+/* jm_history_change_fn: one line per change (--changed-since) */
+static void collector_change(void* ctx, const jm_history_change_t* change) {
+    collector_t* c = ctx;
+    jm_history_write_change(stdout, change, c->options->output_json);
+    c->changes++;
+}
+
+/**
+ * Append a source's disks to --history (on the reading thread, in input order)
+ */
+static void collector_record(collector_t* c, const source_result_t* result) {
+    int report_changes = c->options->changed_since && !c->options->quiet;
+    if (report_changes && result->error[0] != '\0') {
+        fprintf(stderr, "Warning: %s: %s\n", result->device, result->error);  /* Not in the change report */
+    }
+    if (c->has_history && result->error[0] == '\0' &&
+        jm_history_append(&c->history, result->device, result->disks, result->num_disks, c->now,
+                          report_changes ? collector_change : NULL, c) < 0) {
+        fprintf(stderr, "Warning: History %s holds %u drives with snapshots in it; %s not recorded\n",
+                c->options->history_path, jm_history_max_drives(&c->history), result->device);
+    }
+}
+
+/**
+ * Count a filled-in source; streaming outputs it right away
+ */
+static void collector_commit(collector_t* c, source_result_t* result) {
+    if (c->options->config_path != NULL && result->error[0] == '\0') {
+        source_reassess(result);
     }
+    health_totals_add(&c->totals, result);
+    collector_record(c, result);
+    collector_emit(c, result);
+}
+
+/**
+ * Parse one NDJSON line as a source
+ * @return 0 if it was a valid source
+ */
+static int collector_add_line(collector_t* c, const char* line, size_t len) {
+    if (c->options->verbose) {
+        fprintf(stderr, "Parsing source %d...\n", c->totals.num_sources + 1);
+    }
+
+    source_result_t* result = c->current;
+    if (parse_disk_health_arena(line, len, &c->arena, result) != 0) {
+        return -1;
+    }
+    collector_commit(c, result);
+    return 0;
+}
 
-    while (fgets(line, MAX_LINE_SIZE, stdin)) {
+/**
+ * Record a --source command that produced no usable result
+ */
+static void collector_add_failure(collector_t* c, const char* command, const char* error) {
+    fprintf(stderr, "Warning: Source \"%s\" %s\n", command, error);
+
+    source_result_t* result = c->current;
+    memset(result, 0, sizeof(source_result_t));
+    snprintf(result->backend, sizeof(result->backend), "command");
+    snprintf(result->device, sizeof(result->device), "%s", command);
+    snprintf(result->error, sizeof(result->error), "%s", error);
+    result->overall_status = DISK_STATUS_ERROR;
+    collector_commit(c, result);
+}
+
+/* source_line_fn: one output line of a --source command */
+static void on_source_line(void* ctx, int index, const char* line, size_t len) {
+    collector_t* c = ctx;
+    if (collector_add_line(c, line, len) == 0) {
+        c->per_command[index]++;
+    }
+}
+
+/**
+ * Read NDJSON from stdin (one JSON object per line, or binary records)
+ */
+static void collect_stdin(collector_t* c, input_reader_t* in) {
+    const char* line;
+    size_t len;
+    int ret;
+
+    while ((ret = health_input_next(in, &line, &len)) > 0) {
         /* Skip empty lines */
-        if (line[0] == '\n' || line[0] == '\0') {
+        if (len == 0) {
             continue;
         }
+        collector_add_line(c, line, len);
+    }
+    if (ret < 0) {
+        fprintf(stderr, "Warning: Error reading stdin: %s\n", in->error);
+    }
+}
+
+/* line_pool_parse_fn: parse (and re-assess) one line on a worker thread */
+static int pool_parse(void* ctx, health_arena_t* arena, const char* line, size_t len,
+                      source_result_t* result) {
+    const collector_t* c = ctx;
 
-        if (report.num_sources >= MAX_SOURCES) {
-            fprintf(stderr, "Warning: Maximum sources (%d) exceeded, ignoring rest\n", MAX_SOURCES);
-            break;
+    if (parse_disk_health_arena(line, len, arena, result) != 0) {
+        return -1;
+    }
+    if (c->options->config_path != NULL) {
+        source_reassess(result);
+    }
+    return 0;
+}
+
+/* line_pool_commit_fn: take a parsed batch, in input order */
+static void pool_commit(void* ctx, const line_batch_t* batch) {
+    collector_t* c = ctx;
+
+    /* Record and output (or store) in input order, then merge the batch's partial report */
+    for (int i = 0; i < batch->num_lines; i++) {
+        if (!batch->valid[i]) continue;
+        collector_record(c, &batch->results[i]);
+        collector_emit(c, &batch->results[i]);
+    }
+    health_totals_merge(&c->totals, &batch->totals);
+}
+
+/**
+ * Read NDJSON from stdin and parse it on --threads workers
+ */
+static void collect_stdin_threaded(collector_t* c, input_reader_t* in) {
+    if (c->options->verbose) {
+        fprintf(stderr, "Parsing on %d threads...\n", c->options->threads);
+    }
+    if (line_pool_run(in, c->options->threads, pool_parse, pool_commit, c) != 0) {
+        fprintf(stderr, "Warning: Could not start parser threads\n");
+    } else if (in->error != NULL) {
+        fprintf(stderr, "Warning: Error reading stdin: %s\n", in->error);
+    }
+}
+
+/**
+ * Run every --source command concurrently and collect their output
+ * Streaming takes lines in arrival order; a batch report keeps the
+ * command-line order.
+ */
+static void collect_commands(collector_t* c) {
+    const cli_options_t* options = c->options;
+    int timeout_ms = options->timeout_s * 1000;
+    source_proc_t procs[MAX_SOURCE_COMMANDS];
+
+    for (int i = 0; i < options->num_commands; i++) {
+        source_proc_init(&procs[i], options->commands[i]);
+    }
+
+    source_run_all(procs, options->num_commands, timeout_ms,
+                   options->stream ? on_source_line : NULL, c);
+
+    for (int i = 0; i < options->num_commands; i++) {
+        char error[64];
+
+        if (!options->stream) {
+            source_for_each_line(&procs[i], i, on_source_line, c);
         }
 
-        if (options.verbose) {
-            fprintf(stderr, "Parsing source %d...\n", report.num_sources + 1);
+        if (options->verbose) {
+            fprintf(stderr, "Source %d finished in %llu ms: %s\n", i + 1,
+                    (unsigned long long)(procs[i].elapsed_us / 1000), procs[i].command);
         }
 
-        source_result_t* result = &report.sources[report.num_sources];
-        if (parse_disk_health_line(line, result) == 0) {
-            report.num_sources++;
+        if (source_failure(&procs[i], timeout_ms, error, sizeof(error))) {
+            collector_add_failure(c, procs[i].command, error);
+        } else if (c->per_command[i] == 0) {
+            snprintf(error, sizeof(error), "produced no valid output (exit status %d)",
+                     WIFEXITED(procs[i].exit_status) ? WEXITSTATUS(procs[i].exit_status) : -1);
+            collector_add_failure(c, procs[i].command, error);
         }
+        source_proc_free(&procs[i]);
     }
+}
 
-    free(line);
+int main(int argc, char** argv) {
+    cli_options_t options;
+    parse_arguments(argc, argv, &options);
 
-    if (report.num_sources == 0) {
-        if (!options.quiet) {
-            fprintf(stderr, "Error: No valid sources found on stdin\n");
-            fprintf(stderr, "Expected NDJSON input (one JSON object per line)\n");
+    /* Compile the policy once; each attribute is then one table lookup */
+    smart_config_t config;
+    if (options.config_path != NULL) {
+        if (config_load(options.config_path, &config) != 0) {
+            if (!options.quiet) {
+                fprintf(stderr, "Error: Failed to load config from %s\n", options.config_path);
+            }
+            return 3;
         }
-        return 3;
+        smart_set_config(&config);
     }
 
-    /* Aggregate results */
-    aggregate_sources(&report);
+    collector_t c;
+    if (collector_init(&c, &options) != 0) {
+        fprintf(stderr, "Error: Out of memory\n");
+        collector_free(&c);
+        return 3;
+    }
+    if (options.history_path != NULL) {
+        if (jm_history_open(&c.history, options.history_path, 1, 0, options.history_drives) != 0) {
+            fprintf(stderr, "Error: Cannot open history file %s\n", options.history_path);
+            collector_free(&c);
+            return 3;
+        }
+        c.has_history = 1;
+    }
 
-    /* Output based on mode */
-    if (!options.quiet) {
-        if (options.output_json) {
-            output_json(&report);
+    if (options.num_commands > 0) {
+        collect_commands(&c);
+    } else {
+        /* Mapped when stdin is a file, so lines are parsed where they lie */
+        input_reader_t in;
+        input_reader_open(&in, stdin);
+        if (options.threads > 1) {
+            collect_stdin_threaded(&c, &in);
         } else {
-            output_summary(&report);
+            collect_stdin(&c, &in);
+        }
+        input_reader_free(&in);
+    }
+
+    int ret;
+    if (c.totals.num_sources == 0) {
+        if (!options.quiet) {
+            fprintf(stderr, "Error: No valid sources found on stdin\n");
+            fprintf(stderr, "Expected NDJSON input (one JSON object per line)\n");
+        }
+        ret = 3;
+    } else {
+        /* Exit code based on overall health */
+        ret = (c.totals.overall_status == DISK_STATUS_PASSED) ? 0 : 1;
+
+        /* Output based on mode (streaming already wrote the sources) */
+        if (!options.quiet) {
+            if (options.changed_since) {
+                if (c.changes == 0) {
+                    jm_history_write_heartbeat(stdout, NULL, c.now, c.totals.total_disks,
+                                               c.totals.overall_status, options.output_json);
+                }
+            } else if (options.stream && options.output_json) {
+                output_json_summary(&c.json, &c.totals);
+                json_writer_flush(&c.json, stdout);
+            } else if (options.stream) {
+                printf("  (%d source%s)\n", c.totals.num_sources, c.totals.num_sources == 1 ? "" : "s");
+                output_summary_totals(&c.totals);
+            } else {
+                c.report->totals = c.totals;
+                memcpy(c.report->timestamp, c.timestamp, sizeof(c.timestamp));
+                if (options.verbose) {
+                    fprintf(stderr, "Stored %u disks of %u sources in %zu KB\n", c.report->table.num_disks,
+                            c.report->table.num_sources, disk_table_bytes(&c.report->table) / 1024);
+                }
+                if (options.has_query) {
+                    fleet_query_result_t result;
+                    if (fleet_query_run(&options.query, &c.report->table, &result) != 0) {
+                        fprintf(stderr, "Error: Out of memory running the query\n");
+                        ret = 3;
+                    } else if (options.output_json) {
+                        output_query_json(&options, c.report, &result);
+                    } else {
+                        output_query(&options, c.report, &result);
+                    }
+                    fleet_query_result_free(&result);
+                } else if (options.output_json) {
+                    output_json(c.report, c.current);
+                } else {
+                    output_summary(c.report, c.current);
+                }
+            }
         }
     }
 
-    /* Exit code based on overall health */
-    return (report.overall_status == DISK_STATUS_PASSED) ? 0 : 1;
+    collector_free(&c);
+    if (options.config_path != NULL) {
+        config_free(&config);
+    }
+    return ret;
 }
@@ -0,0 +1,349 @@
+/*
+ * disk_table.c - Columnar store of the disks of many sources
+ *
+ * Copyright (C) 2026 Jamie Treworgy
+ * SPDX-License-Identifier: MIT
+ */
+
+#define JSMN_HEADER  /* jsmn declarations only (via health_source.h) */
+#include "disk_table.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INITIAL_CAPACITY 64
+
+/* Helper: Grow one column to capacity entries (contents kept; unchanged on failure) */
+static int grow_column(void* column_ptr, size_t elem_size, uint32_t capacity) {
+    void** column = column_ptr;
+    void* grown = realloc(*column, (size_t)capacity * elem_size);
+    if (grown == NULL) {
+        return -1;
+    }
+    *column = grown;
+    return 0;
+}
+
+/* Helper: Capacity for at least need entries, doubling from current */
+static uint32_t next_capacity(uint32_t current, uint32_t need) {
+    uint32_t capacity = current > 0 ? current : INITIAL_CAPACITY;
+    while (capacity < need) {
+        capacity *= 2;
+    }
+    return capacity;
+}
+
+/* ---- String pool ---- */
+
+static uint32_t hash_string(const char* s) {
+    uint32_t hash = 2166136261u;  /* FNV-1a */
+    for (; *s != '\0'; s++) {
+        hash = (hash ^ (uint8_t)*s) * 16777619u;
+    }
+    return hash;
+}
+
+static int pool_rehash(string_pool_t* pool, uint32_t num_buckets) {
+    uint32_t* buckets = calloc(num_buckets, sizeof(uint32_t));
+    if (buckets == NULL) {
+        return -1;
+    }
+    for (uint32_t id = 0; id < pool->count; id++) {
+        uint32_t b = hash_string(pool->data + pool->offsets[id]) & (num_buckets - 1);
+        while (buckets[b] != 0) {
+            b = (b + 1) & (num_buckets - 1);
+        }
+        buckets[b] = id + 1;
+    }
+    free(pool->buckets);
+    pool->buckets = buckets;
+    pool->num_buckets = num_buckets;
+    return 0;
+}
+
+/* Helper: Id of s, adding it if new; -1 if out of memory */
+static int64_t pool_intern(string_pool_t* pool, const char* s) {
+    uint32_t hash = hash_string(s);
+    uint32_t b = hash & (pool->num_buckets - 1);
+
+    while (pool->buckets[b] != 0) {
+        uint32_t id = pool->buckets[b] - 1;
+        if (strcmp(pool->data + pool->offsets[id], s) == 0) {
+            return id;
+        }
+        b = (b + 1) & (pool->num_buckets - 1);
+    }
+
+    size_t n = strlen(s) + 1;
+    if (pool->len + n > UINT32_MAX) {
+        return -1;
+    }
+    if (pool->len + n > pool->capacity) {
+        size_t capacity = pool->capacity * 2;
+        while (capacity < pool->len + n) capacity *= 2;
+        char* data = realloc(pool->data, capacity);
+        if (data == NULL) return -1;
+        pool->data = data;
+        pool->capacity = capacity;
+    }
+    if (pool->count == pool->offsets_capacity) {
+        uint32_t capacity = next_capacity(pool->offsets_capacity, pool->count + 1);
+        if (grow_column(&pool->offsets, sizeof(uint32_t), capacity) != 0) return -1;
+        pool->offsets_capacity = capacity;
+    }
+
+    uint32_t id = pool->count;
+    memcpy(pool->data + pool->len, s, n);
+    pool->offsets[id] = (uint32_t)pool->len;
+    pool->len += n;
+    pool->count++;
+
+    if ((uint64_t)pool->count * 2 > pool->num_buckets) {
+        if (pool_rehash(pool, pool->num_buckets * 2) != 0) {
+            pool->count--;  /* Not findable: drop it again */
+            pool->len -= n;
+            return -1;
+        }
+    } else {
+        pool->buckets[b] = id + 1;
+    }
+    return id;
+}
+
+/* ---- Table ---- */
+
+int disk_table_init(disk_table_t* table) {
+    memset(table, 0, sizeof(disk_table_t));
+
+    string_pool_t* pool = &table->strings;
+    pool->capacity = 4096;
+    pool->data = malloc(pool->capacity);
+    pool->buckets = calloc(INITIAL_CAPACITY, sizeof(uint32_t));
+    pool->num_buckets = INITIAL_CAPACITY;
+    table->attr_start = malloc(sizeof(uint32_t));
+    if (pool->data == NULL || pool->buckets == NULL || table->attr_start == NULL ||
+        pool_intern(pool, "") != DISK_TABLE_EMPTY) {
+        disk_table_free(table);
+        return -1;
+    }
+    table->attr_start[0] = 0;
+    return 0;
+}
+
+void disk_table_free(disk_table_t* table) {
+    free(table->strings.data);
+    free(table->strings.offsets);
+    free(table->strings.buckets);
+    free(table->sources);
+    free(table->timings);
+    free(table->disk_source);
+    free(table->model);
+    free(table->serial);
+    free(table->firmware);
+    free(table->size_mb);
+    free(table->disk_number);
+    free(table->status);
+    free(table->attr_start);
+    free(table->attr_disk);
+    free(table->attr_id);
+    free(table->attr_value);
+    free(table->attr_worst);
+    free(table->attr_thresh);
+    free(table->attr_status);
+    free(table->attr_raw);
+    memset(table, 0, sizeof(disk_table_t));
+}
+
+/* Helper: Room for `disks` more disks and `attrs` more attributes */
+static int reserve(disk_table_t* t, uint32_t disks, uint32_t attrs) {
+    if (t->num_disks + disks > t->disks_capacity) {
+        uint32_t capacity = next_capacity(t->disks_capacity, t->num_disks + disks);
+        if (grow_column(&t->disk_source, sizeof(uint32_t), capacity) != 0 ||
+            grow_column(&t->model, sizeof(uint32_t), capacity) != 0 ||
+            grow_column(&t->serial, sizeof(uint32_t), capacity) != 0 ||
+            grow_column(&t->firmware, sizeof(uint32_t), capacity) != 0 ||
+            grow_column(&t->size_mb, sizeof(uint64_t), capacity) != 0 ||
+            grow_column(&t->disk_number, sizeof(int8_t), capacity) != 0 ||
+            grow_column(&t->status, sizeof(uint8_t), capacity) != 0 ||
+            grow_column(&t->attr_start, sizeof(uint32_t), capacity + 1) != 0) {
+            return -1;
+        }
+        t->disks_capacity = capacity;
+    }
+    if (t->num_attrs + attrs > t->attrs_capacity) {
+        uint32_t capacity = next_capacity(t->attrs_capacity, t->num_attrs + attrs);
+        if (grow_column(&t->attr_disk, sizeof(uint32_t), capacity) != 0 ||
+            grow_column(&t->attr_id, sizeof(uint8_t), capacity) != 0 ||
+            grow_column(&t->attr_value, sizeof(uint8_t), capacity) != 0 ||
+            grow_column(&t->attr_worst, sizeof(uint8_t), capacity) != 0 ||
+            grow_column(&t->attr_thresh, sizeof(uint8_t), capacity) != 0 ||
+            grow_column(&t->attr_status, sizeof(uint8_t), capacity) != 0 ||
+            grow_column(&t->attr_raw, sizeof(uint64_t), capacity) != 0) {
+            return -1;
+        }
+        t->attrs_capacity = capacity;
+    }
+    return 0;
+}
+
+int disk_table_add_source(disk_table_t* t, const source_result_t* src) {
+    int num_disks = src->num_disks;
+    uint32_t attrs = 0;
+
+    if (num_disks < 0) num_disks = 0;
+    if (num_disks > 32) num_disks = 32;
+    for (int i = 0; i < num_disks; i++) {
+        attrs += (uint32_t)src->disks[i].num_attributes;
+    }
+
+    /* Reserve everything first, so a failure adds nothing */
+    if (reserve(t, (uint32_t)num_disks, attrs) != 0) {
+        return -1;
+    }
+    if (t->num_sources == t->sources_capacity) {
+        uint32_t capacity = next_capacity(t->sources_capacity, t->num_sources + 1);
+        if (grow_column(&t->sources, sizeof(disk_table_source_t), capacity) != 0) return -1;
+        t->sources_capacity = capacity;
+    }
+    if (src->has_timings && t->num_timings == t->timings_capacity) {
+        uint32_t capacity = next_capacity(t->timings_capacity, t->num_timings + 1);
+        if (grow_column(&t->timings, sizeof(jm_timings_t), capacity) != 0) return -1;
+        t->timings_capacity = capacity;
+    }
+
+    int64_t backend = pool_intern(&t->strings, src->backend);
+    int64_t device = pool_intern(&t->strings, src->device);
+    int64_t controller_model = pool_intern(&t->strings, src->controller_model);
+    int64_t controller_type = pool_intern(&t->strings, src->controller_type);
+    int64_t error = pool_intern(&t->strings, src->error);
+    if (backend < 0 || device < 0 || controller_model < 0 || controller_type < 0 || error < 0) {
+        return -1;
+    }
+
+    /* Interned ids of every disk before anything is appended */
+    uint32_t ids[32][3];
+    for (int i = 0; i < num_disks; i++) {
+        int64_t model = pool_intern(&t->strings, src->disks[i].disk_name);
+        int64_t serial = pool_intern(&t->strings, src->disks[i].serial_number);
+        int64_t firmware = pool_intern(&t->strings, src->disks[i].firmware_rev);
+        if (model < 0 || serial < 0 || firmware < 0) {
+            return -1;
+        }
+        ids[i][0] = (uint32_t)model;
+        ids[i][1] = (uint32_t)serial;
+        ids[i][2] = (uint32_t)firmware;
+    }
+
+    uint32_t index = t->num_sources++;
+    disk_table_source_t* s = &t->sources[index];
+    s->backend = (uint32_t)backend;
+    s->device = (uint32_t)device;
+    s->controller_model = (uint32_t)controller_model;
+    s->controller_type = (uint32_t)controller_type;
+    s->error = (uint32_t)error;
+    s->first_disk = t->num_disks;
+    s->num_disks = num_disks;
+    s->overall_status = src->overall_status;
+    s->timings = -1;
+    if (src->has_timings) {
+        s->timings = (int32_t)t->num_timings;
+        t->timings[t->num_timings++] = src->timings;
+    }
+
+    for (int i = 0; i < num_disks; i++) {
+        const disk_smart_data_t* disk = &src->disks[i];
+        uint32_t d = t->num_disks++;
+
+        t->disk_source[d] = index;
+        t->model[d] = ids[i][0];
+        t->serial[d] = ids[i][1];
+        t->firmware[d] = ids[i][2];
+        t->size_mb[d] = disk->size_mb;
+        t->disk_number[d] = (disk->disk_number >= 0 && disk->disk_number <= INT8_MAX)
+                            ? (int8_t)disk->disk_number : -1;
+        t->status[d] = (uint8_t)disk->overall_status;
+
+        for (int j = 0; j < disk->num_attributes; j++) {
+            const parsed_smart_attribute_t* attr = &disk->attributes[j];
+            uint32_t a = t->num_attrs++;
+            t->attr_disk[a] = d;
+            t->attr_id[a] = attr->id;
+            t->attr_value[a] = attr->current_value;
+            t->attr_worst[a] = attr->worst_value;
+            t->attr_thresh[a] = attr->threshold;
+            t->attr_status[a] = (uint8_t)attr->status;
+            t->attr_raw[a] = attr->raw_value;
+        }
+        t->attr_start[d + 1] = t->num_attrs;
+    }
+    return 0;
+}
+
+void disk_table_get_source(const disk_table_t* t, uint32_t index, source_result_t* out) {
+    const disk_table_source_t* s = &t->sources[index];
+
+    snprintf(out->backend, sizeof(out->backend), "%s", disk_table_string(t, s->backend));
+    snprintf(out->device, sizeof(out->device), "%s", disk_table_string(t, s->device));
+    snprintf(out->controller_model, sizeof(out->controller_model), "%s",
+             disk_table_string(t, s->controller_model));
+    snprintf(out->controller_type, sizeof(out->controller_type), "%s",
+             disk_table_string(t, s->controller_type));
+    snprintf(out->error, sizeof(out->error), "%s", disk_table_string(t, s->error));
+    out->num_disks = s->num_disks;
+    out->overall_status = s->overall_status;
+    out->parse_error = 0;
+    out->has_timings = s->timings >= 0;
+    if (out->has_timings) {
+        out->timings = t->timings[s->timings];
+    }
+}
+
+int64_t disk_table_find_string(const disk_table_t* t, const char* s) {
+    const string_pool_t* pool = &t->strings;
+    uint32_t b = hash_string(s) & (pool->num_buckets - 1);
+
+    while (pool->buckets[b] != 0) {
+        uint32_t id = pool->buckets[b] - 1;
+        if (strcmp(pool->data + pool->offsets[id], s) == 0) {
+            return id;
+        }
+        b = (b + 1) & (pool->num_buckets - 1);
+    }
+    return -1;
+}
+
+int disk_table_find_attr(const disk_table_t* t, uint32_t disk, uint8_t id) {
+    for (uint32_t a = t->attr_start[disk]; a < t->attr_start[disk + 1]; a++) {
+        if (t->attr_id[a] == id) {
+            return (int)a;
+        }
+    }
+    return -1;
+}
+
+uint32_t disk_table_scan_raw(const disk_table_t* t, uint8_t id, uint64_t min_raw,
+                             uint32_t* disks, uint32_t max_disks) {
+    uint32_t matches = 0;
+
+    for (uint32_t a = 0; a < t->num_attrs; a++) {
+        if (t->attr_id[a] == id && t->attr_raw[a] > min_raw) {
+            if (disks != NULL && matches < max_disks) {
+                disks[matches] = t->attr_disk[a];
+            }
+            matches++;
+        }
+    }
+    return matches;
+}
+
+size_t disk_table_bytes(const disk_table_t* t) {
+    const size_t per_disk = 5 * sizeof(uint32_t) + sizeof(uint64_t) + sizeof(int8_t) + sizeof(uint8_t);
+    const size_t per_attr = sizeof(uint32_t) + 5 * sizeof(uint8_t) + sizeof(uint64_t);
+
+    return t->strings.capacity + (size_t)t->strings.offsets_capacity * sizeof(uint32_t) +
+           (size_t)t->strings.num_buckets * sizeof(uint32_t) +
+           (size_t)t->sources_capacity * sizeof(disk_table_source_t) +
+           (size_t)t->timings_capacity * sizeof(jm_timings_t) +
+           (size_t)t->disks_capacity * per_disk + sizeof(uint32_t) +
+           (size_t)t->attrs_capacity * per_attr;
+}
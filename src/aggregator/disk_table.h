@@ -0,0 +1,152 @@
+/*
+ * disk_table.h - Columnar store of the disks of many sources
+ *
+ * Copyright (C) 2026 Jamie Treworgy
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef AGGREGATOR_DISK_TABLE_H
+#define AGGREGATOR_DISK_TABLE_H
+
+#include "health_source.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * A source_result_t holds 32 full disk_smart_data_t (about 40 KB) whatever
+ * it reports; a fleet-wide report keeps every disk of every source. The
+ * table stores them as columns instead: one entry per disk in the disk
+ * columns, and the attributes of all disks back to back in the attribute
+ * columns (disk d owns attr_start[d] .. attr_start[d + 1] - 1). Strings are
+ * interned, so a model or firmware shared by a thousand drives is stored
+ * once. Attribute names are not stored: get_attribute_definition resolves
+ * them from the ID.
+ */
+
+/* No string: id of "" (every table interns it first) */
+#define DISK_TABLE_EMPTY 0
+
+/* Interned NUL-terminated strings, addressed by id */
+typedef struct {
+    char* data;
+    size_t len;
+    size_t capacity;
+    uint32_t* offsets;                  /* Start of each string in data, by id */
+    uint32_t count;
+    uint32_t offsets_capacity;
+    uint32_t* buckets;                  /* Open addressing, id + 1 (0 = empty) */
+    uint32_t num_buckets;               /* Power of two, kept at most half full */
+} string_pool_t;
+
+/* One source: its header fields, without the disks */
+typedef struct {
+    uint32_t backend;                   /* String ids */
+    uint32_t device;
+    uint32_t controller_model;
+    uint32_t controller_type;
+    uint32_t error;                     /* DISK_TABLE_EMPTY unless the source failed */
+    uint32_t first_disk;                /* Its disks are first_disk .. first_disk + num_disks - 1 */
+    int num_disks;
+    disk_health_status_t overall_status;
+    int32_t timings;                    /* Index into timings, or -1 */
+} disk_table_source_t;
+
+typedef struct {
+    string_pool_t strings;
+
+    disk_table_source_t* sources;
+    uint32_t num_sources;
+    uint32_t sources_capacity;
+    jm_timings_t* timings;              /* Only sources run with --timings */
+    uint32_t num_timings;
+    uint32_t timings_capacity;
+
+    /* Disk columns */
+    uint32_t* disk_source;              /* Index into sources */
+    uint32_t* model;                    /* String ids */
+    uint32_t* serial;
+    uint32_t* firmware;
+    uint64_t* size_mb;
+    int8_t* disk_number;                /* Slot in its enclosure (-1 = none) */
+    uint8_t* status;                    /* disk_health_status_t */
+    uint32_t* attr_start;               /* num_disks + 1 entries */
+    uint32_t num_disks;
+    uint32_t disks_capacity;
+
+    /* Attribute columns */
+    uint32_t* attr_disk;                /* Owning disk (for scans) */
+    uint8_t* attr_id;
+    uint8_t* attr_value;
+    uint8_t* attr_worst;
+    uint8_t* attr_thresh;
+    uint8_t* attr_status;               /* attribute_health_status_t */
+    uint64_t* attr_raw;
+    uint32_t num_attrs;
+    uint32_t attrs_capacity;
+} disk_table_t;
+
+/**
+ * Initialize an empty table
+ * @return 0 on success, -1 if out of memory
+ */
+int disk_table_init(disk_table_t* table);
+
+/**
+ * Release a table's storage
+ */
+void disk_table_free(disk_table_t* table);
+
+/**
+ * Append a source and its disks
+ * @param table Table
+ * @param src Parsed (and possibly re-assessed) source
+ * @return 0 on success, -1 if out of memory (the source is not added)
+ */
+int disk_table_add_source(disk_table_t* table, const source_result_t* src);
+
+/**
+ * Rebuild a source's header fields (everything but the disks)
+ * Lets code written against source_result_t report a stored source.
+ * @param table Table
+ * @param index Source index
+ * @param out Output; disks are not filled in and num_disks is the count
+ */
+void disk_table_get_source(const disk_table_t* table, uint32_t index, source_result_t* out);
+
+/**
+ * Interned string by id
+ */
+static inline const char* disk_table_string(const disk_table_t* table, uint32_t id) {
+    return table->strings.data + table->strings.offsets[id];
+}
+
+/**
+ * Id of a string already in the table
+ * @return Id, or -1 if no stored source uses the string
+ */
+int64_t disk_table_find_string(const disk_table_t* table, const char* s);
+
+/**
+ * Attribute index of one disk's attribute, or -1 if the disk lacks it
+ */
+int disk_table_find_attr(const disk_table_t* table, uint32_t disk, uint8_t id);
+
+/**
+ * Disks whose attribute `id` has a raw value above `min_raw`
+ * One linear pass over the attribute ID and raw columns.
+ * @param table Table
+ * @param id Attribute ID (e.g. 0xC5 for pending sectors)
+ * @param min_raw Raw values greater than this match
+ * @param disks Output disk indexes, in table order (may be NULL to count only)
+ * @param max_disks Capacity of disks
+ * @return Number of matching disks (may exceed max_disks)
+ */
+uint32_t disk_table_scan_raw(const disk_table_t* table, uint8_t id, uint64_t min_raw,
+                             uint32_t* disks, uint32_t max_disks);
+
+/**
+ * Bytes of storage the table holds (allocated capacity)
+ */
+size_t disk_table_bytes(const disk_table_t* table);
+
+#endif /* AGGREGATOR_DISK_TABLE_H */
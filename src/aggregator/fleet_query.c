@@ -0,0 +1,495 @@
+/*
+ * fleet_query.c - Filter, group and rank the disks of a disk-health report
+ *
+ * Copyright (C) 2026 Jamie Treworgy
+ * SPDX-License-Identifier: MIT
+ */
+
+#define JSMN_HEADER  /* jsmn declarations only (via health_source.h) */
+#include "fleet_query.h"
+#include "../smart_parser.h"
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+/* Named fields (attr[ID].FIELD is parsed separately) */
+static const struct {
+    const char* name;
+    query_field_t field;
+} g_fields[] = {
+    {"temperature", QUERY_FIELD_TEMPERATURE},
+    {"size_mb", QUERY_FIELD_SIZE_MB},
+    {"disk_number", QUERY_FIELD_DISK_NUMBER},
+    {"status", QUERY_FIELD_STATUS},
+    {"model", QUERY_FIELD_MODEL},
+    {"serial", QUERY_FIELD_SERIAL},
+    {"firmware", QUERY_FIELD_FIRMWARE},
+    {"backend", QUERY_FIELD_BACKEND},
+    {"controller", QUERY_FIELD_CONTROLLER},
+    {"device", QUERY_FIELD_DEVICE},
+};
+
+static int is_string_field(query_field_t field) {
+    return field >= QUERY_FIELD_MODEL;
+}
+
+void fleet_query_init(fleet_query_t* query) {
+    memset(query, 0, sizeof(fleet_query_t));
+    query->by.field = QUERY_FIELD_TEMPERATURE;
+    snprintf(query->by_name, sizeof(query->by_name), "temperature");
+}
+
+/* Helper: Text of [start, end) with surrounding blanks (and quotes) removed */
+static void trim_copy(const char* start, const char* end, char* out, size_t out_size, int unquote) {
+    while (start < end && isspace((unsigned char)*start)) start++;
+    while (end > start && isspace((unsigned char)end[-1])) end--;
+    if (unquote && end - start >= 2 && (*start == '\'' || *start == '"') && end[-1] == *start) {
+        start++;
+        end--;
+    }
+    size_t len = (size_t)(end - start);
+    if (len >= out_size) len = out_size - 1;
+    memcpy(out, start, len);
+    out[len] = '\0';
+}
+
+/* Helper: Attribute ID from a number (0xC5, 197) or a rule name; 0 if unknown */
+static int parse_attr_id(const char* text) {
+    char* end;
+    unsigned long id = strtoul(text, &end, 0);
+    if (end != text && *end == '\0') {
+        return (id >= 1 && id <= 255) ? (int)id : 0;
+    }
+    for (int i = 1; i <= 255; i++) {
+        health_rule_t scratch;
+        const health_rule_t* rule = smart_lookup_rule((uint8_t)i, &scratch);
+        if (rule->name != NULL && strcasecmp(rule->name, text) == 0) {
+            return i;
+        }
+    }
+    return 0;
+}
+
+/* Helper: Field name into a term (field and attr_id) */
+static int parse_field(const char* name, query_term_t* term) {
+    if (strncmp(name, "attr[", 5) == 0) {
+        const char* close = strchr(name, ']');
+        char id_text[48];
+        if (close == NULL || close[1] != '.' || (size_t)(close - name - 5) >= sizeof(id_text)) {
+            return -1;
+        }
+        trim_copy(name + 5, close, id_text, sizeof(id_text), 0);
+        int id = parse_attr_id(id_text);
+        if (id == 0) {
+            return -1;
+        }
+        term->attr_id = (uint8_t)id;
+
+        const char* sub = close + 2;
+        if (strcmp(sub, "raw") == 0) term->field = QUERY_FIELD_ATTR_RAW;
+        else if (strcmp(sub, "value") == 0) term->field = QUERY_FIELD_ATTR_VALUE;
+        else if (strcmp(sub, "worst") == 0) term->field = QUERY_FIELD_ATTR_WORST;
+        else if (strcmp(sub, "thresh") == 0) term->field = QUERY_FIELD_ATTR_THRESH;
+        else return -1;
+        return 0;
+    }
+    for (size_t i = 0; i < sizeof(g_fields) / sizeof(g_fields[0]); i++) {
+        if (strcmp(name, g_fields[i].name) == 0) {
+            term->field = g_fields[i].field;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/* Helper: One TERM of a clause */
+static int parse_term(const char* start, const char* end, query_term_t* term,
+                      char* error, size_t error_size) {
+    char text[128], lhs[64];
+    trim_copy(start, end, text, sizeof(text), 0);
+
+    char* op = strpbrk(text, "<>=!~");
+    if (op == NULL) {
+        snprintf(error, error_size, "'%s' has no operator (> >= < <= == != ~)", text);
+        return -1;
+    }
+    const char* rhs = op + 1;
+    switch (op[0]) {
+        case '>': term->op = (op[1] == '=') ? QUERY_OP_GE : QUERY_OP_GT; break;
+        case '<': term->op = (op[1] == '=') ? QUERY_OP_LE : QUERY_OP_LT; break;
+        case '=': term->op = QUERY_OP_EQ; break;
+        case '~': term->op = QUERY_OP_CONTAINS; break;
+        default:
+            if (op[1] != '=') {
+                snprintf(error, error_size, "'%s': expected !=", text);
+                return -1;
+            }
+            term->op = QUERY_OP_NE;
+            break;
+    }
+    if (op[1] == '=') rhs++;
+
+    trim_copy(text, op, lhs, sizeof(lhs), 0);
+    if (parse_field(lhs, term) != 0) {
+        snprintf(error, error_size, "unknown field '%s'", lhs);
+        return -1;
+    }
+    trim_copy(rhs, rhs + strlen(rhs), term->text, sizeof(term->text), 1);
+    if (term->text[0] == '\0') {
+        snprintf(error, error_size, "'%s' has no value", text);
+        return -1;
+    }
+
+    if (is_string_field(term->field)) {
+        if (term->op != QUERY_OP_EQ && term->op != QUERY_OP_NE && term->op != QUERY_OP_CONTAINS) {
+            snprintf(error, error_size, "'%s': strings compare with ==, != or ~", lhs);
+            return -1;
+        }
+        return 0;
+    }
+    if (term->field == QUERY_FIELD_STATUS) {
+        if (term->op != QUERY_OP_EQ && term->op != QUERY_OP_NE) {
+            snprintf(error, error_size, "status compares with == or !=");
+            return -1;
+        }
+        if (strcmp(term->text, "healthy") == 0 || strcmp(term->text, "passed") == 0) {
+            term->number = DISK_STATUS_PASSED;
+        } else if (strcmp(term->text, "failed") == 0) {
+            term->number = DISK_STATUS_FAILED;
+        } else if (strcmp(term->text, "error") == 0) {
+            term->number = DISK_STATUS_ERROR;
+        } else {
+            snprintf(error, error_size, "status is healthy, failed or error, not '%s'", term->text);
+            return -1;
+        }
+        return 0;
+    }
+
+    char* num_end;
+    errno = 0;
+    term->number = strtoull(term->text, &num_end, 0);
+    if (term->op == QUERY_OP_CONTAINS || *num_end != '\0' || term->text[0] == '-') {
+        snprintf(error, error_size, "'%s' needs a number and a numeric operator", text);
+        return -1;
+    }
+    if (errno == ERANGE) {
+        snprintf(error, error_size, "'%s' is out of range (at most %llu)", term->text, ULLONG_MAX);
+        return -1;
+    }
+    return 0;
+}
+
+int fleet_query_add_where(fleet_query_t* query, const char* clause, char* error, size_t error_size) {
+    const char* start = clause;
+
+    for (;;) {
+        const char* end = strstr(start, "&&");
+        if (end == NULL) end = start + strlen(start);
+
+        if (query->num_terms >= FLEET_QUERY_MAX_TERMS) {
+            snprintf(error, error_size, "at most %d terms", FLEET_QUERY_MAX_TERMS);
+            return -1;
+        }
+        if (parse_term(start, end, &query->terms[query->num_terms], error, error_size) != 0) {
+            return -1;
+        }
+        query->num_terms++;
+
+        if (*end == '\0') break;
+        start = end + 2;
+    }
+
+    size_t used = strlen(query->where);
+    snprintf(query->where + used, sizeof(query->where) - used, "%s%s", used > 0 ? " && " : "", clause);
+    return 0;
+}
+
+int fleet_query_set_group(fleet_query_t* query, const char* key) {
+    if (strcmp(key, "model") == 0) query->group_by = QUERY_GROUP_MODEL;
+    else if (strcmp(key, "firmware") == 0) query->group_by = QUERY_GROUP_FIRMWARE;
+    else if (strcmp(key, "backend") == 0) query->group_by = QUERY_GROUP_BACKEND;
+    else if (strcmp(key, "controller") == 0) query->group_by = QUERY_GROUP_CONTROLLER;
+    else return -1;
+    return 0;
+}
+
+int fleet_query_set_by(fleet_query_t* query, const char* field) {
+    query_term_t by;
+    memset(&by, 0, sizeof(by));
+    if (parse_field(field, &by) != 0 || is_string_field(by.field) || by.field == QUERY_FIELD_STATUS) {
+        return -1;
+    }
+    query->by = by;
+    snprintf(query->by_name, sizeof(query->by_name), "%s", field);
+    return 0;
+}
+
+int fleet_query_temperature(const disk_table_t* table, uint32_t disk) {
+    for (uint32_t a = table->attr_start[disk]; a < table->attr_start[disk + 1]; a++) {
+        int temp = smart_attribute_temperature(table->attr_id[a], table->attr_raw[a]);
+        if (temp >= 0) {
+            return temp;
+        }
+    }
+    return -1;
+}
+
+/* Helper: Numeric field of a disk; 0 if the disk lacks it */
+static int disk_number_of(const disk_table_t* t, uint32_t d, const query_term_t* term, uint64_t* out) {
+    switch (term->field) {
+        case QUERY_FIELD_TEMPERATURE: {
+            int temp = fleet_query_temperature(t, d);
+            *out = (uint64_t)temp;
+            return temp >= 0;
+        }
+        case QUERY_FIELD_SIZE_MB:
+            *out = t->size_mb[d];
+            return 1;
+        case QUERY_FIELD_DISK_NUMBER:
+            *out = (uint64_t)t->disk_number[d];
+            return t->disk_number[d] >= 0;
+        case QUERY_FIELD_STATUS:
+            *out = t->status[d];
+            return 1;
+        default:
+            break;
+    }
+
+    int a = disk_table_find_attr(t, d, term->attr_id);
+    if (a < 0) {
+        return 0;
+    }
+    switch (term->field) {
+        case QUERY_FIELD_ATTR_RAW: *out = t->attr_raw[a]; break;
+        case QUERY_FIELD_ATTR_VALUE: *out = t->attr_value[a]; break;
+        case QUERY_FIELD_ATTR_WORST: *out = t->attr_worst[a]; break;
+        default: *out = t->attr_thresh[a]; break;
+    }
+    return 1;
+}
+
+/* Helper: String id of a disk's string field */
+static uint32_t disk_string_of(const disk_table_t* t, uint32_t d, query_field_t field) {
+    const disk_table_source_t* src = &t->sources[t->disk_source[d]];
+    switch (field) {
+        case QUERY_FIELD_MODEL: return t->model[d];
+        case QUERY_FIELD_SERIAL: return t->serial[d];
+        case QUERY_FIELD_FIRMWARE: return t->firmware[d];
+        case QUERY_FIELD_BACKEND: return src->backend;
+        case QUERY_FIELD_CONTROLLER: return src->controller_model;
+        default: return src->device;
+    }
+}
+
+/* A term bound to one table: string operands become ids, ~ a per-string match map */
+typedef struct {
+    const query_term_t* term;
+    int64_t id;                         /* ==, != (-1: the string does not occur) */
+    uint8_t* contains;                  /* ~: by string id */
+} bound_term_t;
+
+static int compare(uint64_t value, query_op_t op, uint64_t operand) {
+    switch (op) {
+        case QUERY_OP_GT: return value > operand;
+        case QUERY_OP_GE: return value >= operand;
+        case QUERY_OP_LT: return value < operand;
+        case QUERY_OP_LE: return value <= operand;
+        case QUERY_OP_EQ: return value == operand;
+        default: return value != operand;
+    }
+}
+
+static int term_matches(const disk_table_t* t, uint32_t d, const bound_term_t* b) {
+    const query_term_t* term = b->term;
+
+    if (is_string_field(term->field)) {
+        uint32_t id = disk_string_of(t, d, term->field);
+        switch (term->op) {
+            case QUERY_OP_CONTAINS: return b->contains[id];
+            case QUERY_OP_EQ: return b->id == (int64_t)id;
+            default: return b->id != (int64_t)id;
+        }
+    }
+
+    uint64_t value;
+    return disk_number_of(t, d, term, &value) && compare(value, term->op, term->number);
+}
+
+/* Min-heap on (value, later disk first), so the root is the weakest of the top N */
+static int weaker(const query_match_t* a, const query_match_t* b) {
+    return a->value < b->value || (a->value == b->value && a->disk > b->disk);
+}
+
+static void heap_sift_down(query_match_t* heap, uint32_t n, uint32_t i) {
+    for (;;) {
+        uint32_t least = i, l = 2 * i + 1, r = l + 1;
+        if (l < n && weaker(&heap[l], &heap[least])) least = l;
+        if (r < n && weaker(&heap[r], &heap[least])) least = r;
+        if (least == i) return;
+        query_match_t tmp = heap[i];
+        heap[i] = heap[least];
+        heap[least] = tmp;
+        i = least;
+    }
+}
+
+static void heap_push(query_match_t* heap, uint32_t* n, query_match_t m) {
+    uint32_t i = (*n)++;
+    heap[i] = m;
+    while (i > 0 && weaker(&heap[i], &heap[(i - 1) / 2])) {
+        query_match_t tmp = heap[i];
+        heap[i] = heap[(i - 1) / 2];
+        heap[(i - 1) / 2] = tmp;
+        i = (i - 1) / 2;
+    }
+}
+
+static int compare_best_first(const void* a, const void* b) {
+    const query_match_t* x = a;
+    const query_match_t* y = b;
+    if (x->value != y->value) return x->value < y->value ? 1 : -1;
+    return x->disk < y->disk ? -1 : (x->disk > y->disk);
+}
+
+static const disk_table_t* g_sort_table;  /* qsort has no context argument */
+
+static int compare_groups(const void* a, const void* b) {
+    const query_group_entry_t* x = a;
+    const query_group_entry_t* y = b;
+    if (x->disks != y->disks) return x->disks < y->disks ? 1 : -1;
+    return strcmp(disk_table_string(g_sort_table, x->key), disk_table_string(g_sort_table, y->key));
+}
+
+/* Helper: Grouping key of a disk */
+static uint32_t group_key(const disk_table_t* t, uint32_t d, query_group_t group_by) {
+    switch (group_by) {
+        case QUERY_GROUP_MODEL: return t->model[d];
+        case QUERY_GROUP_FIRMWARE: return t->firmware[d];
+        case QUERY_GROUP_BACKEND: return t->sources[t->disk_source[d]].backend;
+        default: return t->sources[t->disk_source[d]].controller_model;
+    }
+}
+
+int fleet_query_run(const fleet_query_t* query, const disk_table_t* t, fleet_query_result_t* result) {
+    bound_term_t bound[FLEET_QUERY_MAX_TERMS];
+    int32_t* group_of = NULL;           /* By string id: index into groups, or -1 */
+    uint32_t groups_capacity = 0;
+    int ok = 1;
+
+    memset(result, 0, sizeof(fleet_query_result_t));
+    memset(bound, 0, sizeof(bound));
+
+    /* Bind string operands once; disks are then matched by id */
+    for (int i = 0; i < query->num_terms; i++) {
+        const query_term_t* term = &query->terms[i];
+        bound[i].term = term;
+        if (!is_string_field(term->field)) continue;
+        if (term->op != QUERY_OP_CONTAINS) {
+            bound[i].id = disk_table_find_string(t, term->text);
+            continue;
+        }
+        bound[i].contains = malloc(t->strings.count ? t->strings.count : 1);
+        if (bound[i].contains == NULL) {
+            ok = 0;
+            break;
+        }
+        for (uint32_t id = 0; id < t->strings.count; id++) {
+            bound[i].contains[id] = strstr(disk_table_string(t, id), term->text) != NULL;
+        }
+    }
+
+    uint32_t capacity = 0;
+    if (ok && query->group_by != QUERY_GROUP_NONE) {
+        group_of = malloc(sizeof(int32_t) * (t->strings.count ? t->strings.count : 1));
+        ok = group_of != NULL;
+        for (uint32_t id = 0; ok && id < t->strings.count; id++) group_of[id] = -1;
+    } else if (ok) {
+        capacity = query->top > 0 ? (uint32_t)query->top : t->num_disks;
+        result->matches = malloc(sizeof(query_match_t) * (capacity ? capacity : 1));
+        ok = result->matches != NULL;
+    }
+
+    /* The one pass over the disks */
+    for (uint32_t d = 0; ok && d < t->num_disks; d++) {
+        int match = 1;
+        for (int i = 0; match && i < query->num_terms; i++) {
+            match = term_matches(t, d, &bound[i]);
+        }
+        if (!match) continue;
+        result->matched++;
+
+        if (group_of != NULL) {
+            uint32_t key = group_key(t, d, query->group_by);
+            if (group_of[key] < 0) {
+                if (result->num_groups == groups_capacity) {
+                    groups_capacity = groups_capacity ? groups_capacity * 2 : 64;
+                    query_group_entry_t* grown = realloc(result->groups,
+                                                         sizeof(query_group_entry_t) * groups_capacity);
+                    if (grown == NULL) {
+                        ok = 0;
+                        break;
+                    }
+                    result->groups = grown;
+                }
+                group_of[key] = (int32_t)result->num_groups;
+                query_group_entry_t* g = &result->groups[result->num_groups++];
+                memset(g, 0, sizeof(*g));
+                g->key = key;
+                g->max_temperature = -1;
+            }
+            query_group_entry_t* g = &result->groups[group_of[key]];
+            int temp = fleet_query_temperature(t, d);
+            g->disks++;
+            if (t->status[d] == DISK_STATUS_PASSED) g->healthy++;
+            else g->failed++;
+            if (temp > g->max_temperature) g->max_temperature = temp;
+            continue;
+        }
+
+        query_match_t m = {d, 0};
+        if (query->top > 0) {
+            if (!disk_number_of(t, d, &query->by, &m.value)) {
+                continue;               /* Nothing to rank it by */
+            }
+            if (result->num_matches < capacity) {
+                heap_push(result->matches, &result->num_matches, m);
+            } else if (weaker(&result->matches[0], &m)) {
+                result->matches[0] = m;
+                heap_sift_down(result->matches, result->num_matches, 0);
+            }
+        } else {
+            result->matches[result->num_matches++] = m;
+        }
+    }
+
+    for (int i = 0; i < query->num_terms; i++) {
+        free(bound[i].contains);
+    }
+    free(group_of);
+    if (!ok) {
+        fleet_query_result_free(result);
+        return -1;
+    }
+
+    if (query->top > 0) {
+        qsort(result->matches, result->num_matches, sizeof(query_match_t), compare_best_first);
+    }
+    if (result->num_groups > 1) {
+        g_sort_table = t;
+        qsort(result->groups, result->num_groups, sizeof(query_group_entry_t), compare_groups);
+    }
+    return 0;
+}
+
+void fleet_query_result_free(fleet_query_result_t* result) {
+    free(result->matches);
+    free(result->groups);
+    result->matches = NULL;
+    result->groups = NULL;
+    result->num_matches = 0;
+    result->num_groups = 0;
+}
@@ -0,0 +1,156 @@
+/*
+ * fleet_query.h - Filter, group and rank the disks of a disk-health report
+ *
+ * Copyright (C) 2026 Jamie Treworgy
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef AGGREGATOR_FLEET_QUERY_H
+#define AGGREGATOR_FLEET_QUERY_H
+
+#include "disk_table.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Queries run over a disk_table_t in one pass over its disks. --where
+ * terms are compiled once: attribute names resolve to IDs through the
+ * compiled rule table, and string terms compare interned ids, so a disk is
+ * matched with integer compares only. Temperature is the raw low byte of
+ * the first attribute the active policy checks as a temperature.
+ */
+
+#define FLEET_QUERY_MAX_TERMS 16
+#define FLEET_QUERY_MAX_TOP 10000
+
+/* A disk field a query can test or rank by */
+typedef enum {
+    QUERY_FIELD_TEMPERATURE = 0,        /* °C, if the disk reports one */
+    QUERY_FIELD_SIZE_MB,
+    QUERY_FIELD_DISK_NUMBER,
+    QUERY_FIELD_STATUS,                 /* healthy, failed or error */
+    QUERY_FIELD_ATTR_RAW,               /* attr[ID].raw ...: absent on disks without ID */
+    QUERY_FIELD_ATTR_VALUE,
+    QUERY_FIELD_ATTR_WORST,
+    QUERY_FIELD_ATTR_THRESH,
+    QUERY_FIELD_MODEL,                  /* Strings: ==, != and ~ (contains) */
+    QUERY_FIELD_SERIAL,
+    QUERY_FIELD_FIRMWARE,
+    QUERY_FIELD_BACKEND,
+    QUERY_FIELD_CONTROLLER,
+    QUERY_FIELD_DEVICE
+} query_field_t;
+
+typedef enum {
+    QUERY_OP_GT = 0,
+    QUERY_OP_GE,
+    QUERY_OP_LT,
+    QUERY_OP_LE,
+    QUERY_OP_EQ,
+    QUERY_OP_NE,
+    QUERY_OP_CONTAINS
+} query_op_t;
+
+/* One comparison of a where clause */
+typedef struct {
+    query_field_t field;
+    uint8_t attr_id;                    /* For QUERY_FIELD_ATTR_* */
+    query_op_t op;
+    uint64_t number;                    /* Numeric and status operand */
+    char text[64];                      /* String operand */
+} query_term_t;
+
+typedef enum {
+    QUERY_GROUP_NONE = 0,
+    QUERY_GROUP_MODEL,
+    QUERY_GROUP_FIRMWARE,
+    QUERY_GROUP_BACKEND,
+    QUERY_GROUP_CONTROLLER
+} query_group_t;
+
+/* A compiled query; all terms must match (AND) */
+typedef struct {
+    query_term_t terms[FLEET_QUERY_MAX_TERMS];
+    int num_terms;
+    char where[256];                    /* Source text of all --where clauses, joined with && */
+    query_group_t group_by;
+    int top;                            /* --top N (0 = list every match) */
+    query_term_t by;                    /* --by: field to rank on (operator unused) */
+    char by_name[48];
+} fleet_query_t;
+
+/* One --group-by group */
+typedef struct {
+    uint32_t key;                       /* String id of the group's value */
+    uint32_t disks;
+    uint32_t healthy;
+    uint32_t failed;
+    int max_temperature;                /* -1 if no disk reported one */
+} query_group_entry_t;
+
+/* A matched disk, with its --by value when ranking */
+typedef struct {
+    uint32_t disk;
+    uint64_t value;
+} query_match_t;
+
+typedef struct {
+    uint32_t matched;                   /* Disks that passed --where */
+    query_match_t* matches;             /* Without --group-by: listed disks (best first with --top) */
+    uint32_t num_matches;
+    query_group_entry_t* groups;        /* With --group-by: largest group first */
+    uint32_t num_groups;
+} fleet_query_result_t;
+
+/**
+ * Start an empty query (every disk matches, listed in table order)
+ */
+void fleet_query_init(fleet_query_t* query);
+
+/**
+ * Compile one --where clause: TERM [&& TERM]...
+ * TERM is FIELD OP VALUE with OP one of > >= < <= == != ~. FIELD is
+ * temperature, size_mb, disk_number, status, model, serial, firmware,
+ * backend, controller, device or attr[ID].raw|value|worst|thresh, where
+ * ID is a number (0xC5, 197) or an attribute name (Current_Pending_Sector).
+ * @param query Query (clauses accumulate)
+ * @param clause Clause text
+ * @param error Output: the reason if it does not compile
+ * @param error_size Size of error
+ * @return 0 on success, -1 on a malformed clause
+ */
+int fleet_query_add_where(fleet_query_t* query, const char* clause, char* error, size_t error_size);
+
+/**
+ * Set --group-by: model, firmware, backend or controller
+ * @return 0 on success, -1 for another key
+ */
+int fleet_query_set_group(fleet_query_t* query, const char* key);
+
+/**
+ * Set --by: a numeric field (temperature, size_mb, disk_number or attr[ID].FIELD)
+ * @return 0 on success, -1 for a non-numeric or malformed field
+ */
+int fleet_query_set_by(fleet_query_t* query, const char* field);
+
+/**
+ * Run a query over every disk of a table
+ * @param query Compiled query
+ * @param table Table of the report
+ * @param result Output (release with fleet_query_result_free)
+ * @return 0 on success, -1 if out of memory
+ */
+int fleet_query_run(const fleet_query_t* query, const disk_table_t* table, fleet_query_result_t* result);
+
+/**
+ * Release a query result
+ */
+void fleet_query_result_free(fleet_query_result_t* result);
+
+/**
+ * Temperature of a stored disk
+ * @return °C, or -1 if the disk has no temperature attribute
+ */
+int fleet_query_temperature(const disk_table_t* table, uint32_t disk);
+
+#endif /* AGGREGATOR_FLEET_QUERY_H */
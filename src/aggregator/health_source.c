@@ -0,0 +1,577 @@
+/*
+ * health_source.c - Parse one disk-health NDJSON source line
+ *
+ * Copyright (C) 2026 Jamie Treworgy
+ * SPDX-License-Identifier: MIT
+ */
+
+#define JSMN_STATIC
+#include "../jsmn/jsmn.h"
+#include "health_source.h"
+#include "../parsers/common.h"
+#include "../smart_attributes.h"
+#include "../health_record.h"
+#include <endian.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Keys of a source line and of its nested objects */
+typedef enum {
+    KEY_OTHER = 0,
+    /* Source line */
+    KEY_BACKEND,
+    KEY_DEVICE,
+    KEY_CONTROLLER,
+    KEY_TIMINGS,
+    KEY_DISKS,
+    KEY_ERROR,
+    /* controller */
+    KEY_MODEL,
+    KEY_TYPE,
+    /* disks[] (model shared with controller) */
+    KEY_DISK_NUMBER,
+    KEY_SERIAL,
+    KEY_FIRMWARE,
+    KEY_SIZE_MB,
+    KEY_OVERALL_STATUS,
+    KEY_ATTRIBUTES,
+    /* attributes[] */
+    KEY_ID,
+    KEY_VALUE,
+    KEY_WORST,
+    KEY_THRESH,
+    KEY_RAW,
+    KEY_STATUS
+} source_key_t;
+
+/* Helper: Identify a key by length, then first byte; one table for every
+ * level since the key sets barely overlap */
+static source_key_t classify_key(const char* line, const jsmntok_t* key) {
+    char first = line[key->start];
+
+    switch (key->end - key->start) {
+        case 2:  return JSON_KEY_IS(line, key, "id") ? KEY_ID : KEY_OTHER;
+        case 3:  return JSON_KEY_IS(line, key, "raw") ? KEY_RAW : KEY_OTHER;
+        case 4:  return JSON_KEY_IS(line, key, "type") ? KEY_TYPE : KEY_OTHER;
+        case 5:
+            if (first == 'd') return JSON_KEY_IS(line, key, "disks") ? KEY_DISKS : KEY_OTHER;
+            if (first == 'e') return JSON_KEY_IS(line, key, "error") ? KEY_ERROR : KEY_OTHER;
+            if (first == 'm') return JSON_KEY_IS(line, key, "model") ? KEY_MODEL : KEY_OTHER;
+            if (first == 'v') return JSON_KEY_IS(line, key, "value") ? KEY_VALUE : KEY_OTHER;
+            return JSON_KEY_IS(line, key, "worst") ? KEY_WORST : KEY_OTHER;
+        case 6:
+            if (first == 'd') return JSON_KEY_IS(line, key, "device") ? KEY_DEVICE : KEY_OTHER;
+            if (first == 't') return JSON_KEY_IS(line, key, "thresh") ? KEY_THRESH : KEY_OTHER;
+            if (line[key->start + 1] == 'e') return JSON_KEY_IS(line, key, "serial") ? KEY_SERIAL : KEY_OTHER;
+            return JSON_KEY_IS(line, key, "status") ? KEY_STATUS : KEY_OTHER;
+        case 7:
+            if (first == 'b') return JSON_KEY_IS(line, key, "backend") ? KEY_BACKEND : KEY_OTHER;
+            if (first == 't') return JSON_KEY_IS(line, key, "timings") ? KEY_TIMINGS : KEY_OTHER;
+            return JSON_KEY_IS(line, key, "size_mb") ? KEY_SIZE_MB : KEY_OTHER;
+        case 8:  return JSON_KEY_IS(line, key, "firmware") ? KEY_FIRMWARE : KEY_OTHER;
+        case 10:
+            if (first == 'c') return JSON_KEY_IS(line, key, "controller") ? KEY_CONTROLLER : KEY_OTHER;
+            return JSON_KEY_IS(line, key, "attributes") ? KEY_ATTRIBUTES : KEY_OTHER;
+        case 11: return JSON_KEY_IS(line, key, "disk_number") ? KEY_DISK_NUMBER : KEY_OTHER;
+        case 14: return JSON_KEY_IS(line, key, "overall_status") ? KEY_OVERALL_STATUS : KEY_OTHER;
+        default: return KEY_OTHER;
+    }
+}
+
+/* Helper: Parse {"count": N, "total_us": N, "max_us": N} */
+static void parse_latency(const char* line, jsmntok_t* tokens, int num_tokens, int obj,
+                          jm_latency_t* latency) {
+    int obj_end = tokens[obj].end;
+    for (int m = obj + 1; m + 1 < num_tokens && tokens[m].start < obj_end; m += 2) {
+        uint64_t value = 0;
+        if (json_token_touint64(line, &tokens[m + 1], &value) != 0) continue;
+
+        if (json_token_streq(line, &tokens[m], "count")) {
+            latency->count = (uint32_t)value;
+        } else if (json_token_streq(line, &tokens[m], "total_us")) {
+            latency->total_us = value;
+        } else if (json_token_streq(line, &tokens[m], "max_us")) {
+            latency->max_us = value;
+        }
+    }
+}
+
+/* Helper: Parse the "timings" object written by jm_timings_write_json */
+static void parse_timings(const char* line, jsmntok_t* tokens, int num_tokens, int obj,
+                          jm_timings_t* timings) {
+    int obj_end = tokens[obj].end;
+    int g = obj + 1;
+
+    while (g + 1 < num_tokens && tokens[g].start < obj_end) {
+        int group = g + 1;
+        if (tokens[group].type == JSMN_OBJECT) {
+            int group_end = tokens[group].end;
+            int k = group + 1;
+            while (k + 1 < num_tokens && tokens[k].start < group_end) {
+                jm_latency_t* latency = NULL;
+                if (json_token_streq(line, &tokens[g], "phases")) {
+                    for (int i = 0; i < JM_PHASE_COUNT && !latency; i++) {
+                        if (json_token_streq(line, &tokens[k], jm_phase_name((jm_phase_t)i)))
+                            latency = &timings->phases[i];
+                    }
+                } else if (json_token_streq(line, &tokens[g], "commands")) {
+                    for (int i = 0; i < JM_CMD_TYPE_COUNT && !latency; i++) {
+                        if (json_token_streq(line, &tokens[k], jm_cmd_type_name((jm_cmd_type_t)i)))
+                            latency = &timings->commands[i];
+                    }
+                } else if (json_token_streq(line, &tokens[g], "ioctls")) {
+                    if (json_token_streq(line, &tokens[k], "write")) latency = &timings->ioctl_write;
+                    else if (json_token_streq(line, &tokens[k], "read")) latency = &timings->ioctl_read;
+                }
+
+                if (latency && tokens[k + 1].type == JSMN_OBJECT) {
+                    parse_latency(line, tokens, num_tokens, k + 1, latency);
+                }
+                k = json_token_skip(tokens, num_tokens, k + 1);
+            }
+        }
+        g = json_token_skip(tokens, num_tokens, group);
+    }
+}
+
+/* Helper: Parse one disk's "attributes" array; names and criticality come
+ * from the built-in definitions so they outlive the input line */
+static void parse_attributes(const char* line, jsmntok_t* tokens, int num_tokens, int array,
+                             disk_smart_data_t* disk) {
+    int array_end = tokens[array].end;
+    int k = array + 1;
+
+    while (k < num_tokens && tokens[k].start < array_end &&
+           disk->num_attributes < MAX_SMART_ATTRIBUTES) {
+        if (tokens[k].type != JSMN_OBJECT) {
+            k = json_token_skip(tokens, num_tokens, k);
+            continue;
+        }
+
+        parsed_smart_attribute_t* attr = &disk->attributes[disk->num_attributes];
+        memset(attr, 0, sizeof(parsed_smart_attribute_t));
+
+        int m = k + 1;
+        for (int member = 0; member < tokens[k].size && m + 1 < num_tokens; member++) {
+            jsmntok_t* val = &tokens[m + 1];
+            int value = 0;
+
+            switch (classify_key(line, &tokens[m])) {
+                case KEY_ID:
+                    if (json_token_toint(line, val, &value) == 0) attr->id = (uint8_t)value;
+                    break;
+                case KEY_VALUE:
+                    if (json_token_toint(line, val, &value) == 0) attr->current_value = (uint8_t)value;
+                    break;
+                case KEY_WORST:
+                    if (json_token_toint(line, val, &value) == 0) attr->worst_value = (uint8_t)value;
+                    break;
+                case KEY_THRESH:
+                    if (json_token_toint(line, val, &value) == 0) attr->threshold = (uint8_t)value;
+                    break;
+                case KEY_RAW:
+                    json_token_touint64(line, val, &attr->raw_value);
+                    break;
+                case KEY_STATUS:
+                    if (json_token_streq(line, val, "ok")) attr->status = ATTR_STATUS_PASSED;
+                    else if (json_token_streq(line, val, "failed")) attr->status = ATTR_STATUS_FAILED;
+                    break;
+                default:
+                    break;
+            }
+            m = json_token_skip(tokens, num_tokens, m + 1);
+        }
+
+        if (attr->id != 0) {
+            const smart_attribute_def_t* def = get_attribute_definition(attr->id);
+            attr->name = (def != NULL) ? def->name : "Unknown_Attribute";
+            attr->is_critical = (def != NULL) ? def->is_critical : 0;
+            disk->num_attributes++;
+        }
+        k = json_token_skip(tokens, num_tokens, k);
+    }
+}
+
+/* Helper: Parse the "controller" object */
+static void parse_controller(const char* line, jsmntok_t* tokens, int num_tokens, int obj,
+                             source_result_t* result) {
+    int m = obj + 1;
+    for (int member = 0; member < tokens[obj].size && m + 1 < num_tokens; member++) {
+        switch (classify_key(line, &tokens[m])) {
+            case KEY_MODEL:
+                json_token_tostr(line, &tokens[m + 1], result->controller_model,
+                                 sizeof(result->controller_model));
+                break;
+            case KEY_TYPE:
+                json_token_tostr(line, &tokens[m + 1], result->controller_type,
+                                 sizeof(result->controller_type));
+                break;
+            default:
+                break;
+        }
+        m = json_token_skip(tokens, num_tokens, m + 1);
+    }
+}
+
+/* Helper: Parse one element of the "disks" array */
+static void parse_disk(const char* line, jsmntok_t* tokens, int num_tokens, int obj,
+                       disk_smart_data_t* disk) {
+    memset(disk, 0, sizeof(disk_smart_data_t));
+    disk->is_present = 1;
+
+    int m = obj + 1;
+    for (int member = 0; member < tokens[obj].size && m + 1 < num_tokens; member++) {
+        jsmntok_t* value = &tokens[m + 1];
+
+        switch (classify_key(line, &tokens[m])) {
+            case KEY_DISK_NUMBER:
+                json_token_toint(line, value, &disk->disk_number);
+                break;
+            case KEY_MODEL:
+                json_token_tostr(line, value, disk->disk_name, sizeof(disk->disk_name));
+                break;
+            case KEY_SERIAL:
+                json_token_tostr(line, value, disk->serial_number, sizeof(disk->serial_number));
+                break;
+            case KEY_FIRMWARE:
+                json_token_tostr(line, value, disk->firmware_rev, sizeof(disk->firmware_rev));
+                break;
+            case KEY_SIZE_MB: {
+                uint64_t size = 0;
+                json_token_touint64(line, value, &size);
+                disk->size_mb = size;
+                break;
+            }
+            case KEY_ATTRIBUTES:
+                if (value->type == JSMN_ARRAY) {
+                    parse_attributes(line, tokens, num_tokens, m + 1, disk);
+                }
+                break;
+            case KEY_OVERALL_STATUS: {
+                char status[16];
+                json_token_tostr(line, value, status, sizeof(status));
+                if (strcmp(status, "healthy") == 0) {
+                    disk->overall_status = DISK_STATUS_PASSED;
+                } else if (strcmp(status, "failed") == 0) {
+                    disk->overall_status = DISK_STATUS_FAILED;
+                } else {
+                    disk->overall_status = DISK_STATUS_ERROR;
+                }
+                break;
+            }
+            default:
+                break;
+        }
+        m = json_token_skip(tokens, num_tokens, m + 1);
+    }
+}
+
+/* Helper: Parse the "disks" array (at most 32 disks per source) */
+static void parse_disks(const char* line, jsmntok_t* tokens, int num_tokens, int array,
+                        source_result_t* result) {
+    int k = array + 1;
+    for (int element = 0; element < tokens[array].size && k < num_tokens &&
+                          result->num_disks < 32; element++) {
+        if (tokens[k].type == JSMN_OBJECT) {
+            parse_disk(line, tokens, num_tokens, k, &result->disks[result->num_disks]);
+            result->num_disks++;
+        }
+        k = json_token_skip(tokens, num_tokens, k);
+    }
+}
+
+/* Helper: A source fails if any of its disks failed */
+static void update_source_status(source_result_t* result) {
+    result->overall_status = DISK_STATUS_PASSED;
+    for (int i = 0; i < result->num_disks; i++) {
+        if (result->disks[i].overall_status == DISK_STATUS_FAILED) {
+            result->overall_status = DISK_STATUS_FAILED;
+            break;
+        }
+    }
+}
+
+void health_arena_init(health_arena_t* arena) {
+    arena->tokens = NULL;
+    arena->capacity = 0;
+}
+
+void health_arena_free(health_arena_t* arena) {
+    free(arena->tokens);
+    health_arena_init(arena);
+}
+
+/* Helper: Tokenize into the arena, doubling it until the line fits; jsmn
+ * keeps its position on NOMEM, so each retry resumes where it stopped */
+static int tokenize(const char* line, size_t len, health_arena_t* arena) {
+    jsmn_parser parser;
+    jsmn_init(&parser);
+
+    while (1) {
+        if (arena->tokens != NULL) {
+            int n = jsmn_parse(&parser, line, len, arena->tokens, arena->capacity);
+            if (n != JSMN_ERROR_NOMEM) {
+                return n;
+            }
+        }
+
+        unsigned int capacity = arena->capacity ? arena->capacity * 2 : HEALTH_ARENA_MIN_TOKENS;
+        if (capacity > HEALTH_ARENA_MAX_TOKENS) {
+            return JSMN_ERROR_NOMEM;
+        }
+        jsmntok_t* tokens = realloc(arena->tokens, capacity * sizeof(jsmntok_t));
+        if (tokens == NULL) {
+            return JSMN_ERROR_NOMEM;
+        }
+        arena->tokens = tokens;
+        arena->capacity = capacity;
+    }
+}
+
+/**
+ * Parse one line of disk-health JSON format
+ */
+int parse_disk_health_line(const char* line, source_result_t* result) {
+    health_arena_t arena;
+    health_arena_init(&arena);
+    int ret = parse_disk_health_arena(line, strlen(line), &arena, result);
+    health_arena_free(&arena);
+    return ret;
+}
+
+/* Helper: Copy a NUL-padded record field, which may fill its whole width */
+static void get_string(char* out, size_t size, const char* field, size_t field_size) {
+    size_t n = strnlen(field, field_size);
+    if (n >= size) n = size - 1;
+    memcpy(out, field, n);
+    out[n] = '\0';
+}
+
+static void get_latency(jm_latency_t* out, const health_record_latency_t* latency) {
+    out->count = le32toh(latency->count);
+    out->total_us = le64toh(latency->total_us);
+    out->max_us = le64toh(latency->max_us);
+}
+
+/* Helper: Report a record that can't be decoded */
+static int record_error(source_result_t* result, const char* why) {
+    fprintf(stderr, "Warning: Failed to parse binary record (%s)\n", why);
+    result->parse_error = 1;
+    return -1;
+}
+
+/**
+ * Parse one binary disk-health record (--format=bin)
+ */
+int parse_disk_health_record(const char* data, size_t len, source_result_t* result) {
+    health_record_header_t header;
+    size_t size;
+
+    if (health_record_size(data, len, &size) != 1 || size > len) {
+        return record_error(result, "truncated");
+    }
+    memcpy(&header, data, sizeof(header));
+    if (le16toh(header.version) != HEALTH_RECORD_VERSION) {
+        char why[48];
+        snprintf(why, sizeof(why), "unsupported version %u", le16toh(header.version));
+        return record_error(result, why);
+    }
+    if (header.type != HEALTH_RECORD_SOURCE) {
+        return record_error(result, "not a source record");
+    }
+
+    /* Fields are copied out, so the record needn't be aligned */
+    size_t pos = le16toh(header.header_size);
+    health_record_source_t source;
+    if (pos < sizeof(header)) pos = sizeof(header);
+    if (size - pos < sizeof(source)) {
+        return record_error(result, "truncated");
+    }
+    memcpy(&source, data + pos, sizeof(source));
+    pos += sizeof(source);
+
+    memset(result, 0, sizeof(source_result_t));
+    get_string(result->backend, sizeof(result->backend), source.backend, sizeof(source.backend));
+    get_string(result->device, sizeof(result->device), source.device, sizeof(source.device));
+    get_string(result->controller_model, sizeof(result->controller_model),
+               source.controller_model, sizeof(source.controller_model));
+    get_string(result->controller_type, sizeof(result->controller_type),
+               source.controller_type, sizeof(source.controller_type));
+
+    if (header.flags & HEALTH_RECORD_HAS_TIMINGS) {
+        health_record_timings_t t;
+        if (size - pos < sizeof(t)) {
+            return record_error(result, "truncated");
+        }
+        memcpy(&t, data + pos, sizeof(t));
+        pos += sizeof(t);
+
+        for (int i = 0; i < JM_PHASE_COUNT; i++) get_latency(&result->timings.phases[i], &t.phases[i]);
+        for (int i = 0; i < JM_CMD_TYPE_COUNT; i++) get_latency(&result->timings.commands[i], &t.commands[i]);
+        get_latency(&result->timings.ioctl_write, &t.ioctl_write);
+        get_latency(&result->timings.ioctl_read, &t.ioctl_read);
+        result->has_timings = 1;
+    }
+
+    for (int d = 0; d < source.num_disks && d < HEALTH_RECORD_MAX_DISKS; d++) {
+        health_record_disk_t r;
+        if (size - pos < sizeof(r)) {
+            return record_error(result, "truncated");
+        }
+        memcpy(&r, data + pos, sizeof(r));
+        pos += sizeof(r);
+        if ((size - pos) / sizeof(health_record_attribute_t) < r.num_attributes) {
+            return record_error(result, "truncated");
+        }
+
+        disk_smart_data_t* disk = &result->disks[result->num_disks++];
+        disk->is_present = 1;
+        disk->disk_number = (int32_t)le32toh((uint32_t)r.disk_number);
+        get_string(disk->disk_name, sizeof(disk->disk_name), r.model, sizeof(r.model));
+        get_string(disk->serial_number, sizeof(disk->serial_number), r.serial, sizeof(r.serial));
+        get_string(disk->firmware_rev, sizeof(disk->firmware_rev), r.firmware, sizeof(r.firmware));
+        disk->size_mb = le64toh(r.size_mb);
+        disk->command_retries = le32toh(r.command_retries);
+        disk->overall_status = (r.overall_status == DISK_STATUS_PASSED ||
+                                r.overall_status == DISK_STATUS_FAILED)
+                                   ? (disk_health_status_t)r.overall_status : DISK_STATUS_ERROR;
+
+        /* As for JSON: names and criticality from the built-in definitions */
+        for (int i = 0; i < r.num_attributes; i++) {
+            health_record_attribute_t a;
+            memcpy(&a, data + pos, sizeof(a));
+            pos += sizeof(a);
+            if (a.id == 0 || disk->num_attributes >= MAX_SMART_ATTRIBUTES) continue;
+
+            parsed_smart_attribute_t* attr = &disk->attributes[disk->num_attributes++];
+            const smart_attribute_def_t* def = get_attribute_definition(a.id);
+            attr->id = a.id;
+            attr->current_value = a.value;
+            attr->worst_value = a.worst;
+            attr->threshold = a.thresh;
+            attr->raw_value = le64toh(a.raw);
+            attr->status = (a.status == ATTR_STATUS_FAILED) ? ATTR_STATUS_FAILED : ATTR_STATUS_PASSED;
+            attr->name = (def != NULL) ? def->name : "Unknown_Attribute";
+            attr->is_critical = (def != NULL) ? def->is_critical : 0;
+        }
+    }
+
+    update_source_status(result);
+    return 0;
+}
+
+/**
+ * Parse one line of disk-health JSON format with a reusable token arena
+ */
+int parse_disk_health_arena(const char* line, size_t len, health_arena_t* arena,
+                            source_result_t* result) {
+    if (len > 0 && line[0] == HEALTH_RECORD_MAGIC[0]) {
+        return parse_disk_health_record(line, len, result);
+    }
+
+    int num_tokens = tokenize(line, len, arena);
+    jsmntok_t* tokens = arena->tokens;
+
+    if (num_tokens < 0) {
+        fprintf(stderr, "Warning: Failed to parse JSON line (error %d)\n", num_tokens);
+        result->parse_error = 1;
+        return -1;
+    }
+
+    memset(result, 0, sizeof(source_result_t));
+
+    /* Walk the root object's members; each value is skipped as a whole */
+    int root_members = (num_tokens > 0 && tokens[0].type == JSMN_OBJECT) ? tokens[0].size : 0;
+    int i = 1;
+    for (int member = 0; member < root_members && i + 1 < num_tokens; member++) {
+        jsmntok_t* value = &tokens[i + 1];
+
+        switch (classify_key(line, &tokens[i])) {
+            case KEY_BACKEND:
+                json_token_tostr(line, value, result->backend, sizeof(result->backend));
+                break;
+            case KEY_DEVICE:
+                json_token_tostr(line, value, result->device, sizeof(result->device));
+                break;
+            case KEY_CONTROLLER:
+                /* controller.model and controller.type */
+                if (value->type == JSMN_OBJECT) {
+                    parse_controller(line, tokens, num_tokens, i + 1, result);
+                }
+                break;
+            case KEY_TIMINGS:
+                /* timings object (jmraidstatus --timings) */
+                if (value->type == JSMN_OBJECT) {
+                    parse_timings(line, tokens, num_tokens, i + 1, &result->timings);
+                    result->has_timings = 1;
+                }
+                break;
+            case KEY_DISKS:
+                if (value->type == JSMN_ARRAY) {
+                    parse_disks(line, tokens, num_tokens, i + 1, result);
+                }
+                break;
+            case KEY_ERROR:
+                /* A device the source could not poll (jmraidstatus --daemon) */
+                json_token_tostr(line, value, result->error, sizeof(result->error));
+                break;
+            default:
+                break;
+        }
+        i = json_token_skip(tokens, num_tokens, i + 1);
+    }
+
+    /* Determine overall status for this source */
+    update_source_status(result);
+
+    return 0;
+}
+
+/**
+ * Re-assess every disk that carried attributes with the active policy
+ */
+void source_reassess(source_result_t* result) {
+    for (int i = 0; i < result->num_disks; i++) {
+        if (result->disks[i].num_attributes > 0) {
+            assess_overall_health(&result->disks[i]);
+        }
+    }
+    update_source_status(result);
+}
+
+void health_totals_init(health_totals_t* totals) {
+    memset(totals, 0, sizeof(health_totals_t));
+    totals->overall_status = DISK_STATUS_PASSED;
+}
+
+void health_totals_add(health_totals_t* totals, const source_result_t* src) {
+    totals->num_sources++;
+    totals->total_disks += src->num_disks;
+
+    /* A source that could not report leaves its disks' health unknown */
+    if (src->error[0] != '\0') {
+        totals->error_sources++;
+        totals->overall_status = DISK_STATUS_FAILED;
+    }
+
+    for (int j = 0; j < src->num_disks; j++) {
+        if (src->disks[j].overall_status == DISK_STATUS_PASSED) {
+            totals->healthy_disks++;
+        } else {
+            totals->failed_disks++;
+            totals->overall_status = DISK_STATUS_FAILED;
+        }
+    }
+}
+
+void health_totals_merge(health_totals_t* into, const health_totals_t* from) {
+    into->num_sources += from->num_sources;
+    into->total_disks += from->total_disks;
+    into->healthy_disks += from->healthy_disks;
+    into->failed_disks += from->failed_disks;
+    into->error_sources += from->error_sources;
+    if (from->overall_status != DISK_STATUS_PASSED) {
+        into->overall_status = DISK_STATUS_FAILED;
+    }
+}
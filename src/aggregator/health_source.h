@@ -0,0 +1,122 @@
+/*
+ * health_source.h - Parse one disk-health NDJSON source line
+ *
+ * Copyright (C) 2026 Jamie Treworgy
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef AGGREGATOR_HEALTH_SOURCE_H
+#define AGGREGATOR_HEALTH_SOURCE_H
+
+#include "../smart_parser.h"
+#include "../jm_timings.h"
+#include <stddef.h>
+
+/* Token arena bounds: starts small, doubles per oversized line (16 bytes/token) */
+#define HEALTH_ARENA_MIN_TOKENS 1024
+#define HEALTH_ARENA_MAX_TOKENS (1024 * 1024)
+
+struct jsmntok;
+
+/**
+ * Reusable token storage for parsing many lines
+ * It grows to the largest line seen and is then reused, so parsing a
+ * stream of sources allocates nothing per line.
+ */
+typedef struct {
+    struct jsmntok* tokens;
+    unsigned int capacity;
+} health_arena_t;
+
+/* Source result from one input line */
+typedef struct {
+    char backend[32];
+    char device[256];
+    char controller_model[64];
+    char controller_type[32];
+
+    disk_smart_data_t disks[32];
+    int num_disks;
+
+    disk_health_status_t overall_status;
+    int parse_error;
+    char error[64];                     /* Source command failed (e.g. "timed out after 30 s") */
+
+    int has_timings;                    /* Source was run with --timings */
+    jm_timings_t timings;
+} source_result_t;
+
+/* Running totals over a set of sources (a partial or whole report) */
+typedef struct {
+    int num_sources;
+    int total_disks;
+    int healthy_disks;
+    int failed_disks;
+    int error_sources;                  /* Source commands that failed or timed out */
+    disk_health_status_t overall_status;
+} health_totals_t;
+
+/**
+ * Parse one line of disk-health JSON format
+ * @param line NUL-terminated JSON object (one NDJSON line)
+ * @param result Output source result
+ * @return 0 on success, -1 on parse error (result->parse_error is set)
+ */
+int parse_disk_health_line(const char* line, source_result_t* result);
+
+/**
+ * Initialize an empty token arena
+ */
+void health_arena_init(health_arena_t* arena);
+
+/**
+ * Release a token arena's storage
+ */
+void health_arena_free(health_arena_t* arena);
+
+/**
+ * Parse one line of disk-health JSON format, tokenizing into an arena
+ * A binary record (starting with HEALTH_RECORD_MAGIC) is decoded instead.
+ * @param line JSON object (one NDJSON line, need not be NUL-terminated)
+ * @param len Length of line in bytes
+ * @param arena Token arena, grown as needed (up to HEALTH_ARENA_MAX_TOKENS)
+ * @param result Output source result
+ * @return 0 on success, -1 on parse error (result->parse_error is set)
+ */
+int parse_disk_health_arena(const char* line, size_t len, health_arena_t* arena,
+                            source_result_t* result);
+
+/**
+ * Parse one binary disk-health record (see health_record.h)
+ * @param data Record, starting with its header
+ * @param len Bytes available at data (at least the record's size)
+ * @param result Output source result
+ * @return 0 on success, -1 if the record is truncated or of an unsupported
+ *         version (result->parse_error is set)
+ */
+int parse_disk_health_record(const char* data, size_t len, source_result_t* result);
+
+/**
+ * Re-assess a parsed source with the active SMART policy (smart_set_config)
+ * Disks that carried attributes get their status from the policy instead
+ * of the source's verdict; disks without attributes keep the verdict.
+ * @param result Source result from parse_disk_health_line
+ */
+void source_reassess(source_result_t* result);
+
+/**
+ * Start empty totals (overall status PASSED)
+ */
+void health_totals_init(health_totals_t* totals);
+
+/**
+ * Fold one source into totals
+ */
+void health_totals_add(health_totals_t* totals, const source_result_t* src);
+
+/**
+ * Merge partial totals into running totals
+ */
+void health_totals_merge(health_totals_t* into, const health_totals_t* from);
+
+#endif /* AGGREGATOR_HEALTH_SOURCE_H */
@@ -0,0 +1,277 @@
+/*
+ * line_pool.c - Parse NDJSON line batches on a worker pool
+ *
+ * Copyright (C) 2026 Jamie Treworgy
+ * SPDX-License-Identifier: MIT
+ */
+
+#define JSMN_HEADER  /* jsmn declarations only (via common.h) */
+#include "line_pool.h"
+#include "../health_record.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum { BATCH_FREE = 0, BATCH_QUEUED, BATCH_DONE };
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t work;                /* A batch was queued, or the pool is stopping */
+    pthread_cond_t done;                /* A batch finished parsing */
+
+    line_batch_t* batches;              /* Ring, indexed by seq % num_batches */
+    int num_batches;
+    uint64_t next_fill;                 /* Sequence number of the next queued batch */
+    uint64_t next_parse;                /* Next queued batch a worker takes */
+    uint64_t next_commit;               /* Next batch to commit (reader only) */
+    int stopping;
+
+    line_pool_parse_fn parse;
+    line_pool_commit_fn commit;
+    void* ctx;
+} line_pool_t;
+
+/* Helper: Parse every line of a batch and total the valid results */
+static void parse_batch(line_pool_t* pool, line_batch_t* batch, health_arena_t* arena) {
+    health_totals_init(&batch->totals);
+
+    for (int i = 0; i < batch->num_lines; i++) {
+        source_result_t* result = &batch->results[i];
+        batch->valid[i] = pool->parse(pool->ctx, arena, batch->line[i],
+                                      batch->length[i], result) == 0;
+        if (batch->valid[i]) {
+            health_totals_add(&batch->totals, result);
+        }
+    }
+}
+
+static void* worker_main(void* arg) {
+    line_pool_t* pool = arg;
+    health_arena_t arena;
+    health_arena_init(&arena);
+
+    pthread_mutex_lock(&pool->lock);
+    while (1) {
+        while (pool->next_parse == pool->next_fill && !pool->stopping) {
+            pthread_cond_wait(&pool->work, &pool->lock);
+        }
+        if (pool->next_parse == pool->next_fill) {
+            break;  /* Stopping with nothing left to parse */
+        }
+
+        line_batch_t* batch = &pool->batches[pool->next_parse % (uint64_t)pool->num_batches];
+        pool->next_parse++;
+        pthread_mutex_unlock(&pool->lock);
+
+        parse_batch(pool, batch, &arena);
+
+        pthread_mutex_lock(&pool->lock);
+        batch->state = BATCH_DONE;
+        pthread_cond_broadcast(&pool->done);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    health_arena_free(&arena);
+    return NULL;
+}
+
+/* Helper: Hand a filled batch to the workers */
+static void queue_batch(line_pool_t* pool, line_batch_t* batch) {
+    /* Copied lines are located only now: text may have moved while filling */
+    for (int i = 0; i < batch->num_lines; i++) {
+        if (batch->line[i] == NULL) batch->line[i] = batch->text + batch->offset[i];
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    batch->seq = pool->next_fill;
+    batch->state = BATCH_QUEUED;
+    pool->next_fill++;
+    pthread_cond_signal(&pool->work);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/**
+ * Commit the oldest batch if it has been parsed
+ * @param wait Non-zero to wait for it
+ * @return 1 if a batch was committed
+ */
+static int commit_next(line_pool_t* pool, int wait) {
+    line_batch_t* batch = &pool->batches[pool->next_commit % (uint64_t)pool->num_batches];
+
+    pthread_mutex_lock(&pool->lock);
+    if (pool->next_commit == pool->next_fill) {
+        pthread_mutex_unlock(&pool->lock);
+        return 0;
+    }
+    while (batch->state != BATCH_DONE) {
+        if (!wait) {
+            pthread_mutex_unlock(&pool->lock);
+            return 0;
+        }
+        pthread_cond_wait(&pool->done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    /* Workers never touch a DONE batch, so it is read without the lock */
+    pool->commit(pool->ctx, batch);
+
+    pthread_mutex_lock(&pool->lock);
+    batch->state = BATCH_FREE;
+    pthread_mutex_unlock(&pool->lock);
+    pool->next_commit++;
+    return 1;
+}
+
+int health_input_next(input_reader_t* in, const char** unit, size_t* len) {
+    const char* data;
+    size_t avail, size;
+
+    if (input_peek(in, 1, &data, &avail) != 0) {
+        return -1;
+    }
+    if (avail == 0 || data[0] != HEALTH_RECORD_MAGIC[0]) {
+        return input_next_line(in, unit, len);
+    }
+
+    if (input_peek(in, sizeof(health_record_header_t), &data, &avail) != 0) {
+        return -1;
+    }
+    int framed = health_record_size(data, avail, &size);
+    if (framed < 0) {
+        return input_next_line(in, unit, len);  /* Just a line starting with that byte */
+    }
+    if (framed > 0 && size > HEALTH_RECORD_MAX_SIZE) {
+        in->error = "oversized binary record";
+        return -1;
+    }
+    if (framed > 0 && input_peek(in, size, &data, &avail) != 0) {
+        return -1;
+    }
+    if (framed == 0 || avail < size) {
+        in->error = "truncated binary record";
+        input_skip(in, avail);
+        return -1;
+    }
+
+    *unit = data;
+    *len = size;
+    input_skip(in, size);
+    return 1;
+}
+
+/* Helper: Add one line to a batch that is being filled; lines of a pipe
+ * are only valid until the next read, so those are copied */
+static int append_line(line_batch_t* batch, const input_reader_t* in, const char* line, size_t len) {
+    batch->length[batch->num_lines] = len;
+    if (in->in_memory) {
+        batch->line[batch->num_lines++] = line;
+        return 0;
+    }
+
+    if (batch->text_len + len + 1 > batch->text_cap) {
+        size_t cap = batch->text_cap ? batch->text_cap : 4096;
+        while (batch->text_len + len + 1 > cap) cap *= 2;
+        char* text = realloc(batch->text, cap);
+        if (text == NULL) {
+            return -1;
+        }
+        batch->text = text;
+        batch->text_cap = cap;
+    }
+
+    batch->line[batch->num_lines] = NULL;
+    batch->offset[batch->num_lines] = batch->text_len;
+    memcpy(batch->text + batch->text_len, line, len);
+    batch->text[batch->text_len + len] = '\0';
+    batch->text_len += len + 1;
+    batch->num_lines++;
+    return 0;
+}
+
+int line_pool_run(input_reader_t* in, int num_threads, line_pool_parse_fn parse,
+                  line_pool_commit_fn commit, void* ctx) {
+    if (num_threads < 1 || num_threads > LINE_POOL_MAX_THREADS) {
+        return -1;
+    }
+
+    line_pool_t pool;
+    memset(&pool, 0, sizeof(pool));
+    pool.num_batches = 2 * num_threads;
+    pool.batches = calloc((size_t)pool.num_batches, sizeof(line_batch_t));
+    pool.parse = parse;
+    pool.commit = commit;
+    pool.ctx = ctx;
+    if (pool.batches == NULL) {
+        return -1;
+    }
+    pthread_mutex_init(&pool.lock, NULL);
+    pthread_cond_init(&pool.work, NULL);
+    pthread_cond_init(&pool.done, NULL);
+
+    pthread_t threads[LINE_POOL_MAX_THREADS];
+    int started = 0;
+    while (started < num_threads &&
+           pthread_create(&threads[started], NULL, worker_main, &pool) == 0) {
+        started++;
+    }
+
+    int ret = 0;
+    if (started == 0) {
+        ret = -1;
+    } else {
+        line_batch_t* filling = NULL;
+        const char* line;
+        size_t len;
+
+        while (health_input_next(in, &line, &len) > 0) {
+            /* Skip empty lines */
+            if (len == 0) {
+                continue;
+            }
+
+            if (filling == NULL) {
+                /* Ring full: the oldest batch must be committed before reuse */
+                if (pool.next_fill - pool.next_commit == (uint64_t)pool.num_batches) {
+                    commit_next(&pool, 1);
+                }
+                filling = &pool.batches[pool.next_fill % (uint64_t)pool.num_batches];
+                filling->num_lines = 0;
+                filling->text_len = 0;
+            }
+
+            if (append_line(filling, in, line, len) != 0) {
+                ret = -1;
+                break;
+            }
+            if (filling->num_lines == LINE_BATCH_LINES || filling->text_len >= LINE_BATCH_BYTES) {
+                queue_batch(&pool, filling);
+                filling = NULL;
+            }
+
+            /* Commit whatever is already parsed, without waiting */
+            while (commit_next(&pool, 0)) {}
+        }
+
+        if (filling != NULL && filling->num_lines > 0) {
+            queue_batch(&pool, filling);
+        }
+        while (commit_next(&pool, 1)) {}
+    }
+
+    pthread_mutex_lock(&pool.lock);
+    pool.stopping = 1;
+    pthread_cond_broadcast(&pool.work);
+    pthread_mutex_unlock(&pool.lock);
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    for (int i = 0; i < pool.num_batches; i++) {
+        free(pool.batches[i].text);
+    }
+    free(pool.batches);
+    pthread_cond_destroy(&pool.done);
+    pthread_cond_destroy(&pool.work);
+    pthread_mutex_destroy(&pool.lock);
+    return ret;
+}
@@ -0,0 +1,82 @@
+/*
+ * line_pool.h - Parse NDJSON line batches on a worker pool
+ *
+ * Copyright (C) 2026 Jamie Treworgy
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef AGGREGATOR_LINE_POOL_H
+#define AGGREGATOR_LINE_POOL_H
+
+#include "health_source.h"
+#include "../parsers/common.h"
+
+#define LINE_POOL_MAX_THREADS 32
+#define LINE_BATCH_LINES 16                 /* Lines handed to a worker at once */
+#define LINE_BATCH_BYTES (1024 * 1024)      /* ...or fewer, once this much text is queued */
+
+/**
+ * A run of consecutive input lines and what they parsed to
+ * Batches are committed in input order.
+ */
+typedef struct {
+    uint64_t seq;                           /* Batch sequence number */
+    int num_lines;
+    const char* line[LINE_BATCH_LINES];     /* Into the reader's memory, or into text */
+    size_t length[LINE_BATCH_LINES];
+    size_t offset[LINE_BATCH_LINES];        /* Line start in text, if copied */
+    char* text;                             /* Copies of lines from a pipe */
+    size_t text_len;
+    size_t text_cap;
+
+    source_result_t results[LINE_BATCH_LINES];
+    int valid[LINE_BATCH_LINES];            /* results[i] holds a parsed source */
+    health_totals_t totals;                 /* Partial report over the valid results */
+
+    int state;                              /* Internal */
+} line_batch_t;
+
+/**
+ * Read the next input unit: an NDJSON line, or a binary record
+ * A unit starting with HEALTH_RECORD_MAGIC is framed by its header, so
+ * records and lines may be mixed in one stream.
+ * @param in Input reader
+ * @param unit Output unit (valid as for input_next_line)
+ * @param len Output unit length
+ * @return 1 for a unit, 0 at end of input, -1 on a read error or a
+ *         truncated record (see in->error)
+ */
+int health_input_next(input_reader_t* in, const char** unit, size_t* len);
+
+/**
+ * Parse one line into a result (called on a worker thread)
+ * @param ctx Caller context (must be safe to read from several threads)
+ * @param arena The worker's own token arena
+ * @return 0 if the line is a valid source
+ */
+typedef int (*line_pool_parse_fn)(void* ctx, health_arena_t* arena,
+                                  const char* line, size_t len, source_result_t* result);
+
+/**
+ * Take one parsed batch (called on the reading thread, in input order)
+ */
+typedef void (*line_pool_commit_fn)(void* ctx, const line_batch_t* batch);
+
+/**
+ * Read NDJSON lines (or binary records) and parse them on num_threads workers
+ * The calling thread reads and commits; at most 2 batches per worker are
+ * in flight, so memory is bounded however long the input is. Lines of
+ * an in-memory (mapped) input are parsed in place; lines from a pipe are
+ * copied into their batch. Empty lines are skipped.
+ *
+ * @param in Input reader
+ * @param num_threads Worker threads (1 to LINE_POOL_MAX_THREADS)
+ * @param parse Line parser
+ * @param commit Batch consumer
+ * @param ctx Passed to both callbacks
+ * @return 0 on success, -1 if the pool could not be started
+ */
+int line_pool_run(input_reader_t* in, int num_threads, line_pool_parse_fn parse,
+                  line_pool_commit_fn commit, void* ctx);
+
+#endif /* AGGREGATOR_LINE_POOL_H */
@@ -0,0 +1,273 @@
+/*
+ * source_runner.c - Run disk-health source commands concurrently
+ *
+ * Copyright (C) 2026 Jamie Treworgy
+ * SPDX-License-Identifier: MIT
+ */
+
+#define _GNU_SOURCE  /* pipe2 */
+#include "source_runner.h"
+#include "../jm_timings.h"
+#include "../health_record.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define READ_CHUNK 65536
+
+void source_proc_init(source_proc_t* proc, const char* command) {
+    memset(proc, 0, sizeof(source_proc_t));
+    proc->command = command;
+    proc->pid = -1;
+    proc->pgid = -1;
+    proc->fd = -1;
+}
+
+void source_proc_free(source_proc_t* proc) {
+    free(proc->buf);
+    proc->buf = NULL;
+    proc->len = proc->cap = 0;
+}
+
+/* Helper: fork /bin/sh -c command with stdout on a pipe */
+static int spawn(source_proc_t* proc) {
+    int fds[2];
+
+    /* CLOEXEC so sibling sources don't hold each other's pipes open */
+    if (pipe2(fds, O_CLOEXEC) != 0) {
+        return -1;
+    }
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return -1;
+    }
+
+    if (pid == 0) {
+        /* Own process group so a timeout kills the whole pipeline */
+        setpgid(0, 0);
+        int devnull = open("/dev/null", O_RDONLY);
+        if (devnull >= 0) {
+            dup2(devnull, STDIN_FILENO);
+        }
+        dup2(fds[1], STDOUT_FILENO);
+        execl("/bin/sh", "sh", "-c", proc->command, (char*)NULL);
+        _exit(127);
+    }
+
+    setpgid(pid, pid);  /* Also in the parent, so kill() can't race the child */
+    close(fds[1]);
+    proc->pid = pid;
+    proc->pgid = pid;
+    proc->fd = fds[0];
+    return 0;
+}
+
+/* Helper: Append bytes to the source's buffer */
+static int append(source_proc_t* proc, const char* data, size_t len) {
+    if (proc->len + len + 1 > proc->cap) {
+        size_t cap = proc->cap ? proc->cap : READ_CHUNK;
+        while (proc->len + len + 1 > cap) cap *= 2;
+        char* buf = realloc(proc->buf, cap);
+        if (buf == NULL) {
+            return -1;
+        }
+        proc->buf = buf;
+        proc->cap = cap;
+    }
+    memcpy(proc->buf + proc->len, data, len);
+    proc->len += len;
+    proc->buf[proc->len] = '\0';
+    return 0;
+}
+
+/* Helper: Hand complete lines and binary records to the callback; the
+ * partial tail stays buffered (a truncated record is dropped at flush) */
+static void drain_lines(source_proc_t* proc, int index, source_line_fn on_line, void* ctx, int flush) {
+    size_t start = 0;
+    if (proc->buf == NULL) return;
+
+    while (start < proc->len) {
+        char* unit = proc->buf + start;
+        size_t avail = proc->len - start;
+        size_t size;
+
+        int framed = health_record_size(unit, avail, &size);
+        if (framed >= 0) {
+            if (framed > 0 && size <= avail) {
+                on_line(ctx, index, unit, size);
+                start += size;
+                continue;
+            }
+            if (flush) start = proc->len;
+            break;
+        }
+
+        char* nl = memchr(unit, '\n', avail);
+        if (nl == NULL) {
+            if (flush) {
+                on_line(ctx, index, unit, avail);
+                start = proc->len;
+            }
+            break;
+        }
+        *nl = '\0';
+        if (nl > unit) on_line(ctx, index, unit, (size_t)(nl - unit));
+        start += (size_t)(nl - unit) + 1;
+    }
+
+    memmove(proc->buf, proc->buf + start, proc->len - start);
+    proc->len -= start;
+    proc->buf[proc->len] = '\0';
+}
+
+void source_for_each_line(source_proc_t* proc, int index, source_line_fn on_line, void* ctx) {
+    drain_lines(proc, index, on_line, ctx, 1);
+}
+
+/* Helper: Reap a source if it has exited */
+static void reap(source_proc_t* proc, uint64_t start_us, int block) {
+    int status;
+    if (proc->pid < 0) return;
+
+    pid_t r = waitpid(proc->pid, &status, block ? 0 : WNOHANG);
+    if (r == proc->pid || (r < 0 && errno == ECHILD)) {
+        proc->exit_status = (r == proc->pid) ? status : 0;
+        proc->pid = -1;
+        proc->elapsed_us = jm_monotonic_us() - start_us;
+    }
+}
+
+void source_run_all(source_proc_t* procs, int num_procs, int timeout_ms,
+                    source_line_fn on_line, void* ctx) {
+    uint64_t start_us = jm_monotonic_us();
+    uint64_t deadline_us = start_us + (uint64_t)timeout_ms * 1000;
+
+    struct pollfd* pfds = calloc((size_t)num_procs, sizeof(struct pollfd));
+    int* owner = calloc((size_t)num_procs, sizeof(int));
+    char* chunk = malloc(READ_CHUNK);
+    if (pfds == NULL || owner == NULL || chunk == NULL) {
+        for (int i = 0; i < num_procs; i++) procs[i].spawn_failed = 1;
+        free(pfds);
+        free(owner);
+        free(chunk);
+        return;
+    }
+
+    for (int i = 0; i < num_procs; i++) {
+        if (spawn(&procs[i]) != 0) {
+            procs[i].spawn_failed = 1;
+        }
+    }
+
+    while (1) {
+        /* Reap early exits, then wait on the pipes still open */
+        int live = 0, nfds = 0;
+        for (int i = 0; i < num_procs; i++) {
+            reap(&procs[i], start_us, 0);
+            if (procs[i].pid >= 0) live++;
+            if (procs[i].fd >= 0) {
+                pfds[nfds].fd = procs[i].fd;
+                pfds[nfds].events = POLLIN;
+                owner[nfds++] = i;
+            }
+        }
+        if (live == 0 && nfds == 0) break;
+
+        uint64_t now_us = jm_monotonic_us();
+        if (now_us >= deadline_us) break;
+        int wait_ms = (int)((deadline_us - now_us + 999) / 1000);
+
+        if (nfds == 0) {
+            /* Outputs closed but some processes still running */
+            struct timespec delay = { 0, 10 * 1000000L };
+            nanosleep(&delay, NULL);
+            continue;
+        }
+
+        int ready = poll(pfds, (nfds_t)nfds, wait_ms);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+
+        for (int k = 0; k < nfds; k++) {
+            if (!(pfds[k].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+            source_proc_t* proc = &procs[owner[k]];
+
+            ssize_t n = read(proc->fd, chunk, READ_CHUNK);
+            if (n < 0 && (errno == EINTR || errno == EAGAIN)) continue;
+
+            if (n > 0 && append(proc, chunk, (size_t)n) == 0) {
+                if (on_line) drain_lines(proc, owner[k], on_line, ctx, 0);
+                continue;
+            }
+
+            /* EOF (or read/allocation failure): a final unterminated line still counts */
+            if (on_line) drain_lines(proc, owner[k], on_line, ctx, 1);
+            close(proc->fd);
+            proc->fd = -1;
+        }
+    }
+
+    /* Deadline passed: kill whatever is left. A source whose shell exited
+     * but left a background child holding the pipe is killed by its group */
+    for (int i = 0; i < num_procs; i++) {
+        source_proc_t* proc = &procs[i];
+        if (proc->pid >= 0 || proc->fd >= 0) {
+            if (proc->pgid > 0) kill(-proc->pgid, SIGKILL);
+            if (proc->pid >= 0) kill(proc->pid, SIGKILL);
+            proc->timed_out = 1;
+            reap(proc, start_us, 1);
+            proc->elapsed_us = jm_monotonic_us() - start_us;
+        }
+        if (proc->fd >= 0) {
+            if (proc->timed_out) {
+                /* Drop the partial line of a killed source */
+                while (proc->len > 0 && proc->buf[proc->len - 1] != '\n') proc->len--;
+                if (proc->buf != NULL) proc->buf[proc->len] = '\0';
+            } else if (on_line) {
+                drain_lines(proc, i, on_line, ctx, 1);
+            }
+            close(proc->fd);
+            proc->fd = -1;
+        }
+    }
+
+    free(pfds);
+    free(owner);
+    free(chunk);
+}
+
+int source_failure(const source_proc_t* proc, int timeout_ms, char* buf, size_t bufsize) {
+    if (proc->spawn_failed) {
+        snprintf(buf, bufsize, "could not be started");
+        return 1;
+    }
+    if (proc->timed_out) {
+        if (timeout_ms % 1000 == 0) {
+            snprintf(buf, bufsize, "timed out after %d s", timeout_ms / 1000);
+        } else {
+            snprintf(buf, bufsize, "timed out after %d ms", timeout_ms);
+        }
+        return 1;
+    }
+    if (WIFSIGNALED(proc->exit_status)) {
+        snprintf(buf, bufsize, "killed by signal %d", WTERMSIG(proc->exit_status));
+        return 1;
+    }
+    if (WIFEXITED(proc->exit_status) && WEXITSTATUS(proc->exit_status) >= 126) {
+        snprintf(buf, bufsize, "could not run command (exit status %d)", WEXITSTATUS(proc->exit_status));
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,84 @@
+/*
+ * source_runner.h - Run disk-health source commands concurrently
+ *
+ * Copyright (C) 2026 Jamie Treworgy
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef AGGREGATOR_SOURCE_RUNNER_H
+#define AGGREGATOR_SOURCE_RUNNER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+/* One --source command and what it produced */
+typedef struct {
+    const char* command;                /* Run with /bin/sh -c */
+    pid_t pid;                          /* -1 once reaped (or never started) */
+    pid_t pgid;                         /* Its process group, kept after the reap */
+    int fd;                             /* Read end of its stdout, -1 once closed */
+
+    char* buf;                          /* Output not yet passed to the line callback */
+    size_t len;
+    size_t cap;
+
+    int spawn_failed;
+    int timed_out;                      /* Killed at the deadline */
+    int exit_status;                    /* waitpid status (valid once pid is -1) */
+    uint64_t elapsed_us;                /* Start to exit (or kill) */
+} source_proc_t;
+
+/**
+ * Called with one complete output line (without the newline), or one
+ * whole binary record (see health_record.h)
+ * @param ctx Caller context
+ * @param index Index of the source in the procs array
+ * @param line Line bytes (NUL-terminated; a binary record is not)
+ * @param len Length of line
+ */
+typedef void (*source_line_fn)(void* ctx, int index, const char* line, size_t len);
+
+/**
+ * Initialize a source for source_run_all
+ */
+void source_proc_init(source_proc_t* proc, const char* command);
+
+/**
+ * Release a source's output buffer
+ */
+void source_proc_free(source_proc_t* proc);
+
+/**
+ * Start every source at once and collect their stdout until all exit
+ * Outputs are multiplexed with poll(). A source still running at the
+ * deadline is killed (with its process group) and marked timed_out.
+ * stdin of each source is /dev/null; stderr is inherited.
+ *
+ * @param procs Sources from source_proc_init
+ * @param num_procs Number of sources
+ * @param timeout_ms Per-source deadline, measured from the common start
+ * @param on_line Called for each line as soon as it is complete, in
+ *                arrival order; NULL keeps each source's whole output in
+ *                proc->buf for source_for_each_line
+ * @param ctx Passed to on_line
+ */
+void source_run_all(source_proc_t* procs, int num_procs, int timeout_ms,
+                    source_line_fn on_line, void* ctx);
+
+/**
+ * Pass each line kept in proc->buf to a callback (after on_line = NULL)
+ */
+void source_for_each_line(source_proc_t* proc, int index, source_line_fn on_line, void* ctx);
+
+/**
+ * Describe why a source produced no result, if it failed
+ * @param proc Finished source
+ * @param buf Output buffer for the description (e.g. "timed out after 30 s")
+ * @param bufsize Size of buf
+ * @param timeout_ms Deadline that was used
+ * @return 1 if the source failed to run or timed out, 0 otherwise
+ */
+int source_failure(const source_proc_t* proc, int timeout_ms, char* buf, size_t bufsize);
+
+#endif /* AGGREGATOR_SOURCE_RUNNER_H */
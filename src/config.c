@@ -14,9 +14,11 @@
 #include <ctype.h>
 #include <errno.h>
 #include "config.h"
+#include "smart_attributes.h"
 
 #define MAX_CONFIG_SIZE 65536  /* 64KB max config file */
 #define MAX_ATTRIBUTES 32      /* Max custom attribute thresholds */
+#define MAX_WARM_PROBE_DEVICES 64  /* Max "warm_probe" device paths */
 
 void config_init_default(smart_config_t* config) {
     memset(config, 0, sizeof(smart_config_t));
@@ -26,6 +28,42 @@ void config_init_default(smart_config_t* config) {
     config->has_temp_critical = 0;
     config->attributes = NULL;
     config->num_attributes = 0;
+
+    config_compile(config);
+}
+
+void config_builtin_rule(uint8_t id, health_rule_t* rule) {
+    const smart_attribute_def_t* def = get_attribute_definition(id);
+
+    memset(rule, 0, sizeof(health_rule_t));
+    if (def != NULL) {
+        rule->name = def->name;
+        rule->is_critical = (uint8_t)def->is_critical;
+        rule->check = (uint8_t)def->check;
+    }
+    rule->temp_critical = CONFIG_DEFAULT_TEMP_CRITICAL;
+}
+
+void config_compile(smart_config_t* config) {
+    for (int id = 0; id < 256; id++) {
+        health_rule_t* rule = &config->rules[id];
+        config_builtin_rule((uint8_t)id, rule);
+        if (config->has_temp_critical) {
+            rule->temp_critical = config->temp_critical;
+        }
+    }
+
+    /* An ID listed more than once fails at its lowest raw_critical */
+    for (int i = 0; i < config->num_attributes; i++) {
+        const attribute_threshold_t* attr = &config->attributes[i];
+        health_rule_t* rule = &config->rules[attr->id];
+        if (!attr->has_raw_critical) continue;
+
+        if (!rule->has_raw_critical || attr->raw_critical < rule->raw_critical) {
+            rule->has_raw_critical = 1;
+            rule->raw_critical = attr->raw_critical;
+        }
+    }
 }
 
 void config_free(smart_config_t* config) {
@@ -34,6 +72,24 @@ void config_free(smart_config_t* config) {
         config->attributes = NULL;
     }
     config->num_attributes = 0;
+    free(config->warm_probe_devices);
+    config->warm_probe_devices = NULL;
+    config->num_warm_probe_devices = 0;
+}
+
+int config_warm_probe(const smart_config_t* config, const char* device_path) {
+    if (config == NULL) {
+        return 0;
+    }
+    if (config->warm_probe_all) {
+        return 1;
+    }
+    for (int i = 0; i < config->num_warm_probe_devices; i++) {
+        if (strcmp(config->warm_probe_devices[i], device_path) == 0) {
+            return 1;
+        }
+    }
+    return 0;
 }
 
 int config_write_default(const char* path) {
@@ -274,6 +330,29 @@ int config_load(const char* path, smart_config_t* config) {
                 }
             }
         }
+        else if (strcmp(key, "warm_probe") == 0) {
+            if (tok.type == TOK_TRUE || tok.type == TOK_FALSE) {
+                config->warm_probe_all = tok.bool_value;
+                continue;
+            }
+            if (tok.type != TOK_LBRACKET) continue;
+
+            /* Parse the list of device paths */
+            while (1) {
+                if (get_token(&tokenizer, &tok) != 0) break;
+                if (tok.type == TOK_RBRACKET) break;
+                if (tok.type == TOK_COMMA) continue;
+                if (tok.type != TOK_STRING) break;
+                if (config->num_warm_probe_devices >= MAX_WARM_PROBE_DEVICES) continue;
+
+                if (config->warm_probe_devices == NULL) {
+                    config->warm_probe_devices = calloc(MAX_WARM_PROBE_DEVICES, sizeof(*config->warm_probe_devices));
+                    if (config->warm_probe_devices == NULL) break;
+                }
+                snprintf(config->warm_probe_devices[config->num_warm_probe_devices++],
+                         sizeof(config->warm_probe_devices[0]), "%s", tok.string_value);
+            }
+        }
         else if (strcmp(key, "attributes") == 0) {
             if (tok.type != TOK_LBRACE) continue;
 
@@ -336,6 +415,7 @@ int config_load(const char* path, smart_config_t* config) {
             config->num_attributes = attr_count;
         }
     }
+    config_compile(config);
 
     free(buffer);
     return 0;
@@ -17,6 +17,19 @@ typedef struct {
     uint64_t raw_critical;   /* Fail if raw value exceeds this */
 } attribute_threshold_t;
 
+/* Temperature limit (°C) when the config sets none */
+#define CONFIG_DEFAULT_TEMP_CRITICAL 60
+
+/* Compiled health rule for one attribute ID (see config_compile) */
+typedef struct {
+    const char* name;          /* Built-in attribute name, NULL if unknown */
+    uint8_t is_critical;       /* Built-in criticality */
+    uint8_t check;             /* Built-in check (attribute_check_t) */
+    uint8_t temp_critical;     /* Limit for ATTR_CHECK_TEMPERATURE attributes */
+    uint8_t has_raw_critical;  /* Whether raw_critical is set */
+    uint64_t raw_critical;     /* Fail if raw value exceeds this (lowest configured) */
+} health_rule_t;
+
 /* Configuration structure */
 typedef struct {
     /* Temperature thresholds */
@@ -29,6 +42,15 @@ typedef struct {
 
     /* Whether to use manufacturer thresholds as fallback */
     int use_manufacturer_thresholds;
+
+    /* Settings above merged with the built-in attribute definitions,
+     * indexed by attribute ID */
+    health_rule_t rules[256];
+
+    /* "warm_probe": true for every device, or a list of device paths */
+    int warm_probe_all;
+    char (*warm_probe_devices)[256];
+    int num_warm_probe_devices;
 } smart_config_t;
 
 /**
@@ -53,4 +75,22 @@ int config_write_default(const char* path);
  */
 void config_init_default(smart_config_t* config);
 
+/**
+ * Rebuild config->rules from the settings and the built-in definitions
+ * config_load and config_init_default call this; call it again after
+ * changing the settings in memory.
+ */
+void config_compile(smart_config_t* config);
+
+/**
+ * Whether the config enables the warm-controller probe for a device
+ * Returns 1 if "warm_probe" is true or lists device_path, 0 otherwise
+ */
+int config_warm_probe(const smart_config_t* config, const char* device_path);
+
+/**
+ * Built-in rule for one attribute ID (the compiled form of no config)
+ */
+void config_builtin_rule(uint8_t id, health_rule_t* rule);
+
 #endif /* CONFIG_H */
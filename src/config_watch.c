@@ -0,0 +1,166 @@
+/**
+ * config_watch.c - Reload the configuration file while a daemon runs
+ *
+ * Copyright (C) 2026 Jamie Treworgy
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#define _GNU_SOURCE  /* pipe2 */
+#include "config_watch.h"
+#include "smart_parser.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <limits.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+
+/* Events that can leave a different file behind the path */
+#define WATCH_EVENTS (IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE)
+
+struct config_watch {
+    char path[PATH_MAX];
+    struct stat loaded;                 /* The file as last parsed (or at start) */
+    int inotify_fd;                     /* Watches the file's directory */
+    int stop_pipe[2];
+    pthread_t thread;
+    _Atomic(smart_config_t*) pending;   /* Parsed by the thread, not yet installed */
+    smart_config_t* installed;          /* The reload smart_get_config returns, if any */
+};
+
+static void release(smart_config_t* config) {
+    if (config) {
+        config_free(config);
+        free(config);
+    }
+}
+
+/* Helper: Whether stat results describe the same file contents */
+static int same_file(const struct stat* a, const struct stat* b) {
+    return a->st_dev == b->st_dev && a->st_ino == b->st_ino && a->st_size == b->st_size &&
+           a->st_mtim.tv_sec == b->st_mtim.tv_sec && a->st_mtim.tv_nsec == b->st_mtim.tv_nsec;
+}
+
+/* Helper: Parse the file if it changed, and leave it for config_watch_swap
+ * A file created empty is skipped: its contents follow with IN_CLOSE_WRITE. */
+static void reload(config_watch_t* watch) {
+    struct stat st;
+
+    if (stat(watch->path, &st) != 0 || st.st_size == 0 || same_file(&st, &watch->loaded)) {
+        return;
+    }
+    watch->loaded = st;
+
+    smart_config_t* fresh = malloc(sizeof(smart_config_t));
+    if (!fresh) {
+        return;
+    }
+    config_init_default(fresh);
+    if (config_load(watch->path, fresh) != 0) {
+        fprintf(stderr, "Warning: Config %s did not reload; keeping the current settings\n", watch->path);
+        release(fresh);
+        return;
+    }
+
+    /* A reload nobody has installed yet is superseded */
+    release(atomic_exchange(&watch->pending, fresh));
+}
+
+static void* watch_thread(void* arg) {
+    config_watch_t* watch = arg;
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    struct pollfd pfds[2] = {
+        { .fd = watch->inotify_fd, .events = POLLIN },
+        { .fd = watch->stop_pipe[0], .events = POLLIN }
+    };
+
+    while (1) {
+        int n = poll(pfds, 2, -1);
+        if (n < 0 && errno != EINTR) {
+            break;
+        }
+        if (n <= 0) {
+            continue;
+        }
+        if (pfds[1].revents != 0) {
+            break;
+        }
+
+        /* One save is several events: drain them all, then look once */
+        while (read(watch->inotify_fd, buf, sizeof(buf)) > 0) {
+        }
+        reload(watch);
+    }
+    return NULL;
+}
+
+config_watch_t* config_watch_start(const char* path) {
+    config_watch_t* watch = calloc(1, sizeof(config_watch_t));
+    char dir[PATH_MAX];
+
+    if (!watch) {
+        return NULL;
+    }
+    watch->inotify_fd = -1;
+    watch->stop_pipe[0] = watch->stop_pipe[1] = -1;
+    atomic_init(&watch->pending, NULL);
+
+    if (strlen(path) >= sizeof(watch->path) || stat(path, &watch->loaded) != 0) {
+        free(watch);
+        return NULL;
+    }
+    strcpy(watch->path, path);
+    strcpy(dir, path);
+
+    watch->inotify_fd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+    if (watch->inotify_fd < 0 || inotify_add_watch(watch->inotify_fd, dirname(dir), WATCH_EVENTS) < 0 ||
+        pipe2(watch->stop_pipe, O_CLOEXEC) != 0 ||
+        pthread_create(&watch->thread, NULL, watch_thread, watch) != 0) {
+        if (watch->inotify_fd >= 0) close(watch->inotify_fd);
+        if (watch->stop_pipe[0] >= 0) close(watch->stop_pipe[0]);
+        if (watch->stop_pipe[1] >= 0) close(watch->stop_pipe[1]);
+        free(watch);
+        return NULL;
+    }
+    return watch;
+}
+
+const smart_config_t* config_watch_swap(config_watch_t* watch) {
+    if (!watch) {
+        return NULL;
+    }
+    smart_config_t* fresh = atomic_exchange(&watch->pending, NULL);
+    if (!fresh) {
+        return NULL;
+    }
+
+    smart_set_config(fresh);
+    release(watch->installed);
+    watch->installed = fresh;
+    return fresh;
+}
+
+void config_watch_stop(config_watch_t* watch) {
+    if (!watch) {
+        return;
+    }
+    if (write(watch->stop_pipe[1], "", 1) == 1) {
+        pthread_join(watch->thread, NULL);
+    } else {
+        pthread_cancel(watch->thread);
+        pthread_join(watch->thread, NULL);
+    }
+    close(watch->inotify_fd);
+    close(watch->stop_pipe[0]);
+    close(watch->stop_pipe[1]);
+    release(atomic_exchange(&watch->pending, NULL));
+    release(watch->installed);
+    free(watch);
+}
@@ -0,0 +1,48 @@
+/**
+ * config_watch.h - Reload the configuration file while a daemon runs
+ *
+ * Copyright (C) 2026 Jamie Treworgy
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef CONFIG_WATCH_H
+#define CONFIG_WATCH_H
+
+#include "config.h"
+
+/*
+ * A side thread waits on inotify for the config file's directory, so
+ * editors that save by renaming and symlink swaps are seen as well as
+ * in-place writes. When the file's identity or contents change it is
+ * re-parsed and compiled there, off the polling thread. The result is only
+ * handed over when the daemon asks for it between polls, so no assessment
+ * ever sees two policies, and open sessions and cached data are untouched.
+ * A file that does not parse is reported and the current policy stays.
+ */
+
+typedef struct config_watch config_watch_t;
+
+/**
+ * Start watching a config file
+ * Returns the watch, or NULL if inotify or the thread is unavailable
+ */
+config_watch_t* config_watch_start(const char* path);
+
+/**
+ * Install the newest reloaded config, if one is pending
+ * Call between polls, while no thread is assessing: the config this
+ * replaces (if it was an earlier reload) is freed. The config given to
+ * smart_set_config at startup stays the caller's.
+ * Returns the new config (also set with smart_set_config), or NULL if the
+ * file has not changed since the last call
+ */
+const smart_config_t* config_watch_swap(config_watch_t* watch);
+
+/**
+ * Stop the thread and free the watch and every config it loaded
+ * The startup config must be set again with smart_set_config first if a
+ * reload is still installed.
+ */
+void config_watch_stop(config_watch_t* watch);
+
+#endif /* CONFIG_WATCH_H */
@@ -10,6 +10,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <limits.h>
+#include <dirent.h>
+#include <sys/stat.h>
 
 /* Check if we're running in WSL */
 int is_wsl(void) {
@@ -28,6 +30,28 @@ int is_wsl(void) {
     return wsl_detected;
 }
 
+/* Helper: Read a hex sysfs attribute ("152d", "0x197b") from dir/name */
+static int read_hex_attr(const char *dir, const char *name, unsigned int *value) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL)
+        return -1;
+    int ok = (fscanf(fp, "%x", value) == 1);
+    fclose(fp);
+    return ok ? 0 : -1;
+}
+
+/* Helper: PCI function dirs are named "dddd:bb:dd.f" */
+#define JM_PCI_ADDRESS_LEN 12 /* "dddd:bb:dd.f" */
+
+static int is_pci_address(const char *name) {
+    unsigned int domain, bus, dev, fn;
+    char extra;
+    return sscanf(name, "%4x:%2x:%2x.%1x%c", &domain, &bus, &dev, &fn, &extra) == 4;
+}
+
 /* Get USB vendor and product IDs for a block device */
 int get_usb_ids(const char *device_path, unsigned int *vendor_id, unsigned int *product_id) {
     char *devname = strrchr(device_path, '/');
@@ -35,47 +59,13 @@ int get_usb_ids(const char *device_path, unsigned int *vendor_id, unsigned int *
         return -1;
     devname++; /* Skip the '/' */
 
-    /* Navigate up the sysfs tree to find USB device info */
-    char syspath[PATH_MAX];
-    char search_path[PATH_MAX];
-    char realpath_buf[PATH_MAX];
-
-    snprintf(syspath, sizeof(syspath), "/sys/block/%s/device", devname);
-    if (realpath(syspath, realpath_buf) == NULL)
+    jm_scan_entry_t entry;
+    if (probe_block_device(JM_SYSFS_ROOT, devname, &entry) != 0 || entry.bus != JM_BUS_USB)
         return -1;
 
-    /* Walk up the directory tree looking for idVendor/idProduct files */
-    snprintf(search_path, sizeof(search_path), "%s", realpath_buf);
-
-    for (int i = 0; i < 10; i++) { /* Max 10 levels up */
-        char vendor_path[PATH_MAX];
-        char product_path[PATH_MAX];
-        snprintf(vendor_path, sizeof(vendor_path), "%s/idVendor", search_path);
-        snprintf(product_path, sizeof(product_path), "%s/idProduct", search_path);
-
-        FILE *vf = fopen(vendor_path, "r");
-        FILE *pf = fopen(product_path, "r");
-
-        if (vf && pf) {
-            if (fscanf(vf, "%x", vendor_id) == 1 && fscanf(pf, "%x", product_id) == 1) {
-                fclose(vf);
-                fclose(pf);
-                return 0;
-            }
-        }
-        if (vf)
-            fclose(vf);
-        if (pf)
-            fclose(pf);
-
-        /* Go up one directory */
-        char *last_slash = strrchr(search_path, '/');
-        if (last_slash == NULL || last_slash == search_path)
-            break;
-        *last_slash = '\0';
-    }
-
-    return -1;
+    *vendor_id = entry.controller.vendor_id;
+    *product_id = entry.controller.device_id;
+    return 0;
 }
 
 /* Check if a block device is USB-connected */
@@ -163,6 +153,189 @@ static const char *get_usb_controller_model(unsigned int vendor_id, unsigned int
     return NULL; /* Unknown USB controller */
 }
 
+/* Helper: Fill controller info for a USB device (same wording as before the scan existed) */
+static void describe_usb(controller_info_t *info, unsigned int vendor, unsigned int product) {
+    const char *model = get_usb_controller_model(vendor, product);
+
+    info->found = 1;
+    info->vendor_id = vendor;
+    info->device_id = product;
+    if (model != NULL) {
+        snprintf(info->model, sizeof(info->model), "%s", model);
+        snprintf(info->description, sizeof(info->description),
+                 "USB enclosure (VID:%04x PID:%04x)", vendor, product);
+    } else {
+        snprintf(info->model, sizeof(info->model), "USB enclosure");
+        snprintf(info->description, sizeof(info->description),
+                 "USB-connected storage (VID:%04x PID:%04x)", vendor, product);
+    }
+}
+
+int probe_block_device(const char *sys_root, const char *name, jm_scan_entry_t *entry) {
+    char syspath[PATH_MAX];
+    char search_path[PATH_MAX];
+
+    memset(entry, 0, sizeof(jm_scan_entry_t));
+    snprintf(entry->device_path, sizeof(entry->device_path), "/dev/%s", name);
+
+    /* Block device number: "<major>:<minor>" */
+    snprintf(syspath, sizeof(syspath), "%s/block/%s/dev", sys_root, name);
+    FILE *fp = fopen(syspath, "r");
+    if (fp == NULL)
+        return -1;
+    int ok = (fscanf(fp, "%u:%u", &entry->major, &entry->minor) == 2);
+    fclose(fp);
+    if (!ok)
+        return -1;
+
+    snprintf(syspath, sizeof(syspath), "%s/block/%s/device", sys_root, name);
+    if (realpath(syspath, search_path) == NULL)
+        return 1; /* Virtual device (loop, dm, ...) - nothing behind it */
+
+    /* One walk up the tree; the first USB device or PCI function decides */
+    for (int i = 0; i < 10; i++) { /* Max 10 levels up */
+        unsigned int vendor, product;
+        const char *base = strrchr(search_path, '/');
+        base = base ? base + 1 : search_path;
+
+        if (read_hex_attr(search_path, "idVendor", &vendor) == 0 &&
+            read_hex_attr(search_path, "idProduct", &product) == 0) {
+            entry->bus = JM_BUS_USB;
+            if (snprintf(entry->controller_path, sizeof(entry->controller_path), "%s", search_path) >=
+                (int)sizeof(entry->controller_path))
+                return -1; /* Too long to key the cache by; truncated it would never match */
+            describe_usb(&entry->controller, vendor, product);
+            return 0;
+        }
+
+        if (is_pci_address(base) &&
+            read_hex_attr(search_path, "vendor", &vendor) == 0 &&
+            read_hex_attr(search_path, "device", &product) == 0) {
+            if (vendor != 0x197b)
+                return 1; /* Behind another vendor's controller */
+            entry->bus = JM_BUS_PCI;
+            if (snprintf(entry->controller_path, sizeof(entry->controller_path), "%s", search_path) >=
+                (int)sizeof(entry->controller_path))
+                return -1;
+            entry->controller.found = 1;
+            entry->controller.vendor_id = vendor;
+            entry->controller.device_id = product;
+            snprintf(entry->controller.model, sizeof(entry->controller.model), "%s",
+                     get_jmicron_model(product));
+            snprintf(entry->controller.description, sizeof(entry->controller.description),
+                     "PCIe controller at %.*s", JM_PCI_ADDRESS_LEN, base);
+            return 0;
+        }
+
+        /* Go up one directory */
+        char *last_slash = strrchr(search_path, '/');
+        if (last_slash == NULL || last_slash == search_path)
+            break;
+        *last_slash = '\0';
+    }
+
+    return 1;
+}
+
+int is_jmicron_entry(const jm_scan_entry_t *entry) {
+    return entry->bus != JM_BUS_NONE &&
+           (entry->controller.vendor_id == 0x152d || entry->controller.vendor_id == 0x197b);
+}
+
+/* Helper: Block devices that are never behind a controller */
+static int is_virtual_block_name(const char *name) {
+    static const char *const prefixes[] = {"loop", "ram", "zram", "dm-", "md", "nbd", "sr"};
+    for (size_t i = 0; i < sizeof(prefixes) / sizeof(prefixes[0]); i++) {
+        if (strncmp(name, prefixes[i], strlen(prefixes[i])) == 0)
+            return 1;
+    }
+    return 0;
+}
+
+static int compare_entries(const void *a, const void *b) {
+    return strcmp(((const jm_scan_entry_t *)a)->device_path, ((const jm_scan_entry_t *)b)->device_path);
+}
+
+int scan_jmicron_devices(const char *sys_root, jm_scan_entry_t *entries, int max_entries) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/block", sys_root);
+
+    DIR *dir = opendir(path);
+    if (dir == NULL)
+        return -1;
+
+    int count = 0;
+    struct dirent *de;
+    while ((de = readdir(dir)) != NULL && count < max_entries) {
+        if (de->d_name[0] == '.' || is_virtual_block_name(de->d_name))
+            continue;
+
+        if (probe_block_device(sys_root, de->d_name, &entries[count]) == 0 &&
+            is_jmicron_entry(&entries[count])) {
+            count++;
+        }
+    }
+    closedir(dir);
+
+    /* readdir order is arbitrary; keep output stable across runs */
+    qsort(entries, (size_t)count, sizeof(jm_scan_entry_t), compare_entries);
+    return count;
+}
+
+int scan_entry_is_current(const char *sys_root, const jm_scan_entry_t *entry) {
+    char path[PATH_MAX];
+    char resolved[PATH_MAX];
+    unsigned int major, minor;
+    struct stat st;
+
+    const char *name = strrchr(entry->device_path, '/');
+    if (name == NULL || entry->controller_path[0] == '\0')
+        return 0;
+    name++;
+
+    snprintf(path, sizeof(path), "%s/block/%s/dev", sys_root, name);
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL)
+        return 0;
+    int ok = (fscanf(fp, "%u:%u", &major, &minor) == 2);
+    fclose(fp);
+    if (!ok || major != entry->major || minor != entry->minor)
+        return 0;
+
+    /* Same controller directory? (a re-plugged enclosure moves or disappears) */
+    size_t len = strlen(entry->controller_path);
+    snprintf(path, sizeof(path), "%s/block/%s/device", sys_root, name);
+    return stat(entry->controller_path, &st) == 0 &&
+           realpath(path, resolved) != NULL &&
+           strncmp(resolved, entry->controller_path, len) == 0 &&
+           resolved[len] == '/';
+}
+
+uint32_t block_listing_hash(const char *sys_root) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/block", sys_root);
+
+    DIR *dir = opendir(path);
+    if (dir == NULL)
+        return 0;
+
+    /* Sum of per-name FNV-1a hashes: independent of readdir order */
+    uint32_t sum = 0;
+    struct dirent *de;
+    while ((de = readdir(dir)) != NULL) {
+        if (de->d_name[0] == '.')
+            continue;
+        uint32_t h = 2166136261u;
+        for (const char *p = de->d_name; *p; p++) {
+            h = (h ^ (uint8_t)*p) * 16777619u;
+        }
+        sum += h;
+    }
+    closedir(dir);
+
+    return sum ? sum : 1;
+}
+
 /* Check if JMicron controller is present and identify model */
 int detect_jmicron_hardware(controller_info_t *info, const char *device_path) {
     memset(info, 0, sizeof(controller_info_t));
@@ -176,31 +349,20 @@ int detect_jmicron_hardware(controller_info_t *info, const char *device_path) {
         return 0;
     }
 
-    /* Check if this is a USB device - most JMicron RAID enclosures are USB */
+    /* One sysfs walk finds the USB device or PCI function behind the disk */
+    const char *devname = strrchr(device_path, '/');
+    jm_scan_entry_t entry;
+    if (devname != NULL && probe_block_device(JM_SYSFS_ROOT, devname + 1, &entry) == 0) {
+        *info = entry.controller;
+        return 0;
+    }
+
+    /* USB-connected but no IDs found - most JMicron RAID enclosures are USB */
     if (is_usb_device(device_path)) {
-        unsigned int usb_vendor = 0, usb_product = 0;
         info->found = 1;
-
-        /* Try to get USB vendor/product IDs */
-        if (get_usb_ids(device_path, &usb_vendor, &usb_product) == 0) {
-            info->vendor_id = usb_vendor;
-            info->device_id = usb_product;
-
-            const char *model = get_usb_controller_model(usb_vendor, usb_product);
-            if (model != NULL) {
-                snprintf(info->model, sizeof(info->model), "%s", model);
-                snprintf(info->description, sizeof(info->description),
-                         "USB enclosure (VID:%04x PID:%04x)", usb_vendor, usb_product);
-            } else {
-                snprintf(info->model, sizeof(info->model), "USB enclosure");
-                snprintf(info->description, sizeof(info->description),
-                         "USB-connected storage (VID:%04x PID:%04x)", usb_vendor, usb_product);
-            }
-        } else {
-            snprintf(info->model, sizeof(info->model), "USB enclosure");
-            snprintf(info->description, sizeof(info->description),
-                     "USB-connected storage (likely JMicron RAID enclosure)");
-        }
+        snprintf(info->model, sizeof(info->model), "USB enclosure");
+        snprintf(info->description, sizeof(info->description),
+                 "USB-connected storage (likely JMicron RAID enclosure)");
         return 0;
     }
 
@@ -8,6 +8,10 @@
 #ifndef HARDWARE_DETECT_H
 #define HARDWARE_DETECT_H
 
+#include <stdint.h>
+
+#define JM_SYSFS_ROOT "/sys"
+
 /* Controller information structure */
 typedef struct {
     int found;                  /* 1 if controller found, 0 otherwise */
@@ -49,4 +53,68 @@ int is_usb_device(const char* device_path);
  */
 int get_usb_ids(const char* device_path, unsigned int* vendor_id, unsigned int* product_id);
 
+/* Bus the controller behind a block device sits on */
+typedef enum {
+    JM_BUS_NONE = 0,
+    JM_BUS_USB = 1,             /* USB device dir (has idVendor/idProduct) */
+    JM_BUS_PCI = 2              /* PCI function dir (has vendor/device) */
+} jm_bus_t;
+
+/* One block device and the controller it sits behind (--scan, detection cache) */
+typedef struct {
+    char device_path[64];       /* Device node (e.g., "/dev/sdc") */
+    unsigned int major;         /* Block device number, part of the cache key */
+    unsigned int minor;
+    jm_bus_t bus;
+    char controller_path[256];  /* sysfs dir of the USB device or PCI function, part of the cache key */
+    controller_info_t controller;
+} jm_scan_entry_t;
+
+/**
+ * Resolve a block device to the controller it sits behind in one sysfs walk
+ * Walks up from <sys_root>/block/<name>/device to the first USB device
+ * (idVendor) or PCI function (vendor). USB devices are always reported as
+ * found, like detect_jmicron_hardware; PCI functions only if JMicron.
+ *
+ * @param sys_root sysfs mount point (JM_SYSFS_ROOT, or a fake tree in tests)
+ * @param name Block device name (e.g., "sdc")
+ * @param entry Output entry
+ * @return 0 if a controller was found, 1 if not, -1 if the block device doesn't
+ *         exist or its controller's sysfs path doesn't fit controller_path
+ */
+int probe_block_device(const char* sys_root, const char* name, jm_scan_entry_t* entry);
+
+/**
+ * Check if a probed controller carries a JMicron vendor ID
+ * (0x152d on USB, 0x197b on PCIe and some USB bridges)
+ */
+int is_jmicron_entry(const jm_scan_entry_t* entry);
+
+/**
+ * Enumerate <sys_root>/block once and list every device behind a JMicron controller
+ *
+ * @param sys_root sysfs mount point
+ * @param entries Output array, sorted by device name
+ * @param max_entries Capacity of entries
+ * @return Number of entries found, or -1 if <sys_root>/block can't be read
+ */
+int scan_jmicron_devices(const char* sys_root, jm_scan_entry_t* entries, int max_entries);
+
+/**
+ * Cheaply re-check a cached entry without walking sysfs
+ * Valid if the block device still has the same major:minor and still
+ * resolves to a path under the same controller directory.
+ *
+ * @return 1 if the entry still describes the device, 0 if stale
+ */
+int scan_entry_is_current(const char* sys_root, const jm_scan_entry_t* entry);
+
+/**
+ * Hash the names in <sys_root>/block (readdir only, no file reads)
+ * A changed hash means devices were added or removed since a cached scan.
+ *
+ * @return Order-independent hash of the names, 0 if unreadable
+ */
+uint32_t block_listing_hash(const char* sys_root);
+
 #endif /* HARDWARE_DETECT_H */
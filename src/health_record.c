@@ -0,0 +1,133 @@
+/*
+ * health_record.c - Part of jm-raid-status
+ *
+ * Copyright (C) 2026 Jamie Treworgy
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "health_record.h"
+#include <endian.h>
+#include <string.h>
+
+#define SOURCE_OFFSET sizeof(health_record_header_t)
+
+/* Helper: Copy a string of at most max bytes into a fixed NUL-padded field (truncating) */
+static void put_bounded(char* field, size_t size, const char* s, size_t max) {
+    memset(field, 0, size);
+    if (s != NULL) {
+        memcpy(field, s, strnlen(s, max < size - 1 ? max : size - 1));
+    }
+}
+
+static void put_string(char* field, size_t size, const char* s) {
+    put_bounded(field, size, s, size - 1);
+}
+
+static void put_latency(health_record_latency_t* out, const jm_latency_t* latency) {
+    out->count = htole32(latency->count);
+    out->total_us = htole64(latency->total_us);
+    out->max_us = htole64(latency->max_us);
+}
+
+void health_record_begin(health_record_t* rec, const char* backend, const char* device,
+                         const char* controller_model, const char* controller_type,
+                         const jm_timings_t* timings) {
+    health_record_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, HEALTH_RECORD_MAGIC, HEALTH_RECORD_MAGIC_LEN);
+    header.version = htole16(HEALTH_RECORD_VERSION);
+    header.header_size = htole16(sizeof(health_record_header_t));
+    header.type = HEALTH_RECORD_SOURCE;
+    header.flags = timings ? HEALTH_RECORD_HAS_TIMINGS : 0;
+
+    health_record_source_t source;
+    memset(&source, 0, sizeof(source));
+    put_string(source.backend, sizeof(source.backend), backend);
+    put_string(source.device, sizeof(source.device), device);
+    put_string(source.controller_model, sizeof(source.controller_model), controller_model);
+    put_string(source.controller_type, sizeof(source.controller_type), controller_type);
+
+    memcpy(rec->data, &header, sizeof(header));
+    memcpy(rec->data + SOURCE_OFFSET, &source, sizeof(source));
+    rec->len = SOURCE_OFFSET + sizeof(source);
+
+    if (timings != NULL) {
+        health_record_timings_t t;
+        for (int i = 0; i < JM_PHASE_COUNT; i++) put_latency(&t.phases[i], &timings->phases[i]);
+        for (int i = 0; i < JM_CMD_TYPE_COUNT; i++) put_latency(&t.commands[i], &timings->commands[i]);
+        put_latency(&t.ioctl_write, &timings->ioctl_write);
+        put_latency(&t.ioctl_read, &timings->ioctl_read);
+        memcpy(rec->data + rec->len, &t, sizeof(t));
+        rec->len += sizeof(t);
+    }
+}
+
+int health_record_add_disk(health_record_t* rec, const disk_smart_data_t* disk, int disk_number) {
+    health_record_source_t* source = (health_record_source_t*)(rec->data + SOURCE_OFFSET);
+    if (source->num_disks >= HEALTH_RECORD_MAX_DISKS) {
+        return -1;
+    }
+    source->num_disks++;
+
+    int num_attributes = disk->num_attributes;
+    if (num_attributes > MAX_SMART_ATTRIBUTES) num_attributes = MAX_SMART_ATTRIBUTES;
+    if (num_attributes < 0) num_attributes = 0;
+
+    health_record_disk_t d;
+    memset(&d, 0, sizeof(d));
+    d.disk_number = (int32_t)htole32((uint32_t)disk_number);
+    put_bounded(d.model, sizeof(d.model), disk->disk_name, sizeof(disk->disk_name));
+    put_bounded(d.serial, sizeof(d.serial), disk->serial_number, sizeof(disk->serial_number));
+    put_bounded(d.firmware, sizeof(d.firmware), disk->firmware_rev, sizeof(disk->firmware_rev));
+    d.size_mb = htole64(disk->size_mb);
+    d.command_retries = htole32(disk->command_retries);
+    d.overall_status = (uint8_t)disk->overall_status;
+    d.num_attributes = (uint8_t)num_attributes;
+    memcpy(rec->data + rec->len, &d, sizeof(d));
+    rec->len += sizeof(d);
+
+    for (int i = 0; i < num_attributes; i++) {
+        const parsed_smart_attribute_t* attr = &disk->attributes[i];
+        health_record_attribute_t a;
+        memset(&a, 0, sizeof(a));
+        a.id = attr->id;
+        a.value = attr->current_value;
+        a.worst = attr->worst_value;
+        a.thresh = attr->threshold;
+        a.status = (uint8_t)attr->status;
+        a.critical = attr->is_critical ? 1 : 0;
+        a.raw = htole64(attr->raw_value);
+        memcpy(rec->data + rec->len, &a, sizeof(a));
+        rec->len += sizeof(a);
+    }
+    return 0;
+}
+
+void health_record_finish(health_record_t* rec) {
+    health_record_header_t* header = (health_record_header_t*)rec->data;
+    header->payload_len = htole32((uint32_t)(rec->len - sizeof(health_record_header_t)));
+}
+
+int health_record_write(health_record_t* rec, FILE* out) {
+    health_record_finish(rec);
+    return fwrite(rec->data, 1, rec->len, out) == rec->len ? 0 : -1;
+}
+
+int health_record_size(const void* data, size_t avail, size_t* size) {
+    size_t n = avail < HEALTH_RECORD_MAGIC_LEN ? avail : HEALTH_RECORD_MAGIC_LEN;
+    if (n == 0 || memcmp(data, HEALTH_RECORD_MAGIC, n) != 0) {
+        return -1;
+    }
+    if (avail < sizeof(health_record_header_t)) {
+        return 0;
+    }
+
+    health_record_header_t header;
+    memcpy(&header, data, sizeof(header));
+    size_t header_size = le16toh(header.header_size);
+    if (header_size < sizeof(health_record_header_t)) {
+        header_size = sizeof(health_record_header_t);
+    }
+    *size = header_size + le32toh(header.payload_len);
+    return 1;
+}
@@ -0,0 +1,154 @@
+/*
+ * health_record.h - Part of jm-raid-status
+ *
+ * Copyright (C) 2026 Jamie Treworgy
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef HEALTH_RECORD_H
+#define HEALTH_RECORD_H
+
+#include "smart_parser.h"
+#include "jm_timings.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * Binary disk-health record (--format=bin)
+ *
+ * The same source as one disk-health JSON line, as fixed-layout structs:
+ *
+ *   header | source | timings (if HEALTH_RECORD_HAS_TIMINGS)
+ *          | disk | attribute * disk.num_attributes | disk | ...
+ *
+ * Integers are little-endian, strings NUL-padded. payload_len covers
+ * everything after the header, so a reader can skip a record it does not
+ * understand. The first magic byte is not ASCII, so a record can't be
+ * mistaken for a JSON line and the two can be mixed in one stream.
+ * Changing any struct below (or JM_PHASE_COUNT / JM_CMD_TYPE_COUNT)
+ * needs a new HEALTH_RECORD_VERSION.
+ */
+
+#define HEALTH_RECORD_MAGIC "\x89JMH"
+#define HEALTH_RECORD_MAGIC_LEN 4
+#define HEALTH_RECORD_VERSION 1
+
+#define HEALTH_RECORD_SOURCE 1              /* header.type */
+#define HEALTH_RECORD_HAS_TIMINGS 0x01      /* header.flags */
+#define HEALTH_RECORD_MAX_DISKS 32          /* As many as a disk-health source holds */
+
+typedef struct {
+    uint8_t magic[HEALTH_RECORD_MAGIC_LEN];
+    uint16_t version;
+    uint16_t header_size;                   /* sizeof(health_record_header_t) */
+    uint32_t payload_len;
+    uint8_t type;
+    uint8_t flags;
+    uint16_t reserved;
+} __attribute__((packed)) health_record_header_t;
+
+typedef struct {
+    char backend[32];
+    char device[256];
+    char controller_model[64];
+    char controller_type[32];
+    uint8_t num_disks;
+    uint8_t reserved[7];
+} __attribute__((packed)) health_record_source_t;
+
+typedef struct {
+    uint32_t count;
+    uint64_t total_us;
+    uint64_t max_us;
+} __attribute__((packed)) health_record_latency_t;
+
+typedef struct {
+    health_record_latency_t phases[JM_PHASE_COUNT];
+    health_record_latency_t commands[JM_CMD_TYPE_COUNT];
+    health_record_latency_t ioctl_write;
+    health_record_latency_t ioctl_read;
+} __attribute__((packed)) health_record_timings_t;
+
+typedef struct {
+    int32_t disk_number;
+    char model[64];
+    char serial[24];
+    char firmware[12];
+    uint64_t size_mb;
+    uint32_t command_retries;
+    uint8_t overall_status;                 /* disk_health_status_t */
+    uint8_t num_attributes;
+    uint16_t reserved;
+} __attribute__((packed)) health_record_disk_t;
+
+typedef struct {
+    uint8_t id;
+    uint8_t value;
+    uint8_t worst;
+    uint8_t thresh;
+    uint8_t status;                         /* attribute_health_status_t */
+    uint8_t critical;
+    uint16_t reserved;
+    uint64_t raw;
+} __attribute__((packed)) health_record_attribute_t;
+
+/* Largest possible record */
+#define HEALTH_RECORD_MAX_SIZE \
+    (sizeof(health_record_header_t) + sizeof(health_record_source_t) + \
+     sizeof(health_record_timings_t) + HEALTH_RECORD_MAX_DISKS * \
+     (sizeof(health_record_disk_t) + MAX_SMART_ATTRIBUTES * sizeof(health_record_attribute_t)))
+
+/**
+ * A record being built; fixed size, so encoding allocates nothing
+ */
+typedef struct {
+    uint8_t data[HEALTH_RECORD_MAX_SIZE];
+    size_t len;
+} health_record_t;
+
+/**
+ * Start a record for one source
+ * @param rec Record to fill
+ * @param backend Source backend ("jmicron", "smartctl")
+ * @param device Device path
+ * @param controller_model Controller model
+ * @param controller_type Controller type ("raid_array", "single_disk")
+ * @param timings Timings to carry, or NULL
+ */
+void health_record_begin(health_record_t* rec, const char* backend, const char* device,
+                         const char* controller_model, const char* controller_type,
+                         const jm_timings_t* timings);
+
+/**
+ * Append one disk and its attributes
+ * @param rec Record from health_record_begin
+ * @param disk Disk data (names are not carried; readers look them up by ID)
+ * @param disk_number Slot number reported for the disk
+ * @return 0 on success, -1 if the record already holds HEALTH_RECORD_MAX_DISKS
+ */
+int health_record_add_disk(health_record_t* rec, const disk_smart_data_t* disk, int disk_number);
+
+/**
+ * Finish a record in place (rec->data then holds the complete record)
+ */
+void health_record_finish(health_record_t* rec);
+
+/**
+ * Finish a record and write it in one call
+ * @return 0 on success, -1 on write error
+ */
+int health_record_write(health_record_t* rec, FILE* out);
+
+/**
+ * Find the size of the record at the start of a buffer
+ * @param data Buffer
+ * @param avail Bytes available in data
+ * @param size Output: header plus payload size
+ * @return 1 if data starts with a record header (size is set, and may be
+ *         more than avail), 0 if data is a prefix of a header, -1 if
+ *         data is not a record
+ */
+int health_record_size(const void* data, size_t avail, size_t* size);
+
+#endif /* HEALTH_RECORD_H */
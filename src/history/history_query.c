@@ -0,0 +1,408 @@
+/*
+ * history_query.c - Query a SMART history file (jm-history)
+ *
+ * Copyright (C) 2026 Jamie Treworgy
+ * SPDX-License-Identifier: MIT
+ *
+ * Usage: jm-history [OPTIONS] FILE
+ * Scans the mapped history written by jmraidstatus/disk-health --history
+ * and answers per-drive questions such as reallocated sector growth over
+ * 30 days or the maximum temperature of the last week.
+ */
+
+#define JSMN_HEADER  /* jsmn declarations only (via common.h) */
+#include "../jm_history.h"
+#include "../smart_attributes.h"
+#include "../parsers/common.h"
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+typedef enum {
+    STAT_LIST = 0,                      /* No --attr: list the drives */
+    STAT_GROWTH,
+    STAT_MAX,
+    STAT_MIN,
+    STAT_LAST,
+    STAT_SERIES
+} stat_t;
+
+static const char* stat_names[] = { "list", "growth", "max", "min", "last", "series" };
+
+/* CLI options */
+typedef struct {
+    const char* path;
+    const char* serial;                 /* --serial: one drive only */
+    int attr_id;                        /* --attr, 0 = none */
+    stat_t stat;
+    int64_t since;                      /* --since as Unix time, 0 = everything */
+    int output_json;
+} cli_options_t;
+
+/* What one drive's snapshots (in the window) add up to */
+typedef struct {
+    char serial[24];
+    char model[48];
+    int snapshots;
+    int with_attr;                      /* Snapshots that carried the attribute */
+    int64_t first_time;
+    int64_t last_time;
+    uint64_t first;
+    uint64_t last;
+    uint64_t min;
+    uint64_t max;
+    disk_health_status_t last_status;
+} drive_summary_t;
+
+typedef struct {
+    const cli_options_t* options;
+    drive_summary_t* drives;            /* One per directory entry at most */
+    int max_drives;
+    int num_drives;
+    int series_count;                   /* Series entries printed so far */
+} query_t;
+
+/* Helper: Attribute value as reported (temperatures keep only the Celsius byte) */
+static uint64_t attribute_value(const jm_history_attribute_t* attr) {
+    if (attr->id == 190 || attr->id == 194) {
+        return attr->raw & 0xFF;
+    }
+    return attr->raw;
+}
+
+static void format_time(int64_t t, char* buf, size_t bufsize) {
+    time_t tt = (time_t)t;
+    struct tm tm_info;
+    gmtime_r(&tt, &tm_info);
+    strftime(buf, bufsize, "%Y-%m-%dT%H:%M:%SZ", &tm_info);
+}
+
+static drive_summary_t* find_summary(query_t* q, const jm_history_snapshot_t* snap) {
+    for (int i = 0; i < q->num_drives; i++) {
+        if (strcmp(q->drives[i].serial, snap->serial) == 0) {
+            return &q->drives[i];
+        }
+    }
+    if (q->num_drives >= q->max_drives) {
+        return NULL;
+    }
+    drive_summary_t* d = &q->drives[q->num_drives++];
+    memset(d, 0, sizeof(drive_summary_t));
+    snprintf(d->serial, sizeof(d->serial), "%s", snap->serial);
+    return d;
+}
+
+/* jm_history_fn: fold one snapshot into its drive's summary */
+static int on_snapshot(void* ctx, const jm_history_snapshot_t* snap) {
+    query_t* q = ctx;
+    const cli_options_t* options = q->options;
+
+    if (snap->timestamp < options->since ||
+        (options->serial != NULL && strcmp(snap->serial, options->serial) != 0)) {
+        return 0;
+    }
+    drive_summary_t* d = find_summary(q, snap);
+    if (d == NULL) {
+        return 0;
+    }
+
+    snprintf(d->model, sizeof(d->model), "%s", snap->model);
+    if (d->snapshots++ == 0) d->first_time = snap->timestamp;
+    d->last_time = snap->timestamp;
+    d->last_status = snap->overall_status;
+
+    const jm_history_attribute_t* attr = NULL;
+    for (int i = 0; i < snap->num_attributes && attr == NULL; i++) {
+        if (snap->attributes[i].id == options->attr_id) attr = &snap->attributes[i];
+    }
+    if (attr == NULL) {
+        return 0;
+    }
+
+    uint64_t value = attribute_value(attr);
+    if (d->with_attr++ == 0) {
+        d->first = d->min = d->max = value;
+    }
+    d->last = value;
+    if (value < d->min) d->min = value;
+    if (value > d->max) d->max = value;
+
+    if (options->stat == STAT_SERIES) {
+        char when[32];
+        format_time(snap->timestamp, when, sizeof(when));
+        if (options->output_json) {
+            printf("%s{\"timestamp\":\"%s\",\"serial\":", q->series_count ? "," : "", when);
+            json_output_string(snap->serial);
+            printf(",\"value\":%llu}", (unsigned long long)value);
+        } else {
+            printf("%s  %-24s %llu\n", when, snap->serial, (unsigned long long)value);
+        }
+        q->series_count++;
+    }
+    return 0;
+}
+
+/* Helper: The statistic asked for, as a signed value (growth can be negative) */
+static long long stat_value(const drive_summary_t* d, stat_t stat) {
+    switch (stat) {
+        case STAT_GROWTH: return (long long)(d->last - d->first);
+        case STAT_MAX:    return (long long)d->max;
+        case STAT_MIN:    return (long long)d->min;
+        default:          return (long long)d->last;
+    }
+}
+
+static void output_text(const query_t* q) {
+    const cli_options_t* options = q->options;
+
+    if (options->stat == STAT_LIST) {
+        printf("%-24s %-32s %9s  %-20s  %-20s  %s\n",
+               "SERIAL", "MODEL", "SNAPSHOTS", "FIRST", "LAST", "STATUS");
+        for (int i = 0; i < q->num_drives; i++) {
+            const drive_summary_t* d = &q->drives[i];
+            char first[32], last[32];
+            format_time(d->first_time, first, sizeof(first));
+            format_time(d->last_time, last, sizeof(last));
+            printf("%-24s %-32s %9d  %-20s  %-20s  %s\n", d->serial, d->model, d->snapshots,
+                   first, last, d->last_status == DISK_STATUS_PASSED ? "healthy" : "failed");
+        }
+        return;
+    }
+
+    for (int i = 0; i < q->num_drives; i++) {
+        const drive_summary_t* d = &q->drives[i];
+        if (d->with_attr == 0) {
+            continue;
+        }
+        if (options->stat == STAT_GROWTH) {
+            printf("%-24s %-32s %+lld (%llu -> %llu over %d snapshots)\n", d->serial, d->model,
+                   stat_value(d, options->stat), (unsigned long long)d->first,
+                   (unsigned long long)d->last, d->with_attr);
+        } else {
+            printf("%-24s %-32s %lld (%d snapshots)\n", d->serial, d->model,
+                   stat_value(d, options->stat), d->with_attr);
+        }
+    }
+}
+
+static void output_json(const query_t* q) {
+    const cli_options_t* options = q->options;
+    int first = 1;
+
+    printf("\"drives\":[");
+    for (int i = 0; i < q->num_drives; i++) {
+        const drive_summary_t* d = &q->drives[i];
+        char first_time[32], last_time[32];
+
+        if (options->stat != STAT_LIST && d->with_attr == 0) {
+            continue;
+        }
+        format_time(d->first_time, first_time, sizeof(first_time));
+        format_time(d->last_time, last_time, sizeof(last_time));
+
+        printf("%s{\"serial\":", first ? "" : ",");
+        json_output_string(d->serial);
+        printf(",\"model\":");
+        json_output_string(d->model);
+        printf(",\"snapshots\":%d,\"first\":\"%s\",\"last\":\"%s\"",
+               options->stat == STAT_LIST ? d->snapshots : d->with_attr, first_time, last_time);
+        if (options->stat == STAT_LIST) {
+            printf(",\"status\":\"%s\"", d->last_status == DISK_STATUS_PASSED ? "healthy" : "failed");
+        } else {
+            printf(",\"value\":%lld", stat_value(d, options->stat));
+            if (options->stat == STAT_GROWTH) {
+                printf(",\"from\":%llu,\"to\":%llu",
+                       (unsigned long long)d->first, (unsigned long long)d->last);
+            }
+        }
+        printf("}");
+        first = 0;
+    }
+    printf("]");
+}
+
+/* Helper: Attribute by ID or by name (e.g. 5 or Reallocated_Sector_Ct) */
+static int parse_attribute(const char* arg) {
+    char* end;
+    long id = strtol(arg, &end, 10);
+    if (*end == '\0') {
+        return (id >= 1 && id <= 255) ? (int)id : 0;
+    }
+    for (int i = 1; i <= 255; i++) {
+        const smart_attribute_def_t* def = get_attribute_definition((uint8_t)i);
+        if (def != NULL && strcasecmp(def->name, arg) == 0) {
+            return i;
+        }
+    }
+    return 0;
+}
+
+/* Helper: Age such as 30d, 12h, 1w or 90 (seconds) */
+static int parse_age(const char* arg, int64_t* seconds) {
+    char* end;
+    long long n = strtoll(arg, &end, 10);
+    long long unit = 1;
+
+    if (n < 0 || end == arg) return -1;
+    switch (*end) {
+        case '\0':
+        case 's': unit = 1; break;
+        case 'm': unit = 60; break;
+        case 'h': unit = 3600; break;
+        case 'd': unit = 86400; break;
+        case 'w': unit = 7 * 86400; break;
+        default: return -1;
+    }
+    if (*end != '\0' && end[1] != '\0') return -1;
+    *seconds = n * unit;
+    return 0;
+}
+
+static void print_help(void) {
+    printf("Usage: jm-history [OPTIONS] FILE\n\n");
+    printf("Query a SMART history file written with --history\n\n");
+    printf("Options:\n");
+    printf("  -a, --attr ATTR  SMART attribute ID or name (e.g. 5, Reallocated_Sector_Ct);\n");
+    printf("                   without it, list the drives in the file\n");
+    printf("  -s, --stat STAT  growth (default), max, min, last, or series (every snapshot)\n");
+    printf("      --since AGE  Only snapshots newer than AGE: N[smhdw] (e.g. 30d, 1w)\n");
+    printf("  -S, --serial SERIAL\n");
+    printf("                   Only the drive with this serial\n");
+    printf("  -j, --json       JSON output\n");
+    printf("  -h, --help       Show this help\n\n");
+    printf("Temperatures (attributes 190 and 194) are reported in Celsius, other\n");
+    printf("attributes as raw values.\n\n");
+    printf("Examples:\n");
+    printf("  jm-history --attr 5 --since 30d history.jmh       # Reallocated sector growth\n");
+    printf("  jm-history --attr 194 --stat max --since 1w history.jmh  # Max temperature\n");
+}
+
+static void parse_arguments(int argc, char** argv, cli_options_t* options) {
+    memset(options, 0, sizeof(cli_options_t));
+
+    static struct option long_options[] = {
+        {"attr", required_argument, 0, 'a'},
+        {"stat", required_argument, 0, 's'},
+        {"since", required_argument, 0, 'A'},
+        {"serial", required_argument, 0, 'S'},
+        {"json", no_argument, 0, 'j'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    const char* stat = NULL;
+    int opt;
+    while ((opt = getopt_long(argc, argv, "a:s:S:jh", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'a':
+                options->attr_id = parse_attribute(optarg);
+                if (options->attr_id == 0) {
+                    fprintf(stderr, "Error: Unknown SMART attribute: %s\n", optarg);
+                    exit(3);
+                }
+                break;
+            case 's':
+                stat = optarg;
+                break;
+            case 'A': {
+                int64_t age;
+                if (parse_age(optarg, &age) != 0) {
+                    fprintf(stderr, "Error: --since must be N[smhdw], e.g. 30d\n");
+                    exit(3);
+                }
+                options->since = (int64_t)time(NULL) - age;
+                break;
+            }
+            case 'S':
+                options->serial = optarg;
+                break;
+            case 'j':
+                options->output_json = 1;
+                break;
+            case 'h':
+                print_help();
+                exit(0);
+            default:
+                exit(3);
+        }
+    }
+
+    if (optind != argc - 1) {
+        fprintf(stderr, "Error: Expected one history file (see --help)\n");
+        exit(3);
+    }
+    options->path = argv[optind];
+
+    if (stat != NULL && options->attr_id == 0) {
+        fprintf(stderr, "Error: --stat needs --attr\n");
+        exit(3);
+    }
+    if (options->attr_id != 0) {
+        options->stat = (stat == NULL) ? STAT_GROWTH : STAT_LIST;
+        for (int i = STAT_GROWTH; stat != NULL && i <= STAT_SERIES; i++) {
+            if (strcmp(stat, stat_names[i]) == 0) options->stat = (stat_t)i;
+        }
+        if (options->stat == STAT_LIST) {
+            fprintf(stderr, "Error: --stat must be growth, max, min, last or series\n");
+            exit(3);
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    cli_options_t options;
+    parse_arguments(argc, argv, &options);
+
+    jm_history_t history;
+    if (jm_history_open(&history, options.path, 0, 0, 0) != 0) {
+        fprintf(stderr, "Error: %s is not a readable history file\n", options.path);
+        return 3;
+    }
+
+    static query_t query;
+    query.options = &options;
+    query.max_drives = (int)jm_history_max_drives(&history);
+    query.drives = calloc((size_t)query.max_drives, sizeof(drive_summary_t));
+    if (query.drives == NULL) {
+        fprintf(stderr, "Error: Out of memory\n");
+        jm_history_close(&history);
+        return 3;
+    }
+
+    if (options.output_json) {
+        printf("{\"stat\":\"%s\"", stat_names[options.stat]);
+        if (options.attr_id != 0) {
+            const smart_attribute_def_t* def = get_attribute_definition((uint8_t)options.attr_id);
+            printf(",\"attribute\":{\"id\":%d,\"name\":", options.attr_id);
+            json_output_string(def != NULL ? def->name : "Unknown_Attribute");
+            printf("}");
+        }
+        if (options.stat == STAT_SERIES) printf(",\"snapshots\":[");
+    }
+
+    jm_history_scan(&history, on_snapshot, &query);
+    jm_history_close(&history);
+
+    if (options.output_json) {
+        if (options.stat == STAT_SERIES) {
+            printf("]");
+        } else {
+            printf(",");
+            output_json(&query);
+        }
+        printf("}\n");
+    } else if (options.stat != STAT_SERIES) {
+        output_text(&query);
+    }
+
+    /* 1 if nothing matched, like grep */
+    int matched = 0;
+    for (int i = 0; i < query.num_drives; i++) {
+        matched += (options.attr_id != 0) ? query.drives[i].with_attr : query.drives[i].snapshots;
+    }
+    free(query.drives);
+    return matched > 0 ? 0 : 1;
+}
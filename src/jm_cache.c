@@ -0,0 +1,322 @@
+/*
+ * jm_cache.c - Part of jm-raid-status
+ *
+ * Copyright (C) 2026 Jamie Treworgy
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "jm_cache.h"
+#include "jm_lock.h"
+#include "smart_attributes.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <limits.h>
+#include <sys/stat.h>
+
+#define JM_CACHE_MAGIC   0x31434d4a  /* "JMC1" */
+#define JM_CACHE_VERSION 1
+
+/* On-disk header; the five jm_cache_slot_t records follow it */
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t slot_size;                 /* sizeof(jm_cache_slot_t), catches layout changes */
+    uint8_t disk_bitmask;
+    uint8_t reserved[7];
+} jm_cache_header_t;
+
+#define JM_DETECT_CACHE_MAGIC   0x31444d4a  /* "JMD1" */
+#define JM_DETECT_CACHE_VERSION 1
+#define JM_DETECT_CACHE_FILE    "detect.cache"
+
+/* On-disk header of detect.cache; num_entries jm_scan_entry_t records follow */
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t entry_size;                /* sizeof(jm_scan_entry_t) */
+    uint32_t listing_hash;              /* block_listing_hash of a full scan, 0 = partial */
+    uint32_t num_entries;
+} jm_detect_cache_header_t;
+
+#define JM_RESULT_MAGIC   0x31534d4a  /* "JMS1" */
+#define JM_RESULT_VERSION 1
+
+/* On-disk header of <device>.result; one jm_result_entry_t follows */
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t reserved;
+    uint32_t entry_size;                /* sizeof(jm_result_entry_t) */
+} jm_result_header_t;
+
+/* Helper: Build "<dir>/<serial>.cache", keeping only filename-safe characters */
+static int cache_path(const char* dir, const char* serial, char* path, size_t path_size) {
+    char name[sizeof(((jm_cache_slot_t*)0)->serial)];
+    size_t n = 0;
+
+    for (const char* p = serial; *p && n < sizeof(name) - 1; p++) {
+        char c = *p;
+        if ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') ||
+            (c >= '0' && c <= '9') || c == '-' || c == '_') {
+            name[n++] = c;
+        } else {
+            name[n++] = '_';
+        }
+    }
+    name[n] = '\0';
+
+    if (n == 0) {
+        return -1;  /* No serial, no key */
+    }
+
+    int len = snprintf(path, path_size, "%s/%s.cache", dir, name);
+    return (len > 0 && (size_t)len < path_size) ? 0 : -1;
+}
+
+/* Helper: Write header + records to a temp file and rename it over path */
+static int store_atomically(const char* dir, const char* path, const void* header, size_t header_size,
+                            const void* records, size_t record_size, size_t num_records) {
+    char tmp_path[540];
+
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+        return -1;
+    }
+
+    /* Unique per writer so parallel scans of one controller can't collide */
+    snprintf(tmp_path, sizeof(tmp_path), "%s.%ld.tmp", path, (long)getpid());
+
+    FILE* f = fopen(tmp_path, "wb");
+    if (f == NULL) {
+        return -1;
+    }
+
+    int ok = fwrite(header, header_size, 1, f) == 1 &&
+             (num_records == 0 || fwrite(records, record_size, num_records, f) == num_records);
+    ok = (fclose(f) == 0) && ok;
+
+    if (!ok || rename(tmp_path, path) != 0) {
+        unlink(tmp_path);
+        return -1;
+    }
+
+    return 0;
+}
+
+int jm_cache_load(const char* dir, const char* anchor_serial, jm_cache_entry_t* entry) {
+    char path[512];
+    jm_cache_header_t header;
+
+    if (dir == NULL || anchor_serial == NULL || entry == NULL) {
+        return -1;
+    }
+    if (cache_path(dir, anchor_serial, path, sizeof(path)) != 0) {
+        return -1;
+    }
+
+    FILE* f = fopen(path, "rb");
+    if (f == NULL) {
+        return -1;
+    }
+
+    memset(entry, 0, sizeof(jm_cache_entry_t));
+    int ok = fread(&header, sizeof(header), 1, f) == 1 &&
+             header.magic == JM_CACHE_MAGIC &&
+             header.version == JM_CACHE_VERSION &&
+             header.slot_size == sizeof(jm_cache_slot_t) &&
+             fread(entry->slots, sizeof(jm_cache_slot_t), 5, f) == 5;
+    fclose(f);
+
+    if (!ok) {
+        return -1;
+    }
+
+    entry->disk_bitmask = header.disk_bitmask;
+
+    /* Never trust strings from disk to be terminated */
+    for (int i = 0; i < 5; i++) {
+        jm_cache_slot_t* slot = &entry->slots[i];
+        slot->model[sizeof(slot->model) - 1] = '\0';
+        slot->serial[sizeof(slot->serial) - 1] = '\0';
+        slot->firmware[sizeof(slot->firmware) - 1] = '\0';
+    }
+
+    return 0;
+}
+
+const jm_cache_slot_t* jm_cache_match_slot(const jm_cache_entry_t* entry, int slot,
+                                           const char* serial, const char* firmware) {
+    if (entry == NULL || slot < 0 || slot >= 5 || serial == NULL || firmware == NULL || serial[0] == '\0') {
+        return NULL;
+    }
+
+    const jm_cache_slot_t* rec = &entry->slots[slot];
+    if (!rec->present || strcmp(rec->serial, serial) != 0 || strcmp(rec->firmware, firmware) != 0) {
+        return NULL;
+    }
+    return rec;
+}
+
+int jm_cache_store(const char* dir, const jm_cache_entry_t* entry) {
+    char path[512];
+    jm_cache_header_t header;
+
+    if (dir == NULL || entry == NULL || !entry->slots[0].present) {
+        return -1;
+    }
+    if (cache_path(dir, entry->slots[0].serial, path, sizeof(path)) != 0) {
+        return -1;
+    }
+
+    memset(&header, 0, sizeof(header));
+    header.magic = JM_CACHE_MAGIC;
+    header.version = JM_CACHE_VERSION;
+    header.slot_size = sizeof(jm_cache_slot_t);
+    header.disk_bitmask = entry->disk_bitmask;
+
+    return store_atomically(dir, path, &header, sizeof(header), entry->slots,
+                            sizeof(jm_cache_slot_t), 5);
+}
+
+int jm_detect_cache_load(const char* dir, jm_scan_entry_t* entries, int max_entries, uint32_t* listing_hash) {
+    char path[512];
+    jm_detect_cache_header_t header;
+
+    if (dir == NULL || entries == NULL || max_entries <= 0 || listing_hash == NULL) {
+        return -1;
+    }
+    snprintf(path, sizeof(path), "%s/%s", dir, JM_DETECT_CACHE_FILE);
+
+    FILE* f = fopen(path, "rb");
+    if (f == NULL) {
+        return -1;
+    }
+
+    int ok = fread(&header, sizeof(header), 1, f) == 1 &&
+             header.magic == JM_DETECT_CACHE_MAGIC &&
+             header.version == JM_DETECT_CACHE_VERSION &&
+             header.entry_size == sizeof(jm_scan_entry_t) &&
+             header.num_entries <= (uint32_t)max_entries &&
+             fread(entries, sizeof(jm_scan_entry_t), header.num_entries, f) == header.num_entries;
+    fclose(f);
+
+    if (!ok) {
+        return -1;
+    }
+
+    *listing_hash = header.listing_hash;
+
+    /* Never trust strings from disk to be terminated */
+    for (uint32_t i = 0; i < header.num_entries; i++) {
+        jm_scan_entry_t* e = &entries[i];
+        e->device_path[sizeof(e->device_path) - 1] = '\0';
+        e->controller_path[sizeof(e->controller_path) - 1] = '\0';
+        e->controller.model[sizeof(e->controller.model) - 1] = '\0';
+        e->controller.description[sizeof(e->controller.description) - 1] = '\0';
+    }
+
+    return (int)header.num_entries;
+}
+
+int jm_detect_cache_store(const char* dir, uint32_t listing_hash,
+                          const jm_scan_entry_t* entries, int num_entries) {
+    char path[512];
+    jm_detect_cache_header_t header;
+
+    if (dir == NULL || (entries == NULL && num_entries > 0) || num_entries < 0) {
+        return -1;
+    }
+    snprintf(path, sizeof(path), "%s/%s", dir, JM_DETECT_CACHE_FILE);
+
+    memset(&header, 0, sizeof(header));
+    header.magic = JM_DETECT_CACHE_MAGIC;
+    header.version = JM_DETECT_CACHE_VERSION;
+    header.entry_size = sizeof(jm_scan_entry_t);
+    header.listing_hash = listing_hash;
+    header.num_entries = (uint32_t)num_entries;
+
+    return store_atomically(dir, path, &header, sizeof(header), entries,
+                            sizeof(jm_scan_entry_t), (size_t)num_entries);
+}
+
+/* Helper: Build "<dir>/<device>.result" */
+static int result_path(const char* dir, const char* device_path, char* path, size_t path_size) {
+    char key[NAME_MAX + 1];
+
+    if (jm_lock_key(device_path, key, sizeof(key)) != 0) {
+        return -1;
+    }
+    int len = snprintf(path, path_size, "%s/%s.result", dir, key);
+    return (len > 0 && (size_t)len < path_size) ? 0 : -1;
+}
+
+int jm_result_load(const char* dir, const char* device_path, jm_result_entry_t* entry) {
+    char path[512];
+    jm_result_header_t header;
+
+    if (dir == NULL || device_path == NULL || entry == NULL) {
+        return -1;
+    }
+    if (result_path(dir, device_path, path, sizeof(path)) != 0) {
+        return -1;
+    }
+
+    FILE* f = fopen(path, "rb");
+    if (f == NULL) {
+        return -1;
+    }
+
+    int ok = fread(&header, sizeof(header), 1, f) == 1 &&
+             header.magic == JM_RESULT_MAGIC &&
+             header.version == JM_RESULT_VERSION &&
+             header.entry_size == sizeof(jm_result_entry_t) &&
+             fread(entry, sizeof(jm_result_entry_t), 1, f) == 1;
+    fclose(f);
+
+    if (!ok) {
+        return -1;
+    }
+
+    /* Never trust strings from disk to be terminated; names point into this process */
+    entry->controller_model[sizeof(entry->controller_model) - 1] = '\0';
+    for (int i = 0; i < 5; i++) {
+        disk_smart_data_t* disk = &entry->disks[i];
+        disk->disk_name[sizeof(disk->disk_name) - 1] = '\0';
+        disk->serial_number[sizeof(disk->serial_number) - 1] = '\0';
+        disk->firmware_rev[sizeof(disk->firmware_rev) - 1] = '\0';
+        if (disk->num_attributes < 0 || disk->num_attributes > MAX_SMART_ATTRIBUTES) {
+            disk->num_attributes = 0;
+        }
+        for (int a = 0; a < disk->num_attributes; a++) {
+            const smart_attribute_def_t* def = get_attribute_definition(disk->attributes[a].id);
+            disk->attributes[a].name = (def != NULL) ? def->name : "Unknown_Attribute";
+        }
+        /* A disk whose SMART read failed stays an error */
+        if (disk->is_present && disk->overall_status != DISK_STATUS_ERROR) {
+            assess_overall_health(disk);
+        }
+    }
+
+    return 0;
+}
+
+int jm_result_store(const char* dir, const char* device_path, const jm_result_entry_t* entry) {
+    char path[512];
+    jm_result_header_t header;
+
+    if (dir == NULL || device_path == NULL || entry == NULL) {
+        return -1;
+    }
+    if (result_path(dir, device_path, path, sizeof(path)) != 0) {
+        return -1;
+    }
+
+    memset(&header, 0, sizeof(header));
+    header.magic = JM_RESULT_MAGIC;
+    header.version = JM_RESULT_VERSION;
+    header.entry_size = sizeof(jm_result_entry_t);
+
+    return store_atomically(dir, path, &header, sizeof(header), entry, sizeof(jm_result_entry_t), 1);
+}
@@ -0,0 +1,142 @@
+/*
+ * jm_cache.h - Part of jm-raid-status
+ *
+ * Copyright (C) 2026 Jamie Treworgy
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef JM_CACHE_H
+#define JM_CACHE_H
+
+#include "smart_parser.h"
+#include "hardware_detect.h"
+#include <stdint.h>
+
+#define JM_CACHE_DEFAULT_DIR "/var/cache/jmraidstatus"
+
+/**
+ * Cached identity and SMART thresholds for one slot
+ * Thresholds don't change for a given drive, so a steady-state poll only
+ * needs IDENTIFY (to confirm the drive) and 0xD0.
+ */
+typedef struct {
+    uint8_t present;                    /* Disk identified in this slot */
+    uint8_t thresholds_valid;           /* thresholds were read successfully */
+    char model[41];
+    char serial[21];
+    char firmware[9];
+    uint64_t size_mb;
+    smart_thresholds_page_t thresholds;
+} jm_cache_slot_t;
+
+/**
+ * Cached state of one controller
+ * Keyed (file name) by the serial of the disk in slot 0. Every poll still
+ * identifies each slot and checks it with jm_cache_match_slot.
+ */
+typedef struct {
+    uint8_t disk_bitmask;               /* Presence bitmask (0x1F0) when cached */
+    jm_cache_slot_t slots[5];
+} jm_cache_entry_t;
+
+/**
+ * Load the cache entry for a controller
+ *
+ * @param dir Cache directory
+ * @param anchor_serial Serial of the disk in slot 0
+ * @param entry Output entry
+ * @return 0 on success, -1 if missing, unreadable or from another version
+ */
+int jm_cache_load(const char* dir, const char* anchor_serial, jm_cache_entry_t* entry);
+
+/**
+ * Cached record of the drive that is in a slot right now
+ * A slot matches only while it holds the same drive (serial) with the same
+ * firmware, so a disk replaced in any slot or reflashed is read again.
+ *
+ * @param entry Entry from jm_cache_load
+ * @param slot Slot number (0-4)
+ * @param serial Serial the slot's IDENTIFY reported
+ * @param firmware Firmware revision the slot's IDENTIFY reported
+ * @return The cached record, or NULL if the slot is not cached for this drive
+ */
+const jm_cache_slot_t* jm_cache_match_slot(const jm_cache_entry_t* entry, int slot,
+                                           const char* serial, const char* firmware);
+
+/**
+ * Store the cache entry for a controller
+ * Written to a temporary file and renamed into place, so concurrent readers
+ * never see a partial entry. Creates the cache directory if needed.
+ *
+ * @param dir Cache directory
+ * @param entry Entry to store (slot 0 must be present; its serial is the key)
+ * @return 0 on success, -1 on error
+ */
+int jm_cache_store(const char* dir, const jm_cache_entry_t* entry);
+
+/**
+ * Load the cached hardware detection (--scan results and per-device detection)
+ * Stored as "<dir>/detect.cache". Entries are keyed by major:minor and
+ * controller sysfs path; check each with scan_entry_is_current before use.
+ *
+ * @param dir Cache directory
+ * @param entries Output entries
+ * @param max_entries Capacity of entries
+ * @param listing_hash Output block_listing_hash of the full scan that wrote the
+ *        file, 0 if the entries were added one device at a time
+ * @return Number of entries, or -1 if missing, unreadable or from another version
+ */
+int jm_detect_cache_load(const char* dir, jm_scan_entry_t* entries, int max_entries, uint32_t* listing_hash);
+
+/**
+ * Store the hardware detection cache (temporary file renamed into place)
+ *
+ * @param dir Cache directory (created if needed)
+ * @param listing_hash block_listing_hash of a full scan, 0 if the list is partial
+ * @param entries Entries to store
+ * @param num_entries Number of entries
+ * @return 0 on success, -1 on error
+ */
+int jm_detect_cache_store(const char* dir, uint32_t listing_hash,
+                          const jm_scan_entry_t* entries, int num_entries);
+
+/**
+ * Last all-disk poll of one controller (--max-age)
+ * Stored in the run directory (JM_RUN_DEFAULT_DIR) as "<device>.result",
+ * keyed like the mailbox lock, so another process can report a recent poll
+ * instead of issuing the commands again.
+ */
+typedef struct {
+    int64_t timestamp;                  /* Unix time of the poll */
+    int expected_array_size;            /* Session setting is_degraded was judged by */
+    int num_disks;
+    int is_degraded;
+    int present_disks;
+    char controller_model[64];          /* Empty if not detected */
+    disk_smart_data_t disks[5];
+} jm_result_entry_t;
+
+/**
+ * Load the last poll of a device
+ * Attribute names are re-resolved and disk health re-assessed under the
+ * current configuration, so a poll stored by a process with another
+ * --config reports this process's verdicts.
+ *
+ * @param dir Run directory
+ * @param device_path Device as given (symlinks are followed)
+ * @param entry Output entry
+ * @return 0 on success, -1 if missing, unreadable or from another version
+ */
+int jm_result_load(const char* dir, const char* device_path, jm_result_entry_t* entry);
+
+/**
+ * Store the last poll of a device (temporary file renamed into place)
+ *
+ * @param dir Run directory (created if needed)
+ * @param device_path Device as given
+ * @param entry Poll to store
+ * @return 0 on success, -1 on error
+ */
+int jm_result_store(const char* dir, const char* device_path, const jm_result_entry_t* entry);
+
+#endif /* JM_CACHE_H */
@@ -7,6 +7,7 @@
 
 #include "jm_commands.h"
 #include "jm_protocol.h"
+#include "jm_cache.h"
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -14,39 +15,50 @@
 
 #define JM_RAID_SCRAMBLED_CMD (0x197b0322)
 
-/* Command counter for scrambled commands */
-static uint32_t cmd_counter = 1;
-
-/* Global runtime context (singleton) */
-static const jm_runtime_context_t* g_runtime_context = NULL;
-
-void jm_set_context(const jm_runtime_context_t* ctx) {
-    g_runtime_context = ctx;
-}
-
-const jm_runtime_context_t* jm_get_context(void) {
-    return g_runtime_context;
-}
-
-/* Helper function to build and execute a scrambled command */
-static int execute_probe_command(int fd, const uint8_t* probe_data, size_t probe_len,
-                                 uint8_t* response, uint32_t sector) {
+/* Helper function to build and execute a scrambled command
+ * CRC mismatches and timeouts are retried up to session->max_retries times
+ * after a jittered backoff. Each attempt is rebuilt with a fresh counter so
+ * the controller never sees a repeated command. */
+static int execute_probe_command(jm_session_t* session, const uint8_t* probe_data, size_t probe_len,
+                                 uint8_t* response) {
     uint8_t cmd_buf[512];
     uint32_t* cmd_buf32 = (uint32_t*)cmd_buf;
     uint32_t* resp_buf32 = (uint32_t*)response;
+    int result = JM_SUCCESS;
+    int attempt;
+
+    for (attempt = 0; attempt <= session->max_retries; attempt++) {
+        if (attempt > 0) {
+            session->retries++;
+            if (session->verbose) {
+                fprintf(stderr, "  %s, retrying (attempt %d of %d, timeout %u ms)\n",
+                        jm_error_string(result), attempt + 1, session->max_retries + 1,
+                        session->timeout_ms);
+            }
+            jm_retry_backoff(session, attempt);
+        }
 
-    /* Zero-fill command buffer */
-    memset(cmd_buf, 0, 512);
+        /* Zero-fill command buffer (jm_execute_command scrambles it in place) */
+        memset(cmd_buf, 0, 512);
 
-    /* Add scrambled command header */
-    cmd_buf32[0] = __cpu_to_le32(JM_RAID_SCRAMBLED_CMD);
-    cmd_buf32[1] = __cpu_to_le32(cmd_counter++);
+        /* Add scrambled command header */
+        cmd_buf32[0] = __cpu_to_le32(JM_RAID_SCRAMBLED_CMD);
+        cmd_buf32[1] = __cpu_to_le32(session->cmd_counter++);
 
-    /* Copy probe command data */
-    memcpy(cmd_buf + 8, probe_data, probe_len);
+        /* Copy probe command data */
+        memcpy(cmd_buf + 8, probe_data, probe_len);
 
-    /* Execute command */
-    int result = jm_execute_command(fd, cmd_buf32, resp_buf32, sector);
+        /* Execute command */
+        result = jm_execute_command(session, cmd_buf32, resp_buf32);
+        if (!jm_is_retryable(result)) {
+            break;
+        }
+    }
+
+    if (jm_is_retryable(result)) {
+        fprintf(stderr, "Warning: %s after %d attempt%s\n", jm_error_string(result),
+                attempt, attempt == 1 ? "" : "s");
+    }
 
     /* Return success only if command succeeded */
     return (result == JM_SUCCESS) ? 0 : -1;
@@ -116,17 +128,11 @@ static int validate_identify_response(const uint8_t* response) {
     return 1;  // Looks like a valid disk
 }
 
-int jm_get_disk_identify(int fd, int disk_num, char* model, char* serial, char* firmware, uint64_t* size_mb, uint8_t* disk_bitmask) {
+int jm_get_disk_identify(jm_session_t* session, int disk_num, char* model, char* serial, char* firmware, uint64_t* size_mb, uint8_t* disk_bitmask) {
     if (disk_num < 0 || disk_num > 4) {
         return -1;
     }
 
-    const jm_runtime_context_t* ctx = jm_get_context();
-    if (ctx == NULL) {
-        fprintf(stderr, "Error: Runtime context not initialized\n");
-        return -1;
-    }
-
     /* Build IDENTIFY DEVICE command for specified disk (probe11-15) */
     uint8_t probe_cmd[] = {
         0x00, 0x02, 0x02, 0xff,
@@ -138,13 +144,13 @@ int jm_get_disk_identify(int fd, int disk_num, char* model, char* serial, char*
     uint8_t response[512];
 
     /* Execute command - CRC failures indicate communication errors */
-    if (execute_probe_command(fd, probe_cmd, sizeof(probe_cmd), response, ctx->sector) != 0) {
+    if (execute_probe_command(session, probe_cmd, sizeof(probe_cmd), response) != 0) {
         /* CRC error or communication failure - this is a real error */
         return -1;
     }
 
     /* Dump raw response if debug mode enabled */
-    if (ctx->dump_raw) {
+    if (session->dump_raw) {
         fprintf(stderr, "\n=== IDENTIFY DISK %d RESPONSE (512 bytes) ===\n", disk_num);
         for (int i = 0; i < 512; i += 16) {
             fprintf(stderr, "%04x: ", i);
@@ -217,27 +223,72 @@ int jm_get_disk_identify(int fd, int disk_num, char* model, char* serial, char*
     return 0;  /* Success: real disk with valid data */
 }
 
-int jm_get_disk_names(int fd, char disk_names[5][64]) {
+int jm_probe_awake(jm_session_t* session) {
+    static const uint8_t probe_cmd[] = { 0x00, 0x02, 0x02, 0xff, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
+    uint32_t cmd_buf32[128];
+    uint32_t plain[128];
+    uint32_t resp_buf32[128];
+    uint32_t counter = session->cmd_counter++;
+
+    memset(cmd_buf32, 0, sizeof(cmd_buf32));
+    cmd_buf32[0] = __cpu_to_le32(JM_RAID_SCRAMBLED_CMD);
+    cmd_buf32[1] = __cpu_to_le32(counter);
+    memcpy((uint8_t*)cmd_buf32 + 8, probe_cmd, sizeof(probe_cmd));
+    memcpy(plain, cmd_buf32, sizeof(plain));
+
+    /* One attempt: a failure just means the full wakeup */
+    if (jm_execute_command(session, cmd_buf32, resp_buf32) != JM_SUCCESS) {
+        return 0;
+    }
+    if (resp_buf32[0] != __cpu_to_le32(JM_RAID_SCRAMBLED_CMD) || resp_buf32[1] != __cpu_to_le32(counter)) {
+        return 0;
+    }
+
+    /* Descrambled, a command read back passes the CRC check like a
+     * response; an answer differs from it before the CRC word */
+    return memcmp(plain, resp_buf32, 0x7f * sizeof(uint32_t)) != 0;
+}
+
+int jm_wake(jm_session_t* session) {
+    if (session->warm_probe && jm_probe_awake(session)) {
+        if (session->verbose) {
+            fprintf(stderr, "Controller already awake; wakeup sequence skipped\n");
+        }
+        return JM_SUCCESS;
+    }
+    return jm_send_wakeup(session);
+}
+
+int jm_get_raid_flags(jm_session_t* session, jm_raid_flags_t* flags) {
+    /* IDENTIFY DEVICE for slot 0: the flags are in every response, even an empty slot's */
+    static const uint8_t probe_cmd[] = { 0x00, 0x02, 0x02, 0xff, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
+    uint8_t response[512];
+
+    if (execute_probe_command(session, probe_cmd, sizeof(probe_cmd), response) != 0) {
+        return -1;
+    }
+    memcpy(flags->raw, response + 0x1F0, sizeof(flags->raw));
+    flags->presence = response[0x1F0];
+    flags->rebuild = response[0x1F5];
+    flags->phase = response[0x1FA];
+    return 0;
+}
+
+int jm_get_disk_names(jm_session_t* session, char disk_names[5][64]) {
     /* Use IDENTIFY DEVICE to get model names */
     for (int i = 0; i < 5; i++) {
-        if (jm_get_disk_identify(fd, i, disk_names[i], NULL, NULL, NULL, NULL) != 0) {
+        if (jm_get_disk_identify(session, i, disk_names[i], NULL, NULL, NULL, NULL) != 0) {
             memset(disk_names[i], 0, 64);
         }
     }
     return 0;
 }
 
-int jm_smart_read_values(int fd, int disk_num, smart_values_page_t* values) {
+int jm_smart_read_values(jm_session_t* session, int disk_num, smart_values_page_t* values) {
     if (disk_num < 0 || disk_num > 4 || values == NULL) {
         return -1;
     }
 
-    const jm_runtime_context_t* ctx = jm_get_context();
-    if (ctx == NULL) {
-        fprintf(stderr, "Error: Runtime context not initialized\n");
-        return -1;
-    }
-
     /* Build SMART READ ATTRIBUTE VALUE command for specified disk */
     uint8_t probe_cmd[] = {
         0x00, 0x02, 0x03, 0xff,
@@ -250,12 +301,12 @@ int jm_smart_read_values(int fd, int disk_num, smart_values_page_t* values) {
 
     uint8_t response[512];
 
-    if (execute_probe_command(fd, probe_cmd, sizeof(probe_cmd), response, ctx->sector) != 0) {
+    if (execute_probe_command(session, probe_cmd, sizeof(probe_cmd), response) != 0) {
         return -1;
     }
 
     /* Dump raw response if debug mode enabled */
-    if (ctx->dump_raw) {
+    if (session->dump_raw) {
         fprintf(stderr, "\n=== SMART VALUES DISK %d RESPONSE (512 bytes) ===\n", disk_num);
         fprintf(stderr, "First 32 bytes are JMicron header/echo:\n");
         for (int i = 0; i < 32; i += 16) {
@@ -281,17 +332,11 @@ int jm_smart_read_values(int fd, int disk_num, smart_values_page_t* values) {
     return smart_parse_values(response + 0x20, values);
 }
 
-int jm_smart_read_thresholds(int fd, int disk_num, smart_thresholds_page_t* thresholds) {
+int jm_smart_read_thresholds(jm_session_t* session, int disk_num, smart_thresholds_page_t* thresholds) {
     if (disk_num < 0 || disk_num > 4 || thresholds == NULL) {
         return -1;
     }
 
-    const jm_runtime_context_t* ctx = jm_get_context();
-    if (ctx == NULL) {
-        fprintf(stderr, "Error: Runtime context not initialized\n");
-        return -1;
-    }
-
     /* Build SMART READ ATTRIBUTE THRESHOLDS command for specified disk */
     uint8_t probe_cmd[] = {
         0x00, 0x02, 0x03, 0xff,
@@ -304,7 +349,7 @@ int jm_smart_read_thresholds(int fd, int disk_num, smart_thresholds_page_t* thre
 
     uint8_t response[512];
 
-    if (execute_probe_command(fd, probe_cmd, sizeof(probe_cmd), response, ctx->sector) != 0) {
+    if (execute_probe_command(session, probe_cmd, sizeof(probe_cmd), response) != 0) {
         return -1;
     }
 
@@ -313,14 +358,23 @@ int jm_smart_read_thresholds(int fd, int disk_num, smart_thresholds_page_t* thre
     return smart_parse_thresholds(response + 0x20, thresholds);
 }
 
-int jm_get_disk_smart_data(int fd, int disk_num, const char* disk_name,
-                            disk_smart_data_t* data) {
+/* Helper: Read SMART values and thresholds and assess health
+ * cached_thresholds (may be NULL) skips the 0xD1 read. thresholds_out (may be
+ * NULL) receives the thresholds that were used; *thresholds_ok is set to 1
+ * when they came from the drive or the cache rather than the zeroed fallback. */
+static int read_disk_smart(jm_session_t* session, int disk_num, const char* disk_name,
+                           const smart_thresholds_page_t* cached_thresholds,
+                           smart_thresholds_page_t* thresholds_out, int* thresholds_ok,
+                           disk_smart_data_t* data) {
     smart_values_page_t values;
     smart_thresholds_page_t thresholds;
 
     if (data == NULL) {
         return -1;
     }
+    if (thresholds_ok != NULL) {
+        *thresholds_ok = 0;
+    }
 
     /* Initialize basic disk info */
     memset(data, 0, sizeof(disk_smart_data_t));
@@ -332,7 +386,7 @@ int jm_get_disk_smart_data(int fd, int disk_num, const char* disk_name,
     }
 
     /* Read SMART values (optional - disk still shown if unavailable) */
-    if (jm_smart_read_values(fd, disk_num, &values) != 0) {
+    if (jm_smart_read_values(session, disk_num, &values) != 0) {
         /* SMART VALUES unavailable - show disk with warning */
         data->overall_status = DISK_STATUS_ERROR;
         fprintf(stderr, "Warning: SMART data unavailable for disk %d (%s)\n",
@@ -341,17 +395,173 @@ int jm_get_disk_smart_data(int fd, int disk_num, const char* disk_name,
     }
 
     /* Read SMART thresholds (optional - will use defaults if unavailable) */
-    if (jm_smart_read_thresholds(fd, disk_num, &thresholds) != 0) {
+    if (cached_thresholds != NULL) {
+        thresholds = *cached_thresholds;
+        if (thresholds_ok != NULL) {
+            *thresholds_ok = 1;
+        }
+    } else if (!(session->reads & JM_READ_THRESHOLDS)) {
+        /* Not wanted: only the manufacturer threshold checks are skipped */
+        memset(&thresholds, 0, sizeof(thresholds));
+    } else if (jm_smart_read_thresholds(session, disk_num, &thresholds) != 0) {
         /* Thresholds unavailable - zero them out and use default checks instead */
         memset(&thresholds, 0, sizeof(thresholds));
         fprintf(stderr, "Warning: SMART thresholds unavailable for disk %d, using default checks\n", disk_num);
+    } else if (thresholds_ok != NULL) {
+        *thresholds_ok = 1;
+    }
+
+    if (thresholds_out != NULL) {
+        *thresholds_out = thresholds;
     }
 
     /* Combine and assess health */
     return smart_combine_data(disk_num, disk_name, &values, &thresholds, data);
 }
 
-int jm_get_all_disks_smart_data(int fd, disk_smart_data_t data[5], int* num_disks, int* is_degraded, int* present_disks) {
+int jm_get_disk_smart_data(jm_session_t* session, int disk_num, const char* disk_name,
+                            disk_smart_data_t* data) {
+    return read_disk_smart(session, disk_num, disk_name, NULL, NULL, NULL, data);
+}
+
+uint8_t jm_plan_identify_slots(int slot0_result, uint8_t disk_bitmask) {
+    const uint8_t full_sweep = 0x1E;  /* Slots 1-4 */
+
+    /* No bitmask without a valid response from slot 0 */
+    if (slot0_result != 0 && slot0_result != -2) {
+        return full_sweep;
+    }
+
+    /* Only slots 0-4 exist, and a live controller reports at least one disk */
+    if (disk_bitmask == 0 || (disk_bitmask & ~0x1F) != 0) {
+        return full_sweep;
+    }
+
+    /* Bit 0 must agree with what slot 0 actually returned */
+    if (((disk_bitmask & 0x01) != 0) != (slot0_result == 0)) {
+        return full_sweep;
+    }
+
+    return disk_bitmask & full_sweep;
+}
+
+/* Helper: IDENTIFY one slot into a cache record
+ * Adds the retries it took to *retries.
+ * Returns the jm_get_disk_identify result (0, -1 or -2) */
+static int identify_slot(jm_session_t* session, int slot, jm_cache_slot_t* rec, uint8_t* bitmask,
+                         uint32_t* retries) {
+    uint32_t retries_before = session->retries;
+
+    memset(rec, 0, sizeof(jm_cache_slot_t));
+
+    if (session->verbose) {
+        fprintf(stderr, "  Probing disk slot %d...\n", slot);
+    }
+
+    /* Return codes:
+     *   0 = disk present and identified successfully
+     *  -1 = communication error (CRC failure, etc.) - will have printed warning
+     *  -2 = no disk in slot (empty, but communication OK) */
+    int identify_result = jm_get_disk_identify(session, slot, rec->model, rec->serial,
+                                               rec->firmware, &rec->size_mb, bitmask);
+    *retries += session->retries - retries_before;
+
+    if (identify_result == -2) {
+        /* Empty slot - not an error */
+        if (session->verbose) {
+            fprintf(stderr, "    Slot %d: Empty (no disk present)\n", slot);
+        }
+    } else if (identify_result != 0) {
+        /* Communication error - warning already printed, skip this disk */
+        if (session->verbose) {
+            fprintf(stderr, "    Slot %d: Communication error\n", slot);
+        }
+    } else {
+        rec->present = 1;
+        if (session->verbose) {
+            fprintf(stderr, "    Slot %d: Found disk - %s\n", slot, rec->model);
+        }
+    }
+
+    return identify_result;
+}
+
+/* Helper: Read SMART data for an identified slot and attach its identity
+ * With use_cached_thresholds the record's thresholds replace the 0xD1 read;
+ * otherwise the thresholds read are stored back into the record. Without
+ * JM_READ_VALUES the disk gets its identity only (no SMART commands).
+ * Counts the disk in *disks_found when its SMART data was read. */
+static void read_slot_smart(jm_session_t* session, int slot, jm_cache_slot_t* rec,
+                            int use_cached_thresholds, disk_smart_data_t* data, int* disks_found) {
+    const smart_thresholds_page_t* cached = NULL;
+    int thresholds_ok = 0;
+    uint32_t retries_before = session->retries;
+
+    if (use_cached_thresholds && rec->thresholds_valid) {
+        cached = &rec->thresholds;
+    }
+
+    if (!(session->reads & JM_READ_VALUES)) {
+        memset(data, 0, sizeof(disk_smart_data_t));
+        data->disk_number = slot;
+        data->is_present = 1;
+        data->overall_status = DISK_STATUS_ERROR;  /* No SMART data, as when 0xD0 fails */
+        strncpy(data->disk_name, rec->model, sizeof(data->disk_name) - 1);
+        thresholds_ok = rec->thresholds_valid;
+    }
+    if (!(session->reads & JM_READ_VALUES) ||
+        read_disk_smart(session, slot, rec->model, cached, &rec->thresholds, &thresholds_ok, data) == 0) {
+        /* Disk exists and SMART data retrieved successfully - store disk info
+         * NOTE: Must do this AFTER read_disk_smart because smart_combine_data
+         * clears the structure with memset() */
+        strncpy(data->serial_number, rec->serial, sizeof(data->serial_number) - 1);
+        data->serial_number[sizeof(data->serial_number) - 1] = '\0';
+        strncpy(data->firmware_rev, rec->firmware, sizeof(data->firmware_rev) - 1);
+        data->firmware_rev[sizeof(data->firmware_rev) - 1] = '\0';
+        data->size_mb = rec->size_mb;
+        data->command_retries = session->retries - retries_before;
+        (*disks_found)++;
+    }
+    rec->thresholds_valid = (uint8_t)thresholds_ok;
+}
+
+/* Helper: Take the cached thresholds for a freshly identified slot
+ * Only if the cache holds this very drive (serial and firmware) in this
+ * slot, so a replaced disk is never judged by its predecessor's thresholds.
+ * Returns 1 if the record now has thresholds, 0 if 0xD1 must be read */
+static int adopt_cached_thresholds(jm_session_t* session, int slot, jm_cache_slot_t* rec,
+                                   const jm_cache_entry_t* cached) {
+    const jm_cache_slot_t* match = cached ? jm_cache_match_slot(cached, slot, rec->serial, rec->firmware) : NULL;
+
+    if (match == NULL || !match->thresholds_valid) {
+        if (cached != NULL && session->verbose) {
+            fprintf(stderr, "    Slot %d: Not in the cache, reading thresholds\n", slot);
+        }
+        return 0;
+    }
+    rec->thresholds = match->thresholds;
+    rec->thresholds_valid = 1;
+    if (session->verbose) {
+        fprintf(stderr, "    Slot %d: Thresholds from the cache\n", slot);
+    }
+    return 1;
+}
+
+/* Helper: IDENTIFY one slot and, if a disk is there, read its SMART data
+ * Sets *cache_miss when the slot's thresholds had to be read. */
+static int probe_slot(jm_session_t* session, int slot, jm_cache_slot_t* rec, const jm_cache_entry_t* cached,
+                      disk_smart_data_t* data, uint8_t* bitmask, uint32_t* retries, int* disks_found,
+                      int* cache_miss) {
+    int identify_result = identify_slot(session, slot, rec, bitmask, retries);
+    if (identify_result == 0) {
+        int hit = adopt_cached_thresholds(session, slot, rec, cached);
+        *cache_miss |= !hit;
+        read_slot_smart(session, slot, rec, hit, data, disks_found);
+    }
+    return identify_result;
+}
+
+int jm_get_all_disks_smart_data(jm_session_t* session, disk_smart_data_t data[5], int* num_disks, int* is_degraded, int* present_disks) {
     int disks_found = 0;
     int degraded = 0;
     uint8_t disk_bitmask = 0;
@@ -361,85 +571,125 @@ int jm_get_all_disks_smart_data(int fd, disk_smart_data_t data[5], int* num_disk
         return -1;
     }
 
-    const jm_runtime_context_t* ctx = jm_get_context();
-    if (ctx == NULL) {
-        fprintf(stderr, "Error: Runtime context not initialized\n");
-        return -1;
-    }
-
     if (is_degraded != NULL) {
         *is_degraded = 0;
     }
 
-    /* Query each possible disk (0-4) */
+    /* Initialize data for every slot (unprobed slots stay not-present) */
     for (int i = 0; i < 5; i++) {
-        char model[41] = {0};
-        char serial[21] = {0};
-        char firmware[9] = {0};
-        uint64_t size_mb = 0;
-        uint8_t bitmask_temp = 0;
-
-        if (ctx->verbose) {
-            fprintf(stderr, "  Probing disk slot %d...\n", i);
-        }
-
-        /* Initialize data for this slot */
         memset(&data[i], 0, sizeof(disk_smart_data_t));
         data[i].disk_number = i;
         data[i].is_present = 0;
+    }
+
+    /* Identity and thresholds of every slot, stored as the cache entry */
+    jm_cache_entry_t cache;
+    memset(&cache, 0, sizeof(cache));
+    int comm_errors = 0;
+
+    /* IDENTIFY retries per slot, added to the disk's SMART retries at the end */
+    uint32_t identify_retries[5] = {0};
+
+    /* Slot 0 is always identified; its response carries the presence bitmask,
+     * which is the same in all responses (even for empty slots) */
+    int slot0_result = identify_slot(session, 0, &cache.slots[0], &disk_bitmask, &identify_retries[0]);
+    bitmask_captured = (slot0_result == 0 || slot0_result == -2);
+    comm_errors += (slot0_result == -1);
+
+    /* The cache entry is found by the slot 0 serial, but each slot is still
+     * identified and only reuses its thresholds while it holds the same drive:
+     * replacing a disk in slots 1-4 leaves the bitmask unchanged */
+    jm_cache_entry_t loaded;
+    const jm_cache_entry_t* cached = NULL;
+    int cache_miss = 0;
+    if (session->cache_dir != NULL && slot0_result == 0) {
+        if (jm_cache_load(session->cache_dir, cache.slots[0].serial, &loaded) == 0) {
+            cached = &loaded;
+            if (session->verbose) {
+                fprintf(stderr, "  Cache entry for %s, skipping thresholds of unchanged disks\n",
+                        cache.slots[0].serial);
+            }
+        } else if (session->verbose) {
+            fprintf(stderr, "  No valid cache entry for %s\n", cache.slots[0].serial);
+        }
+        cache_miss = (cached == NULL || cached->disk_bitmask != disk_bitmask);
+    }
+
+    if (slot0_result == 0) {
+        int hit = adopt_cached_thresholds(session, 0, &cache.slots[0], cached);
+        cache_miss |= !hit;
+        read_slot_smart(session, 0, &cache.slots[0], hit, &data[0], &disks_found);
+    }
+
+    /* Probe only the slots the bitmask marks present, unless the bitmask
+     * looks inconsistent, in which case sweep slots 1-4 as before */
+    uint8_t planned = jm_plan_identify_slots(slot0_result, disk_bitmask);
+    uint8_t probed = 0x01;
+    int plan_mismatch = 0;
+
+    if (session->verbose && bitmask_captured) {
+        fprintf(stderr, "  Presence bitmask 0x%02x, probing slot mask 0x%02x\n",
+                disk_bitmask, planned | 0x01);
+    }
+
+    for (int i = 1; i < 5; i++) {
+        if (!(planned & (1 << i))) {
+            continue;
+        }
 
-        /* First try to IDENTIFY the disk
-         * Return codes:
-         *   0 = disk present and identified successfully
-         *  -1 = communication error (CRC failure, etc.) - will have printed warning
-         *  -2 = no disk in slot (empty, but communication OK) */
-        int identify_result = jm_get_disk_identify(fd, i, model, serial, firmware, &size_mb, &bitmask_temp);
+        uint8_t bitmask_temp = 0;
+        int identify_result = probe_slot(session, i, &cache.slots[i], cached, &data[i], &bitmask_temp,
+                                         &identify_retries[i], &disks_found, &cache_miss);
+        probed |= (uint8_t)(1 << i);
+        comm_errors += (identify_result == -1);
 
-        /* Capture disk bitmask from first successful response (even if slot is empty)
-         * The bitmask is the same in all responses, so we only need it once */
+        /* Capture the bitmask from the first successful response */
         if (!bitmask_captured && (identify_result == 0 || identify_result == -2)) {
             disk_bitmask = bitmask_temp;
             bitmask_captured = 1;
         }
 
-        if (identify_result == -2) {
-            /* Empty slot - not an error, just continue */
-            if (ctx->verbose) {
-                fprintf(stderr, "    Slot %d: Empty (no disk present)\n", i);
-            }
-            continue;
-        } else if (identify_result != 0) {
-            /* Communication error - warning already printed, skip this disk */
-            if (ctx->verbose) {
-                fprintf(stderr, "    Slot %d: Communication error\n", i);
-            }
-            continue;
+        /* A slot the bitmask marked present turned out empty */
+        if (identify_result == -2 && planned != 0x1E) {
+            plan_mismatch = 1;
         }
+    }
 
-        if (ctx->verbose) {
-            fprintf(stderr, "    Slot %d: Found disk - %s\n", i, model);
+    /* The bitmask was wrong about at least one slot - don't trust it for the rest */
+    if (plan_mismatch) {
+        if (session->verbose) {
+            fprintf(stderr, "  Bitmask 0x%02x disagrees with IDENTIFY, probing remaining slots\n",
+                    disk_bitmask);
         }
+        for (int i = 1; i < 5; i++) {
+            if (!(probed & (1 << i))) {
+                uint8_t bitmask_temp = 0;
+                comm_errors += (probe_slot(session, i, &cache.slots[i], cached, &data[i], &bitmask_temp,
+                                           &identify_retries[i], &disks_found, &cache_miss) == -1);
+            }
+        }
+    }
 
-        /* Get SMART data */
-        if (jm_get_disk_smart_data(fd, i, model, &data[i]) == 0) {
-            /* Disk exists and SMART data retrieved successfully - store disk info
-             * NOTE: Must do this AFTER jm_get_disk_smart_data because smart_combine_data
-             * clears the structure with memset() */
-            strncpy(data[i].serial_number, serial, sizeof(data[i].serial_number) - 1);
-            data[i].serial_number[sizeof(data[i].serial_number) - 1] = '\0';
-            strncpy(data[i].firmware_rev, firmware, sizeof(data[i].firmware_rev) - 1);
-            data[i].firmware_rev[sizeof(data[i].firmware_rev) - 1] = '\0';
-            data[i].size_mb = size_mb;
-            disks_found++;
+    /* Only cache a complete picture of the array, and only when it changed */
+    if (session->cache_dir != NULL && slot0_result == 0 && cache_miss && comm_errors == 0 && !plan_mismatch) {
+        cache.disk_bitmask = disk_bitmask;
+        if (jm_cache_store(session->cache_dir, &cache) != 0 && session->verbose) {
+            fprintf(stderr, "  Warning: Could not write cache entry in %s\n", session->cache_dir);
         }
     }
 
     *num_disks = disks_found;
 
+    for (int i = 0; i < 5; i++) {
+        if (data[i].is_present) {
+            data[i].command_retries += identify_retries[i];
+        }
+    }
+
     /* Check for degraded RAID using the disk presence bitmask from 0x1F0
      * The controller reports which disks are present via a bitmask
      * If expected_array_size is specified, compare actual vs expected */
-    if (ctx->expected_array_size > 0 && bitmask_captured) {
+    if (session->expected_array_size > 0 && bitmask_captured) {
         /* Count the number of present disks using popcount */
         int disks_from_bitmask = 0;
         for (int i = 0; i < 8; i++) {
@@ -454,22 +704,22 @@ int jm_get_all_disks_smart_data(int fd, disk_smart_data_t data[5], int* num_disk
         }
 
         /* Compare to expected array size */
-        if (disks_from_bitmask < ctx->expected_array_size) {
+        if (disks_from_bitmask < session->expected_array_size) {
             degraded = 1;
-            if (ctx->verbose) {
+            if (session->verbose) {
                 fprintf(stderr, "\n*** DEGRADED RAID DETECTED (bitmask 0x%02x) ***\n", disk_bitmask);
                 fprintf(stderr, "    Expected %d disk%s, found %d disk%s present\n",
-                        ctx->expected_array_size, ctx->expected_array_size == 1 ? "" : "s",
+                        session->expected_array_size, session->expected_array_size == 1 ? "" : "s",
                         disks_from_bitmask, disks_from_bitmask == 1 ? "" : "s");
                 fprintf(stderr, "    RAID array is operating in degraded mode\n");
                 fprintf(stderr, "    One or more disks have failed or been removed\n");
                 fprintf(stderr, "    CRITICAL: Array has REDUCED or NO redundancy!\n\n");
             }
-        } else if (disks_from_bitmask > ctx->expected_array_size) {
-            if (ctx->verbose) {
+        } else if (disks_from_bitmask > session->expected_array_size) {
+            if (session->verbose) {
                 fprintf(stderr, "\n*** WARNING: MORE DISKS THAN EXPECTED (bitmask 0x%02x) ***\n", disk_bitmask);
                 fprintf(stderr, "    Expected %d disk%s, found %d disk%s present\n",
-                        ctx->expected_array_size, ctx->expected_array_size == 1 ? "" : "s",
+                        session->expected_array_size, session->expected_array_size == 1 ? "" : "s",
                         disks_from_bitmask, disks_from_bitmask == 1 ? "" : "s");
                 fprintf(stderr, "    This may indicate:\n");
                 fprintf(stderr, "    - Incorrect --array-size specified\n");
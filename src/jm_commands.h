@@ -9,106 +9,142 @@
 #define JM_COMMANDS_H
 
 #include "smart_parser.h"
+#include "jm_protocol.h"
 #include <stdint.h>
 
 /**
- * Global runtime context for command execution
- * Set once at program start, accessed globally
+ * Read disk identify information from RAID controller
+ * Executes ATA IDENTIFY DEVICE command (probe11-15) to get disk info
+ * Uses the session's sector and dump_raw settings
+ *
+ * @param session Session from jm_init_device (after jm_send_wakeup)
+ * @param disk_num Disk number (0-4)
+ * @param model Output buffer for model name (40 bytes minimum)
+ * @param serial Output buffer for serial number (20 bytes minimum)
+ * @param firmware Output buffer for firmware revision (8 bytes minimum)
+ * @param size_mb Output pointer for disk size in MB (can be NULL)
+ * @param disk_bitmask Output pointer for disk presence bitmask from 0x1F0 (can be NULL)
+ * @return 0 on success, -1 on error, -2 on empty slot
  */
+int jm_get_disk_identify(jm_session_t* session, int disk_num, char* model, char* serial, char* firmware, uint64_t* size_mb, uint8_t* disk_bitmask);
+
+/* RAID-wide status bytes at 0x1F0-0x1FB of every IDENTIFY response (the CRC follows) */
 typedef struct {
-    int verbose;              /* Verbose output */
-    int dump_raw;            /* Dump raw protocol data */
-    uint32_t sector;         /* Sector number for communication */
-    int expected_array_size; /* Expected number of disks (0 = not specified) */
-} jm_runtime_context_t;
+    uint8_t presence;                   /* 0x1F0: bit N = disk N present */
+    uint8_t rebuild;                    /* 0x1F5: 0x01 while rebuilding */
+    uint8_t phase;                      /* 0x1FA: changes across a rebuild (meaning unknown) */
+    uint8_t raw[12];                    /* 0x1F0-0x1FB as read */
+} jm_raid_flags_t;
 
 /**
- * Set global runtime context (singleton)
- * Call once at program startup
+ * Read the RAID status flags with one IDENTIFY round trip (no SMART reads)
+ * Cheap enough to poll far more often than the full SMART query.
+ *
+ * @param session Session from jm_init_device (after jm_send_wakeup)
+ * @param flags Output flags
+ * @return 0 on success, -1 on error
  */
-void jm_set_context(const jm_runtime_context_t* ctx);
+int jm_get_raid_flags(jm_session_t* session, jm_raid_flags_t* flags);
 
 /**
- * Get global runtime context
- * @return Pointer to current context, or NULL if not set
+ * Check whether the controller is already awake, with one command
+ * Sends one scrambled IDENTIFY (slot 0) without retries. The controller is
+ * awake if the response CRC verifies, its header echoes the command counter,
+ * and it is not just the command read back (an idle controller leaves the
+ * written sector in place).
+ *
+ * @param session Session from jm_init_device
+ * @return 1 if awake, 0 if the wakeup sequence is needed
  */
-const jm_runtime_context_t* jm_get_context(void);
+int jm_probe_awake(jm_session_t* session);
 
 /**
- * Read disk identify information from RAID controller
- * Executes ATA IDENTIFY DEVICE command (probe11-15) to get disk info
- * Uses global runtime context for sector and dump_raw settings
+ * Wake the controller before a poll
+ * With session->warm_probe set, probes first (jm_probe_awake) and sends
+ * the four-sector wakeup only if the probe fails; otherwise always sends it.
  *
- * @param fd File descriptor from jm_init_device
- * @param disk_num Disk number (0-4)
- * @param model Output buffer for model name (40 bytes minimum)
- * @param serial Output buffer for serial number (20 bytes minimum)
- * @param firmware Output buffer for firmware revision (8 bytes minimum)
- * @param size_mb Output pointer for disk size in MB (can be NULL)
- * @param disk_bitmask Output pointer for disk presence bitmask from 0x1F0 (can be NULL)
- * @return 0 on success, -1 on error, -2 on empty slot
+ * @param session Session from jm_init_device
+ * @return JM_SUCCESS on success, error code from jm_send_wakeup on failure
  */
-int jm_get_disk_identify(int fd, int disk_num, char* model, char* serial, char* firmware, uint64_t* size_mb, uint8_t* disk_bitmask);
+int jm_wake(jm_session_t* session);
 
 /**
  * Read disk names from RAID controller (deprecated - use jm_get_disk_identify)
  * Executes probe9 command to get disk model names
- * Uses global runtime context for sector setting
  *
- * @param fd File descriptor from jm_init_device
+ * @param session Session from jm_init_device (after jm_send_wakeup)
  * @param disk_names Output array of 5 disk name strings (64 bytes each)
  * @return 0 on success, -1 on error
  */
-int jm_get_disk_names(int fd, char disk_names[5][64]);
+int jm_get_disk_names(jm_session_t* session, char disk_names[5][64]);
 
 /**
  * Read SMART attribute values for a disk
  * Executes ATA SMART READ ATTRIBUTE VALUE (0xD0) command
- * Uses global runtime context for sector and dump_raw settings
+ * Uses the session's sector and dump_raw settings
  *
- * @param fd File descriptor from jm_init_device
+ * @param session Session from jm_init_device (after jm_send_wakeup)
  * @param disk_num Disk number (0-4)
  * @param values Output SMART values structure
  * @return 0 on success, -1 on error
  */
-int jm_smart_read_values(int fd, int disk_num, smart_values_page_t* values);
+int jm_smart_read_values(jm_session_t* session, int disk_num, smart_values_page_t* values);
 
 /**
  * Read SMART attribute thresholds for a disk
  * Executes ATA SMART READ ATTRIBUTE THRESHOLDS (0xD1) command
- * Uses global runtime context for sector setting
  *
- * @param fd File descriptor from jm_init_device
+ * @param session Session from jm_init_device (after jm_send_wakeup)
  * @param disk_num Disk number (0-4)
  * @param thresholds Output SMART thresholds structure
  * @return 0 on success, -1 on error
  */
-int jm_smart_read_thresholds(int fd, int disk_num, smart_thresholds_page_t* thresholds);
+int jm_smart_read_thresholds(jm_session_t* session, int disk_num, smart_thresholds_page_t* thresholds);
 
 /**
  * Get complete SMART data for a disk (values + thresholds + health assessment)
- * Uses global runtime context for sector and dump_raw settings
+ * Uses the session's sector and dump_raw settings
  *
- * @param fd File descriptor from jm_init_device
+ * @param session Session from jm_init_device (after jm_send_wakeup)
  * @param disk_num Disk number (0-4)
  * @param disk_name Disk model name (can be NULL)
  * @param data Output complete SMART data with health assessment
  * @return 0 on success, -1 on error
  */
-int jm_get_disk_smart_data(int fd, int disk_num, const char* disk_name,
+int jm_get_disk_smart_data(jm_session_t* session, int disk_num, const char* disk_name,
                             disk_smart_data_t* data);
 
+/**
+ * Decide which of slots 1-4 need an IDENTIFY after slot 0 has been probed
+ * Uses the presence bitmask from the slot 0 response (offset 0x1F0) so empty
+ * slots cost no round trip. Falls back to a full sweep (0x1E) when no bitmask
+ * was returned, it is zero, it has bits above slot 4, or bit 0 disagrees with
+ * the slot 0 result.
+ *
+ * @param slot0_result jm_get_disk_identify result for slot 0 (0, -1 or -2)
+ * @param disk_bitmask Presence bitmask from the slot 0 response
+ * @return Bitmask of slots 1-4 to probe (bit N = slot N)
+ */
+uint8_t jm_plan_identify_slots(int slot0_result, uint8_t disk_bitmask);
+
 /**
  * Get SMART data for all disks in the array
- * Uses global runtime context for sector, dump_raw, verbose, and expected_array_size settings
+ * Probes slot 0, then only the slots its presence bitmask marks present
+ * (see jm_plan_identify_slots)
+ * Commands run strictly one at a time: the controller has a single mailbox
+ * sector, so a command's response must be read back before the next one is
+ * written. The host-side work around each round trip (smart/disk_host_work
+ * in bench/) is microseconds against milliseconds of SG_IO, so it is not
+ * overlapped with the transfers.
+ * Uses the session's dump_raw, verbose, and expected_array_size settings
  *
- * @param fd File descriptor from jm_init_device
+ * @param session Session from jm_init_device (after jm_send_wakeup)
  * @param data Output array of SMART data (must have space for 5 disks)
  * @param num_disks Output number of disks found
  * @param is_degraded Optional output: set to 1 if degraded RAID detected, 0 otherwise (can be NULL)
  * @param present_disks Optional output: number of disks reported by controller bitmask (can be NULL)
  * @return 0 on success, -1 on error
  */
-int jm_get_all_disks_smart_data(int fd, disk_smart_data_t data[5], int* num_disks, int* is_degraded, int* present_disks);
+int jm_get_all_disks_smart_data(jm_session_t* session, disk_smart_data_t data[5], int* num_disks, int* is_degraded, int* present_disks);
 
 #endif /* JM_COMMANDS_H */
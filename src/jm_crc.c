@@ -6,42 +6,66 @@
  */
 
 #include "jm_crc.h"
+#include "sata_xor.h"
 #include <stdint.h>
 #include <stddef.h>
+#include <asm/byteorder.h>
 
-/* CRC-32 polynomial (IEEE 802.3): x^32 + x^26 + x^23 + ... + x^2 + x + 1 */
-#define CRC32_POLY 0x04C11DB7
+/* CRC-32 polynomial (IEEE 802.3): x^32 + x^26 + x^23 + ... + x^2 + x + 1
+ * (tables generated by tools/gen_crc_table.c) */
 
-/* JMicron protocol uses this specific initial value */
-#define JM_CRC_SEED 0x52325032
+/* Slicing-by-8 tables (const, generated): crc_tables[0] is the classic byte
+ * table and crc_tables[k][i] advances crc_tables[k-1][i] by one more zero byte */
+#include "jm_crc_table.h"
 
-/* Pre-computed CRC table for faster calculation */
-static uint32_t crc_table[256];
-static int table_initialized = 0;
+/*
+ * Advance the CRC over one 32-bit word, most significant byte first
+ * (the JMicron word order: the byteswapped word fed low byte first)
+ */
+static inline uint32_t crc_word(uint32_t crc, uint32_t word)
+{
+    crc ^= word;
+    return crc_tables[3][crc >> 24] ^
+           crc_tables[2][(crc >> 16) & 0xFF] ^
+           crc_tables[1][(crc >> 8) & 0xFF] ^
+           crc_tables[0][crc & 0xFF];
+}
 
 /*
- * Initialize CRC lookup table
- * Uses standard CRC-32 algorithm with polynomial 0x04C11DB7
+ * Advance the CRC over two 32-bit words with one round of 8 lookups
  */
-static void init_crc_table(void)
+static inline uint32_t crc_dword_pair(uint32_t crc, uint32_t w0, uint32_t w1)
 {
-    for (unsigned int i = 0; i < 256; i++)
+    crc ^= w0;
+    return crc_tables[7][crc >> 24] ^
+           crc_tables[6][(crc >> 16) & 0xFF] ^
+           crc_tables[5][(crc >> 8) & 0xFF] ^
+           crc_tables[4][crc & 0xFF] ^
+           crc_tables[3][w1 >> 24] ^
+           crc_tables[2][(w1 >> 16) & 0xFF] ^
+           crc_tables[1][(w1 >> 8) & 0xFF] ^
+           crc_tables[0][w1 & 0xFF];
+}
+
+/*
+ * Continue a CRC over more 32-bit words
+ *
+ * Stateless and table-only, so it is safe to call from any thread.
+ */
+uint32_t jm_crc_update(uint32_t crc, const uint32_t *data, uint32_t num_words)
+{
+    uint32_t i = 0;
+
+    for (; i + 2 <= num_words; i += 2)
     {
-        uint32_t crc = i << 24;
-        for (int j = 0; j < 8; j++)
-        {
-            if (crc & 0x80000000)
-            {
-                crc = (crc << 1) ^ CRC32_POLY;
-            }
-            else
-            {
-                crc = crc << 1;
-            }
-        }
-        crc_table[i] = crc;
+        crc = crc_dword_pair(crc, data[i], data[i + 1]);
     }
-    table_initialized = 1;
+    if (i < num_words)
+    {
+        crc = crc_word(crc, data[i]);
+    }
+
+    return crc;
 }
 
 /*
@@ -56,24 +80,59 @@ static void init_crc_table(void)
  */
 uint32_t JM_CRC(uint32_t *data, uint32_t num_words)
 {
-    if (!table_initialized)
+    return jm_crc_update(JM_CRC_INIT, data, num_words);
+}
+
+/*
+ * Checksum and scramble a 512-byte command in one pass
+ *
+ * Each word is folded into the CRC and XORed with the pattern while it is
+ * in a register, instead of a CRC pass followed by a SATA_XOR pass.
+ */
+uint32_t JM_CRC_THEN_XOR(uint32_t *data)
+{
+    const uint32_t *pattern = sata_xor_pattern;
+    uint32_t crc = JM_CRC_INIT;
+    int i = 0;
+
+    /* Words 0-0x7d in pairs, then word 0x7e, then the CRC itself */
+    for (; i < 0x7e; i += 2)
     {
-        init_crc_table();
+        uint32_t w0 = data[i];
+        uint32_t w1 = data[i + 1];
+        crc = crc_dword_pair(crc, w0, w1);
+        data[i] = w0 ^ pattern[i];
+        data[i + 1] = w1 ^ pattern[i + 1];
     }
+    uint32_t last = data[0x7e];
+    crc = crc_word(crc, last);
+    data[0x7e] = last ^ pattern[0x7e];
+    data[0x7f] = __cpu_to_le32(crc) ^ pattern[0x7f];
 
-    uint32_t crc = JM_CRC_SEED;
+    return crc;
+}
 
-    for (uint32_t i = 0; i < num_words; i++)
-    {
-        /* Convert to big-endian (network order) */
-        uint32_t word = __builtin_bswap32(data[i]);
+/*
+ * Descramble a 512-byte response and checksum it in one pass
+ */
+uint32_t JM_XOR_THEN_CRC(uint32_t *data)
+{
+    const uint32_t *pattern = sata_xor_pattern;
+    uint32_t crc = JM_CRC_INIT;
+    int i = 0;
 
-        /* Process each byte through CRC table */
-        crc = crc_table[(word & 0xFF) ^ (crc >> 24)] ^ (crc << 8);
-        crc = crc_table[((word >> 8) & 0xFF) ^ (crc >> 24)] ^ (crc << 8);
-        crc = crc_table[((word >> 16) & 0xFF) ^ (crc >> 24)] ^ (crc << 8);
-        crc = crc_table[(word >> 24) ^ (crc >> 24)] ^ (crc << 8);
+    for (; i < 0x7e; i += 2)
+    {
+        uint32_t w0 = data[i] ^ pattern[i];
+        uint32_t w1 = data[i + 1] ^ pattern[i + 1];
+        data[i] = w0;
+        data[i + 1] = w1;
+        crc = crc_dword_pair(crc, w0, w1);
     }
+    uint32_t last = data[0x7e] ^ pattern[0x7e];
+    data[0x7e] = last;
+    crc = crc_word(crc, last);
+    data[0x7f] ^= pattern[0x7f];
 
     return crc;
 }
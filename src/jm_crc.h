@@ -10,8 +10,26 @@
 
 #include <stdint.h>
 
+/* JMicron protocol uses this specific initial value (no final XOR) */
+#define JM_CRC_INIT 0x52325032
+
+/*
+ * Continue a CRC over more 32-bit words (streaming API)
+ * Start with JM_CRC_INIT; the running value is the CRC of everything so far,
+ * so a sector can be checksummed incrementally while it is filled:
+ *   crc = jm_crc_update(JM_CRC_INIT, header, 2);
+ *   crc = jm_crc_update(crc, payload, 0x7d);
+ *
+ * @param crc Running CRC (JM_CRC_INIT for the first call)
+ * @param theData Pointer to data buffer (32-bit words)
+ * @param numDwords Number of 32-bit words to process
+ * @return Updated CRC-32 value
+ */
+uint32_t jm_crc_update(uint32_t crc, const uint32_t* theData, uint32_t numDwords);
+
 /*
  * Calculate CRC-32 for JMicron protocol
+ * Same as jm_crc_update(JM_CRC_INIT, theData, numDwords)
  *
  * @param theData Pointer to data buffer (32-bit words)
  * @param numDwords Number of 32-bit words to process
@@ -19,4 +37,23 @@
  */
 uint32_t JM_CRC(uint32_t* theData, uint32_t numDwords);
 
+/*
+ * Checksum and scramble a 512-byte command in a single pass
+ * Equivalent to storing JM_CRC(theData, 0x7f) in word 0x7f, then SATA_XOR.
+ *
+ * @param theData Pointer to 512-byte buffer (128 32-bit words)
+ * @return CRC-32 of words 0-0x7e before scrambling
+ */
+uint32_t JM_CRC_THEN_XOR(uint32_t* theData);
+
+/*
+ * Descramble a 512-byte response and checksum it in a single pass
+ * Equivalent to SATA_XOR followed by JM_CRC(theData, 0x7f). The caller
+ * compares the result with (descrambled) word 0x7f.
+ *
+ * @param theData Pointer to 512-byte buffer (128 32-bit words)
+ * @return CRC-32 of descrambled words 0-0x7e
+ */
+uint32_t JM_XOR_THEN_CRC(uint32_t* theData);
+
 #endif /* JM_CRC_H */
@@ -0,0 +1,140 @@
+/*
+ * jm_device.c - Part of jm-raid-status
+ *
+ * Copyright (C) 2026 Jamie Treworgy
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "jm_device.h"
+#include "jm_commands.h"
+#include "jm_cache.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void jm_device_init(jm_device_t* dev, uint32_t sector) {
+    memset(dev, 0, sizeof(jm_device_t));
+    jm_session_init(&dev->session, sector);
+    jm_lock_init(&dev->lock);
+}
+
+jm_device_error_t jm_device_open(jm_device_t* dev, const char* path, const jm_device_options_t* options) {
+    uint8_t block_sector[JM_SECTORSIZE];
+    jm_device_error_t error;
+
+    snprintf(dev->path, sizeof(dev->path), "%s", path);
+    dev->run_dir = options->run_dir;
+    dev->lock_timeout_ms = options->lock_timeout_ms > 0 ? options->lock_timeout_ms : JM_LOCK_DEFAULT_TIMEOUT_MS;
+    dev->protocol_error = JM_SUCCESS;
+
+    memset(&dev->controller, 0, sizeof(dev->controller));
+    if (!options->force && (detect_jmicron_hardware(&dev->controller, path) != 0 || !dev->controller.found)) {
+        return JM_DEVICE_NOT_JMICRON;
+    }
+
+    /* Same safety check as jmraidstatus: the on-disk sector must be unused */
+    if (jm_read_sector_block(path, dev->session.sector, block_sector) != 0) {
+        return JM_DEVICE_SECTOR_UNREADABLE;
+    }
+    if (!jm_sector_is_empty(block_sector, sizeof(block_sector))) {
+        return JM_DEVICE_SECTOR_IN_USE;
+    }
+
+    /* Locked from the open through the wakeup, like each poll; without a
+     * usable run directory the session still works, unlocked */
+    if (options->run_dir != NULL && dev->lock.fd < 0) {
+        jm_lock_open(&dev->lock, options->run_dir, path);
+    }
+    if (jm_device_begin(dev) != 0) {
+        error = JM_DEVICE_LOCKED;
+        goto fail;
+    }
+
+    int result = jm_init_device(&dev->session, path);
+    if (result != JM_SUCCESS) {
+        dev->protocol_error = result;
+        error = JM_DEVICE_OPEN_FAILED;
+        goto fail_locked;
+    }
+    if (options->signal_handlers) {
+        jm_setup_signal_handlers(&dev->session);
+    }
+
+    result = jm_wake(&dev->session);
+    if (result != JM_SUCCESS) {
+        jm_cleanup_device(&dev->session);
+        dev->protocol_error = result;
+        error = JM_DEVICE_WAKE_FAILED;
+        goto fail_locked;
+    }
+    dev->need_wakeup = 0;
+    jm_device_end(dev, 0);
+    return JM_DEVICE_OK;
+
+fail_locked:
+    jm_lock_release(&dev->lock);
+fail:
+    jm_lock_close(&dev->lock);
+    return error;
+}
+
+int jm_device_begin(jm_device_t* dev) {
+    if (dev->lock.fd >= 0) {
+        int result = jm_lock_acquire(&dev->lock, dev->lock_timeout_ms);
+        if (result < 0) {
+            return -1;
+        }
+        /* Another process's cleanup may have left the controller idle */
+        if (result == 1) {
+            dev->need_wakeup = 1;
+        }
+    }
+    if (dev->need_wakeup && dev->session.fd >= 0) {  /* jm_device_open wakes after jm_init_device */
+        jm_wake(&dev->session);
+        dev->need_wakeup = 0;
+    }
+    return 0;
+}
+
+void jm_device_end(jm_device_t* dev, int result) {
+    jm_lock_release(&dev->lock);
+    if (result != 0) {
+        dev->need_wakeup = 1;  /* The controller may have dropped back to idle */
+    }
+}
+
+int jm_device_share(const jm_device_t* dev, const disk_smart_data_t* disks, int num_disks,
+                    int is_degraded, int present_disks, int64_t timestamp) {
+    if (dev->run_dir == NULL) {
+        return -1;
+    }
+
+    /* Five full disks: kept off the (possibly small) caller's stack */
+    jm_result_entry_t* entry = calloc(1, sizeof(jm_result_entry_t));
+    if (entry == NULL) {
+        return -1;
+    }
+    entry->timestamp = timestamp;
+    entry->expected_array_size = dev->session.expected_array_size;
+    entry->num_disks = num_disks;
+    entry->is_degraded = is_degraded;
+    entry->present_disks = present_disks;
+    if (dev->controller.found) {
+        snprintf(entry->controller_model, sizeof(entry->controller_model), "%s", dev->controller.model);
+    }
+    memcpy(entry->disks, disks, sizeof(entry->disks));
+
+    int ret = jm_result_store(dev->run_dir, dev->path, entry);
+    free(entry);
+    return ret;
+}
+
+void jm_device_close(jm_device_t* dev) {
+    /* Restoring the sector is an exchange like any other; it fails if the
+     * device is gone, and the fd is released either way */
+    int locked = dev->lock.fd < 0 || jm_lock_acquire(&dev->lock, dev->lock_timeout_ms) >= 0;
+    jm_cleanup_device(&dev->session);
+    if (locked) jm_lock_release(&dev->lock);
+    jm_lock_close(&dev->lock);
+    dev->need_wakeup = 0;
+}
@@ -0,0 +1,104 @@
+/*
+ * jm_device.h - Part of jm-raid-status
+ *
+ * Copyright (C) 2026 Jamie Treworgy
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef JM_DEVICE_H
+#define JM_DEVICE_H
+
+#include "jm_protocol.h"
+#include "jm_lock.h"
+#include "hardware_detect.h"
+#include "smart_parser.h"
+#include <stdint.h>
+
+/*
+ * Persistent enclosure session
+ *
+ * The open, lock, wake and share sequence of programs that keep a
+ * controller session open between polls (libjmraid, jmraid-monitord).
+ * jm_device_open does the same hardware detection and mailbox sector
+ * safety check as jmraidstatus. Every exchange runs between
+ * jm_device_begin and jm_device_end, which hold the device's mailbox lock
+ * and re-send the wakeup sequence when the previous exchange failed or
+ * another process used the mailbox in between.
+ */
+
+/* Why jm_device_open failed */
+typedef enum {
+    JM_DEVICE_OK = 0,
+    JM_DEVICE_NOT_JMICRON,              /* No JMicron controller detected (see force) */
+    JM_DEVICE_SECTOR_UNREADABLE,        /* Block device read of the mailbox sector failed */
+    JM_DEVICE_SECTOR_IN_USE,            /* Mailbox sector holds data on disk */
+    JM_DEVICE_LOCKED,                   /* Another process held the mailbox lock too long */
+    JM_DEVICE_OPEN_FAILED,              /* jm_init_device failed (see protocol_error) */
+    JM_DEVICE_WAKE_FAILED               /* Wakeup failed (see protocol_error) */
+} jm_device_error_t;
+
+/* jm_device_open options */
+typedef struct {
+    int force;                          /* Skip JMicron hardware detection */
+    int lock_timeout_ms;                /* Wait for another process's exchange (0 = JM_LOCK_DEFAULT_TIMEOUT_MS) */
+    int signal_handlers;                /* Restore the sector on a fatal signal (jm_setup_signal_handlers) */
+    const char* run_dir;                /* Mailbox lock and shared polls (NULL = neither) */
+} jm_device_options_t;
+
+/**
+ * An enclosure's session and mailbox lock
+ */
+typedef struct {
+    jm_session_t session;               /* Settings go in between jm_device_init and jm_device_open */
+    jm_lock_t lock;                     /* Not open without a run directory: exchanges are unlocked */
+    controller_info_t controller;       /* Detected controller (found = 0 with force) */
+    char path[256];
+    const char* run_dir;
+    int lock_timeout_ms;
+    int need_wakeup;                    /* Re-wake before the next exchange */
+    int protocol_error;                 /* jm_error_code_t of JM_DEVICE_OPEN_FAILED or _WAKE_FAILED */
+} jm_device_t;
+
+/**
+ * Initialize a closed device with a fresh session
+ * @param sector Mailbox sector
+ */
+void jm_device_init(jm_device_t* dev, uint32_t sector);
+
+/**
+ * Detect the controller, check the mailbox sector, then open and wake the
+ * session (under the mailbox lock)
+ *
+ * @param dev Device from jm_device_init (or jm_device_close)
+ * @param path Block device of the enclosure, e.g. "/dev/sdc"
+ * @param options Open options
+ * @return JM_DEVICE_OK with the session open, or why it is not
+ */
+jm_device_error_t jm_device_open(jm_device_t* dev, const char* path, const jm_device_options_t* options);
+
+/**
+ * Take the mailbox lock before an exchange, re-waking the controller if needed
+ * @return 0 with the lock held, -1 if another process held it too long
+ */
+int jm_device_begin(jm_device_t* dev);
+
+/**
+ * Release the mailbox lock after an exchange
+ * @param result The exchange's result; non-zero re-wakes before the next one
+ */
+void jm_device_end(jm_device_t* dev, int result);
+
+/**
+ * Share an all-disk poll with jmraidstatus --max-age runs (best effort)
+ * @return 0 on success, -1 without a run directory or if it can't be stored
+ */
+int jm_device_share(const jm_device_t* dev, const disk_smart_data_t* disks, int num_disks,
+                    int is_degraded, int present_disks, int64_t timestamp);
+
+/**
+ * Restore the mailbox sector (under the lock if it can be taken) and close
+ * the session and lock file; the device can be opened again
+ */
+void jm_device_close(jm_device_t* dev);
+
+#endif /* JM_DEVICE_H */
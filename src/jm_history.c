@@ -0,0 +1,816 @@
+/*
+ * jm_history.c - Part of jm-raid-status
+ *
+ * Copyright (C) 2026 Jamie Treworgy
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "jm_history.h"
+#include "smart_attributes.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#define JM_HISTORY_MAGIC   0x53484d4a  /* "JMHS" */
+#define JM_HISTORY_VERSION 3
+
+#define HISTORY_KEYFRAME 0x01          /* record.flags: raw values are absolute */
+#define HISTORY_PAGE 4096
+#define HISTORY_SOURCES_SIZE (16 * 1024) /* Source name table bytes */
+#define HISTORY_NO_SOURCE UINT32_MAX
+
+/*
+ * On-disk header; the drive directory follows it, then the source table
+ * (NUL-terminated device names, addressed by offset, "" at 0) at
+ * sources_offset, and the ring starts at data_offset
+ */
+struct jm_history_header {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t drive_size;                /* sizeof(history_drive_t), catches layout changes */
+    uint32_t data_offset;
+    uint32_t num_drives;
+    uint64_t data_size;
+    uint64_t head;                      /* Ring offset of the next record */
+    uint64_t tail;                      /* Ring offset of the oldest record */
+    uint64_t count;                     /* Records in the ring */
+    uint64_t next_seq;
+    uint32_t sources_offset;
+    uint32_t sources_size;
+    uint32_t sources_used;              /* Bytes of the source table in use */
+    uint32_t max_drives;                /* Directory entries */
+};
+
+/* Directory entry: a drive and its latest snapshot, which the next delta is taken against */
+typedef struct {
+    char serial[24];
+    char model[48];
+    uint32_t since_keyframe;            /* Deltas written since the last keyframe */
+    uint8_t num_attributes;
+    uint8_t reserved[3];
+    uint8_t ids[MAX_SMART_ATTRIBUTES];
+    uint8_t reserved2[2];
+    uint64_t raw[MAX_SMART_ATTRIBUTES];
+    uint32_t source;                    /* Source table offset of the latest snapshot's device */
+    uint32_t records;                   /* Snapshots of the drive still in the ring (0 = reusable) */
+    int64_t last_timestamp;
+    uint8_t value[MAX_SMART_ATTRIBUTES];
+    uint8_t worst[MAX_SMART_ATTRIBUTES];
+    uint8_t overall_status;
+    uint8_t removed;                    /* Reported missing from its source's latest poll */
+    uint8_t reserved3[2];
+} history_drive_t;
+
+/*
+ * Ring record header; num_attributes entries of
+ *   id (u8), value (u8), worst (u8), raw (zigzag varint of raw - previous raw)
+ * follow. length 0, or less room than a header before the end of the
+ * ring, means the next record is at offset 0.
+ */
+typedef struct {
+    uint16_t length;                    /* Whole record, header included */
+    uint8_t flags;
+    uint8_t num_attributes;
+    uint8_t overall_status;
+    uint8_t reserved;
+    uint16_t drive;                     /* Directory index */
+    uint64_t seq;
+    int64_t timestamp;
+} __attribute__((packed)) history_record_t;
+
+#define MAX_RECORD_SIZE (sizeof(history_record_t) + MAX_SMART_ATTRIBUTES * (3 + 10))
+
+static history_drive_t* drive_table(const jm_history_t* history) {
+    return (history_drive_t*)(history->map + sizeof(struct jm_history_header));
+}
+
+static char* source_table(const jm_history_t* history) {
+    return (char*)history->map + history->header->sources_offset;
+}
+
+static uint8_t* ring(const jm_history_t* history) {
+    return history->map + history->header->data_offset;
+}
+
+/* Helper: Zigzag varint (LEB128) of a signed delta; returns bytes written */
+static size_t put_varint(uint8_t* out, int64_t delta) {
+    uint64_t v = ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63);
+    size_t n = 0;
+    while (v >= 0x80) {
+        out[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    out[n++] = (uint8_t)v;
+    return n;
+}
+
+/* Helper: Decode a zigzag varint; returns bytes read, 0 if it runs past end */
+static size_t get_varint(const uint8_t* in, const uint8_t* end, int64_t* delta) {
+    uint64_t v = 0;
+    for (size_t n = 0; n < 10 && in + n < end; n++) {
+        v |= (uint64_t)(in[n] & 0x7f) << (7 * n);
+        if (!(in[n] & 0x80)) {
+            *delta = (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+            return n + 1;
+        }
+    }
+    return 0;
+}
+
+/* Helper: Check a mapped file's header against the file size */
+static int header_is_valid(const struct jm_history_header* h, size_t file_size) {
+    uint64_t directory_end = sizeof(*h) + (uint64_t)h->max_drives * sizeof(history_drive_t);
+    return h->magic == JM_HISTORY_MAGIC &&
+           h->version == JM_HISTORY_VERSION &&
+           h->drive_size == sizeof(history_drive_t) &&
+           h->max_drives >= 1 && h->max_drives <= JM_HISTORY_MAX_DRIVES &&
+           h->sources_offset >= directory_end &&
+           h->sources_used >= 1 && h->sources_used <= h->sources_size &&
+           (uint64_t)h->sources_offset + h->sources_size <= h->data_offset &&
+           h->num_drives <= h->max_drives &&
+           h->data_size >= JM_HISTORY_MIN_SIZE &&
+           h->data_offset + h->data_size <= file_size &&
+           ((const char*)h)[h->sources_offset + h->sources_used - 1] == '\0' &&
+           h->head < h->data_size && h->tail < h->data_size;
+}
+
+int jm_history_open(jm_history_t* history, const char* path, int writable, size_t size,
+                    uint32_t max_drives) {
+    struct stat st;
+
+    memset(history, 0, sizeof(jm_history_t));
+    history->fd = open(path, writable ? (O_RDWR | O_CREAT | O_CLOEXEC) : (O_RDONLY | O_CLOEXEC), 0644);
+    if (history->fd < 0) {
+        return -1;
+    }
+    history->writable = writable;
+
+    /* A new file is laid out under the lock, so two first writers can't race */
+    flock(history->fd, writable ? LOCK_EX : LOCK_SH);
+    if (fstat(history->fd, &st) != 0) {
+        goto fail;
+    }
+    if (st.st_size == 0 && writable) {
+        struct jm_history_header h;
+
+        if (size == 0) size = JM_HISTORY_DEFAULT_SIZE;
+        if (size < JM_HISTORY_MIN_SIZE) size = JM_HISTORY_MIN_SIZE;
+        if (max_drives == 0) max_drives = JM_HISTORY_DEFAULT_DRIVES;
+        if (max_drives > JM_HISTORY_MAX_DRIVES) max_drives = JM_HISTORY_MAX_DRIVES;
+        size_t directory_end = sizeof(h) + (size_t)max_drives * sizeof(history_drive_t);
+
+        memset(&h, 0, sizeof(h));
+        h.magic = JM_HISTORY_MAGIC;
+        h.version = JM_HISTORY_VERSION;
+        h.drive_size = sizeof(history_drive_t);
+        h.max_drives = max_drives;
+        h.sources_offset = (uint32_t)directory_end;
+        h.sources_size = HISTORY_SOURCES_SIZE;
+        h.sources_used = 1;             /* "" at offset 0; ftruncate zero-fills it */
+        h.data_offset = (uint32_t)((directory_end + HISTORY_SOURCES_SIZE + HISTORY_PAGE - 1) /
+                                   HISTORY_PAGE * HISTORY_PAGE);
+        h.data_size = size;
+        h.next_seq = 1;
+        if (ftruncate(history->fd, (off_t)(h.data_offset + size)) != 0 ||
+            pwrite(history->fd, &h, sizeof(h), 0) != (ssize_t)sizeof(h) ||
+            fstat(history->fd, &st) != 0) {
+            goto fail;
+        }
+    }
+    if ((size_t)st.st_size < sizeof(struct jm_history_header)) {
+        goto fail;
+    }
+
+    void* map = mmap(NULL, (size_t)st.st_size, writable ? (PROT_READ | PROT_WRITE) : PROT_READ,
+                     MAP_SHARED, history->fd, 0);
+    if (map == MAP_FAILED) {
+        goto fail;
+    }
+    history->map = map;
+    history->map_len = (size_t)st.st_size;
+    history->header = map;
+    if (!header_is_valid(history->header, history->map_len)) {
+        goto fail;
+    }
+
+    flock(history->fd, LOCK_UN);
+    return 0;
+
+fail:
+    jm_history_close(history);
+    return -1;
+}
+
+uint32_t jm_history_max_drives(const jm_history_t* history) {
+    return history->header->max_drives;
+}
+
+void jm_history_close(jm_history_t* history) {
+    if (history->map != NULL) {
+        munmap(history->map, history->map_len);
+    }
+    if (history->fd >= 0) {
+        close(history->fd);
+    }
+    memset(history, 0, sizeof(jm_history_t));
+    history->fd = -1;
+}
+
+/* Helper: Offset of a name among the first used bytes of a source table */
+static uint32_t find_source_in(const char* table, uint32_t used, const char* name) {
+    for (uint32_t off = 0; off < used; off += (uint32_t)strlen(table + off) + 1) {
+        if (strcmp(table + off, name) == 0) {
+            return off;
+        }
+    }
+    return HISTORY_NO_SOURCE;
+}
+
+/* Helper: Directory index of a serial, adding the drive if it is new */
+static int find_drive(jm_history_t* history, const disk_smart_data_t* disk, int* is_new) {
+    struct jm_history_header* h = history->header;
+    history_drive_t* drives = drive_table(history);
+    int index = -1;
+
+    *is_new = 0;
+    for (uint32_t i = 0; i < h->num_drives; i++) {
+        if (strncmp(drives[i].serial, disk->serial_number, sizeof(drives[i].serial)) == 0) {
+            return (int)i;
+        }
+    }
+    *is_new = 1;
+    if (h->num_drives < h->max_drives) {
+        index = (int)h->num_drives++;
+    } else {
+        /* Full: take over the drive seen longest ago whose snapshots have all been overwritten */
+        for (uint32_t i = 0; i < h->num_drives; i++) {
+            if (drives[i].records == 0 &&
+                (index < 0 || drives[i].last_timestamp < drives[index].last_timestamp)) {
+                index = (int)i;
+            }
+        }
+        if (index < 0) {
+            return -1;
+        }
+    }
+
+    history_drive_t* drive = &drives[index];
+    memset(drive, 0, sizeof(history_drive_t));
+    snprintf(drive->serial, sizeof(drive->serial), "%s", disk->serial_number);
+    snprintf(drive->model, sizeof(drive->model), "%.47s", disk->disk_name);
+    drive->since_keyframe = JM_HISTORY_KEYFRAME_INTERVAL;  /* First snapshot is a keyframe */
+    drive->source = HISTORY_NO_SOURCE;
+    return index;
+}
+
+/* Helper: Name of a source table offset ("" if it is out of range) */
+static const char* source_name(const jm_history_t* history, uint32_t source) {
+    return source < history->header->sources_used ? source_table(history) + source : "";
+}
+
+/* Helper: Offset of a source name in the table, or HISTORY_NO_SOURCE */
+static uint32_t find_source(const jm_history_t* history, const char* name) {
+    return find_source_in(source_table(history), history->header->sources_used, name);
+}
+
+/* Helper: Rewrite the source table with only the names drives still refer to */
+static void compact_sources(jm_history_t* history) {
+    struct jm_history_header* h = history->header;
+    history_drive_t* drives = drive_table(history);
+    char* table = source_table(history);
+    char* copy = malloc(h->sources_used);
+    uint32_t used = 1;
+
+    if (copy == NULL) {
+        return;
+    }
+    memcpy(copy, table, h->sources_used);
+    for (uint32_t i = 0; i < h->num_drives; i++) {
+        uint32_t old = drives[i].source;
+        if (old == HISTORY_NO_SOURCE || old == 0 || old >= h->sources_used) {
+            continue;
+        }
+        /* Drives sharing a source are re-pointed together */
+        uint32_t moved = find_source_in(table, used, copy + old);
+        if (moved == HISTORY_NO_SOURCE) {
+            size_t len = strlen(copy + old) + 1;
+            memcpy(table + used, copy + old, len);
+            moved = used;
+            used += (uint32_t)len;
+        }
+        drives[i].source = moved;
+    }
+    h->sources_used = used;
+    free(copy);
+}
+
+/* Helper: Offset of a source name, adding it to the table if it is new */
+static uint32_t intern_source(jm_history_t* history, const char* name) {
+    struct jm_history_header* h = history->header;
+    uint32_t off = find_source(history, name);
+    size_t len = strlen(name) + 1;
+
+    if (off != HISTORY_NO_SOURCE) {
+        return off;
+    }
+    if (h->sources_size - h->sources_used < len) {
+        compact_sources(history);  /* Names no drive refers to any more */
+        if (h->sources_size - h->sources_used < len) {
+            return HISTORY_NO_SOURCE;
+        }
+    }
+    off = h->sources_used;
+    memcpy(source_table(history) + off, name, len);
+    h->sources_used += (uint32_t)len;
+    return off;
+}
+
+/* Helper: Offset of the record after the one at pos (following wrap markers) */
+static uint64_t skip_record(const jm_history_t* history, uint64_t pos, int* is_record) {
+    const struct jm_history_header* h = history->header;
+    history_record_t rec;
+
+    *is_record = 0;
+    if (h->data_size - pos < sizeof(rec)) {
+        return 0;
+    }
+    memcpy(&rec, ring(history) + pos, sizeof(rec));
+    if (rec.length == 0) {
+        return 0;
+    }
+    *is_record = 1;
+    return pos + rec.length;
+}
+
+/* Helper: Drop the oldest records until [start, end) of the ring is free */
+static void make_room(jm_history_t* history, uint64_t start, uint64_t end) {
+    struct jm_history_header* h = history->header;
+    history_drive_t* drives = drive_table(history);
+
+    while (h->count > 0 && h->tail >= start && h->tail < end) {
+        int is_record;
+        uint64_t next = skip_record(history, h->tail, &is_record);
+        if (is_record) {
+            history_record_t rec;
+            memcpy(&rec, ring(history) + h->tail, sizeof(rec));
+            if (rec.drive < h->num_drives && drives[rec.drive].records > 0) {
+                drives[rec.drive].records--;
+            }
+            h->count--;
+        }
+        h->tail = next;
+    }
+    if (h->count == 0) {
+        h->tail = start;
+    }
+}
+
+/* Helper: Encode one disk's snapshot at the ring head */
+static void append_snapshot(jm_history_t* history, int index, uint32_t source,
+                            const disk_smart_data_t* disk, int64_t timestamp) {
+    struct jm_history_header* h = history->header;
+    history_drive_t* drive = &drive_table(history)[index];
+    uint8_t buf[MAX_RECORD_SIZE];
+    history_record_t rec;
+
+    int num_attributes = disk->num_attributes;
+    if (num_attributes > MAX_SMART_ATTRIBUTES) num_attributes = MAX_SMART_ATTRIBUTES;
+    if (num_attributes < 0) num_attributes = 0;
+
+    /* Deltas need the same attribute set as the previous snapshot */
+    int keyframe = drive->since_keyframe + 1 >= JM_HISTORY_KEYFRAME_INTERVAL ||
+                   drive->num_attributes != num_attributes;
+    for (int i = 0; i < num_attributes && !keyframe; i++) {
+        keyframe = drive->ids[i] != disk->attributes[i].id;
+    }
+
+    size_t len = sizeof(rec);
+    for (int i = 0; i < num_attributes; i++) {
+        const parsed_smart_attribute_t* attr = &disk->attributes[i];
+        uint64_t base = keyframe ? 0 : drive->raw[i];
+        buf[len++] = attr->id;
+        buf[len++] = attr->current_value;
+        buf[len++] = attr->worst_value;
+        len += put_varint(buf + len, (int64_t)(attr->raw_value - base));
+    }
+
+    memset(&rec, 0, sizeof(rec));
+    rec.length = (uint16_t)len;
+    rec.flags = keyframe ? HISTORY_KEYFRAME : 0;
+    rec.num_attributes = (uint8_t)num_attributes;
+    rec.drive = (uint16_t)index;
+    rec.overall_status = (uint8_t)disk->overall_status;
+    rec.seq = h->next_seq++;
+    rec.timestamp = timestamp;
+    memcpy(buf, &rec, sizeof(rec));
+
+    /* Wrap: free the rest of the ring, mark it, start over at 0 */
+    if (h->data_size - h->head < len) {
+        make_room(history, h->head, h->data_size);
+        if (h->data_size - h->head >= sizeof(rec.length)) {
+            memset(ring(history) + h->head, 0, sizeof(rec.length));
+        }
+        h->head = 0;
+        if (h->count == 0) h->tail = 0;
+    }
+    make_room(history, h->head, h->head + len);
+
+    memcpy(ring(history) + h->head, buf, len);
+    h->head += len;
+    if (h->head >= h->data_size) h->head = 0;
+    h->count++;
+    drive->records++;
+
+    drive->since_keyframe = keyframe ? 0 : drive->since_keyframe + 1;
+    drive->num_attributes = (uint8_t)num_attributes;
+    for (int i = 0; i < num_attributes; i++) {
+        drive->ids[i] = disk->attributes[i].id;
+        drive->value[i] = disk->attributes[i].current_value;
+        drive->worst[i] = disk->attributes[i].worst_value;
+        drive->raw[i] = disk->attributes[i].raw_value;
+    }
+    if (disk->disk_name[0] != '\0') {
+        snprintf(drive->model, sizeof(drive->model), "%.47s", disk->disk_name);
+    }
+    drive->source = source;
+    drive->last_timestamp = timestamp;
+    drive->overall_status = (uint8_t)disk->overall_status;
+    drive->removed = 0;
+}
+
+/* Helper: A decoded attribute from the directory's latest snapshot of a drive */
+static jm_history_attribute_t drive_attribute(const history_drive_t* drive, int i) {
+    jm_history_attribute_t attr = {
+        drive->ids[i], drive->value[i], drive->worst[i], drive->raw[i]
+    };
+    return attr;
+}
+
+/* Helper: Report how a disk differs from its drive's latest snapshot */
+static void diff_snapshot(const jm_history_t* history, const history_drive_t* drive, uint32_t source,
+                          const disk_smart_data_t* disk, int is_new, jm_history_change_fn fn, void* ctx) {
+    jm_history_change_t change;
+
+    memset(&change, 0, sizeof(change));
+    change.source = source_name(history, source);
+    change.serial = drive->serial;
+    change.model = disk->disk_name[0] != '\0' ? disk->disk_name : drive->model;
+    change.to_status = disk->overall_status;
+
+    if (is_new || drive->removed || drive->source != source) {
+        change.type = JM_HISTORY_ADDED;
+        fn(ctx, &change);
+        return;
+    }
+    if (drive->overall_status != (uint8_t)disk->overall_status) {
+        change.type = JM_HISTORY_STATUS;
+        change.from_status = (disk_health_status_t)drive->overall_status;
+        fn(ctx, &change);
+    }
+
+    change.type = JM_HISTORY_ATTRIBUTE;
+    int num_attributes = disk->num_attributes < MAX_SMART_ATTRIBUTES ? disk->num_attributes : MAX_SMART_ATTRIBUTES;
+    for (int i = 0; i < num_attributes; i++) {
+        const parsed_smart_attribute_t* attr = &disk->attributes[i];
+        int k = 0;
+        while (k < drive->num_attributes && drive->ids[k] != attr->id) k++;
+
+        change.has_from = k < drive->num_attributes;
+        change.has_to = 1;
+        change.to = (jm_history_attribute_t){ attr->id, attr->current_value, attr->worst_value, attr->raw_value };
+        if (change.has_from) {
+            change.from = drive_attribute(drive, k);
+            if (change.from.value == change.to.value && change.from.worst == change.to.worst &&
+                (change.from.raw == change.to.raw || !is_critical_attribute(attr->id))) {
+                continue;
+            }
+        }
+        fn(ctx, &change);
+    }
+
+    change.has_from = 1;
+    change.has_to = 0;
+    for (int k = 0; k < drive->num_attributes; k++) {
+        int i = 0;
+        while (i < num_attributes && disk->attributes[i].id != drive->ids[k]) i++;
+        if (i == num_attributes) {
+            change.from = drive_attribute(drive, k);
+            fn(ctx, &change);
+        }
+    }
+}
+
+/* Helper: Timestamp of a source's previous poll (0 if there was none) */
+static int64_t previous_poll(const jm_history_t* history, uint32_t source, int64_t timestamp) {
+    const history_drive_t* drives = drive_table(history);
+    int64_t previous = 0;
+
+    for (uint32_t i = 0; i < history->header->num_drives; i++) {
+        if (!drives[i].removed && drives[i].last_timestamp < timestamp &&
+            drives[i].last_timestamp > previous && drives[i].source == source) {
+            previous = drives[i].last_timestamp;
+        }
+    }
+    return previous;
+}
+
+/* Helper: Mark (and report) the drives a source's previous poll had and this one lacks */
+static void mark_removed(jm_history_t* history, uint32_t source, int64_t previous,
+                         jm_history_change_fn fn, void* ctx) {
+    history_drive_t* drives = drive_table(history);
+
+    for (uint32_t i = 0; i < history->header->num_drives; i++) {
+        history_drive_t* drive = &drives[i];
+        if (previous == 0 || drive->removed || drive->last_timestamp != previous ||
+            drive->source != source) {
+            continue;
+        }
+        drive->removed = 1;
+        if (fn != NULL) {
+            jm_history_change_t change;
+            memset(&change, 0, sizeof(change));
+            change.type = JM_HISTORY_REMOVED;
+            change.source = source_name(history, drive->source);
+            change.serial = drive->serial;
+            change.model = drive->model;
+            fn(ctx, &change);
+        }
+    }
+}
+
+int jm_history_append(jm_history_t* history, const char* source, const disk_smart_data_t* disks,
+                      int num_disks, int64_t timestamp, jm_history_change_fn fn, void* ctx) {
+    int appended = 0;
+
+    if (!history->writable) {
+        return -1;
+    }
+
+    flock(history->fd, LOCK_EX);
+    uint32_t key = intern_source(history, source != NULL ? source : "");
+    if (key == HISTORY_NO_SOURCE) {
+        flock(history->fd, LOCK_UN);
+        return -1;
+    }
+    int64_t previous = previous_poll(history, key, timestamp);
+    for (int i = 0; i < num_disks; i++) {
+        if (!disks[i].is_present || disks[i].serial_number[0] == '\0') {
+            continue;
+        }
+        int is_new;
+        int index = find_drive(history, &disks[i], &is_new);
+        if (index < 0) {
+            appended = -1;
+            break;
+        }
+        if (fn != NULL) {
+            diff_snapshot(history, &drive_table(history)[index], key, &disks[i], is_new, fn, ctx);
+        }
+        append_snapshot(history, index, key, &disks[i], timestamp);
+        appended++;
+    }
+    if (appended >= 0) {
+        mark_removed(history, key, previous, fn, ctx);
+    }
+    flock(history->fd, LOCK_UN);
+    return appended;
+}
+
+int jm_history_record(const char* path, const char* source, const disk_smart_data_t* disks,
+                      int num_disks, int64_t timestamp, jm_history_change_fn fn, void* ctx) {
+    jm_history_t history;
+    if (jm_history_open(&history, path, 1, 0, 0) != 0) {
+        return -1;
+    }
+    int ret = jm_history_append(&history, source, disks, num_disks, timestamp, fn, ctx);
+    jm_history_close(&history);
+    return ret;
+}
+
+/* Reader's running values per drive (rebuilt from keyframes) */
+typedef struct {
+    int valid;
+    int num_attributes;
+    jm_history_attribute_t attributes[MAX_SMART_ATTRIBUTES];
+} drive_state_t;
+
+/* Helper: Decode one record into the drive's state; 0 if it can't be used */
+static int decode_record(const uint8_t* p, const history_record_t* rec, drive_state_t* state) {
+    const uint8_t* end = p + rec->length;
+    int keyframe = rec->flags & HISTORY_KEYFRAME;
+
+    if (rec->num_attributes > MAX_SMART_ATTRIBUTES ||
+        (!keyframe && (!state->valid || state->num_attributes != rec->num_attributes))) {
+        state->valid = 0;
+        return 0;
+    }
+
+    p += sizeof(history_record_t);
+    for (int i = 0; i < rec->num_attributes; i++) {
+        jm_history_attribute_t* attr = &state->attributes[i];
+        int64_t delta;
+        size_t n;
+
+        if (end - p < 4 || (n = get_varint(p + 3, end, &delta)) == 0 ||
+            (!keyframe && attr->id != p[0])) {
+            state->valid = 0;
+            return 0;
+        }
+        attr->id = p[0];
+        attr->value = p[1];
+        attr->worst = p[2];
+        attr->raw = (keyframe ? 0 : attr->raw) + (uint64_t)delta;
+        p += 3 + n;
+    }
+    state->num_attributes = rec->num_attributes;
+    state->valid = 1;
+    return 1;
+}
+
+int jm_history_scan(jm_history_t* history, jm_history_fn fn, void* ctx) {
+    const struct jm_history_header* h = history->header;
+    const history_drive_t* drives = drive_table(history);
+    drive_state_t* states = calloc(h->max_drives, sizeof(drive_state_t));
+    jm_history_snapshot_t snapshot;
+    int delivered = 0;
+
+    if (states == NULL) {
+        return 0;
+    }
+
+    flock(history->fd, LOCK_SH);
+    uint64_t pos = h->tail;
+    int wrapped = 0;
+    for (uint64_t remaining = h->count; remaining > 0; ) {
+        int is_record;
+        uint64_t next = skip_record(history, pos, &is_record);
+        if (!is_record) {
+            if (wrapped++) break;  /* Second wrap: damaged ring */
+            pos = 0;
+            continue;
+        }
+        remaining--;
+
+        history_record_t rec;
+        const uint8_t* p = ring(history) + pos;
+        memcpy(&rec, p, sizeof(rec));
+        if (rec.length < sizeof(rec) || pos + rec.length > h->data_size) {
+            break;  /* Damaged ring: stop rather than read past it */
+        }
+        pos = next;
+
+        if (rec.drive >= h->num_drives || !decode_record(p, &rec, &states[rec.drive])) {
+            continue;
+        }
+
+        const drive_state_t* state = &states[rec.drive];
+        snapshot.seq = rec.seq;
+        snapshot.timestamp = rec.timestamp;
+        snapshot.serial = drives[rec.drive].serial;
+        snapshot.model = drives[rec.drive].model;
+        snapshot.overall_status = (disk_health_status_t)rec.overall_status;
+        snapshot.num_attributes = state->num_attributes;
+        memcpy(snapshot.attributes, state->attributes,
+               (size_t)state->num_attributes * sizeof(jm_history_attribute_t));
+
+        delivered++;
+        if (fn(ctx, &snapshot) != 0) {
+            break;
+        }
+    }
+    flock(history->fd, LOCK_UN);
+
+    free(states);
+    return delivered;
+}
+
+/* Helper: Status names as the text and JSON reports spell them */
+static const char* status_name(disk_health_status_t status, int json) {
+    switch (status) {
+        case DISK_STATUS_PASSED: return json ? "healthy" : "PASSED";
+        case DISK_STATUS_FAILED: return json ? "failed" : "FAILED";
+        default:                 return json ? "error" : "ERROR";
+    }
+}
+
+/* Helper: JSON string with quotes and control characters escaped */
+static void write_json_string(FILE* out, const char* s) {
+    fputc('"', out);
+    for (; *s != '\0'; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') {
+            fprintf(out, "\\%c", c);
+        } else if (c < 0x20) {
+            fprintf(out, "\\u%04x", c);
+        } else {
+            fputc(c, out);
+        }
+    }
+    fputc('"', out);
+}
+
+static void write_json_attribute(FILE* out, const jm_history_attribute_t* attr, int present) {
+    if (!present) {
+        fputs("null", out);
+        return;
+    }
+    fprintf(out, "{\"value\":%u,\"worst\":%u,\"raw\":%llu}",
+            attr->value, attr->worst, (unsigned long long)attr->raw);
+}
+
+void jm_history_write_change(FILE* out, const jm_history_change_t* change, int json) {
+    static const char* const types[] = { "added", "removed", "status", "attribute" };
+    const jm_history_attribute_t* attr = change->has_to ? &change->to : &change->from;
+    const smart_attribute_def_t* def = get_attribute_definition(attr->id);
+    const char* name = def != NULL ? def->name : "Unknown_Attribute";
+
+    if (json) {
+        fprintf(out, "{\"change\":\"%s\",\"source\":", types[change->type]);
+        write_json_string(out, change->source);
+        fputs(",\"serial\":", out);
+        write_json_string(out, change->serial);
+        fputs(",\"model\":", out);
+        write_json_string(out, change->model);
+        switch (change->type) {
+            case JM_HISTORY_ADDED:
+                fprintf(out, ",\"status\":\"%s\"", status_name(change->to_status, 1));
+                break;
+            case JM_HISTORY_STATUS:
+                fprintf(out, ",\"from\":\"%s\",\"to\":\"%s\"",
+                        status_name(change->from_status, 1), status_name(change->to_status, 1));
+                break;
+            case JM_HISTORY_ATTRIBUTE:
+                fprintf(out, ",\"id\":%u,\"name\":", attr->id);
+                write_json_string(out, name);
+                fputs(",\"from\":", out);
+                write_json_attribute(out, &change->from, change->has_from);
+                fputs(",\"to\":", out);
+                write_json_attribute(out, &change->to, change->has_to);
+                break;
+            default:
+                break;
+        }
+        fputs("}\n", out);
+        return;
+    }
+
+    fprintf(out, "%s %s: ", change->source, change->serial);
+    switch (change->type) {
+        case JM_HISTORY_ADDED:
+            fprintf(out, "added (%s, %s)\n", change->model, status_name(change->to_status, 0));
+            break;
+        case JM_HISTORY_REMOVED:
+            fprintf(out, "removed (%s)\n", change->model);
+            break;
+        case JM_HISTORY_STATUS:
+            fprintf(out, "status %s -> %s\n",
+                    status_name(change->from_status, 0), status_name(change->to_status, 0));
+            break;
+        case JM_HISTORY_ATTRIBUTE:
+            fprintf(out, "%u %s", attr->id, name);
+            if (!change->has_from) {
+                fprintf(out, " appeared (value %u, raw %llu)\n", attr->value, (unsigned long long)attr->raw);
+            } else if (!change->has_to) {
+                fputs(" disappeared\n", out);
+            } else {
+                if (change->from.value != change->to.value)
+                    fprintf(out, " value %u -> %u", change->from.value, change->to.value);
+                if (change->from.worst != change->to.worst)
+                    fprintf(out, " worst %u -> %u", change->from.worst, change->to.worst);
+                if (change->from.raw != change->to.raw)
+                    fprintf(out, " raw %llu -> %llu",
+                            (unsigned long long)change->from.raw, (unsigned long long)change->to.raw);
+                fputc('\n', out);
+            }
+            break;
+    }
+}
+
+void jm_history_write_heartbeat(FILE* out, const char* source, int64_t timestamp, int num_disks,
+                                disk_health_status_t status, int json) {
+    char when[32];
+    time_t t = (time_t)timestamp;
+    struct tm tm_info;
+
+    gmtime_r(&t, &tm_info);
+    strftime(when, sizeof(when), "%Y-%m-%dT%H:%M:%SZ", &tm_info);
+
+    if (json) {
+        fprintf(out, "{\"heartbeat\":\"%s\"", when);
+        if (source != NULL) {
+            fputs(",\"source\":", out);
+            write_json_string(out, source);
+        }
+        fprintf(out, ",\"disks\":%d,\"status\":\"%s\"}\n", num_disks, status_name(status, 1));
+    } else {
+        if (source != NULL) fprintf(out, "%s: ", source);
+        fprintf(out, "no changes at %s (%d disk%s, %s)\n",
+                when, num_disks, num_disks == 1 ? "" : "s", status_name(status, 0));
+    }
+}
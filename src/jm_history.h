@@ -0,0 +1,184 @@
+/*
+ * jm_history.h - Part of jm-raid-status
+ *
+ * Copyright (C) 2026 Jamie Treworgy
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef JM_HISTORY_H
+#define JM_HISTORY_H
+
+#include "smart_parser.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * SMART history store (--history FILE)
+ *
+ * One memory-mapped file: a header, a directory of drives keyed by serial,
+ * and a fixed-size ring of snapshots. Both sizes are set when the file is
+ * created; once the directory is full, a new drive takes over the entry
+ * of a drive with no snapshots left in the ring. Each snapshot holds one drive's
+ * status and attributes at one time. Raw values are delta-encoded against
+ * the drive's previous snapshot (zigzag varints), so a counter that does
+ * not move costs one byte. Every JM_HISTORY_KEYFRAME_INTERVAL-th snapshot
+ * of a drive, and any snapshot whose attribute set changed, is stored in
+ * full. When the ring is full, the oldest snapshots are overwritten; a
+ * reader skips a drive's deltas until the next keyframe if their base was
+ * overwritten.
+ *
+ * Writers hold an exclusive flock() while appending, readers a shared one,
+ * so jmraidstatus, disk-health and jm-history can use one file at once.
+ *
+ * The directory also keeps each drive's latest snapshot and the source
+ * (device) it was last seen on, as an offset into a table of full source
+ * names, so an append can report what changed since that source's
+ * previous poll without scanning the ring (--changed-since). Snapshots with the same timestamp are one poll.
+ */
+
+#define JM_HISTORY_DEFAULT_SIZE (4 * 1024 * 1024)   /* Snapshot ring bytes */
+#define JM_HISTORY_MIN_SIZE (64 * 1024)
+#define JM_HISTORY_DEFAULT_DRIVES 256                /* Drive directory entries */
+#define JM_HISTORY_MAX_DRIVES 65535                  /* Snapshots index the directory in 16 bits */
+#define JM_HISTORY_KEYFRAME_INTERVAL 16
+
+struct jm_history_header;
+
+/**
+ * An open history file
+ */
+typedef struct {
+    int fd;
+    uint8_t* map;
+    size_t map_len;
+    struct jm_history_header* header;
+    int writable;
+} jm_history_t;
+
+/* One attribute of a decoded snapshot */
+typedef struct {
+    uint8_t id;
+    uint8_t value;
+    uint8_t worst;
+    uint64_t raw;
+} jm_history_attribute_t;
+
+/**
+ * One decoded snapshot (valid only during the jm_history_scan callback)
+ */
+typedef struct {
+    uint64_t seq;
+    int64_t timestamp;                  /* Unix time */
+    const char* serial;
+    const char* model;
+    disk_health_status_t overall_status;
+    int num_attributes;
+    jm_history_attribute_t attributes[MAX_SMART_ATTRIBUTES];
+} jm_history_snapshot_t;
+
+/**
+ * Called for each snapshot, oldest first
+ * @return 0 to continue, non-zero to stop the scan
+ */
+typedef int (*jm_history_fn)(void* ctx, const jm_history_snapshot_t* snapshot);
+
+/* What a change report describes */
+typedef enum {
+    JM_HISTORY_ADDED,                   /* Drive is new to its source */
+    JM_HISTORY_REMOVED,                 /* Drive was in the source's previous poll, not this one */
+    JM_HISTORY_STATUS,                  /* Overall status changed */
+    JM_HISTORY_ATTRIBUTE                /* An attribute appeared, disappeared or changed */
+} jm_history_change_type_t;
+
+/**
+ * One change against a drive's previous snapshot
+ *
+ * Attribute changes are a new normalized or worst value, or a new raw value
+ * of a critical attribute; raw counters such as power-on hours and
+ * temperature move every poll and are not reported on their own.
+ */
+typedef struct {
+    jm_history_change_type_t type;
+    const char* source;
+    const char* serial;
+    const char* model;
+    disk_health_status_t from_status;   /* JM_HISTORY_STATUS */
+    disk_health_status_t to_status;     /* JM_HISTORY_STATUS, JM_HISTORY_ADDED */
+    int has_from;                       /* JM_HISTORY_ATTRIBUTE: 0 if the attribute appeared */
+    int has_to;                         /* JM_HISTORY_ATTRIBUTE: 0 if it disappeared */
+    jm_history_attribute_t from;
+    jm_history_attribute_t to;
+} jm_history_change_t;
+
+typedef void (*jm_history_change_fn)(void* ctx, const jm_history_change_t* change);
+
+/**
+ * Open a history file, creating it if needed (writable only)
+ *
+ * @param history Output handle
+ * @param path File path
+ * @param writable Non-zero to append; the file is created if missing
+ * @param size Ring size in bytes for a new file (0 = JM_HISTORY_DEFAULT_SIZE);
+ *        an existing file keeps its size
+ * @param max_drives Drive directory entries for a new file
+ *        (0 = JM_HISTORY_DEFAULT_DRIVES, at most JM_HISTORY_MAX_DRIVES);
+ *        an existing file keeps its directory
+ * @return 0 on success, -1 if it can't be opened or is not a history file
+ */
+int jm_history_open(jm_history_t* history, const char* path, int writable, size_t size,
+                    uint32_t max_drives);
+
+/**
+ * Drive directory entries of an open file (distinct drives in the ring at most)
+ */
+uint32_t jm_history_max_drives(const jm_history_t* history);
+
+/**
+ * Unmap and close a history file
+ */
+void jm_history_close(jm_history_t* history);
+
+/**
+ * Append one snapshot for each disk that has a serial number
+ *
+ * @param history Writable handle
+ * @param source Device the disks were read from (keys disk presence)
+ * @param disks Disks to record (absent disks and disks without a serial are skipped)
+ * @param num_disks Number of entries in disks
+ * @param timestamp Unix time of the snapshots
+ * @param fn Called for each change since the source's previous poll (NULL = none)
+ * @param ctx Passed to fn
+ * @return Number of snapshots appended, or -1 if the source table is full or
+ *         every drive directory entry still has snapshots in the ring
+ */
+int jm_history_append(jm_history_t* history, const char* source, const disk_smart_data_t* disks,
+                      int num_disks, int64_t timestamp, jm_history_change_fn fn, void* ctx);
+
+/**
+ * Open, append and close in one call (for per-poll writers)
+ * A new file gets the default ring and directory sizes.
+ * @return As jm_history_append, or -1 if the file can't be opened
+ */
+int jm_history_record(const char* path, const char* source, const disk_smart_data_t* disks,
+                      int num_disks, int64_t timestamp, jm_history_change_fn fn, void* ctx);
+
+/**
+ * Decode every snapshot in the ring, oldest first
+ * @return Number of snapshots passed to fn
+ */
+int jm_history_scan(jm_history_t* history, jm_history_fn fn, void* ctx);
+
+/**
+ * Write one change as a text line or a JSON line
+ */
+void jm_history_write_change(FILE* out, const jm_history_change_t* change, int json);
+
+/**
+ * Write the heartbeat line printed when a poll changed nothing
+ * @param source Device, or NULL for a report over several sources
+ */
+void jm_history_write_heartbeat(FILE* out, const char* source, int64_t timestamp, int num_disks,
+                                disk_health_status_t status, int json);
+
+#endif /* JM_HISTORY_H */
@@ -0,0 +1,124 @@
+/*
+ * jm_lock.c - Part of jm-raid-status
+ *
+ * Copyright (C) 2026 Jamie Treworgy
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "jm_lock.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+
+#define LOCK_RETRY_NS (5 * 1000 * 1000)     /* Between non-blocking attempts */
+
+void jm_lock_init(jm_lock_t* lock) {
+    lock->fd = -1;
+    lock->held = 0;
+    lock->generation = 0;
+}
+
+int jm_lock_key(const char* device_path, char* key, size_t key_size) {
+    char real[PATH_MAX];
+    const char* base;
+    size_t n = 0;
+
+    if (realpath(device_path, real) == NULL) {
+        return -1;
+    }
+    base = strrchr(real, '/');
+    base = base ? base + 1 : real;
+
+    for (const char* p = base; *p && n < key_size - 1; p++) {
+        key[n++] = *p;
+    }
+    key[n] = '\0';
+    return n > 0 ? 0 : -1;
+}
+
+/* Helper: Exchange count stored at the start of the lock file (0 if new) */
+static uint64_t read_generation(int fd) {
+    uint64_t generation = 0;
+    if (pread(fd, &generation, sizeof(generation), 0) != (ssize_t)sizeof(generation)) {
+        return 0;
+    }
+    return generation;
+}
+
+int jm_lock_open(jm_lock_t* lock, const char* dir, const char* device_path) {
+    char key[NAME_MAX + 1], path[PATH_MAX];
+
+    jm_lock_init(lock);
+    if (jm_lock_key(device_path, key, sizeof(key)) != 0) {
+        return -1;
+    }
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+        return -1;
+    }
+    int len = snprintf(path, sizeof(path), "%s/%s.lock", dir, key);
+    if (len < 0 || (size_t)len >= sizeof(path)) {
+        return -1;
+    }
+
+    lock->fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (lock->fd < 0) {
+        return -1;
+    }
+    lock->generation = read_generation(lock->fd);
+    return 0;
+}
+
+int jm_lock_acquire(jm_lock_t* lock, int timeout_ms) {
+    const struct timespec pause = { 0, LOCK_RETRY_NS };
+    long waited_ns = 0;
+
+    if (lock->fd < 0) {
+        return -1;
+    }
+    if (lock->held) {
+        return 0;
+    }
+
+    /* Polled rather than blocking so the wait is bounded without signals */
+    while (flock(lock->fd, LOCK_EX | LOCK_NB) != 0) {
+        if (errno != EWOULDBLOCK && errno != EINTR) {
+            return -1;
+        }
+        if (waited_ns >= (long)timeout_ms * 1000000L) {
+            return -1;
+        }
+        nanosleep(&pause, NULL);
+        waited_ns += LOCK_RETRY_NS;
+    }
+    lock->held = 1;
+
+    return read_generation(lock->fd) != lock->generation ? 1 : 0;
+}
+
+void jm_lock_release(jm_lock_t* lock) {
+    if (lock->fd < 0 || !lock->held) {
+        return;
+    }
+    uint64_t generation = read_generation(lock->fd) + 1;
+    if (pwrite(lock->fd, &generation, sizeof(generation), 0) == (ssize_t)sizeof(generation)) {
+        lock->generation = generation;
+    }
+    flock(lock->fd, LOCK_UN);
+    lock->held = 0;
+}
+
+void jm_lock_close(jm_lock_t* lock) {
+    if (lock->fd < 0) {
+        return;
+    }
+    jm_lock_release(lock);
+    close(lock->fd);
+    lock->fd = -1;
+}
@@ -0,0 +1,74 @@
+/*
+ * jm_lock.h - Part of jm-raid-status
+ *
+ * Copyright (C) 2026 Jamie Treworgy
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef JM_LOCK_H
+#define JM_LOCK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define JM_RUN_DEFAULT_DIR "/run/jmraidstatus"
+#define JM_LOCK_DEFAULT_TIMEOUT_MS 30000
+
+/*
+ * Mailbox lock
+ *
+ * Every process talking to a controller writes commands to and reads
+ * responses from the same communication sector, so two of them at once
+ * corrupt each other's exchanges. Each holds "<dir>/<device>.lock" with an
+ * exclusive flock() around every exchange (open and wakeup, each poll, and
+ * the cleanup write). The lock file also counts completed exchanges: a
+ * process that keeps its session open between exchanges sees when someone
+ * else used, and possibly reset, the mailbox in the meantime.
+ */
+
+/**
+ * A device's lock file
+ */
+typedef struct {
+    int fd;                             /* -1 = not open (no locking) */
+    int held;
+    uint64_t generation;                /* Exchange count after our last release */
+} jm_lock_t;
+
+/**
+ * Initialize a lock structure (does not open anything)
+ */
+void jm_lock_init(jm_lock_t* lock);
+
+/**
+ * Kernel name of a device path, following symlinks ("sdc" for /dev/sdc or
+ * a /dev/disk/by-id link to it); names the lock and result files
+ * @return 0 on success, -1 if the path doesn't resolve
+ */
+int jm_lock_key(const char* device_path, char* key, size_t key_size);
+
+/**
+ * Open (creating if needed) the lock file of a device
+ * @param dir Run directory (created if needed)
+ * @return 0 on success, -1 if the directory or file can't be created
+ */
+int jm_lock_open(jm_lock_t* lock, const char* dir, const char* device_path);
+
+/**
+ * Take the lock, waiting up to timeout_ms for another process to finish
+ * @return 1 if another process used the mailbox since our last release,
+ *         0 if not, -1 on timeout (or if the lock is not open)
+ */
+int jm_lock_acquire(jm_lock_t* lock, int timeout_ms);
+
+/**
+ * Count the exchange and release the lock (no-op unless held)
+ */
+void jm_lock_release(jm_lock_t* lock);
+
+/**
+ * Release if held and close the lock file
+ */
+void jm_lock_close(jm_lock_t* lock);
+
+#endif /* JM_LOCK_H */
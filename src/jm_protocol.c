@@ -5,9 +5,9 @@
  * SPDX-License-Identifier: MIT
  */
 
+#define _GNU_SOURCE  /* O_DIRECT */
 #include "jm_protocol.h"
 #include "jm_crc.h"
-#include "sata_xor.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -19,82 +19,95 @@
 #include <errno.h>
 #include <signal.h>
 #include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
 
 #define READ_CMD (0x28)
 #define WRITE_CMD (0x2a)
-#define RW_CMD_LEN (10)
 
 #define JM_RAID_WAKEUP_CMD    (0x197b0325)
 #define JM_RAID_SCRAMBLED_CMD (0x197b0322)
 
-/* Static SG_IO header - reused for all operations */
-static sg_io_hdr_t sg_io_hdr;
-static uint8_t rw_cmd_blk[RW_CMD_LEN];
-
-/* Global state for signal handlers - ensures cleanup on interruption */
-static volatile sig_atomic_t g_cleanup_fd = -1;
-static volatile sig_atomic_t g_cleanup_sector = 0;
-static volatile sig_atomic_t g_cleanup_done = 0;
+/* Signal cleanup registry - one slot per live session.
+ * Slots store fd + 1 so that 0 means "free" and -1 "being filled in".
+ * Lock-free atomics are async-signal-safe, so the handler can walk the
+ * table directly. The registration count and the handler installation
+ * change together under g_handlers_lock, which the handler never takes. */
+static atomic_int g_cleanup_fds[JM_MAX_CLEANUP_SESSIONS];
+static atomic_uint g_cleanup_sectors[JM_MAX_CLEANUP_SESSIONS];
+static pthread_mutex_t g_handlers_lock = PTHREAD_MUTEX_INITIALIZER;
+static int g_cleanup_registered = 0;
 
 /**
- * Signal handler - writes zeros to communication sector and exits
- * This is called on SIGINT (Ctrl+C), SIGTERM, etc.
+ * Fill a READ(10)/WRITE(10) command block for a single sector
  */
-static void jm_signal_handler(int signum) {
-    /* If cleanup already done or not initialized, just exit */
-    if (g_cleanup_done || g_cleanup_fd < 0) {
-        _exit(128 + signum);
-    }
-
-    /* Mark cleanup as done (prevents re-entry) */
-    g_cleanup_done = 1;
+static void set_rw_cmd(uint8_t* cmd_blk, uint8_t opcode, uint32_t sector) {
+    cmd_blk[0] = opcode;
+    cmd_blk[5] = sector & 0xFF;
+    cmd_blk[4] = (sector >> 8) & 0xFF;
+    cmd_blk[3] = (sector >> 16) & 0xFF;
+    cmd_blk[2] = (sector >> 24) & 0xFF;
+    cmd_blk[8] = 0x01;  /* Number of sectors */
+}
 
-    /* Write zeros to sector - use direct write, avoid jm_cleanup_device
-     * to keep signal handler simple and async-signal-safe */
-    uint8_t zero_sector[512];
-    memset(zero_sector, 0, 512);
+/**
+ * Write zeros to a sector with a private SG_IO header
+ * Async-signal-safe: touches only the stack and the ioctl.
+ */
+static int write_zero_sector(int fd, uint32_t sector) {
+    uint8_t zero_sector[JM_SECTORSIZE];
+    memset(zero_sector, 0, JM_SECTORSIZE);
 
-    /* Setup write command */
-    uint8_t cmd_blk[10];
-    memset(cmd_blk, 0, 10);
-    cmd_blk[0] = WRITE_CMD;
-    cmd_blk[5] = g_cleanup_sector & 0xFF;
-    cmd_blk[4] = (g_cleanup_sector >> 8) & 0xFF;
-    cmd_blk[3] = (g_cleanup_sector >> 16) & 0xFF;
-    cmd_blk[2] = (g_cleanup_sector >> 24) & 0xFF;
-    cmd_blk[8] = 0x01;  // Number of sectors
+    uint8_t cmd_blk[JM_RW_CMD_LEN];
+    memset(cmd_blk, 0, JM_RW_CMD_LEN);
+    set_rw_cmd(cmd_blk, WRITE_CMD, sector);
 
     sg_io_hdr_t io_hdr;
     memset(&io_hdr, 0, sizeof(io_hdr));
-    io_hdr.interface_id = 'S';
+    io_hdr.interface_id    = 'S';
     io_hdr.dxfer_direction = SG_DXFER_TO_DEV;
-    io_hdr.cmd_len = 10;
-    io_hdr.dxfer_len = 512;
-    io_hdr.dxferp = zero_sector;
-    io_hdr.cmdp = cmd_blk;
-    io_hdr.timeout = 3000;
+    io_hdr.cmd_len         = JM_RW_CMD_LEN;
+    io_hdr.dxfer_len       = JM_SECTORSIZE;
+    io_hdr.dxferp          = zero_sector;
+    io_hdr.cmdp            = cmd_blk;
+    io_hdr.timeout         = 3000;
+
+    return ioctl(fd, SG_IO, &io_hdr);
+}
+
+/**
+ * Signal handler - writes zeros to every registered session's sector and exits
+ * This is called on SIGINT (Ctrl+C), SIGTERM, etc.
+ */
+static void jm_signal_handler(int signum) {
+    for (int i = 0; i < JM_MAX_CLEANUP_SESSIONS; i++) {
+        /* Claim the slot so a racing cleanup (or second signal) skips it;
+         * a slot still being filled in has no sector to clean yet */
+        int fd_plus_one = atomic_load(&g_cleanup_fds[i]);
+        if (fd_plus_one <= 0 || !atomic_compare_exchange_strong(&g_cleanup_fds[i], &fd_plus_one, 0)) {
+            continue;
+        }
 
-    /* Best effort write - ignore errors in signal handler */
-    ioctl(g_cleanup_fd, SG_IO, &io_hdr);
+        /* Best effort write - ignore errors in signal handler */
+        write_zero_sector(fd_plus_one - 1, atomic_load(&g_cleanup_sectors[i]));
+    }
 
     /* Exit with signal-specific exit code */
     _exit(128 + signum);
 }
 
-/**
- * Setup signal handlers to ensure cleanup on interruption
- */
-void jm_setup_signal_handlers(int fd, uint32_t sector) {
+static void install_handlers(void) {
     struct sigaction sa;
     memset(&sa, 0, sizeof(sa));
     sa.sa_handler = jm_signal_handler;
     sigemptyset(&sa.sa_mask);
     sa.sa_flags = SA_RESETHAND;  /* Only catch first signal */
 
-    /* Store for signal handler */
-    g_cleanup_fd = fd;
-    g_cleanup_sector = sector;
-    g_cleanup_done = 0;
+    /* Block the other termination signals while the handler runs */
+    sigaddset(&sa.sa_mask, SIGINT);
+    sigaddset(&sa.sa_mask, SIGTERM);
+    sigaddset(&sa.sa_mask, SIGHUP);
+    sigaddset(&sa.sa_mask, SIGQUIT);
 
     /* Install handlers for catchable termination signals */
     sigaction(SIGINT, &sa, NULL);   /* Ctrl+C */
@@ -104,16 +117,145 @@ void jm_setup_signal_handlers(int fd, uint32_t sector) {
 }
 
 /**
- * Remove signal handlers (restore default behavior)
+ * Register a session for cleanup on interruption
  */
-void jm_remove_signal_handlers(void) {
-    signal(SIGINT, SIG_DFL);
-    signal(SIGTERM, SIG_DFL);
-    signal(SIGHUP, SIG_DFL);
-    signal(SIGQUIT, SIG_DFL);
-    g_cleanup_fd = -1;
+int jm_setup_signal_handlers(jm_session_t* session) {
+    if (session == NULL || session->fd < 0) {
+        return -1;
+    }
+    if (session->cleanup_slot >= 0) {
+        return 0;  /* Already registered */
+    }
+
+    for (int i = 0; i < JM_MAX_CLEANUP_SESSIONS; i++) {
+        /* Claim the slot first, so no other thread can store its sector here;
+         * the fd is published only once the sector is visible */
+        int expected = 0;
+        if (!atomic_compare_exchange_strong(&g_cleanup_fds[i], &expected, -1)) {
+            continue;
+        }
+        atomic_store(&g_cleanup_sectors[i], session->sector);
+        session->cleanup_slot = i;
+
+        pthread_mutex_lock(&g_handlers_lock);
+        if (g_cleanup_registered++ == 0) {
+            install_handlers();
+        }
+        pthread_mutex_unlock(&g_handlers_lock);
+
+        atomic_store(&g_cleanup_fds[i], session->fd + 1);
+        return 0;
+    }
+
+    return -1;
+}
+
+/**
+ * Unregister a session (restore default behavior when none remain)
+ */
+void jm_remove_signal_handlers(jm_session_t* session) {
+    if (session == NULL || session->cleanup_slot < 0) {
+        return;
+    }
+
+    atomic_store(&g_cleanup_fds[session->cleanup_slot], 0);
+    session->cleanup_slot = -1;
+
+    /* Under the lock, so a session registering right now can't have its
+     * freshly installed handlers reset behind it */
+    pthread_mutex_lock(&g_handlers_lock);
+    if (--g_cleanup_registered == 0) {
+        signal(SIGINT, SIG_DFL);
+        signal(SIGTERM, SIG_DFL);
+        signal(SIGHUP, SIG_DFL);
+        signal(SIGQUIT, SIG_DFL);
+    }
+    pthread_mutex_unlock(&g_handlers_lock);
+}
+
+/**
+ * A session is usable with an open fd or with a transport (replay has no fd)
+ */
+static int session_is_open(const jm_session_t* session) {
+    return session != NULL && (session->fd >= 0 || session->transport != NULL);
+}
+
+/**
+ * Fold one successful transfer into the round-trip estimate and derive the
+ * next SG_IO timeout from it (RFC 6298 smoothing, in microseconds)
+ */
+static void update_timeout(jm_session_t* session, uint64_t elapsed_us) {
+    uint32_t rtt = (elapsed_us > UINT32_MAX / 8) ? UINT32_MAX / 8 : (uint32_t)elapsed_us;
+
+    if (session->srtt_us == 0) {
+        session->srtt_us = rtt ? rtt : 1;
+        session->rttvar_us = rtt / 2;
+    } else {
+        uint32_t delta = (rtt > session->srtt_us) ? rtt - session->srtt_us : session->srtt_us - rtt;
+        session->rttvar_us = (3 * session->rttvar_us + delta) / 4;
+        session->srtt_us = (7 * session->srtt_us + rtt) / 8;
+    }
+
+    uint64_t timeout_ms = ((uint64_t)session->srtt_us + 4ULL * session->rttvar_us + 999) / 1000;
+    if (timeout_ms < JM_TIMEOUT_MIN_MS) {
+        timeout_ms = JM_TIMEOUT_MIN_MS;
+    } else if (timeout_ms > JM_TIMEOUT_MAX_MS) {
+        timeout_ms = JM_TIMEOUT_MAX_MS;
+    }
+    session->timeout_ms = (uint32_t)timeout_ms;
+}
+
+/**
+ * Move one mailbox sector through the session's transport
+ */
+static int transfer_sector(jm_session_t* session, jm_xfer_dir_t dir, void* buf) {
+    uint64_t start = jm_monotonic_us();
+
+    int ret = (session->transport != NULL)
+                  ? session->transport->transfer(session->transport, session, dir, buf)
+                  : jm_sg_transfer(session, dir, buf);
+
+    uint64_t elapsed = jm_monotonic_us() - start;
+    if (session->timings) {
+        jm_latency_add(dir == JM_XFER_TO_DEV ? &session->timings->ioctl_write
+                                             : &session->timings->ioctl_read,
+                       elapsed);
+    }
+
+    if (ret == 0) {
+        update_timeout(session, elapsed);
+    } else if (ret == JM_XFER_TIMED_OUT) {
+        /* Back off until a transfer completes again */
+        session->timeout_ms = (session->timeout_ms * 2 > JM_TIMEOUT_MAX_MS)
+                                  ? JM_TIMEOUT_MAX_MS : session->timeout_ms * 2;
+    }
+    return ret;
+}
+
+int jm_sg_transfer(jm_session_t* session, jm_xfer_dir_t dir, void* buf) {
+    if (session == NULL || session->fd < 0 || buf == NULL) {
+        return -1;
+    }
+
+    set_rw_cmd(session->rw_cmd_blk, (dir == JM_XFER_TO_DEV) ? WRITE_CMD : READ_CMD, session->sector);
+    session->sg_io_hdr.dxfer_direction = (dir == JM_XFER_TO_DEV) ? SG_DXFER_TO_DEV : SG_DXFER_FROM_DEV;
+    session->sg_io_hdr.dxferp = buf;
+    session->sg_io_hdr.timeout = session->timeout_ms;
+
+    int ret = ioctl(session->fd, SG_IO, &session->sg_io_hdr);
+
+    /* Don't leave the session pointing at a caller's (often stack) buffer */
+    session->sg_io_hdr.dxferp = NULL;
+
+    if (ret < 0) {
+        return (errno == ETIMEDOUT) ? JM_XFER_TIMED_OUT : -1;
+    }
+    /* DID_TIME_OUT (host) or DRIVER_TIMEOUT (driver): the command was aborted */
+    if (session->sg_io_hdr.host_status == 0x03 || (session->sg_io_hdr.driver_status & 0x0f) == 0x06) {
+        return JM_XFER_TIMED_OUT;
+    }
+    return 0;
 }
-static uint8_t sense_buffer[32];
 
 const char* jm_error_string(jm_error_code_t error_code) {
     switch (error_code) {
@@ -129,16 +271,33 @@ const char* jm_error_string(jm_error_code_t error_code) {
             return "Response CRC mismatch";
         case JM_ERROR_INVALID_ARGS:
             return "Invalid arguments";
+        case JM_ERROR_TIMEOUT:
+            return "Command timed out";
         default:
             return "Unknown error";
     }
 }
 
-int jm_init_device(const char* device_path, int* fd_out) {
+void jm_session_init(jm_session_t* session, uint32_t sector) {
+    memset(session, 0, sizeof(jm_session_t));
+    session->fd = -1;
+    session->sector = sector;
+    session->cmd_counter = 1;
+    session->cleanup_slot = -1;
+    session->max_retries = JM_DEFAULT_RETRIES;
+    session->reads = JM_READ_ALL;
+    session->timeout_ms = JM_TIMEOUT_MAX_MS;
+    session->jitter_state = (uint32_t)jm_monotonic_us() ^ (sector * 2654435761u);
+    if (session->jitter_state == 0) {
+        session->jitter_state = 1;
+    }
+}
+
+int jm_init_device(jm_session_t* session, const char* device_path) {
     int fd;
     int sg_version;
 
-    if (device_path == NULL || fd_out == NULL) {
+    if (session == NULL || device_path == NULL) {
         return JM_ERROR_INVALID_ARGS;
     }
 
@@ -155,114 +314,82 @@ int jm_init_device(const char* device_path, int* fd_out) {
     }
 
     /* Setup SG_IO header for subsequent operations */
-    memset(&sg_io_hdr, 0, sizeof(sg_io_hdr_t));
-    sg_io_hdr.interface_id = 'S';
-    sg_io_hdr.cmd_len = RW_CMD_LEN;
-    sg_io_hdr.mx_sb_len = sizeof(sense_buffer);
-    sg_io_hdr.dxfer_len = JM_SECTORSIZE;
-    sg_io_hdr.cmdp = rw_cmd_blk;
-    sg_io_hdr.sbp = sense_buffer;
-    sg_io_hdr.timeout = 3000;
-
-    memset(rw_cmd_blk, 0, RW_CMD_LEN);
-    rw_cmd_blk[8] = 0x01;  /* Number of sectors */
-
-    *fd_out = fd;
+    sg_io_hdr_t* hdr = &session->sg_io_hdr;
+    memset(hdr, 0, sizeof(sg_io_hdr_t));
+    hdr->interface_id = 'S';
+    hdr->cmd_len = JM_RW_CMD_LEN;
+    hdr->mx_sb_len = sizeof(session->sense_buffer);
+    hdr->dxfer_len = JM_SECTORSIZE;
+    hdr->cmdp = session->rw_cmd_blk;
+    hdr->sbp = session->sense_buffer;
+    hdr->timeout = session->timeout_ms;
+
+    memset(session->rw_cmd_blk, 0, JM_RW_CMD_LEN);
+    session->rw_cmd_blk[8] = 0x01;  /* Number of sectors */
+
+    session->fd = fd;
     return JM_SUCCESS;
 }
 
-int jm_cleanup_device(int fd, uint32_t sector) {
-    if (fd < 0) {
+int jm_cleanup_device(jm_session_t* session) {
+    uint8_t zero_sector[JM_SECTORSIZE];
+
+    if (session == NULL) {
         return JM_ERROR_INVALID_ARGS;
     }
 
-    /* Mark cleanup as done to prevent signal handler from running */
-    g_cleanup_done = 1;
-
     /* Idempotent - safe to call multiple times */
-    if (g_cleanup_fd == -1) {
+    if (!session_is_open(session)) {
         return JM_SUCCESS;  /* Already cleaned up */
     }
 
-    /* Remove signal handlers */
-    jm_remove_signal_handlers();
-
-    /* Write zeros to sector (restore to verified-safe state) */
-    static uint8_t zero_sector[512];
-    memset(zero_sector, 0, 512);
+    /* Unregister first so the signal handler cannot race this write */
+    jm_remove_signal_handlers(session);
 
-    /* Update command block for write */
-    rw_cmd_blk[0] = WRITE_CMD;
-    rw_cmd_blk[5] = sector & 0xFF;
-    rw_cmd_blk[4] = (sector >> 8) & 0xFF;
-    rw_cmd_blk[3] = (sector >> 16) & 0xFF;
-    rw_cmd_blk[2] = (sector >> 24) & 0xFF;
+    /* Write zeros to sector (restore to verified-safe state), never with a
+     * timeout tightened for commands */
+    session->timeout_ms = JM_TIMEOUT_MAX_MS;
+    memset(zero_sector, 0, JM_SECTORSIZE);
+    int ret = transfer_sector(session, JM_XFER_TO_DEV, zero_sector);
 
-    /* Write zeros to sector */
-    sg_io_hdr.dxfer_direction = SG_DXFER_TO_DEV;
-    sg_io_hdr.dxferp = zero_sector;
-
-    if (ioctl(fd, SG_IO, &sg_io_hdr) < 0) {
-        close(fd);
-        return JM_ERROR_IOCTL_FAILED;
+    if (session->transport != NULL) {
+        session->transport->close(session->transport);
+        session->transport = NULL;
+    }
+    if (session->fd >= 0) {
+        close(session->fd);
+        session->fd = -1;  /* Mark as cleaned up */
     }
 
-    close(fd);
-    g_cleanup_fd = -1;  /* Mark as cleaned up */
-    return JM_SUCCESS;
+    return (ret < 0) ? JM_ERROR_IOCTL_FAILED : JM_SUCCESS;
 }
 
-int jm_zero_sector(int fd, uint32_t sector) {
-    if (fd < 0) {
+int jm_zero_sector(jm_session_t* session) {
+    uint8_t zero_sector[JM_SECTORSIZE];
+
+    if (!session_is_open(session)) {
         return JM_ERROR_INVALID_ARGS;
     }
 
-    uint8_t zero_buf[512];
-    memset(zero_buf, 0, 512);
-
-    uint8_t cmd_blk[10];
-    memset(cmd_blk, 0, 10);
-    cmd_blk[0] = WRITE_CMD;
-    cmd_blk[5] = sector & 0xFF;
-    cmd_blk[4] = (sector >> 8) & 0xFF;
-    cmd_blk[3] = (sector >> 16) & 0xFF;
-    cmd_blk[2] = (sector >> 24) & 0xFF;
-    cmd_blk[8] = 0x01;
-
-    sg_io_hdr_t io_hdr;
-    memset(&io_hdr, 0, sizeof(io_hdr));
-    io_hdr.interface_id    = 'S';
-    io_hdr.dxfer_direction = SG_DXFER_TO_DEV;
-    io_hdr.cmd_len         = 10;
-    io_hdr.dxfer_len       = 512;
-    io_hdr.dxferp          = zero_buf;
-    io_hdr.cmdp            = cmd_blk;
-    io_hdr.timeout         = 3000;
-
-    if (ioctl(fd, SG_IO, &io_hdr) < 0) {
+    memset(zero_sector, 0, JM_SECTORSIZE);
+    if (transfer_sector(session, JM_XFER_TO_DEV, zero_sector) < 0) {
         return JM_ERROR_IOCTL_FAILED;
     }
 
     return JM_SUCCESS;
 }
 
-int jm_send_wakeup(int fd, uint32_t sector) {
+int jm_send_wakeup(jm_session_t* session) {
     uint8_t wakeup_buf[JM_SECTORSIZE];
     uint32_t* wakeup_buf32 = (uint32_t*)wakeup_buf;
 
+    if (!session_is_open(session)) {
+        return JM_ERROR_INVALID_ARGS;
+    }
+
     /* Wakeup sequence constants */
     const uint32_t wakeup_values[] = {0x3c75a80b, 0x0388e337, 0x689705f3, 0xe00c523a};
 
-    /* Update command block for write */
-    rw_cmd_blk[0] = WRITE_CMD;
-    rw_cmd_blk[5] = sector & 0xFF;
-    rw_cmd_blk[4] = (sector >> 8) & 0xFF;
-    rw_cmd_blk[3] = (sector >> 16) & 0xFF;
-    rw_cmd_blk[2] = (sector >> 24) & 0xFF;
-
-    sg_io_hdr.dxfer_direction = SG_DXFER_TO_DEV;
-    sg_io_hdr.dxferp = wakeup_buf;
-
     /* Send 4 wakeup sectors */
     for (int i = 0; i < 4; i++) {
         memset(wakeup_buf, 0, JM_SECTORSIZE);
@@ -282,7 +409,7 @@ int jm_send_wakeup(int fd, uint32_t sector) {
         wakeup_buf32[0x1fc >> 2] = __cpu_to_le32(crc);
 
         /* Send wakeup sector */
-        if (ioctl(fd, SG_IO, &sg_io_hdr) < 0) {
+        if (transfer_sector(session, JM_XFER_TO_DEV, wakeup_buf) < 0) {
             return JM_ERROR_IOCTL_FAILED;
         }
     }
@@ -290,56 +417,92 @@ int jm_send_wakeup(int fd, uint32_t sector) {
     return JM_SUCCESS;
 }
 
-int jm_execute_command(int fd, uint32_t* cmd_buf, uint32_t* resp_buf, uint32_t sector) {
-    if (fd < 0 || cmd_buf == NULL || resp_buf == NULL) {
-        return JM_ERROR_INVALID_ARGS;
-    }
+jm_cmd_type_t jm_classify_command(const uint32_t* cmd_buf) {
+    /* Payload follows the 8-byte scrambled header: 00 02 <kind> ff <disk> ... */
+    const uint8_t* payload = (const uint8_t*)cmd_buf + 8;
 
-    /* Calculate CRC for the request */
-    uint32_t crc = JM_CRC(cmd_buf, 0x7f);
-    cmd_buf[0x7f] = __cpu_to_le32(crc);
+    if (payload[0] != 0x00 || payload[1] != 0x02) {
+        return JM_CMD_OTHER;
+    }
+    if (payload[2] == 0x02) {
+        return JM_CMD_IDENTIFY;
+    }
+    if (payload[2] == 0x03 && payload[10] == 0xd0) {
+        return JM_CMD_SMART_VALUES;
+    }
+    if (payload[2] == 0x03 && payload[10] == 0xd1) {
+        return JM_CMD_SMART_THRESHOLDS;
+    }
+    return JM_CMD_OTHER;
+}
 
-    /* Apply XOR scrambling */
-    SATA_XOR(cmd_buf);
+int jm_execute_command(jm_session_t* session, uint32_t* cmd_buf, uint32_t* resp_buf) {
+    if (!session_is_open(session) || cmd_buf == NULL || resp_buf == NULL) {
+        return JM_ERROR_INVALID_ARGS;
+    }
 
-    /* Update command block for sector */
-    rw_cmd_blk[5] = sector & 0xFF;
-    rw_cmd_blk[4] = (sector >> 8) & 0xFF;
-    rw_cmd_blk[3] = (sector >> 16) & 0xFF;
-    rw_cmd_blk[2] = (sector >> 24) & 0xFF;
+    /* Classify before scrambling hides the payload */
+    jm_cmd_type_t type = session->timings ? jm_classify_command(cmd_buf) : JM_CMD_OTHER;
+    uint64_t start = session->timings ? jm_monotonic_us() : 0;
 
-    /* Send command (write) */
-    rw_cmd_blk[0] = WRITE_CMD;
-    sg_io_hdr.dxfer_direction = SG_DXFER_TO_DEV;
-    sg_io_hdr.dxferp = cmd_buf;
+    /* Calculate CRC for the request and apply XOR scrambling (one pass) */
+    uint32_t crc = JM_CRC_THEN_XOR(cmd_buf);
 
-    if (ioctl(fd, SG_IO, &sg_io_hdr) < 0) {
-        return JM_ERROR_IOCTL_FAILED;
+    /* Send command (write), then read the response */
+    int ret = transfer_sector(session, JM_XFER_TO_DEV, cmd_buf);
+    if (ret == 0) {
+        ret = transfer_sector(session, JM_XFER_FROM_DEV, resp_buf);
     }
 
-    /* Read response */
-    rw_cmd_blk[0] = READ_CMD;
-    sg_io_hdr.dxfer_direction = SG_DXFER_FROM_DEV;
-    sg_io_hdr.dxferp = resp_buf;
-
-    if (ioctl(fd, SG_IO, &sg_io_hdr) < 0) {
+    if (session->timings) {
+        jm_latency_add(&session->timings->commands[type], jm_monotonic_us() - start);
+    }
+    if (ret == JM_XFER_TIMED_OUT) {
+        return JM_ERROR_TIMEOUT;
+    }
+    if (ret < 0) {
         return JM_ERROR_IOCTL_FAILED;
     }
 
-    /* Remove XOR scrambling from response */
-    SATA_XOR(resp_buf);
-
-    /* Verify response CRC */
-    crc = JM_CRC(resp_buf, 0x7f);
+    /* Remove XOR scrambling from response and verify its CRC (one pass) */
+    crc = JM_XOR_THEN_CRC(resp_buf);
     if (crc != __le32_to_cpu(resp_buf[0x7f])) {
-        fprintf(stderr, "Warning: Response CRC 0x%08x does not match calculated 0x%08x\n",
-                __le32_to_cpu(resp_buf[0x7f]), crc);
+        if (session->verbose) {
+            fprintf(stderr, "Warning: Response CRC 0x%08x does not match calculated 0x%08x\n",
+                    __le32_to_cpu(resp_buf[0x7f]), crc);
+        }
         return JM_ERROR_CRC_MISMATCH;
     }
 
     return JM_SUCCESS;
 }
 
+int jm_is_retryable(int error_code) {
+    return error_code == JM_ERROR_CRC_MISMATCH || error_code == JM_ERROR_TIMEOUT;
+}
+
+void jm_retry_backoff(jm_session_t* session, int retry) {
+    if (session == NULL || retry < 1) {
+        return;
+    }
+
+    /* xorshift32 - only has to decorrelate sessions, not be unpredictable */
+    uint32_t x = session->jitter_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    session->jitter_state = x;
+
+    uint32_t delay_ms = JM_RETRY_BACKOFF_MS << (retry > 8 ? 7 : retry - 1);
+    delay_ms = delay_ms / 2 + x % (delay_ms / 2 + 1);
+
+    struct timespec delay = {
+        .tv_sec = delay_ms / 1000,
+        .tv_nsec = (long)(delay_ms % 1000) * 1000000L
+    };
+    nanosleep(&delay, NULL);
+}
+
 int jm_read_sector_block(const char *device_path, uint32_t sector, uint8_t *buf)
 {
     if (!device_path || !buf)
@@ -360,3 +523,115 @@ int jm_read_sector_block(const char *device_path, uint32_t sector, uint8_t *buf)
 
     return (n == JM_SECTORSIZE) ? 0 : -1;
 }
+
+int jm_sector_is_empty(const uint8_t *sector_data, size_t size)
+{
+    size_t i = 0;
+
+    /* OR 64-byte blocks a word at a time (the compiler vectorizes the inner
+     * loop), stopping at the first block with data */
+    for (; i + 64 <= size; i += 64) {
+        uint64_t acc = 0;
+        for (int w = 0; w < 8; w++) {
+            uint64_t word;
+            memcpy(&word, sector_data + i + w * 8, sizeof(word));
+            acc |= word;
+        }
+        if (acc != 0)
+            return 0;
+    }
+    for (; i < size; i++) {
+        if (sector_data[i] != 0)
+            return 0;
+    }
+    return 1;
+}
+
+/* Read count sectors at sector, falling back to buffered I/O if the device
+ * refuses O_DIRECT. Returns the number of whole sectors read, or -1. */
+static int read_sector_run(const char *device_path, int *fd, uint32_t sector, uint32_t count, uint8_t *buf)
+{
+    off_t offset = (off_t)sector * JM_SECTORSIZE;
+    size_t len = (size_t)count * JM_SECTORSIZE;
+    ssize_t n = pread(*fd, buf, len, offset);
+
+    if (n < 0 && errno == EINVAL) {
+        int buffered = open(device_path, O_RDONLY);
+        if (buffered < 0)
+            return -1;
+        close(*fd);
+        *fd = buffered;
+        n = pread(*fd, buf, len, offset);
+    }
+    return (n < 0) ? -1 : (int)(n / JM_SECTORSIZE);
+}
+
+int jm_find_empty_sectors(const char *device_path, jm_sector_map_t *empty)
+{
+    /* Start at 32 so every read is 4 KB aligned, as O_DIRECT may require */
+    const uint32_t first = 32;
+
+    if (!device_path || !empty)
+        return -1;
+    memset(empty, 0, sizeof(*empty));
+
+    int fd = open(device_path, O_RDONLY | O_DIRECT);
+    if (fd < 0)
+        fd = open(device_path, O_RDONLY);
+    if (fd < 0)
+        return -1;
+
+    void *buf = NULL;
+    if (posix_memalign(&buf, 4096, (size_t)JM_FIND_CHUNK_SECTORS * JM_SECTORSIZE) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    int found = 0;
+    for (uint32_t sector = first; sector < JM_SAFE_SECTOR_END; sector += JM_FIND_CHUNK_SECTORS) {
+        uint32_t count = JM_SAFE_SECTOR_END - sector;
+        if (count > JM_FIND_CHUNK_SECTORS)
+            count = JM_FIND_CHUNK_SECTORS;
+
+        int n = read_sector_run(device_path, &fd, sector, count, buf);
+        if (n < 0) {
+            found = -1;
+            break;
+        }
+        for (int i = 0; i < n; i++) {
+            uint32_t s = sector + (uint32_t)i;
+            if (jm_sector_in_safe_range(s) &&
+                jm_sector_is_empty((const uint8_t *)buf + (size_t)i * JM_SECTORSIZE, JM_SECTORSIZE)) {
+                empty->bits[s / 64] |= 1ull << (s % 64);
+                found++;
+            }
+        }
+        if ((uint32_t)n < count)
+            break; /* End of a small device */
+    }
+
+    free(buf);
+    close(fd);
+    return found;
+}
+
+int jm_sector_in_safe_range(uint32_t sector)
+{
+    /* Allow 0x21 (33) for backwards compatibility - original JMRaidCon default */
+    if (sector == 0x21) {
+        return 1;
+    }
+
+    /* Reject sectors 0-63: MBR, partition table, GPT protective MBR, boot loaders */
+    /* (except 0x21 which we allow above) */
+    if (sector < 64) {
+        return 0;
+    }
+
+    /* Reject sector 2048 and above (typical first partition start) */
+    if (sector >= 2048) {
+        return 0;
+    }
+
+    return 1;
+}
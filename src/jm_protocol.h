@@ -9,8 +9,40 @@
 #define JM_PROTOCOL_H
 
 #include <stdint.h>
+#include <scsi/sg.h>
+#include "jm_timings.h"
 
 #define JM_SECTORSIZE 512
+#define JM_RW_CMD_LEN 10
+#define JM_SENSE_LEN 32
+
+/* Maximum sessions that can be registered for signal cleanup at once */
+#define JM_MAX_CLEANUP_SESSIONS 64
+
+/* SG_IO timeout bounds (ms); the adaptive timeout stays within them */
+#define JM_TIMEOUT_MIN_MS 1000
+#define JM_TIMEOUT_MAX_MS 3000
+
+/* Command retries after a CRC mismatch or timeout (--retries) */
+#define JM_DEFAULT_RETRIES 2
+#define JM_MAX_RETRIES 10
+
+/* Backoff before the first retry (ms); doubles per retry, with jitter */
+#define JM_RETRY_BACKOFF_MS 10
+
+/* Transfer result for a timed-out SG_IO (other failures return -1) */
+#define JM_XFER_TIMED_OUT (-2)
+
+/* Sectors accepted by jm_sector_in_safe_range all lie below this one */
+#define JM_SAFE_SECTOR_END 2048
+
+/* Sectors per read of jm_find_empty_sectors (128 KB) */
+#define JM_FIND_CHUNK_SECTORS 256
+
+/* One bit per sector below JM_SAFE_SECTOR_END */
+typedef struct {
+    uint64_t bits[JM_SAFE_SECTOR_END / 64];
+} jm_sector_map_t;
 
 /* Error codes */
 typedef enum {
@@ -19,79 +51,197 @@ typedef enum {
     JM_ERROR_NOT_SG_DEVICE = 2,
     JM_ERROR_IOCTL_FAILED = 3,
     JM_ERROR_CRC_MISMATCH = 4,
-    JM_ERROR_INVALID_ARGS = 5
+    JM_ERROR_INVALID_ARGS = 5,
+    JM_ERROR_TIMEOUT = 6
 } jm_error_code_t;
 
+/* Direction of one mailbox transfer */
+typedef enum {
+    JM_XFER_TO_DEV = 0,              /* WRITE(10) of the mailbox sector */
+    JM_XFER_FROM_DEV = 1             /* READ(10) of the mailbox sector */
+} jm_xfer_dir_t;
+
+struct jm_session;
+
+/**
+ * Mailbox transport
+ *
+ * Moves one 512-byte sector to or from the controller. A session without
+ * a transport issues SG_IO on its fd directly; record/replay (jm_replay.h)
+ * plug in here. Implementations embed this struct as their first member.
+ */
+typedef struct jm_transport {
+    /* Returns 0 on success, -1 on failure (like the SG_IO ioctl), or
+     * JM_XFER_TIMED_OUT if the transfer timed out */
+    int (*transfer)(struct jm_transport* transport, struct jm_session* session,
+                    jm_xfer_dir_t dir, void* buf);
+    /* Release the transport (called once by jm_cleanup_device) */
+    void (*close)(struct jm_transport* transport);
+} jm_transport_t;
+
+/* SMART commands a poll issues after IDENTIFY (jm_session_t.reads) */
+#define JM_READ_VALUES     0x01         /* SMART READ ATTRIBUTE VALUES (0xD0) */
+#define JM_READ_THRESHOLDS 0x02         /* SMART READ ATTRIBUTE THRESHOLDS (0xD1) */
+#define JM_READ_ALL        (JM_READ_VALUES | JM_READ_THRESHOLDS)
+
+/**
+ * Controller session
+ *
+ * Owns everything needed to talk to one controller: the open device, the
+ * communication sector, the scrambled-command counter and the SG_IO header
+ * and buffers. Sessions share no state, so a process can drive several
+ * controllers at once (one thread per session).
+ */
+typedef struct jm_session {
+    int fd;                          /* SG device, -1 when closed */
+    uint32_t sector;                 /* Communication (mailbox) sector */
+    uint32_t cmd_counter;            /* Next scrambled command counter */
+    int verbose;                     /* Verbose output */
+    int dump_raw;                    /* Dump raw protocol data */
+    int expected_array_size;         /* Expected number of disks (0 = not specified) */
+    const char* cache_dir;           /* Identity/threshold cache directory (NULL = disabled) */
+    int cleanup_slot;                /* Signal cleanup registration, -1 if none */
+    jm_transport_t* transport;       /* NULL = SG_IO on fd; owned by the session */
+    jm_timings_t* timings;           /* Latency instrumentation (NULL = disabled) */
+    int max_retries;                 /* Command retries on CRC mismatch/timeout */
+    uint32_t reads;                  /* JM_READ_* commands of a poll (default JM_READ_ALL) */
+    uint32_t retries;                /* Retries issued so far */
+    uint32_t timeout_ms;             /* Current SG_IO timeout (adaptive) */
+    uint32_t srtt_us;                /* Smoothed transfer round-trip time (0 = no sample yet) */
+    uint32_t rttvar_us;              /* Round-trip time variation */
+    uint32_t jitter_state;           /* Backoff jitter PRNG state */
+    int warm_probe;                  /* jm_wake probes before the wakeup sequence */
+    sg_io_hdr_t sg_io_hdr;           /* SG_IO header reused for all operations */
+    uint8_t rw_cmd_blk[JM_RW_CMD_LEN];
+    uint8_t sense_buffer[JM_SENSE_LEN];
+} jm_session_t;
+
+/**
+ * Initialize a session structure (does not open anything)
+ *
+ * @param session Session to initialize
+ * @param sector Sector number to use for communication
+ */
+void jm_session_init(jm_session_t* session, uint32_t sector);
+
 /**
  * Initialize JMicron device for communication
- * Opens device, verifies it's an SG device, and sets up the SG_IO header.
+ * Opens device, verifies it's an SG device, and sets up the session's SG_IO header.
  *
  * The caller is responsible for verifying the sector is safe to use before
  * calling this function (use jm_read_sector_block for the block device check).
  *
+ * @param session Session from jm_session_init
  * @param device_path Path to SCSI generic device (e.g., "/dev/sdc")
- * @param fd_out Output file descriptor for the opened device
  * @return JM_SUCCESS on success, error code on failure
  */
-int jm_init_device(const char* device_path, int* fd_out);
+int jm_init_device(jm_session_t* session, const char* device_path);
+
+/**
+ * Issue one SG_IO READ(10)/WRITE(10) of the session's sector on its fd
+ * This is the default transport; wrapping transports (the recorder) call it.
+ *
+ * Uses session->timeout_ms as the SG_IO timeout.
+ *
+ * @param session Session from jm_init_device
+ * @param dir Transfer direction
+ * @param buf 512-byte buffer to send or fill
+ * @return 0 on success, -1 on ioctl failure, JM_XFER_TIMED_OUT on timeout
+ */
+int jm_sg_transfer(jm_session_t* session, jm_xfer_dir_t dir, void* buf);
 
 /**
- * Clean up and restore sector to zeros
+ * Clean up: restore sector to zeros and close the device (and transport)
  * Can be called multiple times safely (idempotent)
  *
- * @param fd File descriptor from jm_init_device
- * @param sector Sector number that was used
+ * @param session Session from jm_init_device
  * @return JM_SUCCESS on success, error code on failure
  */
-int jm_cleanup_device(int fd, uint32_t sector);
+int jm_cleanup_device(jm_session_t* session);
 
 /**
  * Setup signal handlers to ensure sector cleanup on interruption
- * Must be called after jm_init_device
+ * Must be called after jm_init_device. Several sessions may be registered at
+ * once; a signal zeroes the sector of every registered session.
  *
- * @param fd File descriptor to cleanup on signal
- * @param sector Sector number to zero on cleanup
+ * @param session Session to cleanup on signal
+ * @return 0 on success, -1 if too many sessions are registered
  */
-void jm_setup_signal_handlers(int fd, uint32_t sector);
+int jm_setup_signal_handlers(jm_session_t* session);
 
 /**
- * Remove signal handlers (called automatically on cleanup)
+ * Unregister a session from signal cleanup (called automatically on cleanup)
+ * Default signal behavior is restored once no sessions remain registered.
+ *
+ * @param session Session passed to jm_setup_signal_handlers
  */
-void jm_remove_signal_handlers(void);
+void jm_remove_signal_handlers(jm_session_t* session);
 
 /**
  * Send wakeup sequence to JMicron controller
  * This must be called after jm_init_device before any other commands
  *
- * @param fd File descriptor from jm_init_device
- * @param sector Sector number to use for communication
+ * @param session Session from jm_init_device
  * @return JM_SUCCESS on success, error code on failure
  */
-int jm_send_wakeup(int fd, uint32_t sector);
+int jm_send_wakeup(jm_session_t* session);
+
+/**
+ * Classify a scrambled command by its (unscrambled) payload
+ *
+ * @param cmd_buf Command buffer before jm_execute_command scrambles it
+ * @return Command type for latency accounting
+ */
+jm_cmd_type_t jm_classify_command(const uint32_t* cmd_buf);
 
 /**
  * Execute a JMicron scrambled command
- * Handles CRC calculation, XOR scrambling, and response validation
+ * Handles CRC calculation, XOR scrambling, and response validation.
+ * With session->timings set, the ioctl pair is timed per command type.
+ * A single attempt: callers retry (with a fresh counter) via jm_is_retryable.
  *
- * @param fd File descriptor from jm_init_device
+ * Every successful transfer feeds the session's round-trip estimate, and
+ * the SG_IO timeout follows it (mean + 4 x variation, clamped to
+ * JM_TIMEOUT_MIN_MS..JM_TIMEOUT_MAX_MS). A timeout doubles it until the
+ * next successful transfer.
+ *
+ * @param session Session from jm_init_device
  * @param cmd_buf Command buffer (128 uint32_t = 512 bytes)
  * @param resp_buf Response buffer (128 uint32_t = 512 bytes)
- * @param sector Sector number to use for communication
- * @return JM_SUCCESS on success, JM_ERROR_CRC_MISMATCH if response CRC invalid
+ * @return JM_SUCCESS on success, JM_ERROR_CRC_MISMATCH if response CRC invalid,
+ *         JM_ERROR_TIMEOUT if a transfer timed out
+ */
+int jm_execute_command(jm_session_t* session, uint32_t* cmd_buf, uint32_t* resp_buf);
+
+/**
+ * Check whether a jm_execute_command result is worth retrying
+ * CRC mismatches and timeouts are transient on busy USB links; open and
+ * ioctl failures are not.
+ *
+ * @param error_code Result of jm_execute_command
+ * @return 1 if the command should be re-issued, 0 otherwise
+ */
+int jm_is_retryable(int error_code);
+
+/**
+ * Sleep before a retry: JM_RETRY_BACKOFF_MS doubled per retry, jittered
+ * to 50-100% so sessions sharing a hub do not retry in lockstep
+ *
+ * @param session Session (owns the jitter state)
+ * @param retry Retry number (1 = first retry)
  */
-int jm_execute_command(int fd, uint32_t* cmd_buf, uint32_t* resp_buf, uint32_t sector);
+void jm_retry_backoff(jm_session_t* session, int retry);
 
 /**
- * Write zeros to a sector via SG_IO
+ * Write zeros to the session's sector via SG_IO
  * Lightweight write-zeros without signal handler side effects.
  * Used to clear stale JMicron protocol artifacts before a run.
  * Does NOT close the file descriptor.
  *
- * @param fd File descriptor from jm_init_device
- * @param sector Sector number to zero
+ * @param session Session from jm_init_device
  * @return JM_SUCCESS on success, error code on failure
  */
-int jm_zero_sector(int fd, uint32_t sector);
+int jm_zero_sector(jm_session_t* session);
 
 /**
  * Read a sector via normal block device I/O (not SG_IO)
@@ -111,6 +261,47 @@ int jm_zero_sector(int fd, uint32_t sector);
  */
 int jm_read_sector_block(const char *device_path, uint32_t sector, uint8_t *buf);
 
+/**
+ * Check that a sector read with jm_read_sector_block is all zeros (unused)
+ *
+ * @param sector_data Sector contents
+ * @param size Bytes in sector_data
+ * @return 1 if every byte is zero, 0 otherwise
+ */
+int jm_sector_is_empty(const uint8_t *sector_data, size_t size);
+
+/**
+ * Find every empty sector of the safe range with block I/O
+ *
+ * The check jm_read_sector_block and jm_sector_is_empty make for one
+ * sector, for sectors 33 and 64-2047 at once: the range is read with a few
+ * JM_FIND_CHUNK_SECTORS requests (O_DIRECT where the device allows it, so
+ * the page cache is bypassed as with a single read).
+ *
+ * @param device_path Path to device (e.g., "/dev/sdc")
+ * @param empty Output: bit N set if sector N is in the safe range and all zeros
+ * @return Number of empty safe sectors, or -1 if the device can't be read
+ */
+int jm_find_empty_sectors(const char *device_path, jm_sector_map_t *empty);
+
+/**
+ * Check a sector in a map from jm_find_empty_sectors
+ *
+ * @return 1 if the sector's bit is set, 0 otherwise (or out of range)
+ */
+static inline int jm_sector_map_test(const jm_sector_map_t *map, uint32_t sector)
+{
+    return sector < JM_SAFE_SECTOR_END && ((map->bits[sector / 64] >> (sector % 64)) & 1);
+}
+
+/**
+ * Check that a sector number is outside the partition table and boot areas
+ *
+ * @param sector Sector number
+ * @return 1 for sector 33 (0x21, the original default) or 64-2047, 0 otherwise
+ */
+int jm_sector_in_safe_range(uint32_t sector);
+
 /**
  * Get human-readable error message for error code
  *
@@ -0,0 +1,240 @@
+/*
+ * jm_replay.c - Part of jm-raid-status
+ *
+ * Copyright (C) 2026 Jamie Treworgy
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "jm_replay.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define JM_REPLAY_MAGIC   0x31524d4a  /* "JMR1" */
+#define JM_REPLAY_VERSION 1
+
+/* On-disk header; jm_replay_record_t entries follow it */
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t record_size;               /* sizeof(jm_replay_record_t) */
+    uint32_t sector;
+    uint32_t num_transfers;             /* Patched in when the recording closes */
+    char device_path[256];
+    char controller_model[64];
+} jm_replay_header_t;
+
+/* One transfer as it crossed the wire (still scrambled) */
+typedef struct {
+    uint8_t dir;                        /* jm_xfer_dir_t */
+    uint8_t failed;                     /* Negated transfer error (0 = ok, 2 = timed out) */
+    uint8_t reserved[2];
+    uint32_t elapsed_us;                /* Latency of the transfer */
+    uint8_t data[JM_SECTORSIZE];
+} jm_replay_record_t;
+
+typedef struct {
+    jm_transport_t base;                /* Must be first */
+    jm_transport_t* inner;              /* NULL = SG_IO */
+    FILE* file;
+    jm_replay_header_t header;
+    int write_error;
+    char path[256];
+} recorder_t;
+
+typedef struct {
+    jm_transport_t base;                /* Must be first */
+    jm_replay_record_t* records;
+    uint32_t num_records;
+    uint32_t next;
+    int realtime;
+} replayer_t;
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000;
+}
+
+static int recorder_transfer(jm_transport_t* transport, jm_session_t* session,
+                             jm_xfer_dir_t dir, void* buf) {
+    recorder_t* rec = (recorder_t*)transport;
+    jm_replay_record_t record;
+
+    uint64_t start = now_us();
+    int ret = (rec->inner != NULL) ? rec->inner->transfer(rec->inner, session, dir, buf)
+                                   : jm_sg_transfer(session, dir, buf);
+    uint64_t elapsed = now_us() - start;
+
+    memset(&record, 0, sizeof(record));
+    record.dir = (uint8_t)dir;
+    record.failed = (ret < 0) ? (uint8_t)-ret : 0;
+    record.elapsed_us = (elapsed > UINT32_MAX) ? UINT32_MAX : (uint32_t)elapsed;
+    memcpy(record.data, buf, JM_SECTORSIZE);
+
+    if (fwrite(&record, sizeof(record), 1, rec->file) != 1) {
+        rec->write_error = 1;
+    }
+    rec->header.num_transfers++;
+
+    return ret;
+}
+
+static void recorder_close(jm_transport_t* transport) {
+    recorder_t* rec = (recorder_t*)transport;
+
+    /* Patch the final transfer count into the header */
+    if (fseek(rec->file, 0, SEEK_SET) != 0 ||
+        fwrite(&rec->header, sizeof(rec->header), 1, rec->file) != 1) {
+        rec->write_error = 1;
+    }
+    if (fclose(rec->file) != 0) {
+        rec->write_error = 1;
+    }
+    if (rec->write_error) {
+        fprintf(stderr, "Warning: Recording %s is incomplete (write failed)\n", rec->path);
+    }
+
+    if (rec->inner != NULL) {
+        rec->inner->close(rec->inner);
+    }
+    free(rec);
+}
+
+jm_transport_t* jm_record_open(const char* path, jm_transport_t* inner, const jm_replay_info_t* info) {
+    if (path == NULL || info == NULL) {
+        return NULL;
+    }
+
+    recorder_t* rec = calloc(1, sizeof(recorder_t));
+    if (rec == NULL) {
+        return NULL;
+    }
+
+    rec->file = fopen(path, "wb");
+    if (rec->file == NULL) {
+        free(rec);
+        return NULL;
+    }
+
+    rec->base.transfer = recorder_transfer;
+    rec->base.close = recorder_close;
+    rec->inner = inner;
+    snprintf(rec->path, sizeof(rec->path), "%s", path);
+
+    rec->header.magic = JM_REPLAY_MAGIC;
+    rec->header.version = JM_REPLAY_VERSION;
+    rec->header.record_size = sizeof(jm_replay_record_t);
+    rec->header.sector = info->sector;
+    snprintf(rec->header.device_path, sizeof(rec->header.device_path), "%s", info->device_path);
+    snprintf(rec->header.controller_model, sizeof(rec->header.controller_model), "%s",
+             info->controller_model);
+
+    if (fwrite(&rec->header, sizeof(rec->header), 1, rec->file) != 1) {
+        fclose(rec->file);
+        free(rec);
+        return NULL;
+    }
+
+    return &rec->base;
+}
+
+static int replayer_transfer(jm_transport_t* transport, jm_session_t* session,
+                             jm_xfer_dir_t dir, void* buf) {
+    replayer_t* rp = (replayer_t*)transport;
+
+    if (rp->next >= rp->num_records) {
+        fprintf(stderr, "Warning: Replay exhausted after %u transfers\n", rp->num_records);
+        return -1;
+    }
+
+    const jm_replay_record_t* record = &rp->records[rp->next];
+    if (record->dir != (uint8_t)dir ||
+        (dir == JM_XFER_TO_DEV && memcmp(record->data, buf, JM_SECTORSIZE) != 0)) {
+        fprintf(stderr, "Warning: Replay diverged from the recording at transfer %u "
+                        "(replay with the options used to record)\n", rp->next);
+        return -1;
+    }
+    rp->next++;
+
+    if (session->verbose) {
+        fprintf(stderr, "Replay: transfer %u %s, %u us recorded%s\n", rp->next - 1,
+                dir == JM_XFER_TO_DEV ? "write" : "read", record->elapsed_us,
+                record->failed ? " (failed)" : "");
+    }
+
+    if (rp->realtime && record->elapsed_us > 0) {
+        struct timespec delay = {
+            .tv_sec = record->elapsed_us / 1000000,
+            .tv_nsec = (long)(record->elapsed_us % 1000000) * 1000
+        };
+        nanosleep(&delay, NULL);
+    }
+
+    if (record->failed) {
+        return -(int)record->failed;
+    }
+    if (dir == JM_XFER_FROM_DEV) {
+        memcpy(buf, record->data, JM_SECTORSIZE);
+    }
+    return 0;
+}
+
+static void replayer_close(jm_transport_t* transport) {
+    replayer_t* rp = (replayer_t*)transport;
+    free(rp->records);
+    free(rp);
+}
+
+jm_transport_t* jm_replay_open(const char* path, int realtime, jm_replay_info_t* info) {
+    jm_replay_header_t header;
+
+    if (path == NULL) {
+        return NULL;
+    }
+
+    FILE* f = fopen(path, "rb");
+    if (f == NULL) {
+        return NULL;
+    }
+
+    replayer_t* rp = calloc(1, sizeof(replayer_t));
+    int ok = rp != NULL &&
+             fread(&header, sizeof(header), 1, f) == 1 &&
+             header.magic == JM_REPLAY_MAGIC &&
+             header.version == JM_REPLAY_VERSION &&
+             header.record_size == sizeof(jm_replay_record_t);
+
+    if (ok && header.num_transfers > 0) {
+        rp->records = malloc((size_t)header.num_transfers * sizeof(jm_replay_record_t));
+        ok = rp->records != NULL &&
+             fread(rp->records, sizeof(jm_replay_record_t), header.num_transfers, f) == header.num_transfers;
+    }
+    fclose(f);
+
+    if (!ok) {
+        if (rp != NULL) {
+            free(rp->records);
+            free(rp);
+        }
+        return NULL;
+    }
+
+    rp->base.transfer = replayer_transfer;
+    rp->base.close = replayer_close;
+    rp->num_records = header.num_transfers;
+    rp->realtime = realtime;
+
+    if (info != NULL) {
+        memset(info, 0, sizeof(jm_replay_info_t));
+        header.device_path[sizeof(header.device_path) - 1] = '\0';
+        header.controller_model[sizeof(header.controller_model) - 1] = '\0';
+        snprintf(info->device_path, sizeof(info->device_path), "%s", header.device_path);
+        snprintf(info->controller_model, sizeof(info->controller_model), "%s", header.controller_model);
+        info->sector = header.sector;
+        info->num_transfers = header.num_transfers;
+    }
+
+    return &rp->base;
+}
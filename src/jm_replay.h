@@ -0,0 +1,51 @@
+/*
+ * jm_replay.h - Part of jm-raid-status
+ *
+ * Copyright (C) 2026 Jamie Treworgy
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef JM_REPLAY_H
+#define JM_REPLAY_H
+
+#include "jm_protocol.h"
+#include <stdint.h>
+
+/**
+ * What a recording says about the run that produced it
+ */
+typedef struct {
+    char device_path[256];              /* Device that was recorded */
+    char controller_model[64];          /* Detected controller ("" if --force) */
+    uint32_t sector;                    /* Mailbox sector used */
+    uint32_t num_transfers;             /* Transfers in the file */
+} jm_replay_info_t;
+
+/**
+ * Open a recording transport
+ * Every transfer is passed to the inner transport and appended to the file
+ * as sent/received (scrambled), with its status and latency. The file is
+ * complete once jm_cleanup_device closes the transport.
+ *
+ * @param path Output file
+ * @param inner Transport to record (NULL = SG_IO on the session fd)
+ * @param info Device, controller and sector written to the file header
+ * @return Transport to store in session->transport, or NULL on error
+ */
+jm_transport_t* jm_record_open(const char* path, jm_transport_t* inner, const jm_replay_info_t* info);
+
+/**
+ * Open a replay transport
+ * Transfers are served from a recording in order. Writes must match the
+ * recorded command bytes, so the replaying run has to issue the same
+ * commands (same --disk, --cache and --array-size options); the first
+ * divergence fails that transfer. Recorded I/O errors are replayed too.
+ *
+ * @param path Recording from jm_record_open
+ * @param realtime Non-zero to sleep for each transfer's recorded latency
+ * @param info Output header information (may be NULL)
+ * @return Transport to store in session->transport, or NULL on error
+ */
+jm_transport_t* jm_replay_open(const char* path, int realtime, jm_replay_info_t* info);
+
+#endif /* JM_REPLAY_H */
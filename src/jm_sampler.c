@@ -0,0 +1,69 @@
+/*
+ * jm_sampler.c - Part of jm-raid-status
+ *
+ * Copyright (C) 2026 Jamie Treworgy
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "jm_sampler.h"
+#include <string.h>
+
+void jm_sample_ring_reset(jm_sample_ring_t* ring) {
+    memset(ring, 0, sizeof(*ring));
+}
+
+void jm_sample_ring_add(jm_sample_ring_t* ring, uint8_t value) {
+    if (ring->count == JM_SAMPLE_CAPACITY) {
+        uint8_t oldest = ring->values[ring->head];
+        ring->histogram[oldest]--;
+        ring->total -= oldest;
+    } else {
+        ring->count++;
+    }
+    ring->values[ring->head] = value;
+    ring->head = (ring->head + 1) % JM_SAMPLE_CAPACITY;
+    ring->histogram[value]++;
+    ring->total += value;
+}
+
+int jm_sample_ring_stats(const jm_sample_ring_t* ring, jm_sample_stats_t* stats) {
+    memset(stats, 0, sizeof(*stats));
+    if (ring->count == 0) {
+        return -1;
+    }
+
+    /* Nearest rank: the smallest value with at least ceil(0.99 * n) readings at or below it */
+    uint32_t rank = (uint32_t)(((uint64_t)ring->count * 99 + 99) / 100);
+    uint32_t seen = 0;
+    int min = -1, max = 0, p99 = -1;
+    for (int v = 0; v < 256; v++) {
+        if (ring->histogram[v] == 0) {
+            continue;
+        }
+        if (min < 0) min = v;
+        max = v;
+        seen += ring->histogram[v];
+        if (p99 < 0 && seen >= rank) p99 = v;
+    }
+
+    stats->count = ring->count;
+    stats->min = min;
+    stats->max = max;
+    stats->mean = (double)ring->total / ring->count;
+    stats->p99 = p99;
+    return 0;
+}
+
+int jm_sample_temperature(const smart_values_page_t* values) {
+    for (int i = 0; i < MAX_SMART_ATTRIBUTES; i++) {
+        const smart_attribute_t* attr = &values->attributes[i];
+        if (attr->id == 0) {
+            continue;
+        }
+        int temp = smart_attribute_temperature(attr->id, attr->raw_value[0]);
+        if (temp >= 0) {
+            return temp;
+        }
+    }
+    return -1;
+}
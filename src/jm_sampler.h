@@ -0,0 +1,71 @@
+/*
+ * jm_sampler.h - Part of jm-raid-status
+ *
+ * Copyright (C) 2026 Jamie Treworgy
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef JM_SAMPLER_H
+#define JM_SAMPLER_H
+
+#include <stdint.h>
+#include "smart_parser.h"
+
+/* Samples kept per disk: an hour at 1 Hz */
+#define JM_SAMPLE_CAPACITY 3600
+
+/*
+ * Temperature sampling (jmraidstatus --sample temp)
+ *
+ * Each disk keeps its last JM_SAMPLE_CAPACITY readings in a fixed ring.
+ * Readings are whole degrees (the raw low byte), so the ring also keeps a
+ * count per degree: evicting the oldest reading is O(1) and the
+ * percentile needs no sort.
+ */
+
+/**
+ * Readings of one disk
+ */
+typedef struct {
+    uint8_t values[JM_SAMPLE_CAPACITY];
+    uint32_t head;                      /* Next slot written */
+    uint32_t count;                     /* Readings held (<= capacity) */
+    uint32_t histogram[256];            /* Held readings per degree */
+    uint64_t total;                     /* Sum of held readings */
+} jm_sample_ring_t;
+
+/**
+ * Summary of the readings held in a ring
+ */
+typedef struct {
+    uint32_t count;
+    int min;
+    int max;
+    double mean;
+    int p99;                            /* Nearest-rank 99th percentile */
+} jm_sample_stats_t;
+
+/**
+ * Empty a ring (start of a run or of a window)
+ */
+void jm_sample_ring_reset(jm_sample_ring_t* ring);
+
+/**
+ * Add a reading, evicting the oldest once the ring is full
+ */
+void jm_sample_ring_add(jm_sample_ring_t* ring, uint8_t value);
+
+/**
+ * Summarize the held readings
+ * @return 0 on success, -1 if the ring is empty (stats zeroed)
+ */
+int jm_sample_ring_stats(const jm_sample_ring_t* ring, jm_sample_stats_t* stats);
+
+/**
+ * Temperature from a SMART values page: raw low byte of the first
+ * temperature attribute (0xC2, 0xBE or 0xE7)
+ * @return Degrees Celsius, or -1 if the page has no temperature attribute
+ */
+int jm_sample_temperature(const smart_values_page_t* values);
+
+#endif /* JM_SAMPLER_H */
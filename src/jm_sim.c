@@ -0,0 +1,323 @@
+/*
+ * jm_sim.c - Part of jm-raid-status
+ *
+ * Copyright (C) 2026 Jamie Treworgy
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "jm_sim.h"
+#include "jm_crc.h"
+#include "sata_xor.h"
+#include "aggregator/health_source.h"
+#include <asm/byteorder.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define JM_RAID_WAKEUP_CMD    (0x197b0325)
+#define JM_RAID_SCRAMBLED_CMD (0x197b0322)
+
+#define SIM_MAX_FILE (4 * 1024 * 1024)
+#define SIM_DEFAULT_SEED 0x9e3779b9u
+
+/* Second words of the four wakeup sectors, in order (see jm_send_wakeup) */
+static const uint32_t wakeup_values[4] = {0x3c75a80b, 0x0388e337, 0x689705f3, 0xe00c523a};
+
+typedef struct {
+    jm_transport_t base;                /* Must be first */
+    jm_sim_array_t array;
+    jm_sim_profile_t profile;
+    jm_sim_stats_t stats;
+    uint32_t rng;
+    int wakeup_stage;                   /* Wakeup sectors seen in order (4 = awake) */
+    int has_response;
+    uint8_t sector[JM_SECTORSIZE];      /* Last sector written */
+    uint32_t response[128];             /* Plain response to the last command */
+} sim_controller_t;
+
+/* Helper: xorshift32 (the same generator as the retry jitter) */
+static uint32_t sim_random(sim_controller_t* sim) {
+    uint32_t x = sim->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    sim->rng = x;
+    return x;
+}
+
+/* Helper: True for `ppm` out of every million draws */
+static int sim_chance(sim_controller_t* sim, uint32_t ppm) {
+    return ppm > 0 && sim_random(sim) % 1000000u < ppm;
+}
+
+/* Helper: Sleep for the profile's latency give or take the jitter */
+static void sim_delay(sim_controller_t* sim) {
+    int64_t us = sim->profile.latency_us;
+    if (sim->profile.jitter_us > 0) {
+        us += (int64_t)(sim_random(sim) % (2u * sim->profile.jitter_us + 1)) - sim->profile.jitter_us;
+    }
+    if (us <= 0) {
+        return;
+    }
+    struct timespec delay = { (time_t)(us / 1000000), (long)(us % 1000000) * 1000L };
+    nanosleep(&delay, NULL);
+}
+
+/* Helper: Store an ATA string byte-swapped within 16-bit words, space padded */
+static void put_ata_string(uint8_t* dest, const char* src, int len) {
+    size_t n = strlen(src);
+    for (int i = 0; i < len; i++) {
+        char c = (size_t)i < n ? src[i] : ' ';
+        dest[i ^ 1] = (uint8_t)c;
+    }
+}
+
+/* Helper: IDENTIFY response for a slot (flags only for an empty one) */
+static void build_identify(const sim_controller_t* sim, int slot, uint8_t* resp) {
+    if (slot >= 0 && slot < 5 && sim->array.disks[slot].is_present) {
+        const disk_smart_data_t* disk = &sim->array.disks[slot];
+        put_ata_string(resp + 0x10, disk->disk_name, 32);
+        put_ata_string(resp + 0x30, disk->serial_number, 16);
+        put_ata_string(resp + 0x50, disk->firmware_rev, 8);
+
+        uint64_t sectors = disk->size_mb * 2048;  /* 512-byte sectors per MB */
+        for (int i = 0; i < 6; i++) {
+            resp[0x4A + i] = (uint8_t)(sectors >> (i * 8));
+        }
+    }
+    resp[0x1F0] = sim->array.presence;
+    resp[0x1F5] = sim->array.rebuild;
+    resp[0x1FA] = sim->array.phase;
+}
+
+/* Helper: SMART values (0xD0) or thresholds (0xD1) page at offset 0x20 */
+static void build_smart_page(const sim_controller_t* sim, int slot, int thresholds, uint8_t* resp) {
+    if (slot < 0 || slot >= 5 || !sim->array.disks[slot].is_present) {
+        return;
+    }
+    const disk_smart_data_t* disk = &sim->array.disks[slot];
+    uint8_t* page = resp + 0x20;
+
+    page[0] = 0x10;  /* Revision */
+    for (int i = 0; i < disk->num_attributes && i < 30; i++) {
+        const parsed_smart_attribute_t* attr = &disk->attributes[i];
+        uint8_t* entry = page + 2 + i * 12;
+        entry[0] = attr->id;
+        if (thresholds) {
+            entry[1] = attr->threshold;
+            continue;
+        }
+        entry[1] = 0x03;  /* Flags: pre-fail, online */
+        entry[3] = attr->current_value;
+        entry[4] = attr->worst_value;
+        for (int b = 0; b < 6; b++) {
+            entry[5 + b] = (uint8_t)(attr->raw_value >> (b * 8));
+        }
+    }
+}
+
+/* Helper: Act on a written sector: wakeup progress, sleep, or a command */
+static void sim_write(sim_controller_t* sim) {
+    uint32_t plain[128];
+    const uint32_t* words = (const uint32_t*)sim->sector;
+
+    sim->has_response = 0;
+
+    if (jm_sector_is_empty(sim->sector, JM_SECTORSIZE)) {
+        /* The cleanup write: the controller drops back to idle */
+        sim->wakeup_stage = 0;
+        return;
+    }
+
+    if (__le32_to_cpu(words[0]) == JM_RAID_WAKEUP_CMD) {
+        memcpy(plain, sim->sector, sizeof(plain));
+        int valid = JM_CRC(plain, 0x7f) == __le32_to_cpu(words[0x7f]);
+        uint32_t value = __le32_to_cpu(words[1]);
+        int stage = sim->wakeup_stage < 4 ? sim->wakeup_stage : 0;
+
+        if (valid && value == wakeup_values[stage]) {
+            sim->wakeup_stage = stage + 1;
+            if (sim->wakeup_stage == 4) sim->stats.wakeups++;
+        } else {
+            sim->wakeup_stage = (valid && value == wakeup_values[0]) ? 1 : 0;
+        }
+        return;
+    }
+
+    memcpy(plain, sim->sector, sizeof(plain));
+    if (sim->wakeup_stage != 4 || JM_XOR_THEN_CRC(plain) != __le32_to_cpu(plain[0x7f]) ||
+        __le32_to_cpu(plain[0]) != JM_RAID_SCRAMBLED_CMD) {
+        /* Asleep, or not a command: the sector just holds what was written */
+        sim->stats.ignored++;
+        return;
+    }
+
+    /* Payload after the header: 00 02 <kind> ff <slot> ... (jm_classify_command) */
+    const uint8_t* payload = (const uint8_t*)plain + 8;
+    uint8_t* resp = (uint8_t*)sim->response;
+    memset(sim->response, 0, sizeof(sim->response));
+
+    if (payload[0] == 0x00 && payload[1] == 0x02 && payload[2] == 0x02) {
+        build_identify(sim, payload[4], resp);
+        memcpy(resp, plain, 8);
+    } else if (payload[0] == 0x00 && payload[1] == 0x02 && payload[2] == 0x03 &&
+               (payload[10] == 0xd0 || payload[10] == 0xd1)) {
+        memcpy(resp, plain, 0x20);
+        build_smart_page(sim, payload[4], payload[10] == 0xd1, resp);
+    } else {
+        memcpy(resp, plain, 8);
+    }
+    sim->has_response = 1;
+    sim->stats.commands++;
+}
+
+static int sim_transfer(jm_transport_t* transport, jm_session_t* session,
+                        jm_xfer_dir_t dir, void* buf) {
+    sim_controller_t* sim = (sim_controller_t*)transport;
+    (void)session;
+
+    if (dir == JM_XFER_TO_DEV) {
+        memcpy(sim->sector, buf, JM_SECTORSIZE);
+        sim_write(sim);
+        return 0;
+    }
+
+    if (!sim->has_response) {
+        memcpy(buf, sim->sector, JM_SECTORSIZE);
+        return 0;
+    }
+
+    sim_delay(sim);
+    if (sim_chance(sim, sim->profile.timeout_ppm)) {
+        sim->stats.timeouts++;
+        return JM_XFER_TIMED_OUT;
+    }
+    memcpy(buf, sim->response, sizeof(sim->response));
+    JM_CRC_THEN_XOR((uint32_t*)buf);
+    if (sim_chance(sim, sim->profile.crc_error_ppm)) {
+        sim->stats.crc_errors++;
+        ((uint8_t*)buf)[0x40 + sim_random(sim) % 0x100] ^= 0x01;
+    }
+    return 0;
+}
+
+static void sim_close(jm_transport_t* transport) {
+    free(transport);
+}
+
+jm_transport_t* jm_sim_open(const jm_sim_array_t* array, const jm_sim_profile_t* profile) {
+    if (array == NULL) {
+        return NULL;
+    }
+    sim_controller_t* sim = calloc(1, sizeof(sim_controller_t));
+    if (sim == NULL) {
+        return NULL;
+    }
+    sim->base.transfer = sim_transfer;
+    sim->base.close = sim_close;
+    sim->array = *array;
+    if (profile != NULL) {
+        sim->profile = *profile;
+    }
+    sim->rng = sim->profile.seed ? sim->profile.seed : SIM_DEFAULT_SEED;
+    return &sim->base;
+}
+
+void jm_sim_get_stats(const jm_transport_t* transport, jm_sim_stats_t* stats) {
+    *stats = ((const sim_controller_t*)transport)->stats;
+}
+
+int jm_sim_load(const char* path, jm_sim_array_t* array) {
+    FILE* f = fopen(path, "rb");
+    if (f == NULL) {
+        return -1;
+    }
+    char* text = malloc(SIM_MAX_FILE + 1);
+    source_result_t* result = malloc(sizeof(source_result_t));
+    size_t len = (text != NULL) ? fread(text, 1, SIM_MAX_FILE, f) : 0;
+    int ok = text != NULL && result != NULL && ferror(f) == 0 && len < SIM_MAX_FILE;
+    fclose(f);
+
+    memset(array, 0, sizeof(*array));
+    if (ok) {
+        text[len] = '\0';
+        ok = parse_disk_health_line(text, result) == 0 && result->num_disks > 0;
+    }
+    for (int i = 0; ok && i < result->num_disks; i++) {
+        int slot = result->disks[i].disk_number;
+        if (slot < 0 || slot >= 5) {
+            ok = 0;
+            break;
+        }
+        array->disks[slot] = result->disks[i];
+        array->disks[slot].is_present = 1;
+        array->presence |= (uint8_t)(1u << slot);
+    }
+    if (ok) {
+        snprintf(array->controller_model, sizeof(array->controller_model), "%s", result->controller_model);
+    }
+
+    free(text);
+    free(result);
+    return ok ? 0 : -1;
+}
+
+/* Helper: Parse a non-negative decimal with an optional fraction, scaled by `scale` */
+static int parse_scaled(const char* text, size_t len, double scale, uint32_t* out) {
+    char buf[32], *end;
+    if (len == 0 || len >= sizeof(buf)) {
+        return -1;
+    }
+    memcpy(buf, text, len);
+    buf[len] = '\0';
+    double value = strtod(buf, &end);
+    if (*end != '\0' || value < 0 || value * scale > 4294967295.0) {
+        return -1;
+    }
+    *out = (uint32_t)(value * scale + 0.5);
+    return 0;
+}
+
+int jm_sim_parse_spec(const char* spec, char* path, size_t path_size, jm_sim_profile_t* profile) {
+    const char* comma = strchr(spec, ',');
+    size_t path_len = comma ? (size_t)(comma - spec) : strlen(spec);
+
+    memset(profile, 0, sizeof(*profile));
+    if (path_len == 0 || path_len >= path_size) {
+        return -1;
+    }
+    memcpy(path, spec, path_len);
+    path[path_len] = '\0';
+
+    while (comma != NULL) {
+        const char* key = comma + 1;
+        const char* eq = strchr(key, '=');
+        comma = strchr(key, ',');
+        size_t item_len = comma ? (size_t)(comma - key) : strlen(key);
+        if (eq == NULL || eq > key + item_len) {
+            return -1;
+        }
+        size_t key_len = (size_t)(eq - key);
+        const char* value = eq + 1;
+        size_t value_len = item_len - key_len - 1;
+        uint32_t rate;
+
+        if (key_len == 7 && strncmp(key, "latency", 7) == 0) {
+            if (parse_scaled(value, value_len, 1000.0, &profile->latency_us) != 0) return -1;
+        } else if (key_len == 6 && strncmp(key, "jitter", 6) == 0) {
+            if (parse_scaled(value, value_len, 1000.0, &profile->jitter_us) != 0) return -1;
+        } else if (key_len == 3 && strncmp(key, "crc", 3) == 0) {
+            if (parse_scaled(value, value_len, 1000000.0, &rate) != 0 || rate > 1000000) return -1;
+            profile->crc_error_ppm = rate;
+        } else if (key_len == 8 && strncmp(key, "timeouts", 8) == 0) {
+            if (parse_scaled(value, value_len, 1000000.0, &rate) != 0 || rate > 1000000) return -1;
+            profile->timeout_ppm = rate;
+        } else if (key_len == 4 && strncmp(key, "seed", 4) == 0) {
+            if (parse_scaled(value, value_len, 1.0, &profile->seed) != 0) return -1;
+        } else {
+            return -1;
+        }
+    }
+    return 0;
+}
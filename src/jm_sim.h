@@ -0,0 +1,104 @@
+/*
+ * jm_sim.h - Part of jm-raid-status
+ *
+ * Copyright (C) 2026 Jamie Treworgy
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef JM_SIM_H
+#define JM_SIM_H
+
+#include "jm_protocol.h"
+#include "smart_parser.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Simulated controller
+ *
+ * A transport that behaves like a JMicron mailbox instead of replaying one:
+ * it needs the four-sector wakeup before it answers, descrambles and
+ * CRC-checks each command, echoes the command header (counter included)
+ * and builds IDENTIFY, SMART READ VALUES (0xD0) and READ THRESHOLDS (0xD1)
+ * responses from an array description. Writing a zero sector (another
+ * process's cleanup) puts it back to sleep. Latency, jitter, CRC errors
+ * and timeouts are injected per command from a seeded PRNG, so a run is
+ * reproducible. Instances share nothing: one per virtual enclosure.
+ */
+
+/**
+ * What the simulated enclosure holds
+ */
+typedef struct {
+    disk_smart_data_t disks[5];         /* By slot; is_present marks a disk */
+    uint8_t presence;                   /* 0x1F0 bitmask (derived from the disks by jm_sim_load) */
+    uint8_t rebuild;                    /* 0x1F5 */
+    uint8_t phase;                      /* 0x1FA */
+    char controller_model[64];          /* From the JSON "controller" object ("" if absent) */
+} jm_sim_array_t;
+
+/**
+ * Per-command fault and latency injection
+ */
+typedef struct {
+    uint32_t latency_us;                /* Added to every command's response */
+    uint32_t jitter_us;                 /* Latency varies uniformly by +/- this much */
+    uint32_t crc_error_ppm;             /* Responses corrupted, per million commands */
+    uint32_t timeout_ppm;               /* Responses that time out, per million commands */
+    uint32_t seed;                      /* PRNG seed (0 = fixed default) */
+} jm_sim_profile_t;
+
+/**
+ * What an instance has seen so far
+ */
+typedef struct {
+    uint64_t commands;                  /* Valid commands answered (faults included) */
+    uint64_t wakeups;                   /* Completed wakeup sequences */
+    uint64_t crc_errors;                /* Responses corrupted on purpose */
+    uint64_t timeouts;                  /* Responses timed out on purpose */
+    uint64_t ignored;                   /* Commands written while asleep or with a bad CRC */
+} jm_sim_stats_t;
+
+/**
+ * Load an array from jmraidstatus JSON output (the tests/data/jmicron fixtures)
+ * Disks go to the slot of their "disk_number"; model, serial, firmware,
+ * size and attribute values, worst, thresholds and raw values are served
+ * back as read, so a poll of the simulator reproduces the document.
+ *
+ * @param path JSON file (one document, compact or pretty)
+ * @param array Output array
+ * @return 0 on success, -1 if unreadable or not jmraidstatus output
+ */
+int jm_sim_load(const char* path, jm_sim_array_t* array);
+
+/**
+ * Parse a --simulate specification: FILE[,latency=MS][,jitter=MS][,crc=RATE][,timeouts=RATE][,seed=N]
+ * RATE is a fraction of commands (0.01 = 1%); MS may have a fraction.
+ *
+ * @param spec Specification
+ * @param path Output: the JSON file
+ * @param path_size Size of path
+ * @param profile Output profile (unset keys are 0)
+ * @return 0 on success, -1 on a malformed or unknown key
+ */
+int jm_sim_parse_spec(const char* spec, char* path, size_t path_size, jm_sim_profile_t* profile);
+
+/**
+ * Open a simulated controller
+ * The array is copied, so one loaded array can back many instances.
+ *
+ * @param array Enclosure contents
+ * @param profile Latency and faults (NULL = instant, no faults)
+ * @return Transport to store in session->transport, or NULL on error
+ */
+jm_transport_t* jm_sim_open(const jm_sim_array_t* array, const jm_sim_profile_t* profile);
+
+/**
+ * Copy an instance's counters
+ *
+ * @param transport Transport from jm_sim_open
+ * @param stats Output counters
+ */
+void jm_sim_get_stats(const jm_transport_t* transport, jm_sim_stats_t* stats);
+
+#endif /* JM_SIM_H */
@@ -0,0 +1,87 @@
+/*
+ * jm_timings.c - Part of jm-raid-status
+ *
+ * Copyright (C) 2026 Jamie Treworgy
+ * SPDX-License-Identifier: MIT
+ */
+
+#define JSMN_HEADER  /* jsmn declarations only (via common.h) */
+#include "jm_timings.h"
+#include "parsers/common.h"
+#include <time.h>
+
+static const char* const phase_names[JM_PHASE_COUNT] = {
+    "detect", "safety_read", "open", "wakeup", "query", "cleanup"
+};
+
+static const char* const cmd_type_names[JM_CMD_TYPE_COUNT] = {
+    "identify", "smart_values", "smart_thresholds", "other"
+};
+
+const uint64_t jm_histogram_bounds_us[JM_HISTOGRAM_BUCKETS] = {
+    5000, 10000, 25000, 50000, 100000, 250000, 500000, 1000000, 2500000, 5000000, 10000000
+};
+
+uint64_t jm_monotonic_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000;
+}
+
+void jm_latency_add(jm_latency_t* latency, uint64_t elapsed_us) {
+    latency->count++;
+    latency->total_us += elapsed_us;
+    if (elapsed_us > latency->max_us) {
+        latency->max_us = elapsed_us;
+    }
+}
+
+void jm_histogram_add(jm_histogram_t* histogram, uint64_t elapsed_us) {
+    int bucket = 0;
+    while (bucket < JM_HISTOGRAM_BUCKETS && elapsed_us > jm_histogram_bounds_us[bucket]) {
+        bucket++;
+    }
+    histogram->buckets[bucket]++;
+    histogram->count++;
+    histogram->total_us += elapsed_us;
+}
+
+const char* jm_phase_name(jm_phase_t phase) {
+    return ((int)phase >= 0 && phase < JM_PHASE_COUNT) ? phase_names[phase] : "unknown";
+}
+
+const char* jm_cmd_type_name(jm_cmd_type_t type) {
+    return ((int)type >= 0 && type < JM_CMD_TYPE_COUNT) ? cmd_type_names[type] : "unknown";
+}
+
+/* Helper: One "name": {count, total_us, max_us} member */
+static void write_latency(json_writer_t* w, const char* name, const jm_latency_t* latency) {
+    json_begin_inline(w, name, '{');
+    json_write_uint(w, "count", latency->count);
+    json_write_uint(w, "total_us", latency->total_us);
+    json_write_uint(w, "max_us", latency->max_us);
+    json_end(w);
+}
+
+void jm_timings_write_json(json_writer_t* w, const char* key, const jm_timings_t* timings) {
+    json_begin_object(w, key);
+
+    json_begin_object(w, "phases");
+    for (int i = 0; i < JM_PHASE_COUNT; i++) {
+        write_latency(w, phase_names[i], &timings->phases[i]);
+    }
+    json_end(w);
+
+    json_begin_object(w, "commands");
+    for (int i = 0; i < JM_CMD_TYPE_COUNT; i++) {
+        write_latency(w, cmd_type_names[i], &timings->commands[i]);
+    }
+    json_end(w);
+
+    json_begin_object(w, "ioctls");
+    write_latency(w, "write", &timings->ioctl_write);
+    write_latency(w, "read", &timings->ioctl_read);
+    json_end(w);
+
+    json_end(w);
+}
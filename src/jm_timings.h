@@ -0,0 +1,111 @@
+/*
+ * jm_timings.h - Part of jm-raid-status
+ *
+ * Copyright (C) 2026 Jamie Treworgy
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef JM_TIMINGS_H
+#define JM_TIMINGS_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/* Phases of one run, in the order they happen */
+typedef enum {
+    JM_PHASE_DETECT = 0,                /* sysfs/lspci hardware detection */
+    JM_PHASE_SAFETY_READ,               /* Block-device read of the mailbox sector */
+    JM_PHASE_OPEN,                      /* SG device open and version check */
+    JM_PHASE_WAKEUP,                    /* 4-sector wakeup sequence */
+    JM_PHASE_QUERY,                     /* All IDENTIFY/SMART commands of a poll */
+    JM_PHASE_CLEANUP,                   /* Zero the mailbox sector and close */
+    JM_PHASE_COUNT
+} jm_phase_t;
+
+/* Scrambled command types (decoded from the command payload) */
+typedef enum {
+    JM_CMD_IDENTIFY = 0,                /* IDENTIFY DEVICE */
+    JM_CMD_SMART_VALUES,                /* SMART READ ATTRIBUTE VALUES (0xD0) */
+    JM_CMD_SMART_THRESHOLDS,            /* SMART READ ATTRIBUTE THRESHOLDS (0xD1) */
+    JM_CMD_OTHER,
+    JM_CMD_TYPE_COUNT
+} jm_cmd_type_t;
+
+/**
+ * Latency statistics in microseconds
+ */
+typedef struct {
+    uint32_t count;
+    uint64_t total_us;
+    uint64_t max_us;
+} jm_latency_t;
+
+/* Upper bucket bounds of a latency histogram: 5 ms to 10 s (+Inf is implied) */
+#define JM_HISTOGRAM_BUCKETS 11
+extern const uint64_t jm_histogram_bounds_us[JM_HISTOGRAM_BUCKETS];
+
+/**
+ * Latency histogram (jmraid-monitord --listen)
+ * buckets[i] counts samples above bound i-1 and up to bound i; the last
+ * bucket counts the samples above every bound. Counts are not cumulative.
+ */
+typedef struct {
+    uint64_t buckets[JM_HISTOGRAM_BUCKETS + 1];
+    uint64_t count;
+    uint64_t total_us;
+} jm_histogram_t;
+
+/**
+ * Timings of one controller session (--timings)
+ * commands[] covers the write+read ioctl pair of each command; ioctl_write
+ * and ioctl_read cover every individual SG_IO, wakeup and cleanup included.
+ */
+typedef struct {
+    jm_latency_t phases[JM_PHASE_COUNT];
+    jm_latency_t commands[JM_CMD_TYPE_COUNT];
+    jm_latency_t ioctl_write;
+    jm_latency_t ioctl_read;
+} jm_timings_t;
+
+/**
+ * Current CLOCK_MONOTONIC time in microseconds
+ */
+uint64_t jm_monotonic_us(void);
+
+/**
+ * Add one sample to a latency statistic
+ *
+ * @param latency Statistic to update
+ * @param elapsed_us Sample in microseconds
+ */
+void jm_latency_add(jm_latency_t* latency, uint64_t elapsed_us);
+
+/**
+ * Add one sample to a latency histogram
+ *
+ * @param histogram Histogram to update
+ * @param elapsed_us Sample in microseconds
+ */
+void jm_histogram_add(jm_histogram_t* histogram, uint64_t elapsed_us);
+
+/**
+ * Get the JSON key for a phase or command type
+ *
+ * @return Key string (e.g. "safety_read", "smart_values")
+ */
+const char* jm_phase_name(jm_phase_t phase);
+const char* jm_cmd_type_name(jm_cmd_type_t type);
+
+struct json_writer;
+
+/**
+ * Write timings as a JSON object member
+ * Every phase and command type is always present so the schema is fixed.
+ *
+ * @param w JSON writer (parsers/common.h)
+ * @param key Member name (NULL inside an array)
+ * @param timings Timings to write
+ */
+void jm_timings_write_json(struct json_writer* w, const char* key, const jm_timings_t* timings);
+
+#endif /* JM_TIMINGS_H */
@@ -0,0 +1,226 @@
+/*
+ * jmraid.c - libjmraid: persistent controller sessions for other programs
+ *
+ * Copyright (C) 2026 Jamie Treworgy
+ * SPDX-License-Identifier: MIT
+ *
+ * Wraps the session API (jm_protocol.h, jm_commands.h) behind the fixed
+ * layout structs of jmraid.h. Built with -fvisibility=hidden, so only the
+ * JMRAID_API functions are exported from libjmraid.so.
+ */
+
+#include "jmraid.h"
+#include "jm_commands.h"
+#include "jm_cache.h"
+#include "jm_device.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define JMRAID_API __attribute__((visibility("default")))
+
+#define JMRAID_DEFAULT_SECTOR 33
+
+#ifndef VERSION
+#define VERSION "unknown"
+#endif
+
+struct jmraid {
+    jm_device_t device;                 /* Shared results go to its run_dir too (NULL = none) */
+    int expected_disks;
+    disk_smart_data_t disks[5];         /* Last full poll (large: kept off the caller's stack) */
+};
+
+JMRAID_API uint32_t jmraid_abi_version(void) {
+    return JMRAID_ABI_VERSION;
+}
+
+JMRAID_API const char* jmraid_version(void) {
+    return VERSION;
+}
+
+JMRAID_API void jmraid_options_init(jmraid_options_t* options) {
+    memset(options, 0, sizeof(*options));
+    options->sector = JMRAID_DEFAULT_SECTOR;
+    options->retries = JM_DEFAULT_RETRIES;
+    options->lock_timeout_ms = JM_LOCK_DEFAULT_TIMEOUT_MS;
+    options->run_dir = JM_RUN_DEFAULT_DIR;
+}
+
+JMRAID_API const char* jmraid_strerror(int error) {
+    switch (error) {
+        case JMRAID_ERR_NOT_JMICRON:    return "No JMicron RAID controller detected";
+        case JMRAID_ERR_SECTOR_IN_USE:  return "Mailbox sector contains data on disk";
+        case JMRAID_ERR_LOCKED:         return "Mailbox locked by another process";
+        case JMRAID_ERR_NO_MEMORY:      return "Out of memory";
+        case JMRAID_ERR_POLL:           return "Controller gave no valid response";
+        default:
+            if (error >= JMRAID_OK && error <= JMRAID_ERR_TIMEOUT) {
+                return jm_error_string((jm_error_code_t)error);
+            }
+            return "Unknown error";
+    }
+}
+
+JMRAID_API jmraid_t* jmraid_open(const char* device_path, const jmraid_options_t* options, int* error) {
+    jmraid_options_t defaults;
+    int result = JMRAID_OK;
+    jmraid_t* h;
+
+    if (options == NULL) {
+        jmraid_options_init(&defaults);
+        options = &defaults;
+    }
+    if (device_path == NULL || strlen(device_path) >= sizeof(h->device.path) ||
+        !jm_sector_in_safe_range(options->sector) ||
+        options->retries < 0 || options->retries > JM_MAX_RETRIES) {
+        result = JMRAID_ERR_ARGS;
+        goto fail;
+    }
+
+    h = calloc(1, sizeof(jmraid_t));
+    if (h == NULL) {
+        result = JMRAID_ERR_NO_MEMORY;
+        goto fail;
+    }
+    h->expected_disks = options->expected_disks;
+
+    jm_device_init(&h->device, options->sector);
+    h->device.session.max_retries = options->retries;
+    h->device.session.expected_array_size = options->expected_disks;
+    h->device.session.cache_dir = options->cache_dir;
+
+    jm_device_options_t open_options = {
+        .force = options->force,
+        .lock_timeout_ms = options->lock_timeout_ms,
+        .run_dir = options->run_dir,
+    };
+    switch (jm_device_open(&h->device, device_path, &open_options)) {
+        case JM_DEVICE_OK:
+            break;
+        case JM_DEVICE_NOT_JMICRON:
+            result = JMRAID_ERR_NOT_JMICRON;
+            goto fail_free;
+        case JM_DEVICE_SECTOR_UNREADABLE:
+            result = JMRAID_ERR_OPEN;
+            goto fail_free;
+        case JM_DEVICE_SECTOR_IN_USE:
+            result = JMRAID_ERR_SECTOR_IN_USE;
+            goto fail_free;
+        case JM_DEVICE_LOCKED:
+            result = JMRAID_ERR_LOCKED;
+            goto fail_free;
+        case JM_DEVICE_OPEN_FAILED:
+        case JM_DEVICE_WAKE_FAILED:
+            result = h->device.protocol_error;
+            goto fail_free;
+    }
+
+    if (error != NULL) *error = JMRAID_OK;
+    return h;
+
+fail_free:
+    free(h);
+fail:
+    if (error != NULL) *error = result;
+    return NULL;
+}
+
+/* Helper: Copy one disk into the public layout */
+static void export_disk(const disk_smart_data_t* src, jmraid_disk_t* dst) {
+    memset(dst, 0, sizeof(*dst));
+    dst->temperature_c = -1;
+    if (!src->is_present) {
+        return;
+    }
+
+    dst->present = 1;
+    dst->status = src->overall_status == DISK_STATUS_PASSED ? JMRAID_DISK_HEALTHY
+                : src->overall_status == DISK_STATUS_FAILED ? JMRAID_DISK_FAILED : JMRAID_DISK_ERROR;
+    snprintf(dst->model, sizeof(dst->model), "%s", src->disk_name);
+    snprintf(dst->serial, sizeof(dst->serial), "%s", src->serial_number);
+    snprintf(dst->firmware, sizeof(dst->firmware), "%s", src->firmware_rev);
+    dst->size_mb = src->size_mb;
+    dst->temperature_c = smart_disk_temperature(src);
+    dst->command_retries = src->command_retries;
+
+    dst->num_attributes = (uint32_t)src->num_attributes;
+    for (int i = 0; i < src->num_attributes && i < JMRAID_MAX_ATTRIBUTES; i++) {
+        const parsed_smart_attribute_t* a = &src->attributes[i];
+        jmraid_attribute_t* out = &dst->attributes[i];
+        out->id = a->id;
+        out->value = a->current_value;
+        out->worst = a->worst_value;
+        out->thresh = a->threshold;
+        out->status = (uint8_t)a->status;
+        out->critical = a->is_critical ? 1 : 0;
+        out->raw = a->raw_value;
+        snprintf(out->name, sizeof(out->name), "%s", a->name ? a->name : "Unknown_Attribute");
+    }
+}
+
+JMRAID_API int jmraid_poll(jmraid_t* h, jmraid_status_t* status) {
+    int num_disks = 0, is_degraded = 0, present_disks = 0;
+
+    if (h == NULL || status == NULL) {
+        return JMRAID_ERR_ARGS;
+    }
+    memset(status, 0, sizeof(*status));
+    if (jm_device_begin(&h->device) != 0) {
+        return JMRAID_ERR_LOCKED;
+    }
+    int result = jm_get_all_disks_smart_data(&h->device.session, h->disks, &num_disks, &is_degraded, &present_disks);
+    jm_device_end(&h->device, result);
+    if (result != 0) {
+        return JMRAID_ERR_POLL;
+    }
+
+    status->num_disks = num_disks;
+    status->present_disks = present_disks;
+    status->degraded = is_degraded;
+    status->status = is_degraded ? JMRAID_DISK_FAILED : JMRAID_DISK_HEALTHY;
+    for (int i = 0; i < JMRAID_MAX_DISKS; i++) {
+        export_disk(&h->disks[i], &status->disks[i]);
+        if (status->disks[i].present && status->disks[i].status != JMRAID_DISK_HEALTHY) {
+            status->status = JMRAID_DISK_FAILED;
+        }
+    }
+    jm_device_share(&h->device, h->disks, num_disks, is_degraded, present_disks, (int64_t)time(NULL));
+    return JMRAID_OK;
+}
+
+JMRAID_API int jmraid_poll_flags(jmraid_t* h, jmraid_flags_t* flags) {
+    jm_raid_flags_t raw;
+
+    if (h == NULL || flags == NULL) {
+        return JMRAID_ERR_ARGS;
+    }
+    memset(flags, 0, sizeof(*flags));
+    if (jm_device_begin(&h->device) != 0) {
+        return JMRAID_ERR_LOCKED;
+    }
+    int result = jm_get_raid_flags(&h->device.session, &raw);
+    jm_device_end(&h->device, result);
+    if (result != 0) {
+        return JMRAID_ERR_POLL;
+    }
+
+    flags->presence = raw.presence;
+    flags->rebuild = raw.rebuild;
+    flags->phase = raw.phase;
+    memcpy(flags->raw, raw.raw, sizeof(flags->raw));
+    for (int i = 0; i < JMRAID_MAX_DISKS; i++) {
+        if (raw.presence & (1u << i)) flags->present_disks++;
+    }
+    flags->degraded = h->expected_disks > 0 && flags->present_disks < h->expected_disks;
+    return JMRAID_OK;
+}
+
+JMRAID_API void jmraid_close(jmraid_t* h) {
+    if (h == NULL) {
+        return;
+    }
+    jm_device_close(&h->device);
+    free(h);
+}
@@ -0,0 +1,178 @@
+/*
+ * jmraid.h - libjmraid public API
+ *
+ * Copyright (C) 2026 Jamie Treworgy
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef JMRAID_H
+#define JMRAID_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * libjmraid
+ *
+ * The protocol, command and SMART parser code of jmraidstatus as a library
+ * (libjmraid.so / libjmraid.a), for programs that poll an enclosure in
+ * process on one persistent session instead of running jmraidstatus per
+ * poll. A handle is one open, woken controller session: jmraid_open does
+ * the same hardware detection and mailbox sector safety check as
+ * jmraidstatus, and every poll holds the device's mailbox lock (see
+ * --run-dir), re-waking the controller after another process used it.
+ *
+ * Only this header is public. Its structs have a fixed layout, and a new
+ * ABI version only ever appends members and functions; check
+ * jmraid_abi_version() against JMRAID_ABI_VERSION when loading the shared
+ * library at run time. No signal handlers are installed: call jmraid_close
+ * before exiting, or the mailbox sector keeps the last command.
+ *
+ * A handle must not be used by two threads at once; separate handles are
+ * independent. Warnings go to stderr, as with jmraidstatus.
+ */
+
+#define JMRAID_ABI_VERSION 1
+
+#define JMRAID_MAX_DISKS 5
+#define JMRAID_MAX_ATTRIBUTES 30
+
+/* Error codes (1-6 are the protocol's jm_error_code_t) */
+typedef enum {
+    JMRAID_OK = 0,
+    JMRAID_ERR_OPEN = 1,                /* Cannot open the device */
+    JMRAID_ERR_NOT_SG = 2,              /* Not a SCSI generic device */
+    JMRAID_ERR_IOCTL = 3,               /* SG_IO failed */
+    JMRAID_ERR_CRC = 4,                 /* Response CRC mismatch (after retries) */
+    JMRAID_ERR_ARGS = 5,                /* Invalid argument */
+    JMRAID_ERR_TIMEOUT = 6,             /* SG_IO timed out (after retries) */
+    JMRAID_ERR_NOT_JMICRON = 7,         /* No JMicron controller detected (see force) */
+    JMRAID_ERR_SECTOR_IN_USE = 8,       /* Mailbox sector holds data on disk */
+    JMRAID_ERR_LOCKED = 9,              /* Mailbox locked by another process for too long */
+    JMRAID_ERR_NO_MEMORY = 10,
+    JMRAID_ERR_POLL = 11                /* Controller gave no valid response */
+} jmraid_error_t;
+
+/* Disk and attribute status */
+#define JMRAID_DISK_HEALTHY 0
+#define JMRAID_DISK_FAILED 1
+#define JMRAID_DISK_ERROR 2             /* SMART data could not be read */
+
+#define JMRAID_ATTR_OK 0
+#define JMRAID_ATTR_FAILED 1
+#define JMRAID_ATTR_UNKNOWN 2
+
+/* Session options (jmraid_options_init sets the jmraidstatus defaults) */
+typedef struct {
+    uint32_t sector;                    /* Mailbox sector (default 33) */
+    int32_t force;                      /* Skip JMicron hardware detection */
+    int32_t retries;                    /* Command retries (0-10, default 2) */
+    int32_t expected_disks;             /* Array size for degraded detection (0 = off) */
+    int32_t lock_timeout_ms;            /* Wait for another process's exchange (default 30000) */
+    const char* run_dir;                /* Mailbox lock directory (NULL = no locking) */
+    const char* cache_dir;              /* IDENTIFY/threshold cache (NULL = disabled) */
+} jmraid_options_t;
+
+/* One SMART attribute */
+typedef struct {
+    uint8_t id;
+    uint8_t value;
+    uint8_t worst;
+    uint8_t thresh;
+    uint8_t status;                     /* JMRAID_ATTR_* */
+    uint8_t critical;
+    uint8_t reserved[2];
+    uint64_t raw;
+    char name[32];                      /* "Unknown_Attribute" if not known */
+} jmraid_attribute_t;
+
+/* One disk slot of a poll */
+typedef struct {
+    int32_t present;
+    int32_t status;                     /* JMRAID_DISK_* */
+    char model[64];
+    char serial[24];
+    char firmware[12];
+    uint64_t size_mb;
+    int32_t temperature_c;              /* -1 if not reported */
+    uint32_t command_retries;
+    uint32_t num_attributes;
+    jmraid_attribute_t attributes[JMRAID_MAX_ATTRIBUTES];
+} jmraid_disk_t;
+
+/* RAID-wide flags from one IDENTIFY (bytes 0x1F0-0x1FB) */
+typedef struct {
+    uint8_t presence;                   /* 0x1F0: bit N = disk N present */
+    uint8_t rebuild;                    /* 0x1F5: non-zero while rebuilding */
+    uint8_t phase;                      /* 0x1FA */
+    uint8_t reserved;
+    int32_t present_disks;              /* Bits set in presence */
+    int32_t degraded;                   /* Fewer present than expected_disks */
+    uint8_t raw[12];
+} jmraid_flags_t;
+
+/* Result of a full poll (jmraid_poll) */
+typedef struct {
+    int32_t num_disks;                  /* Disks answering IDENTIFY */
+    int32_t present_disks;              /* Disks in the presence bitmask */
+    int32_t degraded;
+    int32_t status;                     /* JMRAID_DISK_FAILED if any disk failed or degraded */
+    jmraid_disk_t disks[JMRAID_MAX_DISKS];  /* Indexed by slot */
+} jmraid_status_t;
+
+typedef struct jmraid jmraid_t;
+
+/**
+ * ABI version of the loaded library (JMRAID_ABI_VERSION it was built with)
+ */
+uint32_t jmraid_abi_version(void);
+
+/**
+ * Library version string (the jm-raid-status release)
+ */
+const char* jmraid_version(void);
+
+/**
+ * Fill options with the defaults (locking in /run/jmraidstatus)
+ */
+void jmraid_options_init(jmraid_options_t* options);
+
+/**
+ * Detect the controller, check the mailbox sector, open and wake it
+ * @param device_path Block device of the enclosure, e.g. "/dev/sdc"
+ * @param options Options, or NULL for the defaults
+ * @param error Optional output: JMRAID_* error when NULL is returned
+ * @return Handle, or NULL on failure
+ */
+jmraid_t* jmraid_open(const char* device_path, const jmraid_options_t* options, int* error);
+
+/**
+ * Read IDENTIFY and SMART data of every present disk
+ * @return JMRAID_OK, or an error (the handle stays usable; poll again or close)
+ */
+int jmraid_poll(jmraid_t* handle, jmraid_status_t* status);
+
+/**
+ * Read only the RAID flags (one IDENTIFY, no SMART reads)
+ * @return JMRAID_OK or an error
+ */
+int jmraid_poll_flags(jmraid_t* handle, jmraid_flags_t* flags);
+
+/**
+ * Restore the mailbox sector, close the device and free the handle (NULL is ignored)
+ */
+void jmraid_close(jmraid_t* handle);
+
+/**
+ * Message for a JMRAID_* error code
+ */
+const char* jmraid_strerror(int error);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* JMRAID_H */
@@ -5,30 +5,51 @@
  * SPDX-License-Identifier: MIT
  */
 
+#define JSMN_HEADER /* jsmn declarations only (via common.h) */
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <getopt.h>
 #include <limits.h>
 #include <unistd.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
 #include "jm_protocol.h"
 #include "jm_commands.h"
 #include "smart_parser.h"
 #include "output_formatter.h"
 #include "config.h"
+#include "config_watch.h"
 #include "hardware_detect.h"
+#include "jm_cache.h"
+#include "jm_lock.h"
+#include "jm_replay.h"
+#include "jm_sim.h"
+#include "jm_history.h"
+#include "jm_sampler.h"
+#include "parsers/common.h"
 
 #ifndef VERSION
 #define VERSION "unknown"
 #endif
 #define DEFAULT_SECTOR 33 /* Original sector from jmraidcon - most compatible */
+#define DEFAULT_DAEMON_INTERVAL 60 /* Seconds between polls in --daemon mode */
+#define MAX_DEVICES 32 /* Enclosures accepted in one invocation */
+#define MAX_POLL_FAILURES 3 /* Daemon mode: consecutive failed polls before the session is reopened */
+#define DEFAULT_SAMPLE_DURATION 60 /* Seconds of --sample when --duration is not given */
+#define MAX_SAMPLE_RATE 10 /* --rate limit (Hz): one 0xD0 per disk per sample */
+#define MAX_DETECT_CACHE 64 /* Devices remembered in the hardware detection cache */
 
 /* Command-line options structure */
 typedef struct
 {
-    char device_path[256];
+    char device_paths[MAX_DEVICES][256];
+    int num_devices;
     int disk_number; // -1 = all disks
     output_mode_t output_mode;
+    int json_line; // One compact JSON line per device (NDJSON)
+    int binary; // --format=bin: one binary disk-health record per device instead
     int verbose;
     int quiet;
     int force; // Skip hardware detection
@@ -37,46 +58,64 @@ typedef struct
     int expected_array_size; // Expected number of disks (0 = not specified)
     char config_path[256]; // Path to config file (empty = use defaults)
     char write_default_config_path[256]; // If set, write default config and exit
+    int daemon; // Keep the session open and poll repeatedly
+    int interval; // Seconds between polls in daemon mode
+    char cache_dir[256]; // Identity/threshold cache directory (empty = disabled)
+    char record_path[256]; // Record every SG_IO transfer to this file (empty = off)
+    char replay_path[256]; // Serve transfers from this recording instead of a device
+    int replay_realtime; // Replay with the recorded per-transfer latency
+    char simulate_path[256]; // Serve a simulated controller built from this JSON (empty = off)
+    jm_sim_profile_t simulate_profile; // --simulate latency and fault injection
+    jm_sim_array_t simulate_array; // Loaded from simulate_path, shared by every virtual enclosure
+    int timings; // Measure per-phase and per-command latency
+    int retries; // Command retries on CRC mismatch/timeout
+    int scan; // Query every device found behind a JMicron controller
+    char history_path[256]; // Append each poll's SMART snapshots to this file (empty = off)
+    int changed_since; // Report only what changed since the history file's last poll
+    char run_dir[256]; // Mailbox lock files and shared polls
+    int max_age; // Report a shared poll at most this many seconds old (-1 = always poll)
+    int flags_only; // --flags: one IDENTIFY for the RAID flags, no SMART reads
+    int sample; // --sample temp: sample temperatures on one session
+    double sample_rate; // --rate: samples per second
+    int sample_duration; // --duration: seconds to sample
+    int sample_window; // --window: seconds per summary (0 = one at the end)
+    int has_fields; // --fields given: project the JSON and skip unneeded commands
+    output_fields_t fields;
+    int find_sector; // --find-sector: list the empty safe sectors (block reads only)
 } cli_options_t;
 
-/* Hardware detection functions now in hardware_detect.c */
-
-/* Check if a sector contains all zeros (is unused) */
-static int is_sector_empty(const uint8_t *sector_data, size_t size)
+/* Results of one poll of the controller */
+typedef struct
 {
-    for (size_t i = 0; i < size; i++)
-    {
-        if (sector_data[i] != 0)
-            return 0;
-    }
-    return 1;
-}
-
+    disk_smart_data_t disk_data[5];
+    int num_disks;
+    int is_degraded;
+    int present_disks; // From controller bitmask
+    jm_raid_flags_t flags; // --flags poll
+} poll_result_t;
 
-/* Validate sector number is in a safe range */
-static int is_sector_in_safe_range(uint32_t sector)
+/* One enclosure being queried (each runs on its own worker thread) */
+typedef struct
 {
-    /* Allow 0x21 (33) for backwards compatibility - original JMRaidCon default */
-    if (sector == 0x21)
-    {
-        return 1;
-    }
-
-    /* Reject sectors 0-63: MBR, partition table, GPT protective MBR, boot loaders */
-    /* (except 0x21 which we allow above) */
-    if (sector < 64)
-    {
-        return 0;
-    }
-
-    /* Reject sector 2048 and above (typical first partition start) */
-    if (sector >= 2048)
-    {
-        return 0;
-    }
+    const cli_options_t *options;
+    const char *device_path;
+    jm_session_t session;
+    controller_info_t controller;
+    int detected; // controller came from --scan or the detection cache
+    poll_result_t poll;
+    int opened; // Session is open and awake
+    int need_wakeup; // Daemon mode: previous poll failed
+    int failures; // Daemon mode: consecutive failed polls
+    const char *error; // Daemon mode: why this cycle's poll failed
+    int status; // 0 = queried, 3 = error (already reported)
+    char replay_device[256]; // Recorded device path (replay without a device argument)
+    jm_timings_t timings; // --timings: filled through session.timings
+    jm_lock_t lock; // Mailbox lock (not open for --replay, --simulate or without a run directory)
+    jm_sector_map_t empty_sectors; // --find-sector result
+    int num_empty; // Empty safe sectors in empty_sectors
+} device_job_t;
 
-    return 1;
-}
+/* Hardware detection functions now in hardware_detect.c */
 
 /* Hardware detection functions moved to hardware_detect.c */
 
@@ -90,7 +129,8 @@ static void print_version(void)
 
 static void print_help(const char *program_name)
 {
-    printf("Usage: %s [OPTIONS] /dev/sdX\n\n", program_name);
+    printf("Usage: %s [OPTIONS] /dev/sdX [/dev/sdY ...]\n", program_name);
+    printf("       %s [OPTIONS] --scan\n\n", program_name);
     printf("SMART health monitor for JMicron RAID controllers\n");
     printf("Supports USB-connected enclosures and PCIe controllers (JMB3xx series)\n\n");
     printf("Options:\n");
@@ -101,7 +141,9 @@ static void print_help(const char *program_name)
     printf("  -s, --summary           Show summary only (default)\n");
     printf("  -f, --full              Show full SMART attribute table\n");
     printf("  -j, --json              Output in JSON format\n");
-    printf("  --json-only             JSON output only (no extra messages, implies --quiet)\n");
+    printf("  --json-only             One compact JSON line per device for disk-health (implies --quiet)\n");
+    printf("  --format=FMT            Output for disk-health: json (same as --json-only) or bin\n");
+    printf("                          (binary records, no text encoding; implies --quiet)\n");
     printf("  -r, --raw               Dump raw protocol data to stderr (debug mode)\n");
     printf("  -q, --quiet             Minimal output (exit code only)\n");
     printf("  --verbose               Verbose output with debug info\n");
@@ -110,15 +152,56 @@ static void print_help(const char *program_name)
     printf("  --array-size N          Expected number of disks (fail if mismatch detected)\n");
     printf("  --config PATH           Load custom SMART threshold configuration\n");
     printf("  --write-default-config PATH  Write default config file and exit\n");
+    printf("  --daemon                Stay running and re-poll on a timer (setup is done once)\n");
+    printf("  --interval N            Seconds between polls in daemon mode (default: %d)\n", DEFAULT_DAEMON_INTERVAL);
+    printf("  --cache                 Cache IDENTIFY data and SMART thresholds (in %s)\n", JM_CACHE_DEFAULT_DIR);
+    printf("  --cache-dir PATH        Cache in PATH instead (implies --cache)\n");
+    printf("  --record FILE           Record every SG_IO transfer (with timings) to FILE\n");
+    printf("  --replay FILE           Run against a recording instead of a device (device optional)\n");
+    printf("  --replay-realtime       Replay with the recorded transfer latencies\n");
+    printf("  --simulate FILE[,latency=MS,jitter=MS,crc=RATE,timeouts=RATE,seed=N]\n");
+    printf("                          Query simulated controllers serving FILE (jmraidstatus JSON);\n");
+    printf("                          device args name the virtual enclosures (default: sim0)\n");
+    printf("  --timings               Report per-phase and per-command latency (JSON \"timings\")\n");
+    printf("  --scan                  Query every device behind a JMicron controller (no device args)\n");
+    printf("  --retries N             Re-issue a command up to N times on CRC mismatch or timeout\n");
+    printf("                          (default: %d, max: %d)\n", JM_DEFAULT_RETRIES, JM_MAX_RETRIES);
+    printf("  --history FILE          Append every poll's SMART snapshots to FILE (see jm-history)\n");
+    printf("  --changed-since FILE    Print only what changed since FILE's last poll, or a heartbeat\n");
+    printf("                          line if nothing did (implies --history FILE)\n");
+    printf("  --fields LIST           JSON fields per disk: identity, values, thresholds and/or\n");
+    printf("                          attribute IDs (e.g. identity or 194,5,197); commands the\n");
+    printf("                          fields don't need are skipped (identity: IDENTIFY only)\n");
+    printf("  --flags                 Read only the RAID flags (disk presence, rebuild) with one\n");
+    printf("                          IDENTIFY; no SMART reads, cheap enough to poll every few seconds\n");
+    printf("  --sample temp           Sample drive temperatures (one SMART values read per disk and\n");
+    printf("                          sample on one session) and print min/max/mean/p99 per disk\n");
+    printf("  --rate HZ               Samples per second with --sample (default: 1, max: %d)\n", MAX_SAMPLE_RATE);
+    printf("  --duration S            Seconds to sample (default: %d)\n", DEFAULT_SAMPLE_DURATION);
+    printf("  --window S              Print a summary every S seconds instead of once at the end\n");
+    printf("  --find-sector           List the empty sectors of the safe range (33, 64-2047) of each\n");
+    printf("                          device with a few large block reads; no controller commands\n");
+    printf("  --max-age N             Report another run's poll of the device if at most N seconds\n");
+    printf("                          old instead of polling (every all-disk poll is shared)\n");
+    printf("  --run-dir PATH          Mailbox locks and shared polls (default: %s)\n", JM_RUN_DEFAULT_DIR);
     printf("\nExamples:\n");
     printf("  %s /dev/sdc              # Show summary for all disks\n", program_name);
     printf("  %s -d 0 -f /dev/sdc      # Full SMART table for disk 0\n", program_name);
     printf("  %s -a -j /dev/sdc        # JSON output for all disks\n", program_name);
     printf("  %s --raw /dev/sdc        # Raw hex (original behavior)\n", program_name);
+    printf("  %s --daemon --interval 60 -j /dev/sdc  # Poll every 60 seconds\n", program_name);
+    printf("  %s --json-only /dev/sdc /dev/sdd | disk-health  # Query enclosures in parallel\n", program_name);
+    printf("  %s --find-sector --scan  # Empty mailbox candidates on every enclosure\n", program_name);
+    printf("  %s --record sdc.jmr /dev/sdc && %s --replay sdc.jmr  # Capture, then re-run offline\n",
+           program_name, program_name);
+    printf("  %s --simulate healthy.json,latency=8,crc=0.01 --json-only sim0 sim1  # No hardware\n",
+           program_name);
     printf("\nExit codes:\n");
     printf("  0: All disks healthy\n");
     printf("  1: Failed condition detected (or degraded RAID)\n");
-    printf("  3: Error (device not found, permission denied, etc.)\n");
+    printf("  3: Error (device not found, permission denied, etc.), or health not\n");
+    printf("     assessed (--fields without values)\n");
+    printf("  With several devices the worst result wins (a failure outranks an error).\n");
 }
 
 static int parse_arguments(int argc, char **argv, cli_options_t *options)
@@ -134,6 +217,12 @@ static int parse_arguments(int argc, char **argv, cli_options_t *options)
     options->expected_array_size = 0; // Not specified
     options->config_path[0] = '\0'; // No config file
     options->write_default_config_path[0] = '\0'; // Not writing config
+    options->interval = DEFAULT_DAEMON_INTERVAL;
+    options->retries = JM_DEFAULT_RETRIES;
+    options->max_age = -1;
+    options->sample_rate = 1.0;
+    options->sample_duration = DEFAULT_SAMPLE_DURATION;
+    strncpy(options->run_dir, JM_RUN_DEFAULT_DIR, sizeof(options->run_dir) - 1);
 
     static struct option long_options[] = {
         {"help", no_argument, 0, 'h'},
@@ -144,6 +233,7 @@ static int parse_arguments(int argc, char **argv, cli_options_t *options)
         {"full", no_argument, 0, 'f'},
         {"json", no_argument, 0, 'j'},
         {"json-only", no_argument, 0, 'J'},
+        {"format", required_argument, 0, 'O'},
         {"raw", no_argument, 0, 'r'},
         {"quiet", no_argument, 0, 'q'},
         {"verbose", no_argument, 0, 'V'},
@@ -152,6 +242,28 @@ static int parse_arguments(int argc, char **argv, cli_options_t *options)
         {"array-size", required_argument, 0, 'A'},
         {"config", required_argument, 0, 'C'},
         {"write-default-config", required_argument, 0, 'W'},
+        {"daemon", no_argument, 0, 'D'},
+        {"interval", required_argument, 0, 'I'},
+        {"cache", no_argument, 0, 'c'},
+        {"cache-dir", required_argument, 0, 'P'},
+        {"record", required_argument, 0, 'R'},
+        {"replay", required_argument, 0, 'Y'},
+        {"replay-realtime", no_argument, 0, 'X'},
+        {"simulate", required_argument, 0, 'm'},
+        {"timings", no_argument, 0, 'T'},
+        {"retries", required_argument, 0, 'E'},
+        {"scan", no_argument, 0, 'L'},
+        {"history", required_argument, 0, 'H'},
+        {"changed-since", required_argument, 0, 'G'},
+        {"max-age", required_argument, 0, 'M'},
+        {"run-dir", required_argument, 0, 'U'},
+        {"flags", no_argument, 0, 'B'},
+        {"sample", required_argument, 0, 'K'},
+        {"rate", required_argument, 0, 'Z'},
+        {"duration", required_argument, 0, 'N'},
+        {"window", required_argument, 0, 'Q'},
+        {"fields", required_argument, 0, 'e'},
+        {"find-sector", no_argument, 0, 'z'},
         {0, 0, 0, 0}};
 
     while ((opt = getopt_long(argc, argv, "hvd:asfjqrV", long_options, &option_index)) != -1)
@@ -189,6 +301,18 @@ static int parse_arguments(int argc, char **argv, cli_options_t *options)
         case 'J':
             /* --json-only: JSON output with no extra messages */
             options->output_mode = OUTPUT_MODE_JSON;
+            options->json_line = 1;
+            options->quiet = 1;
+            break;
+        case 'O':
+            if (strcmp(optarg, "json") != 0 && strcmp(optarg, "bin") != 0)
+            {
+                fprintf(stderr, "Error: --format must be json or bin\n");
+                return -1;
+            }
+            options->output_mode = OUTPUT_MODE_JSON;
+            options->json_line = 1;
+            options->binary = (strcmp(optarg, "bin") == 0);
             options->quiet = 1;
             break;
         case 'r':
@@ -222,27 +346,254 @@ static int parse_arguments(int argc, char **argv, cli_options_t *options)
             strncpy(options->write_default_config_path, optarg, sizeof(options->write_default_config_path) - 1);
             options->write_default_config_path[sizeof(options->write_default_config_path) - 1] = '\0';
             break;
+        case 'D':
+            options->daemon = 1;
+            break;
+        case 'I':
+            options->interval = atoi(optarg);
+            if (options->interval < 1)
+            {
+                fprintf(stderr, "Error: Interval must be at least 1 second\n");
+                return -1;
+            }
+            break;
+        case 'c':
+            if (options->cache_dir[0] == '\0')
+            {
+                strncpy(options->cache_dir, JM_CACHE_DEFAULT_DIR, sizeof(options->cache_dir) - 1);
+            }
+            break;
+        case 'P':
+            strncpy(options->cache_dir, optarg, sizeof(options->cache_dir) - 1);
+            options->cache_dir[sizeof(options->cache_dir) - 1] = '\0';
+            break;
+        case 'R':
+            strncpy(options->record_path, optarg, sizeof(options->record_path) - 1);
+            options->record_path[sizeof(options->record_path) - 1] = '\0';
+            break;
+        case 'Y':
+            strncpy(options->replay_path, optarg, sizeof(options->replay_path) - 1);
+            options->replay_path[sizeof(options->replay_path) - 1] = '\0';
+            break;
+        case 'X':
+            options->replay_realtime = 1;
+            break;
+        case 'm':
+            if (jm_sim_parse_spec(optarg, options->simulate_path, sizeof(options->simulate_path),
+                                  &options->simulate_profile) != 0)
+            {
+                fprintf(stderr, "Error: Invalid --simulate '%s' (FILE[,latency=MS,jitter=MS,crc=RATE,"
+                                "timeouts=RATE,seed=N], RATE 0-1)\n", optarg);
+                return -1;
+            }
+            break;
+        case 'H':
+            strncpy(options->history_path, optarg, sizeof(options->history_path) - 1);
+            options->history_path[sizeof(options->history_path) - 1] = '\0';
+            break;
+        case 'G':
+            strncpy(options->history_path, optarg, sizeof(options->history_path) - 1);
+            options->history_path[sizeof(options->history_path) - 1] = '\0';
+            options->changed_since = 1;
+            break;
+        case 'M':
+            options->max_age = atoi(optarg);
+            if (options->max_age < 0)
+            {
+                fprintf(stderr, "Error: --max-age must be 0 or more seconds\n");
+                return -1;
+            }
+            break;
+        case 'U':
+            strncpy(options->run_dir, optarg, sizeof(options->run_dir) - 1);
+            options->run_dir[sizeof(options->run_dir) - 1] = '\0';
+            break;
+        case 'B':
+            options->flags_only = 1;
+            break;
+        case 'z':
+            options->find_sector = 1;
+            break;
+        case 'e':
+            if (format_parse_fields(optarg, &options->fields) != 0)
+            {
+                fprintf(stderr, "Error: --fields takes identity, values, thresholds and attribute IDs "
+                                "(e.g. identity,194,5)\n");
+                return -1;
+            }
+            options->has_fields = 1;
+            break;
+        case 'K':
+            if (strcmp(optarg, "temp") != 0)
+            {
+                fprintf(stderr, "Error: --sample supports only temp\n");
+                return -1;
+            }
+            options->sample = 1;
+            break;
+        case 'Z':
+            options->sample_rate = strtod(optarg, NULL);
+            if (!(options->sample_rate > 0.0 && options->sample_rate <= MAX_SAMPLE_RATE))
+            {
+                fprintf(stderr, "Error: --rate must be above 0 and at most %d Hz\n", MAX_SAMPLE_RATE);
+                return -1;
+            }
+            break;
+        case 'N':
+            options->sample_duration = atoi(optarg);
+            if (options->sample_duration < 1)
+            {
+                fprintf(stderr, "Error: --duration must be at least 1 second\n");
+                return -1;
+            }
+            break;
+        case 'Q':
+            options->sample_window = atoi(optarg);
+            if (options->sample_window < 1)
+            {
+                fprintf(stderr, "Error: --window must be at least 1 second\n");
+                return -1;
+            }
+            break;
+        case 'T':
+            options->timings = 1;
+            break;
+        case 'L':
+            options->scan = 1;
+            break;
+        case 'E':
+            options->retries = atoi(optarg);
+            if (options->retries < 0 || options->retries > JM_MAX_RETRIES)
+            {
+                fprintf(stderr, "Error: Retries must be 0-%d\n", JM_MAX_RETRIES);
+                return -1;
+            }
+            break;
         default:
             return -1;
         }
     }
 
-    /* Get device path (not required for --write-default-config) */
+    /* Get device paths (not required for --write-default-config, --replay or --scan) */
+    if (options->scan && optind < argc)
+    {
+        fprintf(stderr, "Error: --scan finds the devices itself; don't pass device paths\n");
+        return -1;
+    }
+    if (options->scan && (options->record_path[0] != '\0' || options->replay_path[0] != '\0' ||
+                          options->simulate_path[0] != '\0'))
+    {
+        fprintf(stderr, "Error: --scan cannot be combined with --record, --replay or --simulate\n");
+        return -1;
+    }
     if (optind >= argc)
     {
-        if (options->write_default_config_path[0] == '\0')
+        if (options->write_default_config_path[0] == '\0' && options->replay_path[0] == '\0' &&
+            options->simulate_path[0] == '\0' && !options->scan)
         {
             fprintf(stderr, "Error: Device path required\n\n");
             print_help(argv[0]);
             return -1;
         }
         /* --write-default-config doesn't need device path */
-        options->device_path[0] = '\0';
     }
-    else
+
+    for (int i = optind; i < argc; i++)
+    {
+        if (options->num_devices >= MAX_DEVICES)
+        {
+            fprintf(stderr, "Error: At most %d devices can be queried at once\n", MAX_DEVICES);
+            return -1;
+        }
+        strncpy(options->device_paths[options->num_devices], argv[i], sizeof(options->device_paths[0]) - 1);
+        options->device_paths[options->num_devices][sizeof(options->device_paths[0]) - 1] = '\0';
+        options->num_devices++;
+    }
+
+    /* A recording holds exactly one controller's transfers */
+    if ((options->record_path[0] != '\0' || options->replay_path[0] != '\0') && options->num_devices > 1)
+    {
+        fprintf(stderr, "Error: --record and --replay take a single device\n");
+        return -1;
+    }
+    if (options->record_path[0] != '\0' && options->replay_path[0] != '\0')
+    {
+        fprintf(stderr, "Error: --record and --replay cannot be combined\n");
+        return -1;
+    }
+    if (options->simulate_path[0] != '\0' && (options->record_path[0] != '\0' || options->replay_path[0] != '\0'))
+    {
+        fprintf(stderr, "Error: --simulate cannot be combined with --record or --replay\n");
+        return -1;
+    }
+    if (options->replay_path[0] != '\0' && options->daemon)
+    {
+        fprintf(stderr, "Error: --replay cannot be used with --daemon\n");
+        return -1;
+    }
+    if (options->max_age >= 0 && options->daemon)
+    {
+        fprintf(stderr, "Error: --max-age cannot be used with --daemon (the daemon always polls)\n");
+        return -1;
+    }
+    if (options->flags_only &&
+        (options->disk_number >= 0 || options->output_mode == OUTPUT_MODE_FULL || options->binary ||
+         options->history_path[0] != '\0' || options->max_age >= 0))
+    {
+        fprintf(stderr, "Error: --flags reads no SMART data; it cannot be combined with "
+                        "--disk, --full, --format=bin, --history, --changed-since or --max-age\n");
+        return -1;
+    }
+    if (options->sample &&
+        (options->daemon || options->flags_only || options->output_mode == OUTPUT_MODE_FULL || options->binary ||
+         options->history_path[0] != '\0' || options->max_age >= 0))
+    {
+        fprintf(stderr, "Error: --sample cannot be combined with --daemon, --flags, --full, --format=bin, "
+                        "--history, --changed-since or --max-age\n");
+        return -1;
+    }
+    if (options->find_sector &&
+        (options->daemon || options->flags_only || options->sample || options->disk_number >= 0 ||
+         options->output_mode == OUTPUT_MODE_FULL || options->binary || options->history_path[0] != '\0' ||
+         options->max_age >= 0 || options->has_fields || options->record_path[0] != '\0' ||
+         options->replay_path[0] != '\0' || options->simulate_path[0] != '\0'))
+    {
+        fprintf(stderr, "Error: --find-sector only reads the disks; it cannot be combined with --daemon, "
+                        "--flags, --sample, --disk, --full, --format=bin, --history, --changed-since, "
+                        "--max-age, --fields, --record, --replay or --simulate\n");
+        return -1;
+    }
+    if (options->has_fields &&
+        (options->output_mode != OUTPUT_MODE_JSON || options->binary || options->flags_only || options->sample ||
+         options->history_path[0] != '\0'))
+    {
+        fprintf(stderr, "Error: --fields projects the JSON output; use it with --json or --json-only, "
+                        "without --format=bin, --flags, --sample, --history or --changed-since\n");
+        return -1;
+    }
+    if (options->replay_path[0] != '\0' && options->num_devices == 0)
+    {
+        options->num_devices = 1; /* Device path comes from the recording */
+    }
+    if (options->simulate_path[0] != '\0')
+    {
+        if (jm_sim_load(options->simulate_path, &options->simulate_array) != 0)
+        {
+            fprintf(stderr, "Error: Cannot load %s for --simulate (expected jmraidstatus JSON output)\n",
+                    options->simulate_path);
+            return -1;
+        }
+        if (options->num_devices == 0)
+        {
+            snprintf(options->device_paths[0], sizeof(options->device_paths[0]), "sim0");
+            options->num_devices = 1;
+        }
+    }
+
+    /* Several pretty-printed documents can't be told apart; emit NDJSON */
+    if (options->num_devices > 1 && options->output_mode == OUTPUT_MODE_JSON)
     {
-        strncpy(options->device_path, argv[optind], sizeof(options->device_path) - 1);
-        options->device_path[sizeof(options->device_path) - 1] = '\0';
+        options->json_line = 1;
     }
 
     return 0;
@@ -270,136 +621,489 @@ static int determine_exit_code(const disk_smart_data_t *disks, int num_disks)
     return 0;
 }
 
-int main(int argc, char **argv)
+/* Query disk(s) for SMART data
+ * Returns 0 on success, 3 on error (error already reported unless quiet) */
+static int query_disks(jm_session_t *session, const cli_options_t *options, poll_result_t *poll)
 {
-    cli_options_t options;
-    int fd;
-    disk_smart_data_t disk_data[5];
-    int num_disks = 0;
-    int exit_code = 0;
-    int is_degraded = 0;
-    int present_disks = 0;  /* From controller bitmask */
+    int result;
 
-    /* Parse command-line arguments */
-    if (parse_arguments(argc, argv, &options) != 0)
-    {
-        return 3;
-    }
+    memset(poll, 0, sizeof(poll_result_t));
 
-    /* Handle --write-default-config (write config and exit) */
-    if (options.write_default_config_path[0] != '\0')
+    if (options->flags_only)
     {
-        return (config_write_default(options.write_default_config_path) == 0) ? 0 : 3;
+        /* The presence bitmask, rebuild and phase bytes; one IDENTIFY */
+        if (jm_get_raid_flags(session, &poll->flags) != 0)
+        {
+            if (!options->quiet)
+            {
+                fprintf(stderr, "Error: Failed to read RAID flags\n");
+            }
+            return 3;
+        }
+        return 0;
     }
 
-    /* Load config if specified, otherwise use defaults */
-    smart_config_t config;
-    if (options.config_path[0] != '\0')
+    if (options->disk_number >= 0)
     {
-        if (config_load(options.config_path, &config) != 0)
+        /* Single disk query */
+        if (options->verbose)
         {
-            if (!options.quiet)
+            printf("Querying disk %d...\n", options->disk_number);
+        }
+
+        disk_smart_data_t *disk = &poll->disk_data[options->disk_number];
+        if (session->reads & JM_READ_VALUES)
+        {
+            result = jm_get_disk_smart_data(session, options->disk_number, NULL, disk);
+        }
+        else
+        {
+            disk->disk_number = options->disk_number;
+            disk->is_present = 1;
+            disk->overall_status = DISK_STATUS_ERROR; /* No SMART data read */
+            result = 0;
+        }
+
+        /* The single-disk path has no IDENTIFY unless --fields asks for the identity */
+        if (result == 0 && options->has_fields && options->fields.identity &&
+            jm_get_disk_identify(session, options->disk_number, disk->disk_name, disk->serial_number,
+                                 disk->firmware_rev, &disk->size_mb, NULL) != 0 &&
+            !(session->reads & JM_READ_VALUES))
+        {
+            result = -1;
+        }
+        if (result != 0)
+        {
+            if (!options->quiet)
             {
-                fprintf(stderr, "Error: Failed to load config from %s\n", options.config_path);
+                fprintf(stderr, "Error: Failed to read %s from disk %d\n",
+                        (session->reads & JM_READ_VALUES) ? "SMART data" : "identity", options->disk_number);
             }
             return 3;
         }
-        if (options.verbose)
-        {
-            printf("Loaded config from: %s\n", options.config_path);
-        }
+        poll->num_disks = 1;
     }
     else
     {
-        /* No config file specified - use defaults */
-        config_init_default(&config);
+        /* All disks query */
+        if (options->verbose)
+        {
+            printf("Querying all disks...\n");
+        }
+
+        result = jm_get_all_disks_smart_data(session, poll->disk_data, &poll->num_disks,
+                                             &poll->is_degraded, &poll->present_disks);
+        if (result != 0)
+        {
+            if (!options->quiet)
+            {
+                fprintf(stderr, "Error: Failed to read SMART data\n");
+            }
+            return 3;
+        }
     }
 
-    /* Set global config for SMART assessment */
-    smart_set_config(&config);
+    return 0;
+}
+
+/* Change report of one poll (--changed-since) */
+typedef struct
+{
+    int json;
+    int changes;
+} change_report_t;
 
-    /* Set global runtime context for JM commands */
-    jm_runtime_context_t runtime_ctx = {
-        .verbose = options.verbose,
-        .dump_raw = options.dump_raw,
-        .sector = options.sector,
-        .expected_array_size = options.expected_array_size
-    };
-    jm_set_context(&runtime_ctx);
+static void print_change(void *ctx, const jm_history_change_t *change)
+{
+    change_report_t *report = ctx;
+    jm_history_write_change(stdout, change, report->json);
+    report->changes++;
+}
 
-    /* Validate sector is in safe range */
-    if (!is_sector_in_safe_range(options.sector))
+/* Print the RAID flags of a --flags poll
+ * Returns 1 if the array is degraded or rebuilding, 0 otherwise */
+static int report_flags(const cli_options_t *options, const device_job_t *job)
+{
+    const char *controller_model = job->controller.found ? job->controller.model : NULL;
+    const char *status = raid_flags_status(&job->poll.flags, options->expected_array_size);
+
+    if (!options->quiet || options->json_line)
     {
-        if (!options.quiet)
+        if (options->output_mode == OUTPUT_MODE_JSON)
         {
-            fprintf(stderr, "Error: Sector %u is in an unsafe range\n", options.sector);
-            fprintf(stderr, "\n");
-            fprintf(stderr, "  Unsafe ranges:\n");
-            fprintf(stderr, "  - Sectors 0-32, 34-63: MBR, partition table, GPT, boot loaders\n");
-            fprintf(stderr, "  - Sector 2048+: Typical first partition location\n");
-            fprintf(stderr, "\n");
-            fprintf(stderr, "  Safe range: 33 (0x21, original default), 64-2047\n");
-            fprintf(stderr, "  Recommended: Use default (33) or run tests/check_sectors\n");
-            fprintf(stderr, "\n");
-            fprintf(stderr, "  See SECTOR_USAGE.md for details.\n");
+            format_flags_json(job->device_path, &job->poll.flags, options->expected_array_size,
+                              controller_model, job->session.timings, options->json_line);
         }
-        return 3;
+        else
+        {
+            format_flags(job->device_path, &job->poll.flags, options->expected_array_size, controller_model);
+            if (job->session.timings != NULL)
+            {
+                format_timings(job->session.timings);
+            }
+        }
+        fflush(stdout);
     }
 
-    /* Set verbose mode environment variable for protocol layer */
-    if (options.verbose)
+    return (strcmp(status, "rebuilding") == 0 || strcmp(status, "degraded") == 0) ? 1 : 0;
+}
+
+/* Print the results of one poll in the selected output mode
+ * Returns the health exit code (0 = healthy, 1 = failed or degraded,
+ * 3 = not assessed: --fields without values) */
+static int report_results(const cli_options_t *options, const device_job_t *job)
+{
+    const poll_result_t *poll = &job->poll;
+    const char *controller_model = job->controller.found ? job->controller.model : NULL;
+    int exit_code;
+
+    if (options->flags_only)
     {
-        setenv("JMRAIDSTATUS_VERBOSE", "1", 1);
+        return report_flags(options, job);
     }
 
-    /* Detect JMicron hardware unless --force is used */
-    controller_info_t controller;
-    memset(&controller, 0, sizeof(controller));
-
-    if (!options.force)
+    /* Output results based on mode (--changed-since prints changes instead);
+     * --json-only is quiet about everything but its records */
+    if ((!options->quiet || options->json_line) && !options->changed_since)
     {
-        if (options.verbose)
+        switch (options->output_mode)
         {
-            printf("Detecting hardware...\n");
-        }
+        case OUTPUT_MODE_SUMMARY:
+            format_summary(job->device_path, poll->disk_data, poll->num_disks,
+                           controller_model);
+            break;
 
-        if (detect_jmicron_hardware(&controller, options.device_path) != 0)
-        {
-            if (!options.quiet)
+        case OUTPUT_MODE_FULL:
+            if (options->disk_number >= 0)
             {
-                fprintf(stderr, "Error: Could not detect JMicron RAID controller\n");
-                fprintf(stderr, "  This tool supports JMicron RAID controllers in USB enclosures or PCIe cards.\n");
-                fprintf(stderr, "  Use --force to skip hardware detection and try anyway.\n");
-                fprintf(stderr, "\n");
-                fprintf(stderr, "  Note: For USB enclosures, detection should work automatically.\n");
-                fprintf(stderr, "  If you get this error with a USB enclosure, try --force.\n");
+                format_full_smart(&poll->disk_data[options->disk_number]);
             }
-            return 3;
-        }
+            else
+            {
+                /* Show full for all disks */
+                for (int i = 0; i < 5; i++)
+                {
+                    if (poll->disk_data[i].is_present)
+                    {
+                        format_full_smart(&poll->disk_data[i]);
+                        printf("\n");
+                    }
+                }
+            }
+            break;
 
-        if (options.verbose)
-        {
-            if (controller.device_id > 0)
+        case OUTPUT_MODE_JSON:
+            if (options->binary)
             {
-                printf("Detected: %s (%04x:%04x) - %s\n",
-                       controller.model, controller.vendor_id, controller.device_id,
-                       controller.description);
+                format_record(job->device_path, poll->disk_data, controller_model,
+                              job->session.timings);
+            }
+            else if (options->json_line)
+            {
+                format_json_line(job->device_path, poll->disk_data, poll->num_disks,
+                                 options->expected_array_size, poll->present_disks, poll->is_degraded,
+                                 controller_model, job->session.timings);
             }
             else
             {
-                printf("Detected: %s - %s\n", controller.model, controller.description);
+                format_json(job->device_path, poll->disk_data, poll->num_disks,
+                            options->expected_array_size, poll->present_disks, poll->is_degraded,
+                            controller_model, job->session.timings);
             }
+            break;
+
+        default:
+            break;
         }
-    }
-    else if (options.verbose)
-    {
-        printf("Skipping hardware detection (--force used).\n");
-    }
 
-    /* Show version banner unless quiet mode or JSON mode */
-    if (!options.quiet && options.output_mode != OUTPUT_MODE_JSON)
-    {
-        /* Summary and full modes get minimal banner */
+        /* JSON carries timings inline; other modes get a table after the report */
+        if (job->session.timings != NULL && options->output_mode != OUTPUT_MODE_JSON)
+        {
+            format_timings(job->session.timings);
+        }
+    }
+
+    /* Determine exit code based on health status */
+    exit_code = determine_exit_code(poll->disk_data, poll->num_disks);
+
+    /* If RAID is degraded and all disks are healthy, return failed exit code */
+    if (poll->is_degraded && exit_code == 0)
+    {
+        exit_code = 1; /* Failed: degraded RAID even though disks are healthy */
+    }
+
+    /* --fields without values read no SMART data: health unknown, not healthy */
+    if (options->has_fields && !options->fields.values && exit_code == 0)
+    {
+        exit_code = 3;
+    }
+
+    /* Opened per poll, so a daemon never holds the history file between polls */
+    if (options->history_path[0] != '\0')
+    {
+        int64_t now = (int64_t)time(NULL);
+        int report_changes = options->changed_since && !options->quiet;
+        change_report_t report = {options->output_mode == OUTPUT_MODE_JSON, 0};
+        char source[sizeof(options->device_paths[0]) + 16];
+
+        /* A --disk poll sees one slot; keyed apart so the others don't read as removed */
+        if (options->disk_number >= 0)
+            snprintf(source, sizeof(source), "%s:%d", job->device_path, options->disk_number);
+        else
+            snprintf(source, sizeof(source), "%s", job->device_path);
+
+        if (jm_history_record(options->history_path, source, poll->disk_data, 5, now,
+                              report_changes ? print_change : NULL, &report) < 0)
+        {
+            fprintf(stderr, "Warning: Could not append to history file %s\n", options->history_path);
+        }
+        else if (report_changes && report.changes == 0)
+        {
+            jm_history_write_heartbeat(stdout, source, now, poll->num_disks,
+                                       exit_code == 0 ? DISK_STATUS_PASSED : DISK_STATUS_FAILED, report.json);
+        }
+        fflush(stdout);
+    }
+
+    /* Show RAID array size warnings at end (after SMART data)
+     * Skip in JSON mode - warnings are included in JSON output */
+    if (options->expected_array_size > 0 && poll->present_disks > 0 && !options->quiet &&
+        options->output_mode != OUTPUT_MODE_JSON && !options->changed_since)
+    {
+        if (poll->is_degraded)
+        {
+            /* Degraded: fewer disks than expected */
+            printf("\n");
+            printf("=======================================================================\n");
+            printf("WARNING: DEGRADED RAID ARRAY DETECTED\n");
+            printf("=======================================================================\n");
+            printf("Expected %d disk%s but found only %d disk%s.\n",
+                   options->expected_array_size, options->expected_array_size == 1 ? "" : "s",
+                   poll->present_disks, poll->present_disks == 1 ? "" : "s");
+            printf("One or more disks may have failed or been removed.\n");
+            printf("RAID array is operating in degraded mode with REDUCED or NO redundancy!\n");
+            printf("Replace failed disk(s) immediately to restore redundancy.\n");
+            printf("=======================================================================\n\n");
+        }
+        else if (poll->present_disks > options->expected_array_size)
+        {
+            /* More disks than expected */
+            printf("\n");
+            printf("=======================================================================\n");
+            printf("WARNING: MORE DISKS THAN EXPECTED\n");
+            printf("=======================================================================\n");
+            printf("Expected %d disk%s but found %d disk%s.\n",
+                   options->expected_array_size, options->expected_array_size == 1 ? "" : "s",
+                   poll->present_disks, poll->present_disks == 1 ? "" : "s");
+            printf("This may indicate:\n");
+            printf("  - Incorrect --array-size specified (check your array configuration)\n");
+            printf("  - Extra disk added to array\n");
+            printf("  - Array configuration changed\n");
+            printf("=======================================================================\n\n");
+        }
+    }
+
+    return exit_code;
+}
+
+/* Sleep until an absolute CLOCK_MONOTONIC deadline (restarts on EINTR) */
+static void sleep_until(const struct timespec *deadline)
+{
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, deadline, NULL) == EINTR)
+    {
+    }
+}
+
+/* Whether runs talk to real devices (not --replay or --simulate): only then
+ * do the mailbox lock, detection cache and shared results apply */
+static int uses_device(const cli_options_t *options)
+{
+    return options->replay_path[0] == '\0' && options->simulate_path[0] == '\0';
+}
+
+/* --timings helpers: no-ops unless the session has timings attached */
+static uint64_t phase_begin(const device_job_t *job)
+{
+    return job->session.timings ? jm_monotonic_us() : 0;
+}
+
+static void phase_end(device_job_t *job, jm_phase_t phase, uint64_t start)
+{
+    if (job->session.timings)
+    {
+        jm_latency_add(&job->session.timings->phases[phase], jm_monotonic_us() - start);
+    }
+}
+
+/* Open the session on a recording instead of a device. Detection, the
+ * sector safety check and signal cleanup don't apply: nothing touches disk.
+ * Returns 0 with the session open, or 3 (error already reported). */
+static int open_replay(device_job_t *job)
+{
+    const cli_options_t *options = job->options;
+    jm_replay_info_t info;
+
+    job->session.transport = jm_replay_open(options->replay_path, options->replay_realtime, &info);
+    if (job->session.transport == NULL)
+    {
+        if (!options->quiet)
+        {
+            fprintf(stderr, "Error: Cannot read recording %s\n", options->replay_path);
+        }
+        return 3;
+    }
+
+    /* Report under the recorded device unless one was given */
+    if (job->device_path[0] == '\0')
+    {
+        snprintf(job->replay_device, sizeof(job->replay_device), "%s", info.device_path);
+        job->device_path = job->replay_device;
+    }
+    if (info.controller_model[0] != '\0')
+    {
+        job->controller.found = 1;
+        snprintf(job->controller.model, sizeof(job->controller.model), "%s", info.controller_model);
+    }
+
+    if (options->verbose)
+    {
+        printf("Replaying %u transfers from %s (recorded on %s, sector %u)...\n",
+               info.num_transfers, options->replay_path, info.device_path, info.sector);
+    }
+
+    uint64_t start = phase_begin(job);
+    int result = jm_send_wakeup(&job->session);
+    phase_end(job, JM_PHASE_WAKEUP, start);
+    if (result != JM_SUCCESS)
+    {
+        if (!options->quiet)
+        {
+            fprintf(stderr, "Error: Failed to wake up controller on %s\n", job->device_path);
+            fprintf(stderr, "  %s\n", jm_error_string(result));
+        }
+        jm_cleanup_device(&job->session);
+        return 3;
+    }
+
+    job->opened = 1;
+    return 0;
+}
+
+/* Open the session on a simulated controller serving the --simulate array.
+ * Each virtual enclosure gets its own fault sequence, seeded from its name.
+ * Returns 0 with the session open, or 3 (error already reported). */
+static int open_simulated(device_job_t *job)
+{
+    const cli_options_t *options = job->options;
+    jm_sim_profile_t profile = options->simulate_profile;
+
+    uint32_t hash = 2166136261u; // FNV-1a
+    for (const char *p = job->device_path; *p != '\0'; p++)
+    {
+        hash = (hash ^ (uint8_t)*p) * 16777619u;
+    }
+    profile.seed ^= hash;
+
+    job->session.transport = jm_sim_open(&options->simulate_array, &profile);
+    if (job->session.transport == NULL)
+    {
+        if (!options->quiet)
+        {
+            fprintf(stderr, "Error: Cannot create simulated controller for %s\n", job->device_path);
+        }
+        return 3;
+    }
+
+    job->controller.found = 1;
+    snprintf(job->controller.model, sizeof(job->controller.model), "%s",
+             options->simulate_array.controller_model[0] != '\0' ? options->simulate_array.controller_model
+                                                                 : "Simulated");
+
+    uint64_t start = phase_begin(job);
+    int result = jm_wake(&job->session);
+    phase_end(job, JM_PHASE_WAKEUP, start);
+    if (result != JM_SUCCESS)
+    {
+        if (!options->quiet)
+        {
+            fprintf(stderr, "Error: Failed to wake up controller on %s\n", job->device_path);
+            fprintf(stderr, "  %s\n", jm_error_string(result));
+        }
+        jm_cleanup_device(&job->session);
+        return 3;
+    }
+
+    job->opened = 1;
+    return 0;
+}
+
+/* Detect the controller, verify the mailbox sector, then open and wake the
+ * session. Returns 0 with the session open, or 3 (error already reported). */
+static int open_device(device_job_t *job)
+{
+    const cli_options_t *options = job->options;
+    uint64_t start;
+    int result;
+
+    if (options->replay_path[0] != '\0')
+    {
+        return open_replay(job);
+    }
+    if (options->simulate_path[0] != '\0')
+    {
+        return open_simulated(job);
+    }
+
+    /* Detect JMicron hardware unless --force is used or --scan/the cache already did */
+    if (job->detected)
+    {
+        if (options->verbose)
+        {
+            printf("Detected (cached): %s (%04x:%04x) - %s\n", job->controller.model,
+                   job->controller.vendor_id, job->controller.device_id, job->controller.description);
+        }
+    }
+    else if (!options->force)
+    {
+        if (options->verbose)
+        {
+            printf("Detecting hardware...\n");
+        }
+
+        start = phase_begin(job);
+        result = detect_jmicron_hardware(&job->controller, job->device_path);
+        phase_end(job, JM_PHASE_DETECT, start);
+        if (result != 0)
+        {
+            if (!options->quiet)
+            {
+                fprintf(stderr, "Error: Could not detect JMicron RAID controller on %s\n", job->device_path);
+                fprintf(stderr, "  This tool supports JMicron RAID controllers in USB enclosures or PCIe cards.\n");
+                fprintf(stderr, "  Use --force to skip hardware detection and try anyway.\n");
+                fprintf(stderr, "\n");
+                fprintf(stderr, "  Note: For USB enclosures, detection should work automatically.\n");
+                fprintf(stderr, "  If you get this error with a USB enclosure, try --force.\n");
+            }
+            return 3;
+        }
+
+        if (options->verbose)
+        {
+            if (job->controller.device_id > 0)
+            {
+                printf("Detected: %s (%04x:%04x) - %s\n",
+                       job->controller.model, job->controller.vendor_id, job->controller.device_id,
+                       job->controller.description);
+            }
+            else
+            {
+                printf("Detected: %s - %s\n", job->controller.model, job->controller.description);
+            }
+        }
+    }
+    else if (options->verbose)
+    {
+        printf("Skipping hardware detection (--force used).\n");
     }
 
     /* Safety check: block device I/O is the authoritative source of truth.
@@ -412,22 +1116,25 @@ int main(int argc, char **argv)
      * If the block device read fails, we refuse to proceed conservatively.
      */
     uint8_t block_sector[512];
-    if (jm_read_sector_block(options.device_path, options.sector, block_sector) != 0)
+    start = phase_begin(job);
+    result = jm_read_sector_block(job->device_path, options->sector, block_sector);
+    phase_end(job, JM_PHASE_SAFETY_READ, start);
+    if (result != 0)
     {
-        if (!options.quiet)
+        if (!options->quiet)
         {
-            fprintf(stderr, "Error: Could not read sector %u via block device to verify it is safe\n",
-                    options.sector);
+            fprintf(stderr, "Error: Could not read sector %u of %s via block device to verify it is safe\n",
+                    options->sector, job->device_path);
             fprintf(stderr, "  See SECTOR_USAGE.md for details.\n");
         }
         return 3;
     }
 
-    if (!is_sector_empty(block_sector, 512))
+    if (!jm_sector_is_empty(block_sector, 512))
     {
-        if (!options.quiet)
+        if (!options->quiet)
         {
-            fprintf(stderr, "Error: Sector %u contains data on disk\n", options.sector);
+            fprintf(stderr, "Error: Sector %u contains data on disk (%s)\n", options->sector, job->device_path);
             fprintf(stderr, "  First 16 bytes: ");
             for (int i = 0; i < 16; i++)
                 fprintf(stderr, "%02x ", block_sector[i]);
@@ -436,7 +1143,7 @@ int main(int argc, char **argv)
             fprintf(stderr, "  This sector may contain partition data, RAID metadata, or other critical information.\n");
             fprintf(stderr, "\n");
             fprintf(stderr, "  Solutions:\n");
-            fprintf(stderr, "  1. Check your partition layout: sudo fdisk -l %s\n", options.device_path);
+            fprintf(stderr, "  1. Check your partition layout: sudo fdisk -l %s\n", job->device_path);
             fprintf(stderr, "  2. Use a different sector: --sector XXXX (must be unused)\n");
             fprintf(stderr, "  3. Use tests/check_sectors to find an empty sector\n");
             fprintf(stderr, "\n");
@@ -445,23 +1152,25 @@ int main(int argc, char **argv)
         return 3;
     }
 
-    if (options.verbose)
+    if (options->verbose)
     {
-        printf("Sector %u verified empty via block device (safe to use).\n", options.sector);
+        printf("Sector %u verified empty via block device (safe to use).\n", options->sector);
     }
 
     /* Open the SG device for protocol communication */
-    if (options.verbose)
+    if (options->verbose)
     {
-        printf("Opening device %s...\n", options.device_path);
+        printf("Opening device %s...\n", job->device_path);
     }
 
-    int result = jm_init_device(options.device_path, &fd);
+    start = phase_begin(job);
+    result = jm_init_device(&job->session, job->device_path);
+    phase_end(job, JM_PHASE_OPEN, start);
     if (result != JM_SUCCESS)
     {
-        if (!options.quiet)
+        if (!options->quiet)
         {
-            fprintf(stderr, "Error: Cannot open %s\n", options.device_path);
+            fprintf(stderr, "Error: Cannot open %s\n", job->device_path);
             fprintf(stderr, "  %s\n", jm_error_string(result));
             if (result == JM_ERROR_DEVICE_OPEN)
             {
@@ -474,178 +1183,1132 @@ int main(int argc, char **argv)
         return 3;
     }
 
+    /* Record every transfer from here on, wakeup included */
+    if (options->record_path[0] != '\0')
+    {
+        jm_replay_info_t info;
+        memset(&info, 0, sizeof(info));
+        snprintf(info.device_path, sizeof(info.device_path), "%s", job->device_path);
+        if (job->controller.found)
+        {
+            snprintf(info.controller_model, sizeof(info.controller_model), "%s", job->controller.model);
+        }
+        info.sector = options->sector;
+
+        job->session.transport = jm_record_open(options->record_path, NULL, &info);
+        if (job->session.transport == NULL)
+        {
+            if (!options->quiet)
+            {
+                fprintf(stderr, "Error: Cannot create recording %s\n", options->record_path);
+            }
+            jm_cleanup_device(&job->session);
+            return 3;
+        }
+        if (options->verbose)
+        {
+            printf("Recording transfers to %s.\n", options->record_path);
+        }
+    }
+
     /* Setup signal handlers to ensure cleanup on interruption */
-    jm_setup_signal_handlers(fd, options.sector);
+    jm_setup_signal_handlers(&job->session);
 
-    if (options.verbose)
+    if (options->verbose)
     {
         printf("Signal handlers installed (sector will be restored on Ctrl+C).\n");
     }
 
     /* Send wakeup sequence */
-    if (options.verbose)
+    if (options->verbose)
     {
         printf("Sending wakeup sequence...\n");
     }
 
-    result = jm_send_wakeup(fd, options.sector);
+    start = phase_begin(job);
+    result = jm_wake(&job->session);
+    phase_end(job, JM_PHASE_WAKEUP, start);
     if (result != JM_SUCCESS)
     {
-        if (!options.quiet)
+        if (!options->quiet)
         {
-            fprintf(stderr, "Error: Failed to wake up controller\n");
+            fprintf(stderr, "Error: Failed to wake up controller on %s\n", job->device_path);
             fprintf(stderr, "  %s\n", jm_error_string(result));
         }
-        jm_cleanup_device(fd, options.sector);
+        jm_cleanup_device(&job->session);
         return 3;
     }
 
-    /* Query disk(s) for SMART data */
-    if (options.disk_number >= 0)
+    job->opened = 1;
+    job->need_wakeup = 0;
+    return 0;
+}
+
+/* Close the session, restoring the mailbox sector */
+static void close_device(device_job_t *job)
+{
+    const cli_options_t *options = job->options;
+
+    if (!job->opened)
     {
-        /* Single disk query */
-        if (options.verbose)
-        {
-            printf("Querying disk %d...\n", options.disk_number);
-        }
+        return;
+    }
 
-        result = jm_get_disk_smart_data(fd, options.disk_number, NULL,
-                                        &disk_data[options.disk_number]);
-        if (result == 0)
-        {
-            num_disks = 1;
-        }
-        else
-        {
-            if (!options.quiet)
-            {
-                fprintf(stderr, "Error: Failed to read SMART data from disk %d\n",
-                        options.disk_number);
-            }
-            jm_cleanup_device(fd, options.sector);
-            return 3;
-        }
+    if (options->verbose)
+    {
+        printf("Restoring sector and closing device %s...\n", job->device_path);
     }
-    else
+
+    uint64_t start = phase_begin(job);
+    int result = jm_cleanup_device(&job->session);
+    phase_end(job, JM_PHASE_CLEANUP, start);
+    if (result != JM_SUCCESS && !options->quiet)
     {
-        /* All disks query */
-        if (options.verbose)
-        {
-            printf("Querying all disks...\n");
-        }
+        fprintf(stderr, "Warning: Failed to restore original sector data on %s\n", job->device_path);
+    }
+    job->opened = 0;
+}
 
-        result = jm_get_all_disks_smart_data(fd, disk_data, &num_disks, &is_degraded, &present_disks);
-        if (result != 0)
-        {
-            if (!options.quiet)
-            {
-                fprintf(stderr, "Error: Failed to read SMART data\n");
-            }
-            jm_cleanup_device(fd, options.sector);
-            return 3;
-        }
+/* Take the mailbox lock of the job's device (no-op without a lock file)
+ * Returns 0 when held, or 3 (error already reported) */
+static int lock_mailbox(device_job_t *job)
+{
+    const cli_options_t *options = job->options;
 
+    if (job->lock.fd < 0)
+    {
+        return 0;
     }
 
-    /* Output results based on mode */
-    if (!options.quiet)
+    int result = jm_lock_acquire(&job->lock, JM_LOCK_DEFAULT_TIMEOUT_MS);
+    if (result < 0)
     {
-        switch (options.output_mode)
+        if (!options->quiet)
         {
-        case OUTPUT_MODE_SUMMARY:
-            format_summary(options.device_path, disk_data, num_disks,
-                           controller.found ? controller.model : NULL);
-            break;
-
-        case OUTPUT_MODE_FULL:
-            if (options.disk_number >= 0)
-            {
-                format_full_smart(&disk_data[options.disk_number]);
-            }
-            else
-            {
-                /* Show full for all disks */
-                for (int i = 0; i < 5; i++)
-                {
-                    if (disk_data[i].is_present)
-                    {
-                        format_full_smart(&disk_data[i]);
-                        printf("\n");
-                    }
-                }
-            }
-            break;
-
-        case OUTPUT_MODE_JSON:
-            format_json(options.device_path, disk_data, num_disks,
-                        options.expected_array_size, present_disks, is_degraded,
-                        controller.found ? controller.model : NULL);
-            break;
+            fprintf(stderr, "Error: Timed out waiting for another process using %s\n", job->device_path);
         }
+        return 3;
     }
 
-    /* Determine exit code based on health status */
-    exit_code = determine_exit_code(disk_data, num_disks);
+    /* Another process's cleanup may have left the controller idle */
+    if (result == 1)
+    {
+        job->need_wakeup = 1;
+    }
+    return 0;
+}
 
-    /* If RAID is degraded and all disks are healthy, return failed exit code */
-    if (is_degraded && exit_code == 0)
+/* --max-age: report a recent enough poll another run shared for this device
+ * Returns 1 if the job's poll was filled in */
+static int use_shared_result(device_job_t *job)
+{
+    const cli_options_t *options = job->options;
+    jm_result_entry_t entry;
+
+    if (options->max_age < 0 || !uses_device(options) ||
+        jm_result_load(options->run_dir, job->device_path, &entry) != 0)
     {
-        exit_code = 1; /* Failed: degraded RAID even though disks are healthy */
+        return 0;
     }
 
-    /* Show RAID array size warnings at end (after SMART data)
-     * Skip in JSON mode - warnings are included in JSON output */
-    if (options.expected_array_size > 0 && present_disks > 0 && !options.quiet &&
-        options.output_mode != OUTPUT_MODE_JSON)
+    int64_t age = (int64_t)time(NULL) - entry.timestamp;
+    if (age < 0 || age > options->max_age || entry.expected_array_size != options->expected_array_size)
     {
-        if (is_degraded)
+        return 0;
+    }
+
+    memset(&job->poll, 0, sizeof(job->poll));
+    if (options->disk_number >= 0)
+    {
+        /* A missing disk is an error only a real query should report */
+        if (!entry.disks[options->disk_number].is_present)
         {
-            /* Degraded: fewer disks than expected */
-            printf("\n");
-            printf("=======================================================================\n");
-            printf("WARNING: DEGRADED RAID ARRAY DETECTED\n");
-            printf("=======================================================================\n");
-            printf("Expected %d disk%s but found only %d disk%s.\n",
-                   options.expected_array_size, options.expected_array_size == 1 ? "" : "s",
-                   present_disks, present_disks == 1 ? "" : "s");
-            printf("One or more disks may have failed or been removed.\n");
-            printf("RAID array is operating in degraded mode with REDUCED or NO redundancy!\n");
-            printf("Replace failed disk(s) immediately to restore redundancy.\n");
-            printf("=======================================================================\n\n");
+            return 0;
         }
-        else if (present_disks > options.expected_array_size)
+        job->poll.disk_data[options->disk_number] = entry.disks[options->disk_number];
+        job->poll.num_disks = 1;
+    }
+    else
+    {
+        memcpy(job->poll.disk_data, entry.disks, sizeof(job->poll.disk_data));
+        job->poll.num_disks = entry.num_disks;
+        job->poll.is_degraded = entry.is_degraded;
+        job->poll.present_disks = entry.present_disks;
+    }
+
+    if (!job->controller.found && entry.controller_model[0] != '\0')
+    {
+        job->controller.found = 1;
+        snprintf(job->controller.model, sizeof(job->controller.model), "%s", entry.controller_model);
+    }
+
+    if (options->verbose)
+    {
+        printf("Using the poll of %s from %lld second%s ago (--max-age %d).\n", job->device_path,
+               (long long)age, age == 1 ? "" : "s", options->max_age);
+    }
+    return 1;
+}
+
+/* Share an all-disk poll for --max-age runs (best effort) */
+static void share_result(const device_job_t *job)
+{
+    const cli_options_t *options = job->options;
+    jm_result_entry_t entry;
+
+    if (options->disk_number >= 0 || options->flags_only || options->has_fields || !uses_device(options))
+    {
+        return;
+    }
+
+    memset(&entry, 0, sizeof(entry));
+    entry.timestamp = (int64_t)time(NULL);
+    entry.expected_array_size = options->expected_array_size;
+    entry.num_disks = job->poll.num_disks;
+    entry.is_degraded = job->poll.is_degraded;
+    entry.present_disks = job->poll.present_disks;
+    if (job->controller.found)
+    {
+        snprintf(entry.controller_model, sizeof(entry.controller_model), "%s", job->controller.model);
+    }
+    memcpy(entry.disks, job->poll.disk_data, sizeof(entry.disks));
+
+    if (jm_result_store(options->run_dir, job->device_path, &entry) != 0 && options->verbose)
+    {
+        fprintf(stderr, "Warning: Could not share the poll in %s\n", options->run_dir);
+    }
+}
+
+/* Worker: one complete single-shot query of an enclosure */
+static void *scan_device_worker(void *arg)
+{
+    device_job_t *job = arg;
+
+    if (use_shared_result(job))
+    {
+        job->status = 0;
+        return NULL;
+    }
+
+    job->status = lock_mailbox(job);
+    if (job->status != 0)
+    {
+        return NULL;
+    }
+
+    /* Runs queued behind the lock take the poll the holder just shared */
+    if (use_shared_result(job))
+    {
+        jm_lock_release(&job->lock);
+        return NULL;
+    }
+
+    job->status = open_device(job);
+    if (job->status == 0)
+    {
+        uint64_t start = phase_begin(job);
+        job->status = query_disks(&job->session, job->options, &job->poll);
+        phase_end(job, JM_PHASE_QUERY, start);
+        if (job->status == 0)
         {
-            /* More disks than expected */
-            printf("\n");
-            printf("=======================================================================\n");
-            printf("WARNING: MORE DISKS THAN EXPECTED\n");
-            printf("=======================================================================\n");
-            printf("Expected %d disk%s but found %d disk%s.\n",
-                   options.expected_array_size, options.expected_array_size == 1 ? "" : "s",
-                   present_disks, present_disks == 1 ? "" : "s");
-            printf("This may indicate:\n");
-            printf("  - Incorrect --array-size specified (check your array configuration)\n");
-            printf("  - Extra disk added to array\n");
-            printf("  - Array configuration changed\n");
-            printf("=======================================================================\n\n");
+            share_result(job);
         }
+        close_device(job);
     }
+    jm_lock_release(&job->lock);
+    return NULL;
+}
 
-    /* Clean up and restore sector */
-    if (options.verbose)
+/* Worker: one daemon-mode poll. The session stays open between polls; an
+ * enclosure that is not open (first cycle, failed open, or dropped after
+ * failed polls) is opened again first. */
+static void *poll_device_worker(void *arg)
+{
+    device_job_t *job = arg;
+    const cli_options_t *options = job->options;
+
+    job->status = lock_mailbox(job);
+    if (job->status != 0)
     {
-        printf("Restoring sector and closing device...\n");
+        job->error = "mailbox locked by another process";
+        return NULL;
     }
 
-    result = jm_cleanup_device(fd, options.sector);
-    if (result != JM_SUCCESS)
+    if (!job->opened)
+    {
+        job->status = open_device(job);
+        if (job->status != 0)
+        {
+            job->error = "cannot open device";
+            jm_lock_release(&job->lock);
+            return NULL;
+        }
+        job->failures = 0;
+    }
+
+    /* Command, ioctl and query figures cover this poll only; the setup
+     * phases keep what the initial open measured */
+    if (job->session.timings)
+    {
+        jm_timings_t *t = job->session.timings;
+        memset(t->commands, 0, sizeof(t->commands));
+        memset(&t->ioctl_write, 0, sizeof(t->ioctl_write));
+        memset(&t->ioctl_read, 0, sizeof(t->ioctl_read));
+        memset(&t->phases[JM_PHASE_QUERY], 0, sizeof(t->phases[JM_PHASE_QUERY]));
+    }
+
+    /* A failed poll may mean the controller dropped back to idle, as may
+     * another process's cleanup (lock_mailbox) */
+    if (job->need_wakeup)
+    {
+        if (options->verbose)
+        {
+            printf("Re-sending wakeup sequence to %s...\n", job->device_path);
+        }
+        uint64_t start = phase_begin(job);
+        int result = jm_wake(&job->session);
+        phase_end(job, JM_PHASE_WAKEUP, start);
+        if (result != JM_SUCCESS && !options->quiet)
+        {
+            fprintf(stderr, "Warning: Failed to wake up controller on %s: %s\n",
+                    job->device_path, jm_error_string(result));
+        }
+        job->need_wakeup = 0;
+    }
+
+    uint64_t start = phase_begin(job);
+    job->status = query_disks(&job->session, options, &job->poll);
+    phase_end(job, JM_PHASE_QUERY, start);
+    job->need_wakeup = (job->status != 0);
+    if (job->status == 0)
+    {
+        job->failures = 0;
+        share_result(job);
+    }
+    else
+    {
+        job->error = "poll failed";
+
+        /* An unplugged device keeps failing on its old fd, even once it is
+         * back: drop the session so the next cycle opens the device again */
+        if (++job->failures >= MAX_POLL_FAILURES || (uses_device(options) && access(job->device_path, F_OK) != 0))
+        {
+            close_device(job);
+            job->error = "not responding; reopening";
+        }
+    }
+    jm_lock_release(&job->lock);
+    return NULL;
+}
+
+/* --sample state of one enclosure (allocated by the worker: the rings are large) */
+typedef struct
+{
+    jm_sample_ring_t rings[5];
+    uint32_t errors[5]; // Failed reads in the current window
+    int max_seen[5]; // Hottest reading of the whole run (-1 = none)
+    time_t window_start;
+} sample_state_t;
+
+/* Print the summary of the current window, from a sampling worker thread */
+static void report_samples(const device_job_t *job, const sample_state_t *state, time_t end)
+{
+    const cli_options_t *options = job->options;
+    char from[32], to[32];
+
+    if (options->quiet)
+    {
+        return;
+    }
+    strftime(from, sizeof(from), "%Y-%m-%dT%H:%M:%SZ", gmtime(&state->window_start));
+    strftime(to, sizeof(to), "%Y-%m-%dT%H:%M:%SZ", gmtime(&end));
+
+    if (options->output_mode == OUTPUT_MODE_JSON)
+    {
+        /* One write() per record, so concurrent enclosures' lines never interleave */
+        json_writer_t w;
+        json_writer_init(&w, 0);
+        json_begin_object(&w, NULL);
+        json_write_string(&w, "device", job->device_path);
+        json_write_string(&w, "sample", "temperature");
+        json_write_string(&w, "start", from);
+        json_write_string(&w, "end", to);
+        json_write_double(&w, "rate_hz", options->sample_rate, -1);
+        json_begin_array(&w, "disks");
+        for (int i = 0; i < 5; i++)
+        {
+            const disk_smart_data_t *disk = &job->poll.disk_data[i];
+            jm_sample_stats_t stats;
+            if (!disk->is_present)
+            {
+                continue;
+            }
+            json_begin_object(&w, NULL);
+            json_write_int(&w, "disk_number", i);
+            json_write_string(&w, "model", disk->disk_name);
+            json_write_string(&w, "serial", disk->serial_number);
+            if (jm_sample_ring_stats(&state->rings[i], &stats) == 0)
+            {
+                json_write_uint(&w, "samples", stats.count);
+                json_write_uint(&w, "errors", state->errors[i]);
+                json_write_int(&w, "min", stats.min);
+                json_write_int(&w, "max", stats.max);
+                json_write_double(&w, "mean", stats.mean, 2);
+                json_write_int(&w, "p99", stats.p99);
+            }
+            else
+            {
+                json_write_uint(&w, "samples", 0);
+                json_write_uint(&w, "errors", state->errors[i]);
+            }
+            json_end(&w);
+        }
+        json_end(&w);
+        json_end(&w);
+        json_writer_flush(&w, stdout);
+        json_writer_free(&w);
+        return;
+    }
+
+    /* Workers of several enclosures report concurrently; keep each report whole */
+    flockfile(stdout);
+    printf("%s: temperature %s to %s (%g Hz)\n", job->device_path, from, to, options->sample_rate);
+    for (int i = 0; i < 5; i++)
+    {
+        const disk_smart_data_t *disk = &job->poll.disk_data[i];
+        jm_sample_stats_t stats;
+        if (!disk->is_present)
+        {
+            continue;
+        }
+        printf("  Disk %d (%s): ", i, disk->serial_number[0] ? disk->serial_number : "unknown serial");
+        if (jm_sample_ring_stats(&state->rings[i], &stats) == 0)
+        {
+            printf("%u samples, min %d, max %d, mean %.1f, p99 %d C", stats.count, stats.min, stats.max,
+                   stats.mean, stats.p99);
+        }
+        else
+        {
+            printf("no samples");
+        }
+        if (state->errors[i] > 0)
+        {
+            printf(" (%u failed read%s)", state->errors[i], state->errors[i] == 1 ? "" : "s");
+        }
+        printf("\n");
+    }
+    fflush(stdout);
+    funlockfile(stdout);
+}
+
+/* Find the disks to sample: the --disk slot, or every slot the presence
+ * bitmask marks; one IDENTIFY each for the model and serial
+ * Returns 0 on success, 3 on error (already reported) */
+static int identify_sample_disks(device_job_t *job)
+{
+    const cli_options_t *options = job->options;
+    jm_raid_flags_t flags;
+    int found = 0;
+
+    memset(&job->poll, 0, sizeof(job->poll));
+    if (options->disk_number < 0 && jm_get_raid_flags(&job->session, &flags) != 0)
+    {
+        if (!options->quiet)
+        {
+            fprintf(stderr, "Error: Failed to read RAID flags from %s\n", job->device_path);
+        }
+        return 3;
+    }
+
+    for (int i = 0; i < 5; i++)
+    {
+        disk_smart_data_t *disk = &job->poll.disk_data[i];
+        int wanted = options->disk_number >= 0 ? (i == options->disk_number) : (flags.presence & (1u << i)) != 0;
+        if (!wanted)
+        {
+            continue;
+        }
+        if (jm_get_disk_identify(&job->session, i, disk->disk_name, disk->serial_number, disk->firmware_rev,
+                                 &disk->size_mb, NULL) == 0)
+        {
+            disk->disk_number = i;
+            disk->is_present = 1;
+            found++;
+        }
+    }
+
+    if (found == 0)
+    {
+        if (!options->quiet)
+        {
+            fprintf(stderr, "Error: No disk to sample on %s\n", job->device_path);
+        }
+        return 3;
+    }
+    return 0;
+}
+
+/* One sampling tick: a SMART READ VALUES (0xD0) per sampled disk, nothing else */
+static void sample_tick(device_job_t *job, sample_state_t *state)
+{
+    if (lock_mailbox(job) != 0)
+    {
+        for (int i = 0; i < 5; i++)
+        {
+            state->errors[i] += job->poll.disk_data[i].is_present;
+        }
+        return;
+    }
+
+    if (job->need_wakeup)
+    {
+        jm_wake(&job->session);
+        job->need_wakeup = 0;
+    }
+
+    for (int i = 0; i < 5; i++)
+    {
+        smart_values_page_t values;
+        int temp;
+
+        if (!job->poll.disk_data[i].is_present)
+        {
+            continue;
+        }
+        if (jm_smart_read_values(&job->session, i, &values) != 0)
+        {
+            state->errors[i]++;
+            job->need_wakeup = 1;
+            continue;
+        }
+        temp = jm_sample_temperature(&values);
+        if (temp < 0)
+        {
+            state->errors[i]++;
+            continue;
+        }
+        jm_sample_ring_add(&state->rings[i], (uint8_t)temp);
+        if (temp > state->max_seen[i])
+        {
+            state->max_seen[i] = temp;
+        }
+    }
+    jm_lock_release(&job->lock);
+}
+
+/* Worker: --sample temp on one enclosure for --duration seconds, reporting
+ * each --window (or once at the end). The status is the exit code: 1 if a
+ * reading reached the temperature limit. */
+static void *sample_device_worker(void *arg)
+{
+    device_job_t *job = arg;
+    const cli_options_t *options = job->options;
+    const smart_config_t *config = smart_get_config();
+    int limit = config ? config->rules[0xC2].temp_critical : CONFIG_DEFAULT_TEMP_CRITICAL;
+    sample_state_t *state;
+
+    job->status = lock_mailbox(job);
+    if (job->status != 0)
+    {
+        return NULL;
+    }
+    job->status = open_device(job);
+    if (job->status == 0)
+    {
+        job->status = identify_sample_disks(job);
+    }
+    jm_lock_release(&job->lock);
+
+    state = job->status == 0 ? calloc(1, sizeof(*state)) : NULL;
+    if (state == NULL)
+    {
+        if (job->status == 0 && !options->quiet)
+        {
+            fprintf(stderr, "Error: Out of memory\n");
+        }
+        job->status = 3;
+    }
+    else
+    {
+        /* Ticks are scheduled on absolute deadlines, so read latency doesn't drift the rate */
+        long period_ns = (long)(1e9 / options->sample_rate);
+        long long total = (long long)(options->sample_duration * options->sample_rate);
+        struct timespec next;
+        time_t window_end;
+
+        for (int i = 0; i < 5; i++)
+        {
+            state->max_seen[i] = -1;
+        }
+        state->window_start = time(NULL);
+        window_end = options->sample_window > 0 ? state->window_start + options->sample_window : 0;
+        clock_gettime(CLOCK_MONOTONIC, &next);
+
+        if (total < 1)
+        {
+            total = 1;
+        }
+        for (long long tick = 0; tick < total; tick++)
+        {
+            sample_tick(job, state);
+
+            time_t now = time(NULL);
+            if (window_end != 0 && now >= window_end)
+            {
+                report_samples(job, state, now);
+                for (int i = 0; i < 5; i++)
+                {
+                    jm_sample_ring_reset(&state->rings[i]);
+                    state->errors[i] = 0;
+                }
+                state->window_start = now;
+                window_end = now + options->sample_window;
+            }
+
+            if (tick + 1 == total)
+            {
+                break;
+            }
+            next.tv_nsec += period_ns;
+            while (next.tv_nsec >= 1000000000L)
+            {
+                next.tv_nsec -= 1000000000L;
+                next.tv_sec++;
+            }
+            sleep_until(&next);
+        }
+
+        /* The whole run, or what the last window got before the end */
+        int pending = window_end == 0;
+        for (int i = 0; i < 5; i++)
+        {
+            pending |= state->rings[i].count > 0 || state->errors[i] > 0;
+        }
+        if (pending)
+        {
+            report_samples(job, state, time(NULL));
+        }
+
+        for (int i = 0; i < 5; i++)
+        {
+            if (state->max_seen[i] >= limit)
+            {
+                job->status = 1;
+            }
+        }
+        free(state);
+    }
+
+    if (job->opened)
+    {
+        int locked = lock_mailbox(job) == 0;
+        close_device(job);
+        if (locked)
+        {
+            jm_lock_release(&job->lock);
+        }
+    }
+    return NULL;
+}
+
+/* Worker: --find-sector on one device. Holds the mailbox lock so a poll in
+ * progress elsewhere does not show up as data in the configured sector. */
+static void *find_sector_worker(void *arg)
+{
+    device_job_t *job = arg;
+
+    job->status = lock_mailbox(job);
+    if (job->status != 0)
+    {
+        return NULL;
+    }
+    job->num_empty = jm_find_empty_sectors(job->device_path, &job->empty_sectors);
+    jm_lock_release(&job->lock);
+
+    if (job->num_empty < 0)
+    {
+        if (!job->options->quiet)
+        {
+            fprintf(stderr, "Error: Cannot read sectors of %s\n", job->device_path);
+        }
+        job->status = 3;
+    }
+    return NULL;
+}
+
+/* Print a --find-sector result
+ * Returns 1 if the configured sector holds data, 0 if it is empty */
+static int report_sectors(const cli_options_t *options, const device_job_t *job)
+{
+    if (!options->quiet || options->json_line)
+    {
+        if (options->output_mode == OUTPUT_MODE_JSON)
+        {
+            format_sectors_json(job->device_path, options->sector, &job->empty_sectors, job->num_empty,
+                                options->json_line);
+        }
+        else
+        {
+            format_sectors(job->device_path, options->sector, &job->empty_sectors, job->num_empty);
+        }
+        fflush(stdout);
+    }
+    return jm_sector_map_test(&job->empty_sectors, options->sector) ? 0 : 1;
+}
+
+/* Run a worker for every job. Each enclosure is bound by its own USB latency,
+ * so they run concurrently and the total time is that of the slowest one.
+ * A single job runs on the calling thread. */
+static void run_jobs(device_job_t *jobs, int num_jobs, void *(*worker)(void *))
+{
+    pthread_t threads[MAX_DEVICES];
+    int started[MAX_DEVICES];
+
+    if (num_jobs == 1)
+    {
+        worker(&jobs[0]);
+        return;
+    }
+
+    for (int i = 0; i < num_jobs; i++)
+    {
+        /* Fall back to running inline if a thread can't be created */
+        started[i] = (pthread_create(&threads[i], NULL, worker, &jobs[i]) == 0);
+        if (!started[i])
+        {
+            worker(&jobs[i]);
+        }
+    }
+
+    for (int i = 0; i < num_jobs; i++)
+    {
+        if (started[i])
+        {
+            pthread_join(threads[i], NULL);
+        }
+    }
+}
+
+/* Combine per-device exit codes: a detected failure outranks an error on
+ * another device, which outranks healthy */
+static int combine_exit_codes(int a, int b)
+{
+    if (a == 1 || b == 1)
+        return 1;
+    if (a == 3 || b == 3)
+        return 3;
+    return 0;
+}
+
+/* Report every job in command-line order; returns the combined exit code */
+static int report_jobs(const cli_options_t *options, const device_job_t *jobs, int num_jobs)
+{
+    int exit_code = 0;
+
+    for (int i = 0; i < num_jobs; i++)
+    {
+        int code = (jobs[i].status == 0) ? report_results(options, &jobs[i]) : 3;
+        exit_code = combine_exit_codes(exit_code, code);
+    }
+    return exit_code;
+}
+
+/* Daemon mode: report a job that could not be polled this cycle. JSON
+ * output gets an error document, so --json-only consumers see the enclosure
+ * is down rather than just missing its line. */
+static void report_poll_error(const cli_options_t *options, const device_job_t *job)
+{
+    const char *controller_model = job->controller.found ? job->controller.model : NULL;
+
+    if (options->output_mode == OUTPUT_MODE_JSON)
+    {
+        format_json_error(job->device_path, controller_model, job->error,
+                          options->json_line || options->binary);
+    }
+    else if (!options->quiet)
+    {
+        fprintf(stderr, "Error: %s: %s; retrying in %d s\n", job->device_path, job->error, options->interval);
+    }
+}
+
+/* Daemon mode: sessions opened on the first cycle stay open and the signal
+ * handlers stay installed, so each cycle only re-runs the SMART queries.
+ * An enclosure that could not be opened, or stopped answering, is reported
+ * every cycle and opened again on the next one. An edited --config file is
+ * picked up between cycles without touching the sessions. Runs until a
+ * signal terminates the process (the handler restores every sector). */
+static void run_daemon(const cli_options_t *options, device_job_t *jobs, int num_jobs)
+{
+    struct timespec next;
+    config_watch_t *watch = NULL;
+
+    if (options->config_path[0] != '\0')
+    {
+        watch = config_watch_start(options->config_path);
+        if (watch == NULL && !options->quiet)
+        {
+            fprintf(stderr, "Warning: Cannot watch %s; config changes need a restart\n", options->config_path);
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &next);
+
+    while (1)
+    {
+        /* No worker is running, so the old policy can go */
+        const smart_config_t *reloaded = config_watch_swap(watch);
+        if (reloaded != NULL)
+        {
+            for (int i = 0; i < num_jobs; i++)
+            {
+                jobs[i].session.warm_probe = config_warm_probe(reloaded, jobs[i].device_path);
+            }
+            if (!options->quiet)
+            {
+                fprintf(stderr, "Reloaded config from %s\n", options->config_path);
+            }
+        }
+
+        run_jobs(jobs, num_jobs, poll_device_worker);
+
+        for (int i = 0; i < num_jobs; i++)
+        {
+            if (jobs[i].status == 0)
+            {
+                report_results(options, &jobs[i]);
+            }
+            else
+            {
+                report_poll_error(options, &jobs[i]);
+            }
+        }
+        fflush(stdout);
+
+        /* A cycle that overran the interval skips the ticks it missed
+         * instead of polling back to back until it catches up */
+        struct timespec now;
+        next.tv_sec += options->interval;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (next.tv_sec < now.tv_sec || (next.tv_sec == now.tv_sec && next.tv_nsec < now.tv_nsec))
+        {
+            next = now;
+            next.tv_sec += options->interval;
+        }
+        sleep_until(&next);
+    }
+}
+
+/* Find a device in a detection cache list (NULL if absent or stale) */
+static const jm_scan_entry_t *find_cached_entry(const jm_scan_entry_t *entries, int num_entries,
+                                                const char *device_path)
+{
+    for (int i = 0; i < num_entries; i++)
+    {
+        if (strcmp(entries[i].device_path, device_path) == 0)
+        {
+            return scan_entry_is_current(JM_SYSFS_ROOT, &entries[i]) ? &entries[i] : NULL;
+        }
+    }
+    return NULL;
+}
+
+/* --scan: fill the device list with every device behind a JMicron controller.
+ * With --cache the previous scan is reused while /sys/block lists the same
+ * devices and each entry still checks out, so no sysfs walk is needed.
+ * Returns the number of devices, or -1 if sysfs can't be read. */
+static int scan_devices(cli_options_t *options, jm_scan_entry_t *found)
+{
+    static jm_scan_entry_t cached[MAX_DETECT_CACHE];
+    uint32_t listing_hash = block_listing_hash(JM_SYSFS_ROOT);
+    int count = -1;
+
+    if (options->cache_dir[0] != '\0')
+    {
+        uint32_t stored_hash = 0;
+        int num_cached = jm_detect_cache_load(options->cache_dir, cached, MAX_DETECT_CACHE, &stored_hash);
+        if (num_cached >= 0 && stored_hash != 0 && stored_hash == listing_hash)
+        {
+            count = 0;
+            for (int i = 0; i < num_cached && count >= 0; i++)
+            {
+                if (!is_jmicron_entry(&cached[i]))
+                {
+                    continue;
+                }
+                if (count >= MAX_DEVICES || !scan_entry_is_current(JM_SYSFS_ROOT, &cached[i]))
+                {
+                    count = -1; /* Stale - fall back to a full scan */
+                    break;
+                }
+                found[count++] = cached[i];
+            }
+        }
+        if (options->verbose)
+        {
+            printf("Scan cache %s\n", count >= 0 ? "hit" : "miss");
+        }
+    }
+
+    if (count < 0)
+    {
+        count = scan_jmicron_devices(JM_SYSFS_ROOT, found, MAX_DEVICES);
+        if (count >= 0 && options->cache_dir[0] != '\0' &&
+            jm_detect_cache_store(options->cache_dir, listing_hash, found, count) != 0 && options->verbose)
+        {
+            fprintf(stderr, "Warning: Could not write detection cache in %s\n", options->cache_dir);
+        }
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        /* device_path is far shorter than device_paths[], so this never truncates */
+        snprintf(options->device_paths[i], sizeof(options->device_paths[0]), "%.*s",
+                 (int)sizeof(found[i].device_path) - 1, found[i].device_path);
+        if (options->verbose)
+        {
+            printf("Found %s behind %s (%04x:%04x)\n", found[i].device_path, found[i].controller.model,
+                   found[i].controller.vendor_id, found[i].controller.device_id);
+        }
+    }
+    options->num_devices = (count > 0) ? count : 0;
+    return count;
+}
+
+/* --cache without --scan: take each device's controller from the detection
+ * cache when its entry is current, otherwise probe sysfs once and add it */
+static void prefill_detection(const cli_options_t *options, device_job_t *jobs, int num_jobs)
+{
+    static jm_scan_entry_t cached[MAX_DETECT_CACHE];
+    uint32_t stored_hash = 0;
+    int changed = 0;
+
+    int num_cached = jm_detect_cache_load(options->cache_dir, cached, MAX_DETECT_CACHE, &stored_hash);
+    if (num_cached < 0)
+    {
+        num_cached = 0;
+    }
+
+    for (int i = 0; i < num_jobs; i++)
+    {
+        device_job_t *job = &jobs[i];
+        uint64_t start = phase_begin(job);
+        const jm_scan_entry_t *entry = find_cached_entry(cached, num_cached, job->device_path);
+        const char *name = strrchr(job->device_path, '/');
+        jm_scan_entry_t probed;
+
+        if (entry == NULL && name != NULL && probe_block_device(JM_SYSFS_ROOT, name + 1, &probed) == 0)
+        {
+            /* Replace a stale entry for this device, or append */
+            int slot = 0;
+            while (slot < num_cached && strcmp(cached[slot].device_path, probed.device_path) != 0)
+            {
+                slot++;
+            }
+            if (slot < MAX_DETECT_CACHE)
+            {
+                cached[slot] = probed;
+                num_cached += (slot == num_cached);
+                entry = &cached[slot];
+                changed = 1;
+            }
+        }
+
+        if (entry != NULL)
+        {
+            job->controller = entry->controller;
+            job->detected = 1;
+            phase_end(job, JM_PHASE_DETECT, start);
+        }
+    }
+
+    /* A full scan's list stays complete only while /sys/block is unchanged */
+    if (changed)
+    {
+        uint32_t listing_hash = (stored_hash == block_listing_hash(JM_SYSFS_ROOT)) ? stored_hash : 0;
+        if (jm_detect_cache_store(options->cache_dir, listing_hash, cached, num_cached) != 0 && options->verbose)
+        {
+            fprintf(stderr, "Warning: Could not write detection cache in %s\n", options->cache_dir);
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    cli_options_t options;
+    static device_job_t jobs[MAX_DEVICES];
+    int exit_code = 0;
+
+    /* Parse command-line arguments */
+    if (parse_arguments(argc, argv, &options) != 0)
+    {
+        return 3;
+    }
+
+    /* Handle --write-default-config (write config and exit) */
+    if (options.write_default_config_path[0] != '\0')
+    {
+        return (config_write_default(options.write_default_config_path) == 0) ? 0 : 3;
+    }
+
+    /* Load config if specified, otherwise use defaults */
+    smart_config_t config;
+    if (options.config_path[0] != '\0')
+    {
+        if (config_load(options.config_path, &config) != 0)
+        {
+            if (!options.quiet)
+            {
+                fprintf(stderr, "Error: Failed to load config from %s\n", options.config_path);
+            }
+            return 3;
+        }
+        if (options.verbose)
+        {
+            printf("Loaded config from: %s\n", options.config_path);
+        }
+    }
+    else
+    {
+        /* No config file specified - use defaults */
+        config_init_default(&config);
+    }
+
+    /* Set global config for SMART assessment */
+    smart_set_config(&config);
+    format_set_fields(options.has_fields ? &options.fields : NULL);
+
+    /* Validate sector is in safe range */
+    if (!jm_sector_in_safe_range(options.sector))
     {
         if (!options.quiet)
         {
-            fprintf(stderr, "Warning: Failed to restore original sector data\n");
+            fprintf(stderr, "Error: Sector %u is in an unsafe range\n", options.sector);
+            fprintf(stderr, "\n");
+            fprintf(stderr, "  Unsafe ranges:\n");
+            fprintf(stderr, "  - Sectors 0-32, 34-63: MBR, partition table, GPT, boot loaders\n");
+            fprintf(stderr, "  - Sector 2048+: Typical first partition location\n");
+            fprintf(stderr, "\n");
+            fprintf(stderr, "  Safe range: 33 (0x21, original default), 64-2047\n");
+            fprintf(stderr, "  Recommended: Use default (33) or pick an empty one with --find-sector\n");
+            fprintf(stderr, "\n");
+            fprintf(stderr, "  See SECTOR_USAGE.md for details.\n");
+        }
+        return 3;
+    }
+
+    /* Set verbose mode environment variable for protocol layer */
+    if (options.verbose)
+    {
+        setenv("JMRAIDSTATUS_VERBOSE", "1", 1);
+    }
+
+    /* --scan: the devices come from sysfs (or the detection cache) */
+    static jm_scan_entry_t scanned[MAX_DEVICES];
+    uint64_t scan_us = 0;
+    if (options.scan)
+    {
+        uint64_t start = jm_monotonic_us();
+        int found = scan_devices(&options, scanned);
+        scan_us = jm_monotonic_us() - start;
+        if (found <= 0)
+        {
+            if (!options.quiet)
+            {
+                fprintf(stderr, "Error: %s\n", found < 0 ? "Cannot read /sys/block"
+                                                        : "No devices found behind a JMicron controller");
+            }
+            return 3;
+        }
+        if (options.num_devices > 1 && options.output_mode == OUTPUT_MODE_JSON)
+        {
+            options.json_line = 1;
         }
     }
 
+    /* One job (and controller session) per enclosure */
+    for (int i = 0; i < options.num_devices; i++)
+    {
+        device_job_t *job = &jobs[i];
+        job->options = &options;
+        job->device_path = options.device_paths[i];
+        jm_session_init(&job->session, options.sector);
+        job->session.verbose = options.verbose;
+        job->session.dump_raw = options.dump_raw;
+        job->session.expected_array_size = options.expected_array_size;
+        job->session.cache_dir = options.cache_dir[0] ? options.cache_dir : NULL;
+        job->session.timings = options.timings ? &job->timings : NULL;
+        job->session.max_retries = options.retries;
+        /* A replay must see the recorded wakeup */
+        job->session.warm_probe = options.replay_path[0] == '\0' && config_warm_probe(&config, job->device_path);
+        if (options.has_fields)
+        {
+            job->session.reads = (options.fields.values ? JM_READ_VALUES : 0) |
+                                 (options.fields.thresholds ? JM_READ_THRESHOLDS : 0);
+        }
+
+        /* Without a run directory (e.g. not root) the mailbox is used unlocked */
+        jm_lock_init(&job->lock);
+        if (uses_device(&options) &&
+            jm_lock_open(&job->lock, options.run_dir, job->device_path) != 0 && options.verbose)
+        {
+            fprintf(stderr, "Warning: No mailbox lock for %s in %s; not locking\n",
+                    job->device_path, options.run_dir);
+        }
+
+        if (options.scan)
+        {
+            job->controller = scanned[i].controller;
+            job->detected = 1;
+            if (job->session.timings)
+            {
+                jm_latency_add(&job->timings.phases[JM_PHASE_DETECT], scan_us);
+            }
+        }
+    }
+
+    if (!options.scan && options.cache_dir[0] != '\0' && !options.force &&
+        uses_device(&options) && !is_wsl())
+    {
+        prefill_detection(&options, jobs, options.num_devices);
+    }
+
+    if (options.find_sector)
+    {
+        run_jobs(jobs, options.num_devices, find_sector_worker);
+        for (int i = 0; i < options.num_devices; i++)
+        {
+            int code = (jobs[i].status == 0) ? report_sectors(&options, &jobs[i]) : 3;
+            exit_code = combine_exit_codes(exit_code, code);
+        }
+        config_free(&config);
+        return exit_code;
+    }
+
+    if (options.sample)
+    {
+        run_jobs(jobs, options.num_devices, sample_device_worker);
+        for (int i = 0; i < options.num_devices; i++)
+        {
+            exit_code = combine_exit_codes(exit_code, jobs[i].status);
+        }
+        config_free(&config);
+        return exit_code;
+    }
+
+    if (options.daemon)
+    {
+        if (options.verbose)
+        {
+            printf("Entering daemon mode (polling every %d second%s)...\n",
+                   options.interval, options.interval == 1 ? "" : "s");
+        }
+        run_daemon(&options, jobs, options.num_devices); /* Does not return */
+    }
+
+    /* Query each enclosure on its own thread, then report in argument order */
+    run_jobs(jobs, options.num_devices, scan_device_worker);
+    exit_code = report_jobs(&options, jobs, options.num_devices);
+
     /* Free config resources */
     config_free(&config);
 
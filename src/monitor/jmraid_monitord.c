@@ -0,0 +1,1050 @@
+/*
+ * jmraid_monitord.c - Event-driven JMicron RAID monitor
+ *
+ * Copyright (C) 2026 Jamie Treworgy
+ * SPDX-License-Identifier: MIT
+ *
+ * Usage: jmraid-monitord [OPTIONS] DEVICE...
+ * Keeps a controller session open per enclosure and listens for kernel
+ * block device uevents (or, where netlink is unavailable, /dev inotify
+ * events), so an enclosure that disappears or appears is reported at once
+ * instead of at the next poll. The RAID flags (one IDENTIFY round trip) are
+ * polled every --flags-interval seconds and the full SMART data every
+ * --smart-interval seconds. One line is printed per event.
+ *
+ * With --listen, the state from the last polls is also served as
+ * Prometheus metrics. Scrapes are answered from a snapshot rendered after
+ * each poll, so they never touch the controller however many there are,
+ * and served on the metrics server's thread, so they never wait for a poll.
+ */
+
+#define JSMN_HEADER  /* jsmn declarations only (via common.h) */
+#include "../jm_protocol.h"
+#include "../jm_commands.h"
+#include "../jm_history.h"
+#include "../jm_cache.h"
+#include "../jm_lock.h"
+#include "../jm_device.h"
+#include "../hardware_detect.h"
+#include "../config.h"
+#include "../config_watch.h"
+#include "../smart_parser.h"
+#include "../smart_attributes.h"
+#include "../jm_timings.h"
+#include "../parsers/common.h"
+#include "metrics_server.h"
+#include <errno.h>
+#include <getopt.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/netlink.h>
+#include <sys/inotify.h>
+#include <sys/socket.h>
+
+#define MAX_DEVICES 32
+#define DEFAULT_FLAGS_INTERVAL 60
+#define DEFAULT_SMART_INTERVAL 3600
+#define DEFAULT_SECTOR 33
+#define MAX_POLL_FAILURES 3             /* Consecutive failed polls before "disconnected" */
+#define UEVENT_BUFFER_SIZE 8192
+
+/* CLI options */
+typedef struct {
+    const char* devices[MAX_DEVICES];
+    int num_devices;
+    int flags_interval;                 /* --flags-interval: seconds between RAID flag polls */
+    int smart_interval;                 /* --smart-interval: seconds between SMART polls */
+    const char* history_path;           /* --history: record SMART polls, report their changes */
+    const char* exec_cmd;               /* --exec: also pipe each event line to this command */
+    const char* listen_address;         /* --listen: serve /metrics on [ADDR:]PORT */
+    const char* config_path;
+    const char* run_dir;                /* Mailbox locks and shared polls */
+    uint32_t sector;
+    int force;
+    int json;
+    int verbose;
+} cli_options_t;
+
+/* One watched enclosure */
+typedef struct {
+    const char* path;                   /* As given (may be a symlink) */
+    char name[NAME_MAX + 1];            /* Kernel name (sdc) once resolved */
+    jm_device_t device;                 /* Session and mailbox lock */
+    int opened;
+    int open_failed;                    /* Last open failed (its error was reported) */
+    int failures;                       /* Consecutive failed polls */
+    int has_flags;
+    jm_raid_flags_t flags;              /* From the last flags poll */
+    int smart_status;                   /* Last SMART verdict, -1 = none yet */
+    uint64_t next_flags_us;
+    uint64_t next_smart_us;
+
+    /* Last poll results and latency, for --listen */
+    int has_smart;
+    disk_smart_data_t disks[5];
+    int64_t flags_time;                 /* Unix time of the last flags poll */
+    int64_t smart_time;
+    uint64_t poll_failures;
+    jm_histogram_t poll_latency[2];     /* POLL_FLAGS, POLL_SMART */
+    jm_timings_t timings;               /* device.session.timings: per-command latency */
+} monitor_device_t;
+
+enum { POLL_FLAGS = 0, POLL_SMART = 1 };
+
+typedef struct {
+    const cli_options_t* options;
+    monitor_device_t devices[MAX_DEVICES];
+    int num_devices;
+    int event_fd;                       /* Netlink uevent socket or inotify descriptor */
+    int inotify;                        /* event_fd is inotify on /dev */
+    config_watch_t* config_watch;       /* --config: reloaded when the file changes */
+    metrics_server_t metrics;           /* --listen */
+    int metrics_stale;                  /* A poll or event since the last render */
+} monitor_t;
+
+/* Helper: Current wall-clock time for event lines */
+static void format_now(char* buf, size_t size) {
+    time_t now = time(NULL);
+    struct tm tm_info;
+    gmtime_r(&now, &tm_info);
+    strftime(buf, size, "%Y-%m-%dT%H:%M:%SZ", &tm_info);
+}
+
+/**
+ * Print one event line and hand it to --exec
+ */
+static void emit_line(const monitor_t* m, const char* line) {
+    fputs(line, stdout);
+    fflush(stdout);
+
+    if (m->options->exec_cmd != NULL) {
+        FILE* p = popen(m->options->exec_cmd, "w");
+        if (p == NULL) {
+            fprintf(stderr, "Warning: Cannot run %s\n", m->options->exec_cmd);
+            return;
+        }
+        fputs(line, p);
+        pclose(p);
+    }
+}
+
+/**
+ * Print a JSON event built in w, as one line, and free the writer
+ */
+static void emit_json_event(const monitor_t* m, json_writer_t* w) {
+    char* line = NULL;
+    size_t len = 0;
+    FILE* out = open_memstream(&line, &len);
+
+    if (out != NULL) {
+        int ok = json_writer_flush(w, out) == 0;
+        fclose(out);
+        if (ok) {
+            emit_line(m, line);
+        }
+        free(line);
+    }
+    json_writer_free(w);
+}
+
+/**
+ * Open a JSON event object with its name, time and device
+ */
+static void begin_json_event(json_writer_t* w, const monitor_device_t* dev, const char* event,
+                             const char* when) {
+    json_writer_init(w, 0);
+    json_begin_object(w, NULL);
+    json_write_string(w, "event", event);
+    json_write_string(w, "time", when);
+    json_write_string(w, "device", dev->path);
+}
+
+/**
+ * Print a device event ("connected", ...) with an optional detail
+ */
+static void emit_event(const monitor_t* m, const monitor_device_t* dev, const char* event,
+                       const char* detail) {
+    char when[32], line[512];
+    format_now(when, sizeof(when));
+
+    if (m->options->json) {
+        json_writer_t w;
+        begin_json_event(&w, dev, event, when);
+        if (detail != NULL) {
+            json_write_string(&w, "detail", detail);
+        }
+        json_end(&w);
+        emit_json_event(m, &w);
+        return;
+    }
+
+    snprintf(line, sizeof(line), "%s %s %s%s%s%s\n", when, dev->path, event,
+             detail ? " (" : "", detail ? detail : "", detail ? ")" : "");
+    emit_line(m, line);
+}
+
+/* Helper: One side of a flags change as {"presence":..,"rebuild":..,"phase":..} */
+static void write_flags_json(json_writer_t* w, const char* key, const jm_raid_flags_t* flags) {
+    json_begin_object(w, key);
+    json_write_uint(w, "presence", flags->presence);
+    json_write_uint(w, "rebuild", flags->rebuild);
+    json_write_uint(w, "phase", flags->phase);
+    json_end(w);
+}
+
+/**
+ * Print a RAID flags change (presence bitmask, rebuild and phase bytes)
+ */
+static void emit_flags(const monitor_t* m, const monitor_device_t* dev, const jm_raid_flags_t* from,
+                       const jm_raid_flags_t* to) {
+    char when[32], raw[3 * sizeof(to->raw)], line[512];
+    format_now(when, sizeof(when));
+    for (size_t i = 0; i < sizeof(to->raw); i++) {
+        snprintf(raw + 3 * i, sizeof(raw) - 3 * i, i ? " %02x" : "%02x", to->raw[i]);
+    }
+
+    if (m->options->json) {
+        json_writer_t w;
+        begin_json_event(&w, dev, "flags", when);
+        if (from != NULL) {
+            write_flags_json(&w, "from", from);
+        } else {
+            json_write_null(&w, "from");
+        }
+        write_flags_json(&w, "to", to);
+        json_write_string(&w, "raw", raw);
+        json_end(&w);
+        emit_json_event(m, &w);
+        return;
+    }
+
+    if (from != NULL) {
+        snprintf(line, sizeof(line),
+                 "%s %s flags: presence 0x%02x -> 0x%02x, rebuild 0x%02x -> 0x%02x, phase 0x%02x -> 0x%02x\n",
+                 when, dev->path, from->presence, to->presence, from->rebuild, to->rebuild,
+                 from->phase, to->phase);
+    } else {
+        snprintf(line, sizeof(line), "%s %s flags: presence 0x%02x, rebuild 0x%02x, phase 0x%02x (%s)\n",
+                 when, dev->path, to->presence, to->rebuild, to->phase, raw);
+    }
+    emit_line(m, line);
+}
+
+/* jm_history_change_fn: a SMART change, formatted like --changed-since */
+static void emit_change(void* ctx, const jm_history_change_t* change) {
+    const monitor_t* m = ctx;
+    char* line = NULL;
+    size_t len = 0;
+    FILE* out = open_memstream(&line, &len);
+
+    if (out == NULL) {
+        return;
+    }
+    jm_history_write_change(out, change, m->options->json);
+    fclose(out);
+    emit_line(m, line);
+    free(line);
+}
+
+/* Helper: Kernel device name of a path, following symlinks (0 if it doesn't exist) */
+static int resolve_name(monitor_device_t* dev) {
+    char real[PATH_MAX];
+    if (realpath(dev->path, real) == NULL) {
+        return 0;
+    }
+    const char* base = strrchr(real, '/');
+    snprintf(dev->name, sizeof(dev->name), "%.*s", (int)sizeof(dev->name) - 1, base ? base + 1 : real);
+    return 1;
+}
+
+/* Helper: Report why an open failed, unless the previous attempt failed too */
+static void __attribute__((format(printf, 2, 3))) open_error(const monitor_device_t* dev, const char* fmt, ...) {
+    va_list ap;
+    if (dev->open_failed) {
+        return;
+    }
+    va_start(ap, fmt);
+    fputs("Error: ", stderr);
+    vfprintf(stderr, fmt, ap);
+    fputc('\n', stderr);
+    va_end(ap);
+}
+
+/* Helper: Take the mailbox lock and re-wake if needed; -1 if another
+ * process held it too long */
+static int begin_exchange(const monitor_t* m, monitor_device_t* dev) {
+    if (jm_device_begin(&dev->device) != 0) {
+        if (m->options->verbose) {
+            fprintf(stderr, "Mailbox of %s still locked by another process; poll skipped\n", dev->path);
+        }
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Detect, check the mailbox sector, open and wake one enclosure
+ * The open is retried on the next event or flags tick; only the first
+ * failure in a row is reported.
+ * @return 0 with the session open, -1 otherwise
+ */
+static int device_open(monitor_t* m, monitor_device_t* dev) {
+    const cli_options_t* options = m->options;
+    jm_device_options_t open_options = {
+        .force = options->force,
+        .signal_handlers = 1,
+        .run_dir = options->run_dir,
+    };
+    jm_device_t* device = &dev->device;
+
+    if (!resolve_name(dev)) {
+        return -1;
+    }
+
+    jm_device_init(device, options->sector);
+    device->session.verbose = options->verbose;
+    device->session.warm_probe = config_warm_probe(smart_get_config(), dev->path);
+    if (options->listen_address != NULL) {
+        device->session.timings = &dev->timings;
+    }
+
+    switch (jm_device_open(device, dev->path, &open_options)) {
+        case JM_DEVICE_OK:
+            break;
+        case JM_DEVICE_NOT_JMICRON:
+            open_error(dev, "Could not detect JMicron RAID controller on %s (use --force to skip)", dev->path);
+            goto fail;
+        case JM_DEVICE_SECTOR_UNREADABLE:
+            open_error(dev, "Could not read sector %u of %s via block device to verify it is safe",
+                       options->sector, dev->path);
+            goto fail;
+        case JM_DEVICE_SECTOR_IN_USE:
+            open_error(dev, "Sector %u contains data on disk (%s); see SECTOR_USAGE.md",
+                       options->sector, dev->path);
+            goto fail;
+        case JM_DEVICE_LOCKED:
+            open_error(dev, "Mailbox of %s is locked by another process", dev->path);
+            goto fail;
+        case JM_DEVICE_OPEN_FAILED:
+            open_error(dev, "Cannot open %s: %s", dev->path, jm_error_string(device->protocol_error));
+            goto fail;
+        case JM_DEVICE_WAKE_FAILED:
+            open_error(dev, "Failed to wake up controller on %s: %s", dev->path,
+                       jm_error_string(device->protocol_error));
+            goto fail;
+    }
+    if (device->lock.fd < 0 && options->verbose) {
+        fprintf(stderr, "No mailbox lock for %s in %s; not locking\n", dev->path, options->run_dir);
+    }
+
+    dev->opened = 1;
+    dev->open_failed = 0;
+    dev->failures = 0;
+    dev->has_flags = 0;
+    dev->has_smart = 0;
+    dev->smart_status = -1;
+    return 0;
+
+fail:
+    dev->open_failed = 1;
+    return -1;
+}
+
+/**
+ * Close a session that is gone or no longer answers, and report it
+ */
+static void device_lost(monitor_t* m, monitor_device_t* dev, const char* reason) {
+    if (!dev->opened) {
+        return;
+    }
+    jm_device_close(&dev->device);
+    dev->opened = 0;
+    m->metrics_stale = 1;
+    emit_event(m, dev, "disconnected", reason);
+}
+
+/**
+ * Try to open a closed enclosure whose device node exists, and report it
+ */
+static void device_connect(monitor_t* m, monitor_device_t* dev, uint64_t now) {
+    if (dev->opened || access(dev->path, F_OK) != 0 || device_open(m, dev) != 0) {
+        return;
+    }
+    m->metrics_stale = 1;
+    emit_event(m, dev, "connected", dev->device.controller.found ? dev->device.controller.model : NULL);
+
+    /* Poll both right away so the first flags and SMART state are known */
+    dev->next_flags_us = now;
+    dev->next_smart_us = now;
+}
+
+/* Helper: Count a failed poll; the session is dropped after MAX_POLL_FAILURES */
+static void poll_failed(monitor_t* m, monitor_device_t* dev) {
+    dev->poll_failures++;
+    m->metrics_stale = 1;
+    if (access(dev->path, F_OK) != 0) {
+        device_lost(m, dev, "device removed");
+    } else if (++dev->failures >= MAX_POLL_FAILURES) {
+        device_lost(m, dev, "not responding");
+    }
+}
+
+/**
+ * Cheap poll: the RAID flags from one IDENTIFY; reports any change
+ */
+static void poll_flags(monitor_t* m, monitor_device_t* dev) {
+    jm_raid_flags_t flags;
+    uint64_t start;
+    int result;
+
+    if (begin_exchange(m, dev) != 0) {
+        return;
+    }
+    start = jm_monotonic_us();
+    result = jm_get_raid_flags(&dev->device.session, &flags);
+    jm_device_end(&dev->device, result);
+    if (result != 0) {
+        poll_failed(m, dev);
+        return;
+    }
+    jm_histogram_add(&dev->poll_latency[POLL_FLAGS], jm_monotonic_us() - start);
+    dev->failures = 0;
+    dev->flags_time = (int64_t)time(NULL);
+    m->metrics_stale = 1;
+
+    if (!dev->has_flags || flags.presence != dev->flags.presence ||
+        flags.rebuild != dev->flags.rebuild || flags.phase != dev->flags.phase) {
+        emit_flags(m, dev, dev->has_flags ? &dev->flags : NULL, &flags);
+    }
+    dev->flags = flags;
+    dev->has_flags = 1;
+}
+
+/**
+ * Full poll: SMART data of every disk; with --history, reports what changed
+ * since the last poll, otherwise the array verdict when it changes
+ */
+static void poll_smart(monitor_t* m, monitor_device_t* dev) {
+    disk_smart_data_t disks[5];
+    int num_disks = 0, is_degraded = 0, present_disks = 0;
+    uint64_t start;
+    int result;
+
+    if (begin_exchange(m, dev) != 0) {
+        return;
+    }
+    start = jm_monotonic_us();
+    result = jm_get_all_disks_smart_data(&dev->device.session, disks, &num_disks, &is_degraded, &present_disks);
+    jm_device_end(&dev->device, result);
+    if (result != 0) {
+        poll_failed(m, dev);
+        return;
+    }
+    jm_histogram_add(&dev->poll_latency[POLL_SMART], jm_monotonic_us() - start);
+    dev->failures = 0;
+    dev->smart_time = (int64_t)time(NULL);
+    memcpy(dev->disks, disks, sizeof(disks));
+    dev->has_smart = 1;
+    m->metrics_stale = 1;
+    if (jm_device_share(&dev->device, disks, num_disks, is_degraded, present_disks, dev->smart_time) != 0 &&
+        m->options->verbose) {
+        fprintf(stderr, "Could not share the poll of %s in %s\n", dev->path, m->options->run_dir);
+    }
+
+    int status = DISK_STATUS_PASSED;
+    for (int i = 0; i < 5; i++) {
+        if (disks[i].is_present && disks[i].overall_status != DISK_STATUS_PASSED) {
+            status = DISK_STATUS_FAILED;
+        }
+    }
+    if (is_degraded) {
+        status = DISK_STATUS_FAILED;
+    }
+
+    if (m->options->history_path != NULL) {
+        if (jm_history_record(m->options->history_path, dev->path, disks, 5, (int64_t)time(NULL),
+                              emit_change, m) < 0) {
+            fprintf(stderr, "Warning: Could not append to history file %s\n", m->options->history_path);
+        }
+    } else if (status != dev->smart_status) {
+        char detail[64];
+        snprintf(detail, sizeof(detail), "%d disk%s, %s%s", num_disks, num_disks == 1 ? "" : "s",
+                 status == DISK_STATUS_PASSED ? "PASSED" : "FAILED", is_degraded ? ", degraded" : "");
+        emit_event(m, dev, "smart", detail);
+    }
+    dev->smart_status = status;
+}
+
+/* Helper: Write a label value, escaping backslashes, quotes and newlines */
+static void write_label_value(FILE* out, const char* value) {
+    for (const char* p = value; *p; p++) {
+        if (*p == '\\' || *p == '"') {
+            fputc('\\', out);
+            fputc(*p, out);
+        } else if (*p == '\n') {
+            fputs("\\n", out);
+        } else {
+            fputc(*p, out);
+        }
+    }
+}
+
+/* Helper: HELP and TYPE lines that open a metric family */
+static void write_family(FILE* out, const char* name, const char* type, const char* help) {
+    fprintf(out, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+/* Helper: Sample name and device label (the caller adds labels and the value) */
+static void write_device_sample(FILE* out, const char* name, const monitor_device_t* dev) {
+    fprintf(out, "%s{device=\"", name);
+    write_label_value(out, dev->path);
+    fputc('"', out);
+}
+
+/* Helper: Device sample plus the disk slot and serial labels */
+static void write_disk_sample(FILE* out, const char* name, const monitor_device_t* dev, int slot) {
+    write_device_sample(out, name, dev);
+    fprintf(out, ",disk=\"%d\",serial=\"", slot);
+    write_label_value(out, dev->disks[slot].serial_number);
+    fputc('"', out);
+}
+
+/* Helper: Disks of the last SMART poll, while the enclosure is connected */
+static int has_disk(const monitor_device_t* dev, int slot) {
+    return dev->opened && dev->has_smart && dev->disks[slot].is_present;
+}
+
+/* Which attribute field write_attribute_family reports */
+typedef enum { ATTR_FIELD_VALUE, ATTR_FIELD_WORST, ATTR_FIELD_RAW } attr_field_t;
+
+/* Helper: One gauge per SMART attribute of every present disk */
+static void write_attribute_family(FILE* out, const monitor_t* m, const char* name, const char* help,
+                                   attr_field_t field) {
+    write_family(out, name, "gauge", help);
+    for (int d = 0; d < m->num_devices; d++) {
+        const monitor_device_t* dev = &m->devices[d];
+        for (int slot = 0; slot < 5; slot++) {
+            if (!has_disk(dev, slot)) {
+                continue;
+            }
+            for (int i = 0; i < dev->disks[slot].num_attributes; i++) {
+                const parsed_smart_attribute_t* attr = &dev->disks[slot].attributes[i];
+                uint64_t value = field == ATTR_FIELD_VALUE ? attr->current_value
+                               : field == ATTR_FIELD_WORST ? attr->worst_value : attr->raw_value;
+                write_disk_sample(out, name, dev, slot);
+                fprintf(out, ",id=\"%u\",name=\"", attr->id);
+                write_label_value(out, attr->name ? attr->name : "Unknown_Attribute");
+                fprintf(out, "\"} %llu\n", (unsigned long long)value);
+            }
+        }
+    }
+}
+
+/**
+ * Render every enclosure's last poll results in the Prometheus text format
+ * Flags and SMART series are only present while the enclosure is connected.
+ */
+static void metrics_render(const monitor_t* m, FILE* out) {
+    static const char* const poll_names[2] = { "flags", "smart" };
+
+    write_family(out, "jmraid_up", "gauge", "Whether the enclosure's controller session is open");
+    for (int d = 0; d < m->num_devices; d++) {
+        write_device_sample(out, "jmraid_up", &m->devices[d]);
+        fprintf(out, "} %d\n", m->devices[d].opened);
+    }
+
+    write_family(out, "jmraid_presence_mask", "gauge", "Disk presence bitmask from the RAID flags (bit N = slot N)");
+    for (int d = 0; d < m->num_devices; d++) {
+        const monitor_device_t* dev = &m->devices[d];
+        if (dev->opened && dev->has_flags) {
+            write_device_sample(out, "jmraid_presence_mask", dev);
+            fprintf(out, "} %u\n", dev->flags.presence);
+        }
+    }
+
+    write_family(out, "jmraid_rebuild", "gauge", "Rebuild byte from the RAID flags (0 = no rebuild)");
+    for (int d = 0; d < m->num_devices; d++) {
+        const monitor_device_t* dev = &m->devices[d];
+        if (dev->opened && dev->has_flags) {
+            write_device_sample(out, "jmraid_rebuild", dev);
+            fprintf(out, "} %u\n", dev->flags.rebuild);
+        }
+    }
+
+    write_family(out, "jmraid_phase", "gauge", "Phase byte from the RAID flags");
+    for (int d = 0; d < m->num_devices; d++) {
+        const monitor_device_t* dev = &m->devices[d];
+        if (dev->opened && dev->has_flags) {
+            write_device_sample(out, "jmraid_phase", dev);
+            fprintf(out, "} %u\n", dev->flags.phase);
+        }
+    }
+
+    write_family(out, "jmraid_last_poll_timestamp_seconds", "gauge", "Unix time of the last successful poll");
+    for (int d = 0; d < m->num_devices; d++) {
+        const monitor_device_t* dev = &m->devices[d];
+        const int64_t times[2] = { dev->flags_time, dev->smart_time };
+        for (int p = 0; p < 2; p++) {
+            if (times[p] != 0) {
+                write_device_sample(out, "jmraid_last_poll_timestamp_seconds", dev);
+                fprintf(out, ",poll=\"%s\"} %lld\n", poll_names[p], (long long)times[p]);
+            }
+        }
+    }
+
+    write_family(out, "jmraid_poll_failures_total", "counter", "Polls that got no valid response");
+    for (int d = 0; d < m->num_devices; d++) {
+        write_device_sample(out, "jmraid_poll_failures_total", &m->devices[d]);
+        fprintf(out, "} %llu\n", (unsigned long long)m->devices[d].poll_failures);
+    }
+
+    write_family(out, "jmraid_disk_info", "gauge", "Disk identity (always 1)");
+    for (int d = 0; d < m->num_devices; d++) {
+        const monitor_device_t* dev = &m->devices[d];
+        for (int slot = 0; slot < 5; slot++) {
+            if (has_disk(dev, slot)) {
+                write_disk_sample(out, "jmraid_disk_info", dev, slot);
+                fputs(",model=\"", out);
+                write_label_value(out, dev->disks[slot].disk_name);
+                fputs("\",firmware=\"", out);
+                write_label_value(out, dev->disks[slot].firmware_rev);
+                fputs("\"} 1\n", out);
+            }
+        }
+    }
+
+    write_family(out, "jmraid_disk_healthy", "gauge", "Whether the disk's SMART assessment passed");
+    for (int d = 0; d < m->num_devices; d++) {
+        const monitor_device_t* dev = &m->devices[d];
+        for (int slot = 0; slot < 5; slot++) {
+            if (has_disk(dev, slot)) {
+                write_disk_sample(out, "jmraid_disk_healthy", dev, slot);
+                fprintf(out, "} %d\n", dev->disks[slot].overall_status == DISK_STATUS_PASSED);
+            }
+        }
+    }
+
+    write_family(out, "jmraid_disk_temperature_celsius", "gauge", "Disk temperature");
+    for (int d = 0; d < m->num_devices; d++) {
+        const monitor_device_t* dev = &m->devices[d];
+        for (int slot = 0; slot < 5; slot++) {
+            int temp = has_disk(dev, slot) ? smart_disk_temperature(&dev->disks[slot]) : -1;
+            if (temp >= 0) {
+                write_disk_sample(out, "jmraid_disk_temperature_celsius", dev, slot);
+                fprintf(out, "} %d\n", temp);
+            }
+        }
+    }
+
+    write_attribute_family(out, m, "jmraid_smart_value", "SMART attribute normalized value", ATTR_FIELD_VALUE);
+    write_attribute_family(out, m, "jmraid_smart_worst", "SMART attribute worst normalized value", ATTR_FIELD_WORST);
+    write_attribute_family(out, m, "jmraid_smart_raw", "SMART attribute raw value", ATTR_FIELD_RAW);
+
+    write_family(out, "jmraid_poll_duration_seconds", "histogram", "Latency of successful polls");
+    for (int d = 0; d < m->num_devices; d++) {
+        const monitor_device_t* dev = &m->devices[d];
+        for (int p = 0; p < 2; p++) {
+            const jm_histogram_t* h = &dev->poll_latency[p];
+            uint64_t cumulative = 0;
+            for (int b = 0; b < JM_HISTOGRAM_BUCKETS; b++) {
+                cumulative += h->buckets[b];
+                write_device_sample(out, "jmraid_poll_duration_seconds_bucket", dev);
+                fprintf(out, ",poll=\"%s\",le=\"%g\"} %llu\n", poll_names[p],
+                        (double)jm_histogram_bounds_us[b] / 1e6, (unsigned long long)cumulative);
+            }
+            write_device_sample(out, "jmraid_poll_duration_seconds_bucket", dev);
+            fprintf(out, ",poll=\"%s\",le=\"+Inf\"} %llu\n", poll_names[p], (unsigned long long)h->count);
+            write_device_sample(out, "jmraid_poll_duration_seconds_sum", dev);
+            fprintf(out, ",poll=\"%s\"} %.6f\n", poll_names[p], (double)h->total_us / 1e6);
+            write_device_sample(out, "jmraid_poll_duration_seconds_count", dev);
+            fprintf(out, ",poll=\"%s\"} %llu\n", poll_names[p], (unsigned long long)h->count);
+        }
+    }
+
+    write_family(out, "jmraid_command_duration_seconds", "summary",
+                 "Latency of controller commands (write and read round trip)");
+    for (int d = 0; d < m->num_devices; d++) {
+        const monitor_device_t* dev = &m->devices[d];
+        for (int t = 0; t < JM_CMD_TYPE_COUNT; t++) {
+            const jm_latency_t* latency = &dev->timings.commands[t];
+            const char* type = jm_cmd_type_name((jm_cmd_type_t)t);
+            write_device_sample(out, "jmraid_command_duration_seconds_sum", dev);
+            fprintf(out, ",command=\"%s\"} %.6f\n", type, (double)latency->total_us / 1e6);
+            write_device_sample(out, "jmraid_command_duration_seconds_count", dev);
+            fprintf(out, ",command=\"%s\"} %u\n", type, latency->count);
+        }
+    }
+}
+
+/**
+ * Publish a new metrics snapshot if anything changed since the last one
+ */
+static void metrics_refresh(monitor_t* m) {
+    char* text = NULL;
+    size_t len = 0;
+    FILE* out;
+
+    if (m->options->listen_address == NULL || !m->metrics_stale) {
+        return;
+    }
+    out = open_memstream(&text, &len);
+    if (out == NULL) {
+        return;
+    }
+    metrics_render(m, out);
+    if (fclose(out) == 0 && metrics_server_publish(&m->metrics, text, len) == 0) {
+        m->metrics_stale = 0;
+    }
+}
+
+/**
+ * Open the kernel uevent socket, or fall back to watching /dev
+ * @return 0 on success, -1 if neither is available
+ */
+static int events_open(monitor_t* m) {
+    struct sockaddr_nl addr;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = 1;  /* Kernel uevents */
+
+    m->event_fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_KOBJECT_UEVENT);
+    if (m->event_fd >= 0 && bind(m->event_fd, (struct sockaddr*)&addr, sizeof(addr)) == 0) {
+        m->inotify = 0;
+        return 0;
+    }
+    if (m->event_fd >= 0) {
+        close(m->event_fd);
+    }
+
+    m->event_fd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+    if (m->event_fd >= 0 && inotify_add_watch(m->event_fd, "/dev", IN_CREATE | IN_DELETE) >= 0) {
+        m->inotify = 1;
+        if (m->options->verbose) {
+            fprintf(stderr, "Netlink uevents unavailable, watching /dev instead\n");
+        }
+        return 0;
+    }
+    if (m->event_fd >= 0) {
+        close(m->event_fd);
+    }
+    m->event_fd = -1;
+    return -1;
+}
+
+/**
+ * React to a block device appearing or disappearing
+ */
+static void on_device_event(monitor_t* m, int added, const char* name, uint64_t now) {
+    if (m->options->verbose) {
+        fprintf(stderr, "Event: %s %s\n", added ? "add" : "remove", name);
+    }
+    for (int i = 0; i < m->num_devices; i++) {
+        monitor_device_t* dev = &m->devices[i];
+        if (added) {
+            /* The path may be a by-id link that only now resolves */
+            device_connect(m, dev, now);
+        } else if (dev->opened && strcmp(dev->name, name) == 0) {
+            device_lost(m, dev, "device removed");
+        }
+    }
+}
+
+/* Helper: Value of KEY in a uevent message (NUL-separated KEY=VALUE pairs) */
+static const char* uevent_value(const char* msg, size_t len, const char* key) {
+    size_t key_len = strlen(key);
+    for (size_t pos = 0; pos < len; pos += strlen(msg + pos) + 1) {
+        if (strncmp(msg + pos, key, key_len) == 0 && msg[pos + key_len] == '=') {
+            return msg + pos + key_len + 1;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Drain pending uevents or inotify events
+ */
+static void events_read(monitor_t* m, uint64_t now) {
+    char buf[UEVENT_BUFFER_SIZE] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t n;
+
+    while ((n = read(m->event_fd, buf, sizeof(buf) - 1)) > 0) {
+        if (m->inotify) {
+            for (char* p = buf; p < buf + n; ) {
+                const struct inotify_event* ev = (const struct inotify_event*)p;
+                if (ev->len > 0) {
+                    on_device_event(m, (ev->mask & IN_CREATE) != 0, ev->name, now);
+                }
+                p += sizeof(struct inotify_event) + ev->len;
+            }
+            continue;
+        }
+
+        buf[n] = '\0';
+        const char* action = uevent_value(buf, (size_t)n, "ACTION");
+        const char* subsystem = uevent_value(buf, (size_t)n, "SUBSYSTEM");
+        const char* devtype = uevent_value(buf, (size_t)n, "DEVTYPE");
+        const char* devname = uevent_value(buf, (size_t)n, "DEVNAME");
+        if (action == NULL || subsystem == NULL || devname == NULL ||
+            strcmp(subsystem, "block") != 0 || (devtype != NULL && strcmp(devtype, "disk") != 0)) {
+            continue;
+        }
+        if (strcmp(action, "add") == 0 || strcmp(action, "remove") == 0) {
+            const char* base = strrchr(devname, '/');
+            on_device_event(m, action[0] == 'a', base ? base + 1 : devname, now);
+        }
+    }
+}
+
+/**
+ * Event loop: sleep until the next due poll or a device event
+ */
+static void monitor_run(monitor_t* m) {
+    const cli_options_t* options = m->options;
+    const uint64_t flags_us = (uint64_t)options->flags_interval * 1000000ULL;
+    const uint64_t smart_us = (uint64_t)options->smart_interval * 1000000ULL;
+
+    while (1) {
+        /* Polls run on this thread, so none is assessing while the policy changes */
+        const smart_config_t* reloaded = config_watch_swap(m->config_watch);
+        if (reloaded != NULL) {
+            for (int i = 0; i < m->num_devices; i++) {
+                m->devices[i].device.session.warm_probe = config_warm_probe(reloaded, m->devices[i].path);
+            }
+            fprintf(stderr, "Reloaded config from %s\n", options->config_path);
+        }
+
+        uint64_t now = jm_monotonic_us();
+        uint64_t next = now + flags_us;
+
+        for (int i = 0; i < m->num_devices; i++) {
+            monitor_device_t* dev = &m->devices[i];
+
+            if (!dev->opened) {
+                /* Retried every flags interval too, in case an event was missed */
+                if (now >= dev->next_flags_us) {
+                    dev->next_flags_us = now + flags_us;
+                    device_connect(m, dev, now);
+                }
+            }
+            if (dev->opened && now >= dev->next_smart_us) {
+                dev->next_smart_us = now + smart_us;
+                dev->next_flags_us = now + flags_us;  /* The SMART poll read slot 0 too */
+                poll_flags(m, dev);
+                if (dev->opened) poll_smart(m, dev);
+            } else if (dev->opened && now >= dev->next_flags_us) {
+                dev->next_flags_us = now + flags_us;
+                poll_flags(m, dev);
+            }
+
+            if (dev->next_flags_us < next) next = dev->next_flags_us;
+            if (dev->opened && dev->next_smart_us < next) next = dev->next_smart_us;
+        }
+
+        metrics_refresh(m);
+
+        /* Scrapes are answered on the metrics server's thread */
+        struct pollfd pfd = { .fd = m->event_fd, .events = POLLIN };
+        int num_fds = m->event_fd >= 0 ? 1 : 0;
+
+        now = jm_monotonic_us();
+        int timeout_ms = next > now ? (int)((next - now + 999) / 1000) : 0;
+        if (poll(&pfd, (nfds_t)num_fds, timeout_ms) > 0 && pfd.revents != 0) {
+            events_read(m, jm_monotonic_us());
+        }
+    }
+}
+
+static void print_help(const char* program_name) {
+    printf("Usage: %s [OPTIONS] DEVICE...\n\n", program_name);
+    printf("Monitor JMicron RAID enclosures: report hotplug at once, poll RAID flags\n");
+    printf("often and SMART data rarely, and print one line per change\n\n");
+    printf("Options:\n");
+    printf("  -f, --flags-interval N  Seconds between RAID flag polls (default: %d)\n", DEFAULT_FLAGS_INTERVAL);
+    printf("  -s, --smart-interval N  Seconds between SMART polls (default: %d)\n", DEFAULT_SMART_INTERVAL);
+    printf("  -H, --history FILE      Record SMART polls to FILE and report their changes\n");
+    printf("                          (see jmraidstatus --changed-since)\n");
+    printf("  -e, --exec CMD          Also pipe each event line to CMD (via /bin/sh)\n");
+    printf("  -l, --listen [ADDR:]PORT\n");
+    printf("                          Serve Prometheus metrics from the last polls at\n");
+    printf("                          http://ADDR:PORT/metrics (scrapes never poll)\n");
+    printf("  -j, --json              Print events as JSON lines\n");
+    printf("  -c, --config PATH       SMART threshold configuration\n");
+    printf("  --sector N              Communication sector (default: %d)\n", DEFAULT_SECTOR);
+    printf("  --run-dir PATH          Mailbox locks and shared polls (default: %s)\n", JM_RUN_DEFAULT_DIR);
+    printf("  --force                 Skip hardware detection\n");
+    printf("  -v, --verbose           Verbose output\n");
+    printf("  -h, --help              Show this help\n\n");
+    printf("Events: connected, disconnected, flags, smart (without --history),\n");
+    printf("and the --changed-since change lines (with --history)\n");
+}
+
+/* Helper: Positive integer option or exit */
+static int parse_interval(const char* arg, const char* name) {
+    char* end;
+    long value = strtol(arg, &end, 10);
+    if (*arg == '\0' || *end != '\0' || value < 1 || value > 86400 * 7) {
+        fprintf(stderr, "Error: --%s must be 1-%d seconds\n", name, 86400 * 7);
+        exit(3);
+    }
+    return (int)value;
+}
+
+static void parse_arguments(int argc, char** argv, cli_options_t* options) {
+    memset(options, 0, sizeof(cli_options_t));
+    options->flags_interval = DEFAULT_FLAGS_INTERVAL;
+    options->smart_interval = DEFAULT_SMART_INTERVAL;
+    options->sector = DEFAULT_SECTOR;
+    options->run_dir = JM_RUN_DEFAULT_DIR;
+
+    static struct option long_options[] = {
+        {"flags-interval", required_argument, 0, 'f'},
+        {"smart-interval", required_argument, 0, 's'},
+        {"history", required_argument, 0, 'H'},
+        {"exec", required_argument, 0, 'e'},
+        {"listen", required_argument, 0, 'l'},
+        {"json", no_argument, 0, 'j'},
+        {"config", required_argument, 0, 'c'},
+        {"sector", required_argument, 0, 'S'},
+        {"run-dir", required_argument, 0, 'R'},
+        {"force", no_argument, 0, 'F'},
+        {"verbose", no_argument, 0, 'v'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "f:s:H:e:l:jc:vh", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'f':
+                options->flags_interval = parse_interval(optarg, "flags-interval");
+                break;
+            case 's':
+                options->smart_interval = parse_interval(optarg, "smart-interval");
+                break;
+            case 'H':
+                options->history_path = optarg;
+                break;
+            case 'e':
+                options->exec_cmd = optarg;
+                break;
+            case 'l':
+                options->listen_address = optarg;
+                break;
+            case 'j':
+                options->json = 1;
+                break;
+            case 'c':
+                options->config_path = optarg;
+                break;
+            case 'S': {
+                char* end;
+                unsigned long sector = strtoul(optarg, &end, 0);
+                if (*optarg == '\0' || *end != '\0' || !jm_sector_in_safe_range((uint32_t)sector)) {
+                    fprintf(stderr, "Error: Sector %s is in an unsafe range (safe: 33, 64-2047)\n", optarg);
+                    exit(3);
+                }
+                options->sector = (uint32_t)sector;
+                break;
+            }
+            case 'R':
+                options->run_dir = optarg;
+                break;
+            case 'F':
+                options->force = 1;
+                break;
+            case 'v':
+                options->verbose = 1;
+                break;
+            case 'h':
+                print_help(argv[0]);
+                exit(0);
+            default:
+                exit(3);
+        }
+    }
+
+    for (int i = optind; i < argc; i++) {
+        if (options->num_devices >= MAX_DEVICES) {
+            fprintf(stderr, "Error: At most %d devices\n", MAX_DEVICES);
+            exit(3);
+        }
+        options->devices[options->num_devices++] = argv[i];
+    }
+    if (options->num_devices == 0) {
+        fprintf(stderr, "Error: No device specified (see --help)\n");
+        exit(3);
+    }
+}
+
+int main(int argc, char** argv) {
+    cli_options_t options;
+    parse_arguments(argc, argv, &options);
+
+    smart_config_t config;
+    if (options.config_path != NULL) {
+        if (config_load(options.config_path, &config) != 0) {
+            fprintf(stderr, "Error: Failed to load config from %s\n", options.config_path);
+            return 3;
+        }
+    } else {
+        config_init_default(&config);
+    }
+    smart_set_config(&config);
+
+    if (options.verbose) {
+        setenv("JMRAIDSTATUS_VERBOSE", "1", 1);
+    }
+    signal(SIGPIPE, SIG_IGN);  /* An --exec command that exits early must not stop the monitor */
+
+    static monitor_t monitor;
+    monitor.options = &options;
+    monitor.num_devices = options.num_devices;
+    for (int i = 0; i < options.num_devices; i++) {
+        monitor.devices[i].path = options.devices[i];
+        jm_device_init(&monitor.devices[i].device, options.sector);
+        monitor.devices[i].smart_status = -1;
+    }
+
+    if (options.listen_address != NULL && (metrics_server_open(&monitor.metrics, options.listen_address) != 0 ||
+                                            metrics_server_start(&monitor.metrics) != 0)) {
+        fprintf(stderr, "Error: Cannot listen on %s: %s\n", options.listen_address, strerror(errno));
+        return 3;
+    }
+    monitor.metrics_stale = 1;
+
+    if (options.config_path != NULL) {
+        monitor.config_watch = config_watch_start(options.config_path);
+        if (monitor.config_watch == NULL) {
+            fprintf(stderr, "Warning: Cannot watch %s; config changes need a restart\n", options.config_path);
+        }
+    }
+
+    /* Without device events, enclosures are still picked up at each flags poll */
+    if (events_open(&monitor) != 0) {
+        fprintf(stderr, "Warning: No device events (netlink and inotify unavailable); "
+                        "polling every %d s\n", options.flags_interval);
+    }
+
+    /* Enclosures that are missing now are reported when they appear */
+    uint64_t now = jm_monotonic_us();
+    for (int i = 0; i < monitor.num_devices; i++) {
+        monitor.devices[i].next_flags_us = now + (uint64_t)options.flags_interval * 1000000ULL;
+        device_connect(&monitor, &monitor.devices[i], now);
+        if (!monitor.devices[i].opened) {
+            emit_event(&monitor, &monitor.devices[i], "disconnected",
+                       access(monitor.devices[i].path, F_OK) == 0 ? "open failed" : "not present");
+        }
+    }
+
+    /* Runs until a signal; the session handlers restore every mailbox sector */
+    monitor_run(&monitor);
+    return 0;
+}
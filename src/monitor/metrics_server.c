@@ -0,0 +1,440 @@
+/*
+ * metrics_server.c - Serve a metrics snapshot over HTTP (/metrics)
+ *
+ * Copyright (C) 2026 Jamie Treworgy
+ * SPDX-License-Identifier: MIT
+ */
+
+#define _GNU_SOURCE  /* accept4, pipe2 */
+#include "metrics_server.h"
+#include "../jm_timings.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#define METRICS_CONTENT_TYPE "text/plain; version=0.0.4; charset=utf-8"
+
+struct metrics_snapshot {
+    int refs;                               /* Server's current pointer + each scrape writing it */
+    size_t len;
+    char* text;
+};
+
+/* Helper: Drop one reference to a snapshot */
+static void snapshot_release(metrics_server_t* server, struct metrics_snapshot* snapshot) {
+    if (snapshot == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&server->lock);
+    int refs = --snapshot->refs;
+    pthread_mutex_unlock(&server->lock);
+    if (refs == 0) {
+        free(snapshot->text);
+        free(snapshot);
+    }
+}
+
+/* Helper: Split [ADDR:]PORT into host (NULL = any) and port */
+static int split_address(const char* address, char* host, size_t host_size, const char** port) {
+    const char* colon;
+
+    if (address[0] == '[') {
+        const char* end = strchr(address, ']');
+        if (end == NULL || end[1] != ':' || (size_t)(end - address - 1) >= host_size) {
+            return -1;
+        }
+        memcpy(host, address + 1, (size_t)(end - address - 1));
+        host[end - address - 1] = '\0';
+        *port = end + 2;
+        return 0;
+    }
+
+    colon = strrchr(address, ':');
+    if (colon == NULL) {
+        host[0] = '\0';
+        *port = address;
+        return 0;
+    }
+    if ((size_t)(colon - address) >= host_size) {
+        return -1;
+    }
+    memcpy(host, address, (size_t)(colon - address));
+    host[colon - address] = '\0';
+    *port = colon + 1;
+    return 0;
+}
+
+int metrics_server_open(metrics_server_t* server, const char* address) {
+    char host[256];
+    const char* port;
+    struct addrinfo hints, *results, *ai;
+    int saved_errno = EADDRNOTAVAIL;
+
+    memset(server, 0, sizeof(*server));
+    server->listen_fd = -1;
+    server->stop_pipe[0] = server->stop_pipe[1] = -1;
+    pthread_mutex_init(&server->lock, NULL);
+    for (int i = 0; i < METRICS_MAX_CLIENTS; i++) {
+        server->clients[i].fd = -1;
+    }
+
+    if (split_address(address, host, sizeof(host), &port) != 0 || *port == '\0') {
+        errno = EINVAL;
+        return -1;
+    }
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE | AI_NUMERICSERV;
+    if (getaddrinfo(host[0] ? host : NULL, port, &hints, &results) != 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    /* With no address, prefer the IPv6 wildcard: it accepts IPv4 too */
+    for (int pass = 0; pass < 2 && server->listen_fd < 0; pass++) {
+        for (ai = results; ai != NULL && server->listen_fd < 0; ai = ai->ai_next) {
+            if (pass == 0 && host[0] == '\0' && ai->ai_family != AF_INET6) {
+                continue;
+            }
+            int fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC | SOCK_NONBLOCK, ai->ai_protocol);
+            int one = 1, zero = 0;
+            if (fd < 0) {
+                saved_errno = errno;
+                continue;
+            }
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+            if (ai->ai_family == AF_INET6 && host[0] == '\0') {
+                setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &zero, sizeof(zero));
+            }
+            if (bind(fd, ai->ai_addr, ai->ai_addrlen) == 0 && listen(fd, METRICS_MAX_CLIENTS) == 0) {
+                server->listen_fd = fd;
+            } else {
+                saved_errno = errno;
+                close(fd);
+            }
+        }
+    }
+    freeaddrinfo(results);
+
+    if (server->listen_fd < 0) {
+        errno = saved_errno;
+        return -1;
+    }
+    return 0;
+}
+
+int metrics_server_publish(metrics_server_t* server, char* text, size_t len) {
+    struct metrics_snapshot* snapshot = malloc(sizeof(*snapshot));
+    if (snapshot == NULL) {
+        free(text);
+        return -1;
+    }
+    snapshot->refs = 1;
+    snapshot->len = len;
+    snapshot->text = text;
+
+    /* Scrapes still writing the previous snapshot keep it alive */
+    pthread_mutex_lock(&server->lock);
+    struct metrics_snapshot* previous = server->current;
+    server->current = snapshot;
+    pthread_mutex_unlock(&server->lock);
+    snapshot_release(server, previous);
+    return 0;
+}
+
+/* Helper: Close a connection and drop its snapshot */
+static void client_close(metrics_server_t* server, metrics_client_t* client) {
+    close(client->fd);
+    snapshot_release(server, client->snapshot);
+    memset(client, 0, sizeof(*client));
+    client->fd = -1;
+}
+
+/* Helper: Queue the response to a complete request head */
+static void client_respond(metrics_server_t* server, metrics_client_t* client) {
+    char method[8] = "", path[256] = "";
+    int status = 200;
+    const char* reason = "OK";
+    const char* type = METRICS_CONTENT_TYPE;
+
+    client->request[client->request_len] = '\0';
+    if (sscanf(client->request, "%7s %255s", method, path) != 2) {
+        status = 400;
+    } else if (strcmp(method, "GET") != 0 && strcmp(method, "HEAD") != 0) {
+        status = 405;
+    } else {
+        char* query = strchr(path, '?');
+        if (query != NULL) *query = '\0';
+
+        if (strcmp(path, "/metrics") == 0) {
+            pthread_mutex_lock(&server->lock);
+            client->snapshot = server->current;
+            if (client->snapshot != NULL) client->snapshot->refs++;
+            pthread_mutex_unlock(&server->lock);
+        }
+
+        if (client->snapshot != NULL) {
+            client->body = client->snapshot->text;
+            client->body_len = client->snapshot->len;
+        } else if (strcmp(path, "/metrics") == 0) {
+            status = 503;
+        } else if (strcmp(path, "/") == 0) {
+            type = "text/plain; charset=utf-8";
+            client->body = "jmraid-monitord: metrics at /metrics\n";
+            client->body_len = strlen(client->body);
+        } else {
+            status = 404;
+        }
+    }
+
+    switch (status) {
+        case 400: reason = "Bad Request"; break;
+        case 404: reason = "Not Found"; break;
+        case 405: reason = "Method Not Allowed"; break;
+        case 503: reason = "Service Unavailable"; break;
+        default: break;
+    }
+    if (status != 200) {
+        type = "text/plain; charset=utf-8";
+        client->body = reason;
+        client->body_len = strlen(reason);
+    }
+
+    client->head_len = (size_t)snprintf(client->head, sizeof(client->head),
+                                        "HTTP/1.0 %d %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\n"
+                                        "Connection: close\r\n\r\n",
+                                        status, reason, type, client->body_len);
+    if (strcmp(method, "HEAD") == 0) {
+        client->body_len = 0;
+    }
+    client->responding = 1;
+}
+
+/* Helper: Read request bytes; respond once the head is complete */
+static void client_read(metrics_server_t* server, metrics_client_t* client) {
+    while (client->request_len < sizeof(client->request) - 1) {
+        ssize_t n = recv(client->fd, client->request + client->request_len,
+                         sizeof(client->request) - 1 - client->request_len, 0);
+        if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+            client_close(server, client);
+            return;
+        }
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        client->request_len += (size_t)n;
+        client->request[client->request_len] = '\0';
+        if (strstr(client->request, "\r\n\r\n") != NULL || strstr(client->request, "\n\n") != NULL) {
+            client_respond(server, client);
+            return;
+        }
+    }
+    /* Head too long: answer 400 */
+    client->request[0] = '\0';
+    client->request_len = 0;
+    client_respond(server, client);
+}
+
+/* Helper: Write as much of the response as the socket takes */
+static void client_write(metrics_server_t* server, metrics_client_t* client) {
+    size_t total = client->head_len + client->body_len;
+
+    while (client->sent < total) {
+        struct iovec iov[2];
+        int count = 0;
+        if (client->sent < client->head_len) {
+            iov[count].iov_base = client->head + client->sent;
+            iov[count].iov_len = client->head_len - client->sent;
+            count++;
+            iov[count].iov_base = (void*)client->body;
+            iov[count].iov_len = client->body_len;
+            count++;
+        } else {
+            iov[count].iov_base = (void*)(client->body + (client->sent - client->head_len));
+            iov[count].iov_len = total - client->sent;
+            count++;
+        }
+
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = (size_t)count;
+        ssize_t n = sendmsg(client->fd, &msg, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) client_close(server, client);
+            return;
+        }
+        client->sent += (size_t)n;
+    }
+    client_close(server, client);
+}
+
+/* Helper: Accept pending connections while there are free slots */
+static void server_accept(metrics_server_t* server, uint64_t now_us) {
+    for (int i = 0; i < METRICS_MAX_CLIENTS; i++) {
+        metrics_client_t* client = &server->clients[i];
+        if (client->fd >= 0) {
+            continue;
+        }
+        int fd = accept4(server->listen_fd, NULL, NULL, SOCK_CLOEXEC | SOCK_NONBLOCK);
+        if (fd < 0) {
+            return;
+        }
+        client->fd = fd;
+        client->deadline_us = now_us + METRICS_CLIENT_TIMEOUT_US;
+    }
+    /* Every slot busy: the rest wait in the listen backlog */
+}
+
+/* Helper: Fill poll() entries for the listener and every open connection */
+static int server_pollfds(const metrics_server_t* server, struct pollfd* fds) {
+    int n = 0;
+
+    if (server->listen_fd < 0) {
+        return 0;
+    }
+    fds[n].fd = server->listen_fd;
+    fds[n].events = POLLIN;
+    fds[n].revents = 0;
+    n++;
+    for (int i = 0; i < METRICS_MAX_CLIENTS; i++) {
+        const metrics_client_t* client = &server->clients[i];
+        if (client->fd >= 0) {
+            fds[n].fd = client->fd;
+            fds[n].events = client->responding ? POLLOUT : POLLIN;
+            fds[n].revents = 0;
+            n++;
+        }
+    }
+    return n;
+}
+
+/* Helper: Accept, read and write as poll() reported, and close timed out connections */
+static void server_handle(metrics_server_t* server, const struct pollfd* fds, int num_fds, uint64_t now_us) {
+    for (int f = 0; f < num_fds; f++) {
+        if (fds[f].revents == 0 || fds[f].fd == server->listen_fd) {
+            continue;
+        }
+        for (int i = 0; i < METRICS_MAX_CLIENTS; i++) {
+            metrics_client_t* client = &server->clients[i];
+            if (client->fd != fds[f].fd) {
+                continue;
+            }
+            if (!client->responding) {
+                client_read(server, client);
+            }
+            /* Usually the whole response fits the socket buffer at once */
+            if (client->fd >= 0 && client->responding) {
+                client_write(server, client);
+            }
+            break;
+        }
+    }
+
+    for (int i = 0; i < METRICS_MAX_CLIENTS; i++) {
+        metrics_client_t* client = &server->clients[i];
+        if (client->fd >= 0 && now_us >= client->deadline_us) {
+            client_close(server, client);
+        }
+    }
+
+    /* Accept last so a new connection's fd can't match a stale poll entry */
+    if (num_fds > 0 && fds[0].fd == server->listen_fd && fds[0].revents != 0) {
+        server_accept(server, now_us);
+    }
+}
+
+/* Helper: Earliest connection deadline, or UINT64_MAX with no connections */
+static uint64_t server_deadline(const metrics_server_t* server) {
+    uint64_t deadline = UINT64_MAX;
+    for (int i = 0; i < METRICS_MAX_CLIENTS; i++) {
+        const metrics_client_t* client = &server->clients[i];
+        if (client->fd >= 0 && client->deadline_us < deadline) {
+            deadline = client->deadline_us;
+        }
+    }
+    return deadline;
+}
+
+/* Server thread: serve connections until metrics_server_close */
+static void* server_thread(void* arg) {
+    metrics_server_t* server = arg;
+    struct pollfd fds[2 + METRICS_MAX_CLIENTS];
+
+    while (1) {
+        fds[0].fd = server->stop_pipe[0];
+        fds[0].events = POLLIN;
+        fds[0].revents = 0;
+        int num_fds = 1 + server_pollfds(server, fds + 1);
+
+        uint64_t deadline = server_deadline(server), now = jm_monotonic_us();
+        int timeout_ms = deadline == UINT64_MAX ? -1
+                       : deadline > now ? (int)((deadline - now + 999) / 1000) : 0;
+        if (poll(fds, (nfds_t)num_fds, timeout_ms) < 0 && errno != EINTR) {
+            break;
+        }
+        if (fds[0].revents != 0) {
+            break;
+        }
+        server_handle(server, fds + 1, num_fds - 1, jm_monotonic_us());
+    }
+    return NULL;
+}
+
+int metrics_server_start(metrics_server_t* server) {
+    int result;
+
+    if (pipe2(server->stop_pipe, O_CLOEXEC) != 0) {
+        return -1;
+    }
+    result = pthread_create(&server->thread, NULL, server_thread, server);
+    if (result != 0) {
+        close(server->stop_pipe[0]);
+        close(server->stop_pipe[1]);
+        server->stop_pipe[0] = server->stop_pipe[1] = -1;
+        errno = result;
+        return -1;
+    }
+    server->running = 1;
+    return 0;
+}
+
+void metrics_server_close(metrics_server_t* server) {
+    if (server->running) {
+        if (write(server->stop_pipe[1], "", 1) != 1) {
+            pthread_cancel(server->thread);
+        }
+        pthread_join(server->thread, NULL);
+        server->running = 0;
+    }
+    if (server->stop_pipe[0] >= 0) {
+        close(server->stop_pipe[0]);
+        close(server->stop_pipe[1]);
+        server->stop_pipe[0] = server->stop_pipe[1] = -1;
+    }
+
+    for (int i = 0; i < METRICS_MAX_CLIENTS; i++) {
+        if (server->clients[i].fd >= 0) {
+            client_close(server, &server->clients[i]);
+        }
+    }
+    if (server->listen_fd >= 0) {
+        close(server->listen_fd);
+        server->listen_fd = -1;
+    }
+    snapshot_release(server, server->current);
+    server->current = NULL;
+    pthread_mutex_destroy(&server->lock);
+}
@@ -0,0 +1,81 @@
+/*
+ * metrics_server.h - Serve a metrics snapshot over HTTP (/metrics)
+ *
+ * Copyright (C) 2026 Jamie Treworgy
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef MONITOR_METRICS_SERVER_H
+#define MONITOR_METRICS_SERVER_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define METRICS_MAX_CLIENTS 16
+#define METRICS_REQUEST_MAX 2048            /* Request head bytes; longer requests get 400 */
+#define METRICS_CLIENT_TIMEOUT_US (10 * 1000000ULL)
+
+struct metrics_snapshot;
+
+/* One scrape connection */
+typedef struct {
+    int fd;                                 /* -1 = free slot */
+    uint64_t deadline_us;                   /* Closed if not done by then */
+    char request[METRICS_REQUEST_MAX];
+    size_t request_len;
+    int responding;                         /* Request read; writing the response */
+    char head[256];                         /* Status line and headers */
+    size_t head_len;
+    struct metrics_snapshot* snapshot;      /* Body, shared with other scrapes (or NULL) */
+    const char* body;
+    size_t body_len;
+    size_t sent;                            /* Bytes of head + body written */
+} metrics_client_t;
+
+/**
+ * A non-blocking HTTP listener answering from the last published snapshot
+ * Scrapes never reach the hardware: the owner publishes a new snapshot
+ * after each poll, and a scrape writes out the one current when its
+ * request arrived. Scrapes are served on the server's own thread, so a
+ * poll waiting on the controller (or on another process's mailbox lock)
+ * never delays one. Snapshots are reference counted, so any number of
+ * concurrent scrapes share one copy.
+ */
+typedef struct {
+    int listen_fd;
+    metrics_client_t clients[METRICS_MAX_CLIENTS];    /* Server thread only */
+    pthread_mutex_t lock;                   /* current and every snapshot's refs */
+    struct metrics_snapshot* current;
+    int stop_pipe[2];
+    pthread_t thread;
+    int running;
+} metrics_server_t;
+
+/**
+ * Listen on [ADDR:]PORT (all interfaces if ADDR is omitted or empty;
+ * IPv6 addresses in brackets, e.g. [::1]:9633)
+ * @return 0 on success, -1 with errno set
+ */
+int metrics_server_open(metrics_server_t* server, const char* address);
+
+/**
+ * Start serving connections on the server's thread
+ * @return 0 on success, -1 with errno set
+ */
+int metrics_server_start(metrics_server_t* server);
+
+/**
+ * Replace the snapshot served at /metrics (safe while the thread serves)
+ * @param text Prometheus text exposition, malloc'd; the server takes ownership
+ * @return 0 on success, -1 if out of memory (text is freed)
+ */
+int metrics_server_publish(metrics_server_t* server, char* text, size_t len);
+
+/**
+ * Stop the thread, close the listener and every connection and release
+ * the snapshot
+ */
+void metrics_server_close(metrics_server_t* server);
+
+#endif /* MONITOR_METRICS_SERVER_H */
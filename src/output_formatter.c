@@ -5,11 +5,56 @@
  * SPDX-License-Identifier: MIT
  */
 
+#define JSMN_HEADER  /* jsmn declarations only (via common.h) */
 #include "output_formatter.h"
+#include "health_record.h"
+#include "parsers/common.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
+/* --fields projection of the JSON output (NULL = every field) */
+static const output_fields_t* json_fields = NULL;
+
+void format_set_fields(const output_fields_t* fields) {
+    json_fields = fields;
+}
+
+int format_parse_fields(const char* spec, output_fields_t* fields) {
+    char buf[512];
+    char* save = NULL;
+    int any = 0;
+
+    memset(fields, 0, sizeof(*fields));
+    if (strlen(spec) >= sizeof(buf)) {
+        return -1;
+    }
+    strcpy(buf, spec);
+
+    for (char* token = strtok_r(buf, ",", &save); token != NULL; token = strtok_r(NULL, ",", &save)) {
+        char* end;
+        if (strcmp(token, "identity") == 0) {
+            fields->identity = 1;
+        } else if (strcmp(token, "values") == 0) {
+            fields->values = 1;
+        } else if (strcmp(token, "thresholds") == 0) {
+            fields->values = 1;
+            fields->thresholds = 1;
+        } else {
+            unsigned long id = strtoul(token, &end, 0);
+            if (end == token || *end != '\0' || id < 1 || id > 255) {
+                return -1;
+            }
+            fields->values = 1;
+            fields->filter_attributes = 1;
+            fields->attribute_ids[id] = 1;
+        }
+        any = 1;
+    }
+    return any ? 0 : -1;
+}
+
 const char* disk_status_string(disk_health_status_t status) {
     switch (status) {
         case DISK_STATUS_PASSED:   return "PASSED";
@@ -28,18 +73,6 @@ const char* attribute_status_string(attribute_health_status_t status) {
     }
 }
 
-/* Helper: Get temperature from attributes */
-static int get_temperature(const disk_smart_data_t* disk) {
-    for (int i = 0; i < disk->num_attributes; i++) {
-        if (disk->attributes[i].id == 0xC2 ||
-            disk->attributes[i].id == 0xBE ||
-            disk->attributes[i].id == 0xE7) {
-            return (int)(disk->attributes[i].raw_value & 0xFF);
-        }
-    }
-    return -1;  // Not found
-}
-
 /* Helper: Get power-on hours from attributes */
 static uint64_t get_power_on_hours(const disk_smart_data_t* disk) {
     for (int i = 0; i < disk->num_attributes; i++) {
@@ -131,7 +164,7 @@ void format_summary(const char* device_path, const disk_smart_data_t* disks, int
         printf("  Status: %s\n", disk_status_string(disks[i].overall_status));
 
         /* Temperature */
-        int temp = get_temperature(&disks[i]);
+        int temp = smart_disk_temperature(&disks[i]);
         if (temp >= 0) {
             printf("  Temperature: %d°C\n", temp);
         }
@@ -286,14 +319,46 @@ void format_full_smart(const disk_smart_data_t* disk) {
     printf("\n");
 }
 
-void format_json(const char* device_path, const disk_smart_data_t* disks, int num_disks,
-                 int expected_array_size, int present_disks, int is_degraded,
-                 const char* controller_model) {
+/* Helper: The "Degraded"/"Oversized" issue of an array size mismatch, if any */
+static void write_size_issue(json_writer_t* w, int expected_array_size, int present_disks, int degraded) {
+    char issue[128];
+
+    if (degraded) {
+        snprintf(issue, sizeof(issue), "Degraded: Expected %d disk%s but found only %d disk%s",
+                 expected_array_size, expected_array_size == 1 ? "" : "s",
+                 present_disks, present_disks == 1 ? "" : "s");
+    } else if (expected_array_size > 0 && present_disks > expected_array_size) {
+        snprintf(issue, sizeof(issue), "Oversized: Expected %d disk%s but found %d disk%s",
+                 expected_array_size, expected_array_size == 1 ? "" : "s",
+                 present_disks, present_disks == 1 ? "" : "s");
+    } else {
+        return;
+    }
+    json_write_string(w, NULL, issue);
+}
+
+/* Helper: Version, backend, device, timestamp and controller members */
+static void write_json_header(json_writer_t* w, const char* device_path, const char* controller_model) {
     time_t now = time(NULL);
     struct tm* tm_info = gmtime(&now);
     char timestamp[64];
     strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", tm_info);
 
+    json_write_string(w, "version", "1.0");
+    json_write_string(w, "backend", "jmicron");
+    json_write_string(w, "device", device_path);
+    json_write_string(w, "timestamp", timestamp);
+
+    json_begin_object(w, "controller");
+    json_write_string(w, "model", controller_model ? controller_model : "Unknown");
+    json_write_string(w, "type", "raid_array");
+    json_end(w);
+}
+
+static void format_json_to(json_writer_t* w, const char* device_path, const disk_smart_data_t* disks,
+                           int num_disks, int expected_array_size, int present_disks,
+                           int is_degraded, const char* controller_model,
+                           const jm_timings_t* timings) {
     (void)num_disks;  /* Unused but kept for API consistency */
 
     /* Determine overall RAID status */
@@ -309,7 +374,10 @@ void format_json(const char* device_path, const disk_smart_data_t* disks, int nu
     }
 
     /* Determine status based on array size and disk health */
-    if (expected_array_size > 0 && present_disks > 0) {
+    if (json_fields != NULL && !json_fields->values) {
+        /* SMART values not read: only the disk count can be judged */
+        raid_status = is_degraded && expected_array_size > 0 && present_disks > 0 ? "degraded" : "unknown";
+    } else if (expected_array_size > 0 && present_disks > 0) {
         if (is_degraded) {
             raid_status = "degraded";
         } else if (present_disks > expected_array_size) {
@@ -324,91 +392,69 @@ void format_json(const char* device_path, const disk_smart_data_t* disks, int nu
         raid_status = has_failed_disk ? "failed" : "healthy";
     }
 
-    printf("{\n");
-    printf("  \"version\": \"1.0\",\n");
-    printf("  \"backend\": \"jmicron\",\n");
-    printf("  \"device\": \"%s\",\n", device_path);
-    printf("  \"timestamp\": \"%s\",\n", timestamp);
-
-    /* Controller information */
-    printf("  \"controller\": {\n");
-    printf("    \"model\": \"%s\",\n", controller_model ? controller_model : "Unknown");
-    printf("    \"type\": \"raid_array\"\n");
-    printf("  },\n");
+    json_begin_object(w, NULL);
+    write_json_header(w, device_path, controller_model);
 
     /* RAID status section */
-    printf("  \"raid_status\": {\n");
-    printf("    \"status\": \"%s\",\n", raid_status);
+    json_begin_object(w, "raid_status");
+    json_write_string(w, "status", raid_status);
     if (expected_array_size > 0) {
-        printf("    \"expected_disks\": %d,\n", expected_array_size);
+        json_write_int(w, "expected_disks", expected_array_size);
     }
     if (present_disks > 0) {
-        printf("    \"present_disks\": %d,\n", present_disks);
+        json_write_int(w, "present_disks", present_disks);
     }
-    printf("    \"rebuilding\": false,\n");  /* Not yet detected */
+    json_write_bool(w, "rebuilding", 0);  /* Not yet detected */
 
-    /* Build issues array */
-    printf("    \"issues\": [");
-    int first_issue = 1;
-
-    if (is_degraded && expected_array_size > 0 && present_disks > 0) {
-        if (!first_issue) printf(", ");
-        printf("\n      \"Degraded: Expected %d disk%s but found only %d disk%s\"",
-               expected_array_size, expected_array_size == 1 ? "" : "s",
-               present_disks, present_disks == 1 ? "" : "s");
-        first_issue = 0;
-    } else if (present_disks > expected_array_size && expected_array_size > 0) {
-        if (!first_issue) printf(", ");
-        printf("\n      \"Oversized: Expected %d disk%s but found %d disk%s\"",
-               expected_array_size, expected_array_size == 1 ? "" : "s",
-               present_disks, present_disks == 1 ? "" : "s");
-        first_issue = 0;
+    json_begin_array(w, "issues");
+    if (present_disks > 0) {
+        write_size_issue(w, expected_array_size, present_disks, is_degraded && expected_array_size > 0);
     }
 
     /* Add failed disk issues */
     for (int i = 0; i < 5; i++) {
         if (disks[i].is_present && disks[i].overall_status == DISK_STATUS_FAILED) {
-            if (!first_issue) printf(",");
-            printf("\n      \"Disk %d (%s): SMART health check failed\"",
-                   i, disks[i].disk_name[0] ? disks[i].disk_name : "Unknown");
-            first_issue = 0;
+            char issue[128];
+            snprintf(issue, sizeof(issue), "Disk %d (%s): SMART health check failed",
+                     i, disks[i].disk_name[0] ? disks[i].disk_name : "Unknown");
+            json_write_string(w, NULL, issue);
         }
     }
+    json_end(w);
+    json_end(w);
 
-    if (!first_issue) {
-        printf("\n    ");
-    }
-    printf("]\n");
-    printf("  },\n");
-
-    printf("  \"disks\": [\n");
+    int identity = json_fields == NULL || json_fields->identity;
+    int values = json_fields == NULL || json_fields->values;
+    int thresholds = json_fields == NULL || json_fields->thresholds;
 
-    int first_disk = 1;
+    json_begin_array(w, "disks");
     for (int i = 0; i < 5; i++) {
         if (!disks[i].is_present) {
             continue;
         }
 
-        if (!first_disk) {
-            printf(",\n");
-        }
-        first_disk = 0;
+        json_begin_object(w, NULL);
+        json_write_int(w, "disk_number", i);
+        json_write_string(w, "model", disks[i].disk_name[0] ? disks[i].disk_name : "Unknown");
 
-        printf("    {\n");
-        printf("      \"disk_number\": %d,\n", i);
-        printf("      \"model\": \"%s\",\n",
-               disks[i].disk_name[0] ? disks[i].disk_name : "Unknown");
+        if (identity && disks[i].serial_number[0] != '\0') {
+            json_write_string(w, "serial", disks[i].serial_number);
+        }
 
-        if (disks[i].serial_number[0] != '\0') {
-            printf("      \"serial\": \"%s\",\n", disks[i].serial_number);
+        if (identity && disks[i].firmware_rev[0] != '\0') {
+            json_write_string(w, "firmware", disks[i].firmware_rev);
         }
 
-        if (disks[i].firmware_rev[0] != '\0') {
-            printf("      \"firmware\": \"%s\",\n", disks[i].firmware_rev);
+        if (identity && disks[i].size_mb > 0) {
+            json_write_uint(w, "size_mb", disks[i].size_mb);
         }
 
-        if (disks[i].size_mb > 0) {
-            printf("      \"size_mb\": %llu,\n", (unsigned long long)disks[i].size_mb);
+        if (!values) {
+            if (disks[i].command_retries > 0) {
+                json_write_uint(w, "command_retries", disks[i].command_retries);
+            }
+            json_end(w);
+            continue;
         }
 
         {
@@ -418,31 +464,40 @@ void format_json(const char* device_path, const disk_smart_data_t* disks, int nu
                 case DISK_STATUS_FAILED: s = "failed";  break;
                 default:                 s = "error";   break;
             }
-            printf("      \"overall_status\": \"%s\",\n", s);
+            json_write_string(w, "overall_status", s);
         }
 
-        int temp = get_temperature(&disks[i]);
+        int temp = smart_disk_temperature(&disks[i]);
         if (temp >= 0) {
-            printf("      \"temperature_celsius\": %d,\n", temp);
+            json_write_int(w, "temperature_celsius", temp);
         }
 
         uint64_t hours = get_power_on_hours(&disks[i]);
         if (hours > 0) {
-            printf("      \"power_on_hours\": %llu,\n", (unsigned long long)hours);
+            json_write_uint(w, "power_on_hours", hours);
         }
 
-        printf("      \"attributes\": [\n");
+        if (disks[i].command_retries > 0) {
+            json_write_uint(w, "command_retries", disks[i].command_retries);
+        }
 
+        json_begin_array(w, "attributes");
         for (int j = 0; j < disks[i].num_attributes; j++) {
             const parsed_smart_attribute_t* attr = &disks[i].attributes[j];
 
-            printf("        {\n");
-            printf("          \"id\": %d,\n", attr->id);
-            printf("          \"name\": \"%s\",\n", attr->name);
-            printf("          \"value\": %d,\n", attr->current_value);
-            printf("          \"worst\": %d,\n", attr->worst_value);
-            printf("          \"thresh\": %d,\n", attr->threshold);
-            printf("          \"raw\": %llu,\n", (unsigned long long)attr->raw_value);
+            if (json_fields != NULL && json_fields->filter_attributes && !json_fields->attribute_ids[attr->id]) {
+                continue;
+            }
+
+            json_begin_object(w, NULL);
+            json_write_int(w, "id", attr->id);
+            json_write_string(w, "name", attr->name);
+            json_write_int(w, "value", attr->current_value);
+            json_write_int(w, "worst", attr->worst_value);
+            if (thresholds) {
+                json_write_int(w, "thresh", attr->threshold);
+            }
+            json_write_uint(w, "raw", attr->raw_value);
             {
                 const char* s;
                 switch (attr->status) {
@@ -450,18 +505,302 @@ void format_json(const char* device_path, const disk_smart_data_t* disks, int nu
                     case ATTR_STATUS_FAILED:  s = "failed";  break;
                     default:                  s = "unknown"; break;
                 }
-                printf("          \"status\": \"%s\",\n", s);
+                json_write_string(w, "status", s);
             }
-            printf("          \"critical\": %s\n", attr->is_critical ? "true" : "false");
-            printf("        }%s\n", (j < disks[i].num_attributes - 1) ? "," : "");
+            json_write_bool(w, "critical", attr->is_critical);
+            json_end(w);
         }
+        json_end(w);
+        json_end(w);
+    }
+    json_end(w);
 
-        printf("      ]\n");
-        printf("    }");
+    if (timings != NULL) {
+        jm_timings_write_json(w, "timings", timings);
     }
 
-    printf("\n  ]\n");
-    printf("}\n");
+    json_end(w);
+}
+
+/* Helper: Write a finished document to stdout in one write() and free it */
+static void emit_json(json_writer_t* w) {
+    json_writer_flush(w, stdout);
+    json_writer_free(w);
+}
+
+void format_json(const char* device_path, const disk_smart_data_t* disks, int num_disks,
+                 int expected_array_size, int present_disks, int is_degraded,
+                 const char* controller_model, const jm_timings_t* timings) {
+    json_writer_t w;
+    json_writer_init(&w, 1);
+    format_json_to(&w, device_path, disks, num_disks, expected_array_size,
+                   present_disks, is_degraded, controller_model, timings);
+    emit_json(&w);
+}
+
+void format_json_line(const char* device_path, const disk_smart_data_t* disks, int num_disks,
+                      int expected_array_size, int present_disks, int is_degraded,
+                      const char* controller_model, const jm_timings_t* timings) {
+    json_writer_t w;
+    json_writer_init(&w, 0);
+    format_json_to(&w, device_path, disks, num_disks, expected_array_size,
+                   present_disks, is_degraded, controller_model, timings);
+    emit_json(&w);
+}
+
+void format_json_error(const char* device_path, const char* controller_model, const char* error,
+                       int compact) {
+    json_writer_t w;
+    json_writer_init(&w, !compact);
+    json_begin_object(&w, NULL);
+    write_json_header(&w, device_path, controller_model);
+    json_write_string(&w, "error", error);
+    json_end(&w);
+    emit_json(&w);
+}
+
+/* Helper: Number of disks set in the presence bitmask */
+static int count_present(uint8_t presence) {
+    int count = 0;
+    for (int i = 0; i < 5; i++) {
+        if (presence & (1u << i)) count++;
+    }
+    return count;
+}
+
+const char* raid_flags_status(const jm_raid_flags_t* flags, int expected_array_size) {
+    int present = count_present(flags->presence);
+
+    if (flags->rebuild != 0) {
+        return "rebuilding";
+    }
+    if (expected_array_size > 0 && present < expected_array_size) {
+        return "degraded";
+    }
+    if (expected_array_size > 0 && present > expected_array_size) {
+        return "oversized";
+    }
+    return "healthy";
+}
+
+void format_flags(const char* device_path, const jm_raid_flags_t* flags, int expected_array_size,
+                  const char* controller_model) {
+    const char* status = raid_flags_status(flags, expected_array_size);
+    int present = count_present(flags->presence);
+
+    printf("Device: %s", device_path);
+    if (controller_model) {
+        printf(" (%s)", controller_model);
+    }
+    printf("\n");
+
+    printf("RAID status: ");
+    for (const char* p = status; *p; p++) {
+        putchar(*p >= 'a' && *p <= 'z' ? *p - 'a' + 'A' : *p);
+    }
+    printf("\n");
+
+    printf("  Present disks:  %d", present);
+    if (expected_array_size > 0) {
+        printf(" of %d expected", expected_array_size);
+    }
+    printf(" (slots");
+    for (int i = 0; i < 5; i++) {
+        if (flags->presence & (1u << i)) printf(" %d", i);
+    }
+    printf("; 0x1F0 = 0x%02x)\n", flags->presence);
+    printf("  Rebuild:        %s (0x1F5 = 0x%02x)\n", flags->rebuild ? "in progress" : "no", flags->rebuild);
+    printf("  Phase:          0x%02x (0x1FA)\n", flags->phase);
+}
+
+/* Helper: format_flags_json document */
+static void format_flags_json_to(json_writer_t* w, const char* device_path, const jm_raid_flags_t* flags,
+                                 int expected_array_size, const char* controller_model,
+                                 const jm_timings_t* timings) {
+    const char* status = raid_flags_status(flags, expected_array_size);
+    int present = count_present(flags->presence);
+    int degraded = expected_array_size > 0 && present < expected_array_size;
+
+    json_begin_object(w, NULL);
+    write_json_header(w, device_path, controller_model);
+
+    json_begin_object(w, "raid_status");
+    json_write_string(w, "status", status);
+    if (expected_array_size > 0) {
+        json_write_int(w, "expected_disks", expected_array_size);
+    }
+    json_write_int(w, "present_disks", present);
+    json_begin_inline(w, "present_slots", '[');
+    for (int i = 0; i < 5; i++) {
+        if (flags->presence & (1u << i)) {
+            json_write_int(w, NULL, i);
+        }
+    }
+    json_end(w);
+    json_write_bool(w, "degraded", degraded);
+    json_write_bool(w, "rebuilding", flags->rebuild != 0);
+
+    /* Raw bytes, for scripts that track the undocumented ones too */
+    json_begin_object(w, "flags");
+    json_write_uint(w, "presence", flags->presence);
+    json_write_uint(w, "rebuild", flags->rebuild);
+    json_write_uint(w, "phase", flags->phase);
+    json_write_hex(w, "raw", flags->raw, sizeof(flags->raw));
+    json_end(w);
+
+    json_begin_array(w, "issues");
+    write_size_issue(w, expected_array_size, present, degraded);
+    json_end(w);
+    json_end(w);
+
+    if (timings != NULL) {
+        jm_timings_write_json(w, "timings", timings);
+    }
+
+    json_end(w);
+}
+
+void format_flags_json(const char* device_path, const jm_raid_flags_t* flags, int expected_array_size,
+                       const char* controller_model, const jm_timings_t* timings, int compact) {
+    json_writer_t w;
+    json_writer_init(&w, !compact);
+    format_flags_json_to(&w, device_path, flags, expected_array_size, controller_model, timings);
+    emit_json(&w);
+}
+
+/* Helper: next run of safe sectors at or after *sector that are all empty
+ * (or all in use); returns 0 when there are no more */
+static int next_sector_run(const jm_sector_map_t* empty, int want_empty, uint32_t* sector,
+                           uint32_t* first, uint32_t* last) {
+    uint32_t s = *sector;
+
+    while (s < JM_SAFE_SECTOR_END && (!jm_sector_in_safe_range(s) || jm_sector_map_test(empty, s) != want_empty)) {
+        s++;
+    }
+    if (s >= JM_SAFE_SECTOR_END) {
+        return 0;
+    }
+    *first = s;
+    while (s + 1 < JM_SAFE_SECTOR_END && jm_sector_in_safe_range(s + 1) &&
+           jm_sector_map_test(empty, s + 1) == want_empty) {
+        s++;
+    }
+    *last = s;
+    *sector = s + 1;
+    return 1;
+}
+
+/* Helper: print the runs of one kind as "33, 64-1023, ..." */
+static void print_sector_runs(const jm_sector_map_t* empty, int want_empty) {
+    uint32_t sector = 0, first, last;
+    int n = 0;
+
+    while (next_sector_run(empty, want_empty, &sector, &first, &last)) {
+        if (n++) {
+            printf(", ");
+        }
+        if (first == last) {
+            printf("%u", first);
+        } else {
+            printf("%u-%u", first, last);
+        }
+    }
+    printf(n ? "\n" : "none\n");
+}
+
+/* Safe sectors: 33 and 64-2047 */
+#define SAFE_SECTOR_COUNT (1 + JM_SAFE_SECTOR_END - 64)
+
+void format_sectors(const char* device_path, uint32_t sector, const jm_sector_map_t* empty, int num_empty) {
+    printf("Device: %s\n", device_path);
+    printf("  Empty safe sectors: %d of %d\n", num_empty, SAFE_SECTOR_COUNT);
+    printf("  Empty:    ");
+    print_sector_runs(empty, 1);
+    printf("  Has data: ");
+    print_sector_runs(empty, 0);
+    printf("  Sector %u (--sector): %s\n", sector,
+           jm_sector_map_test(empty, sector) ? "empty" : "CONTAINS DATA");
+}
+
+void format_sectors_json(const char* device_path, uint32_t sector, const jm_sector_map_t* empty,
+                         int num_empty, int compact) {
+    json_writer_t w;
+    time_t now = time(NULL);
+    char timestamp[64];
+    strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+
+    json_writer_init(&w, !compact);
+    json_begin_object(&w, NULL);
+    json_write_string(&w, "version", "1.0");
+    json_write_string(&w, "device", device_path);
+    json_write_string(&w, "timestamp", timestamp);
+    json_write_uint(&w, "sector", sector);
+    json_write_bool(&w, "sector_empty", jm_sector_map_test(empty, sector));
+    json_write_int(&w, "safe_sectors", SAFE_SECTOR_COUNT);
+    json_write_int(&w, "empty_sectors", num_empty);
+
+    uint32_t next = 0, first, last;
+    json_begin_array(&w, "empty_ranges");
+    while (next_sector_run(empty, 1, &next, &first, &last)) {
+        json_begin_inline(&w, NULL, '[');
+        json_write_uint(&w, NULL, first);
+        json_write_uint(&w, NULL, last);
+        json_end(&w);
+    }
+    json_end(&w);
+    json_end(&w);
+    emit_json(&w);
+}
+
+void format_record(const char* device_path, const disk_smart_data_t* disks,
+                   const char* controller_model, const jm_timings_t* timings) {
+    /* Large fixed-size record: keep it off the (per-device thread) stack */
+    health_record_t* rec = malloc(sizeof(health_record_t));
+    if (rec == NULL) {
+        return;
+    }
+
+    health_record_begin(rec, "jmicron", device_path,
+                        controller_model ? controller_model : "Unknown", "raid_array", timings);
+    for (int i = 0; i < 5; i++) {
+        if (!disks[i].is_present) {
+            continue;
+        }
+        /* Same fallback as the JSON "model" field */
+        if (disks[i].disk_name[0] == '\0') {
+            disk_smart_data_t named = disks[i];
+            snprintf(named.disk_name, sizeof(named.disk_name), "Unknown");
+            health_record_add_disk(rec, &named, i);
+        } else {
+            health_record_add_disk(rec, &disks[i], i);
+        }
+    }
+
+    health_record_write(rec, stdout);
+    free(rec);
+}
+
+/* Helper: One row of the timings table */
+static void format_latency_row(const char* name, const jm_latency_t* latency) {
+    if (latency->count == 0) {
+        return;
+    }
+    printf("  %-18s %6u %12.1f %12.1f %12.1f\n", name, latency->count,
+           latency->total_us / 1000.0, latency->total_us / 1000.0 / latency->count,
+           latency->max_us / 1000.0);
+}
+
+void format_timings(const jm_timings_t* timings) {
+    printf("\nTimings (ms):\n");
+    printf("  %-18s %6s %12s %12s %12s\n", "", "count", "total", "avg", "max");
+    for (int i = 0; i < JM_PHASE_COUNT; i++) {
+        format_latency_row(jm_phase_name((jm_phase_t)i), &timings->phases[i]);
+    }
+    for (int i = 0; i < JM_CMD_TYPE_COUNT; i++) {
+        format_latency_row(jm_cmd_type_name((jm_cmd_type_t)i), &timings->commands[i]);
+    }
+    format_latency_row("ioctl write", &timings->ioctl_write);
+    format_latency_row("ioctl read", &timings->ioctl_read);
 }
 
 void format_raw(const uint8_t* data, uint32_t len, const char* label) {
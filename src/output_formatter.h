@@ -9,6 +9,8 @@
 #define OUTPUT_FORMATTER_H
 
 #include "smart_parser.h"
+#include "jm_commands.h"
+#include "jm_timings.h"
 #include <stdint.h>
 
 /* Output format modes */
@@ -19,6 +21,33 @@ typedef enum {
     OUTPUT_MODE_RAW = 3
 } output_mode_t;
 
+/* Disk fields of the JSON output (--fields); disk_number and model are always present */
+typedef struct {
+    int identity;                       /* serial, firmware, size_mb */
+    int values;                         /* overall_status, temperature, power-on hours, attributes */
+    int thresholds;                     /* Each attribute's thresh */
+    int filter_attributes;              /* Only the attributes marked in attribute_ids */
+    uint8_t attribute_ids[256];         /* 1 = emit the attribute with this ID */
+} output_fields_t;
+
+/**
+ * Parse a --fields list: identity, values, thresholds and attribute IDs
+ * (decimal or 0x hex), comma separated. Attribute IDs and thresholds imply
+ * values; IDs restrict the attributes emitted.
+ *
+ * @param spec Comma-separated list
+ * @param fields Output projection
+ * @return 0 on success, -1 on an unknown name or empty list
+ */
+int format_parse_fields(const char* spec, output_fields_t* fields);
+
+/**
+ * Project the JSON output (format_json, format_json_line) onto fields
+ *
+ * @param fields Projection (not copied; must outlive the output), or NULL for every field
+ */
+void format_set_fields(const output_fields_t* fields);
+
 /**
  * Format and print summary view for all disks
  * Shows overall health status and key metrics
@@ -49,10 +78,103 @@ void format_full_smart(const disk_smart_data_t* disk);
  * @param present_disks Number of disks reported by controller (0 = not available)
  * @param is_degraded 1 if RAID is degraded, 0 otherwise
  * @param controller_model Controller model string (optional, can be NULL)
+ * @param timings Per-phase/per-command latencies (--timings), or NULL to omit
  */
 void format_json(const char* device_path, const disk_smart_data_t* disks, int num_disks,
                  int expected_array_size, int present_disks, int is_degraded,
-                 const char* controller_model);
+                 const char* controller_model, const jm_timings_t* timings);
+
+/**
+ * Format and print JSON output as one compact line (NDJSON)
+ * Same document as format_json, for piping to disk-health
+ *
+ * Parameters are the same as format_json.
+ */
+void format_json_line(const char* device_path, const disk_smart_data_t* disks, int num_disks,
+                      int expected_array_size, int present_disks, int is_degraded,
+                      const char* controller_model, const jm_timings_t* timings);
+
+/**
+ * Format and print the document of a device that could not be polled: the
+ * header members of format_json and an "error" string, no disks
+ * (disk-health reports the source as an error)
+ *
+ * @param device_path Device path
+ * @param controller_model Controller model string (optional, can be NULL)
+ * @param error Why the poll failed
+ * @param compact 1 for one compact line (NDJSON), 0 for indented
+ */
+void format_json_error(const char* device_path, const char* controller_model, const char* error,
+                       int compact);
+
+/**
+ * Write the devices' disks as one binary disk-health record (--format=bin)
+ * Carries what disk-health reads from format_json_line, without the text.
+ *
+ * @param device_path Device path
+ * @param disks Array of disk data (5 slots; only present disks are written)
+ * @param controller_model Controller model string (optional, can be NULL)
+ * @param timings Per-phase/per-command latencies (--timings), or NULL to omit
+ */
+void format_record(const char* device_path, const disk_smart_data_t* disks,
+                   const char* controller_model, const jm_timings_t* timings);
+
+/**
+ * Format and print the RAID flags of a --flags poll (no disk data)
+ *
+ * @param device_path Device path (e.g., "/dev/sdc")
+ * @param flags Flags from jm_get_raid_flags
+ * @param expected_array_size Expected number of disks (0 = not specified)
+ * @param controller_model Controller model string (optional, can be NULL)
+ */
+void format_flags(const char* device_path, const jm_raid_flags_t* flags, int expected_array_size,
+                  const char* controller_model);
+
+/**
+ * Format and print the RAID flags as JSON: the raid_status object of
+ * format_json, with the presence bitmask, rebuild and phase bytes filled
+ * in from the controller and no disks array
+ *
+ * @param compact 1 for one compact line (NDJSON), 0 for indented
+ * @param timings Per-phase/per-command latencies (--timings), or NULL to omit
+ * (other parameters as format_flags)
+ */
+void format_flags_json(const char* device_path, const jm_raid_flags_t* flags, int expected_array_size,
+                       const char* controller_model, const jm_timings_t* timings, int compact);
+
+/**
+ * Format and print the empty sectors of a --find-sector scan
+ *
+ * @param device_path Device path (e.g., "/dev/sdc")
+ * @param sector Sector the tool is configured to use (--sector)
+ * @param empty Map from jm_find_empty_sectors
+ * @param num_empty Its return value
+ */
+void format_sectors(const char* device_path, uint32_t sector, const jm_sector_map_t* empty, int num_empty);
+
+/**
+ * Format and print a --find-sector scan as JSON: the configured sector,
+ * whether it is empty, and every empty safe sector as [first, last] ranges
+ *
+ * @param compact 1 for one compact line (NDJSON), 0 for indented
+ * (other parameters as format_sectors)
+ */
+void format_sectors_json(const char* device_path, uint32_t sector, const jm_sector_map_t* empty,
+                         int num_empty, int compact);
+
+/**
+ * Array status derived from the RAID flags
+ * @return "rebuilding", "degraded", "oversized" or "healthy" (degraded and
+ *         oversized need expected_array_size)
+ */
+const char* raid_flags_status(const jm_raid_flags_t* flags, int expected_array_size);
+
+/**
+ * Format and print a latency table (--timings in summary/full mode)
+ *
+ * @param timings Timings of one session
+ */
+void format_timings(const jm_timings_t* timings);
 
 /**
  * Format and print raw hex dump (original behavior)
@@ -11,55 +11,265 @@
 #include <string.h>
 #include <time.h>
 #include <errno.h>
+#include <math.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-char* read_all_stdin(size_t* size) {
-    size_t capacity = 4096;
-    size_t used = 0;
-    char* buffer = malloc(capacity);
+int json_tokenize(const char* json, size_t len, json_tokens_t* tokens) {
+    jsmn_parser parser;
+    /* Roughly one token per 8 bytes of pretty-printed smartctl output */
+    size_t capacity = len / 8 + 64;
 
-    if (!buffer) {
-        fprintf(stderr, "Error: Out of memory\n");
-        return NULL;
+    if (capacity < tokens->capacity) {
+        capacity = tokens->capacity;
     }
 
+    jsmn_init(&parser);
     while (1) {
-        size_t space = capacity - used;
-        if (space < 1024) {
-            capacity *= 2;
-            if (capacity > MAX_JSON_INPUT_SIZE) {
-                fprintf(stderr, "Error: Input too large (>%d bytes)\n", MAX_JSON_INPUT_SIZE);
-                free(buffer);
-                return NULL;
+        if (capacity > tokens->capacity) {
+            jsmntok_t* grown = realloc(tokens->tokens, capacity * sizeof(jsmntok_t));
+            if (!grown) {
+                return JSMN_ERROR_NOMEM;
             }
-            char* new_buffer = realloc(buffer, capacity);
-            if (!new_buffer) {
-                fprintf(stderr, "Error: Out of memory\n");
-                free(buffer);
-                return NULL;
+            tokens->tokens = grown;
+            tokens->capacity = (unsigned int)capacity;
+        }
+
+        /* On NOMEM jsmn keeps its position, so the parse resumes where it stopped */
+        int n = jsmn_parse(&parser, json, len, tokens->tokens, tokens->capacity);
+        if (n != JSMN_ERROR_NOMEM) {
+            return (n == 0) ? JSMN_ERROR_PART : n;
+        }
+        capacity *= 2;
+    }
+}
+
+#define READ_CHUNK 65536
+
+void input_reader_open(input_reader_t* reader, FILE* in) {
+    struct stat st;
+    int fd = fileno(in);
+
+    memset(reader, 0, sizeof(input_reader_t));
+    reader->in = in;
+
+    /* A regular file is mapped whole, from the current offset on */
+    if (fd >= 0 && fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        off_t offset = lseek(fd, 0, SEEK_CUR);
+        if (offset >= 0 && offset < st.st_size) {
+            void* map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (map != MAP_FAILED) {
+                madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+                reader->map = map;
+                reader->map_len = (size_t)st.st_size;
+                input_reader_open_mem(reader, (const char*)map + offset,
+                                      (size_t)(st.st_size - offset));
             }
-            buffer = new_buffer;
-            space = capacity - used;
         }
+    }
+}
 
-        size_t nread = fread(buffer + used, 1, space, stdin);
-        if (nread == 0) {
-            if (feof(stdin)) {
-                break;
+void input_reader_open_mem(input_reader_t* reader, const char* data, size_t len) {
+    void* map = reader->map;
+    size_t map_len = reader->map_len;
+
+    memset(reader, 0, sizeof(input_reader_t));
+    reader->map = map;
+    reader->map_len = map_len;
+    reader->data = data;
+    reader->len = len;
+    reader->in_memory = 1;
+    reader->eof = 1;
+}
+
+void input_reader_free(input_reader_t* reader) {
+    if (reader->map != NULL) {
+        munmap(reader->map, reader->map_len);
+    }
+    free(reader->buf);
+    memset(reader, 0, sizeof(input_reader_t));
+    reader->eof = 1;
+}
+
+/**
+ * Read the next chunk of a pipe behind the unconsumed input
+ * Consumed input is dropped first, so the buffer only ever holds the
+ * current line or document plus one chunk. One read() takes whatever the
+ * pipe holds: waiting for a full chunk (as fread does) would hold back a
+ * slow producer's lines, e.g. a daemon's, until 64 KB had arrived.
+ * @return 1 if data was added, 0 at end of input, -1 on error
+ */
+static int input_fill(input_reader_t* reader) {
+    if (reader->eof) {
+        return 0;
+    }
+
+    if (reader->pos > 0) {
+        memmove(reader->buf, reader->buf + reader->pos, reader->len - reader->pos);
+        reader->len -= reader->pos;
+        reader->scan -= reader->pos;
+        reader->pos = 0;
+    }
+
+    if (reader->len + READ_CHUNK > reader->cap) {
+        size_t cap = reader->cap ? reader->cap : READ_CHUNK;
+        while (reader->len + READ_CHUNK > cap) cap *= 2;
+        char* buf = realloc(reader->buf, cap);
+        if (!buf) {
+            reader->error = "out of memory";
+            reader->eof = 1;
+            return -1;
+        }
+        reader->buf = buf;
+        reader->cap = cap;
+    }
+
+    ssize_t nread;
+    do {
+        nread = read(fileno(reader->in), reader->buf + reader->len, READ_CHUNK);
+    } while (nread < 0 && errno == EINTR);
+    reader->data = reader->buf;
+    if (nread > 0) {
+        reader->len += (size_t)nread;
+        return 1;
+    }
+
+    reader->eof = 1;
+    if (nread < 0) {
+        reader->error = strerror(errno);
+        return -1;
+    }
+    return 0;
+}
+
+int input_next_line(input_reader_t* reader, const char** line, size_t* len) {
+    while (1) {
+        if (reader->scan < reader->pos) {
+            reader->scan = reader->pos;
+        }
+        const char* nl = (reader->scan < reader->len)
+            ? memchr(reader->data + reader->scan, '\n', reader->len - reader->scan) : NULL;
+
+        if (nl != NULL) {
+            size_t end = (size_t)(nl - reader->data);
+            *line = reader->data + reader->pos;
+            *len = end - reader->pos;
+            reader->pos = reader->scan = end + 1;
+            return 1;
+        }
+        reader->scan = reader->len;
+
+        int filled = input_fill(reader);
+        if (filled < 0) {
+            return -1;
+        }
+        if (filled == 0) {
+            if (reader->pos >= reader->len) {
+                return 0;
+            }
+            /* Final line without a newline */
+            *line = reader->data + reader->pos;
+            *len = reader->len - reader->pos;
+            reader->pos = reader->scan = reader->len;
+            return 1;
+        }
+    }
+}
+
+int input_peek(input_reader_t* reader, size_t want, const char** data, size_t* avail) {
+    while (reader->len - reader->pos < want) {
+        int filled = input_fill(reader);
+        if (filled < 0) {
+            return -1;
+        }
+        if (filled == 0) {
+            break;
+        }
+    }
+    *data = reader->data + reader->pos;
+    *avail = reader->len - reader->pos;
+    return 0;
+}
+
+void input_skip(input_reader_t* reader, size_t n) {
+    reader->pos += n;
+    if (reader->scan < reader->pos) {
+        reader->scan = reader->pos;
+    }
+}
+
+int input_next_document(input_reader_t* reader, const char** doc, size_t* len) {
+    while (1) {
+        while (reader->scan < reader->len) {
+            char c = reader->data[reader->scan++];
+
+            if (reader->skip_line) {
+                if (c == '\n') {
+                    reader->skip_line = 0;
+                    reader->pos = reader->scan;
+                }
+                continue;
             }
-            if (ferror(stdin)) {
-                fprintf(stderr, "Error reading stdin: %s\n", strerror(errno));
-                free(buffer);
-                return NULL;
+            if (reader->in_string) {
+                if (reader->escaped) reader->escaped = 0;
+                else if (c == '\\') reader->escaped = 1;
+                else if (c == '"') reader->in_string = 0;
+                continue;
             }
+            if (reader->depth == 0) {
+                if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+                    reader->pos = reader->scan;
+                    continue;
+                }
+                if (c != '{' && c != '[') {
+                    reader->skip_line = 1;
+                    reader->error = "input is not a JSON document";
+                    return -1;
+                }
+            }
+
+            if (c == '"') {
+                reader->in_string = 1;
+            } else if (c == '{' || c == '[') {
+                reader->depth++;
+            } else if (c == '}' || c == ']') {
+                if (--reader->depth == 0) {
+                    *doc = reader->data + reader->pos;
+                    *len = reader->scan - reader->pos;
+                    reader->pos = reader->scan;
+                    return 1;
+                }
+            }
+        }
+
+        if (reader->skip_line) {
+            /* Nothing in a skipped line is kept */
+            reader->pos = reader->scan;
+        }
+        int filled = input_fill(reader);
+        if (filled < 0) {
+            return -1;
+        }
+        if (filled == 0) {
+            break;
         }
-        used += nread;
     }
 
-    buffer[used] = '\0';
-    if (size) {
-        *size = used;
+    if (reader->depth > 0) {
+        reader->depth = reader->in_string = reader->escaped = 0;
+        reader->pos = reader->len;
+        reader->error = "truncated JSON document";
+        return -1;
     }
-    return buffer;
+    return 0;
+}
+
+int json_token_skip(const jsmntok_t* tokens, int num_tokens, int idx) {
+    int end = tokens[idx].end;
+    int k = idx + 1;
+    while (k < num_tokens && tokens[k].start < end) k++;
+    return k;
 }
 
 int json_token_streq(const char* json, jsmntok_t* tok, const char* s) {
@@ -144,7 +354,6 @@ int json_find_key(const char* json, jsmntok_t* tokens, jsmntok_t* obj_tok, const
     for (int count = 0; count < obj_tok->size; count++) {
         /* Each property is key-value pair */
         jsmntok_t* key_tok = &tokens[i];
-        jsmntok_t* val_tok = &tokens[i + 1];
 
         if (json_token_streq(json, key_tok, key)) {
             return i + 1;  /* Return index of value token */
@@ -165,28 +374,303 @@ int json_find_key(const char* json, jsmntok_t* tokens, jsmntok_t* obj_tok, const
     return -1;
 }
 
+/* Escape letter of each byte that can't appear in a JSON string as is
+ * ('u' = \u00XX), 0 for bytes copied through */
+static const char json_escapes[256] = {
+    [0 ... 7] = 'u', ['\b'] = 'b', ['\t'] = 't', ['\n'] = 'n', [11] = 'u',
+    ['\f'] = 'f', ['\r'] = 'r', [14 ... 31] = 'u',
+    ['"'] = '"', ['\\'] = '\\',
+};
+
+static const char hex_digits[] = "0123456789abcdef";
+
 void json_output_string(const char* str) {
     putchar('"');
-    for (const char* p = str; *p; p++) {
-        switch (*p) {
-            case '"':  printf("\\\""); break;
-            case '\\': printf("\\\\"); break;
-            case '\b': printf("\\b"); break;
-            case '\f': printf("\\f"); break;
-            case '\n': printf("\\n"); break;
-            case '\r': printf("\\r"); break;
-            case '\t': printf("\\t"); break;
-            default:
-                if ((unsigned char)*p < 32) {
-                    printf("\\u%04x", (unsigned char)*p);
-                } else {
-                    putchar(*p);
-                }
+    for (const unsigned char* p = (const unsigned char*)str; *p; p++) {
+        char esc = json_escapes[*p];
+        if (esc == 0) {
+            putchar(*p);
+        } else if (esc == 'u') {
+            printf("\\u%04x", *p);
+        } else {
+            putchar('\\');
+            putchar(esc);
         }
     }
     putchar('"');
 }
 
+void json_writer_init(json_writer_t* w, int pretty) {
+    memset(w, 0, sizeof(*w));
+    w->pretty = pretty;
+}
+
+void json_writer_reset(json_writer_t* w, int pretty) {
+    w->len = 0;
+    w->pretty = pretty;
+    w->failed = 0;
+    w->depth = 0;
+}
+
+void json_writer_free(json_writer_t* w) {
+    free(w->buf);
+    json_writer_init(w, w->pretty);
+}
+
+/* Helper: Make room for n more bytes; 0 on success */
+static int writer_reserve(json_writer_t* w, size_t n) {
+    if (w->failed) {
+        return -1;
+    }
+    if (w->len + n > w->cap) {
+        size_t cap = w->cap ? w->cap : 4096;
+        while (w->len + n > cap) {
+            cap *= 2;
+        }
+        char* grown = realloc(w->buf, cap);
+        if (grown == NULL) {
+            w->failed = 1;
+            return -1;
+        }
+        w->buf = grown;
+        w->cap = cap;
+    }
+    return 0;
+}
+
+/* Helper: Append raw bytes */
+static void writer_put(json_writer_t* w, const char* data, size_t n) {
+    if (writer_reserve(w, n) == 0) {
+        memcpy(w->buf + w->len, data, n);
+        w->len += n;
+    }
+}
+
+static void writer_putc(json_writer_t* w, char c) {
+    if (writer_reserve(w, 1) == 0) {
+        w->buf[w->len++] = c;
+    }
+}
+
+/* Helper: Append a quoted, escaped string, copying unescaped runs whole */
+static void writer_put_string(json_writer_t* w, const char* str) {
+    const unsigned char* p = (const unsigned char*)str;
+
+    writer_putc(w, '"');
+    while (*p) {
+        const unsigned char* run = p;
+        while (*p && json_escapes[*p] == 0) {
+            p++;
+        }
+        writer_put(w, (const char*)run, (size_t)(p - run));
+        if (*p == '\0') {
+            break;
+        }
+
+        char esc[6] = { '\\', json_escapes[*p] };
+        if (esc[1] == 'u') {
+            esc[2] = '0';
+            esc[3] = '0';
+            esc[4] = hex_digits[*p >> 4];
+            esc[5] = hex_digits[*p & 0x0F];
+            writer_put(w, esc, 6);
+        } else {
+            writer_put(w, esc, 2);
+        }
+        p++;
+    }
+    writer_putc(w, '"');
+}
+
+/* Helper: Append an unsigned decimal */
+static void writer_put_uint(json_writer_t* w, uint64_t value) {
+    char digits[20];
+    int n = 0;
+
+    do {
+        digits[sizeof(digits) - 1 - n++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    writer_put(w, digits + sizeof(digits) - n, (size_t)n);
+}
+
+/* Helper: Newline and two spaces per open level (pretty mode) */
+static void writer_newline(json_writer_t* w) {
+    size_t n = 1 + 2 * (size_t)w->depth;
+    if (writer_reserve(w, n) == 0) {
+        w->buf[w->len] = '\n';
+        memset(w->buf + w->len + 1, ' ', n - 1);
+        w->len += n;
+    }
+}
+
+/* Helper: Separator, indentation and key ahead of a member */
+static void writer_member(json_writer_t* w, const char* key) {
+    if (w->depth > 0) {
+        int level = w->depth - 1;
+        int first = w->members[level]++ == 0;
+
+        if (!first) {
+            writer_putc(w, ',');
+        }
+        if (w->pretty && w->is_inline[level]) {
+            if (!first) {
+                writer_putc(w, ' ');
+            }
+        } else if (w->pretty) {
+            writer_newline(w);
+        }
+    }
+    if (key != NULL) {
+        writer_put_string(w, key);
+        writer_put(w, ": ", w->pretty ? 2 : 1);
+    }
+}
+
+/* Helper: Open a container one level down */
+static void writer_begin(json_writer_t* w, const char* key, char open, int is_inline) {
+    writer_member(w, key);
+    if (w->depth >= JSON_WRITER_MAX_DEPTH) {
+        w->failed = 1;
+        return;
+    }
+    writer_putc(w, open);
+    w->members[w->depth] = 0;
+    w->closer[w->depth] = open == '[' ? ']' : '}';
+    /* Inside an inline container everything stays on its line */
+    w->is_inline[w->depth] = is_inline || (w->depth > 0 && w->is_inline[w->depth - 1]);
+    w->depth++;
+}
+
+void json_begin_object(json_writer_t* w, const char* key) {
+    writer_begin(w, key, '{', 0);
+}
+
+void json_begin_array(json_writer_t* w, const char* key) {
+    writer_begin(w, key, '[', 0);
+}
+
+void json_begin_inline(json_writer_t* w, const char* key, char open) {
+    writer_begin(w, key, open, 1);
+}
+
+void json_end(json_writer_t* w) {
+    if (w->depth == 0) {
+        return;
+    }
+    int level = --w->depth;
+    if (w->pretty && !w->is_inline[level] && w->members[level] > 0) {
+        writer_newline(w);
+    }
+    writer_putc(w, w->closer[level]);
+    if (w->depth == 0) {
+        writer_putc(w, '\n');
+    }
+}
+
+void json_write_string(json_writer_t* w, const char* key, const char* value) {
+    writer_member(w, key);
+    if (value != NULL) {
+        writer_put_string(w, value);
+    } else {
+        writer_put(w, "null", 4);
+    }
+}
+
+void json_write_int(json_writer_t* w, const char* key, int64_t value) {
+    writer_member(w, key);
+    if (value < 0) {
+        writer_putc(w, '-');
+        writer_put_uint(w, (uint64_t)0 - (uint64_t)value);
+    } else {
+        writer_put_uint(w, (uint64_t)value);
+    }
+}
+
+void json_write_uint(json_writer_t* w, const char* key, uint64_t value) {
+    writer_member(w, key);
+    writer_put_uint(w, value);
+}
+
+void json_write_double(json_writer_t* w, const char* key, double value, int decimals) {
+    char text[32];
+    int n;
+
+    writer_member(w, key);
+    if (!isfinite(value)) {
+        writer_put(w, "null", 4);
+        return;
+    }
+    n = decimals < 0 ? snprintf(text, sizeof(text), "%g", value)
+                     : snprintf(text, sizeof(text), "%.*f", decimals, value);
+    if (n > 0 && (size_t)n < sizeof(text)) {
+        writer_put(w, text, (size_t)n);
+    } else {
+        writer_put(w, "null", 4);
+    }
+}
+
+void json_write_bool(json_writer_t* w, const char* key, int value) {
+    writer_member(w, key);
+    if (value) {
+        writer_put(w, "true", 4);
+    } else {
+        writer_put(w, "false", 5);
+    }
+}
+
+void json_write_null(json_writer_t* w, const char* key) {
+    writer_member(w, key);
+    writer_put(w, "null", 4);
+}
+
+void json_write_hex(json_writer_t* w, const char* key, const uint8_t* bytes, size_t n) {
+    writer_member(w, key);
+    if (writer_reserve(w, 2 * n + 2) != 0) {
+        return;
+    }
+    w->buf[w->len++] = '"';
+    for (size_t i = 0; i < n; i++) {
+        w->buf[w->len++] = hex_digits[bytes[i] >> 4];
+        w->buf[w->len++] = hex_digits[bytes[i] & 0x0F];
+    }
+    w->buf[w->len++] = '"';
+}
+
+int json_writer_flush(json_writer_t* w, FILE* out) {
+    size_t done = 0;
+    int ret = 0;
+
+    if (w->failed) {
+        w->len = 0;
+        return -1;
+    }
+
+    /* Anything already printed through stdio goes first */
+    if (fflush(out) != 0) {
+        ret = -1;
+    }
+    int fd = fileno(out);
+    if (fd < 0) {
+        /* Memory stream: no descriptor to write to */
+        if (fwrite(w->buf, 1, w->len, out) != w->len) {
+            ret = -1;
+        }
+    } else {
+        while (done < w->len) {
+            ssize_t n = write(fd, w->buf + done, w->len - done);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                ret = -1;
+                break;
+            }
+            done += (size_t)n;
+        }
+    }
+    w->len = 0;
+    return ret;
+}
+
 void get_timestamp(char* buf, size_t bufsize) {
     time_t now = time(NULL);
     struct tm* tm_info = gmtime(&now);
@@ -9,20 +9,122 @@
 #define PARSERS_COMMON_H
 
 #include <stdint.h>
+#include <stdio.h>
+#include <string.h>
 #include "../jsmn/jsmn.h"
 
-/* Maximum JSON input size (10MB) */
-#define MAX_JSON_INPUT_SIZE (10 * 1024 * 1024)
+/**
+ * Helper: Check a key token against a string literal
+ * For key dispatch: switch on the token length first, then compare.
+ */
+#define JSON_KEY_IS(json, tok, lit) \
+    ((tok)->end - (tok)->start == (int)sizeof(lit) - 1 && \
+     memcmp((json) + (tok)->start, (lit), sizeof(lit) - 1) == 0)
+
+/* Token array reused across documents; grows, never shrinks */
+typedef struct {
+    jsmntok_t* tokens;
+    unsigned int capacity;
+} json_tokens_t;
+
+/**
+ * Tokenize a JSON document into a reusable token array
+ * The array starts at an estimate from len and grows until the document
+ * fits. Initialize with {NULL, 0}; free tokens->tokens when done.
+ * @param json JSON text
+ * @param len Length of json
+ * @param tokens Token array (grown as needed)
+ * @return Token count, or a negative jsmn error
+ */
+int json_tokenize(const char* json, size_t len, json_tokens_t* tokens);
+
+/**
+ * Reads input as lines or JSON documents without copying it
+ * A regular file is mapped whole; a pipe is read in chunks, and each line
+ * or document is handed out from the chunk buffer in place.
+ */
+typedef struct {
+    FILE* in;                   /* NULL once the whole input is in memory */
+    const char* data;           /* Mapped file, caller's memory, or buf */
+    size_t len;
+    char* buf;                  /* Chunk buffer for pipes */
+    size_t cap;
+    void* map;                  /* mmap of a regular file */
+    size_t map_len;
+    int in_memory;              /* Returned text stays valid until input_reader_free */
+    int eof;
+
+    size_t pos;                 /* Start of the unconsumed input */
+    size_t scan;                /* Scan position */
+    int depth;                  /* Document scanner state */
+    int in_string;
+    int escaped;
+    int skip_line;              /* Discarding a line that isn't JSON */
+    const char* error;          /* Why the last call returned -1 */
+} input_reader_t;
+
+/**
+ * Open a reader on a stream; regular files are mapped instead of read
+ * The stream is read through its descriptor, so nothing may have been read
+ * from it through stdio before.
+ */
+void input_reader_open(input_reader_t* reader, FILE* in);
 
-/* Maximum tokens for JSON parsing */
-#define MAX_JSON_TOKENS 10000
+/**
+ * Open a reader on a buffer already in memory (not copied)
+ */
+void input_reader_open_mem(input_reader_t* reader, const char* data, size_t len);
 
 /**
- * Read all input from stdin
- * @param size Output size of data read
- * @return Allocated buffer with stdin contents (caller must free), or NULL on error
+ * Release the reader's mapping or chunk buffer
+ */
+void input_reader_free(input_reader_t* reader);
+
+/**
+ * Read the next line
+ * @param reader Reader
+ * @param line Output line, without its newline (not NUL-terminated; valid
+ *             until the next call, or until input_reader_free if in_memory)
+ * @param len Output line length
+ * @return 1 for a line, 0 at end of input, -1 on a read error (see reader->error)
+ */
+int input_next_line(input_reader_t* reader, const char** line, size_t* len);
+
+/**
+ * Look at the unconsumed input without consuming it
+ * @param reader Reader
+ * @param want Bytes wanted (reads more of a pipe until there are this many)
+ * @param data Output start of the unconsumed input (valid as for input_next_line)
+ * @param avail Output bytes available; less than want only at end of input
+ * @return 0 on success, -1 on a read error (see reader->error)
+ */
+int input_peek(input_reader_t* reader, size_t want, const char** data, size_t* avail);
+
+/**
+ * Consume n bytes returned by input_peek
+ */
+void input_skip(input_reader_t* reader, size_t n);
+
+/**
+ * Read the next top-level JSON object or array
+ * Documents may be pretty-printed, one per line, or run together.
+ * Text outside a document is skipped to the end of its line.
+ * @param reader Reader
+ * @param doc Output document (not NUL-terminated; valid as for input_next_line)
+ * @param len Output document length
+ * @return 1 for a document, 0 at end of input, -1 for skipped input
+ *         (see reader->error; reading may continue)
+ */
+int input_next_document(input_reader_t* reader, const char** doc, size_t* len);
+
+/**
+ * Helper: Index of the first token after token idx and everything inside it
+ * @param tokens Token array
+ * @param num_tokens Number of tokens
+ * @param idx Token to skip
+ * @return Next sibling's index (num_tokens at the end)
  */
-char* read_all_stdin(size_t* size);
+int json_token_skip(const jsmntok_t* tokens, int num_tokens, int idx);
 
 /**
  * Helper: Check if JSON token matches a string
@@ -77,6 +179,89 @@ int json_find_key(const char* json, jsmntok_t* tokens, jsmntok_t* obj_tok, const
  */
 void json_output_string(const char* str);
 
+#define JSON_WRITER_MAX_DEPTH 16
+
+/**
+ * Buffered JSON writer
+ * A document is built in memory and reaches the output with a single
+ * write(), so NDJSON lines of processes sharing a pipe never interleave.
+ * Pretty mode indents two spaces per level; compact mode emits no
+ * whitespace. Members take a key inside objects and NULL elsewhere. The
+ * buffer is kept across documents; after running out of memory the
+ * writer stays failed until reset and flushes nothing.
+ */
+typedef struct json_writer {
+    char* buf;
+    size_t len;
+    size_t cap;
+    int pretty;
+    int failed;
+    int depth;
+    int members[JSON_WRITER_MAX_DEPTH];     /* Members written at each open level */
+    char closer[JSON_WRITER_MAX_DEPTH];     /* '}' or ']' */
+    char is_inline[JSON_WRITER_MAX_DEPTH];  /* Pretty mode: members on one line */
+} json_writer_t;
+
+/**
+ * Initialize a writer (no allocation until the first member)
+ * @param pretty Non-zero for indented output, zero for one compact line
+ */
+void json_writer_init(json_writer_t* w, int pretty);
+
+/**
+ * Start a new document, keeping the buffer
+ */
+void json_writer_reset(json_writer_t* w, int pretty);
+
+/**
+ * Free the buffer
+ */
+void json_writer_free(json_writer_t* w);
+
+/**
+ * Open an object or array
+ * The inline variant keeps its members on one line in pretty mode
+ * ("{"count": 1, ...}"), for short fixed-shape values.
+ */
+void json_begin_object(json_writer_t* w, const char* key);
+void json_begin_array(json_writer_t* w, const char* key);
+void json_begin_inline(json_writer_t* w, const char* key, char open);
+
+/**
+ * Close the innermost object or array
+ * Closing the outermost one ends the document with a newline.
+ */
+void json_end(json_writer_t* w);
+
+/**
+ * Members (key is NULL in arrays)
+ */
+void json_write_string(json_writer_t* w, const char* key, const char* value);
+void json_write_int(json_writer_t* w, const char* key, int64_t value);
+void json_write_uint(json_writer_t* w, const char* key, uint64_t value);
+void json_write_bool(json_writer_t* w, const char* key, int value);
+void json_write_null(json_writer_t* w, const char* key);
+
+/**
+ * A number with a fixed count of decimals, or as short as %g with decimals < 0
+ * NaN and infinities, which JSON has no form for, are written as null.
+ */
+void json_write_double(json_writer_t* w, const char* key, double value, int decimals);
+
+/**
+ * Bytes as one lowercase hex string
+ */
+void json_write_hex(json_writer_t* w, const char* key, const uint8_t* bytes, size_t n);
+
+/**
+ * Write out everything buffered so far and empty the buffer
+ * One write() to out's file descriptor after flushing out (or one fwrite
+ * for memory streams). Can be called between members to stream a large
+ * document; the writer's nesting state is kept.
+ * @return 0 on success, -1 on a write error or if the writer failed
+ */
+int json_writer_flush(json_writer_t* w, FILE* out);
+
 /**
  * Get current timestamp in ISO 8601 format
  * @param buf Output buffer
@@ -0,0 +1,207 @@
+/*
+ * smartctl_json.c - Parse smartctl --json output
+ *
+ * Copyright (C) 2026 Jamie Treworgy
+ * SPDX-License-Identifier: MIT
+ */
+
+#define JSMN_HEADER
+#include "../jsmn/jsmn.h"
+#include "smartctl_json.h"
+#include "common.h"
+#include "../smart_attributes.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Top-level keys we extract; everything else (logs, tables) is skipped whole */
+typedef enum {
+    KEY_OTHER = 0,
+    KEY_DEVICE,
+    KEY_MODEL_NAME,
+    KEY_TEMPERATURE,
+    KEY_SERIAL_NUMBER,
+    KEY_USER_CAPACITY,
+    KEY_FIRMWARE_VERSION,
+    KEY_ATA_SMART_ATTRIBUTES
+} top_key_t;
+
+/* Keys of one ata_smart_attributes.table entry */
+typedef enum {
+    ATTR_KEY_OTHER = 0,
+    ATTR_KEY_ID,
+    ATTR_KEY_RAW,
+    ATTR_KEY_VALUE,
+    ATTR_KEY_WORST,
+    ATTR_KEY_THRESH
+} attr_key_t;
+
+/* Helper: Identify a top-level key by length, then first byte */
+static top_key_t classify_top_key(const char* json, const jsmntok_t* key) {
+    switch (key->end - key->start) {
+        case 6:  return JSON_KEY_IS(json, key, "device") ? KEY_DEVICE : KEY_OTHER;
+        case 10: return JSON_KEY_IS(json, key, "model_name") ? KEY_MODEL_NAME : KEY_OTHER;
+        case 11: return JSON_KEY_IS(json, key, "temperature") ? KEY_TEMPERATURE : KEY_OTHER;
+        case 13:
+            if (json[key->start] == 's') {
+                return JSON_KEY_IS(json, key, "serial_number") ? KEY_SERIAL_NUMBER : KEY_OTHER;
+            }
+            return JSON_KEY_IS(json, key, "user_capacity") ? KEY_USER_CAPACITY : KEY_OTHER;
+        case 16: return JSON_KEY_IS(json, key, "firmware_version") ? KEY_FIRMWARE_VERSION : KEY_OTHER;
+        case 20: return JSON_KEY_IS(json, key, "ata_smart_attributes") ? KEY_ATA_SMART_ATTRIBUTES : KEY_OTHER;
+        default: return KEY_OTHER;
+    }
+}
+
+/* Helper: Identify an attribute key by length, then first byte */
+static attr_key_t classify_attr_key(const char* json, const jsmntok_t* key) {
+    switch (key->end - key->start) {
+        case 2: return JSON_KEY_IS(json, key, "id") ? ATTR_KEY_ID : ATTR_KEY_OTHER;
+        case 3: return JSON_KEY_IS(json, key, "raw") ? ATTR_KEY_RAW : ATTR_KEY_OTHER;
+        case 5:
+            if (json[key->start] == 'v') {
+                return JSON_KEY_IS(json, key, "value") ? ATTR_KEY_VALUE : ATTR_KEY_OTHER;
+            }
+            return JSON_KEY_IS(json, key, "worst") ? ATTR_KEY_WORST : ATTR_KEY_OTHER;
+        case 6: return JSON_KEY_IS(json, key, "thresh") ? ATTR_KEY_THRESH : ATTR_KEY_OTHER;
+        default: return ATTR_KEY_OTHER;
+    }
+}
+
+/* Helper: Parse one ata_smart_attributes.table entry */
+static void parse_attribute(const char* json, jsmntok_t* tokens, int num_tokens, int obj,
+                            parsed_smart_attribute_t* attr) {
+    memset(attr, 0, sizeof(parsed_smart_attribute_t));
+
+    int k = obj + 1;
+    for (int member = 0; member < tokens[obj].size && k + 1 < num_tokens; member++) {
+        jsmntok_t* value = &tokens[k + 1];
+        int val;
+
+        switch (classify_attr_key(json, &tokens[k])) {
+            case ATTR_KEY_ID:
+                if (json_token_toint(json, value, &val) == 0) attr->id = (uint8_t)val;
+                break;
+            case ATTR_KEY_VALUE:
+                if (json_token_toint(json, value, &val) == 0) attr->current_value = (uint8_t)val;
+                break;
+            case ATTR_KEY_WORST:
+                if (json_token_toint(json, value, &val) == 0) attr->worst_value = (uint8_t)val;
+                break;
+            case ATTR_KEY_THRESH:
+                if (json_token_toint(json, value, &val) == 0) attr->threshold = (uint8_t)val;
+                break;
+            case ATTR_KEY_RAW: {
+                /* raw.value */
+                int raw = json_find_key(json, tokens, value, "value");
+                if (raw >= 0) json_token_touint64(json, &tokens[raw], &attr->raw_value);
+                break;
+            }
+            default:
+                break;
+        }
+        k = json_token_skip(tokens, num_tokens, k + 1);
+    }
+
+    /* Get attribute definition for name and criticality */
+    const smart_attribute_def_t* def = get_attribute_definition(attr->id);
+    if (def) {
+        attr->name = def->name;
+        attr->is_critical = def->is_critical;
+    }
+}
+
+/* Helper: Parse the ata_smart_attributes.table array */
+static void parse_attribute_table(const char* json, jsmntok_t* tokens, int num_tokens, int array,
+                                  smartctl_data_t* data) {
+    int k = array + 1;
+    for (int element = 0; element < tokens[array].size && k < num_tokens &&
+                          data->num_attributes < MAX_SMART_ATTRIBUTES; element++) {
+        if (tokens[k].type == JSMN_OBJECT) {
+            parse_attribute(json, tokens, num_tokens, k, &data->attributes[data->num_attributes]);
+            data->num_attributes++;
+        }
+        k = json_token_skip(tokens, num_tokens, k);
+    }
+}
+
+/**
+ * Parse smartctl JSON and extract fields
+ */
+int parse_smartctl_json(const char* json, smartctl_data_t* data) {
+    json_tokens_t tokens = { NULL, 0 };
+    int ret = parse_smartctl_json_tokens(json, strlen(json), &tokens, data);
+    free(tokens.tokens);
+    return ret;
+}
+
+/**
+ * Parse smartctl JSON with a token array reused across documents
+ */
+int parse_smartctl_json_tokens(const char* json, size_t len, json_tokens_t* token_buf,
+                               smartctl_data_t* data) {
+    int num_tokens = json_tokenize(json, len, token_buf);
+    jsmntok_t* tokens = token_buf->tokens;
+
+    if (num_tokens < 0) {
+        fprintf(stderr, "Error: Failed to parse JSON (error %d)\n", num_tokens);
+        return -1;
+    }
+
+    if (tokens[0].type != JSMN_OBJECT) {
+        fprintf(stderr, "Error: Root element must be object\n");
+        return -1;
+    }
+
+    memset(data, 0, sizeof(smartctl_data_t));
+
+    /* Walk the root object's members; each value is skipped as a whole */
+    int k = 1;
+    for (int member = 0; member < tokens[0].size && k + 1 < num_tokens; member++) {
+        jsmntok_t* value = &tokens[k + 1];
+        int found;
+
+        switch (classify_top_key(json, &tokens[k])) {
+            case KEY_MODEL_NAME:
+                json_token_tostr(json, value, data->model, sizeof(data->model));
+                break;
+            case KEY_SERIAL_NUMBER:
+                json_token_tostr(json, value, data->serial, sizeof(data->serial));
+                break;
+            case KEY_FIRMWARE_VERSION:
+                json_token_tostr(json, value, data->firmware, sizeof(data->firmware));
+                break;
+            case KEY_DEVICE:
+                /* device.name */
+                if ((found = json_find_key(json, tokens, value, "name")) >= 0) {
+                    json_token_tostr(json, &tokens[found], data->device, sizeof(data->device));
+                }
+                break;
+            case KEY_USER_CAPACITY:
+                /* user_capacity.bytes */
+                if ((found = json_find_key(json, tokens, value, "bytes")) >= 0) {
+                    json_token_touint64(json, &tokens[found], &data->size_bytes);
+                }
+                break;
+            case KEY_TEMPERATURE:
+                /* temperature.current */
+                if ((found = json_find_key(json, tokens, value, "current")) >= 0) {
+                    json_token_toint(json, &tokens[found], &data->temperature);
+                    data->has_temperature = 1;
+                }
+                break;
+            case KEY_ATA_SMART_ATTRIBUTES:
+                /* ata_smart_attributes.table array */
+                if ((found = json_find_key(json, tokens, value, "table")) >= 0 &&
+                    tokens[found].type == JSMN_ARRAY) {
+                    parse_attribute_table(json, tokens, num_tokens, found, data);
+                }
+                break;
+            default:
+                break;
+        }
+        k = json_token_skip(tokens, num_tokens, k + 1);
+    }
+
+    return 0;
+}
@@ -0,0 +1,49 @@
+/*
+ * smartctl_json.h - Parse smartctl --json output
+ *
+ * Copyright (C) 2026 Jamie Treworgy
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef PARSERS_SMARTCTL_JSON_H
+#define PARSERS_SMARTCTL_JSON_H
+
+#include "../smart_parser.h"
+#include "common.h"
+#include <stdint.h>
+
+/* Parsed smartctl data */
+typedef struct {
+    char device[256];
+    char model[64];
+    char serial[64];
+    char firmware[16];
+    uint64_t size_bytes;
+
+    parsed_smart_attribute_t attributes[MAX_SMART_ATTRIBUTES];
+    int num_attributes;
+
+    int temperature;
+    int has_temperature;
+} smartctl_data_t;
+
+/**
+ * Parse smartctl JSON and extract fields
+ * @param json NUL-terminated smartctl --json output
+ * @param data Output parsed data
+ * @return 0 on success, -1 on error
+ */
+int parse_smartctl_json(const char* json, smartctl_data_t* data);
+
+/**
+ * Parse smartctl JSON with a token array reused across documents
+ * @param json smartctl --json output (NUL-terminated)
+ * @param len Length of json
+ * @param tokens Token array (grown as needed)
+ * @param data Output parsed data
+ * @return 0 on success, -1 on error
+ */
+int parse_smartctl_json_tokens(const char* json, size_t len, json_tokens_t* tokens,
+                               smartctl_data_t* data);
+
+#endif /* PARSERS_SMARTCTL_JSON_H */
@@ -5,285 +5,359 @@
  * SPDX-License-Identifier: MIT
  *
  * Usage: smartctl --json=c /dev/sda | smartctl-parser
- * Output: Single line of compact JSON in disk-health format
+ *        { smartctl --json=c /dev/sda; smartctl --json=c /dev/sdb; } | smartctl-parser
+ *        smartctl-parser --exec /dev/sda /dev/sdb
+ * Output: One line of compact JSON in disk-health format per drive
  */
 
-#define JSMN_STATIC
-#include "../jsmn/jsmn.h"
+#define JSMN_HEADER  /* jsmn declarations only (via common.h) */
+#include "smartctl_json.h"
 #include "common.h"
-#include "../smart_parser.h"
-#include "../smart_attributes.h"
+#include "../aggregator/source_runner.h"
+#include "../health_record.h"
+#include <getopt.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-/* Parsed smartctl data */
-typedef struct {
-    char device[256];
-    char model[64];
-    char serial[64];
-    char firmware[16];
-    uint64_t size_bytes;
-
-    parsed_smart_attribute_t attributes[MAX_SMART_ATTRIBUTES];
-    int num_attributes;
-
-    int temperature;
-    int has_temperature;
-} smartctl_data_t;
-
-/**
- * Parse smartctl JSON and extract fields
- */
-static int parse_smartctl_json(const char* json, smartctl_data_t* data) {
-    jsmn_parser parser;
-    jsmntok_t tokens[MAX_JSON_TOKENS];
-
-    jsmn_init(&parser);
-    int num_tokens = jsmn_parse(&parser, json, strlen(json), tokens, MAX_JSON_TOKENS);
-
-    if (num_tokens < 0) {
-        fprintf(stderr, "Error: Failed to parse JSON (error %d)\n", num_tokens);
-        return -1;
-    }
-
-    if (num_tokens < 1 || tokens[0].type != JSMN_OBJECT) {
-        fprintf(stderr, "Error: Root element must be object\n");
-        return -1;
-    }
+#define DEFAULT_SMARTCTL "smartctl"
+#define DEFAULT_EXEC_TIMEOUT_S 30
+#define MAX_EXEC_TIMEOUT_S 3600
 
-    memset(data, 0, sizeof(smartctl_data_t));
-
-    /* Simple linear scan - in jsmn, keys and values are sequential tokens */
-    for (int i = 0; i < num_tokens - 1; i++) {
-        jsmntok_t* t = &tokens[i];
-
-        if (t->type != JSMN_STRING) continue;
-
-        /* Top-level fields */
-        if (json_token_streq(json, t, "model_name")) {
-            json_token_tostr(json, &tokens[i + 1], data->model, sizeof(data->model));
-        }
-        else if (json_token_streq(json, t, "serial_number")) {
-            json_token_tostr(json, &tokens[i + 1], data->serial, sizeof(data->serial));
-        }
-        else if (json_token_streq(json, t, "firmware_version")) {
-            json_token_tostr(json, &tokens[i + 1], data->firmware, sizeof(data->firmware));
-        }
-        /* device.name */
-        else if (json_token_streq(json, t, "device") && tokens[i + 1].type == JSMN_OBJECT) {
-            /* Look for "name" key within this object */
-            int obj_end = tokens[i + 1].end;
-            for (int j = i + 2; j < num_tokens && tokens[j].start < obj_end; j++) {
-                if (json_token_streq(json, &tokens[j], "name")) {
-                    json_token_tostr(json, &tokens[j + 1], data->device, sizeof(data->device));
-                    break;
-                }
-            }
-        }
-        /* user_capacity.bytes */
-        else if (json_token_streq(json, t, "user_capacity") && tokens[i + 1].type == JSMN_OBJECT) {
-            int obj_end = tokens[i + 1].end;
-            for (int j = i + 2; j < num_tokens && tokens[j].start < obj_end; j++) {
-                if (json_token_streq(json, &tokens[j], "bytes")) {
-                    json_token_touint64(json, &tokens[j + 1], &data->size_bytes);
-                    break;
-                }
-            }
-        }
-        /* temperature.current */
-        else if (json_token_streq(json, t, "temperature") && tokens[i + 1].type == JSMN_OBJECT) {
-            int obj_end = tokens[i + 1].end;
-            for (int j = i + 2; j < num_tokens && tokens[j].start < obj_end; j++) {
-                if (json_token_streq(json, &tokens[j], "current")) {
-                    json_token_toint(json, &tokens[j + 1], &data->temperature);
-                    data->has_temperature = 1;
-                    break;
-                }
-            }
-        }
-        /* ata_smart_attributes.table array */
-        else if (json_token_streq(json, t, "ata_smart_attributes") && tokens[i + 1].type == JSMN_OBJECT) {
-            int obj_end = tokens[i + 1].end;
-            for (int j = i + 2; j < num_tokens && tokens[j].start < obj_end; j++) {
-                if (json_token_streq(json, &tokens[j], "table") && tokens[j + 1].type == JSMN_ARRAY) {
-                    /* Parse array of SMART attributes */
-                    int array_end = tokens[j + 1].end;
-                    int k = j + 2;  /* First element after array token */
-
-                    while (k < num_tokens && tokens[k].start < array_end &&
-                           data->num_attributes < MAX_SMART_ATTRIBUTES) {
-                        if (tokens[k].type == JSMN_OBJECT) {
-                            parsed_smart_attribute_t* attr = &data->attributes[data->num_attributes];
-                            memset(attr, 0, sizeof(parsed_smart_attribute_t));
-
-                            int attr_end = tokens[k].end;
-                            /* Parse this attribute object */
-                            for (int m = k + 1; m < num_tokens && tokens[m].start < attr_end; m++) {
-                                if (json_token_streq(json, &tokens[m], "id")) {
-                                    int id;
-                                    json_token_toint(json, &tokens[m + 1], &id);
-                                    attr->id = (uint8_t)id;
-                                }
-                                else if (json_token_streq(json, &tokens[m], "value")) {
-                                    int val;
-                                    json_token_toint(json, &tokens[m + 1], &val);
-                                    attr->current_value = (uint8_t)val;
-                                }
-                                else if (json_token_streq(json, &tokens[m], "worst")) {
-                                    int val;
-                                    json_token_toint(json, &tokens[m + 1], &val);
-                                    attr->worst_value = (uint8_t)val;
-                                }
-                                else if (json_token_streq(json, &tokens[m], "thresh")) {
-                                    int val;
-                                    json_token_toint(json, &tokens[m + 1], &val);
-                                    attr->threshold = (uint8_t)val;
-                                }
-                                else if (json_token_streq(json, &tokens[m], "raw") &&
-                                         tokens[m + 1].type == JSMN_OBJECT) {
-                                    /* raw.value */
-                                    int raw_end = tokens[m + 1].end;
-                                    for (int n = m + 2; n < num_tokens && tokens[n].start < raw_end; n++) {
-                                        if (json_token_streq(json, &tokens[n], "value")) {
-                                            json_token_touint64(json, &tokens[n + 1], &attr->raw_value);
-                                            break;
-                                        }
-                                    }
-                                }
-                            }
-
-                            /* Get attribute definition for name and criticality */
-                            const smart_attribute_def_t* def = get_attribute_definition(attr->id);
-                            if (def) {
-                                attr->name = def->name;
-                                attr->is_critical = def->is_critical;
-                            }
-
-                            data->num_attributes++;
-
-                            /* Skip to end of this object */
-                            k++;
-                            while (k < num_tokens && tokens[k].start < attr_end) k++;
-                        } else {
-                            k++;
-                        }
-                    }
-                    break;
-                }
-            }
-        }
-    }
+/* Command line options */
+typedef struct {
+    int exec;                   /* Remaining arguments are devices to run smartctl on */
+    const char* smartctl;       /* smartctl command for --exec */
+    int timeout_s;
+    int binary;                 /* --format=bin */
+} cli_options_t;
 
-    return 0;
+/* Buffers shared by every document of a batch */
+typedef struct {
+    json_tokens_t tokens;
+    smartctl_data_t data;
+    int binary;
+    json_writer_t json;         /* One line at a time, buffer reused */
+    disk_smart_data_t disk;     /* --format=bin */
+    health_record_t record;
+} batch_t;
+
+/* Simple check: a normalized value below its threshold fails */
+static int attribute_failed(const parsed_smart_attribute_t* attr) {
+    return attr->threshold > 0 && attr->current_value < attr->threshold;
 }
 
 /**
  * Output disk-health format JSON (compact, one line)
  */
-static void output_disk_health_json(const smartctl_data_t* data) {
+static void output_disk_health_json(json_writer_t* w, const smartctl_data_t* data) {
     char timestamp[64];
     get_timestamp(timestamp, sizeof(timestamp));
 
     /* Determine overall status (simple check: any threshold failures?) */
     const char* overall_status = "healthy";
     for (int i = 0; i < data->num_attributes; i++) {
-        const parsed_smart_attribute_t* attr = &data->attributes[i];
-        if (attr->threshold > 0 && attr->current_value < attr->threshold) {
+        if (attribute_failed(&data->attributes[i])) {
             overall_status = "failed";
             break;
         }
     }
 
-    /* Output compact JSON (one line) */
-    printf("{");
-    printf("\"version\":\"1.0\",");
-    printf("\"backend\":\"smartctl\",");
-    printf("\"device\":");
-    json_output_string(data->device);
-    printf(",");
-    printf("\"timestamp\":");
-    json_output_string(timestamp);
-    printf(",");
+    json_writer_reset(w, 0);
+    json_begin_object(w, NULL);
+    json_write_string(w, "version", "1.0");
+    json_write_string(w, "backend", "smartctl");
+    json_write_string(w, "device", data->device);
+    json_write_string(w, "timestamp", timestamp);
 
     /* Controller (N/A for single disks) */
-    printf("\"controller\":{");
-    printf("\"model\":\"N/A\",");
-    printf("\"type\":\"single_disk\"");
-    printf("},");
+    json_begin_object(w, "controller");
+    json_write_string(w, "model", "N/A");
+    json_write_string(w, "type", "single_disk");
+    json_end(w);
 
     /* No RAID status for single disks */
-    printf("\"raid_status\":null,");
+    json_write_null(w, "raid_status");
 
     /* Disks array (single disk) */
-    printf("\"disks\":[{");
-    printf("\"disk_number\":0,");
-    printf("\"model\":");
-    json_output_string(data->model);
-    printf(",");
-    printf("\"serial\":");
-    json_output_string(data->serial);
-    printf(",");
-    printf("\"firmware\":");
-    json_output_string(data->firmware);
-    printf(",");
-    printf("\"size_mb\":%llu,", (unsigned long long)(data->size_bytes / (1024 * 1024)));
-    printf("\"overall_status\":");
-    json_output_string(overall_status);
-    printf(",");
+    json_begin_array(w, "disks");
+    json_begin_object(w, NULL);
+    json_write_int(w, "disk_number", 0);
+    json_write_string(w, "model", data->model);
+    json_write_string(w, "serial", data->serial);
+    json_write_string(w, "firmware", data->firmware);
+    json_write_uint(w, "size_mb", data->size_bytes / (1024 * 1024));
+    json_write_string(w, "overall_status", overall_status);
 
     /* Attributes array */
-    printf("\"attributes\":[");
+    json_begin_array(w, "attributes");
     for (int i = 0; i < data->num_attributes; i++) {
         const parsed_smart_attribute_t* attr = &data->attributes[i];
-        if (i > 0) printf(",");
-
-        printf("{");
-        printf("\"id\":%d,", attr->id);
-        printf("\"name\":");
-        json_output_string(attr->name ? attr->name : "Unknown");
-        printf(",");
-        printf("\"value\":%d,", attr->current_value);
-        printf("\"worst\":%d,", attr->worst_value);
-        printf("\"thresh\":%d,", attr->threshold);
-        printf("\"raw\":%llu,", (unsigned long long)attr->raw_value);
-
-        /* Status */
-        const char* status = "ok";
-        if (attr->threshold > 0 && attr->current_value < attr->threshold) {
-            status = "failed";
+
+        json_begin_object(w, NULL);
+        json_write_int(w, "id", attr->id);
+        json_write_string(w, "name", attr->name ? attr->name : "Unknown");
+        json_write_int(w, "value", attr->current_value);
+        json_write_int(w, "worst", attr->worst_value);
+        json_write_int(w, "thresh", attr->threshold);
+        json_write_uint(w, "raw", attr->raw_value);
+        json_write_string(w, "status", attribute_failed(attr) ? "failed" : "ok");
+        json_write_bool(w, "critical", attr->is_critical);
+        json_end(w);
+    }
+    json_end(w);
+
+    json_end(w);  /* Close disk */
+    json_end(w);  /* Close disks array */
+    json_end(w);  /* Close root object (ends the NDJSON line) */
+
+    json_writer_flush(w, stdout);
+}
+
+/**
+ * Output one binary disk-health record (--format=bin)
+ * Same content as output_disk_health_json.
+ */
+static void output_disk_health_record(batch_t* batch) {
+    const smartctl_data_t* data = &batch->data;
+    disk_smart_data_t* disk = &batch->disk;
+
+    memset(disk, 0, sizeof(disk_smart_data_t));
+    disk->is_present = 1;
+    /* Serial and firmware fields have the ATA IDENTIFY sizes; longer strings are cut to them */
+    snprintf(disk->disk_name, sizeof(disk->disk_name), "%.*s", (int)sizeof(disk->disk_name) - 1, data->model);
+    snprintf(disk->serial_number, sizeof(disk->serial_number), "%.*s",
+             (int)sizeof(disk->serial_number) - 1, data->serial);
+    snprintf(disk->firmware_rev, sizeof(disk->firmware_rev), "%.*s",
+             (int)sizeof(disk->firmware_rev) - 1, data->firmware);
+    disk->size_mb = data->size_bytes / (1024 * 1024);
+    disk->overall_status = DISK_STATUS_PASSED;
+
+    disk->num_attributes = data->num_attributes;
+    for (int i = 0; i < data->num_attributes; i++) {
+        disk->attributes[i] = data->attributes[i];
+        disk->attributes[i].status = ATTR_STATUS_PASSED;
+        if (attribute_failed(&data->attributes[i])) {
+            disk->attributes[i].status = ATTR_STATUS_FAILED;
+            disk->overall_status = DISK_STATUS_FAILED;
         }
-        printf("\"status\":");
-        json_output_string(status);
-        printf(",");
-        printf("\"critical\":%s", attr->is_critical ? "true" : "false");
-        printf("}");
     }
-    printf("]");
 
-    printf("}]");  /* Close disks array */
-    printf("}");   /* Close root object */
-    printf("\n");  /* Newline for NDJSON */
+    health_record_begin(&batch->record, "smartctl", data->device, "N/A", "single_disk", NULL);
+    health_record_add_disk(&batch->record, disk, 0);
+    health_record_write(&batch->record, stdout);
 }
 
-int main(void) {
-    /* Read all input from stdin */
-    size_t input_size;
-    char* input = read_all_stdin(&input_size);
-    if (!input) {
-        return 1;
+/**
+ * Convert every smartctl document a reader returns
+ * @param fallback_device Device name for documents without one (may be NULL)
+ * @return Number of documents converted, or -1 if any input was rejected
+ */
+static int convert_stream(batch_t* batch, input_reader_t* reader, const char* fallback_device) {
+    const char* doc;
+    size_t len;
+    int converted = 0, failed = 0, ret;
+
+    while ((ret = input_next_document(reader, &doc, &len)) != 0) {
+        if (ret < 0) {
+            fprintf(stderr, "Error: Skipping input: %s\n", reader->error);
+            failed = 1;
+            continue;
+        }
+        if (parse_smartctl_json_tokens(doc, len, &batch->tokens, &batch->data) != 0) {
+            failed = 1;
+            continue;
+        }
+        if (batch->data.device[0] == '\0' && fallback_device != NULL) {
+            snprintf(batch->data.device, sizeof(batch->data.device), "%s", fallback_device);
+        }
+        if (batch->binary) {
+            output_disk_health_record(batch);
+        } else {
+            output_disk_health_json(&batch->json, &batch->data);
+        }
+        converted++;
     }
+    return failed ? -1 : converted;
+}
 
-    /* Parse smartctl JSON */
-    smartctl_data_t data;
-    if (parse_smartctl_json(input, &data) != 0) {
-        free(input);
+/* Helper: Build "<smartctl> --json=c --all '<device>'" */
+static char* exec_command(const char* smartctl, const char* device) {
+    size_t size = strlen(smartctl) + 4 * strlen(device) + 32;
+    char* command = malloc(size);
+    if (command == NULL) {
+        return NULL;
+    }
+
+    size_t n = (size_t)snprintf(command, size, "%s --json=c --all '", smartctl);
+    for (const char* p = device; *p; p++) {
+        if (*p == '\'') {
+            memcpy(command + n, "'\\''", 4);  /* close, escaped quote, reopen */
+            n += 4;
+        } else {
+            command[n++] = *p;
+        }
+    }
+    command[n++] = '\'';
+    command[n] = '\0';
+    return command;
+}
+
+/**
+ * Run smartctl on every device concurrently, then convert the outputs in
+ * device order
+ * @return 0 if every device produced a document, 1 otherwise
+ */
+static int convert_devices(batch_t* batch, const cli_options_t* options,
+                           char** devices, int num_devices) {
+    source_proc_t* procs = calloc((size_t)num_devices, sizeof(source_proc_t));
+    char** commands = calloc((size_t)num_devices, sizeof(char*));
+    int status = 0;
+
+    if (procs == NULL || commands == NULL) {
+        fprintf(stderr, "Error: Out of memory\n");
+        free(procs);
+        free(commands);
         return 1;
     }
 
-    /* Output disk-health format JSON */
-    output_disk_health_json(&data);
+    for (int i = 0; i < num_devices; i++) {
+        commands[i] = exec_command(options->smartctl, devices[i]);
+        source_proc_init(&procs[i], commands[i] ? commands[i] : "false");
+    }
+
+    source_run_all(procs, num_devices, options->timeout_s * 1000, NULL, NULL);
+
+    for (int i = 0; i < num_devices; i++) {
+        char failure[64];
+        int converted = 0;
+
+        /* smartctl's exit status is a bit mask of drive problems, so any
+         * document it printed is still converted */
+        if (procs[i].buf != NULL && procs[i].len > 0) {
+            input_reader_t reader;
+            input_reader_open_mem(&reader, procs[i].buf, procs[i].len);
+            converted = convert_stream(batch, &reader, devices[i]);
+            input_reader_free(&reader);
+        }
+
+        if (converted <= 0) {
+            if (source_failure(&procs[i], options->timeout_s * 1000, failure, sizeof(failure))) {
+                fprintf(stderr, "Error: %s: smartctl %s\n", devices[i], failure);
+            } else if (converted == 0) {
+                fprintf(stderr, "Error: %s: smartctl produced no JSON\n", devices[i]);
+            }
+            status = 1;
+        }
+
+        source_proc_free(&procs[i]);
+        free(commands[i]);
+    }
+
+    free(procs);
+    free(commands);
+    return status;
+}
+
+/**
+ * Parse command-line arguments
+ */
+static void parse_arguments(int argc, char** argv, cli_options_t* options) {
+    memset(options, 0, sizeof(cli_options_t));
+    options->smartctl = DEFAULT_SMARTCTL;
+    options->timeout_s = DEFAULT_EXEC_TIMEOUT_S;
+
+    static struct option long_options[] = {
+        {"exec", no_argument, 0, 'e'},
+        {"smartctl", required_argument, 0, 'C'},
+        {"timeout", required_argument, 0, 't'},
+        {"format", required_argument, 0, 'F'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "et:h", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'e':
+                options->exec = 1;
+                break;
+            case 'C':
+                options->smartctl = optarg;
+                break;
+            case 't': {
+                char* end;
+                long value = strtol(optarg, &end, 10);
+                if (*end != '\0' || value < 1 || value > MAX_EXEC_TIMEOUT_S) {
+                    fprintf(stderr, "Error: --timeout must be 1-%d seconds\n", MAX_EXEC_TIMEOUT_S);
+                    exit(1);
+                }
+                options->timeout_s = (int)value;
+                break;
+            }
+            case 'F':
+                if (strcmp(optarg, "json") != 0 && strcmp(optarg, "bin") != 0) {
+                    fprintf(stderr, "Error: --format must be json or bin\n");
+                    exit(1);
+                }
+                options->binary = (strcmp(optarg, "bin") == 0);
+                break;
+            case 'h':
+                printf("Usage: smartctl-parser [OPTIONS]\n");
+                printf("       smartctl-parser --exec [OPTIONS] DEVICE...\n\n");
+                printf("Convert smartctl JSON to disk-health format\n\n");
+                printf("Options:\n");
+                printf("  -e, --exec     Run smartctl on each DEVICE (concurrently) instead\n");
+                printf("                 of reading stdin\n");
+                printf("      --smartctl CMD\n");
+                printf("                 smartctl command for --exec (default: %s)\n", DEFAULT_SMARTCTL);
+                printf("  -t, --timeout SEC\n");
+                printf("                 Per-device deadline for --exec (default: %d)\n",
+                       DEFAULT_EXEC_TIMEOUT_S);
+                printf("      --format=FMT\n");
+                printf("                 json (default) or bin: binary disk-health records\n");
+                printf("  -h, --help     Show this help\n\n");
+                printf("Input: smartctl --json documents on stdin, concatenated or one per line\n");
+                printf("Output: One disk-health NDJSON line per drive\n");
+                exit(0);
+            default:
+                exit(1);
+        }
+    }
+
+    if (options->exec && optind >= argc) {
+        fprintf(stderr, "Error: --exec needs at least one device\n");
+        exit(1);
+    }
+    if (!options->exec && optind < argc) {
+        fprintf(stderr, "Error: Devices are only accepted with --exec\n");
+        exit(1);
+    }
+}
+
+int main(int argc, char** argv) {
+    cli_options_t options;
+    parse_arguments(argc, argv, &options);
+
+    /* Large parsed-data struct: keep it off the stack */
+    static batch_t batch;
+    batch.binary = options.binary;
+
+    int status;
+    if (options.exec) {
+        status = convert_devices(&batch, &options, argv + optind, argc - optind);
+    } else {
+        input_reader_t reader;
+        input_reader_open(&reader, stdin);
+        int converted = convert_stream(&batch, &reader, NULL);
+        if (converted == 0) {
+            fprintf(stderr, "Error: No smartctl JSON on stdin\n");
+        }
+        status = converted > 0 ? 0 : 1;
+        input_reader_free(&reader);
+    }
 
-    free(input);
-    return 0;
+    free(batch.tokens.tokens);
+    json_writer_free(&batch.json);
+    return status;
 }
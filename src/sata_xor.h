@@ -10,8 +10,15 @@
 
 #include <stdint.h>
 
+/*
+ * JMicron XOR scrambling pattern (128 32-bit words, 32-byte aligned)
+ */
+extern const uint32_t sata_xor_pattern[128];
+
 /*
  * Apply XOR scrambling/descrambling to 512-byte buffer
+ * Uses AVX2, SSE2 or NEON when the CPU has them (chosen at startup),
+ * otherwise a scalar loop
  *
  * @param theData Pointer to 512-byte buffer (128 32-bit words)
  */
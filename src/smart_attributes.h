@@ -10,16 +10,24 @@
 
 #include <stdint.h>
 
+/* Built-in health check applied to an attribute's raw value */
+typedef enum {
+    ATTR_CHECK_THRESHOLD = 0,   // Manufacturer threshold only
+    ATTR_CHECK_RAW_NONZERO,     // Any non-zero raw count fails (reallocated, pending, ...)
+    ATTR_CHECK_TEMPERATURE      // Raw low byte is °C, compared to the temperature limit
+} attribute_check_t;
+
 /* SMART attribute definition */
 typedef struct {
     uint8_t id;
     const char* name;
     const char* description;
     int is_critical;        // 1 if failure indicates imminent disk failure
+    attribute_check_t check;
 } smart_attribute_def_t;
 
 /**
- * Get attribute definition by ID
+ * Get attribute definition by ID (direct table lookup)
  * @param id SMART attribute ID (e.g., 0x05 for Reallocated Sector Count)
  * @return Pointer to attribute definition, or NULL if unknown
  */
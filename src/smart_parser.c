@@ -54,63 +54,60 @@ int smart_parse_thresholds(const uint8_t* raw_data, smart_thresholds_page_t* thr
     return 0;
 }
 
-attribute_health_status_t assess_attribute_health(const parsed_smart_attribute_t* attr) {
-    if (attr == NULL) {
-        return ATTR_STATUS_UNKNOWN;
-    }
-
-    /* Get global config */
+const health_rule_t* smart_lookup_rule(uint8_t id, health_rule_t* scratch) {
     const smart_config_t* config = smart_get_config();
 
-    /* Check config for custom threshold on this attribute */
-    if (config != NULL && config->attributes != NULL) {
-        for (int i = 0; i < config->num_attributes; i++) {
-            if (config->attributes[i].id == attr->id) {
-                /* Found custom threshold for this attribute */
-                if (config->attributes[i].has_raw_critical) {
-                    if (attr->raw_value > config->attributes[i].raw_critical) {
-                        return ATTR_STATUS_FAILED;
-                    }
-                    /* Custom threshold passed, continue to other checks */
-                }
-            }
-        }
+    if (config != NULL) {
+        return &config->rules[id];
     }
+    config_builtin_rule(id, scratch);
+    return scratch;
+}
 
-    /* Special handling for temperature (0xC2, 0xBE, 0xE7) */
-    if (attr->id == 0xC2 || attr->id == 0xBE || attr->id == 0xE7) {
-        uint8_t temp = (uint8_t)attr->raw_value;  // Temperature is in lowest byte
-        uint8_t temp_threshold = 60;  // Default
+int smart_attribute_temperature(uint8_t id, uint64_t raw_value) {
+    health_rule_t scratch;
 
-        /* Use config temperature threshold if specified */
-        if (config != NULL && config->has_temp_critical) {
-            temp_threshold = config->temp_critical;
-        }
+    if (smart_lookup_rule(id, &scratch)->check != ATTR_CHECK_TEMPERATURE) {
+        return -1;
+    }
+    return (int)(uint8_t)raw_value;
+}
 
-        if (temp >= temp_threshold) {
-            return ATTR_STATUS_FAILED;
+int smart_disk_temperature(const disk_smart_data_t* disk) {
+    for (int i = 0; i < disk->num_attributes; i++) {
+        int temp = smart_attribute_temperature(disk->attributes[i].id, disk->attributes[i].raw_value);
+        if (temp >= 0) {
+            return temp;
         }
-        return ATTR_STATUS_PASSED;
     }
+    return -1;
+}
 
-    /* Critical attributes with non-zero raw values indicate failure
-     * (only if no custom threshold was set for this attribute) */
-    if (attr->is_critical) {
-        /* Reallocated/pending/uncorrectable sectors */
-        if ((attr->id == 0x05 || attr->id == 0xC5 || attr->id == 0xC6 ||
-             attr->id == 0xBB || attr->id == 0xB8) && attr->raw_value > 0) {
-            return ATTR_STATUS_FAILED;
-        }
+attribute_health_status_t assess_attribute_health(const parsed_smart_attribute_t* attr) {
+    if (attr == NULL) {
+        return ATTR_STATUS_UNKNOWN;
+    }
 
-        /* Spin retry count */
-        if (attr->id == 0x0A && attr->raw_value > 0) {
-            return ATTR_STATUS_FAILED;
-        }
+    /* One table lookup covers the config thresholds and the built-in checks */
+    const smart_config_t* config = smart_get_config();
+    health_rule_t scratch;
+    const health_rule_t* rule = smart_lookup_rule(attr->id, &scratch);
 
-        /* Reallocation event count */
-        if (attr->id == 0xC4 && attr->raw_value > 0) {
-            return ATTR_STATUS_FAILED;
-        }
+    /* Custom raw threshold from config (if passed, continue to other checks) */
+    if (rule->has_raw_critical && attr->raw_value > rule->raw_critical) {
+        return ATTR_STATUS_FAILED;
+    }
+
+    /* Temperature (0xC2, 0xBE, 0xE7) is in the lowest raw byte */
+    if (rule->check == ATTR_CHECK_TEMPERATURE) {
+        uint8_t temp = (uint8_t)attr->raw_value;
+        return (temp >= rule->temp_critical) ? ATTR_STATUS_FAILED : ATTR_STATUS_PASSED;
+    }
+
+    /* Reallocated/pending/uncorrectable sectors, spin retries and
+     * reallocation events: any non-zero raw count indicates failure */
+    if (attr->is_critical && rule->check == ATTR_CHECK_RAW_NONZERO && attr->raw_value > 0) {
+        return ATTR_STATUS_FAILED;
     }
 
     /* Check current value against manufacturer threshold (if enabled in config) */
@@ -162,6 +159,13 @@ int smart_combine_data(int disk_num, const char* disk_name,
         data->disk_name[sizeof(data->disk_name) - 1] = '\0';
     }
 
+    /* Index thresholds by ID; walk backwards so the first entry for an ID wins */
+    uint8_t threshold_by_id[256];
+    memset(threshold_by_id, 0, sizeof(threshold_by_id));
+    for (int j = 29; j >= 0; j--) {
+        threshold_by_id[thresholds->thresholds[j].id] = thresholds->thresholds[j].threshold;
+    }
+
     /* Parse each attribute */
     int attr_count = 0;
     for (int i = 0; i < 30 && attr_count < MAX_SMART_ATTRIBUTES; i++) {
@@ -172,22 +176,15 @@ int smart_combine_data(int disk_num, const char* disk_name,
             continue;
         }
 
-        /* Find corresponding threshold */
-        uint8_t threshold = 0;
-        for (int j = 0; j < 30; j++) {
-            if (thresholds->thresholds[j].id == attr->id) {
-                threshold = thresholds->thresholds[j].threshold;
-                break;
-            }
-        }
-
-        /* Get attribute definition */
-        const smart_attribute_def_t* def = get_attribute_definition(attr->id);
+        /* Corresponding threshold and compiled rule */
+        uint8_t threshold = threshold_by_id[attr->id];
+        health_rule_t scratch;
+        const health_rule_t* rule = smart_lookup_rule(attr->id, &scratch);
 
         /* Fill in parsed attribute */
         parsed_smart_attribute_t* parsed = &data->attributes[attr_count];
         parsed->id = attr->id;
-        parsed->name = (def != NULL) ? def->name : "Unknown_Attribute";
+        parsed->name = (rule->name != NULL) ? rule->name : "Unknown_Attribute";
         parsed->current_value = attr->current_value;
         parsed->worst_value = attr->worst_value;
         parsed->threshold = threshold;
@@ -201,7 +198,7 @@ int smart_combine_data(int disk_num, const char* disk_name,
         }
 
         parsed->raw_value = raw_val;
-        parsed->is_critical = (def != NULL) ? def->is_critical : 0;
+        parsed->is_critical = rule->is_critical;
         parsed->status = ATTR_STATUS_UNKNOWN;  // Will be assessed later
 
         attr_count++;
@@ -67,6 +67,7 @@ typedef struct {
     parsed_smart_attribute_t attributes[MAX_SMART_ATTRIBUTES];
     int num_attributes;
     int is_present;         // 0 if disk not present in array
+    uint32_t command_retries;  // Commands re-issued for this disk (CRC mismatch/timeout)
 } disk_smart_data_t;
 
 /* SMART values page structure (512 bytes) */
@@ -163,4 +164,28 @@ void smart_set_config(const smart_config_t* config);
  */
 const smart_config_t* smart_get_config(void);
 
+/**
+ * Compiled health rule for an attribute ID
+ * The global config's rule table, or the built-in rule without one.
+ * @param id SMART attribute ID
+ * @param scratch Holds a built-in rule (returned when no config is set)
+ * @return Rule (config-owned or scratch)
+ */
+const health_rule_t* smart_lookup_rule(uint8_t id, health_rule_t* scratch);
+
+/**
+ * Temperature reading of an attribute whose rule is a temperature check
+ * (0xC2, 0xBE and 0xE7 unless the config says otherwise)
+ * @param id SMART attribute ID
+ * @param raw_value Attribute raw value (degrees Celsius in the low byte)
+ * @return Degrees Celsius, or -1 if the attribute is not a temperature
+ */
+int smart_attribute_temperature(uint8_t id, uint64_t raw_value);
+
+/**
+ * Temperature of a disk from its first temperature attribute
+ * @return Degrees Celsius, or -1 if the disk reports none
+ */
+int smart_disk_temperature(const disk_smart_data_t* disk);
+
 #endif /* SMART_PARSER_H */
@@ -11,6 +11,9 @@ BIN_DIR="$PROJECT_ROOT/bin"
 DATA_DIR="$PROJECT_ROOT/tests/data"
 
 DISK_HEALTH="$BIN_DIR/disk-health"
+SMARTCTL_PARSER="$BIN_DIR/smartctl-parser"
+JM_HISTORY="$BIN_DIR/jm-history"
+MONITORD="$BIN_DIR/jmraid-monitord"
 
 # Colors for output
 RED='\033[0;31m'
@@ -157,9 +160,470 @@ else
     test_fail "JSON summary fields incorrect"
 fi
 
+test_start "Source timings passed through to JSON"
+OUTPUT=$(cat "$DATA_DIR/jmicron/healthy-4disk-timings.json" "$DATA_DIR/smartctl/healthy-ssd.json" | "$DISK_HEALTH" --json 2>&1)
+if echo "$OUTPUT" | python3 -c "
+import sys, json
+d = json.load(sys.stdin)
+t = d['sources'][0]['timings']
+assert t['commands']['smart_values'] == {'count': 4, 'total_us': 24880, 'max_us': 11920}, 'smart_values stats'
+assert t['phases']['wakeup']['max_us'] == 6120, 'wakeup phase'
+assert t['ioctls']['read']['count'] == 13, 'ioctl reads'
+assert 'timings' not in d['sources'][1], 'No timings for sources without them'
+" 2>/dev/null; then
+    test_pass
+else
+    test_fail "Timings missing or wrong in aggregated JSON"
+fi
+
+echo
+echo "Test Suite: Streaming"
+
+test_start "Streamed JSON matches the batch report"
+BATCH=$(cat "$DATA_DIR/jmicron/"*.json "$DATA_DIR/smartctl/healthy-ssd.json" | "$DISK_HEALTH" --json 2>&1 | grep -v '"timestamp"')
+STREAMED=$(cat "$DATA_DIR/jmicron/"*.json "$DATA_DIR/smartctl/healthy-ssd.json" | "$DISK_HEALTH" --json --stream 2>&1 | grep -v '"timestamp"')
+if [ -n "$BATCH" ] && [ "$BATCH" = "$STREAMED" ]; then
+    test_pass
+else
+    test_fail "Streamed JSON differs from the batch JSON"
+fi
+
+test_start "Streaming has no source limit"
+OUTPUT=$(for i in $(seq 40); do cat "$DATA_DIR/jmicron/healthy-4disk.json"; done | "$DISK_HEALTH" --stream 2>&1)
+EXIT_CODE=$?
+if [ $EXIT_CODE -eq 0 ] && echo "$OUTPUT" | grep -q "Total Disks: 160" && ! echo "$OUTPUT" | grep -q "Maximum sources"; then
+    test_pass
+else
+    test_fail "Expected all 40 sources (160 disks) to be counted, got exit code $EXIT_CODE"
+fi
+
+test_start "Batch report keeps every source"
+OUTPUT=$(for i in $(seq 40); do cat "$DATA_DIR/jmicron/healthy-4disk.json"; done | "$DISK_HEALTH" --json 2>&1)
+EXIT_CODE=$?
+if [ $EXIT_CODE -eq 0 ] && echo "$OUTPUT" | grep -q '"total_disks": 160' && \
+   [ "$(echo "$OUTPUT" | grep -c '"backend": "jmicron"')" -eq 40 ]; then
+    test_pass
+else
+    test_fail "Expected 40 listed sources (160 disks), got exit code $EXIT_CODE"
+fi
+
+test_start "Query --where selects matching disks"
+OUTPUT=$(cat "$DATA_DIR/jmicron/healthy-4disk.json" "$DATA_DIR/jmicron/failed-disk.json" | \
+         "$DISK_HEALTH" --where 'attr[Reallocated_Sector_Ct].raw>0' --json 2>&1)
+EXIT_CODE=$?
+if [ $EXIT_CODE -eq 1 ] && echo "$OUTPUT" | grep -q '"matched_disks": 1' && \
+   echo "$OUTPUT" | grep -q '"total_disks": 8'; then
+    test_pass
+else
+    test_fail "Expected 1 of 8 disks matched and exit code 1, got exit code $EXIT_CODE"
+fi
+
+test_start "Query --group-by counts disks per model"
+OUTPUT=$(cat "$DATA_DIR/jmicron/healthy-4disk.json" "$DATA_DIR/jmicron/failed-disk.json" | \
+         "$DISK_HEALTH" --group-by model --json 2>&1)
+if echo "$OUTPUT" | grep -q '"key": "ST4000VN008-2DR166"' && \
+   [ "$(echo "$OUTPUT" | grep -c '"disks": 4')" -eq 2 ]; then
+    test_pass
+else
+    test_fail "Expected two four-disk model groups"
+fi
+
+test_start "Query --top ranks by attribute"
+OUTPUT=$(cat "$DATA_DIR/jmicron/healthy-4disk.json" | "$DISK_HEALTH" --top 1 --by 'attr[9].raw' 2>&1)
+EXIT_CODE=$?
+if [ $EXIT_CODE -eq 0 ] && echo "$OUTPUT" | grep -q "1\. 12451"; then
+    test_pass
+else
+    test_fail "Expected disk 1 (12451 hours) first, got exit code $EXIT_CODE"
+fi
+
+test_start "Query rejects --stream and bad clauses"
+echo "" | "$DISK_HEALTH" --where 'temperature>40' --stream >/dev/null 2>&1
+STREAM_EXIT=$?
+echo "" | "$DISK_HEALTH" --where 'colour==red' >/dev/null 2>&1
+CLAUSE_EXIT=$?
+echo "" | "$DISK_HEALTH" --by temperature >/dev/null 2>&1
+BY_EXIT=$?
+if [ $STREAM_EXIT -eq 3 ] && [ $CLAUSE_EXIT -eq 3 ] && [ $BY_EXIT -eq 3 ]; then
+    test_pass
+else
+    test_fail "Expected exit code 3, got $STREAM_EXIT, $CLAUSE_EXIT and $BY_EXIT"
+fi
+
+test_start "Streaming with failed disk"
+OUTPUT=$(cat "$DATA_DIR/jmicron/healthy-4disk.json" "$DATA_DIR/jmicron/failed-disk.json" | "$DISK_HEALTH" --stream 2>&1)
+EXIT_CODE=$?
+if [ $EXIT_CODE -eq 1 ] && echo "$OUTPUT" | grep -q "Overall Status: FAILED"; then
+    test_pass
+else
+    test_fail "Expected exit code 1 and FAILED status, got exit code $EXIT_CODE"
+fi
+
+test_start "Streaming empty input (no sources)"
+OUTPUT=$(echo "" | "$DISK_HEALTH" --stream 2>&1)
+EXIT_CODE=$?
+if [ $EXIT_CODE -eq 3 ] && echo "$OUTPUT" | grep -q "No valid sources"; then
+    test_pass
+else
+    test_fail "Expected exit code 3 for no input"
+fi
+
+test_start "Threaded parsing matches single-threaded output"
+INPUT=$(for i in $(seq 50); do cat "$DATA_DIR/jmicron/"*.json "$DATA_DIR/smartctl/healthy-ssd.json"; done)
+SINGLE=$(echo "$INPUT" | "$DISK_HEALTH" --json --stream 2>&1 | grep -v '"timestamp"')
+THREADED=$(echo "$INPUT" | "$DISK_HEALTH" --json --stream --threads 4 2>&1 | grep -v '"timestamp"')
+BATCH_SINGLE=$(echo "$INPUT" | "$DISK_HEALTH" --json 2>/dev/null | grep -v '"timestamp"')
+BATCH_THREADED=$(echo "$INPUT" | "$DISK_HEALTH" --json --threads 4 2>/dev/null | grep -v '"timestamp"')
+if [ -n "$SINGLE" ] && [ "$SINGLE" = "$THREADED" ] && [ -n "$BATCH_SINGLE" ] && [ "$BATCH_SINGLE" = "$BATCH_THREADED" ]; then
+    test_pass
+else
+    test_fail "Threaded output differs from single-threaded output"
+fi
+
+test_start "File on stdin reads like a pipe"
+INPUT_FILE=$(mktemp)
+for i in $(seq 20); do cat "$DATA_DIR/jmicron/"*.json "$DATA_DIR/smartctl/healthy-ssd.json"; done > "$INPUT_FILE"
+PIPED=$(cat "$INPUT_FILE" | "$DISK_HEALTH" --json --stream 2>&1 | grep -v '"timestamp"')
+MAPPED=$("$DISK_HEALTH" --json --stream < "$INPUT_FILE" 2>&1 | grep -v '"timestamp"')
+MAPPED_THREADED=$("$DISK_HEALTH" --json --stream --threads 4 < "$INPUT_FILE" 2>&1 | grep -v '"timestamp"')
+rm -f "$INPUT_FILE"
+if [ -n "$PIPED" ] && [ "$PIPED" = "$MAPPED" ] && [ "$PIPED" = "$MAPPED_THREADED" ]; then
+    test_pass
+else
+    test_fail "Output from a file on stdin differs from piped output"
+fi
+
+echo
+echo "Test Suite: smartctl-parser Batch"
+
+test_start "Concatenated smartctl documents give one line each"
+OUTPUT=$(cat "$DATA_DIR/smartctl/source-failed-ssd.json" "$DATA_DIR/smartctl/source-failed-ssd.json" \
+         "$DATA_DIR/smartctl/source-failed-ssd.json" | "$SMARTCTL_PARSER" 2>&1)
+EXIT_CODE=$?
+if [ $EXIT_CODE -eq 0 ] && [ "$(echo "$OUTPUT" | grep -c '"backend":"smartctl"')" -eq 3 ]; then
+    test_pass
+else
+    test_fail "Expected 3 disk-health lines and exit code 0, got exit code $EXIT_CODE"
+fi
+
+test_start "Batch output aggregates like separate runs"
+SINGLE=$("$SMARTCTL_PARSER" < "$DATA_DIR/smartctl/source-failed-ssd.json")
+BATCH=$(for i in 1 2; do tr -d '\n' < "$DATA_DIR/smartctl/source-failed-ssd.json"; echo; done | "$SMARTCTL_PARSER")
+STRIP='s/"timestamp":"[^"]*"//'
+if [ -n "$SINGLE" ] && [ "$(echo "$BATCH" | sed -n 2p | sed "$STRIP")" = "$(echo "$SINGLE" | sed "$STRIP")" ] && \
+   echo "$BATCH" | "$DISK_HEALTH" 2>&1 | grep -q "Total Disks: 2"; then
+    test_pass
+else
+    test_fail "NDJSON batch output differs from a single-document run"
+fi
+
+test_start "Invalid document in a batch is skipped"
+OUTPUT=$({ cat "$DATA_DIR/smartctl/source-failed-ssd.json"; echo "not json"; cat "$DATA_DIR/smartctl/source-failed-ssd.json"; } | \
+         "$SMARTCTL_PARSER" 2>/dev/null)
+EXIT_CODE=$?
+if [ $EXIT_CODE -eq 1 ] && [ "$(echo "$OUTPUT" | grep -c '"backend":"smartctl"')" -eq 2 ]; then
+    test_pass
+else
+    test_fail "Expected both valid documents converted and exit code 1, got exit code $EXIT_CODE"
+fi
+
+test_start "Input file larger than 10 MB"
+BIG_FILE=$(mktemp)
+for i in $(seq 2600); do cat "$DATA_DIR/smartctl/source-failed-ssd.json"; done > "$BIG_FILE"
+LINES=$("$SMARTCTL_PARSER" < "$BIG_FILE" 2>/dev/null | wc -l)
+PIPED=$(cat "$BIG_FILE" | "$SMARTCTL_PARSER" 2>/dev/null | wc -l)
+rm -f "$BIG_FILE"
+if [ "$LINES" -eq 2600 ] && [ "$PIPED" -eq 2600 ]; then
+    test_pass
+else
+    test_fail "Expected 2600 lines from the file and from the pipe, got $LINES and $PIPED"
+fi
+
+test_start "--exec runs smartctl per device"
+FAKE_DIR=$(mktemp -d)
+cat > "$FAKE_DIR/smartctl" <<FAKE
+#!/bin/sh
+for arg; do dev=\$arg; done
+[ "\$dev" = /dev/missing ] && exit 2
+sed "s|/dev/sda|\$dev|" "$DATA_DIR/smartctl/source-failed-ssd.json"
+exit 4
+FAKE
+chmod +x "$FAKE_DIR/smartctl"
+OUTPUT=$("$SMARTCTL_PARSER" --exec --smartctl "$FAKE_DIR/smartctl" /dev/sda /dev/sdb /dev/missing 2>/dev/null)
+EXIT_CODE=$?
+rm -rf "$FAKE_DIR"
+if [ $EXIT_CODE -eq 1 ] && [ "$(echo "$OUTPUT" | wc -l)" -eq 2 ] && \
+   echo "$OUTPUT" | sed -n 2p | grep -q '"device":"/dev/sdb"'; then
+    test_pass
+else
+    test_fail "Expected /dev/sda and /dev/sdb in order and exit code 1, got exit code $EXIT_CODE"
+fi
+
+echo
+echo "Test Suite: Binary Records"
+
+BIN_DIR_TMP=$(mktemp -d)
+for f in healthy-ssd source-failed-ssd; do
+    "$SMARTCTL_PARSER" --format=bin < "$DATA_DIR/smartctl/$f.json" > "$BIN_DIR_TMP/$f.bin"
+    "$SMARTCTL_PARSER" < "$DATA_DIR/smartctl/$f.json" > "$BIN_DIR_TMP/$f.ndjson"
+done
+STRIP='s/"timestamp":"[^"]*"//'
+
+test_start "Binary records report like JSON lines"
+FROM_JSON=$(cat "$BIN_DIR_TMP/"*.ndjson | "$DISK_HEALTH" --json 2>&1 | sed "$STRIP")
+FROM_BIN=$(cat "$BIN_DIR_TMP/"*.bin | "$DISK_HEALTH" --json 2>&1 | sed "$STRIP")
+if [ -n "$FROM_JSON" ] && [ "$FROM_JSON" = "$FROM_BIN" ]; then
+    test_pass
+else
+    test_fail "disk-health output from binary records differs from JSON lines"
+fi
+
+test_start "Binary records and JSON lines mix in one stream"
+for i in $(seq 50); do
+    cat "$BIN_DIR_TMP/healthy-ssd.bin" "$DATA_DIR/jmicron/healthy-4disk.json" "$BIN_DIR_TMP/source-failed-ssd.bin"
+done > "$BIN_DIR_TMP/mixed"
+SINGLE=$(cat "$BIN_DIR_TMP/mixed" | "$DISK_HEALTH" --json --stream 2>&1 | sed "$STRIP")
+THREADED=$(cat "$BIN_DIR_TMP/mixed" | "$DISK_HEALTH" --json --stream --threads 4 2>&1 | sed "$STRIP")
+MAPPED=$("$DISK_HEALTH" --json --stream --threads 4 < "$BIN_DIR_TMP/mixed" 2>&1 | sed "$STRIP")
+if [ "$(echo "$SINGLE" | grep -c '"backend"')" -eq 150 ] && \
+   [ "$SINGLE" = "$THREADED" ] && [ "$SINGLE" = "$MAPPED" ]; then
+    test_pass
+else
+    test_fail "Expected 150 sources, the same from every reader"
+fi
+
+test_start "Binary records from source commands"
+OUTPUT=$("$DISK_HEALTH" --source "cat '$BIN_DIR_TMP/healthy-ssd.bin' '$BIN_DIR_TMP/source-failed-ssd.bin'" 2>&1)
+STREAMED=$("$DISK_HEALTH" --stream --source "cat '$BIN_DIR_TMP/healthy-ssd.bin' '$BIN_DIR_TMP/source-failed-ssd.bin'" 2>&1)
+if echo "$OUTPUT" | grep -q "Total Disks: 2" && echo "$STREAMED" | grep -q "Total Disks: 2"; then
+    test_pass
+else
+    test_fail "Expected both records from the source command"
+fi
+
+test_start "Truncated binary record is reported"
+OUTPUT=$(head -c 100 "$BIN_DIR_TMP/healthy-ssd.bin" | "$DISK_HEALTH" 2>&1)
+EXIT_CODE=$?
+if [ $EXIT_CODE -eq 3 ] && echo "$OUTPUT" | grep -q "truncated binary record"; then
+    test_pass
+else
+    test_fail "Expected a truncation warning and exit code 3, got exit code $EXIT_CODE"
+fi
+rm -rf "$BIN_DIR_TMP"
+
+echo
+echo "Test Suite: Source Commands"
+
+test_start "Sources run concurrently"
+START=$(date +%s%N)
+OUTPUT=$("$DISK_HEALTH" --source "sleep 1; cat $DATA_DIR/jmicron/healthy-4disk.json" \
+                        --source "sleep 1; cat $DATA_DIR/smartctl/healthy-ssd.json" \
+                        --source "sleep 1; cat $DATA_DIR/jmicron/degraded-3disk.json" 2>&1)
+EXIT_CODE=$?
+ELAPSED_MS=$(( ($(date +%s%N) - START) / 1000000 ))
+if [ $EXIT_CODE -eq 0 ] && echo "$OUTPUT" | grep -q "Total Disks: 8" && [ $ELAPSED_MS -lt 2500 ]; then
+    test_pass
+else
+    test_fail "Expected 8 disks in about 1 s, got exit code $EXIT_CODE after ${ELAPSED_MS} ms"
+fi
+
+test_start "Hung source times out as an error"
+START=$(date +%s%N)
+OUTPUT=$("$DISK_HEALTH" --json --timeout 1 --source "cat $DATA_DIR/jmicron/healthy-4disk.json" \
+                                           --source "sleep 30" 2>/dev/null)
+EXIT_CODE=$?
+ELAPSED_MS=$(( ($(date +%s%N) - START) / 1000000 ))
+if [ $EXIT_CODE -eq 1 ] && [ $ELAPSED_MS -lt 5000 ] && echo "$OUTPUT" | python3 -c "
+import sys, json
+d = json.load(sys.stdin)
+assert d['sources'][0]['status'] == 'healthy', 'First source reported'
+assert d['sources'][1]['status'] == 'error', 'Hung source is an error'
+assert 'timed out' in d['sources'][1]['error'], 'Error says it timed out'
+assert d['summary']['error_sources'] == 1, 'One error source'
+assert d['summary']['overall_status'] == 'failed', 'Errors fail the report'
+" 2>/dev/null; then
+    test_pass
+else
+    test_fail "Expected the hung source to be killed and reported, got exit code $EXIT_CODE after ${ELAPSED_MS} ms"
+fi
+
+test_start "Background child holding a source's output is killed at the deadline"
+START=$(date +%s%N)
+OUTPUT=$("$DISK_HEALTH" --json --timeout 1 --source "cat $DATA_DIR/jmicron/healthy-4disk.json" \
+                                           --source "sleep 37 & exit 0" 2>/dev/null)
+EXIT_CODE=$?
+ELAPSED_MS=$(( ($(date +%s%N) - START) / 1000000 ))
+if [ $EXIT_CODE -eq 1 ] && [ $ELAPSED_MS -lt 5000 ] && ! pgrep -f "^sleep 37$" > /dev/null && \
+   echo "$OUTPUT" | python3 -c "
+import sys, json
+d = json.load(sys.stdin)
+assert d['sources'][1]['status'] == 'error', 'Orphaned source is an error'
+assert 'timed out' in d['sources'][1]['error'], 'Error says it timed out'
+" 2>/dev/null; then
+    test_pass
+else
+    test_fail "Expected the background child killed and the source timed out, got exit code $EXIT_CODE after ${ELAPSED_MS} ms"
+fi
+
+test_start "Source without output is an error"
+OUTPUT=$("$DISK_HEALTH" --source "true" 2>&1)
+EXIT_CODE=$?
+if [ $EXIT_CODE -eq 1 ] && echo "$OUTPUT" | grep -q "Source Errors: 1"; then
+    test_pass
+else
+    test_fail "Expected exit code 1 with one source error, got $EXIT_CODE"
+fi
+
+test_start "Threads cannot be combined with --source"
+OUTPUT=$("$DISK_HEALTH" --threads 2 --source "true" 2>&1)
+EXIT_CODE=$?
+if [ $EXIT_CODE -eq 3 ]; then
+    test_pass
+else
+    test_fail "Expected exit code 3, got $EXIT_CODE"
+fi
+
+echo
+echo "Test Suite: Policy Re-assessment"
+
+test_start "Default policy keeps healthy disks healthy"
+DEFAULT_CONFIG=$(mktemp)
+"$BIN_DIR/jmraidstatus" --write-default-config "$DEFAULT_CONFIG" > /dev/null 2>&1
+OUTPUT=$(cat "$DATA_DIR/jmicron/healthy-4disk.json" | "$DISK_HEALTH" --config "$DEFAULT_CONFIG" 2>&1)
+EXIT_CODE=$?
+rm -f "$DEFAULT_CONFIG"
+if [ $EXIT_CODE -eq 0 ] && echo "$OUTPUT" | grep -q "Overall Status: PASSED"; then
+    test_pass
+else
+    test_fail "Expected exit code 0 with the default policy, got $EXIT_CODE"
+fi
+
+test_start "Strict temperature policy overrides the source verdict"
+OUTPUT=$(cat "$DATA_DIR/jmicron/healthy-4disk.json" | "$DISK_HEALTH" --config "$DATA_DIR/config/strict-temperature.json" 2>&1)
+EXIT_CODE=$?
+if [ $EXIT_CODE -eq 1 ] && echo "$OUTPUT" | grep -q "Failed: 1"; then
+    test_pass
+else
+    test_fail "Expected the 32°C disk to fail a 30°C limit, got exit code $EXIT_CODE"
+fi
+
+test_start "Missing config file is an error"
+OUTPUT=$(cat "$DATA_DIR/jmicron/healthy-4disk.json" | "$DISK_HEALTH" --config /nonexistent/config.json 2>&1)
+EXIT_CODE=$?
+if [ $EXIT_CODE -eq 3 ]; then
+    test_pass
+else
+    test_fail "Expected exit code 3 for a missing config, got $EXIT_CODE"
+fi
+
+echo
+echo "Test Suite: SMART History"
+
+HISTORY_FILE=$(mktemp -u)
+"$DISK_HEALTH" --quiet --history "$HISTORY_FILE" < "$DATA_DIR/jmicron/healthy-4disk.json"
+sed 's/\("id":5,[^}]*"raw":\)0/\18/g; s/\("id":194,[^}]*"raw":\)32/\141/' "$DATA_DIR/jmicron/healthy-4disk.json" | \
+    "$DISK_HEALTH" --quiet --stream --history "$HISTORY_FILE"
+
+test_start "disk-health appends a snapshot per disk"
+OUTPUT=$("$JM_HISTORY" "$HISTORY_FILE" 2>&1)
+EXIT_CODE=$?
+if [ $EXIT_CODE -eq 0 ] && [ "$(echo "$OUTPUT" | grep -c ' 2  ')" -eq 4 ]; then
+    test_pass
+else
+    test_fail "Expected 4 drives with 2 snapshots each, got exit code $EXIT_CODE"
+fi
+
+test_start "Reallocated sector growth"
+OUTPUT=$("$JM_HISTORY" --attr Reallocated_Sector_Ct --since 30d --json "$HISTORY_FILE" 2>&1)
+if [ "$(echo "$OUTPUT" | grep -o '"value":8,"from":0,"to":8' | wc -l)" -eq 4 ]; then
+    test_pass
+else
+    test_fail "Expected growth of 8 on all 4 drives"
+fi
+
+test_start "Maximum temperature"
+OUTPUT=$("$JM_HISTORY" --attr 194 --stat max --since 1w "$HISTORY_FILE" 2>&1)
+if echo "$OUTPUT" | grep -q "WD-WCC7K0001 .* 41 (2 snapshots)"; then
+    test_pass
+else
+    test_fail "Expected a maximum of 41 C for WD-WCC7K0001"
+fi
+
+test_start "Non-history file is an error"
+"$JM_HISTORY" "$DATA_DIR/jmicron/healthy-4disk.json" > /dev/null 2>&1
+EXIT_CODE=$?
+if [ $EXIT_CODE -eq 3 ]; then
+    test_pass
+else
+    test_fail "Expected exit code 3, got $EXIT_CODE"
+fi
+rm -f "$HISTORY_FILE"
+
+test_start "--changed-since adds new drives"
+OUTPUT=$("$DISK_HEALTH" --changed-since "$HISTORY_FILE" < "$DATA_DIR/jmicron/healthy-4disk.json" 2>&1)
+if [ "$(echo "$OUTPUT" | grep -c ': added (')" -eq 4 ]; then
+    test_pass
+else
+    test_fail "Expected 4 added drives"
+fi
+
+test_start "--changed-since heartbeat when nothing changed"
+OUTPUT=$("$DISK_HEALTH" --json --changed-since "$HISTORY_FILE" < "$DATA_DIR/jmicron/healthy-4disk.json" 2>&1)
+if echo "$OUTPUT" | grep -q '^{"heartbeat":"[^"]*","disks":4,"status":"healthy"}$'; then
+    test_pass
+else
+    test_fail "Expected a single heartbeat line, got: $OUTPUT"
+fi
+
+test_start "--changed-since reports a changed attribute"
+OUTPUT=$(sed 's/\("id":5,[^}]*"raw":\)0/\18/' "$DATA_DIR/jmicron/healthy-4disk.json" | \
+    "$DISK_HEALTH" --json --changed-since "$HISTORY_FILE" 2>&1)
+if [ "$(echo "$OUTPUT" | wc -l)" -eq 1 ] && \
+   echo "$OUTPUT" | grep -q '"change":"attribute".*"id":5,.*"from":{"value":100,"worst":100,"raw":0},"to":{"value":100,"worst":100,"raw":8}'; then
+    test_pass
+else
+    test_fail "Expected one attribute change, got: $OUTPUT"
+fi
+rm -f "$HISTORY_FILE"
+
+echo
+echo "Test Suite: Monitor Metrics"
+
+test_start "jmraid-monitord serves /metrics for a missing enclosure"
+METRICS_PORT=$((20000 + $$ % 20000))
+"$MONITORD" --listen "127.0.0.1:$METRICS_PORT" /dev/nonexistent-jmraid >/dev/null 2>&1 &
+MONITORD_PID=$!
+OUTPUT=""
+for _ in 1 2 3 4 5 6 7 8 9 10; do
+    OUTPUT=$(curl -s "http://127.0.0.1:$METRICS_PORT/metrics" 2>/dev/null) && [ -n "$OUTPUT" ] && break
+    sleep 0.2
+done
+STATUS=$(curl -s -o /dev/null -w '%{http_code}' "http://127.0.0.1:$METRICS_PORT/other" 2>/dev/null)
+kill $MONITORD_PID 2>/dev/null
+wait $MONITORD_PID 2>/dev/null
+if echo "$OUTPUT" | grep -q '^jmraid_up{device="/dev/nonexistent-jmraid"} 0$' && \
+   echo "$OUTPUT" | grep -q '^# TYPE jmraid_poll_duration_seconds histogram$' && \
+   echo "$OUTPUT" | grep -q 'jmraid_poll_duration_seconds_bucket{device="/dev/nonexistent-jmraid",poll="smart",le="+Inf"} 0' && \
+   [ "$STATUS" = "404" ]; then
+    test_pass
+else
+    test_fail "Expected jmraid_up 0 and a 404 for other paths, got status $STATUS and: $OUTPUT"
+fi
+
 echo
 echo "Test Suite: Error Handling"
 
+test_start "smartctl document with more than 10000 JSON tokens"
+PADDING=$(seq 12000 | tr '\n' ',' | sed 's/,$//')
+OUTPUT=$(tr -d '\n' < "$DATA_DIR/smartctl/source-failed-ssd.json" | sed "s/^{/{\"padding\":[$PADDING],/" | \
+         "$SMARTCTL_PARSER" 2>&1 | "$DISK_HEALTH" --json 2>&1)
+EXIT_CODE=$?
+if [ $EXIT_CODE -eq 0 ] && echo "$OUTPUT" | grep -q '"total_disks": 1' && echo "$OUTPUT" | grep -q '"device": "/dev/sda"'; then
+    test_pass
+else
+    test_fail "Expected the padded document to parse (exit code 0, 1 disk), got exit code $EXIT_CODE"
+fi
+
 test_start "Empty input (no sources)"
 OUTPUT=$(echo "" | "$DISK_HEALTH" 2>&1)
 EXIT_CODE=$?
@@ -189,6 +653,125 @@ else
     test_fail "Quiet mode should produce no output"
 fi
 
+echo
+echo "Test Suite: Simulated Controllers"
+test_start "Simulated enclosures report like their fixture"
+OUTPUT=$("$BIN_DIR/jmraidstatus" --simulate "$DATA_DIR/jmicron/healthy-4disk.json" --json-only sim0 sim1 sim2 |
+         "$DISK_HEALTH" 2>&1)
+EXIT_CODE=$?
+if [ $EXIT_CODE -eq 0 ] && echo "$OUTPUT" | grep -q "Total Disks: 12"; then
+    test_pass
+else
+    test_fail "Expected three healthy 4-disk enclosures, got exit $EXIT_CODE"
+fi
+
+test_start "Simulated failed disk fails through disk-health"
+"$BIN_DIR/jmraidstatus" --simulate "$DATA_DIR/jmicron/failed-disk.json" --json-only sim0 | "$DISK_HEALTH" > /dev/null 2>&1
+EXIT_CODE=$?
+if [ $EXIT_CODE -eq 1 ]; then
+    test_pass
+else
+    test_fail "Expected exit 1, got $EXIT_CODE"
+fi
+
+test_start "--fields identity reports the health as unknown, not healthy"
+OUTPUT=$("$BIN_DIR/jmraidstatus" --simulate "$DATA_DIR/jmicron/failed-disk.json" --fields identity --json-only sim0)
+EXIT_CODE=$?
+if [ $EXIT_CODE -eq 3 ] && echo "$OUTPUT" | grep -q '"raid_status":{"status":"unknown"'; then
+    test_pass
+else
+    test_fail "Expected status unknown and exit 3, got exit $EXIT_CODE: $OUTPUT"
+fi
+
+test_start "Simulated faults are retried"
+OUTPUT=$("$BIN_DIR/jmraidstatus" --simulate "$DATA_DIR/jmicron/healthy-4disk.json,crc=0.1,timeouts=0.05,seed=3" \
+         --retries 10 --json-only sim0 sim1 | "$DISK_HEALTH" 2>&1)
+EXIT_CODE=$?
+if [ $EXIT_CODE -eq 0 ] && echo "$OUTPUT" | grep -q "Total Disks: 8"; then
+    test_pass
+else
+    test_fail "Expected every disk despite injected faults, got exit $EXIT_CODE"
+fi
+
+test_start "Warm probe falls back to the wakeup on an idle controller"
+CONFIG=$(mktemp)
+echo '{"warm_probe": ["sim0"]}' > "$CONFIG"
+OUTPUT=$("$BIN_DIR/jmraidstatus" --simulate "$DATA_DIR/jmicron/healthy-4disk.json" --config "$CONFIG" \
+         --json-only sim0 sim1 | "$DISK_HEALTH" 2>&1)
+EXIT_CODE=$?
+if [ $EXIT_CODE -eq 0 ] && echo "$OUTPUT" | grep -q "Total Disks: 8"; then
+    test_pass
+else
+    test_fail "Expected both enclosures polled, got exit $EXIT_CODE"
+fi
+rm -f "$CONFIG"
+
+test_start "--sample writes one escaped JSON record per enclosure"
+OUTPUT=$("$BIN_DIR/jmraidstatus" --simulate "$DATA_DIR/jmicron/healthy-4disk.json" \
+         --sample temp --rate 10 --duration 1 --json 'sim"0' sim1 2>&1)
+if [ "$(echo "$OUTPUT" | wc -l)" -eq 2 ] && echo "$OUTPUT" | grep -q '^{"device":"sim\\"0","sample":"temperature"' && \
+   echo "$OUTPUT" | grep -q '"disk_number":0,"model":"WDC WD40EFRX-68N32N0","serial":"WD-WCC7K0001","samples":10,"errors":0,"min":32,"max":32,"mean":32.00,"p99":32}'; then
+    test_pass
+else
+    test_fail "Expected two records with the quote escaped, got: $OUTPUT"
+fi
+
+test_start "Daemon applies an edited config without restarting"
+CONFIG=$(mktemp)
+LOG=$(mktemp)
+echo '{"temperature": {"critical": 60}}' > "$CONFIG"
+"$BIN_DIR/jmraidstatus" --simulate "$DATA_DIR/jmicron/healthy-4disk.json" --config "$CONFIG" \
+    --daemon --interval 1 --json-only sim0 > "$LOG" 2>&1 &
+DAEMON_PID=$!
+sleep 1.5
+echo '{"temperature": {"critical": 25}}' > "$CONFIG"
+sleep 2
+kill $DAEMON_PID 2>/dev/null
+wait $DAEMON_PID 2>/dev/null
+if head -1 "$LOG" | grep -q '"overall_status":"healthy"' && tail -1 "$LOG" | grep -q '"overall_status":"failed"'; then
+    test_pass
+else
+    test_fail "Expected healthy polls before the edit and failed ones after"
+fi
+rm -f "$CONFIG" "$LOG"
+
+test_start "Daemon reports a failing enclosure every cycle and reopens it"
+LOG=$(mktemp)
+"$BIN_DIR/jmraidstatus" --simulate "$DATA_DIR/jmicron/healthy-4disk.json,timeouts=1" \
+    --daemon --interval 1 --json-only sim0 > "$LOG" 2>/dev/null &
+DAEMON_PID=$!
+sleep 3.5
+kill $DAEMON_PID 2>/dev/null
+wait $DAEMON_PID 2>/dev/null
+if [ "$(grep -c '"device":"sim0".*"error":' "$LOG")" -ge 3 ] && grep -q '"error":"not responding; reopening"' "$LOG" && \
+   head -1 "$LOG" | "$DISK_HEALTH" --json 2>/dev/null | python3 -c "
+import sys, json
+d = json.load(sys.stdin)
+assert d['sources'][0]['status'] == 'error', 'disk-health reports the source as an error'
+assert d['sources'][0]['error'] == 'poll failed', 'With the reason'
+" 2>/dev/null; then
+    test_pass
+else
+    test_fail "Expected an error line per cycle and a reopen, got: $(cat "$LOG")"
+fi
+rm -f "$LOG"
+
+echo
+echo "Test Suite: Sector Finder"
+test_start "Find-sector lists the empty safe sectors of each device"
+IMAGE=$(mktemp)
+truncate -s 2M "$IMAGE"
+printf 'x' | dd of="$IMAGE" bs=512 seek=1024 conv=notrunc 2>/dev/null
+OUTPUT=$("$BIN_DIR/jmraidstatus" --find-sector --sector 1024 --json-only "$IMAGE" "$IMAGE" 2>&1)
+EXIT_CODE=$?
+if [ $EXIT_CODE -eq 1 ] && [ "$(echo "$OUTPUT" | grep -c '"empty_ranges":\[\[33,33\],\[64,1023\],\[1025,2047\]\]')" -eq 2 ] && \
+   echo "$OUTPUT" | grep -q '"sector_empty":false'; then
+    test_pass
+else
+    test_fail "Expected two devices with sector 1024 in use and exit 1, got exit $EXIT_CODE"
+fi
+rm -f "$IMAGE"
+
 echo
 echo "=== Test Summary ==="
 echo "Tests run: $TESTS_RUN"
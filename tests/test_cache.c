@@ -0,0 +1,107 @@
+/**
+ * test_cache.c - Tests for the on-disk IDENTIFY / SMART threshold cache
+ *
+ * Round-trips entries through a temporary cache directory and checks the
+ * per-slot matching rules (different drive, new firmware).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include "test_framework.h"
+#include "../src/jm_cache.h"
+
+static char cache_dir[64];
+
+static void make_entry(jm_cache_entry_t* entry) {
+    memset(entry, 0, sizeof(*entry));
+    entry->disk_bitmask = 0x07;
+    for (int i = 0; i < 3; i++) {
+        jm_cache_slot_t* slot = &entry->slots[i];
+        slot->present = 1;
+        slot->thresholds_valid = 1;
+        snprintf(slot->model, sizeof(slot->model), "WDC WD40EFRX-%d", i);
+        snprintf(slot->serial, sizeof(slot->serial), "WD-SERIAL%d", i);
+        snprintf(slot->firmware, sizeof(slot->firmware), "82.00A82");
+        slot->size_mb = 3815447;
+        slot->thresholds.thresholds[0].id = 0x05;
+        slot->thresholds.thresholds[0].threshold = 140;
+    }
+}
+
+void test_cache_round_trip(void) {
+    TEST_CASE("Stored entry loads back unchanged");
+
+    jm_cache_entry_t entry, loaded;
+    make_entry(&entry);
+
+    ASSERT_EQ(jm_cache_store(cache_dir, &entry), 0, "Store should succeed");
+    ASSERT_EQ(jm_cache_load(cache_dir, "WD-SERIAL0", &loaded), 0, "Load should succeed");
+    ASSERT_EQ(loaded.disk_bitmask, 0x07, "Bitmask should round-trip");
+    ASSERT_TRUE(strcmp(loaded.slots[2].serial, "WD-SERIAL2") == 0, "Slot 2 serial should round-trip");
+    ASSERT_EQ(loaded.slots[1].thresholds.thresholds[0].threshold, 140, "Thresholds should round-trip");
+    ASSERT_EQ(loaded.slots[3].present, 0, "Empty slot should stay empty");
+}
+
+void test_cache_missing(void) {
+    TEST_CASE("Unknown anchor serial is a miss");
+
+    jm_cache_entry_t loaded;
+    ASSERT_EQ(jm_cache_load(cache_dir, "NO-SUCH-SERIAL", &loaded), -1, "Missing entry should fail to load");
+    ASSERT_EQ(jm_cache_load(cache_dir, "", &loaded), -1, "Empty serial should fail to load");
+}
+
+void test_cache_validation(void) {
+    TEST_CASE("A slot matches only the same drive with the same firmware");
+
+    jm_cache_entry_t entry;
+    make_entry(&entry);
+
+    ASSERT_TRUE(jm_cache_match_slot(&entry, 0, "WD-SERIAL0", "82.00A82") == &entry.slots[0], "Same drive matches");
+    ASSERT_TRUE(jm_cache_match_slot(&entry, 2, "WD-SERIAL2", "82.00A82") != NULL, "Other slots match too");
+    ASSERT_TRUE(jm_cache_match_slot(&entry, 2, "WD-REPLACED", "82.00A82") == NULL, "Swapped disk in slot 2 misses");
+    ASSERT_TRUE(jm_cache_match_slot(&entry, 1, "WD-SERIAL2", "82.00A82") == NULL, "A drive moved to another slot misses");
+    ASSERT_TRUE(jm_cache_match_slot(&entry, 0, "WD-SERIAL0", "83.00A83") == NULL, "Firmware update misses");
+    ASSERT_TRUE(jm_cache_match_slot(&entry, 3, "", "") == NULL, "Empty slot never matches");
+}
+
+void test_cache_corrupt_file(void) {
+    TEST_CASE("Truncated cache file is rejected");
+
+    char path[128];
+    snprintf(path, sizeof(path), "%s/TRUNCATED.cache", cache_dir);
+    FILE* f = fopen(path, "wb");
+    ASSERT_TRUE(f != NULL, "Should create truncated file");
+    if (f) {
+        fwrite("JMC1", 1, 4, f);
+        fclose(f);
+    }
+
+    jm_cache_entry_t loaded;
+    ASSERT_EQ(jm_cache_load(cache_dir, "TRUNCATED", &loaded), -1, "Truncated file should fail to load");
+    unlink(path);
+}
+
+int main(void) {
+    TEST_SUITE("IDENTIFY / Threshold Cache");
+
+    snprintf(cache_dir, sizeof(cache_dir), "/tmp/jm_cache_test.XXXXXX");
+    if (mkdtemp(cache_dir) == NULL) {
+        perror("mkdtemp");
+        return 1;
+    }
+
+    test_cache_round_trip();
+    test_cache_missing();
+    test_cache_validation();
+    test_cache_corrupt_file();
+
+    char path[128];
+    snprintf(path, sizeof(path), "%s/WD-SERIAL0.cache", cache_dir);
+    unlink(path);
+    rmdir(cache_dir);
+
+    TEST_SUMMARY();
+}
@@ -0,0 +1,120 @@
+/**
+ * test_config_watch.c - Tests for reloading the config file in daemon mode
+ *
+ * The watcher thread parses a changed file on its own; config_watch_swap
+ * installs the result. The tests write the file and wait up to a few
+ * seconds for the reload to be pending.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "test_framework.h"
+#include "../src/config_watch.h"
+#include "../src/smart_parser.h"
+
+static char dir[] = "/tmp/test_config_watch_XXXXXX";
+static char path[64];
+
+/* Helper: Replace the file the way an editor saving by rename would */
+static int write_config(const char* text, int by_rename) {
+    char tmp[80];
+    snprintf(tmp, sizeof(tmp), "%s/.config.tmp", dir);
+    FILE* f = fopen(by_rename ? tmp : path, "w");
+    if (f == NULL) return -1;
+    fputs(text, f);
+    fclose(f);
+    return by_rename ? rename(tmp, path) : 0;
+}
+
+/* Helper: Swap until a reload is installed (NULL after about 3 s) */
+static const smart_config_t* wait_swap(config_watch_t* watch) {
+    struct timespec step = { 0, 10 * 1000000L };
+    for (int i = 0; i < 300; i++) {
+        const smart_config_t* config = config_watch_swap(watch);
+        if (config != NULL) return config;
+        nanosleep(&step, NULL);
+    }
+    return NULL;
+}
+
+void test_reload(void) {
+    TEST_CASE("A changed file is compiled and installed on swap");
+
+    smart_config_t startup;
+    ASSERT_EQ(write_config("{\"temperature\": {\"critical\": 50}}", 0), 0, "Config written");
+    ASSERT_EQ(config_load(path, &startup), 0, "Startup config loads");
+    smart_set_config(&startup);
+
+    config_watch_t* watch = config_watch_start(path);
+    ASSERT_TRUE(watch != NULL, "Watch started");
+    ASSERT_TRUE(config_watch_swap(watch) == NULL, "Nothing pending at start");
+
+    /* A different length: an in-place rewrite within one timestamp tick is
+     * only told apart by its size */
+    ASSERT_EQ(write_config("{\"temperature\": {\"critical\": 45}, \"warm_probe\": false}", 0), 0,
+              "Rewritten in place");
+    const smart_config_t* reloaded = wait_swap(watch);
+    ASSERT_TRUE(reloaded != NULL, "Reload installed");
+    ASSERT_TRUE(smart_get_config() == reloaded, "Assessment uses the reload");
+    ASSERT_EQ(reloaded ? reloaded->rules[0xC2].temp_critical : 0, 45, "Compiled rule table");
+    ASSERT_EQ(startup.temp_critical, 50, "Startup config untouched");
+
+    ASSERT_EQ(write_config("{\"temperature\": {\"critical\": 40}, \"warm_probe\": true}", 1), 0,
+              "Replaced by rename");
+    reloaded = wait_swap(watch);
+    ASSERT_TRUE(reloaded != NULL, "Rename seen");
+    ASSERT_EQ(reloaded ? reloaded->rules[0xC2].temp_critical : 0, 40, "Newest settings");
+    ASSERT_EQ(config_warm_probe(reloaded, "/dev/sdc"), 1, "Other keys reloaded too");
+
+    smart_set_config(&startup);
+    config_watch_stop(watch);
+    config_free(&startup);
+}
+
+void test_bad_file_keeps_policy(void) {
+    TEST_CASE("A file that does not parse leaves the policy in place");
+
+    smart_config_t startup;
+    ASSERT_EQ(write_config("{\"temperature\": {\"critical\": 50}}", 0), 0, "Config written");
+    config_load(path, &startup);
+    smart_set_config(&startup);
+    config_watch_t* watch = config_watch_start(path);
+
+    ASSERT_EQ(write_config("temperature = 45", 0), 0, "Broken config written");
+    ASSERT_EQ(write_config("{\"temperature\": {\"critical\": 42}}", 1), 0, "Fixed config written");
+
+    /* The broken version never becomes pending; the fixed one does */
+    const smart_config_t* reloaded = wait_swap(watch);
+    ASSERT_TRUE(reloaded != NULL, "Fixed file installed");
+    ASSERT_EQ(reloaded ? reloaded->rules[0xC2].temp_critical : 0, 42, "Fixed settings");
+    ASSERT_TRUE(config_watch_swap(watch) == NULL, "Nothing else pending");
+
+    smart_set_config(&startup);
+    config_watch_stop(watch);
+    config_free(&startup);
+
+    ASSERT_TRUE(config_watch_start("/nonexistent/config.json") == NULL, "Missing file");
+    ASSERT_TRUE(config_watch_swap(NULL) == NULL, "No watch");
+}
+
+int main(void) {
+    TEST_SUITE("Config Watch");
+
+    if (mkdtemp(dir) == NULL) {
+        fprintf(stderr, "Cannot create %s\n", dir);
+        return 1;
+    }
+    snprintf(path, sizeof(path), "%s/config.json", dir);
+
+    test_reload();
+    test_bad_file_keeps_policy();
+
+    unlink(path);
+    rmdir(dir);
+    smart_set_config(NULL);
+    TEST_SUMMARY();
+}
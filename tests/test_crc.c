@@ -7,6 +7,7 @@
 
 #include "test_framework.h"
 #include "../src/jm_crc.h"
+#include "../src/sata_xor.h"
 #include <stdint.h>
 #include <string.h>
 
@@ -68,6 +69,102 @@ void test_crc_different_lengths(void) {
     ASSERT_NEQ(crc_short, crc_long, "Different lengths should produce different CRCs");
 }
 
+/* Bitwise reference: seed 0x52325032, poly 0x04C11DB7, each word MSB first */
+static uint32_t reference_crc(const uint32_t* data, uint32_t num_words) {
+    uint32_t crc = 0x52325032;
+    for (uint32_t i = 0; i < num_words; i++) {
+        for (int shift = 24; shift >= 0; shift -= 8) {
+            crc ^= ((data[i] >> shift) & 0xFF) << 24;
+            for (int bit = 0; bit < 8; bit++) {
+                crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04C11DB7 : (crc << 1);
+            }
+        }
+    }
+    return crc;
+}
+
+static void fill_pseudo_random(uint32_t* buffer, int words, uint32_t seed) {
+    for (int i = 0; i < words; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        buffer[i] = seed;
+    }
+}
+
+void test_crc_matches_reference(void) {
+    TEST_CASE("Table-driven CRC matches bitwise reference");
+
+    uint32_t buffer[128];
+    fill_pseudo_random(buffer, 128, 0x1234);
+
+    int all_match = 1;
+    for (uint32_t len = 0; len <= 128; len++) {
+        if (JM_CRC(buffer, len) != reference_crc(buffer, len)) {
+            all_match = 0;
+        }
+    }
+    ASSERT_TRUE(all_match, "CRC matches reference for every length 0-128 (odd and even)");
+    ASSERT_EQ(JM_CRC(buffer, 0), 0x52325032, "Zero-length CRC is the seed");
+}
+
+void test_crc_fused_command(void) {
+    TEST_CASE("Fused CRC+XOR matches separate passes (command path)");
+
+    uint32_t fused[128], separate[128];
+    fill_pseudo_random(fused, 128, 0xBEEF);
+    memcpy(separate, fused, sizeof(fused));
+
+    uint32_t crc_fused = JM_CRC_THEN_XOR(fused);
+
+    uint32_t crc_separate = JM_CRC(separate, 0x7f);
+    separate[0x7f] = crc_separate;
+    SATA_XOR(separate);
+
+    ASSERT_EQ(crc_fused, crc_separate, "Returned CRC matches JM_CRC");
+    ASSERT_MEM_EQ(fused, separate, sizeof(fused), "Scrambled buffer matches CRC then SATA_XOR");
+}
+
+void test_crc_fused_response(void) {
+    TEST_CASE("Fused XOR+CRC matches separate passes (response path)");
+
+    uint32_t fused[128], separate[128];
+    fill_pseudo_random(fused, 128, 0xCAFE);
+    memcpy(separate, fused, sizeof(fused));
+
+    uint32_t crc_fused = JM_XOR_THEN_CRC(fused);
+
+    SATA_XOR(separate);
+    uint32_t crc_separate = JM_CRC(separate, 0x7f);
+
+    ASSERT_EQ(crc_fused, crc_separate, "Returned CRC matches SATA_XOR then JM_CRC");
+    ASSERT_MEM_EQ(fused, separate, sizeof(fused), "Descrambled buffer matches SATA_XOR");
+
+    /* A scrambled command round-trips through the response path */
+    uint32_t cmd[128];
+    fill_pseudo_random(cmd, 128, 0xF00D);
+    JM_CRC_THEN_XOR(cmd);
+    ASSERT_EQ(JM_XOR_THEN_CRC(cmd), cmd[0x7f], "Descrambled command carries a valid CRC");
+}
+
+void test_crc_streaming(void) {
+    TEST_CASE("Streaming jm_crc_update matches one-shot JM_CRC");
+
+    uint32_t buffer[128];
+    fill_pseudo_random(buffer, 128, 0x5EED);
+
+    /* Odd chunk sizes exercise the single-word tail between calls */
+    static const uint32_t chunks[] = { 1, 2, 3, 5, 8, 13, 21, 34, 40 };
+    uint32_t crc = JM_CRC_INIT;
+    uint32_t offset = 0;
+    for (size_t i = 0; i < sizeof(chunks) / sizeof(chunks[0]); i++) {
+        crc = jm_crc_update(crc, buffer + offset, chunks[i]);
+        offset += chunks[i];
+    }
+
+    ASSERT_EQ(offset, 127, "Chunks cover the CRC-covered words");
+    ASSERT_EQ(crc, JM_CRC(buffer, 127), "Chunked CRC equals one-shot CRC");
+    ASSERT_EQ(jm_crc_update(JM_CRC_INIT, buffer, 0), JM_CRC_INIT, "Empty update leaves CRC unchanged");
+}
+
 int main(void) {
     TEST_SUITE("JMicron CRC Tests");
 
@@ -75,6 +172,10 @@ int main(void) {
     test_crc_known_values();
     test_crc_consistency();
     test_crc_different_lengths();
+    test_crc_matches_reference();
+    test_crc_fused_command();
+    test_crc_fused_response();
+    test_crc_streaming();
 
     TEST_SUMMARY();
 }
@@ -0,0 +1,171 @@
+/**
+ * test_disk_table.c - Tests for the columnar disk store of disk-health
+ *
+ * Sources are parsed from the jmraidstatus JSON fixtures, as disk-health
+ * parses its input, then stored and read back column by column.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "test_framework.h"
+#include "../src/aggregator/disk_table.h"
+
+#define HEALTHY_PATH "tests/data/jmicron/healthy-4disk.json"
+#define FAILED_PATH "tests/data/jmicron/failed-disk.json"
+
+static source_result_t healthy, failed;
+
+/* Helper: Parse a fixture into a source */
+static int load_source(const char* path, source_result_t* result) {
+    static char text[65536];
+    FILE* f = fopen(path, "r");
+    if (f == NULL) return -1;
+    size_t len = fread(text, 1, sizeof(text) - 1, f);
+    fclose(f);
+    text[len] = '\0';
+    return parse_disk_health_line(text, result);
+}
+
+void test_round_trip(void) {
+    TEST_CASE("Stored disks read back column by column");
+
+    disk_table_t table;
+    ASSERT_EQ(disk_table_init(&table), 0, "Table initializes");
+    ASSERT_EQ(disk_table_add_source(&table, &healthy), 0, "Source is added");
+
+    ASSERT_EQ(table.num_sources, 1, "One source");
+    ASSERT_EQ((int)table.num_disks, healthy.num_disks, "Every disk stored");
+    ASSERT_TRUE(strcmp(disk_table_string(&table, table.model[0]), healthy.disks[0].disk_name) == 0,
+                "Model interned");
+    ASSERT_TRUE(strcmp(disk_table_string(&table, table.serial[1]), healthy.disks[1].serial_number) == 0,
+                "Serial interned");
+    ASSERT_TRUE(strcmp(disk_table_string(&table, table.firmware[2]), "SC60") == 0, "Firmware interned");
+    ASSERT_TRUE(table.size_mb[0] == healthy.disks[0].size_mb, "Size stored");
+    ASSERT_EQ(table.disk_number[3], healthy.disks[3].disk_number, "Slot stored");
+    ASSERT_EQ(table.status[0], DISK_STATUS_PASSED, "Status stored");
+
+    int a = disk_table_find_attr(&table, 1, 9);
+    ASSERT_TRUE(a >= 0 && table.attr_raw[a] == 12451, "Raw value of attribute 9 on disk 1");
+    ASSERT_EQ(table.attr_disk[a], 1, "Attribute knows its disk");
+    ASSERT_EQ(disk_table_find_attr(&table, 1, 0xFE), -1, "Missing attribute");
+    ASSERT_EQ(table.attr_start[table.num_disks], table.num_attrs, "Attribute ranges cover the column");
+
+    disk_table_free(&table);
+}
+
+void test_interning(void) {
+    TEST_CASE("Strings shared by sources are stored once");
+
+    disk_table_t table;
+    disk_table_init(&table);
+    disk_table_add_source(&table, &healthy);
+    uint32_t strings = table.strings.count;
+    disk_table_add_source(&table, &healthy);
+
+    ASSERT_EQ(table.strings.count, strings, "A repeated source adds no strings");
+    ASSERT_EQ(table.model[0], table.model[4], "Same model, same id");
+    ASSERT_EQ(table.model[0], table.model[1], "Disks of one model share an id");
+    ASSERT_TRUE(table.serial[0] != table.serial[1], "Distinct serials");
+    ASSERT_EQ(table.sources[1].first_disk, 4, "Second source starts after the first");
+    ASSERT_EQ(table.disk_source[5], 1, "Disk knows its source");
+    ASSERT_TRUE(strcmp(disk_table_string(&table, DISK_TABLE_EMPTY), "") == 0, "Id 0 is empty");
+
+    disk_table_free(&table);
+}
+
+void test_get_source(void) {
+    TEST_CASE("Source headers are rebuilt for output");
+
+    disk_table_t table;
+    source_result_t* out = calloc(1, sizeof(source_result_t));
+    source_result_t* error = calloc(1, sizeof(source_result_t));
+
+    snprintf(error->backend, sizeof(error->backend), "command");
+    snprintf(error->device, sizeof(error->device), "smartctl -j /dev/sdz");
+    snprintf(error->error, sizeof(error->error), "timed out after 30 s");
+    error->overall_status = DISK_STATUS_ERROR;
+    healthy.has_timings = 1;
+    healthy.timings.ioctl_read.count = 42;
+
+    disk_table_init(&table);
+    disk_table_add_source(&table, &healthy);
+    disk_table_add_source(&table, error);
+    healthy.has_timings = 0;
+
+    disk_table_get_source(&table, 0, out);
+    ASSERT_TRUE(strcmp(out->device, healthy.device) == 0, "Device");
+    ASSERT_TRUE(strcmp(out->controller_model, "JMB567") == 0, "Controller model");
+    ASSERT_EQ(out->num_disks, 4, "Disk count");
+    ASSERT_TRUE(out->error[0] == '\0', "No error");
+    ASSERT_TRUE(out->has_timings && out->timings.ioctl_read.count == 42, "Timings kept");
+
+    disk_table_get_source(&table, 1, out);
+    ASSERT_TRUE(strcmp(out->error, "timed out after 30 s") == 0, "Error kept");
+    ASSERT_EQ(out->overall_status, DISK_STATUS_ERROR, "Error status");
+    ASSERT_EQ(out->num_disks, 0, "No disks");
+    ASSERT_TRUE(!out->has_timings, "No timings");
+    ASSERT_EQ(table.num_timings, 1, "Timings stored only where present");
+
+    disk_table_free(&table);
+    free(out);
+    free(error);
+}
+
+void test_scan(void) {
+    TEST_CASE("Attribute scans find disks by raw value");
+
+    disk_table_t table;
+    uint32_t disks[8];
+
+    disk_table_init(&table);
+    disk_table_add_source(&table, &healthy);
+    disk_table_add_source(&table, &failed);
+    disk_table_add_source(&table, &failed);
+
+    ASSERT_EQ(disk_table_scan_raw(&table, 0x05, 0, disks, 8), 2, "Two disks with reallocated sectors");
+    ASSERT_EQ(disks[0], 4 + 2, "First is disk 2 of the first failed source");
+    ASSERT_EQ(disks[1], 8 + 2, "Second is disk 2 of the second");
+    ASSERT_EQ(disk_table_scan_raw(&table, 0x05, 850, NULL, 0), 0, "Strictly above the minimum");
+    ASSERT_EQ(disk_table_scan_raw(&table, 0x05, 0, disks, 1), 2, "Count beyond capacity");
+
+    disk_table_free(&table);
+}
+
+void test_fleet_size(void) {
+    TEST_CASE("A large fleet costs a fraction of full disk records");
+
+    disk_table_t table;
+    disk_table_init(&table);
+    int ok = 1;
+    for (int i = 0; i < 2000; i++) {
+        snprintf(healthy.device, sizeof(healthy.device), "/dev/sg%d", i);
+        ok &= disk_table_add_source(&table, &healthy) == 0;
+    }
+    ASSERT_TRUE(ok, "Every source is added");
+    ASSERT_EQ(table.num_disks, 8000, "All disks stored");
+
+    size_t full = (size_t)table.num_disks * sizeof(disk_smart_data_t);
+    ASSERT_TRUE(disk_table_bytes(&table) * 10 < full, "At least 10x smaller than disk_smart_data_t");
+    ASSERT_TRUE(strcmp(disk_table_string(&table, table.sources[1999].device), "/dev/sg1999") == 0,
+                "Strings survive rehashing");
+    disk_table_free(&table);
+}
+
+int main(void) {
+    TEST_SUITE("Disk Table");
+
+    if (load_source(HEALTHY_PATH, &healthy) != 0 || load_source(FAILED_PATH, &failed) != 0) {
+        fprintf(stderr, "Cannot load fixtures\n");
+        return 1;
+    }
+
+    test_round_trip();
+    test_interning();
+    test_get_source();
+    test_scan();
+    test_fleet_size();
+
+    TEST_SUMMARY();
+}
@@ -0,0 +1,93 @@
+/**
+ * test_find_sector.c - Tests for the batched empty-sector finder
+ *
+ * jm_find_empty_sectors reads block devices; a sparse image file stands in
+ * for one (files may refuse O_DIRECT, which also covers the buffered path).
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "test_framework.h"
+#include "../src/jm_protocol.h"
+
+static char image_path[] = "/tmp/test_find_sector_XXXXXX";
+
+/* Helper: Create an image of the given size with one non-zero byte per listed sector */
+static int make_image(off_t size, const uint32_t* data_sectors, int num_sectors) {
+    int fd = mkstemp(image_path);
+    if (fd < 0) return -1;
+    int ok = ftruncate(fd, size) == 0;
+    for (int i = 0; i < num_sectors && ok; i++) {
+        /* The last byte, so a scan that stops early would miss it */
+        ok = pwrite(fd, "x", 1, (off_t)data_sectors[i] * JM_SECTORSIZE + JM_SECTORSIZE - 1) == 1;
+    }
+    close(fd);
+    return ok ? 0 : -1;
+}
+
+void test_sector_is_empty(void) {
+    TEST_CASE("jm_sector_is_empty checks every byte");
+
+    uint8_t sector[JM_SECTORSIZE + 3];
+    memset(sector, 0, sizeof(sector));
+    ASSERT_TRUE(jm_sector_is_empty(sector, JM_SECTORSIZE), "Zero sector is empty");
+
+    sector[JM_SECTORSIZE - 1] = 1;
+    ASSERT_FALSE(jm_sector_is_empty(sector, JM_SECTORSIZE), "Last byte counts");
+    sector[JM_SECTORSIZE - 1] = 0;
+    sector[200] = 0x80;
+    ASSERT_FALSE(jm_sector_is_empty(sector, JM_SECTORSIZE), "Middle byte counts");
+    sector[200] = 0;
+
+    sector[JM_SECTORSIZE + 2] = 1;
+    ASSERT_TRUE(jm_sector_is_empty(sector + 1, JM_SECTORSIZE), "Unaligned buffer");
+    ASSERT_FALSE(jm_sector_is_empty(sector + 1, JM_SECTORSIZE + 2), "Tail after the last block");
+}
+
+void test_find_empty_sectors(void) {
+    TEST_CASE("Every safe sector is classified in one pass");
+
+    uint32_t data[] = {40, 64, 1024, 2047, 3000};
+    jm_sector_map_t map;
+
+    strcpy(image_path, "/tmp/test_find_sector_XXXXXX");
+    ASSERT_EQ(make_image(4 * 1024 * 1024, data, 5), 0, "Image created");
+
+    /* 33 and 64-2047 are safe, less 64, 1024 and 2047 */
+    ASSERT_EQ(jm_find_empty_sectors(image_path, &map), 1 + 1984 - 3, "Empty safe sectors counted");
+    ASSERT_TRUE(jm_sector_map_test(&map, 33), "Sector 33 empty");
+    ASSERT_FALSE(jm_sector_map_test(&map, 64), "Sector 64 has data");
+    ASSERT_TRUE(jm_sector_map_test(&map, 65), "Sector 65 empty");
+    ASSERT_FALSE(jm_sector_map_test(&map, 1024), "Sector 1024 has data");
+    ASSERT_FALSE(jm_sector_map_test(&map, 2047), "Last safe sector has data");
+    ASSERT_FALSE(jm_sector_map_test(&map, 34), "Unsafe sectors are never marked");
+    ASSERT_FALSE(jm_sector_map_test(&map, 5000), "Out of range");
+    unlink(image_path);
+}
+
+void test_small_device(void) {
+    TEST_CASE("A device smaller than the range reports what it has");
+
+    jm_sector_map_t map;
+
+    strcpy(image_path, "/tmp/test_find_sector_XXXXXX");
+    ASSERT_EQ(make_image(100 * JM_SECTORSIZE, NULL, 0), 0, "Image created");
+    ASSERT_EQ(jm_find_empty_sectors(image_path, &map), 1 + 36, "Sector 33 and 64-99");
+    ASSERT_FALSE(jm_sector_map_test(&map, 100), "Past the end");
+    unlink(image_path);
+
+    ASSERT_EQ(jm_find_empty_sectors("/nonexistent/device", &map), -1, "Missing device");
+}
+
+int main(void) {
+    TEST_SUITE("Find Sector");
+
+    test_sector_is_empty();
+    test_find_empty_sectors();
+    test_small_device();
+
+    TEST_SUMMARY();
+}
@@ -0,0 +1,171 @@
+/**
+ * test_fleet_query.c - Tests for disk-health --where, --group-by and --top
+ *
+ * Queries run over a disk table of the jmicron and smartctl fixtures.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "test_framework.h"
+#include "../src/aggregator/fleet_query.h"
+
+static source_result_t source;
+static disk_table_t table;
+
+/* Helper: Parse a fixture and add it to the table */
+static int add_fixture(const char* path) {
+    static char text[65536];
+    FILE* f = fopen(path, "r");
+    if (f == NULL) return -1;
+    size_t len = fread(text, 1, sizeof(text) - 1, f);
+    fclose(f);
+    text[len] = '\0';
+    if (parse_disk_health_line(text, &source) != 0) return -1;
+    return disk_table_add_source(&table, &source);
+}
+
+/* Helper: Disks matching one where clause (-1 if it does not compile) */
+static int count_where(const char* clause) {
+    fleet_query_t query;
+    fleet_query_result_t result;
+    char error[160];
+
+    fleet_query_init(&query);
+    if (fleet_query_add_where(&query, clause, error, sizeof(error)) != 0) return -1;
+    if (fleet_query_run(&query, &table, &result) != 0) return -2;
+    int matched = (int)result.matched;
+    fleet_query_result_free(&result);
+    return matched;
+}
+
+void test_where_compiles(void) {
+    TEST_CASE("Where clauses compile or report why not");
+
+    fleet_query_t query;
+    char error[160];
+    fleet_query_init(&query);
+
+    ASSERT_EQ(fleet_query_add_where(&query, "attr[0xC5].raw>0", error, sizeof(error)), 0, "Hex ID");
+    ASSERT_EQ(query.terms[0].attr_id, 0xC5, "ID parsed");
+    ASSERT_EQ(query.terms[0].field, QUERY_FIELD_ATTR_RAW, "Raw field");
+    ASSERT_EQ(query.terms[0].op, QUERY_OP_GT, "Greater than");
+
+    ASSERT_EQ(fleet_query_add_where(&query, "attr[Reallocated_Sector_Ct].value <= 100 && model~WD",
+                                    error, sizeof(error)), 0, "Name and two terms");
+    ASSERT_EQ(query.terms[1].attr_id, 0x05, "Name resolved through the rule table");
+    ASSERT_EQ(query.terms[1].op, QUERY_OP_LE, "Less or equal");
+    ASSERT_TRUE(strcmp(query.terms[2].text, "WD") == 0, "String operand");
+    ASSERT_EQ(query.num_terms, 3, "Clauses accumulate");
+    ASSERT_TRUE(strcmp(query.where, "attr[0xC5].raw>0 && attr[Reallocated_Sector_Ct].value <= 100 && model~WD") == 0,
+                "Source text joined");
+
+    ASSERT_EQ(fleet_query_add_where(&query, "status == 'failed'", error, sizeof(error)), 0, "Quoted value");
+    ASSERT_EQ(query.terms[3].number, DISK_STATUS_FAILED, "Status value");
+
+    ASSERT_EQ(fleet_query_add_where(&query, "colour==red", error, sizeof(error)), -1, "Unknown field");
+    ASSERT_TRUE(strstr(error, "colour") != NULL, "Error names the field");
+    ASSERT_EQ(fleet_query_add_where(&query, "attr[Nope].raw>0", error, sizeof(error)), -1, "Unknown name");
+    ASSERT_EQ(fleet_query_add_where(&query, "attr[5].size>0", error, sizeof(error)), -1, "Unknown subfield");
+    ASSERT_EQ(fleet_query_add_where(&query, "temperature", error, sizeof(error)), -1, "No operator");
+    ASSERT_EQ(fleet_query_add_where(&query, "model>WD", error, sizeof(error)), -1, "Ordered string compare");
+    ASSERT_EQ(fleet_query_add_where(&query, "temperature>hot", error, sizeof(error)), -1, "Not a number");
+    ASSERT_EQ(fleet_query_add_where(&query, "status>failed", error, sizeof(error)), -1, "Ordered status");
+    ASSERT_EQ(fleet_query_add_where(&query, "attr[5].raw>18446744073709551616", error, sizeof(error)), -1,
+              "Out-of-range number");
+    ASSERT_TRUE(strstr(error, "out of range") != NULL, "Error says why");
+    ASSERT_EQ(fleet_query_add_where(&query, "attr[5].raw<=18446744073709551615", error, sizeof(error)), 0,
+              "Largest raw value");
+}
+
+void test_where_matches(void) {
+    TEST_CASE("Where clauses select disks");
+
+    ASSERT_EQ(count_where("attr[0x05].raw>0"), 1, "One disk with reallocated sectors");
+    ASSERT_EQ(count_where("attr[0x05].raw>=0"), 9, "Every disk reports 0x05");
+    ASSERT_EQ(count_where("attr[0x09].raw>=0"), 3, "Only disks reporting 0x09 compare");
+    ASSERT_EQ(count_where("status==failed"), 1, "One failed disk");
+    ASSERT_EQ(count_where("status!=failed"), 8, "The rest");
+    ASSERT_EQ(count_where("model==ST4000VN008-2DR166"), 4, "Exact model");
+    ASSERT_EQ(count_where("model==nothing"), 0, "Absent string");
+    ASSERT_EQ(count_where("model!=nothing"), 9, "Absent string never equals");
+    ASSERT_EQ(count_where("model~WD40"), 4, "Substring");
+    ASSERT_EQ(count_where("backend==smartctl"), 1, "Source field");
+    ASSERT_EQ(count_where("temperature>=30"), 2, "Temperature from the policy table");
+    ASSERT_EQ(count_where("temperature>=30 && backend==jmicron"), 1, "Terms AND together");
+    ASSERT_EQ(count_where("size_mb > 1000000 && model~ST"), 4, "Numeric and string");
+}
+
+void test_group_by(void) {
+    TEST_CASE("Group-by counts disks per key, largest first");
+
+    fleet_query_t query;
+    fleet_query_result_t result;
+
+    fleet_query_init(&query);
+    ASSERT_EQ(fleet_query_set_group(&query, "model"), 0, "Model key");
+    ASSERT_EQ(fleet_query_set_group(&query, "colour"), -1, "Unknown key");
+    ASSERT_EQ(fleet_query_run(&query, &table, &result), 0, "Query runs");
+    ASSERT_EQ(result.num_groups, 3, "Three models");
+    ASSERT_TRUE(strcmp(disk_table_string(&table, result.groups[0].key), "ST4000VN008-2DR166") == 0 ||
+                strcmp(disk_table_string(&table, result.groups[0].key), "WDC WD40EFRX-68N32N0") == 0,
+                "A four-disk model first");
+    ASSERT_EQ(result.groups[0].disks, 4, "Largest group first");
+    ASSERT_EQ(result.groups[2].disks, 1, "The SSD last");
+    fleet_query_result_free(&result);
+
+    fleet_query_set_group(&query, "backend");
+    fleet_query_run(&query, &table, &result);
+    ASSERT_EQ(result.num_groups, 2, "Two backends");
+    ASSERT_EQ(result.groups[0].failed, 1, "Failed disk counted in its group");
+    ASSERT_EQ(result.groups[0].max_temperature, 32, "Hottest jmicron disk");
+    fleet_query_result_free(&result);
+}
+
+void test_top(void) {
+    TEST_CASE("Top-N ranks matching disks, best first");
+
+    fleet_query_t query;
+    fleet_query_result_t result;
+
+    fleet_query_init(&query);
+    query.top = 3;
+    ASSERT_EQ(fleet_query_set_by(&query, "attr[9].raw"), 0, "Rank by power-on hours");
+    ASSERT_EQ(fleet_query_set_by(&query, "model"), -1, "Strings do not rank");
+    ASSERT_EQ(fleet_query_run(&query, &table, &result), 0, "Query runs");
+    ASSERT_TRUE(result.num_matches <= 3, "At most N");
+    for (uint32_t i = 1; i < result.num_matches; i++) {
+        ASSERT_TRUE(result.matches[i - 1].value >= result.matches[i].value, "Descending");
+    }
+    ASSERT_EQ(result.matches[0].value, 12451, "Highest hours first");
+    fleet_query_result_free(&result);
+
+    fleet_query_init(&query);
+    query.top = 100;
+    fleet_query_run(&query, &table, &result);
+    ASSERT_EQ(result.num_matches, 2, "Only disks with a temperature rank by it");
+    ASSERT_EQ(result.matches[0].value, 32, "Temperature value");
+    ASSERT_TRUE(result.matches[0].disk < result.matches[1].disk, "Ties keep input order");
+    fleet_query_result_free(&result);
+}
+
+int main(void) {
+    TEST_SUITE("Fleet Query");
+
+    disk_table_init(&table);
+    if (add_fixture("tests/data/jmicron/healthy-4disk.json") != 0 ||
+        add_fixture("tests/data/jmicron/failed-disk.json") != 0 ||
+        add_fixture("tests/data/smartctl/healthy-ssd.json") != 0) {
+        fprintf(stderr, "Cannot load fixtures\n");
+        return 1;
+    }
+
+    test_where_compiles();
+    test_where_matches();
+    test_group_by();
+    test_top();
+
+    disk_table_free(&table);
+    TEST_SUMMARY();
+}
@@ -0,0 +1,214 @@
+/**
+ * test_hardware_detect.c - Tests for the one-pass sysfs scan
+ *
+ * Builds a fake sysfs tree in a temporary directory: one disk behind a
+ * JMicron USB enclosure, one behind a JMicron PCIe card, one behind another
+ * vendor's AHCI controller and a loop device. The scan must find exactly the
+ * JMicron ones, and cached entries must go stale when the device changes.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "test_framework.h"
+#include "../src/hardware_detect.h"
+#include "../src/jm_cache.h"
+
+static char root[64];
+
+/* Helper: mkdir -p relative to the fake root */
+static void make_dirs(const char* rel) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", root, rel);
+    for (char* p = path + strlen(root) + 1; *p; p++) {
+        if (*p == '/') {
+            *p = '\0';
+            mkdir(path, 0755);
+            *p = '/';
+        }
+    }
+    mkdir(path, 0755);
+}
+
+static void write_file(const char* rel, const char* content) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", root, rel);
+    FILE* f = fopen(path, "w");
+    if (f != NULL) {
+        fputs(content, f);
+        fclose(f);
+    }
+}
+
+/* Helper: /sys/block/<name> with a dev number and a device link into devices/ */
+static void make_block(const char* name, const char* dev, const char* device_rel) {
+    char rel[256], target[512], link[512];
+    snprintf(rel, sizeof(rel), "block/%s", name);
+    make_dirs(rel);
+    snprintf(rel, sizeof(rel), "block/%s/dev", name);
+    write_file(rel, dev);
+    if (device_rel != NULL) {
+        make_dirs(device_rel);
+        snprintf(target, sizeof(target), "%s/%s", root, device_rel);
+        snprintf(link, sizeof(link), "%s/block/%s/device", root, name);
+        unlink(link);
+        symlink(target, link);
+    }
+}
+
+static void build_tree(void) {
+    /* JMicron JMB567 USB enclosure */
+    make_dirs("devices/pci0000:00/0000:00:14.0/usb2/2-1");
+    write_file("devices/pci0000:00/0000:00:14.0/usb2/2-1/idVendor", "152d\n");
+    write_file("devices/pci0000:00/0000:00:14.0/usb2/2-1/idProduct", "0567\n");
+    make_block("sdc", "8:32\n", "devices/pci0000:00/0000:00:14.0/usb2/2-1/2-1:1.0/host4/target4:0:0/4:0:0:0");
+
+    /* JMicron JMB394 PCIe card */
+    make_dirs("devices/pci0000:00/0000:00:1c.0/0000:03:00.0");
+    write_file("devices/pci0000:00/0000:00:1c.0/0000:03:00.0/vendor", "0x197b\n");
+    write_file("devices/pci0000:00/0000:00:1c.0/0000:03:00.0/device", "0x0394\n");
+    make_block("sdb", "8:16\n", "devices/pci0000:00/0000:00:1c.0/0000:03:00.0/ata5/host5/target5:0:0/5:0:0:0");
+
+    /* Intel AHCI boot disk */
+    make_dirs("devices/pci0000:00/0000:00:17.0");
+    write_file("devices/pci0000:00/0000:00:17.0/vendor", "0x8086\n");
+    write_file("devices/pci0000:00/0000:00:17.0/device", "0xa352\n");
+    make_block("sda", "8:0\n", "devices/pci0000:00/0000:00:17.0/ata1/host0/target0:0:0/0:0:0:0");
+
+    /* Loop device: no device link */
+    make_block("loop0", "7:0\n", NULL);
+}
+
+void test_probe_usb(void) {
+    TEST_CASE("USB enclosure is resolved in one walk");
+
+    jm_scan_entry_t entry;
+    ASSERT_EQ(probe_block_device(root, "sdc", &entry), 0, "Controller found");
+    ASSERT_EQ(entry.bus, JM_BUS_USB, "Bus is USB");
+    ASSERT_EQ(entry.major, 8, "Major number read");
+    ASSERT_EQ(entry.minor, 32, "Minor number read");
+    ASSERT_STR_EQ(entry.controller.model, "JMB567", "Model from VID/PID");
+    ASSERT_STR_EQ(entry.device_path, "/dev/sdc", "Device node path");
+    ASSERT_TRUE(strstr(entry.controller_path, "/usb2/2-1") != NULL, "Controller path is the USB device");
+    ASSERT_TRUE(is_jmicron_entry(&entry), "JMicron VID");
+}
+
+void test_probe_pci(void) {
+    TEST_CASE("PCIe controllers are matched by vendor");
+
+    jm_scan_entry_t entry;
+    ASSERT_EQ(probe_block_device(root, "sdb", &entry), 0, "JMicron PCIe found");
+    ASSERT_EQ(entry.bus, JM_BUS_PCI, "Bus is PCI");
+    ASSERT_STR_EQ(entry.controller.model, "JMB394", "Model from device ID");
+
+    ASSERT_EQ(probe_block_device(root, "sda", &entry), 1, "Other vendor's controller is not a match");
+    ASSERT_EQ(probe_block_device(root, "loop0", &entry), 1, "Virtual device has no controller");
+    ASSERT_EQ(probe_block_device(root, "sdz", &entry), -1, "Missing device is an error");
+}
+
+void test_probe_long_path(void) {
+    TEST_CASE("A controller path too long for the cache key is rejected");
+
+    /* USB hubs nest deep enough to pass controller_path */
+    char rel[400] = "devices/pci0000:00/0000:00:14.0/usb3";
+    while (strlen(rel) < 300) {
+        strcat(rel, "/3-1.1.1.1.1");
+    }
+    char file[448];
+    make_dirs(rel);
+    snprintf(file, sizeof(file), "%s/idVendor", rel);
+    write_file(file, "152d\n");
+    snprintf(file, sizeof(file), "%s/idProduct", rel);
+    write_file(file, "0567\n");
+    strcat(rel, "/host9/target9:0:0/9:0:0:0");
+    make_block("sdy", "65:128\n", rel);
+
+    jm_scan_entry_t entry;
+    ASSERT_EQ(probe_block_device(root, "sdy", &entry), -1, "Not truncated into a key that never matches");
+
+    snprintf(file, sizeof(file), "%s/block/sdy/device", root);
+    unlink(file);
+    snprintf(file, sizeof(file), "%s/block/sdy/dev", root);
+    unlink(file);
+    snprintf(file, sizeof(file), "%s/block/sdy", root);
+    rmdir(file);
+}
+
+void test_scan(void) {
+    TEST_CASE("Scan lists only JMicron devices, sorted");
+
+    jm_scan_entry_t entries[8];
+    int n = scan_jmicron_devices(root, entries, 8);
+    ASSERT_EQ(n, 2, "Two JMicron devices");
+    if (n == 2) {
+        ASSERT_STR_EQ(entries[0].device_path, "/dev/sdb", "Sorted by name");
+        ASSERT_STR_EQ(entries[1].device_path, "/dev/sdc", "Sorted by name");
+    }
+    ASSERT_EQ(scan_jmicron_devices(root, entries, 1), 1, "Capacity is respected");
+}
+
+void test_entry_staleness(void) {
+    TEST_CASE("Cached entries go stale when the device changes");
+
+    jm_scan_entry_t entry;
+    probe_block_device(root, "sdc", &entry);
+    ASSERT_TRUE(scan_entry_is_current(root, &entry), "Fresh entry is current");
+
+    uint32_t before = block_listing_hash(root);
+    write_file("block/sdc/dev", "8:48\n");
+    ASSERT_TRUE(!scan_entry_is_current(root, &entry), "New major:minor makes it stale");
+    write_file("block/sdc/dev", "8:32\n");
+
+    /* Re-plugged into another port: same name, different USB device */
+    make_dirs("devices/pci0000:00/0000:00:14.0/usb2/2-2");
+    make_block("sdc", "8:32\n", "devices/pci0000:00/0000:00:14.0/usb2/2-2/2-2:1.0/host6/target6:0:0/6:0:0:0");
+    ASSERT_TRUE(!scan_entry_is_current(root, &entry), "New USB path makes it stale");
+    ASSERT_EQ(block_listing_hash(root), before, "Same device names, same listing hash");
+
+    make_block("sdd", "8:48\n", NULL);
+    ASSERT_TRUE(block_listing_hash(root) != before, "A new device changes the listing hash");
+}
+
+void test_detect_cache_round_trip(void) {
+    TEST_CASE("Detection cache stores entries and the listing hash");
+
+    char dir[128];
+    snprintf(dir, sizeof(dir), "%s/cache", root);
+
+    jm_scan_entry_t entries[8], loaded[8];
+    int n = scan_jmicron_devices(root, entries, 8);
+    uint32_t hash = 0;
+    ASSERT_EQ(n, 2, "Scan finds both devices");
+
+    ASSERT_EQ(jm_detect_cache_store(dir, 0x1234, entries, n), 0, "Store succeeds");
+    ASSERT_EQ(jm_detect_cache_load(dir, loaded, 8, &hash), n, "All entries load back");
+    ASSERT_EQ(hash, 0x1234, "Listing hash round-trips");
+    ASSERT_STR_EQ(loaded[0].controller.model, entries[0].controller.model, "Controller info round-trips");
+    ASSERT_EQ(jm_detect_cache_load(dir, loaded, 1, &hash), -1, "Too small an array is a miss");
+}
+
+int main(void) {
+    TEST_SUITE("Hardware Detection Scan");
+
+    snprintf(root, sizeof(root), "/tmp/jm_sysfs_test.%ld", (long)getpid());
+    mkdir(root, 0755);
+    build_tree();
+
+    test_probe_usb();
+    test_probe_pci();
+    test_probe_long_path();
+    test_scan();
+    test_detect_cache_round_trip();
+    test_entry_staleness();
+
+    char cmd[128];
+    snprintf(cmd, sizeof(cmd), "rm -rf %s", root);
+    if (system(cmd) != 0) {
+        fprintf(stderr, "Warning: could not remove %s\n", root);
+    }
+
+    TEST_SUMMARY();
+}
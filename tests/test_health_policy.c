@@ -0,0 +1,206 @@
+/**
+ * test_health_policy.c - Tests for the compiled SMART health policy
+ *
+ * config_compile merges the config thresholds with the built-in attribute
+ * definitions into a table indexed by attribute ID. Assessment through the
+ * table must give the same verdicts as the built-in rules when no config
+ * is set, and apply the config's limits when one is.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "test_framework.h"
+#include "../src/config.h"
+#include "../src/smart_parser.h"
+#include "../src/smart_attributes.h"
+
+static parsed_smart_attribute_t make_attr(uint8_t id, uint8_t value, uint8_t thresh, uint64_t raw) {
+    parsed_smart_attribute_t attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.id = id;
+    attr.current_value = value;
+    attr.worst_value = value;
+    attr.threshold = thresh;
+    attr.raw_value = raw;
+    attr.is_critical = is_critical_attribute(id);
+    return attr;
+}
+
+void test_definitions_lookup(void) {
+    TEST_CASE("Attribute definitions are indexed by ID");
+
+    const smart_attribute_def_t* def = get_attribute_definition(0xC5);
+    ASSERT_TRUE(def != NULL, "0xC5 is known");
+    ASSERT_EQ(def->id, 0xC5, "Entry matches its index");
+    ASSERT_STR_EQ(def->name, "Current_Pending_Sector", "Name comes from the table");
+    ASSERT_EQ(def->check, ATTR_CHECK_RAW_NONZERO, "Pending sectors fail on any raw count");
+    ASSERT_TRUE(get_attribute_definition(0x06) == NULL, "Unlisted ID is unknown");
+    ASSERT_TRUE(get_attribute_definition(0x00) == NULL, "ID 0 is unknown");
+    ASSERT_EQ(is_critical_attribute(0x05), 1, "0x05 is critical");
+    ASSERT_EQ(is_critical_attribute(0xFF), 0, "Unknown IDs are not critical");
+}
+
+void test_default_compile(void) {
+    TEST_CASE("Default config compiles the built-in rules");
+
+    smart_config_t config;
+    config_init_default(&config);
+
+    ASSERT_STR_EQ(config.rules[0x05].name, "Reallocated_Sector_Ct", "Rule carries the name");
+    ASSERT_EQ(config.rules[0x05].is_critical, 1, "Rule carries criticality");
+    ASSERT_EQ(config.rules[0xC2].check, ATTR_CHECK_TEMPERATURE, "0xC2 is a temperature");
+    ASSERT_EQ(config.rules[0xC2].temp_critical, CONFIG_DEFAULT_TEMP_CRITICAL, "Default temperature limit");
+    ASSERT_TRUE(config.rules[0x06].name == NULL, "Unknown ID has no name");
+    ASSERT_EQ(config.rules[0x05].has_raw_critical, 0, "No raw threshold by default");
+}
+
+void test_config_compile(void) {
+    TEST_CASE("Config thresholds are merged into the rules");
+
+    attribute_threshold_t attrs[3] = {
+        { 0x05, 1, 100 },
+        { 0x05, 1, 20 },       /* duplicate: lowest wins */
+        { 0x09, 0, 5 }         /* no raw_critical: ignored */
+    };
+
+    smart_config_t config;
+    config_init_default(&config);
+    config.has_temp_critical = 1;
+    config.temp_critical = 45;
+    config.attributes = attrs;
+    config.num_attributes = 3;
+    config_compile(&config);
+
+    ASSERT_EQ(config.rules[0x05].has_raw_critical, 1, "0x05 has a raw threshold");
+    ASSERT_EQ(config.rules[0x05].raw_critical, 20, "Duplicate ID keeps the lowest threshold");
+    ASSERT_EQ(config.rules[0x09].has_raw_critical, 0, "Entry without raw_critical is ignored");
+    ASSERT_EQ(config.rules[0xE7].temp_critical, 45, "Config temperature applies to every sensor");
+}
+
+void test_assess_builtin(void) {
+    TEST_CASE("Assessment without a config uses the built-in rules");
+
+    smart_set_config(NULL);
+
+    parsed_smart_attribute_t attr = make_attr(0x05, 100, 10, 0);
+    ASSERT_EQ(assess_attribute_health(&attr), ATTR_STATUS_PASSED, "No reallocations passes");
+    attr = make_attr(0x05, 100, 10, 1);
+    ASSERT_EQ(assess_attribute_health(&attr), ATTR_STATUS_FAILED, "One reallocation fails");
+    attr = make_attr(0xC2, 100, 0, 59);
+    ASSERT_EQ(assess_attribute_health(&attr), ATTR_STATUS_PASSED, "59 C passes");
+    attr = make_attr(0xC2, 100, 0, 0x0000003c);
+    ASSERT_EQ(assess_attribute_health(&attr), ATTR_STATUS_FAILED, "60 C fails");
+    attr = make_attr(0x01, 5, 6, 0);
+    ASSERT_EQ(assess_attribute_health(&attr), ATTR_STATUS_FAILED, "Value at/below threshold fails");
+    attr = make_attr(0x06, 100, 0, 12345);
+    ASSERT_EQ(assess_attribute_health(&attr), ATTR_STATUS_PASSED, "Unknown attribute passes");
+}
+
+void test_assess_with_config(void) {
+    TEST_CASE("Assessment applies the compiled config");
+
+    attribute_threshold_t attrs[1] = { { 0x09, 1, 1000 } };
+
+    smart_config_t config;
+    config_init_default(&config);
+    config.has_temp_critical = 1;
+    config.temp_critical = 40;
+    config.use_manufacturer_thresholds = 0;
+    config.attributes = attrs;
+    config.num_attributes = 1;
+    config_compile(&config);
+    smart_set_config(&config);
+
+    parsed_smart_attribute_t attr = make_attr(0x09, 99, 0, 1001);
+    ASSERT_EQ(assess_attribute_health(&attr), ATTR_STATUS_FAILED, "Raw above raw_critical fails");
+    attr = make_attr(0x09, 99, 0, 1000);
+    ASSERT_EQ(assess_attribute_health(&attr), ATTR_STATUS_PASSED, "Raw at raw_critical passes");
+    attr = make_attr(0xBE, 100, 0, 41);
+    ASSERT_EQ(assess_attribute_health(&attr), ATTR_STATUS_FAILED, "41 C fails a 40 C limit");
+    attr = make_attr(0x01, 5, 6, 0);
+    ASSERT_EQ(assess_attribute_health(&attr), ATTR_STATUS_PASSED,
+              "Manufacturer threshold ignored when disabled");
+
+    smart_set_config(NULL);
+}
+
+void test_combine_lookup(void) {
+    TEST_CASE("smart_combine_data matches thresholds and names by ID");
+
+    smart_values_page_t values;
+    smart_thresholds_page_t thresholds;
+    disk_smart_data_t data;
+    memset(&values, 0, sizeof(values));
+    memset(&thresholds, 0, sizeof(thresholds));
+
+    values.attributes[0].id = 0x05;
+    values.attributes[0].current_value = 100;
+    values.attributes[1].id = 0x06;
+    values.attributes[1].current_value = 3;
+    /* Thresholds in a different order than the values */
+    thresholds.thresholds[4].id = 0x06;
+    thresholds.thresholds[4].threshold = 2;
+    thresholds.thresholds[9].id = 0x05;
+    thresholds.thresholds[9].threshold = 10;
+
+    smart_set_config(NULL);
+    ASSERT_EQ(smart_combine_data(0, "Disk", &values, &thresholds, &data), 0, "Combine succeeds");
+    ASSERT_EQ(data.num_attributes, 2, "Both attributes parsed");
+    ASSERT_EQ(data.attributes[0].threshold, 10, "0x05 threshold found by ID");
+    ASSERT_EQ(data.attributes[1].threshold, 2, "0x06 threshold found by ID");
+    ASSERT_STR_EQ(data.attributes[0].name, "Reallocated_Sector_Ct", "Known name");
+    ASSERT_STR_EQ(data.attributes[1].name, "Unknown_Attribute", "Unknown name");
+    ASSERT_EQ(data.attributes[0].is_critical, 1, "Criticality from the rule");
+    ASSERT_EQ(data.overall_status, DISK_STATUS_PASSED, "Healthy disk passes");
+}
+
+/* Helper: Load a config from text; returns config_load's result */
+static int load_config_text(const char* text, smart_config_t* config) {
+    char path[] = "/tmp/test_health_policy_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) return -1;
+    int ok = write(fd, text, strlen(text)) == (ssize_t)strlen(text);
+    close(fd);
+    int result = ok ? config_load(path, config) : -1;
+    unlink(path);
+    return result;
+}
+
+void test_config_warm_probe(void) {
+    TEST_CASE("warm_probe enables the probe for all or listed devices");
+
+    smart_config_t config;
+
+    config_init_default(&config);
+    ASSERT_EQ(config_warm_probe(&config, "/dev/sdc"), 0, "Off by default");
+    ASSERT_EQ(config_warm_probe(NULL, "/dev/sdc"), 0, "No config");
+
+    ASSERT_EQ(load_config_text("{\"warm_probe\": [\"/dev/sdc\", \"/dev/sdd\"], "
+                               "\"temperature\": {\"critical\": 50}}", &config), 0, "List loads");
+    ASSERT_EQ(config_warm_probe(&config, "/dev/sdd"), 1, "Listed device");
+    ASSERT_EQ(config_warm_probe(&config, "/dev/sde"), 0, "Unlisted device");
+    ASSERT_EQ(config.temp_critical, 50, "Keys after the list still parse");
+    config_free(&config);
+    ASSERT_EQ(config.num_warm_probe_devices, 0, "List freed");
+
+    ASSERT_EQ(load_config_text("{\"warm_probe\": true}", &config), 0, "Boolean loads");
+    ASSERT_EQ(config_warm_probe(&config, "/dev/sdz"), 1, "Every device");
+    config_free(&config);
+}
+
+int main(void) {
+    TEST_SUITE("Health Policy");
+
+    test_definitions_lookup();
+    test_default_compile();
+    test_config_compile();
+    test_assess_builtin();
+    test_assess_with_config();
+    test_combine_lookup();
+    test_config_warm_probe();
+
+    TEST_SUMMARY();
+}
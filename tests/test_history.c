@@ -0,0 +1,317 @@
+/**
+ * test_history.c - Tests for the mmap'd SMART history ring
+ *
+ * Appends snapshots to a temporary history file and checks that scans
+ * decode the delta-encoded raw values, survive the ring wrapping, and
+ * recover at the next keyframe once a drive's base snapshot is overwritten,
+ * and that appends report what changed since the source's previous poll.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include "test_framework.h"
+#include "../src/jm_history.h"
+
+static char history_path[64];
+
+static void make_disk(disk_smart_data_t* disk, const char* serial, uint64_t reallocated, uint64_t temp) {
+    memset(disk, 0, sizeof(*disk));
+    disk->is_present = 1;
+    snprintf(disk->disk_name, sizeof(disk->disk_name), "WDC WD40EFRX");
+    snprintf(disk->serial_number, sizeof(disk->serial_number), "%s", serial);
+    disk->overall_status = DISK_STATUS_PASSED;
+    disk->num_attributes = 3;
+    disk->attributes[0].id = 5;
+    disk->attributes[0].current_value = 200;
+    disk->attributes[0].raw_value = reallocated;
+    disk->attributes[1].id = 9;
+    disk->attributes[1].current_value = 90;
+    disk->attributes[1].raw_value = 0x123456789ULL;
+    disk->attributes[2].id = 194;
+    disk->attributes[2].current_value = 110;
+    disk->attributes[2].raw_value = temp;
+}
+
+/* Scan collector: last raw of attribute 5 and 194 per snapshot of one serial */
+typedef struct {
+    const char* serial;
+    int count;
+    uint64_t first_seq;
+    uint64_t reallocated[64];
+    uint64_t temp[64];
+    int64_t timestamps[64];
+} collect_t;
+
+static int collect(void* ctx, const jm_history_snapshot_t* snap) {
+    collect_t* c = ctx;
+    if (strcmp(snap->serial, c->serial) != 0 || c->count >= 64) {
+        return 0;
+    }
+    if (c->count == 0) c->first_seq = snap->seq;
+    c->reallocated[c->count] = snap->attributes[0].raw;
+    c->temp[c->count] = snap->attributes[2].raw;
+    c->timestamps[c->count] = snap->timestamp;
+    c->count++;
+    return 0;
+}
+
+void test_history_round_trip(void) {
+    TEST_CASE("Snapshots decode back to the appended raw values");
+
+    jm_history_t history;
+    unlink(history_path);
+    ASSERT_EQ(jm_history_open(&history, history_path, 1, 0, 0), 0, "Create should succeed");
+
+    disk_smart_data_t disks[2];
+    int appended = 0;
+    for (int i = 0; i < 20; i++) {
+        make_disk(&disks[0], "SERIAL-A", (uint64_t)i / 4, 30 + (uint64_t)(i % 5));
+        make_disk(&disks[1], "SERIAL-B", 7, 40);
+        appended += jm_history_append(&history, "/dev/sdc", disks, 2, 1000 + i * 60, NULL, NULL);
+    }
+    ASSERT_EQ(appended, 40, "Both drives appended every time");
+    jm_history_close(&history);
+
+    collect_t c = { .serial = "SERIAL-A" };
+    ASSERT_EQ(jm_history_open(&history, history_path, 0, 0, 0), 0, "Reopen read-only");
+    ASSERT_EQ(jm_history_scan(&history, collect, &c), 40, "Every snapshot is delivered");
+    jm_history_close(&history);
+
+    ASSERT_EQ(c.count, 20, "20 snapshots of drive A");
+    ASSERT_EQ(c.reallocated[19], 4, "Delta-encoded counter decodes to the last value");
+    ASSERT_EQ(c.temp[3], 33, "Decreasing values decode too");
+    ASSERT_EQ(c.temp[5], 30, "Value after a drop");
+    ASSERT_EQ(c.timestamps[19], 1000 + 19 * 60, "Timestamps round-trip");
+}
+
+void test_history_skips_unkeyed(void) {
+    TEST_CASE("Absent disks and disks without a serial are not recorded");
+
+    disk_smart_data_t disks[2];
+    make_disk(&disks[0], "", 0, 30);
+    make_disk(&disks[1], "SERIAL-C", 0, 30);
+    disks[1].is_present = 0;
+    ASSERT_EQ(jm_history_record(history_path, "/dev/sdc", disks, 2, 5000, NULL, NULL), 0, "Nothing to append");
+    ASSERT_EQ(jm_history_record("/nonexistent-dir/history", "/dev/sdc", disks, 2, 5000, NULL, NULL), -1, "Unopenable file is an error");
+}
+
+void test_history_wraps(void) {
+    TEST_CASE("Full ring overwrites the oldest snapshots");
+
+    jm_history_t history;
+    unlink(history_path);
+    ASSERT_EQ(jm_history_open(&history, history_path, 1, JM_HISTORY_MIN_SIZE, 0), 0, "Create a small ring");
+
+    /* Each snapshot is a few dozen bytes: thousands wrap 64 KiB */
+    disk_smart_data_t disk;
+    for (int i = 0; i < 5000; i++) {
+        make_disk(&disk, "SERIAL-W", (uint64_t)i, 35);
+        jm_history_append(&history, "/dev/sdc", &disk, 1, i, NULL, NULL);
+    }
+
+    collect_t *c = calloc(1, sizeof(collect_t));
+    c->serial = "SERIAL-W";
+    int delivered = jm_history_scan(&history, collect, c);
+    jm_history_close(&history);
+
+    ASSERT_TRUE(delivered > 100 && delivered < 5000, "Only the newest snapshots remain");
+    ASSERT_EQ(c->first_seq % JM_HISTORY_KEYFRAME_INTERVAL, 1, "Scan resumes at a keyframe");
+    ASSERT_EQ(c->reallocated[0], c->first_seq - 1, "First decoded value is absolute");
+    ASSERT_EQ(c->timestamps[0], (int64_t)(c->first_seq - 1), "And belongs to its snapshot");
+    free(c);
+}
+
+/* Change collector: counts per type, plus the last attribute change */
+typedef struct {
+    int counts[4];
+    jm_history_change_t last_attribute;
+    char removed_serial[24];
+} changes_t;
+
+static void collect_change(void* ctx, const jm_history_change_t* change) {
+    changes_t* c = ctx;
+    c->counts[change->type]++;
+    if (change->type == JM_HISTORY_ATTRIBUTE) c->last_attribute = *change;
+    if (change->type == JM_HISTORY_REMOVED) {
+        snprintf(c->removed_serial, sizeof(c->removed_serial), "%s", change->serial);
+    }
+}
+
+void test_history_changes(void) {
+    TEST_CASE("Appends report changes since the source's previous poll");
+
+    jm_history_t history;
+    disk_smart_data_t disks[2];
+    changes_t c;
+
+    unlink(history_path);
+    ASSERT_EQ(jm_history_open(&history, history_path, 1, 0, 0), 0, "Create should succeed");
+
+    make_disk(&disks[0], "SERIAL-A", 0, 30);
+    make_disk(&disks[1], "SERIAL-B", 0, 30);
+    memset(&c, 0, sizeof(c));
+    jm_history_append(&history, "/dev/sdc", disks, 2, 100, collect_change, &c);
+    ASSERT_EQ(c.counts[JM_HISTORY_ADDED], 2, "First poll adds every drive");
+
+    /* Temperature and power-on hours move every poll; they are not changes */
+    make_disk(&disks[0], "SERIAL-A", 0, 31);
+    disks[0].attributes[1].raw_value++;
+    memset(&c, 0, sizeof(c));
+    jm_history_append(&history, "/dev/sdc", disks, 2, 200, collect_change, &c);
+    ASSERT_EQ(c.counts[0] + c.counts[1] + c.counts[2] + c.counts[3], 0, "Unchanged poll reports nothing");
+
+    make_disk(&disks[0], "SERIAL-A", 8, 31);
+    disks[0].overall_status = DISK_STATUS_FAILED;
+    memset(&c, 0, sizeof(c));
+    jm_history_append(&history, "/dev/sdc", disks, 1, 300, collect_change, &c);
+    ASSERT_EQ(c.counts[JM_HISTORY_STATUS], 1, "Status change is reported");
+    ASSERT_EQ(c.counts[JM_HISTORY_ATTRIBUTE], 1, "Critical raw change is reported");
+    ASSERT_EQ(c.last_attribute.from.raw, 0, "Change carries the previous raw value");
+    ASSERT_EQ(c.last_attribute.to.raw, 8, "And the new one");
+    ASSERT_EQ(c.counts[JM_HISTORY_REMOVED], 1, "Drive missing from the poll is removed");
+    ASSERT_STR_EQ(c.removed_serial, "SERIAL-B", "The missing drive is removed");
+
+    /* Another source's poll doesn't see /dev/sdc's drives as missing */
+    memset(&c, 0, sizeof(c));
+    jm_history_append(&history, "/dev/sdd", disks, 0, 350, collect_change, &c);
+    jm_history_append(&history, "/dev/sdc", disks, 2, 400, collect_change, &c);
+    ASSERT_EQ(c.counts[JM_HISTORY_REMOVED], 0, "Removal is reported once");
+    ASSERT_EQ(c.counts[JM_HISTORY_ADDED], 1, "Returning drive is added again");
+    jm_history_close(&history);
+}
+
+/* Change collector that keeps the source of every change */
+typedef struct {
+    int counts[4];
+    int wrong_source;
+    const char* expected_source;
+} source_changes_t;
+
+static void collect_source_change(void* ctx, const jm_history_change_t* change) {
+    source_changes_t* c = ctx;
+    c->counts[change->type]++;
+    if (strcmp(change->source, c->expected_source) != 0) c->wrong_source++;
+}
+
+void test_history_long_sources(void) {
+    TEST_CASE("Long sources sharing a prefix are kept apart");
+
+    const char* a = "/dev/disk/by-id/usb-JMicron_H_W_RAID5_AAAAAAAAAAAA-0:0";
+    const char* b = "/dev/disk/by-id/usb-JMicron_H_W_RAID5_BBBBBBBBBBBB-0:0";
+    jm_history_t history;
+    disk_smart_data_t disks[2];
+    source_changes_t c;
+
+    unlink(history_path);
+    ASSERT_EQ(jm_history_open(&history, history_path, 1, 0, 0), 0, "Create should succeed");
+
+    make_disk(&disks[0], "SERIAL-A1", 0, 30);
+    make_disk(&disks[1], "SERIAL-A2", 0, 30);
+    memset(&c, 0, sizeof(c));
+    c.expected_source = a;
+    ASSERT_EQ(jm_history_append(&history, a, disks, 2, 100, collect_source_change, &c), 2, "Enclosure A recorded");
+    ASSERT_EQ(c.counts[JM_HISTORY_ADDED], 2, "A's drives are added");
+
+    make_disk(&disks[0], "SERIAL-B1", 0, 30);
+    make_disk(&disks[1], "SERIAL-B2", 0, 30);
+    memset(&c, 0, sizeof(c));
+    c.expected_source = b;
+    ASSERT_EQ(jm_history_append(&history, b, disks, 2, 100, collect_source_change, &c), 2, "Enclosure B recorded");
+    ASSERT_EQ(jm_history_append(&history, b, disks, 2, 200, collect_source_change, &c), 2, "B polled again");
+    ASSERT_EQ(c.counts[JM_HISTORY_ADDED], 2, "B's drives are added");
+    ASSERT_EQ(c.counts[JM_HISTORY_REMOVED], 0, "Polling B doesn't remove A's drives");
+    ASSERT_EQ(c.wrong_source, 0, "Changes carry the full source name");
+
+    make_disk(&disks[0], "SERIAL-A1", 0, 30);
+    make_disk(&disks[1], "SERIAL-A2", 0, 30);
+    memset(&c, 0, sizeof(c));
+    c.expected_source = a;
+    jm_history_append(&history, a, disks, 2, 300, collect_source_change, &c);
+    ASSERT_EQ(c.counts[0] + c.counts[1] + c.counts[2] + c.counts[3], 0, "A's next poll reports nothing");
+
+    /* A drive that moves between many sources reuses the names it left */
+    int appended = 0;
+    for (int i = 0; i < 400; i++) {
+        char source[128];
+        snprintf(source, sizeof(source), "host%03d.example.com:/dev/disk/by-id/usb-JMicron_H_W_RAID5_%064d", i, i);
+        appended += jm_history_append(&history, source, disks, 2, 400 + i, NULL, NULL);
+    }
+    ASSERT_EQ(appended, 800, "Unused source names are reclaimed");
+    jm_history_close(&history);
+}
+
+void test_history_reuses_drives(void) {
+    TEST_CASE("A full directory reuses the entry of a drive overwritten in the ring");
+
+    jm_history_t history;
+    disk_smart_data_t disks[2];
+    collect_t c;
+
+    unlink(history_path);
+    ASSERT_EQ(jm_history_open(&history, history_path, 1, JM_HISTORY_MIN_SIZE, 2), 0, "Create a two-drive file");
+    ASSERT_EQ(jm_history_max_drives(&history), 2, "Directory size is the one asked for");
+
+    make_disk(&disks[0], "WD-OLD", 0, 30);
+    make_disk(&disks[1], "WD-KEPT", 0, 31);
+    ASSERT_EQ(jm_history_append(&history, "/dev/sdc", disks, 2, 1000, NULL, NULL), 2, "Two drives fill it");
+
+    make_disk(&disks[0], "WD-NEW", 0, 32);
+    ASSERT_EQ(jm_history_append(&history, "/dev/sdd", disks, 1, 1001, NULL, NULL), -1,
+              "No entry is free while both drives have snapshots");
+
+    /* Enough snapshots of one drive to overwrite the other's */
+    int64_t t = 1002;
+    for (int i = 0; i < 4000; i++) {
+        jm_history_append(&history, "/dev/sdc", &disks[1], 1, t++, NULL, NULL);
+    }
+    ASSERT_EQ(jm_history_append(&history, "/dev/sdd", disks, 1, t, NULL, NULL), 1,
+              "The new drive takes over the overwritten one's entry");
+
+    memset(&c, 0, sizeof(c));
+    c.serial = "WD-NEW";
+    jm_history_scan(&history, collect, &c);
+    ASSERT_EQ(c.count, 1, "The new drive's snapshot is in the ring");
+    ASSERT_EQ(c.temp[0], 32, "Under its own values");
+
+    memset(&c, 0, sizeof(c));
+    c.serial = "WD-OLD";
+    jm_history_scan(&history, collect, &c);
+    ASSERT_EQ(c.count, 0, "The reused drive is gone");
+    jm_history_close(&history);
+
+    ASSERT_EQ(jm_history_open(&history, history_path, 1, 0, 50), 0, "Reopen");
+    ASSERT_EQ(jm_history_max_drives(&history), 2, "An existing file keeps its directory");
+    jm_history_close(&history);
+}
+
+void test_history_rejects_other_files(void) {
+    TEST_CASE("Non-history file is not opened");
+
+    FILE* f = fopen(history_path, "w");
+    fputs("not a history file", f);
+    fclose(f);
+
+    jm_history_t history;
+    ASSERT_EQ(jm_history_open(&history, history_path, 0, 0, 0), -1, "Read-only open fails");
+    ASSERT_EQ(jm_history_open(&history, history_path, 1, 0, 0), -1, "Writable open fails too");
+}
+
+int main(void) {
+    TEST_SUITE("SMART History Store");
+
+    snprintf(history_path, sizeof(history_path), "/tmp/jm_history_test.%ld", (long)getpid());
+
+    test_history_round_trip();
+    test_history_skips_unkeyed();
+    test_history_wraps();
+    test_history_changes();
+    test_history_long_sources();
+    test_history_reuses_drives();
+    test_history_rejects_other_files();
+
+    unlink(history_path);
+    TEST_SUMMARY();
+}
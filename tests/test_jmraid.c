@@ -0,0 +1,149 @@
+/**
+ * test_jmraid.c - Tests for the libjmraid public API
+ *
+ * Without a controller only the checks jmraid_open makes before talking to
+ * one are reachable: a regular file stands in for the block device.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include "test_framework.h"
+#include "../src/jmraid.h"
+#include "../src/jm_lock.h"
+
+static char run_dir[64];
+static char device_path[128];
+
+/* Helper: Write an image of 64 sectors with one byte set in `sector` (-1 = none) */
+static void write_image(int sector) {
+    uint8_t block[512];
+    FILE* f = fopen(device_path, "w");
+    if (f == NULL) return;
+    for (int i = 0; i < 64; i++) {
+        memset(block, 0, sizeof(block));
+        if (i == sector) block[100] = 0x5A;
+        fwrite(block, 1, sizeof(block), f);
+    }
+    fclose(f);
+}
+
+void test_options_defaults(void) {
+    TEST_CASE("Options default to the jmraidstatus settings");
+
+    jmraid_options_t options;
+    memset(&options, 0xFF, sizeof(options));
+    jmraid_options_init(&options);
+    ASSERT_EQ(options.sector, 33, "Default sector is 33");
+    ASSERT_EQ(options.retries, 2, "Default retries is 2");
+    ASSERT_EQ(options.force, 0, "Detection is on by default");
+    ASSERT_EQ(options.expected_disks, 0, "Degraded detection is off by default");
+    ASSERT_EQ(options.lock_timeout_ms, JM_LOCK_DEFAULT_TIMEOUT_MS, "Default lock timeout");
+    ASSERT_TRUE(options.run_dir != NULL && strcmp(options.run_dir, JM_RUN_DEFAULT_DIR) == 0,
+                "Locks in the default run directory");
+    ASSERT_TRUE(options.cache_dir == NULL, "Cache is off by default");
+    ASSERT_EQ(jmraid_abi_version(), JMRAID_ABI_VERSION, "ABI version matches the header");
+}
+
+void test_strerror(void) {
+    TEST_CASE("Every error code has a message");
+
+    for (int code = JMRAID_OK; code <= JMRAID_ERR_POLL; code++) {
+        const char* message = jmraid_strerror(code);
+        ASSERT_TRUE(message != NULL && strcmp(message, "Unknown error") != 0, "Known code has a message");
+    }
+    ASSERT_TRUE(strcmp(jmraid_strerror(99), "Unknown error") == 0, "Unknown code");
+}
+
+void test_open_invalid_args(void) {
+    TEST_CASE("Open rejects invalid arguments before touching the device");
+
+    jmraid_options_t options;
+    int error = 0;
+
+    jmraid_options_init(&options);
+    options.sector = 0;
+    ASSERT_TRUE(jmraid_open(device_path, &options, &error) == NULL, "Sector 0 is rejected");
+    ASSERT_EQ(error, JMRAID_ERR_ARGS, "Unsafe sector is an argument error");
+
+    jmraid_options_init(&options);
+    options.retries = 11;
+    ASSERT_TRUE(jmraid_open(device_path, &options, &error) == NULL, "Too many retries");
+    ASSERT_EQ(error, JMRAID_ERR_ARGS, "Retries out of range is an argument error");
+
+    ASSERT_TRUE(jmraid_open(NULL, NULL, &error) == NULL, "NULL path is rejected");
+    ASSERT_EQ(error, JMRAID_ERR_ARGS, "NULL path is an argument error");
+
+    jmraid_close(NULL);
+}
+
+void test_open_sector_checks(void) {
+    TEST_CASE("Open refuses a mailbox sector that holds data");
+
+    jmraid_options_t options;
+    int error = 0;
+
+    jmraid_options_init(&options);
+    options.force = 1;
+    options.run_dir = run_dir;
+
+    write_image(33);
+    ASSERT_TRUE(jmraid_open(device_path, &options, &error) == NULL, "Used sector is refused");
+    ASSERT_EQ(error, JMRAID_ERR_SECTOR_IN_USE, "Used sector error");
+
+    /* Empty sector: gets as far as the SG check */
+    write_image(-1);
+    ASSERT_TRUE(jmraid_open(device_path, &options, &error) == NULL, "Regular file is refused");
+    ASSERT_EQ(error, JMRAID_ERR_NOT_SG, "Regular file is not an SG device");
+
+    options.sector = 100;
+    ASSERT_TRUE(jmraid_open(device_path, &options, &error) == NULL, "Sector past the end is refused");
+    ASSERT_EQ(error, JMRAID_ERR_OPEN, "Unreadable sector is an open error");
+}
+
+void test_open_locked(void) {
+    TEST_CASE("Open gives up while another process holds the mailbox");
+
+    jmraid_options_t options;
+    jm_lock_t other;
+    int error = 0;
+
+    write_image(-1);
+    jmraid_options_init(&options);
+    options.force = 1;
+    options.run_dir = run_dir;
+    options.lock_timeout_ms = 20;
+
+    ASSERT_EQ(jm_lock_open(&other, run_dir, device_path), 0, "Other lock should open");
+    ASSERT_EQ(jm_lock_acquire(&other, 0) >= 0, 1, "Other lock should be taken");
+    ASSERT_TRUE(jmraid_open(device_path, &options, &error) == NULL, "Open should time out");
+    ASSERT_EQ(error, JMRAID_ERR_LOCKED, "Held lock is reported");
+    jm_lock_close(&other);
+}
+
+int main(void) {
+    TEST_SUITE("libjmraid API");
+
+    snprintf(run_dir, sizeof(run_dir), "/tmp/jm_lib_test.XXXXXX");
+    if (mkdtemp(run_dir) == NULL) {
+        perror("mkdtemp");
+        return 1;
+    }
+    snprintf(device_path, sizeof(device_path), "%s/sdz", run_dir);
+
+    test_options_defaults();
+    test_strerror();
+    test_open_invalid_args();
+    test_open_sector_checks();
+    test_open_locked();
+
+    char path[160];
+    snprintf(path, sizeof(path), "%s/sdz.lock", run_dir);
+    unlink(path);
+    unlink(device_path);
+    rmdir(run_dir);
+
+    TEST_SUMMARY();
+}
@@ -0,0 +1,190 @@
+/*
+ * test_json_writer.c - Unit tests for the buffered JSON writer
+ *
+ * Copyright (C) 2026 Jamie Treworgy
+ * SPDX-License-Identifier: MIT
+ */
+
+#define JSMN_HEADER  /* jsmn declarations only (via common.h) */
+#include "test_framework.h"
+#include "../src/parsers/common.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Helper: The writer's buffered text, NUL-terminated in a static copy */
+static const char* buffered(const json_writer_t* w) {
+    static char text[1024];
+    size_t n = w->len < sizeof(text) - 1 ? w->len : sizeof(text) - 1;
+    memcpy(text, w->buf, n);
+    text[n] = '\0';
+    return text;
+}
+
+void test_compact_document(void) {
+    TEST_CASE("Compact mode writes one line with no whitespace");
+
+    json_writer_t w;
+    json_writer_init(&w, 0);
+    json_begin_object(&w, NULL);
+    json_write_string(&w, "device", "/dev/sdc");
+    json_write_null(&w, "raid_status");
+    json_begin_array(&w, "disks");
+    json_begin_object(&w, NULL);
+    json_write_int(&w, "id", 194);
+    json_write_bool(&w, "critical", 0);
+    json_end(&w);
+    json_end(&w);
+    json_begin_array(&w, "issues");
+    json_end(&w);
+    json_end(&w);
+
+    ASSERT_STR_EQ(buffered(&w),
+                  "{\"device\":\"/dev/sdc\",\"raid_status\":null,"
+                  "\"disks\":[{\"id\":194,\"critical\":false}],\"issues\":[]}\n",
+                  "Members, nesting, empty array and the closing newline");
+    json_writer_free(&w);
+}
+
+void test_pretty_document(void) {
+    TEST_CASE("Pretty mode indents two spaces per level, inline containers stay on one line");
+
+    json_writer_t w;
+    json_writer_init(&w, 1);
+    json_begin_object(&w, NULL);
+    json_begin_inline(&w, "slots", '[');
+    json_write_int(&w, NULL, 0);
+    json_write_int(&w, NULL, 2);
+    json_end(&w);
+    json_begin_object(&w, "phases");
+    json_begin_inline(&w, "open", '{');
+    json_write_uint(&w, "count", 1);
+    json_write_uint(&w, "max_us", 40);
+    json_end(&w);
+    json_end(&w);
+    json_begin_array(&w, "issues");
+    json_end(&w);
+    json_end(&w);
+
+    ASSERT_STR_EQ(buffered(&w),
+                  "{\n"
+                  "  \"slots\": [0, 2],\n"
+                  "  \"phases\": {\n"
+                  "    \"open\": {\"count\": 1, \"max_us\": 40}\n"
+                  "  },\n"
+                  "  \"issues\": []\n"
+                  "}\n",
+                  "Same layout as the hand-written printf output");
+    json_writer_free(&w);
+}
+
+void test_string_escapes(void) {
+    TEST_CASE("Strings escape quotes, backslashes and control characters");
+
+    json_writer_t w;
+    json_writer_init(&w, 0);
+    json_write_string(&w, NULL, "WDC \"Red\"\\\n\t\x01\x1f");
+    ASSERT_STR_EQ(buffered(&w), "\"WDC \\\"Red\\\"\\\\\\n\\t\\u0001\\u001f\"",
+                  "Short escapes where JSON has them, \\u00XX otherwise");
+
+    json_writer_reset(&w, 0);
+    json_write_string(&w, NULL, "caf\xc3\xa9");
+    ASSERT_STR_EQ(buffered(&w), "\"caf\xc3\xa9\"", "UTF-8 is copied through");
+
+    json_writer_reset(&w, 0);
+    json_write_string(&w, NULL, NULL);
+    ASSERT_STR_EQ(buffered(&w), "null", "A NULL string is null");
+    json_writer_free(&w);
+}
+
+void test_numbers(void) {
+    TEST_CASE("Integers are written in full without printf");
+
+    json_writer_t w;
+    json_writer_init(&w, 0);
+    json_begin_inline(&w, NULL, '[');
+    json_write_int(&w, NULL, 0);
+    json_write_int(&w, NULL, -42);
+    json_write_int(&w, NULL, INT64_MIN);
+    json_write_uint(&w, NULL, UINT64_MAX);
+    json_write_hex(&w, NULL, (const uint8_t*)"\x0f\xa0", 2);
+    json_end(&w);
+
+    ASSERT_STR_EQ(buffered(&w), "[0,-42,-9223372036854775808,18446744073709551615,\"0fa0\"]\n",
+                  "Zero, negatives, both extremes and hex bytes");
+    json_writer_free(&w);
+}
+
+void test_doubles(void) {
+    TEST_CASE("Doubles take fixed decimals or the shortest form");
+
+    json_writer_t w;
+    json_writer_init(&w, 0);
+    json_begin_inline(&w, NULL, '[');
+    json_write_double(&w, NULL, 32.0, 2);
+    json_write_double(&w, NULL, -0.125, 1);
+    json_write_double(&w, NULL, 10.0, -1);
+    json_write_double(&w, NULL, 0.5, -1);
+    json_write_double(&w, NULL, 0.0 / 0.0, 2);
+    json_end(&w);
+
+    ASSERT_STR_EQ(buffered(&w), "[32.00,-0.1,10,0.5,null]\n", "Fixed, rounded, %g-style and NaN as null");
+    json_writer_free(&w);
+}
+
+void test_flush(void) {
+    TEST_CASE("Flush writes the buffer out and keeps the nesting state");
+
+    char* text = NULL;
+    size_t len = 0;
+    FILE* out = open_memstream(&text, &len);
+    json_writer_t w;
+    json_writer_init(&w, 0);
+
+    json_begin_object(&w, NULL);
+    json_begin_array(&w, "sources");
+    json_write_int(&w, NULL, 1);
+    ASSERT_EQ(json_writer_flush(&w, out), 0, "First part written");
+    ASSERT_EQ(w.len, 0, "Buffer emptied");
+    json_write_int(&w, NULL, 2);
+    json_end(&w);
+    json_end(&w);
+    ASSERT_EQ(json_writer_flush(&w, out), 0, "Second part written");
+    fclose(out);
+
+    ASSERT_STR_EQ(text, "{\"sources\":[1,2]}\n", "Separators continue across flushes");
+    free(text);
+    json_writer_free(&w);
+}
+
+void test_large_document(void) {
+    TEST_CASE("The buffer grows past its initial size");
+
+    json_writer_t w;
+    json_writer_init(&w, 0);
+    json_begin_array(&w, NULL);
+    for (int i = 0; i < 5000; i++) {
+        json_write_string(&w, NULL, "Reallocated_Sector_Ct");
+    }
+    json_end(&w);
+
+    ASSERT_FALSE(w.failed, "No allocation failure");
+    ASSERT_EQ(w.len, 5000 * 23 + 4999 + 3, "Every element, separator and the newline");
+    ASSERT_TRUE(w.buf[0] == '[' && w.buf[w.len - 2] == ']', "Document is complete");
+    json_writer_free(&w);
+}
+
+int main(void) {
+    TEST_SUITE("JSON Writer");
+
+    test_compact_document();
+    test_pretty_document();
+    test_string_escapes();
+    test_numbers();
+    test_doubles();
+    test_flush();
+    test_large_document();
+
+    TEST_SUMMARY();
+}
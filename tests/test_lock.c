@@ -0,0 +1,126 @@
+/**
+ * test_lock.c - Tests for the mailbox lock and the shared poll result
+ *
+ * Two lock handles on one file stand in for two processes: flock() locks
+ * belong to the open file, so they exclude each other within one process.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include "test_framework.h"
+#include "../src/jm_lock.h"
+#include "../src/jm_cache.h"
+
+static char run_dir[64];
+static char device_path[128];
+
+void test_lock_key(void) {
+    TEST_CASE("Lock key is the kernel name behind a symlink");
+
+    char link_path[128], key[64];
+    snprintf(link_path, sizeof(link_path), "%s/by-id-link", run_dir);
+    ASSERT_EQ(symlink(device_path, link_path), 0, "Should create symlink");
+
+    ASSERT_EQ(jm_lock_key(link_path, key, sizeof(key)), 0, "Key should resolve");
+    ASSERT_TRUE(strcmp(key, "sdz") == 0, "Key should be the link target's name");
+    ASSERT_EQ(jm_lock_key("/nonexistent/sdq", key, sizeof(key)), -1, "Missing device has no key");
+    unlink(link_path);
+}
+
+void test_lock_exclusion(void) {
+    TEST_CASE("Second holder times out while the lock is held");
+
+    jm_lock_t a, b;
+    ASSERT_EQ(jm_lock_open(&a, run_dir, device_path), 0, "First open should succeed");
+    ASSERT_EQ(jm_lock_open(&b, run_dir, device_path), 0, "Second open should succeed");
+
+    ASSERT_EQ(jm_lock_acquire(&a, 0), 0, "First acquire should succeed");
+    ASSERT_EQ(jm_lock_acquire(&b, 20), -1, "Second acquire should time out");
+    jm_lock_release(&a);
+    ASSERT_TRUE(jm_lock_acquire(&b, 20) >= 0, "Acquire after release should succeed");
+
+    jm_lock_close(&a);
+    jm_lock_close(&b);
+}
+
+void test_lock_generation(void) {
+    TEST_CASE("Another holder's exchange is reported on the next acquire");
+
+    jm_lock_t a, b;
+    jm_lock_open(&a, run_dir, device_path);
+    jm_lock_open(&b, run_dir, device_path);
+
+    ASSERT_EQ(jm_lock_acquire(&a, 0), 0, "No exchange since open");
+    jm_lock_release(&a);
+    ASSERT_EQ(jm_lock_acquire(&a, 0), 0, "Own exchange is not reported");
+    jm_lock_release(&a);
+
+    ASSERT_EQ(jm_lock_acquire(&b, 0), 1, "Exchange after open is reported");
+    jm_lock_release(&b);
+    ASSERT_EQ(jm_lock_acquire(&a, 0), 1, "Other handle's exchange is reported");
+    jm_lock_release(&a);
+
+    jm_lock_close(&a);
+    jm_lock_close(&b);
+
+    jm_lock_t closed;
+    jm_lock_init(&closed);
+    ASSERT_EQ(jm_lock_acquire(&closed, 0), -1, "Unopened lock cannot be taken");
+}
+
+void test_result_round_trip(void) {
+    TEST_CASE("Shared poll result loads back with attribute names resolved");
+
+    static jm_result_entry_t entry, loaded;
+    memset(&entry, 0, sizeof(entry));
+    entry.timestamp = 1700000000;
+    entry.num_disks = 1;
+    entry.present_disks = 1;
+    snprintf(entry.controller_model, sizeof(entry.controller_model), "JMB394");
+    entry.disks[0].is_present = 1;
+    snprintf(entry.disks[0].serial_number, sizeof(entry.disks[0].serial_number), "WD-SERIAL0");
+    entry.disks[0].num_attributes = 1;
+    entry.disks[0].attributes[0].id = 0x05;
+
+    ASSERT_EQ(jm_result_store(run_dir, device_path, &entry), 0, "Store should succeed");
+    ASSERT_EQ(jm_result_load(run_dir, device_path, &loaded), 0, "Load should succeed");
+    ASSERT_EQ(loaded.timestamp, 1700000000, "Timestamp should round-trip");
+    ASSERT_TRUE(strcmp(loaded.controller_model, "JMB394") == 0, "Controller model should round-trip");
+    ASSERT_TRUE(strcmp(loaded.disks[0].serial_number, "WD-SERIAL0") == 0, "Serial should round-trip");
+    ASSERT_TRUE(loaded.disks[0].attributes[0].name != NULL &&
+                strcmp(loaded.disks[0].attributes[0].name, "Reallocated_Sector_Ct") == 0,
+                "Attribute name should be re-resolved");
+    ASSERT_EQ(jm_result_load(run_dir, "/nonexistent/sdq", &loaded), -1, "Unknown device should miss");
+}
+
+int main(void) {
+    TEST_SUITE("Mailbox Lock / Shared Result");
+
+    snprintf(run_dir, sizeof(run_dir), "/tmp/jm_lock_test.XXXXXX");
+    if (mkdtemp(run_dir) == NULL) {
+        perror("mkdtemp");
+        return 1;
+    }
+    /* A regular file stands in for the block device */
+    snprintf(device_path, sizeof(device_path), "%s/sdz", run_dir);
+    FILE* f = fopen(device_path, "w");
+    if (f) fclose(f);
+
+    test_lock_key();
+    test_lock_exclusion();
+    test_lock_generation();
+    test_result_round_trip();
+
+    char path[160];
+    snprintf(path, sizeof(path), "%s/sdz.lock", run_dir);
+    unlink(path);
+    snprintf(path, sizeof(path), "%s/sdz.result", run_dir);
+    unlink(path);
+    unlink(device_path);
+    rmdir(run_dir);
+
+    TEST_SUMMARY();
+}
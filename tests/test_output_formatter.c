@@ -9,6 +9,7 @@
 #include "test_framework.h"
 #include "../src/output_formatter.h"
 #include "../src/smart_parser.h"
+#include "../src/health_record.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -100,7 +101,7 @@ void test_json_valid_structure(void) {
     disks[0].overall_status = DISK_STATUS_PASSED;
 
     setup_output_capture();
-    format_json("/dev/sdX", disks, 1, 0, 0, 0, NULL);
+    format_json("/dev/sdX", disks, 1, 0, 0, 0, NULL, NULL);
     teardown_output_capture();
 
     const char* output = get_captured_output();
@@ -121,7 +122,7 @@ void test_json_includes_raid_status(void) {
     disks[0].overall_status = DISK_STATUS_PASSED;
 
     setup_output_capture();
-    format_json("/dev/sdX", disks, 1, 4, 3, 1, NULL);  /* degraded: expect 4, found 3 */
+    format_json("/dev/sdX", disks, 1, 4, 3, 1, NULL, NULL);  /* degraded: expect 4, found 3 */
     teardown_output_capture();
 
     const char* output = get_captured_output();
@@ -147,7 +148,7 @@ void test_json_degraded_with_issues(void) {
     disks[0].overall_status = DISK_STATUS_PASSED;
 
     setup_output_capture();
-    format_json("/dev/sdX", disks, 1, 5, 4, 1, NULL);  /* degraded: expect 5, found 4 */
+    format_json("/dev/sdX", disks, 1, 5, 4, 1, NULL, NULL);  /* degraded: expect 5, found 4 */
     teardown_output_capture();
 
     const char* output = get_captured_output();
@@ -168,7 +169,7 @@ void test_json_oversized_array(void) {
     }
 
     setup_output_capture();
-    format_json("/dev/sdX", disks, 5, 4, 5, 0, NULL);  /* oversized: expect 4, found 5 */
+    format_json("/dev/sdX", disks, 5, 4, 5, 0, NULL, NULL);  /* oversized: expect 4, found 5 */
     teardown_output_capture();
 
     const char* output = get_captured_output();
@@ -190,7 +191,7 @@ void test_json_failed_disk(void) {
     disks[0].overall_status = DISK_STATUS_FAILED;
 
     setup_output_capture();
-    format_json("/dev/sdX", disks, 1, 0, 0, 0, NULL);  /* single failed disk */
+    format_json("/dev/sdX", disks, 1, 0, 0, 0, NULL, NULL);  /* single failed disk */
     teardown_output_capture();
 
     const char* output = get_captured_output();
@@ -213,7 +214,7 @@ void test_json_healthy_no_issues(void) {
     }
 
     setup_output_capture();
-    format_json("/dev/sdX", disks, 4, 4, 4, 0, NULL);  /* healthy: all good */
+    format_json("/dev/sdX", disks, 4, 4, 4, 0, NULL, NULL);  /* healthy: all good */
     teardown_output_capture();
 
     const char* output = get_captured_output();
@@ -234,7 +235,7 @@ void test_json_no_extraneous_output(void) {
     disks[0].overall_status = DISK_STATUS_PASSED;
 
     setup_output_capture();
-    format_json("/dev/sdX", disks, 1, 5, 4, 1, NULL);  /* degraded */
+    format_json("/dev/sdX", disks, 1, 5, 4, 1, NULL, NULL);  /* degraded */
     teardown_output_capture();
 
     const char* output = get_captured_output();
@@ -252,6 +253,240 @@ void test_json_no_extraneous_output(void) {
     }
 }
 
+/* Test: NDJSON output is a single compact line */
+void test_json_line_single_line(void) {
+    TEST_CASE("JSON line output is one compact NDJSON record");
+
+    disk_smart_data_t disks[5] = {0};
+    disks[0].is_present = 1;
+    disks[0].disk_number = 0;
+    strncpy(disks[0].disk_name, "TEST DISK WITH SPACES", sizeof(disks[0].disk_name) - 1);
+    disks[0].overall_status = DISK_STATUS_PASSED;
+
+    setup_output_capture();
+    format_json_line("/dev/sdX", disks, 1, 4, 3, 1, "JMB394", NULL);
+    teardown_output_capture();
+
+    const char* output = get_captured_output();
+    const char* newline = strchr(output, '\n');
+
+    ASSERT_TRUE(is_valid_json(output), "JSON line should be valid");
+    ASSERT_TRUE(newline != NULL && newline[1] == '\0', "Output should be exactly one newline-terminated line");
+    ASSERT_TRUE(strstr(output, "\"status\":\"degraded\"") != NULL, "Whitespace between tokens should be removed");
+    ASSERT_TRUE(strstr(output, "\"model\":\"TEST DISK WITH SPACES\"") != NULL,
+                "Whitespace inside strings should be preserved");
+    ASSERT_TRUE(strstr(output, "\"issues\":[\"Degraded:") != NULL, "Issues array should be compacted");
+}
+
+/* Test: --timings adds a fixed-schema timings object */
+void test_json_timings(void) {
+    TEST_CASE("JSON includes timings object when timings are given");
+
+    disk_smart_data_t disks[5] = {0};
+    disks[0].is_present = 1;
+    disks[0].overall_status = DISK_STATUS_PASSED;
+
+    jm_timings_t timings;
+    memset(&timings, 0, sizeof(timings));
+    jm_latency_add(&timings.commands[JM_CMD_SMART_VALUES], 1200);
+    jm_latency_add(&timings.commands[JM_CMD_SMART_VALUES], 3400);
+    jm_latency_add(&timings.phases[JM_PHASE_WAKEUP], 800);
+
+    setup_output_capture();
+    format_json_line("/dev/sdX", disks, 1, 0, 0, 0, NULL, &timings);
+    teardown_output_capture();
+
+    const char* output = get_captured_output();
+    ASSERT_TRUE(is_valid_json(output), "JSON with timings should be valid");
+    ASSERT_TRUE(strstr(output, "\"smart_values\":{\"count\":2,\"total_us\":4600,\"max_us\":3400}") != NULL,
+                "Command stats carry count, total and max");
+    ASSERT_TRUE(strstr(output, "\"wakeup\":{\"count\":1,") != NULL, "Phase stats are included");
+    ASSERT_TRUE(strstr(output, "\"identify\":{\"count\":0,") != NULL, "Unused command types are still present");
+
+    setup_output_capture();
+    format_json_line("/dev/sdX", disks, 1, 0, 0, 0, NULL, NULL);
+    teardown_output_capture();
+    ASSERT_TRUE(strstr(get_captured_output(), "timings") == NULL, "No timings object without --timings");
+}
+
+void test_json_command_retries(void) {
+    TEST_CASE("JSON reports command retries only for disks that needed them");
+
+    disk_smart_data_t disks[5] = {0};
+    disks[0].is_present = 1;
+    disks[0].overall_status = DISK_STATUS_PASSED;
+    disks[1].is_present = 1;
+    disks[1].disk_number = 1;
+    disks[1].overall_status = DISK_STATUS_PASSED;
+    disks[1].command_retries = 2;
+
+    setup_output_capture();
+    format_json_line("/dev/sdX", disks, 2, 0, 0, 0, NULL, NULL);
+    teardown_output_capture();
+
+    const char* output = get_captured_output();
+    ASSERT_TRUE(is_valid_json(output), "JSON with retries should be valid");
+    ASSERT_TRUE(strstr(output, "\"disk_number\":1,\"model\":\"Unknown\",\"overall_status\":\"healthy\",\"command_retries\":2,") != NULL,
+                "Disk 1 carries its retry count");
+    ASSERT_TRUE(strstr(output, "\"command_retries\":0") == NULL, "Zero retries are omitted");
+}
+
+void test_binary_record(void) {
+    TEST_CASE("Binary record carries the present disks in a fixed layout");
+
+    disk_smart_data_t disks[5] = {0};
+    disks[0].is_present = 1;
+    strncpy(disks[0].disk_name, "TEST_DISK", sizeof(disks[0].disk_name) - 1);
+    disks[0].overall_status = DISK_STATUS_PASSED;
+    disks[0].num_attributes = 1;
+    disks[0].attributes[0].id = 5;
+    disks[0].attributes[0].current_value = 100;
+    disks[0].attributes[0].raw_value = 0x0102030405ULL;
+    disks[2].is_present = 1;
+    disks[2].overall_status = DISK_STATUS_FAILED;
+
+    /* Binary output: capture by length, not as a string */
+    fflush(stdout);
+    FILE* saved = stdout;
+    stdout = fmemopen(output_buffer, sizeof(output_buffer), "w");
+    format_record("/dev/sdX", disks, NULL, NULL);
+    fflush(stdout);
+    size_t written = (size_t)ftell(stdout);
+    fclose(stdout);
+    stdout = saved;
+
+    const uint8_t* p = (const uint8_t*)output_buffer;
+    size_t size = 0;
+    ASSERT_EQ(health_record_size(p, written, &size), 1, "Output starts with a record header");
+    ASSERT_EQ(size, written, "Header length covers the whole record");
+    ASSERT_MEM_EQ(p, HEALTH_RECORD_MAGIC, HEALTH_RECORD_MAGIC_LEN, "Record starts with the magic");
+    ASSERT_EQ(p[4] | (p[5] << 8), HEALTH_RECORD_VERSION, "Version is little-endian");
+    ASSERT_EQ(written, sizeof(health_record_header_t) + sizeof(health_record_source_t) +
+                       2 * sizeof(health_record_disk_t) + sizeof(health_record_attribute_t),
+              "Two disks, one attribute, no timings");
+
+    const health_record_source_t* source = (const void*)(p + sizeof(health_record_header_t));
+    ASSERT_STR_EQ(source->backend, "jmicron", "Backend is jmicron");
+    ASSERT_STR_EQ(source->controller_model, "Unknown", "Missing controller model falls back to Unknown");
+    ASSERT_EQ(source->num_disks, 2, "Only present disks are written");
+
+    const uint8_t* disk0 = (const uint8_t*)(source + 1);
+    const uint8_t* attr = disk0 + sizeof(health_record_disk_t);
+    ASSERT_STR_EQ((const char*)disk0 + 4, "TEST_DISK", "Disk model follows disk_number");
+    ASSERT_EQ(attr[0], 5, "Attribute ID");
+    ASSERT_TRUE(attr[8] == 0x05 && attr[12] == 0x01, "Raw value is little-endian");
+
+    const uint8_t* disk2 = attr + sizeof(health_record_attribute_t);
+    ASSERT_EQ(disk2[0], 2, "Second disk keeps its slot number");
+    ASSERT_STR_EQ((const char*)disk2 + 4, "Unknown", "Unnamed disk is reported as Unknown");
+}
+
+/* Test: --flags status derivation from the presence bitmask and rebuild byte */
+void test_flags_status(void) {
+    TEST_CASE("RAID flags status derives from presence and rebuild bytes");
+
+    jm_raid_flags_t flags = {0};
+    flags.presence = 0x0f;
+    ASSERT_STR_EQ(raid_flags_status(&flags, 4), "healthy", "All expected disks present");
+    ASSERT_STR_EQ(raid_flags_status(&flags, 0), "healthy", "No array size: presence alone is healthy");
+    ASSERT_STR_EQ(raid_flags_status(&flags, 3), "oversized", "More disks than expected");
+
+    flags.presence = 0x07;
+    ASSERT_STR_EQ(raid_flags_status(&flags, 4), "degraded", "Missing disk is degraded");
+    flags.rebuild = 0x01;
+    ASSERT_STR_EQ(raid_flags_status(&flags, 4), "rebuilding", "Rebuild outranks degraded");
+}
+
+/* Test: --flags JSON carries the flags without a disks array */
+void test_flags_json(void) {
+    TEST_CASE("RAID flags JSON line has presence, rebuild and raw bytes");
+
+    jm_raid_flags_t flags = {0};
+    flags.presence = 0x0b;
+    flags.phase = 0x80;
+    flags.raw[0] = 0x0b;
+    flags.raw[10] = 0x80;
+
+    setup_output_capture();
+    format_flags_json("/dev/sdX", &flags, 4, "JMB394", NULL, 1);
+    teardown_output_capture();
+
+    const char* output = get_captured_output();
+    const char* newline = strchr(output, '\n');
+
+    ASSERT_TRUE(is_valid_json(output), "Flags JSON should be valid");
+    ASSERT_TRUE(newline != NULL && newline[1] == '\0', "Compact output should be one line");
+    ASSERT_TRUE(strstr(output, "\"status\":\"degraded\"") != NULL, "Three of four disks is degraded");
+    ASSERT_TRUE(strstr(output, "\"present_disks\":3") != NULL, "Present disks counted from bitmask");
+    ASSERT_TRUE(strstr(output, "\"present_slots\":[0,1,3]") != NULL, "Present slots listed from bitmask");
+    ASSERT_TRUE(strstr(output, "\"rebuilding\":false") != NULL, "Rebuild byte 0 is not rebuilding");
+    ASSERT_TRUE(strstr(output, "\"raw\":\"0b0000000000000000008000\"") != NULL, "Raw bytes in hex");
+    ASSERT_FALSE(json_contains_key(output, "disks"), "No disks array without SMART reads");
+}
+
+/* Test: --fields parsing */
+void test_fields_parse(void) {
+    TEST_CASE("--fields parses names and attribute IDs");
+
+    output_fields_t fields;
+    ASSERT_EQ(format_parse_fields("identity", &fields), 0, "identity parses");
+    ASSERT_TRUE(fields.identity && !fields.values && !fields.thresholds, "identity alone reads no SMART");
+
+    ASSERT_EQ(format_parse_fields("194,0x05,197", &fields), 0, "Attribute IDs parse");
+    ASSERT_TRUE(fields.values && !fields.thresholds && !fields.identity, "IDs imply values only");
+    ASSERT_TRUE(fields.filter_attributes && fields.attribute_ids[194] && fields.attribute_ids[5] &&
+                fields.attribute_ids[197] && !fields.attribute_ids[198], "Only the listed IDs are kept");
+
+    ASSERT_EQ(format_parse_fields("thresholds", &fields), 0, "thresholds parses");
+    ASSERT_TRUE(fields.values && fields.thresholds, "thresholds implies values");
+
+    ASSERT_EQ(format_parse_fields("identity,bogus", &fields), -1, "Unknown name is rejected");
+    ASSERT_EQ(format_parse_fields("256", &fields), -1, "Out-of-range ID is rejected");
+    ASSERT_EQ(format_parse_fields(",", &fields), -1, "Empty list is rejected");
+}
+
+/* Test: --fields projection of the JSON document */
+void test_fields_projection(void) {
+    TEST_CASE("Projected JSON emits only the requested fields");
+
+    disk_smart_data_t disks[5] = {0};
+    disks[0].is_present = 1;
+    strncpy(disks[0].disk_name, "WDC WD40EFRX", sizeof(disks[0].disk_name) - 1);
+    strncpy(disks[0].serial_number, "WD-SERIAL0", sizeof(disks[0].serial_number) - 1);
+    disks[0].num_attributes = 2;
+    disks[0].attributes[0].id = 0x05;
+    disks[0].attributes[0].name = "Reallocated_Sector_Ct";
+    disks[0].attributes[1].id = 0xC2;
+    disks[0].attributes[1].name = "Temperature_Celsius";
+    disks[0].attributes[1].raw_value = 38;
+
+    output_fields_t fields;
+    format_parse_fields("identity", &fields);
+    format_set_fields(&fields);
+    setup_output_capture();
+    format_json_line("/dev/sdX", disks, 1, 0, 0, 0, NULL, NULL);
+    teardown_output_capture();
+
+    ASSERT_TRUE(is_valid_json(get_captured_output()), "Identity-only JSON should be valid");
+    ASSERT_TRUE(strstr(get_captured_output(), "{\"disk_number\":0,\"model\":\"WDC WD40EFRX\",\"serial\":\"WD-SERIAL0\"}") != NULL,
+                "Identity-only disk has model and serial only");
+    ASSERT_FALSE(json_contains_key(get_captured_output(), "attributes"), "No attributes without values");
+
+    format_parse_fields("194", &fields);
+    setup_output_capture();
+    format_json_line("/dev/sdX", disks, 1, 0, 0, 0, NULL, NULL);
+    teardown_output_capture();
+    format_set_fields(NULL);
+
+    const char* output = get_captured_output();
+    ASSERT_TRUE(is_valid_json(output), "Attribute-filtered JSON should be valid");
+    ASSERT_TRUE(strstr(output, "\"id\":194") != NULL, "Requested attribute is present");
+    ASSERT_TRUE(strstr(output, "\"id\":5,") == NULL, "Other attributes are dropped");
+    ASSERT_FALSE(json_contains_key(output, "thresh"), "No thresh without thresholds");
+    ASSERT_FALSE(json_contains_key(output, "serial"), "No serial without identity");
+    ASSERT_TRUE(json_contains_key(output, "temperature_celsius"), "Values fields are present");
+}
+
 int main(void) {
     TEST_SUITE("Output Formatter Tests");
 
@@ -262,6 +497,14 @@ int main(void) {
     test_json_failed_disk();
     test_json_healthy_no_issues();
     test_json_no_extraneous_output();
+    test_json_line_single_line();
+    test_json_timings();
+    test_json_command_retries();
+    test_binary_record();
+    test_flags_status();
+    test_flags_json();
+    test_fields_parse();
+    test_fields_projection();
 
     TEST_SUMMARY();
 }
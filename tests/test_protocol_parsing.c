@@ -5,6 +5,7 @@
  * - RAID flag detection (degraded, healthy, rebuilding states)
  * - IDENTIFY response parsing
  * - State detection logic
+ * - Bitmask-guided slot probing plan
  */
 
 #include <stdio.h>
@@ -12,6 +13,7 @@
 #include <stdint.h>
 #include <string.h>
 #include "test_framework.h"
+#include "../src/jm_commands.h"
 
 // Test fixture loading
 static uint8_t* load_fixture(const char* path, size_t expected_size) {
@@ -136,6 +138,44 @@ void test_fixture_sizes(void) {
     }
 }
 
+// Test slot probing plan derived from the 0x1F0 presence bitmask
+void test_identify_slot_plan(void) {
+    TEST_CASE("Slot probing plan from 0x1F0 bitmask");
+
+    uint8_t* degraded = load_fixture("tests/fixtures/degraded/identify_disk0.bin", 512);
+    uint8_t* healthy = load_fixture("tests/fixtures/healthy/identify_disk0.bin", 512);
+    ASSERT_TRUE(degraded != NULL && healthy != NULL, "Fixtures should load successfully");
+    if (!degraded || !healthy) {
+        free(degraded);
+        free(healthy);
+        return;
+    }
+
+    ASSERT_EQ(jm_plan_identify_slots(0, degraded[0x1F0]), 0x06,
+              "Degraded 3-disk array (0x07) probes only slots 1-2");
+    ASSERT_EQ(jm_plan_identify_slots(0, healthy[0x1F0]), 0x0E,
+              "Healthy 4-disk array (0x0F) probes slots 1-3, skips slot 4");
+    ASSERT_EQ(jm_plan_identify_slots(0, 0x01), 0x00,
+              "Single-disk array needs no further IDENTIFY");
+    ASSERT_EQ(jm_plan_identify_slots(-2, 0x0A), 0x0A,
+              "Empty slot 0 with bit 0 clear probes only marked slots");
+
+    /* Inconsistent bitmasks fall back to the full sweep */
+    ASSERT_EQ(jm_plan_identify_slots(-1, 0x07), 0x1E,
+              "Communication error on slot 0 sweeps all slots");
+    ASSERT_EQ(jm_plan_identify_slots(0, 0x00), 0x1E,
+              "Zero bitmask sweeps all slots");
+    ASSERT_EQ(jm_plan_identify_slots(0, 0x27), 0x1E,
+              "Bits above slot 4 sweep all slots");
+    ASSERT_EQ(jm_plan_identify_slots(-2, 0x07), 0x1E,
+              "Bit 0 set but slot 0 empty sweeps all slots");
+    ASSERT_EQ(jm_plan_identify_slots(0, 0x06), 0x1E,
+              "Bit 0 clear but disk found on slot 0 sweeps all slots");
+
+    free(degraded);
+    free(healthy);
+}
+
 int main(void) {
     TEST_SUITE("Protocol Parsing with Real Fixtures");
 
@@ -146,6 +186,7 @@ int main(void) {
     test_healthy_flags();
     test_rebuilding_flags();
     test_state_differences();
+    test_identify_slot_plan();
 
     TEST_SUMMARY();
 }
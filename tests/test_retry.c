@@ -0,0 +1,221 @@
+/**
+ * test_retry.c - Tests for command retry and the adaptive SG_IO timeout
+ *
+ * A fake controller transport serves the healthy IDENTIFY fixture and can
+ * be told to corrupt or time out a number of responses first, so retries,
+ * counters and timeout backoff can be checked without a device.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "test_framework.h"
+#include "../src/jm_protocol.h"
+#include "../src/jm_commands.h"
+#include "../src/jm_crc.h"
+
+#define FIXTURE_PATH "tests/fixtures/healthy/identify_disk0.bin"
+
+static uint32_t identify_response[128];
+
+/* Fake controller: the first bad_reads reads fail in the configured way */
+typedef struct {
+    jm_transport_t base;
+    int bad_reads;
+    int timeout;                        /* Fail by timing out instead of a bad CRC */
+    int reads;
+} flaky_controller_t;
+
+static int flaky_transfer(jm_transport_t* transport, jm_session_t* session,
+                          jm_xfer_dir_t dir, void* buf) {
+    flaky_controller_t* fake = (flaky_controller_t*)transport;
+    (void)session;
+
+    if (dir == JM_XFER_TO_DEV) {
+        return 0;
+    }
+
+    fake->reads++;
+    if (fake->bad_reads > 0 && fake->timeout) {
+        fake->bad_reads--;
+        return JM_XFER_TIMED_OUT;
+    }
+
+    memcpy(buf, identify_response, sizeof(identify_response));
+    JM_CRC_THEN_XOR(buf);
+    if (fake->bad_reads > 0) {
+        fake->bad_reads--;
+        ((uint8_t*)buf)[0x20] ^= 0x01;  /* Flip one bit so the CRC no longer matches */
+    }
+    return 0;
+}
+
+static void flaky_close(jm_transport_t* transport) {
+    (void)transport;
+}
+
+static void open_session(jm_session_t* session, flaky_controller_t* fake, int bad_reads, int timeout) {
+    memset(fake, 0, sizeof(*fake));
+    fake->base.transfer = flaky_transfer;
+    fake->base.close = flaky_close;
+    fake->bad_reads = bad_reads;
+    fake->timeout = timeout;
+
+    jm_session_init(session, 33);
+    session->transport = &fake->base;
+}
+
+void test_crc_mismatch_retried(void) {
+    TEST_CASE("A CRC mismatch is retried with a fresh command counter");
+
+    jm_session_t session;
+    flaky_controller_t fake;
+    open_session(&session, &fake, 1, 0);
+
+    char model[41], serial[21], firmware[9];
+    int ret = jm_get_disk_identify(&session, 0, model, serial, firmware, NULL, NULL);
+
+    ASSERT_EQ(ret, 0, "IDENTIFY succeeds on the second attempt");
+    ASSERT_EQ(fake.reads, 2, "Command was issued twice");
+    ASSERT_EQ(session.retries, 1, "One retry is counted");
+    ASSERT_EQ(session.cmd_counter, 3, "Each attempt used its own counter");
+    jm_cleanup_device(&session);
+}
+
+void test_retries_exhausted(void) {
+    TEST_CASE("A command fails once every attempt has failed");
+
+    jm_session_t session;
+    flaky_controller_t fake;
+    open_session(&session, &fake, 100, 0);
+    session.max_retries = 2;
+
+    char model[41];
+    int ret = jm_get_disk_identify(&session, 0, model, NULL, NULL, NULL, NULL);
+
+    ASSERT_EQ(ret, -1, "IDENTIFY fails after all attempts");
+    ASSERT_EQ(fake.reads, 3, "1 attempt + 2 retries");
+    ASSERT_EQ(session.retries, 2, "Both retries are counted");
+    jm_cleanup_device(&session);
+}
+
+void test_no_retries(void) {
+    TEST_CASE("--retries 0 keeps the single-attempt behavior");
+
+    jm_session_t session;
+    flaky_controller_t fake;
+    open_session(&session, &fake, 1, 0);
+    session.max_retries = 0;
+
+    char model[41];
+    ASSERT_EQ(jm_get_disk_identify(&session, 0, model, NULL, NULL, NULL, NULL), -1,
+              "First CRC mismatch fails the command");
+    ASSERT_EQ(fake.reads, 1, "Command was issued once");
+    ASSERT_EQ(session.retries, 0, "No retries counted");
+    jm_cleanup_device(&session);
+}
+
+void test_timeout_backoff(void) {
+    TEST_CASE("Timeouts are reported, retried and back off the SG_IO timeout");
+
+    jm_session_t session;
+    flaky_controller_t fake;
+    open_session(&session, &fake, 1, 1);
+
+    ASSERT_EQ(jm_send_wakeup(&session), JM_SUCCESS, "Wakeup succeeds");
+    ASSERT_EQ(session.timeout_ms, JM_TIMEOUT_MIN_MS, "Fast transfers tighten the timeout to the minimum");
+
+    uint32_t cmd[128], resp[128];
+    memset(cmd, 0, sizeof(cmd));
+    cmd[0] = 0x197b0322;
+    cmd[1] = session.cmd_counter++;
+    cmd[2] = 0x00021f00;
+    ASSERT_EQ(jm_execute_command(&session, cmd, resp), JM_ERROR_TIMEOUT, "Timed-out read is JM_ERROR_TIMEOUT");
+    ASSERT_EQ(session.timeout_ms, 2 * JM_TIMEOUT_MIN_MS, "Timeout doubles after a timeout");
+    ASSERT_TRUE(jm_is_retryable(JM_ERROR_TIMEOUT), "Timeouts are retryable");
+    ASSERT_TRUE(!jm_is_retryable(JM_ERROR_IOCTL_FAILED), "Hard ioctl failures are not");
+
+    char model[41];
+    ASSERT_EQ(jm_get_disk_identify(&session, 0, model, NULL, NULL, NULL, NULL), 0,
+              "Next command completes");
+    ASSERT_EQ(session.timeout_ms, JM_TIMEOUT_MIN_MS, "A completed transfer restores the adaptive timeout");
+
+    ASSERT_EQ(jm_cleanup_device(&session), JM_SUCCESS, "Cleanup succeeds");
+}
+
+void test_per_disk_retry_count(void) {
+    TEST_CASE("Retries are attributed to the disk that needed them");
+
+    jm_session_t session;
+    flaky_controller_t fake;
+    open_session(&session, &fake, 1, 0);
+
+    disk_smart_data_t data[5];
+    int num_disks = 0;
+    jm_get_all_disks_smart_data(&session, data, &num_disks, NULL, NULL);
+
+    ASSERT_TRUE(data[0].is_present, "Disk 0 is found");
+    ASSERT_EQ(data[0].command_retries, 1, "Disk 0 reports the IDENTIFY retry");
+    jm_cleanup_device(&session);
+}
+
+void test_raid_flags(void) {
+    TEST_CASE("RAID flags come from one IDENTIFY round trip");
+
+    jm_session_t session;
+    flaky_controller_t fake;
+    open_session(&session, &fake, 1, 0);
+
+    jm_raid_flags_t flags;
+    ASSERT_EQ(jm_get_raid_flags(&session, &flags), 0, "Flags read after a retry");
+    ASSERT_EQ(fake.reads, 2, "Only the IDENTIFY (and its retry) was issued");
+    ASSERT_EQ(flags.presence, 0x0f, "Presence bitmask from 0x1F0");
+    ASSERT_EQ(flags.rebuild, 0x00, "Not rebuilding (0x1F5)");
+    ASSERT_EQ(flags.raw[9], 0x80, "Raw bytes start at 0x1F0");
+    jm_cleanup_device(&session);
+}
+
+void test_identity_only_reads(void) {
+    TEST_CASE("An identity-only poll issues no SMART commands");
+
+    jm_session_t session;
+    flaky_controller_t fake;
+    open_session(&session, &fake, 0, 0);
+    session.reads = 0;
+
+    disk_smart_data_t data[5];
+    int num_disks = 0;
+    jm_get_all_disks_smart_data(&session, data, &num_disks, NULL, NULL);
+    int identify_reads = fake.reads;
+
+    ASSERT_EQ(num_disks, 4, "Every slot of the presence bitmask is identified");
+    ASSERT_EQ(identify_reads, 4, "One IDENTIFY per disk and nothing else");
+    ASSERT_TRUE(data[0].disk_name[0] != '\0', "Model comes from IDENTIFY");
+
+    open_session(&session, &fake, 0, 0);
+    session.reads = JM_READ_VALUES;
+    jm_get_all_disks_smart_data(&session, data, &num_disks, NULL, NULL);
+    ASSERT_EQ(fake.reads, identify_reads * 2, "Values add one READ VALUES per disk, no thresholds");
+    jm_cleanup_device(&session);
+}
+
+int main(void) {
+    TEST_SUITE("Command Retry and Adaptive Timeout");
+
+    FILE* f = fopen(FIXTURE_PATH, "rb");
+    if (f == NULL || fread(identify_response, 1, 512, f) != 512) {
+        fprintf(stderr, "Cannot read %s (run from the repository root)\n", FIXTURE_PATH);
+        return 1;
+    }
+    fclose(f);
+
+    test_crc_mismatch_retried();
+    test_retries_exhausted();
+    test_no_retries();
+    test_timeout_backoff();
+    test_per_disk_retry_count();
+    test_raid_flags();
+    test_identity_only_reads();
+
+    TEST_SUMMARY();
+}
@@ -0,0 +1,85 @@
+/**
+ * test_sampler.c - Tests for the --sample temperature ring buffer
+ *
+ * Checks the summary statistics, eviction once the ring is full, and
+ * temperature extraction from a SMART values page.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "test_framework.h"
+#include "../src/jm_sampler.h"
+
+static jm_sample_ring_t ring;
+
+void test_sample_stats(void) {
+    TEST_CASE("Stats cover min, max, mean and p99");
+
+    jm_sample_stats_t stats;
+    jm_sample_ring_reset(&ring);
+    ASSERT_EQ(jm_sample_ring_stats(&ring, &stats), -1, "Empty ring has no stats");
+
+    /* 99 readings of 30 and one of 50: p99 (rank 99 of 100) is still 30 */
+    for (int i = 0; i < 99; i++) {
+        jm_sample_ring_add(&ring, 30);
+    }
+    jm_sample_ring_add(&ring, 50);
+
+    ASSERT_EQ(jm_sample_ring_stats(&ring, &stats), 0, "Stats of a non-empty ring");
+    ASSERT_EQ(stats.count, 100, "All readings counted");
+    ASSERT_EQ(stats.min, 30, "Minimum");
+    ASSERT_EQ(stats.max, 50, "Maximum");
+    ASSERT_TRUE(stats.mean > 30.19 && stats.mean < 30.21, "Mean");
+    ASSERT_EQ(stats.p99, 30, "p99 by nearest rank");
+
+    jm_sample_ring_add(&ring, 50);
+    jm_sample_ring_stats(&ring, &stats);
+    ASSERT_EQ(stats.p99, 50, "Two hot readings of 101 reach p99");
+}
+
+void test_sample_eviction(void) {
+    TEST_CASE("Full ring evicts its oldest readings");
+
+    jm_sample_stats_t stats;
+    jm_sample_ring_reset(&ring);
+    jm_sample_ring_add(&ring, 70);
+    for (int i = 0; i < JM_SAMPLE_CAPACITY; i++) {
+        jm_sample_ring_add(&ring, 40);
+    }
+
+    jm_sample_ring_stats(&ring, &stats);
+    ASSERT_EQ(stats.count, JM_SAMPLE_CAPACITY, "Count is capped at capacity");
+    ASSERT_EQ(stats.max, 40, "Evicted reading no longer counts");
+    ASSERT_TRUE(stats.mean > 39.99 && stats.mean < 40.01, "Mean over held readings only");
+}
+
+void test_sample_temperature(void) {
+    TEST_CASE("Temperature comes from the first temperature attribute");
+
+    smart_values_page_t values;
+    memset(&values, 0, sizeof(values));
+    ASSERT_EQ(jm_sample_temperature(&values), -1, "No temperature attribute");
+
+    values.attributes[0].id = 0x05;
+    values.attributes[0].raw_value[0] = 12;
+    values.attributes[3].id = 0xC2;
+    values.attributes[3].raw_value[0] = 41;
+    values.attributes[3].raw_value[2] = 55;     /* Min/max history in the upper bytes */
+    values.attributes[4].id = 0xBE;
+    values.attributes[4].raw_value[0] = 39;
+    ASSERT_EQ(jm_sample_temperature(&values), 41, "Low raw byte of 0xC2");
+
+    values.attributes[3].id = 0x09;
+    ASSERT_EQ(jm_sample_temperature(&values), 39, "0xBE when there is no 0xC2 before it");
+}
+
+int main(void) {
+    TEST_SUITE("Temperature Sampler");
+
+    test_sample_stats();
+    test_sample_eviction();
+    test_sample_temperature();
+
+    TEST_SUMMARY();
+}
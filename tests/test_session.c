@@ -0,0 +1,143 @@
+/**
+ * test_session.c - Tests for the per-controller jm_session_t API
+ *
+ * Sessions must not share state, so these tests check that two sessions
+ * start out independent and that the lifecycle calls are safe on sessions
+ * that were never opened (no SG device is needed).
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <signal.h>
+#include "test_framework.h"
+#include "../src/jm_protocol.h"
+
+void test_session_init_defaults(void) {
+    TEST_CASE("jm_session_init sets closed-session defaults");
+
+    jm_session_t session;
+    memset(&session, 0xAA, sizeof(session));
+    jm_session_init(&session, 33);
+
+    ASSERT_EQ(session.fd, -1, "fd should be -1 (closed)");
+    ASSERT_EQ(session.sector, 33, "sector should be stored");
+    ASSERT_EQ(session.cmd_counter, 1, "command counter should start at 1");
+    ASSERT_EQ(session.cleanup_slot, -1, "session should not be registered for cleanup");
+    ASSERT_EQ(session.verbose, 0, "verbose should default to off");
+    ASSERT_EQ(session.expected_array_size, 0, "expected array size should default to 0");
+    ASSERT_EQ(session.max_retries, JM_DEFAULT_RETRIES, "retries should default to JM_DEFAULT_RETRIES");
+    ASSERT_EQ(session.timeout_ms, JM_TIMEOUT_MAX_MS, "timeout should start at the maximum");
+    ASSERT_EQ(session.srtt_us, 0, "no round-trip sample yet");
+}
+
+void test_sessions_are_independent(void) {
+    TEST_CASE("Two sessions keep separate sector and counter state");
+
+    jm_session_t a, b;
+    jm_session_init(&a, 33);
+    jm_session_init(&b, 100);
+
+    a.cmd_counter += 5;
+
+    ASSERT_EQ(a.cmd_counter, 6, "session A counter advanced");
+    ASSERT_EQ(b.cmd_counter, 1, "session B counter unaffected");
+    ASSERT_EQ(b.sector, 100, "session B keeps its own sector");
+}
+
+void test_closed_session_lifecycle(void) {
+    TEST_CASE("Lifecycle calls are safe on a session that was never opened");
+
+    jm_session_t session;
+    jm_session_init(&session, 33);
+
+    ASSERT_EQ(jm_cleanup_device(&session), JM_SUCCESS, "cleanup of closed session succeeds");
+    ASSERT_EQ(jm_cleanup_device(&session), JM_SUCCESS, "cleanup is idempotent");
+    ASSERT_EQ(jm_setup_signal_handlers(&session), -1, "cannot register a closed session");
+    ASSERT_EQ(jm_send_wakeup(&session), JM_ERROR_INVALID_ARGS, "wakeup rejects closed session");
+    ASSERT_EQ(jm_zero_sector(&session), JM_ERROR_INVALID_ARGS, "zero sector rejects closed session");
+
+    jm_remove_signal_handlers(&session);  /* must be a no-op */
+    ASSERT_EQ(session.cleanup_slot, -1, "unregistering an unregistered session is a no-op");
+}
+
+void test_init_device_errors(void) {
+    TEST_CASE("jm_init_device reports errors without touching the session fd");
+
+    jm_session_t session;
+    jm_session_init(&session, 33);
+
+    ASSERT_EQ(jm_init_device(&session, "/nonexistent/sg-device"), JM_ERROR_DEVICE_OPEN,
+              "missing device returns JM_ERROR_DEVICE_OPEN");
+    ASSERT_EQ(session.fd, -1, "fd stays -1 after failed open");
+    ASSERT_EQ(jm_init_device(&session, "/dev/null"), JM_ERROR_NOT_SG_DEVICE,
+              "non-SG device returns JM_ERROR_NOT_SG_DEVICE");
+    ASSERT_EQ(session.fd, -1, "fd stays -1 after rejected device");
+    ASSERT_EQ(jm_init_device(NULL, "/dev/null"), JM_ERROR_INVALID_ARGS,
+              "NULL session returns JM_ERROR_INVALID_ARGS");
+}
+
+#define CHURN_THREADS 8
+#define CHURN_ROUNDS 2000
+
+static int churn_failures;
+
+/* Helper: Register and unregister a session over and over */
+static void* churn_registry(void* arg) {
+    jm_session_t session;
+    jm_session_init(&session, 33 + (int)(intptr_t)arg);
+    session.fd = 100 + (int)(intptr_t)arg;  /* Never written: no signal is raised */
+
+    for (int i = 0; i < CHURN_ROUNDS; i++) {
+        if (jm_setup_signal_handlers(&session) != 0) {
+            __atomic_add_fetch(&churn_failures, 1, __ATOMIC_RELAXED);
+        }
+        jm_remove_signal_handlers(&session);
+    }
+    return NULL;
+}
+
+/* Helper: Whether SIGINT currently has the default disposition */
+static int sigint_is_default(void) {
+    struct sigaction sa;
+    sigaction(SIGINT, NULL, &sa);
+    return sa.sa_handler == SIG_DFL;
+}
+
+void test_cleanup_registry_threads(void) {
+    TEST_CASE("Concurrent registration keeps every live session protected");
+
+    jm_session_t keeper;
+    jm_session_init(&keeper, 33);
+    keeper.fd = 99;
+
+    ASSERT_EQ(jm_setup_signal_handlers(&keeper), 0, "long-lived session registers");
+    ASSERT_FALSE(sigint_is_default(), "handlers installed");
+
+    pthread_t threads[CHURN_THREADS];
+    for (intptr_t i = 0; i < CHURN_THREADS; i++) {
+        pthread_create(&threads[i], NULL, churn_registry, (void*)i);
+    }
+    for (int i = 0; i < CHURN_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    ASSERT_EQ(churn_failures, 0, "every registration found a slot");
+    ASSERT_FALSE(sigint_is_default(), "handlers still installed for the live session");
+
+    jm_remove_signal_handlers(&keeper);
+    ASSERT_TRUE(sigint_is_default(), "default restored after the last session");
+}
+
+int main(void) {
+    TEST_SUITE("Controller Session API");
+
+    test_session_init_defaults();
+    test_sessions_are_independent();
+    test_closed_session_lifecycle();
+    test_init_device_errors();
+    test_cleanup_registry_threads();
+
+    TEST_SUMMARY();
+}
@@ -0,0 +1,292 @@
+/**
+ * test_sim.c - Tests for the simulated controller transport
+ *
+ * Sessions run the real command path (jm_commands.c) against the
+ * simulator, loaded from the jmraidstatus JSON fixtures.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "test_framework.h"
+#include "../src/jm_protocol.h"
+#include "../src/jm_commands.h"
+#include "../src/jm_sim.h"
+
+#define HEALTHY_PATH "tests/data/jmicron/healthy-4disk.json"
+#define DEGRADED_PATH "tests/data/jmicron/degraded-3disk.json"
+#define FAILED_PATH "tests/data/jmicron/failed-disk.json"
+
+static disk_smart_data_t disks[5];
+
+static void open_sim(jm_session_t* session, const jm_sim_array_t* array, const jm_sim_profile_t* profile) {
+    jm_session_init(session, 33);
+    session->transport = jm_sim_open(array, profile);
+}
+
+/* Helper: Attribute by ID, or NULL */
+static const parsed_smart_attribute_t* find_attr(const disk_smart_data_t* disk, uint8_t id) {
+    for (int i = 0; i < disk->num_attributes; i++) {
+        if (disk->attributes[i].id == id) return &disk->attributes[i];
+    }
+    return NULL;
+}
+
+void test_load_fixture(void) {
+    TEST_CASE("Fixture JSON loads into slots");
+
+    jm_sim_array_t array;
+    ASSERT_EQ(jm_sim_load(HEALTHY_PATH, &array), 0, "Healthy fixture loads");
+    ASSERT_EQ(array.presence, 0x0F, "Four disks present");
+    ASSERT_TRUE(strcmp(array.disks[0].serial_number, "WD-WCC7K0001") == 0, "Serial of slot 0");
+    ASSERT_TRUE(strcmp(array.controller_model, "JMB567") == 0, "Controller model");
+
+    ASSERT_EQ(jm_sim_load(DEGRADED_PATH, &array), 0, "Degraded fixture loads");
+    ASSERT_EQ(array.presence, 0x07, "Three disks present");
+    ASSERT_EQ(jm_sim_load("tests/data/jmicron/missing.json", &array), -1, "Missing file fails");
+}
+
+void test_full_poll(void) {
+    TEST_CASE("A full poll of the simulator reproduces the fixture");
+
+    jm_sim_array_t array;
+    jm_session_t session;
+    int num_disks = 0, is_degraded = 0, present = 0;
+
+    jm_sim_load(HEALTHY_PATH, &array);
+    open_sim(&session, &array, NULL);
+    session.expected_array_size = 4;
+    ASSERT_EQ(jm_send_wakeup(&session), JM_SUCCESS, "Wakeup succeeds");
+    ASSERT_EQ(jm_get_all_disks_smart_data(&session, disks, &num_disks, &is_degraded, &present), 0,
+              "Poll succeeds");
+    ASSERT_EQ(num_disks, 4, "Four disks answer IDENTIFY");
+    ASSERT_EQ(present, 4, "Four disks in the presence bitmask");
+    ASSERT_EQ(is_degraded, 0, "Not degraded");
+    ASSERT_TRUE(!disks[4].is_present, "Slot 4 is empty");
+    ASSERT_TRUE(strcmp(disks[0].disk_name, "WDC WD40EFRX-68N32N0") == 0, "Model round-trips");
+    ASSERT_TRUE(strcmp(disks[2].firmware_rev, "SC60") == 0, "Firmware round-trips");
+    ASSERT_EQ(disks[0].size_mb, 3815447, "Size round-trips");
+
+    const parsed_smart_attribute_t* hours = find_attr(&disks[1], 9);
+    ASSERT_TRUE(hours != NULL && hours->raw_value == 12451, "Raw value round-trips");
+    const parsed_smart_attribute_t* realloc = find_attr(&disks[0], 5);
+    ASSERT_TRUE(realloc != NULL && realloc->threshold == 10, "Threshold comes from the 0xD1 page");
+    ASSERT_EQ(disks[0].overall_status, DISK_STATUS_PASSED, "Healthy disk passes");
+    jm_cleanup_device(&session);
+
+    jm_sim_load(DEGRADED_PATH, &array);
+    open_sim(&session, &array, NULL);
+    session.expected_array_size = 4;
+    jm_send_wakeup(&session);
+    jm_get_all_disks_smart_data(&session, disks, &num_disks, &is_degraded, &present);
+    ASSERT_EQ(present, 3, "Degraded fixture reports three disks");
+    ASSERT_EQ(is_degraded, 1, "Degraded against an array size of 4");
+    jm_cleanup_device(&session);
+
+    jm_sim_load(FAILED_PATH, &array);
+    open_sim(&session, &array, NULL);
+    jm_send_wakeup(&session);
+    jm_get_all_disks_smart_data(&session, disks, &num_disks, &is_degraded, &present);
+    ASSERT_EQ(disks[2].overall_status, DISK_STATUS_FAILED, "Failing values are re-assessed as failed");
+    jm_cleanup_device(&session);
+}
+
+void test_wakeup_required(void) {
+    TEST_CASE("The simulator answers only after the wakeup, and sleeps after a zero write");
+
+    jm_sim_array_t array;
+    jm_session_t session;
+    jm_sim_stats_t stats;
+    char model[41];
+
+    jm_sim_load(HEALTHY_PATH, &array);
+    open_sim(&session, &array, NULL);
+
+    ASSERT_EQ(jm_get_disk_identify(&session, 0, model, NULL, NULL, NULL, NULL), -2,
+              "Asleep: the sector only echoes the command");
+    jm_send_wakeup(&session);
+    ASSERT_EQ(jm_get_disk_identify(&session, 0, model, NULL, NULL, NULL, NULL), 0, "Awake: IDENTIFY answers");
+
+    jm_zero_sector(&session);
+    ASSERT_EQ(jm_get_disk_identify(&session, 0, model, NULL, NULL, NULL, NULL), -2,
+              "Zero sector write puts it back to sleep");
+
+    jm_sim_get_stats(session.transport, &stats);
+    ASSERT_EQ(stats.wakeups, 1, "One wakeup counted");
+    ASSERT_EQ(stats.commands, 1, "One command answered");
+    ASSERT_EQ(stats.ignored, 2, "Two commands ignored");
+    jm_cleanup_device(&session);
+}
+
+void test_counter_echo(void) {
+    TEST_CASE("Responses echo the command header and counter");
+
+    jm_sim_array_t array;
+    jm_session_t session;
+    uint32_t cmd[128], resp[128];
+
+    jm_sim_load(HEALTHY_PATH, &array);
+    open_sim(&session, &array, NULL);
+    jm_send_wakeup(&session);
+
+    memset(cmd, 0, sizeof(cmd));
+    cmd[0] = 0x197b0322;
+    cmd[1] = 0x1234;
+    cmd[2] = 0x00ff0200;  /* 00 02 00 ff: an unknown command kind */
+    ASSERT_EQ(jm_execute_command(&session, cmd, resp), JM_SUCCESS, "Command completes");
+    ASSERT_EQ(resp[0], 0x197b0322, "Header echoed");
+    ASSERT_EQ(resp[1], 0x1234, "Counter echoed");
+    jm_cleanup_device(&session);
+}
+
+void test_warm_probe(void) {
+    TEST_CASE("The warm probe skips the wakeup only while the controller is awake");
+
+    jm_sim_array_t array;
+    jm_session_t session;
+    jm_sim_stats_t stats;
+
+    jm_sim_load(HEALTHY_PATH, &array);
+    open_sim(&session, &array, NULL);
+    session.warm_probe = 1;
+
+    ASSERT_EQ(jm_probe_awake(&session), 0, "Asleep: the probe reads back its own command");
+    ASSERT_EQ(jm_wake(&session), JM_SUCCESS, "Wake falls back to the wakeup sequence");
+    ASSERT_EQ(jm_probe_awake(&session), 1, "Awake: the probe is answered");
+    ASSERT_EQ(jm_wake(&session), JM_SUCCESS, "Wake on a warm controller");
+
+    jm_sim_get_stats(session.transport, &stats);
+    ASSERT_EQ(stats.wakeups, 1, "Warm wake sent no wakeup sequence");
+
+    jm_zero_sector(&session);
+    jm_wake(&session);
+    jm_sim_get_stats(session.transport, &stats);
+    ASSERT_EQ(stats.wakeups, 2, "After a zero write the wakeup is sent again");
+
+    session.warm_probe = 0;
+    jm_wake(&session);
+    jm_sim_get_stats(session.transport, &stats);
+    ASSERT_EQ(stats.wakeups, 3, "Without warm_probe every wake sends the sequence");
+    jm_cleanup_device(&session);
+}
+
+void test_fault_injection(void) {
+    TEST_CASE("Injected CRC errors and timeouts are retried");
+
+    jm_sim_array_t array;
+    jm_session_t session;
+    jm_sim_stats_t stats;
+    jm_sim_profile_t profile;
+    int num_disks = 0, is_degraded = 0, present = 0;
+
+    memset(&profile, 0, sizeof(profile));
+    profile.crc_error_ppm = 200000;
+    profile.timeout_ppm = 100000;
+    profile.seed = 7;
+
+    jm_sim_load(HEALTHY_PATH, &array);
+    open_sim(&session, &array, &profile);
+    session.max_retries = 10;
+    jm_send_wakeup(&session);
+    ASSERT_EQ(jm_get_all_disks_smart_data(&session, disks, &num_disks, &is_degraded, &present), 0,
+              "Poll succeeds despite faults");
+    ASSERT_EQ(num_disks, 4, "Every disk found");
+
+    jm_sim_get_stats(session.transport, &stats);
+    ASSERT_TRUE(stats.crc_errors > 0 && stats.timeouts > 0, "Both fault kinds were injected");
+    ASSERT_EQ(session.retries, stats.crc_errors + stats.timeouts, "Every fault cost one retry");
+    jm_cleanup_device(&session);
+}
+
+/* Helper: Poll once and count the commands it took */
+static uint64_t poll_commands(jm_session_t* session) {
+    jm_sim_stats_t before, after;
+    int num_disks = 0, is_degraded = 0, present = 0;
+
+    jm_sim_get_stats(session->transport, &before);
+    jm_get_all_disks_smart_data(session, disks, &num_disks, &is_degraded, &present);
+    jm_sim_get_stats(session->transport, &after);
+    return after.commands - before.commands;
+}
+
+void test_cache_slot_swap(void) {
+    TEST_CASE("The cache skips 0xD1 only for slots that hold the same drive");
+
+    jm_sim_array_t array;
+    jm_session_t session;
+    char cache_dir[] = "/tmp/jm_sim_cache.XXXXXX";
+    char path[128];
+
+    ASSERT_TRUE(mkdtemp(cache_dir) != NULL, "Cache directory created");
+    jm_sim_load(HEALTHY_PATH, &array);
+    open_sim(&session, &array, NULL);
+    session.cache_dir = cache_dir;
+    jm_send_wakeup(&session);
+
+    ASSERT_EQ(poll_commands(&session), 12, "Cold: IDENTIFY, 0xD0 and 0xD1 for four disks");
+    ASSERT_EQ(poll_commands(&session), 8, "Warm: IDENTIFY and 0xD0 only");
+    jm_cleanup_device(&session);
+
+    /* Replace the disk in slot 2 with one of another kind: same bitmask */
+    disk_smart_data_t* slot2 = &array.disks[2];
+    snprintf(slot2->serial_number, sizeof(slot2->serial_number), "REPLACED");
+    for (int i = 0; i < slot2->num_attributes; i++) {
+        slot2->attributes[i].threshold = 99;
+    }
+    open_sim(&session, &array, NULL);
+    session.cache_dir = cache_dir;
+    jm_send_wakeup(&session);
+
+    ASSERT_EQ(poll_commands(&session), 9, "Swapped slot 2 misses and reads 0xD1");
+    ASSERT_TRUE(strcmp(disks[2].serial_number, "REPLACED") == 0, "New disk's serial reported");
+    ASSERT_EQ(disks[2].num_attributes > 0 ? disks[2].attributes[0].threshold : 0, 99,
+              "New disk judged by its own thresholds");
+    ASSERT_EQ(disks[1].attributes[0].threshold == 99, 0, "Other slots keep theirs");
+    ASSERT_EQ(poll_commands(&session), 8, "Entry updated: warm again");
+    jm_cleanup_device(&session);
+
+    snprintf(path, sizeof(path), "%s/%s.cache", cache_dir, array.disks[0].serial_number);
+    unlink(path);
+    rmdir(cache_dir);
+}
+
+void test_parse_spec(void) {
+    TEST_CASE("Simulation specs parse file, latency and rates");
+
+    char path[256];
+    jm_sim_profile_t profile;
+
+    ASSERT_EQ(jm_sim_parse_spec("a.json", path, sizeof(path), &profile), 0, "File only");
+    ASSERT_TRUE(strcmp(path, "a.json") == 0 && profile.latency_us == 0, "No latency by default");
+
+    ASSERT_EQ(jm_sim_parse_spec("b.json,latency=8.5,jitter=2,crc=0.01,timeouts=0.002,seed=42",
+                                path, sizeof(path), &profile), 0, "All keys");
+    ASSERT_TRUE(strcmp(path, "b.json") == 0, "Path before the first comma");
+    ASSERT_EQ(profile.latency_us, 8500, "Latency in ms");
+    ASSERT_EQ(profile.jitter_us, 2000, "Jitter in ms");
+    ASSERT_EQ(profile.crc_error_ppm, 10000, "CRC rate as ppm");
+    ASSERT_EQ(profile.timeout_ppm, 2000, "Timeout rate as ppm");
+    ASSERT_EQ(profile.seed, 42, "Seed");
+
+    ASSERT_EQ(jm_sim_parse_spec("c.json,speed=1", path, sizeof(path), &profile), -1, "Unknown key");
+    ASSERT_EQ(jm_sim_parse_spec("c.json,crc=2", path, sizeof(path), &profile), -1, "Rate above 1");
+    ASSERT_EQ(jm_sim_parse_spec("c.json,latency", path, sizeof(path), &profile), -1, "Missing value");
+    ASSERT_EQ(jm_sim_parse_spec(",latency=1", path, sizeof(path), &profile), -1, "Missing file");
+}
+
+int main(void) {
+    TEST_SUITE("Simulated Controller");
+
+    test_load_fixture();
+    test_full_poll();
+    test_wakeup_required();
+    test_counter_echo();
+    test_warm_probe();
+    test_fault_injection();
+    test_cache_slot_swap();
+    test_parse_spec();
+
+    TEST_SUMMARY();
+}
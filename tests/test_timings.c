@@ -0,0 +1,63 @@
+/*
+ * test_timings.c - Unit tests for latency statistics and histograms
+ *
+ * Copyright (C) 2026 Jamie Treworgy
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "test_framework.h"
+#include "../src/jm_timings.h"
+#include <stdint.h>
+#include <string.h>
+
+void test_latency_add(void) {
+    TEST_CASE("Latency statistic keeps count, total and maximum");
+
+    jm_latency_t latency;
+    memset(&latency, 0, sizeof(latency));
+    jm_latency_add(&latency, 300);
+    jm_latency_add(&latency, 1200);
+    jm_latency_add(&latency, 500);
+
+    ASSERT_EQ(latency.count, 3, "Three samples");
+    ASSERT_EQ(latency.total_us, 2000, "Total of the samples");
+    ASSERT_EQ(latency.max_us, 1200, "Largest sample");
+}
+
+void test_histogram_buckets(void) {
+    TEST_CASE("Histogram samples land in the bucket of their upper bound");
+
+    jm_histogram_t histogram;
+    memset(&histogram, 0, sizeof(histogram));
+    jm_histogram_add(&histogram, 0);
+    jm_histogram_add(&histogram, jm_histogram_bounds_us[0]);
+    jm_histogram_add(&histogram, jm_histogram_bounds_us[0] + 1);
+    jm_histogram_add(&histogram, jm_histogram_bounds_us[JM_HISTOGRAM_BUCKETS - 1] + 1);
+
+    ASSERT_EQ(histogram.buckets[0], 2, "A sample equal to the bound is in its bucket");
+    ASSERT_EQ(histogram.buckets[1], 1, "Just above the bound is in the next bucket");
+    ASSERT_EQ(histogram.buckets[JM_HISTOGRAM_BUCKETS], 1, "Above every bound is in the last bucket");
+    ASSERT_EQ(histogram.count, 4, "Every sample is counted");
+    ASSERT_EQ(histogram.total_us, 2 * jm_histogram_bounds_us[0] + 1 +
+              jm_histogram_bounds_us[JM_HISTOGRAM_BUCKETS - 1] + 1, "Total of the samples");
+}
+
+void test_histogram_bounds_increase(void) {
+    TEST_CASE("Histogram bounds are strictly increasing");
+
+    int increasing = 1;
+    for (int i = 1; i < JM_HISTOGRAM_BUCKETS; i++) {
+        if (jm_histogram_bounds_us[i] <= jm_histogram_bounds_us[i - 1]) increasing = 0;
+    }
+    ASSERT_TRUE(increasing, "Each bound is above the previous one");
+}
+
+int main(void) {
+    TEST_SUITE("Latency Timing Tests");
+
+    test_latency_add();
+    test_histogram_buckets();
+    test_histogram_bounds_increase();
+
+    TEST_SUMMARY();
+}
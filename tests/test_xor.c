@@ -86,12 +86,37 @@ void test_xor_pattern(void) {
     ASSERT_MEM_EQ(buffer, backup, sizeof(buffer), "Pattern survives scramble/unscramble");
 }
 
+void test_xor_matches_pattern(void) {
+    TEST_CASE("Accelerated XOR matches word-by-word pattern XOR");
+
+    uint32_t buffer[128];
+    uint32_t expected[128];
+
+    for (int i = 0; i < 128; i++) {
+        buffer[i] = 0x9e3779b9u * (uint32_t)(i + 1);
+        expected[i] = buffer[i] ^ sata_xor_pattern[i];
+    }
+    SATA_XOR(buffer);
+    ASSERT_MEM_EQ(buffer, expected, sizeof(buffer), "Every word XORed with its pattern word");
+
+    /* Misaligned buffer (offset by one word) exercises the unaligned loads */
+    uint32_t storage[129];
+    uint32_t* unaligned = storage + 1;
+    for (int i = 0; i < 128; i++) {
+        unaligned[i] = (uint32_t)i;
+        expected[i] = (uint32_t)i ^ sata_xor_pattern[i];
+    }
+    SATA_XOR(unaligned);
+    ASSERT_MEM_EQ(unaligned, expected, sizeof(expected), "Unaligned buffer XORed correctly");
+}
+
 int main(void) {
     TEST_SUITE("SATA XOR Scrambling Tests");
 
     test_xor_reversible();
     test_xor_zeros();
     test_xor_pattern();
+    test_xor_matches_pattern();
 
     TEST_SUMMARY();
 }
@@ -0,0 +1,62 @@
+/**
+ * gen_crc_table.c - Generate the slicing-by-8 CRC tables for jm_crc.c
+ *
+ * Writes src/jm_crc_table.h to stdout. The generated header is checked in,
+ * so a normal build never runs this; regenerate with `make crc-table`.
+ *
+ * Copyright (C) 2026 Jamie Treworgy
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define CRC32_POLY 0x04C11DB7
+
+int main(void) {
+    uint32_t tables[8][256];
+
+    /* Table 0: classic MSB-first byte table */
+    for (unsigned int i = 0; i < 256; i++) {
+        uint32_t crc = i << 24;
+        for (int j = 0; j < 8; j++) {
+            crc = (crc & 0x80000000) ? (crc << 1) ^ CRC32_POLY : (crc << 1);
+        }
+        tables[0][i] = crc;
+    }
+
+    /* Table k: table k-1 advanced by one more zero byte */
+    for (int k = 1; k < 8; k++) {
+        for (unsigned int i = 0; i < 256; i++) {
+            uint32_t prev = tables[k - 1][i];
+            tables[k][i] = (prev << 8) ^ tables[0][prev >> 24];
+        }
+    }
+
+    printf("/*\n");
+    printf(" * jm_crc_table.h - Precomputed CRC-32 tables for JMicron protocol\n");
+    printf(" *\n");
+    printf(" * GENERATED by tools/gen_crc_table.c (make crc-table) - do not edit.\n");
+    printf(" * Polynomial 0x%08X, MSB first, slicing-by-8.\n", CRC32_POLY);
+    printf(" *\n");
+    printf(" * Copyright (C) 2026 Jamie Treworgy\n");
+    printf(" * SPDX-License-Identifier: MIT\n");
+    printf(" */\n\n");
+    printf("#ifndef JM_CRC_TABLE_H\n");
+    printf("#define JM_CRC_TABLE_H\n\n");
+    printf("#include <stdint.h>\n\n");
+    printf("static const uint32_t crc_tables[8][256] = {\n");
+    for (int k = 0; k < 8; k++) {
+        printf("    {\n");
+        for (int i = 0; i < 256; i += 4) {
+            printf("        0x%08x, 0x%08x, 0x%08x, 0x%08x%s\n",
+                   tables[k][i], tables[k][i + 1], tables[k][i + 2], tables[k][i + 3],
+                   (i + 4 < 256) ? "," : "");
+        }
+        printf("    }%s\n", (k < 7) ? "," : "");
+    }
+    printf("};\n\n");
+    printf("#endif /* JM_CRC_TABLE_H */\n");
+
+    return 0;
+}
@@ -0,0 +1,283 @@
+"""
+ctypes binding for libjmraid (src/jmraid.h).
+
+Polls a JMicron enclosure in process on one persistent session, instead of
+running jmraidstatus per poll. Build the library with `make lib`; it is
+looked up as $JMRAID_LIB, then bin/libjmraid.so.1 of this checkout, then on
+the system library path. Opening the device needs the same privileges as
+jmraidstatus (root, or read/write access to the block device).
+
+    with jmraid.Session("/dev/sde") as session:
+        flags = session.poll_flags()
+        status = session.poll()
+"""
+
+import ctypes
+import ctypes.util
+import os
+from pathlib import Path
+
+ABI_VERSION = 1
+MAX_DISKS = 5
+MAX_ATTRIBUTES = 30
+
+OK = 0
+ERR_OPEN = 1
+ERR_NOT_SG = 2
+ERR_IOCTL = 3
+ERR_CRC = 4
+ERR_ARGS = 5
+ERR_TIMEOUT = 6
+ERR_NOT_JMICRON = 7
+ERR_SECTOR_IN_USE = 8
+ERR_LOCKED = 9
+ERR_NO_MEMORY = 10
+ERR_POLL = 11
+
+DISK_STATUS = {0: "healthy", 1: "failed", 2: "error"}
+ATTR_STATUS = {0: "ok", 1: "failed", 2: "unknown"}
+
+
+class Options(ctypes.Structure):
+    _fields_ = [
+        ("sector", ctypes.c_uint32),
+        ("force", ctypes.c_int32),
+        ("retries", ctypes.c_int32),
+        ("expected_disks", ctypes.c_int32),
+        ("lock_timeout_ms", ctypes.c_int32),
+        ("run_dir", ctypes.c_char_p),
+        ("cache_dir", ctypes.c_char_p),
+    ]
+
+
+class Attribute(ctypes.Structure):
+    _fields_ = [
+        ("id", ctypes.c_uint8),
+        ("value", ctypes.c_uint8),
+        ("worst", ctypes.c_uint8),
+        ("thresh", ctypes.c_uint8),
+        ("status", ctypes.c_uint8),
+        ("critical", ctypes.c_uint8),
+        ("reserved", ctypes.c_uint8 * 2),
+        ("raw", ctypes.c_uint64),
+        ("name", ctypes.c_char * 32),
+    ]
+
+
+class Disk(ctypes.Structure):
+    _fields_ = [
+        ("present", ctypes.c_int32),
+        ("status", ctypes.c_int32),
+        ("model", ctypes.c_char * 64),
+        ("serial", ctypes.c_char * 24),
+        ("firmware", ctypes.c_char * 12),
+        ("size_mb", ctypes.c_uint64),
+        ("temperature_c", ctypes.c_int32),
+        ("command_retries", ctypes.c_uint32),
+        ("num_attributes", ctypes.c_uint32),
+        ("attributes", Attribute * MAX_ATTRIBUTES),
+    ]
+
+
+class Flags(ctypes.Structure):
+    _fields_ = [
+        ("presence", ctypes.c_uint8),
+        ("rebuild", ctypes.c_uint8),
+        ("phase", ctypes.c_uint8),
+        ("reserved", ctypes.c_uint8),
+        ("present_disks", ctypes.c_int32),
+        ("degraded", ctypes.c_int32),
+        ("raw", ctypes.c_uint8 * 12),
+    ]
+
+
+class Status(ctypes.Structure):
+    _fields_ = [
+        ("num_disks", ctypes.c_int32),
+        ("present_disks", ctypes.c_int32),
+        ("degraded", ctypes.c_int32),
+        ("status", ctypes.c_int32),
+        ("disks", Disk * MAX_DISKS),
+    ]
+
+
+class JmraidError(Exception):
+    """A libjmraid call failed; `code` is the JMRAID_* error."""
+
+    def __init__(self, code, message):
+        super().__init__(message)
+        self.code = code
+
+
+_lib = None
+
+
+def _candidates():
+    env = os.environ.get("JMRAID_LIB")
+    if env:
+        yield env
+    yield str(Path(__file__).resolve().parent.parent.parent / "bin" / "libjmraid.so.1")
+    found = ctypes.util.find_library("jmraid")
+    if found:
+        yield found
+
+
+def load():
+    """Load the library once; raises OSError if missing or of another ABI."""
+    global _lib
+    if _lib is not None:
+        return _lib
+
+    errors = []
+    for path in _candidates():
+        try:
+            lib = ctypes.CDLL(path)
+            break
+        except OSError as e:
+            errors.append(f"{path}: {e}")
+    else:
+        raise OSError("libjmraid not found (" + "; ".join(errors) + ")")
+
+    lib.jmraid_abi_version.restype = ctypes.c_uint32
+    lib.jmraid_abi_version.argtypes = []
+    if lib.jmraid_abi_version() != ABI_VERSION:
+        raise OSError(f"libjmraid ABI {lib.jmraid_abi_version()} (binding expects {ABI_VERSION})")
+
+    lib.jmraid_version.restype = ctypes.c_char_p
+    lib.jmraid_version.argtypes = []
+    lib.jmraid_options_init.restype = None
+    lib.jmraid_options_init.argtypes = [ctypes.POINTER(Options)]
+    lib.jmraid_open.restype = ctypes.c_void_p
+    lib.jmraid_open.argtypes = [ctypes.c_char_p, ctypes.POINTER(Options), ctypes.POINTER(ctypes.c_int)]
+    lib.jmraid_poll.restype = ctypes.c_int
+    lib.jmraid_poll.argtypes = [ctypes.c_void_p, ctypes.POINTER(Status)]
+    lib.jmraid_poll_flags.restype = ctypes.c_int
+    lib.jmraid_poll_flags.argtypes = [ctypes.c_void_p, ctypes.POINTER(Flags)]
+    lib.jmraid_close.restype = None
+    lib.jmraid_close.argtypes = [ctypes.c_void_p]
+    lib.jmraid_strerror.restype = ctypes.c_char_p
+    lib.jmraid_strerror.argtypes = [ctypes.c_int]
+
+    _lib = lib
+    return lib
+
+
+def version():
+    return load().jmraid_version().decode()
+
+
+def strerror(code):
+    return load().jmraid_strerror(code).decode()
+
+
+def _text(raw):
+    return raw.decode("utf-8", "replace")
+
+
+def _disk_dict(disk):
+    return {
+        "model": _text(disk.model),
+        "serial": _text(disk.serial),
+        "firmware": _text(disk.firmware),
+        "size_mb": disk.size_mb,
+        "status": DISK_STATUS.get(disk.status, "error"),
+        "temperature_celsius": disk.temperature_c if disk.temperature_c >= 0 else None,
+        "command_retries": disk.command_retries,
+        "attributes": [
+            {
+                "id": a.id,
+                "name": _text(a.name),
+                "value": a.value,
+                "worst": a.worst,
+                "thresh": a.thresh,
+                "raw": a.raw,
+                "status": ATTR_STATUS.get(a.status, "unknown"),
+                "critical": bool(a.critical),
+            }
+            for a in disk.attributes[:min(disk.num_attributes, MAX_ATTRIBUTES)]
+        ],
+    }
+
+
+class Session:
+    """One open, woken controller (jmraid_open .. jmraid_close)."""
+
+    def __init__(self, device, sector=33, force=False, retries=2, expected_disks=0,
+                 lock_timeout_ms=30000, run_dir="/run/jmraidstatus", cache_dir=None):
+        self._lib = load()
+        self._handle = None
+        self.device = device
+
+        # Keep the encoded strings alive for the call
+        self._run_dir = run_dir.encode() if run_dir else None
+        self._cache_dir = cache_dir.encode() if cache_dir else None
+        options = Options()
+        self._lib.jmraid_options_init(ctypes.byref(options))
+        options.sector = sector
+        options.force = 1 if force else 0
+        options.retries = retries
+        options.expected_disks = expected_disks
+        options.lock_timeout_ms = lock_timeout_ms
+        options.run_dir = self._run_dir
+        options.cache_dir = self._cache_dir
+
+        error = ctypes.c_int(0)
+        handle = self._lib.jmraid_open(device.encode(), ctypes.byref(options), ctypes.byref(error))
+        if not handle:
+            raise JmraidError(error.value, f"{device}: {strerror(error.value)}")
+        self._handle = handle
+
+    def _check(self, code):
+        if code != OK:
+            raise JmraidError(code, f"{self.device}: {strerror(code)}")
+
+    def poll_flags(self):
+        """RAID flags from one IDENTIFY, shaped like --flags JSON raid_status."""
+        if self._handle is None:
+            raise JmraidError(ERR_ARGS, "session is closed")
+        flags = Flags()
+        self._check(self._lib.jmraid_poll_flags(self._handle, ctypes.byref(flags)))
+        return {
+            "present_disks": flags.present_disks,
+            "degraded": bool(flags.degraded),
+            "rebuilding": flags.rebuild != 0,
+            "flags": {
+                "presence": flags.presence,
+                "rebuild": flags.rebuild,
+                "phase": flags.phase,
+                "raw": bytes(flags.raw).hex(),
+            },
+        }
+
+    def poll(self):
+        """IDENTIFY and SMART data of every disk; absent slots are None."""
+        if self._handle is None:
+            raise JmraidError(ERR_ARGS, "session is closed")
+        status = Status()
+        self._check(self._lib.jmraid_poll(self._handle, ctypes.byref(status)))
+        return {
+            "num_disks": status.num_disks,
+            "present_disks": status.present_disks,
+            "degraded": bool(status.degraded),
+            "status": DISK_STATUS.get(status.status, "error"),
+            "disks": [_disk_dict(d) if d.present else None for d in status.disks],
+        }
+
+    def close(self):
+        """Restore the mailbox sector and close the device (idempotent)."""
+        if self._handle is not None:
+            self._lib.jmraid_close(self._handle)
+            self._handle = None
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+        return False
+
+    def __del__(self):
+        try:
+            self.close()
+        except Exception:
+            pass
@@ -6,13 +6,18 @@ Monitors RAID status flags and sends email alerts on state changes.
 
 import os
 import sys
+import signal
 import subprocess
+import json
 import re
+import time
+import argparse
 from datetime import datetime
 from pathlib import Path
 
 # Import email notifier module
 import email_notifier
+import jmraid
 
 # Configuration
 SCRIPT_DIR = Path(__file__).parent
@@ -66,18 +71,29 @@ def set_disconnect_state(state):
         f.write(state)
 
 
-def capture_raid_state():
-    """Capture current RAID state using jmraidstatus."""
+def capture_raid_state(session=None):
+    """Capture current RAID state using jmraidstatus --flags (one IDENTIFY, no SMART reads).
+
+    With a libjmraid session the flags are read in process and returned as
+    the same JSON line jmraidstatus --flags --json-only prints.
+    """
+    if session is not None:
+        try:
+            return json.dumps({"raid_status": session.poll_flags()}) + "\n"
+        except jmraid.JmraidError as e:
+            log(f"ERROR capturing RAID state: {e}")
+            return None
+
     try:
-        # Use sudo env to pass environment variable
         result = subprocess.run(
-            ["sudo", "env", "JMRAIDSTATUS_DUMP_RAW=1", str(JMRAIDSTATUS_BIN), DEVICE],
+            ["sudo", str(JMRAIDSTATUS_BIN), "--flags", "--json-only", DEVICE],
             capture_output=True,
             text=True,
             timeout=30
         )
 
-        if result.returncode != 0:
+        # Exit code 1 is a degraded or rebuilding array, which the flags show
+        if result.returncode not in (0, 1):
             log(f"WARNING: jmraidstatus returned exit code {result.returncode}")
 
         return result.stdout + result.stderr
@@ -89,9 +105,39 @@ def capture_raid_state():
         return None
 
 
+def extract_flags_json(output):
+    """Extract RAID status flags from jmraidstatus --flags --json-only output."""
+    for line in output.splitlines():
+        if not line.startswith("{"):
+            continue
+        try:
+            raid_status = json.loads(line)["raid_status"]
+            raw = raid_status["flags"]["raw"]
+        except (ValueError, KeyError):
+            continue
+
+        hex_bytes = [raw[i:i + 2] for i in range(0, len(raw), 2)]
+        if len(hex_bytes) < 12:
+            continue
+        return {
+            "0x1F0": hex_bytes[0],
+            "0x1F2": hex_bytes[2],
+            "0x1F5": hex_bytes[5],
+            "0x1F9": hex_bytes[9],
+            "0x1FA": hex_bytes[10],
+            "raw": " ".join(hex_bytes[:12]),
+            "num_disks": raid_status.get("present_disks", 0)
+        }
+    return None
+
+
 def extract_flags(raw_output):
-    """Extract RAID status flags from raw output."""
-    # Find all 0x1F0 offset lines (one per disk)
+    """Extract RAID status flags from --flags JSON or a raw protocol dump."""
+    flags = extract_flags_json(raw_output)
+    if flags:
+        return flags
+
+    # Older captures: JMRAIDSTATUS_DUMP_RAW=1 hex dumps, one 0x1F0 line per disk
     pattern = r"^01f0:\s+([0-9a-f ]+)"
     matches = re.findall(pattern, raw_output, re.MULTILINE)
 
@@ -282,7 +328,18 @@ def compare_states(old_flags, new_flags):
         return "NO_CHANGE"
 
 
-def check_raid_state():
+def open_session():
+    """Open a libjmraid session on DEVICE, or None to use jmraidstatus via sudo."""
+    try:
+        session = jmraid.Session(DEVICE)
+    except (OSError, jmraid.JmraidError) as e:
+        log(f"libjmraid unavailable, using jmraidstatus: {e}")
+        return None
+    log(f"Polling {DEVICE} in process (libjmraid {jmraid.version()})")
+    return session
+
+
+def check_raid_state(session=None):
     """Main check function."""
     log("=" * 60)
     log("Starting RAID state check")
@@ -355,7 +412,7 @@ Timestamp: {datetime.now().strftime('%Y-%m-%d %H:%M:%S')}
                 log(f"ERROR sending reconnect email: {error}")
 
     # Capture current state
-    raw_output = capture_raid_state()
+    raw_output = capture_raid_state(session)
     if not raw_output:
         log("ERROR: Failed to capture RAID state")
         return False
@@ -437,9 +494,39 @@ Timestamp: {datetime.now().strftime('%Y-%m-%d %H:%M:%S')}
     return True
 
 
+def run(interval):
+    """Check every `interval` seconds on one persistent session until stopped."""
+    session = None
+
+    # SIGTERM unwinds like Ctrl+C, so the session restores the mailbox sector
+    signal.signal(signal.SIGTERM, lambda signum, frame: sys.exit(0))
+    try:
+        while True:
+            if session is None and is_device_connected():
+                session = open_session()
+            if not check_raid_state(session) and session is not None:
+                # Disconnected or failing: reopen once the device answers again
+                session.close()
+                session = None
+            time.sleep(interval)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        if session is not None:
+            session.close()
+
+
 if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="JMicron RAID state monitor")
+    parser.add_argument("--interval", type=int, metavar="SECONDS",
+                        help="keep running, checking every SECONDS on one libjmraid session")
+    args = parser.parse_args()
+
     try:
-        check_raid_state()
+        if args.interval:
+            run(args.interval)
+        else:
+            check_raid_state()
     except Exception as e:
         log(f"FATAL ERROR: {e}")
         import traceback